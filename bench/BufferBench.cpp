@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include "SampleFiles.hpp"
+#include "core/Buffer.hpp"
+
+namespace {
+using bench::kMiB;
+using bench::SampleFile;
+using bench::SizeLabel;
+
+constexpr std::uint64_t kSizes[] = {1 * kMiB, 16 * kMiB, 256 * kMiB,
+                                    1024 * kMiB};
+constexpr std::uint64_t kDefaultMaxBytes = 256 * kMiB;
+// Edits between reloads, which keep the journal and the piece table from
+// growing without bound; the reload is not timed.
+constexpr std::size_t kEditsPerLoad = 1 << 16;
+
+bool Load(benchmark::State& state, core::Buffer& buffer,
+          const std::string& path) {
+  if (!buffer.LoadFromFile(path, core::LoadStrategy::kRead)) {
+    state.SkipWithError("cannot load sample file");
+    return false;
+  }
+  return true;
+}
+
+// Until every line is indexed. A mapped file's index is kept in IndexCache
+// after the first load, so with kMap this is what opening it again costs.
+void BM_BufferLoad(benchmark::State& state, core::LoadStrategy strategy,
+                   std::uint64_t size) {
+  const std::string kPath = SampleFile(size);
+  for (auto _ : state) {
+    core::Buffer buffer;
+    if (!buffer.LoadFromFile(kPath, strategy)) {
+      state.SkipWithError("cannot load sample file");
+      break;
+    }
+    buffer.FinishIndexing();
+    benchmark::DoNotOptimize(buffer.LineCount());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(size));
+}
+
+void BM_BufferSave(benchmark::State& state, std::uint64_t size) {
+  const std::string kPath = SampleFile(size);
+  const std::string kOutput = kPath + ".saved";
+  core::Buffer buffer;
+  if (!Load(state, buffer, kPath)) {
+    return;
+  }
+  // Edited, so the pieces are those of a buffer in use.
+  buffer.InsertChar(buffer.LineCount() / 2, 0, 'x');
+  for (auto _ : state) {
+    if (!buffer.SaveToFile(kOutput)) {
+      state.SkipWithError("cannot save sample file");
+      break;
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(size));
+  std::error_code error;
+  std::filesystem::remove(kOutput, error);
+}
+
+// Spread over the buffer, as edits rarely come at one place only.
+void BM_BufferInsertChar(benchmark::State& state, std::uint64_t size) {
+  const std::string kPath = SampleFile(size);
+  core::Buffer buffer;
+  if (!Load(state, buffer, kPath)) {
+    return;
+  }
+  const std::size_t kLines = buffer.LineCount();
+  std::size_t edits = 0;
+  for (auto _ : state) {
+    if (++edits % kEditsPerLoad == 0) {
+      state.PauseTiming();
+      Load(state, buffer, kPath);
+      state.ResumeTiming();
+    }
+    buffer.InsertChar((edits * 7919) % kLines, 0, 'x');
+  }
+}
+
+void BM_BufferDeleteLine(benchmark::State& state, std::uint64_t size) {
+  const std::string kPath = SampleFile(size);
+  core::Buffer buffer;
+  if (!Load(state, buffer, kPath)) {
+    return;
+  }
+  const std::size_t kLines = buffer.LineCount();
+  std::size_t edits = 0;
+  for (auto _ : state) {
+    if (++edits % kEditsPerLoad == 0 || buffer.LineCount() <= kLines / 2) {
+      state.PauseTiming();
+      Load(state, buffer, kPath);
+      state.ResumeTiming();
+    }
+    buffer.DeleteLine((edits * 7919) % buffer.LineCount());
+  }
+}
+
+bool RegisterBenchmarks() {
+  const std::uint64_t kMaxBytes = bench::MaxBytes(kDefaultMaxBytes);
+  for (const std::uint64_t kSize : kSizes) {
+    if (kSize > kMaxBytes) {
+      continue;
+    }
+    const std::string kLabel = "/" + SizeLabel(kSize);
+    benchmark::RegisterBenchmark(("BM_BufferLoadRead" + kLabel).c_str(),
+                                 BM_BufferLoad, core::LoadStrategy::kRead,
+                                 kSize)
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("BM_BufferReopenMapped" + kLabel).c_str(),
+                                 BM_BufferLoad, core::LoadStrategy::kMap,
+                                 kSize)
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("BM_BufferSave" + kLabel).c_str(),
+                                 BM_BufferSave, kSize)
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("BM_BufferInsertChar" + kLabel).c_str(),
+                                 BM_BufferInsertChar, kSize);
+    benchmark::RegisterBenchmark(("BM_BufferDeleteLine" + kLabel).c_str(),
+                                 BM_BufferDeleteLine, kSize);
+  }
+  return true;
+}
+
+const bool kRegistered = RegisterBenchmarks();
+}  // namespace
@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/EventQueue.hpp"
+#include "core/KeyEvent.hpp"
+
+namespace {
+constexpr std::size_t kEventsPerRun = 1 << 16;
+
+// Consumers yield when they find nothing so the producer can run even on a
+// single core.
+
+// The queue EventQueue replaced: a mutex around a vector that is handed out
+// whole on every consume.
+class MutexVectorQueue {
+ public:
+  void Push(const core::KeyEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back(event);
+  }
+
+  std::vector<core::KeyEvent> ConsumeAll() {
+    std::vector<core::KeyEvent> result;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      result.swap(events_);
+    }
+    return result;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<core::KeyEvent> events_;
+};
+
+void BM_MutexVectorQueueTransfer(benchmark::State& state) {
+  for (auto _ : state) {
+    MutexVectorQueue queue;
+    std::jthread producer([&queue] {
+      for (std::size_t i = 0; i < kEventsPerRun; ++i) {
+        queue.Push(core::MakeCharacterEvent(static_cast<char>('a' + i % 26)));
+      }
+    });
+
+    std::size_t received = 0;
+    std::uint64_t checksum = 0;
+    while (received < kEventsPerRun) {
+      const std::vector<core::KeyEvent> kEvents = queue.ConsumeAll();
+      for (const core::KeyEvent& event : kEvents) {
+        checksum += static_cast<unsigned char>(event.value);
+      }
+      received += kEvents.size();
+      if (kEvents.empty()) {
+        std::this_thread::yield();
+      }
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(kEventsPerRun));
+}
+
+void BM_EventQueueTransfer(benchmark::State& state) {
+  for (auto _ : state) {
+    core::EventQueue queue;
+    std::jthread producer([&queue] {
+      for (std::size_t i = 0; i < kEventsPerRun; ++i) {
+        queue.Push(core::MakeCharacterEvent(static_cast<char>('a' + i % 26)));
+      }
+    });
+
+    std::size_t received = 0;
+    std::uint64_t checksum = 0;
+    while (received < kEventsPerRun) {
+      const std::size_t kCount =
+          queue.Drain([&checksum](const core::KeyEvent& event) {
+            checksum += static_cast<unsigned char>(event.value);
+            return true;
+          });
+      received += kCount;
+      if (kCount == 0) {
+        std::this_thread::yield();
+      }
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(kEventsPerRun));
+}
+
+// The per-frame cost when a single key arrives between frames.
+void BM_MutexVectorQueueFrame(benchmark::State& state) {
+  MutexVectorQueue queue;
+  for (auto _ : state) {
+    queue.Push(core::MakeCharacterEvent('x'));
+    benchmark::DoNotOptimize(queue.ConsumeAll());
+  }
+}
+
+void BM_EventQueueFrame(benchmark::State& state) {
+  core::EventQueue queue;
+  for (auto _ : state) {
+    queue.Push(core::MakeCharacterEvent('x'));
+    benchmark::DoNotOptimize(
+        queue.Drain([](const core::KeyEvent& /*event*/) { return true; }));
+  }
+}
+}  // namespace
+
+BENCHMARK(BM_MutexVectorQueueTransfer)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_EventQueueTransfer)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MutexVectorQueueFrame);
+BENCHMARK(BM_EventQueueFrame);
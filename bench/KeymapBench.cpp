@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+#include "core/KeyEvent.hpp"
+#include "core/Keymap.hpp"
+#include "core/Mode.hpp"
+#include "core/Registry.hpp"
+
+namespace {
+constexpr char kBindingKeys[] = "hjklwbeioaAIOxpPuGn";
+
+void RegisterBindings() {
+  static const bool kRegistered = [] {
+    core::Registry& registry = core::Registry::Instance();
+    const core::Origin kOrigin{core::RegistryOriginKind::kCore, "bench"};
+    for (const char kKey : std::string(kBindingKeys)) {
+      core::CommandRegistration command;
+      command.descriptor.id = std::string("bench.key.") + kKey;
+      command.descriptor.modes = {core::Mode::kNormal};
+      command.callable.native_callback =
+          [](const core::CommandInvocation& invocation) {
+            benchmark::DoNotOptimize(&invocation);
+          };
+      registry.RegisterCommand(command, kOrigin);
+
+      core::KeybindingRegistration binding;
+      binding.descriptor.id = command.descriptor.id + ".binding";
+      binding.descriptor.command_id = command.descriptor.id;
+      binding.descriptor.mode = core::KeybindingMode::kNormal;
+      binding.descriptor.gesture = std::string(1, kKey);
+      binding.descriptor.arguments = {{"count", "1"}};
+      registry.RegisterKeybinding(binding, kOrigin);
+    }
+    return true;
+  }();
+  benchmark::DoNotOptimize(kRegistered);
+}
+
+// A lookup of a bound gesture, and of one nothing is bound to: the same
+// key after a Z.
+void BM_RegistryResolveKeybinding(benchmark::State& state, bool bound) {
+  RegisterBindings();
+  core::Registry& registry = core::Registry::Instance();
+  std::size_t next = 0;
+  std::string gesture = bound ? " " : "Z ";
+  for (auto _ : state) {
+    gesture.back() = kBindingKeys[next++ % (sizeof(kBindingKeys) - 1)];
+    benchmark::DoNotOptimize(
+        registry.ResolveKeybinding(core::KeybindingMode::kNormal, gesture));
+  }
+}
+
+// The dispatch Keymap replaced: a gesture string, a locked lookup of the
+// binding and then of its command, each returned by copy.
+void BM_RegistryDispatch(benchmark::State& state) {
+  RegisterBindings();
+  core::Registry& registry = core::Registry::Instance();
+  std::size_t next = 0;
+  for (auto _ : state) {
+    const char kKey = kBindingKeys[next++ % (sizeof(kBindingKeys) - 1)];
+    const std::string kGesture(1, kKey);
+    auto binding =
+        registry.ResolveKeybinding(core::KeybindingMode::kNormal, kGesture);
+    auto command = registry.FindCommand(binding->descriptor.command_id, true);
+    core::CommandInvocation invocation;
+    invocation.command_id = binding->descriptor.command_id;
+    invocation.arguments = binding->descriptor.arguments;
+    command->callable.native_callback(invocation);
+  }
+}
+
+void BM_KeymapDispatch(benchmark::State& state) {
+  RegisterBindings();
+  core::Registry& registry = core::Registry::Instance();
+  std::shared_ptr<const core::Keymap> keymap = registry.CompileKeymap();
+  std::size_t next = 0;
+  for (auto _ : state) {
+    const char kKey = kBindingKeys[next++ % (sizeof(kBindingKeys) - 1)];
+    if (keymap->Version() != registry.Version()) {
+      keymap = registry.CompileKeymap();
+    }
+    const core::Keymap::Binding* binding =
+        keymap->Find(core::Mode::kNormal, core::MakeCharacterEvent(kKey));
+    binding->callback(binding->invocation);
+  }
+}
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_RegistryResolveKeybinding, Bound, true);
+BENCHMARK_CAPTURE(BM_RegistryResolveKeybinding, Unbound, false);
+BENCHMARK(BM_RegistryDispatch);
+BENCHMARK(BM_KeymapDispatch);
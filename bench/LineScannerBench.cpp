@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "SampleFiles.hpp"
+#include "core/LineScanner.hpp"
+#include "io/MappedFile.hpp"
+
+namespace {
+using bench::kMiB;
+using bench::SampleFile;
+using bench::SizeLabel;
+
+constexpr std::uint64_t kSizes[] = {1 * kMiB,   16 * kMiB,   256 * kMiB,
+                                    1024 * kMiB, 4096 * kMiB};
+constexpr std::uint64_t kDefaultMaxBytes = 4096 * kMiB;
+
+// The loader that LineScanner replaced.
+void BM_GetlineLoop(benchmark::State& state, std::uint64_t size) {
+  const std::string kPath = SampleFile(size);
+  for (auto _ : state) {
+    std::ifstream input(kPath);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(input, line)) {
+      lines.push_back(line);
+    }
+    benchmark::DoNotOptimize(lines.data());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(size));
+}
+
+void BM_LineScanner(benchmark::State& state, core::ScanKernel kernel,
+                    std::uint64_t size) {
+  const std::string kPath = SampleFile(size);
+  std::vector<std::uint64_t> starts;
+  for (auto _ : state) {
+    core::MappedFile file;
+    if (!file.Open(kPath)) {
+      state.SkipWithError("cannot map sample file");
+      break;
+    }
+    core::LineScanner scanner(kernel);
+    starts.clear();
+    scanner.Scan(file.View(), 0, starts);
+    scanner.Finish();
+    benchmark::DoNotOptimize(starts.data());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(size));
+}
+
+bool RegisterBenchmarks() {
+  struct KernelName {
+    core::ScanKernel kernel;
+    const char* name;
+  };
+  constexpr KernelName kKernels[] = {
+      {core::ScanKernel::kScalar, "Scalar"},
+      {core::ScanKernel::kSse2, "Sse2"},
+      {core::ScanKernel::kAvx2, "Avx2"},
+      {core::ScanKernel::kNeon, "Neon"},
+  };
+
+  const std::uint64_t kMaxBytes = bench::MaxBytes(kDefaultMaxBytes);
+  for (const std::uint64_t kSize : kSizes) {
+    if (kSize > kMaxBytes) {
+      continue;
+    }
+    benchmark::RegisterBenchmark(("BM_GetlineLoop/" + SizeLabel(kSize)).c_str(),
+                                 BM_GetlineLoop, kSize)
+        ->Unit(benchmark::kMillisecond);
+    for (const KernelName& entry : kKernels) {
+      if (!core::LineScanner::IsSupported(entry.kernel)) {
+        continue;
+      }
+      benchmark::RegisterBenchmark(("BM_LineScanner" + std::string(entry.name) +
+                                    "/" + SizeLabel(kSize))
+                                       .c_str(),
+                                   BM_LineScanner, entry.kernel, kSize)
+          ->Unit(benchmark::kMillisecond);
+    }
+  }
+  return true;
+}
+
+const bool kRegistered = RegisterBenchmarks();
+}  // namespace
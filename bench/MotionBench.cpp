@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include "SampleFiles.hpp"
+#include "core/Buffer.hpp"
+#include "core/Motions.hpp"
+#include "core/TextPosition.hpp"
+
+namespace {
+using bench::kMiB;
+using core::TextPosition;
+
+using Motion = TextPosition (*)(const core::Buffer&, TextPosition);
+
+// Steps `motion` through the whole buffer and starts over, one step per
+// iteration; a backward motion starts from the end.
+void BM_Motion(benchmark::State& state, Motion motion, bool backward) {
+  core::Buffer buffer;
+  if (!buffer.LoadFromFile(bench::SampleSource(4 * kMiB),
+                           core::LoadStrategy::kRead)) {
+    state.SkipWithError("cannot load sample file");
+    return;
+  }
+  const TextPosition kStart{};
+  const TextPosition kEnd{buffer.LineCount() - 1,
+                          buffer.GetLine(buffer.LineCount() - 1).size()};
+  TextPosition position = backward ? kEnd : kStart;
+  for (auto _ : state) {
+    const TextPosition kNext = motion(buffer, position);
+    position = kNext == position ? (backward ? kEnd : kStart) : kNext;
+    benchmark::DoNotOptimize(position);
+  }
+}
+
+// e and E stay on the end they reached, so they step past it first.
+template <Motion kMotion>
+TextPosition PastEnd(const core::Buffer& buffer, TextPosition position) {
+  const TextPosition kEnd =
+      kMotion(buffer, {position.line, position.column + 1});
+  return kEnd.line == position.line && kEnd.column <= position.column
+             ? position
+             : kEnd;
+}
+
+bool RegisterBenchmarks() {
+  struct MotionName {
+    Motion motion;
+    bool backward;
+    const char* name;
+  };
+  constexpr MotionName kMotions[] = {
+      {core::NextWordStart, false, "w"},
+      {core::NextBigWordStart, false, "W"},
+      {core::PreviousWordStart, true, "b"},
+      {core::PreviousBigWordStart, true, "B"},
+      {PastEnd<core::WordEndInclusive>, false, "e"},
+      {PastEnd<core::BigWordEndInclusive>, false, "E"},
+      {core::NextParagraphStart, false, "}"},
+      {core::PreviousParagraphStart, true, "{"},
+  };
+
+  for (const MotionName& entry : kMotions) {
+    benchmark::RegisterBenchmark(
+        ("BM_Motion/" + std::string(entry.name)).c_str(), BM_Motion,
+        entry.motion, entry.backward);
+  }
+  return true;
+}
+
+const bool kRegistered = RegisterBenchmarks();
+}  // namespace
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "core/Mode.hpp"
+#include "core/Registry.hpp"
+
+namespace {
+constexpr std::size_t kCommands = 64;
+const core::Origin kOrigin{core::RegistryOriginKind::kCore, "bench"};
+
+std::string CommandId(std::size_t index) {
+  return "bench.registry." + std::to_string(index);
+}
+
+core::CommandRegistration MakeCommand(std::string id) {
+  core::CommandRegistration command;
+  command.descriptor.id = std::move(id);
+  command.descriptor.modes = {core::Mode::kNormal};
+  command.callable.native_callback =
+      [](const core::CommandInvocation& invocation) {
+        benchmark::DoNotOptimize(&invocation);
+      };
+  return command;
+}
+
+void RegisterCommands() {
+  static const bool kRegistered = [] {
+    for (std::size_t i = 0; i < kCommands; ++i) {
+      core::Registry::Instance().RegisterCommand(MakeCommand(CommandId(i)),
+                                                 kOrigin);
+    }
+    return true;
+  }();
+  benchmark::DoNotOptimize(kRegistered);
+}
+
+// Every thread looks commands up, as plugins and workers would.
+void BM_RegistryFindCommand(benchmark::State& state) {
+  RegisterCommands();
+  core::Registry& registry = core::Registry::Instance();
+  const std::string kId =
+      CommandId(static_cast<std::size_t>(state.thread_index()) % kCommands);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(registry.FindCommand(kId));
+  }
+}
+
+// The same while another thread registers and drops a command over and
+// over.
+void BM_RegistryFindCommandWhileWriting(benchmark::State& state) {
+  RegisterCommands();
+  core::Registry& registry = core::Registry::Instance();
+  std::optional<std::jthread> writer;
+  if (state.thread_index() == 0) {
+    writer.emplace([&registry](const std::stop_token& token) {
+      const core::CommandRegistration kCommand =
+          MakeCommand("bench.registry.churn");
+      while (!token.stop_requested()) {
+        registry.Unregister(registry.RegisterCommand(kCommand, kOrigin).handle);
+      }
+    });
+  }
+  const std::string kId =
+      CommandId(static_cast<std::size_t>(state.thread_index()) % kCommands);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(registry.FindCommand(kId));
+  }
+}
+}  // namespace
+
+BENCHMARK(BM_RegistryFindCommand)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_RegistryFindCommandWhileWriting)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "SampleFiles.hpp"
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/Renderer.hpp"
+#include "io/Terminal.hpp"
+
+namespace {
+using bench::kMiB;
+
+constexpr core::TerminalSize kSizes[] = {{24, 80}, {50, 160}, {100, 320}};
+
+// A terminal of a fixed size that drops what is written to it, counting
+// the bytes.
+class NullSink final : public core::TerminalSink {
+ public:
+  explicit NullSink(core::TerminalSize size) : size_(size) {}
+
+  auto Size() -> core::TerminalSize override { return size_; }
+  auto Write(std::string_view bytes) -> bool override {
+    bytes_ += bytes.size();
+    return true;
+  }
+
+  std::uint64_t Bytes() const noexcept { return bytes_; }
+
+ private:
+  core::TerminalSize size_;
+  std::uint64_t bytes_ = 0;
+};
+
+enum class Frame : std::uint8_t {
+  // Nothing changed, so nothing is sent.
+  kUnchanged,
+  // The cursor moves down a line and the view with it, once at the bottom.
+  kScroll,
+  // Every row is drawn again, as after a resize.
+  kFull,
+};
+
+void BM_Render(benchmark::State& state, Frame frame, core::TerminalSize size) {
+  core::EditorState editor;
+  bool created = false;
+  editor.OpenBuffer(bench::SampleSource(1 * kMiB), created);
+  if (created) {
+    state.SkipWithError("cannot load sample file");
+    return;
+  }
+  NullSink sink(size);
+  core::Renderer renderer;
+  renderer.SetSink(sink);
+  renderer.Prepare();
+  renderer.Render(editor, "", 0);
+  editor.GetBuffer().ClearDamage();
+
+  const std::uint64_t kBytesBefore = sink.Bytes();
+  const std::uint64_t kAllocationsBefore = renderer.AllocationCount();
+  const std::size_t kLines = editor.GetBuffer().LineCount();
+  for (auto _ : state) {
+    if (frame == Frame::kScroll) {
+      if (editor.CursorLine() + 1 >= kLines) {
+        editor.SetCursor(0, 0);
+      } else {
+        editor.MoveCursorLine(1);
+      }
+    } else if (frame == Frame::kFull) {
+      renderer.SetSink(sink);
+    }
+    renderer.Render(editor, "", 0);
+    editor.GetBuffer().ClearDamage();
+  }
+  state.counters["bytes_per_frame"] = benchmark::Counter(
+      static_cast<double>(sink.Bytes() - kBytesBefore),
+      benchmark::Counter::kAvgIterations);
+  state.counters["allocations"] = static_cast<double>(
+      renderer.AllocationCount() - kAllocationsBefore);
+}
+
+bool RegisterBenchmarks() {
+  struct FrameName {
+    Frame frame;
+    const char* name;
+  };
+  constexpr FrameName kFrames[] = {
+      {Frame::kUnchanged, "Unchanged"},
+      {Frame::kScroll, "Scroll"},
+      {Frame::kFull, "Full"},
+  };
+
+  for (const FrameName& entry : kFrames) {
+    for (const core::TerminalSize& kSize : kSizes) {
+      benchmark::RegisterBenchmark(
+          ("BM_Render" + std::string(entry.name) + "/" +
+           std::to_string(kSize.rows) + "x" + std::to_string(kSize.columns))
+              .c_str(),
+          BM_Render, entry.frame, kSize);
+    }
+  }
+  return true;
+}
+
+const bool kRegistered = RegisterBenchmarks();
+}  // namespace
@@ -0,0 +1,570 @@
+// microvi_replay plays a trace of keys through the editor without a
+// terminal, as fast as it goes, and reports what each key cost.
+//
+//   microvi_replay [--json FILE] [--output FILE] [--profile FILE] TRACE
+//
+// A trace is a line per step; blank lines and those starting with '#' are
+// skipped. microvi -w writes one.
+//
+//   size ROWSxCOLUMNS    the size of the screen, 24x80 unless set
+//   open PATH            opens a file, as microvi PATH does
+//   sample MIB           opens a sample log of MIB MiB, written once
+//   keys KEYS            types KEYS, in the notation of KeyNotation.hpp
+//   repeat COUNT KEYS    types KEYS COUNT times
+//   wait                 until indexing, searches and commands are done
+//
+// Every key is handled, the editor's background work picked up and a frame
+// drawn, as the editor does for a key typed on its own; the time that takes
+// is the key's latency. The frames go to memory (and to --output), counted
+// in bytes, and the heap allocations the main thread makes are counted.
+// In a build with MICROVI_PROFILING, --profile writes where the time went
+// as Chrome trace events (see core/Profiler.hpp).
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SampleFiles.hpp"
+#include "commands/BuiltinCommands.hpp"
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/InputHandler.hpp"
+#include "core/ModeController.hpp"
+#include "core/PluginHost.hpp"
+#include "core/Profiler.hpp"
+#include "core/Renderer.hpp"
+#include "core/ScriptedKeySource.hpp"
+#include "core/WorkerPool.hpp"
+#include "io/Terminal.hpp"
+#include "io/Waker.hpp"
+
+namespace {
+// Only the main thread's, so that indexing and other background work do
+// not count against the keys.
+thread_local std::uint64_t t_allocations = 0;
+
+// What plain operator new guarantees, and malloc() with it.
+constexpr std::size_t kDefault = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+// Every replaceable operator new and delete below comes here, so that
+// memory from one form is never freed by another.
+void* Allocate(std::size_t size, std::size_t alignment) noexcept {
+  ++t_allocations;
+  size = size == 0 ? 1 : size;
+  if (alignment <= kDefault) {
+    return std::malloc(size);
+  }
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  // aligned_alloc wants a multiple of the alignment.
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+void* AllocateOrThrow(std::size_t size, std::size_t alignment) {
+  void* memory = Allocate(size, alignment);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void Release(void* memory, std::size_t alignment) noexcept {
+#ifdef _WIN32
+  if (alignment > kDefault) {
+    _aligned_free(memory);
+    return;
+  }
+#else
+  static_cast<void>(alignment);
+#endif
+  std::free(memory);
+}
+
+std::size_t Alignment(std::align_val_t alignment) noexcept {
+  return static_cast<std::size_t>(alignment);
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+  return AllocateOrThrow(size, kDefault);
+}
+
+void* operator new[](std::size_t size) {
+  return AllocateOrThrow(size, kDefault);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& /*tag*/) noexcept {
+  return Allocate(size, kDefault);
+}
+
+void* operator new[](std::size_t size,
+                     const std::nothrow_t& /*tag*/) noexcept {
+  return Allocate(size, kDefault);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, Alignment(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, Alignment(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t& /*tag*/) noexcept {
+  return Allocate(size, Alignment(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t& /*tag*/) noexcept {
+  return Allocate(size, Alignment(alignment));
+}
+
+void operator delete(void* memory) noexcept { Release(memory, kDefault); }
+
+void operator delete[](void* memory) noexcept { Release(memory, kDefault); }
+
+void operator delete(void* memory, const std::nothrow_t& /*tag*/) noexcept {
+  Release(memory, kDefault);
+}
+
+void operator delete[](void* memory, const std::nothrow_t& /*tag*/) noexcept {
+  Release(memory, kDefault);
+}
+
+void operator delete(void* memory, std::size_t /*size*/) noexcept {
+  Release(memory, kDefault);
+}
+
+void operator delete[](void* memory, std::size_t /*size*/) noexcept {
+  Release(memory, kDefault);
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept {
+  Release(memory, Alignment(alignment));
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept {
+  Release(memory, Alignment(alignment));
+}
+
+void operator delete(void* memory, std::align_val_t alignment,
+                     const std::nothrow_t& /*tag*/) noexcept {
+  Release(memory, Alignment(alignment));
+}
+
+void operator delete[](void* memory, std::align_val_t alignment,
+                       const std::nothrow_t& /*tag*/) noexcept {
+  Release(memory, Alignment(alignment));
+}
+
+void operator delete(void* memory, std::size_t /*size*/,
+                     std::align_val_t alignment) noexcept {
+  Release(memory, Alignment(alignment));
+}
+
+void operator delete[](void* memory, std::size_t /*size*/,
+                       std::align_val_t alignment) noexcept {
+  Release(memory, Alignment(alignment));
+}
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// How often background work is looked at while waiting for it, as the
+// editor does.
+constexpr std::chrono::milliseconds kPollInterval{50};
+
+// A screen of a set size that keeps nothing of what is drawn on it, but
+// for a copy to `output`.
+class MemorySink final : public core::TerminalSink {
+ public:
+  auto Size() -> core::TerminalSize override { return size_; }
+  auto Write(std::string_view bytes) -> bool override {
+    bytes_ += bytes.size();
+    if (output_ != nullptr) {
+      output_->write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    return true;
+  }
+
+  void SetSize(core::TerminalSize size) noexcept { size_ = size; }
+  void SetOutput(std::ostream* output) noexcept { output_ = output; }
+  std::uint64_t Bytes() const noexcept { return bytes_; }
+
+ private:
+  core::TerminalSize size_;
+  std::ostream* output_ = nullptr;
+  std::uint64_t bytes_ = 0;
+};
+
+struct Percentiles {
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double max = 0;
+  double mean = 0;
+};
+
+template <typename Value>
+Percentiles Summarize(std::vector<Value> values) {
+  Percentiles summary;
+  if (values.empty()) {
+    return summary;
+  }
+  std::sort(values.begin(), values.end());
+  const auto kAt = [&values](double fraction) {
+    const auto kIndex = static_cast<std::size_t>(
+        fraction * static_cast<double>(values.size() - 1) + 0.5);
+    return static_cast<double>(values[kIndex]);
+  };
+  summary.p50 = kAt(0.50);
+  summary.p90 = kAt(0.90);
+  summary.p99 = kAt(0.99);
+  summary.max = static_cast<double>(values.back());
+  double total = 0;
+  for (const Value& value : values) {
+    total += static_cast<double>(value);
+  }
+  summary.mean = total / static_cast<double>(values.size());
+  return summary;
+}
+
+double Milliseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+class Replay {
+ public:
+  Replay() : mode_controller_(state_, command_handler_, plugin_host_) {
+    plugin_host_.SetWakeHook([this] { wakeup_.Notify(); });
+    mode_controller_.SetSearchWakeHook([this] { wakeup_.Notify(); });
+    command_handler_.SetWakeHook([this] { wakeup_.Notify(); });
+    core::WorkerPool::Shared().SetWakeHook([this] { wakeup_.Notify(); });
+    commands::RegisterBuiltinCommands(command_handler_, plugin_host_);
+    renderer_.SetSink(sink_);
+  }
+
+  ~Replay() { core::WorkerPool::Shared().SetWakeHook({}); }
+
+  Replay(const Replay&) = delete;
+  Replay& operator=(const Replay&) = delete;
+  Replay(Replay&&) = delete;
+  Replay& operator=(Replay&&) = delete;
+
+  void SetOutput(std::ostream* output) noexcept { sink_.SetOutput(output); }
+
+  // Stops at the first step that cannot be taken, or once the editor quits;
+  // `error` receives what was wrong with the step, and where.
+  bool Run(std::istream& trace, std::string& error) {
+    const Clock::time_point kStart = Clock::now();
+    std::string line;
+    for (std::size_t number = 1;
+         state_.IsRunning() && std::getline(trace, line); ++number) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      std::string message;
+      if (!RunStep(line, message)) {
+        error = "line " + std::to_string(number) + ": " + message;
+        return false;
+      }
+    }
+    Wait();
+    command_handler_.Finish(state_);
+    elapsed_ = Clock::now() - kStart;
+    return true;
+  }
+
+  void Report(std::ostream& out) const {
+    const Percentiles kLatency = Summarize(latencies_us_);
+    const Percentiles kAllocations = Summarize(allocations_);
+    const auto kEvents = static_cast<double>(latencies_us_.size());
+    out << "events       " << latencies_us_.size() << '\n';
+    out << "latency us   p50 " << kLatency.p50 << "  p90 " << kLatency.p90
+        << "  p99 " << kLatency.p99 << "  max " << kLatency.max << "  mean "
+        << kLatency.mean << '\n';
+    out << "bytes        " << sink_.Bytes() << " total, "
+        << (kEvents > 0 ? static_cast<double>(key_bytes_) / kEvents : 0)
+        << " per event\n";
+    out << "allocations  " << total_allocations_ << " total, p50 "
+        << kAllocations.p50 << "  p99 " << kAllocations.p99 << "  max "
+        << kAllocations.max << " per event\n";
+    out << "renderer     " << renderer_.AllocationCount()
+        << " allocations composing frames\n";
+    out << "open ms      " << Milliseconds(open_) << '\n';
+    out << "wait ms      " << Milliseconds(waited_) << '\n';
+    out << "total ms     " << Milliseconds(elapsed_) << '\n';
+  }
+
+  void ReportJson(std::ostream& out) const {
+    const Percentiles kLatency = Summarize(latencies_us_);
+    const Percentiles kAllocations = Summarize(allocations_);
+    out << "{\n"
+        << "  \"events\": " << latencies_us_.size() << ",\n"
+        << "  \"latency_us\": {\"p50\": " << kLatency.p50
+        << ", \"p90\": " << kLatency.p90 << ", \"p99\": " << kLatency.p99
+        << ", \"max\": " << kLatency.max << ", \"mean\": " << kLatency.mean
+        << "},\n"
+        << "  \"bytes\": " << sink_.Bytes() << ",\n"
+        << "  \"event_bytes\": " << key_bytes_ << ",\n"
+        << "  \"allocations\": {\"total\": " << total_allocations_
+        << ", \"p50\": " << kAllocations.p50
+        << ", \"p99\": " << kAllocations.p99
+        << ", \"max\": " << kAllocations.max << "},\n"
+        << "  \"renderer_allocations\": " << renderer_.AllocationCount()
+        << ",\n"
+        << "  \"open_ms\": " << Milliseconds(open_) << ",\n"
+        << "  \"wait_ms\": " << Milliseconds(waited_) << ",\n"
+        << "  \"total_ms\": " << Milliseconds(elapsed_) << "\n"
+        << "}\n";
+  }
+
+ private:
+  bool RunStep(std::string_view line, std::string& error) {
+    if (line.empty() || line.front() == '#') {
+      return true;
+    }
+    const std::size_t kSpace = line.find(' ');
+    const std::string_view kVerb = line.substr(0, kSpace);
+    const std::string_view kArgument =
+        kSpace == std::string_view::npos ? std::string_view{}
+                                         : line.substr(kSpace + 1);
+
+    if (kVerb == "size") {
+      return SetSize(kArgument, error);
+    }
+    if (kVerb == "open") {
+      return Open(std::string(kArgument), error);
+    }
+    if (kVerb == "sample") {
+      const std::optional<std::uint64_t> kMiB = ParseCount(kArgument);
+      if (!kMiB.has_value() || *kMiB == 0) {
+        error = "sample needs a size in MiB";
+        return false;
+      }
+      return Open(bench::SampleFile(*kMiB * bench::kMiB), error);
+    }
+    if (kVerb == "keys") {
+      Type(kArgument);
+      return true;
+    }
+    if (kVerb == "repeat") {
+      const std::size_t kKeys = kArgument.find(' ');
+      const std::optional<std::uint64_t> kCount =
+          ParseCount(kArgument.substr(0, kKeys));
+      if (!kCount.has_value() || kKeys == std::string_view::npos) {
+        error = "repeat needs a count and keys";
+        return false;
+      }
+      for (std::uint64_t i = 0; i < *kCount && state_.IsRunning(); ++i) {
+        Type(kArgument.substr(kKeys + 1));
+      }
+      return true;
+    }
+    if (kVerb == "wait") {
+      Wait();
+      return true;
+    }
+    error = "unknown step \"" + std::string(kVerb) + "\"";
+    return false;
+  }
+
+  static std::optional<std::uint64_t> ParseCount(std::string_view text) {
+    if (text.empty() || text.find_first_not_of("0123456789") !=
+                            std::string_view::npos) {
+      return std::nullopt;
+    }
+    return std::strtoull(std::string(text).c_str(), nullptr, 10);
+  }
+
+  bool SetSize(std::string_view argument, std::string& error) {
+    const std::size_t kCross = argument.find('x');
+    const std::optional<std::uint64_t> kRows =
+        ParseCount(argument.substr(0, kCross));
+    const std::optional<std::uint64_t> kColumns =
+        kCross == std::string_view::npos
+            ? std::nullopt
+            : ParseCount(argument.substr(kCross + 1));
+    if (!kRows.has_value() || !kColumns.has_value() || *kRows == 0 ||
+        *kColumns == 0) {
+      error = "size needs ROWSxCOLUMNS";
+      return false;
+    }
+    sink_.SetSize({static_cast<std::size_t>(*kRows),
+                   static_cast<std::size_t>(*kColumns)});
+    return true;
+  }
+
+  // Until the first frame of the file is drawn.
+  bool Open(const std::string& path, std::string& error) {
+    const Clock::time_point kStart = Clock::now();
+    bool created = false;
+    state_.OpenBuffer(path, created);
+    if (created) {
+      error = "cannot open " + path;
+      return false;
+    }
+    Frame();
+    open_ += Clock::now() - kStart;
+    return true;
+  }
+
+  void Type(std::string_view notation) {
+    keys_.Append(notation);
+    core::KeyEvent event{};
+    while (state_.IsRunning() && keys_.Poll(event)) {
+      const std::uint64_t kAllocationsBefore = t_allocations;
+      const std::uint64_t kBytesBefore = sink_.Bytes();
+      const Clock::time_point kStart = Clock::now();
+      mode_controller_.HandleEvent(event);
+      if (state_.IsRunning()) {
+        Frame();
+      }
+      const Clock::duration kTaken = Clock::now() - kStart;
+      latencies_us_.push_back(
+          std::chrono::duration<double, std::micro>(kTaken).count());
+      allocations_.push_back(t_allocations - kAllocationsBefore);
+      total_allocations_ += allocations_.back();
+      key_bytes_ += sink_.Bytes() - kBytesBefore;
+    }
+  }
+
+  // What the editor does between waiting for keys.
+  void Frame() {
+    state_.GetBuffer().SyncIndex();
+    mode_controller_.SyncSearch();
+    mode_controller_.SyncChord();
+    command_handler_.Poll(state_);
+    plugin_host_.Poll(state_);
+    core::WorkerPool::Shared().RunCompletions();
+    renderer_.Render(state_, mode_controller_.CommandBuffer(),
+                     mode_controller_.CommandPrefix());
+    state_.GetBuffer().ClearDamage();
+  }
+
+  void Wait() {
+    const Clock::time_point kStart = Clock::now();
+    while (state_.IsRunning()) {
+      Frame();
+      const auto kDeadline = mode_controller_.ChordDeadline();
+      if (!state_.GetBuffer().IsIndexing() && !command_handler_.IsBusy() &&
+          !mode_controller_.IsSearching() && !kDeadline.has_value()) {
+        break;
+      }
+      std::chrono::milliseconds timeout = kPollInterval;
+      if (kDeadline.has_value()) {
+        timeout = (std::min)(
+            timeout, (std::max)(std::chrono::ceil<std::chrono::milliseconds>(
+                                    *kDeadline - Clock::now()),
+                                std::chrono::milliseconds{0}));
+      }
+      wakeup_.Wait(timeout);
+    }
+    waited_ += Clock::now() - kStart;
+  }
+
+  core::EditorState state_;
+  core::InputHandler command_handler_;
+  core::PluginHost plugin_host_;
+  core::ModeController mode_controller_;
+  core::Renderer renderer_;
+  MemorySink sink_;
+  core::ScriptedKeySource keys_;
+  core::Waker wakeup_;
+
+  std::vector<double> latencies_us_;
+  std::vector<std::uint64_t> allocations_;
+  std::uint64_t total_allocations_ = 0;
+  std::uint64_t key_bytes_ = 0;
+  Clock::duration open_{};
+  Clock::duration waited_{};
+  Clock::duration elapsed_{};
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::span<char*> kArguments(argv, static_cast<std::size_t>(argc));
+  std::string json_path;
+  std::string output_path;
+  std::string profile_path;
+  std::string trace_path;
+  for (std::size_t i = 1; i < kArguments.size(); ++i) {
+    const std::string_view kArgument(kArguments[i]);
+    if (kArgument == "--json" && i + 1 < kArguments.size()) {
+      json_path = kArguments[++i];
+    } else if (kArgument == "--output" && i + 1 < kArguments.size()) {
+      output_path = kArguments[++i];
+    } else if (kArgument == "--profile" && i + 1 < kArguments.size()) {
+      profile_path = kArguments[++i];
+    } else if (trace_path.empty() && !kArgument.starts_with("--")) {
+      trace_path = kArgument;
+    } else {
+      trace_path.clear();
+      break;
+    }
+  }
+  if (trace_path.empty()) {
+    std::cerr << "usage: microvi_replay [--json FILE] [--output FILE] "
+                 "[--profile FILE] TRACE\n";
+    return 2;
+  }
+  if (!profile_path.empty() && !core::Profiler::kCompiledIn) {
+    std::cerr << "microvi_replay: --profile needs a build with "
+                 "-DMICROVI_PROFILING=ON\n";
+    return 2;
+  }
+
+  std::ifstream trace(trace_path);
+  if (!trace.is_open()) {
+    std::cerr << "microvi_replay: cannot read " << trace_path << '\n';
+    return 1;
+  }
+  std::ofstream output;
+  if (!output_path.empty()) {
+    output.open(output_path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+      std::cerr << "microvi_replay: cannot write " << output_path << '\n';
+      return 1;
+    }
+  }
+
+  Replay replay;
+  replay.SetOutput(output.is_open() ? &output : nullptr);
+  std::string error;
+  if (!profile_path.empty()) {
+    core::Profiler::Shared().StartTrace();
+  }
+  if (!replay.Run(trace, error)) {
+    std::cerr << trace_path << ": " << error << '\n';
+    return 1;
+  }
+  if (!profile_path.empty() &&
+      !core::Profiler::Shared().WriteTrace(profile_path)) {
+    std::cerr << "microvi_replay: cannot write " << profile_path << '\n';
+    return 1;
+  }
+  replay.Report(std::cout);
+  if (!json_path.empty()) {
+    std::ofstream json(json_path, std::ios::trunc);
+    if (!json.is_open()) {
+      std::cerr << "microvi_replay: cannot write " << json_path << '\n';
+      return 1;
+    }
+    replay.ReportJson(json);
+  }
+  return 0;
+}
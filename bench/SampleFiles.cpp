@@ -0,0 +1,95 @@
+#include "SampleFiles.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace {
+class Random {
+ public:
+  std::uint32_t Next() {
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+  }
+
+ private:
+  std::uint32_t seed_ = 0x2545F491u;
+};
+
+// Writes lines from `next_line` until the file is `size` bytes, unless it
+// already is.
+template <typename NextLine>
+std::string WriteSample(const std::string& name, std::uint64_t size,
+                        NextLine next_line) {
+  const std::filesystem::path kPath =
+      std::filesystem::temp_directory_path() /
+      ("microvi_bench_" + name + std::to_string(size) + ".txt");
+  std::error_code error;
+  if (std::filesystem::file_size(kPath, error) == size) {
+    return kPath.string();
+  }
+
+  std::ofstream output(kPath, std::ios::binary | std::ios::trunc);
+  std::string line;
+  std::uint64_t written = 0;
+  while (written < size) {
+    line.clear();
+    next_line(line);
+    line.push_back('\n');
+    const std::uint64_t kLength =
+        std::min<std::uint64_t>(line.size(), size - written);
+    output.write(line.data(), static_cast<std::streamsize>(kLength));
+    written += kLength;
+  }
+  return kPath.string();
+}
+}  // namespace
+
+namespace bench {
+std::uint64_t MaxBytes(std::uint64_t fallback) {
+  const char* value = std::getenv("MICROVI_BENCH_MAX_BYTES");
+  if (value == nullptr || *value == '\0') {
+    return fallback;
+  }
+  return std::strtoull(value, nullptr, 10);
+}
+
+std::string SizeLabel(std::uint64_t size) {
+  return std::to_string(size / kMiB) + "MiB";
+}
+
+std::string SampleFile(std::uint64_t size) {
+  Random random;
+  return WriteSample("", size, [&random](std::string& line) {
+    const std::uint32_t kValue = random.Next();
+    line.assign(kValue % 120, 'a' + static_cast<char>(kValue % 26));
+  });
+}
+
+std::string SampleSource(std::uint64_t size) {
+  static constexpr const char* kWords[] = {
+      "value",  "index", "buffer_", "Render", "line", "kCount", "state",
+      "column", "next",  "result",  "42",     "std",  "size_t", "text",
+  };
+  static constexpr const char* kPunctuation[] = {
+      " = ", ", ", "(", ") ", "->", "::", " + ", "; ", " && ", "[", "] ",
+  };
+  Random random;
+  return WriteSample("source_", size, [&random](std::string& line) {
+    // About one line in eight is blank, ending a paragraph.
+    const std::uint32_t kShape = random.Next();
+    if (kShape % 8 == 0) {
+      return;
+    }
+    line.assign(2 * (kShape % 4), ' ');
+    for (std::uint32_t words = 2 + kShape % 9; words > 0; --words) {
+      line += kWords[random.Next() % std::size(kWords)];
+      line += kPunctuation[random.Next() % std::size(kPunctuation)];
+    }
+  });
+}
+}  // namespace bench
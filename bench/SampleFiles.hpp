@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace bench {
+inline constexpr std::uint64_t kMiB = 1024 * 1024;
+
+// Larger sizes are skipped when MICROVI_BENCH_MAX_BYTES is below them.
+std::uint64_t MaxBytes(std::uint64_t fallback);
+std::string SizeLabel(std::uint64_t size);
+
+// Writes (once) a file of ASCII lines between 0 and 119 columns, the shape
+// of typical source and log text, into the temporary directory.
+std::string SampleFile(std::uint64_t size);
+// The same, with lines of identifiers, operators and punctuation in
+// paragraphs, for the motions to stop in.
+std::string SampleSource(std::uint64_t size);
+}  // namespace bench
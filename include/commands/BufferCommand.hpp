@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include "../core/Command.hpp"
+
+namespace commands {
+// :e[dit] [path], which opens a file in a buffer of its own or, without a
+// path, loads the current one again; :b[uffer] N; and :bn[ext] and
+// :bp[revious] (or :bN[ext]), which move along the buffer list.
+class BufferCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
\ No newline at end of file
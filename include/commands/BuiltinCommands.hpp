@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../core/InputHandler.hpp"
+#include "../core/PluginHost.hpp"
+
+namespace commands {
+// Registers the ex commands microvi ships with; :plugin loads plugins into
+// `plugin_host`.
+void RegisterBuiltinCommands(core::InputHandler& handler,
+                             core::PluginHost& plugin_host);
+} // namespace commands
@@ -6,7 +6,8 @@
 namespace commands {
 class DeleteCommand : public core::Command {
 public:
-  bool Matches(const std::string& input) const override;
-  void Execute(core::EditorState& state, const std::string& input) override;
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
 };
 } // namespace commands
\ No newline at end of file
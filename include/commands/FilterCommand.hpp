@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../core/Command.hpp"
+
+namespace commands {
+// :{range}!command sends the lines of the range through a shell command and
+// puts what it writes in their place, as one undoable edit. The lines are
+// streamed to it from a snapshot and its output goes into the buffer as it
+// arrives, so the range is never copied and the output is held only once.
+// The editor waits for the command, as vi does.
+class FilterCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include "../core/Command.hpp"
+#include "../io/FileWatcher.hpp"
+
+namespace commands {
+// :fo[llow] follows the current buffer's file as tail -f does (see
+// core::Buffer::StartFollowing()): what is written to it is appended as the
+// watcher reports it, and a cursor on the last line stays there. One file
+// is followed at a time; :e! stops following it.
+class FollowCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+
+  void SetWakeHook(std::function<void()> hook) override;
+  bool Poll(core::EditorState& state) override;
+
+private:
+  bool Follow(core::EditorState& state, bool replaced);
+
+  core::FileWatcher watcher_;
+  std::function<void()> wake_hook_;
+  std::uint64_t buffer_id_ = 0;
+};
+} // namespace commands
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../core/Command.hpp"
+
+namespace commands {
+// :[range]g[lobal][!]/pattern/d deletes the lines of the range, the whole
+// buffer when none is given, that match the pattern; :v[global]/pattern/d,
+// or :g!, those that do not. Lines are matched across threads by
+// core::MatchLines() and deleted together as one undoable edit. Delete is
+// the only command it runs.
+class GlobalCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
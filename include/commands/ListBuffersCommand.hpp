@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include "../core/Command.hpp"
+
+namespace commands {
+// :ls, :buffers and :files. Each buffer shows as its number, '%' for the
+// current one or 'h' for one kept loaded, '+' when modified, and its name.
+class ListBuffersCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
\ No newline at end of file
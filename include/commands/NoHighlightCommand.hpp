@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include "../core/Command.hpp"
+
+namespace commands {
+class NoHighlightCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include "../core/Command.hpp"
+#include "../core/PluginHost.hpp"
+
+namespace commands {
+// :plugin <path> starts a plugin process; its commands and keys are
+// available once it has introduced itself.
+class PluginCommand : public core::Command {
+public:
+  explicit PluginCommand(core::PluginHost& host);
+
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+
+private:
+  core::PluginHost& host_;
+};
+} // namespace commands
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../core/Command.hpp"
+
+namespace commands {
+// :prof[ile] toggles an overlay of core::Profiler's totals on the message
+// line, which updates with every frame. ":profile reset" zeroes the totals,
+// ":profile trace" starts keeping trace events and ":profile dump FILE"
+// writes them as Chrome trace JSON. Refused unless the timers were built in.
+class ProfileCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
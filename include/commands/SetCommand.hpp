@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include "../core/Command.hpp"
+
+namespace commands {
+// :se[t] with the options that change how text is drawn: [no|inv]wrap,
+// wrap!, tabstop=N (or ts=N), and scrollback=N (or scbk=N), the lines a
+// followed file keeps. "option?" shows the value.
+class SetCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../core/Command.hpp"
+
+namespace commands {
+// :[range]sor[t][!] [n][u][r] sorts the lines of the range, the whole buffer
+// when none is given, by core::SortLines(): n sorts by the first number in
+// each line, u keeps one of identical lines, and r or ! reverses the order.
+// The sorted lines replace the range as one undoable edit.
+class SortCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+};
+} // namespace commands
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "../core/Command.hpp"
+#include "../core/Substitution.hpp"
+
+namespace commands {
+// :[range]s/pattern/replacement/[g]. The pattern and replacement may contain
+// '|'; one after the flags starts the next command. Large ranges are
+// substituted in the background and applied as one undoable edit; Escape
+// abandons them, and the next command waits for them.
+class SubstituteCommand : public core::Command {
+public:
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+
+  void SetWakeHook(std::function<void()> hook) override;
+  bool Poll(core::EditorState& state) override;
+  bool IsBusy() const override;
+  bool Cancel(core::EditorState& state) override;
+  void Finish(core::EditorState& state) override;
+
+private:
+  void Apply(core::EditorState& state, const core::SubstitutionResult& result);
+
+  core::Substitution substitution_;
+  std::string source_;
+  std::uint64_t revision_ = 0;
+  std::size_t shown_percent_ = 0;
+};
+} // namespace commands
\ No newline at end of file
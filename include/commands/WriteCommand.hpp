@@ -2,11 +2,22 @@
 
 #include <string>
 #include "../core/Command.hpp"
+#include "../core/WorkerPool.hpp"
 
 namespace commands {
+// :w [path], and :wq and :x, which quit once the file is written. The file
+// is written on the shared worker pool from a snapshot, so editing continues
+// while a slow disk catches up; the next command waits for it.
 class WriteCommand : public core::Command {
 public:
-  bool Matches(const std::string& input) const override;
-  void Execute(core::EditorState& state, const std::string& input) override;
+  core::ExCommandSpec Spec() const override;
+  bool Execute(core::EditorState& state,
+               const core::ExCommand& command) override;
+
+  bool IsBusy() const override;
+  void Finish(core::EditorState& state) override;
+
+private:
+  core::TaskHandle save_;
 };
 } // namespace commands
\ No newline at end of file
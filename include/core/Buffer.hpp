@@ -1,25 +1,223 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "core/IndexCache.hpp"
+#include "core/LineIndexer.hpp"
+#include "core/LineScanner.hpp"
+#include "core/PieceTable.hpp"
+#include "core/TextPosition.hpp"
+#include "core/UndoJournal.hpp"
+
 namespace core {
+class PagedText;
+class SwapFile;
+struct SwapContents;
+
+enum class LoadStrategy : std::uint8_t {
+  kAuto,
+  kRead,
+  kMap,
+  // Read-only, through a PagedText, for files bigger than memory.
+  kPage,
+};
+
+// Half-open range of lines; `last` is kDamageToEnd when every line from
+// `first` on may have moved.
+struct LineRange {
+  std::size_t first = 0;
+  std::size_t last = 0;
+
+  bool Empty() const noexcept { return first >= last; }
+  bool Contains(std::size_t line) const noexcept {
+    return line >= first && line < last;
+  }
+};
+
+inline constexpr std::size_t kDamageToEnd = SIZE_MAX;
+
+// How lines moved since the last ClearDamage(). Lines before `first` are
+// unchanged and the line at `last` or after is the one that was `shift` lines
+// away from it; in between, anything may have changed. `last` is
+// kDamageToEnd when no line can be matched up, as after a reload.
+struct LineChanges {
+  std::size_t first = 0;
+  std::size_t last = 0;
+  std::ptrdiff_t shift = 0;
+
+  bool Empty() const noexcept { return first >= last && shift == 0; }
+};
+
+enum class SwapStatus : std::uint8_t {
+  // The buffer has no file, or its swap file was never started.
+  kNone,
+  kStarted,
+  // Another swap file for the file was there already; it is left alone and
+  // this buffer's edits are not journaled.
+  kExists,
+  kRecovered,
+  // Recovery was asked for, but there was no swap file.
+  kMissing,
+  // The swap file's edits are to a different version of the file.
+  kStale,
+  kFailed,
+};
+
+// New text for one line, as applied by Buffer::ReplaceLineBatch().
+struct LineChange {
+  std::size_t line = 0;
+  std::string_view text;
+};
+
+// Collects the new texts of many lines in one string, so that an edit
+// across a block of many lines allocates once rather than once a line.
+class LineBatch {
+ public:
+  void Reserve(std::size_t lines, std::size_t bytes);
+  // Starts the new text of `line`, which must come after the last one.
+  void Begin(std::size_t line);
+  void Append(std::string_view text);
+  void AppendRepeated(char value, std::size_t count);
+  bool Empty() const noexcept;
+  // Valid until the batch next changes.
+  std::span<const LineChange> Changes();
+
+ private:
+  std::string text_;
+  // Where each line's text starts in text_.
+  std::vector<std::size_t> starts_;
+  std::vector<LineChange> changes_;
+};
+
+// Everything a save writes, taken from the buffer at one revision so it can
+// be written on another thread while editing goes on.
+struct SaveJob {
+  std::string path;
+  TextSnapshot snapshot;
+  LineEnding line_ending = LineEnding::kLf;
+  bool final_newline = true;
+  // A lone empty line is written as an empty file rather than as "\n". Set
+  // for buffers that loaded no bytes, so a file holding one blank line keeps
+  // it.
+  bool empty_when_blank = false;
+  std::uint64_t revision = 0;
+
+  // Replaces the file atomically; touches nothing but the snapshot.
+  bool Write(std::uint64_t* bytes_written = nullptr) const;
+};
+
 class Buffer {
  public:
   Buffer();
+  // Deletes the buffer's swap file, unless PreserveSwap() was called.
+  ~Buffer();
+
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+  Buffer(Buffer&&) = delete;
+  Buffer& operator=(Buffer&&) = delete;
+
+  static constexpr std::size_t kFollowChunkBytes = 4 * 1024 * 1024;
+  static constexpr std::uint64_t kPageThresholdBytes =
+      std::uint64_t{16} * 1024 * 1024 * 1024;
+
+  // kAuto maps large files, reads small ones and pages those of at least
+  // kPageThresholdBytes. A mapped file shows its first lines immediately;
+  // the rest is indexed in the background and picked up by SyncIndex(). The
+  // index of a mapped file is kept in IndexCache once complete, so opening
+  // it again unchanged scans nothing. A paged file is read-only, holds no
+  // more than a sparse index and a few mapped windows of the file, and is
+  // scanned for its lines the same way.
+  bool LoadFromFile(const std::string& file_path,
+                    LoadStrategy strategy = LoadStrategy::kAuto);
+  // Replaces the file atomically. Files are written with the line endings and
+  // final newline they were loaded with; new files end with a newline.
+  bool SaveToFile(const std::string& file_path,
+                  std::uint64_t* bytes_written = nullptr);
+  // SaveToFile() in three steps, for writing in the background: the job is
+  // written with SaveJob::Write() and then handed back to FinishSave(),
+  // which marks the buffer clean only if it was not edited meanwhile.
+  bool PrepareSave(const std::string& file_path, SaveJob& job);
+  void FinishSave(const SaveJob& job);
+
+  // Appends lines found by the background indexer. Returns true when the
+  // line count changed or indexing completed.
+  bool SyncIndex();
+  // Waits until at least `lines` lines are known, or all of them.
+  void FinishIndexing(std::size_t lines = SIZE_MAX);
+  bool IsIndexing() const noexcept;
+  // The file the buffer pages through, or null when it is loaded.
+  std::shared_ptr<const PagedText> Paged() const noexcept;
+
+  // The cache entry for the loaded file, or null when it has none; a save
+  // to the file drops it.
+  const IndexKey* CacheKey() const noexcept;
+  // Where the file's view was left when it was last closed, if the cache
+  // remembers; handed out once.
+  std::optional<ViewMemory> TakeRememberedView();
 
-  bool LoadFromFile(const std::string& file_path);
-  bool SaveToFile(const std::string& file_path);
+  // Line endings are detected on load and reproduced on save. The text
+  // statistics are complete once indexing has finished.
+  LineEnding GetLineEnding() const noexcept;
+  const TextStats& GetTextStats() const noexcept;
 
   bool InsertChar(std::size_t line, std::size_t column, char value);
   bool DeleteChar(std::size_t line, std::size_t column);
-  bool InsertLine(std::size_t line_index, const std::string& line);
+  bool InsertLine(std::size_t line_index, std::string_view line);
+  bool InsertLines(std::size_t line_index,
+                   std::span<const std::string> lines);
+  bool InsertLines(std::size_t line_index, const LineSlice& lines);
+  // Copies the lines into one piece.
+  bool InsertLines(std::size_t line_index,
+                   std::span<const std::string_view> lines);
+  // Inserts `text`, which may span several '\n'-separated lines, at
+  // (line, column). `end` receives the position just past the inserted text.
+  bool InsertText(std::size_t line, std::size_t column, std::string_view text,
+                  TextPosition* end = nullptr);
+  // Removes `length` bytes from `start`, counting each line break as one.
+  bool DeleteText(TextPosition start, std::size_t length);
+  // Replaces the characters in [start, end) with `text`; `text_end` receives
+  // the position just past the inserted text.
+  bool Splice(TextPosition start, TextPosition end, std::string_view text,
+              TextPosition* text_end = nullptr);
   bool DeleteLine(std::size_t line_index);
+  // Deletes up to `count` lines; returns how many were deleted. `removed`
+  // receives them without copying their text.
+  std::size_t DeleteLines(std::size_t line_index, std::size_t count,
+                          LineSlice* removed = nullptr);
+  bool ReplaceLine(std::size_t line_index, std::string_view line);
+  // Replaces many lines, given in increasing order, as a single edit: runs of
+  // adjacent changes become one piece each, and undo restores the old lines
+  // as one slice.
+  bool ReplaceLineBatch(std::span<const LineChange> changes);
+  // Replaces `count` lines from `line_index` with `lines`, copied into one
+  // piece, as a single edit. The views may point into the buffer's own text.
+  bool ReplaceLineRange(std::size_t line_index, std::size_t count,
+                        std::span<const std::string_view> lines);
+  // Deletes the runs of lines, given in increasing order and apart, as a
+  // single edit that shares the lines kept between them with undo instead
+  // of copying them. Returns how many lines were deleted.
+  std::size_t DeleteLineRuns(std::span<const LineRange> runs);
 
   std::size_t LineCount() const noexcept;
-  const std::string& GetLine(std::size_t line_index) const;
-  std::string& GetLine(std::size_t line_index);
+  // The returned view stays valid until the buffer is next modified, or for
+  // a paged file until lines far from it are read.
+  std::string_view GetLine(std::size_t line_index) const;
+  // Shares up to `count` lines from `line_index` on without copying them.
+  LineSlice CopyLines(std::size_t line_index, std::size_t count);
+  // Appends the characters in [start, end) to `text`, with '\n' between
+  // lines.
+  bool CopyText(TextPosition start, TextPosition end, std::string& text) const;
+  // A copy of the document that another thread can read while this buffer
+  // keeps changing; see PieceTable::Snapshot().
+  TextSnapshot Snapshot(std::size_t split_line = 0);
 
   const std::string& FilePath() const noexcept;
   void SetFilePath(const std::string& file_path);
@@ -27,9 +225,135 @@ class Buffer {
   bool IsDirty() const noexcept;
   void MarkDirty(bool dirty) noexcept;
 
+  // Refuses every edit, undo and redo while set; loading a file clears it,
+  // unless the file is paged. A paged or streaming buffer stays read-only.
+  void SetReadOnly(bool read_only) noexcept;
+  bool IsReadOnly() const noexcept;
+
+  // Follows the file as tail -f does: the buffer turns read-only, keeps only
+  // its last `scrollback` lines, and SyncFollow() appends whatever is written
+  // to the file from then on. Loading a file stops it.
+  bool StartFollowing(std::size_t scrollback);
+  bool IsFollowing() const noexcept;
+  // Appends up to kFollowChunkBytes of what the file gained, then drops
+  // lines from the top beyond `scrollback`; a file that shrank, or was
+  // `replaced`, is loaded again. Returns true when the lines changed; `more`
+  // is set while the file has more to append.
+  bool SyncFollow(std::size_t scrollback, bool replaced, bool* more = nullptr);
+  // Reads a document as it arrives, from a pipe: the buffer starts out empty,
+  // with no file, and stays read-only while AppendStream() adds to it, until
+  // EndStream(). Loading a file ends it as well.
+  void StartStream();
+  void AppendStream(std::string_view bytes);
+  void EndStream();
+  bool IsStreaming() const noexcept;
+
+  // Lines dropped from the top since the file was loaded, which line numbers
+  // go on counting.
+  std::size_t DroppedLines() const noexcept;
+
+  // Lines changed since the last ClearDamage(), so a view can redraw only
+  // those. Lines dropped from the top leave the rest undamaged, as a view
+  // that numbers lines from DroppedLines() on sees them unchanged.
+  const LineRange& Damage() const noexcept;
+  void ClearDamage() noexcept;
+  // The same edits, for a consumer that keeps per-line data.
+  const LineChanges& Changes() const noexcept;
+  // Grows with every change to the text, so work started on a snapshot can
+  // tell whether the buffer has moved on since. No two buffers share a
+  // revision, so neither can such work be applied to another buffer.
+  std::uint64_t Revision() const noexcept;
+
+  // Every edit is journaled. Edits made until the next CloseUndoStep() undo
+  // together; `cursor` receives where the change started.
+  void CloseUndoStep() noexcept;
+  bool Undo(TextPosition* cursor = nullptr);
+  bool Redo(TextPosition* cursor = nullptr);
+  const UndoJournal& History() const noexcept;
+
+  // Journals edits from here on to the file's swap file, so that they can be
+  // recovered after a crash; see SwapFile. With `recover`, the edits in an
+  // existing swap file are first replayed as one undo step and `recovered`
+  // receives how many there were.
+  SwapStatus StartSwap(bool recover, std::size_t* recovered = nullptr);
+  SwapStatus GetSwapStatus() const noexcept;
+  // Writes out every edit and leaves the swap file behind, for when the
+  // editor goes without the user quitting it.
+  void PreserveSwap();
+
+  // Memory the buffer holds: its text unless it is mapped, the line index,
+  // edits and undo history.
+  std::size_t MemoryUsage() const noexcept;
+
  private:
-  std::vector<std::string> lines_;
+  // Records that `removed` lines at `first` were replaced by `inserted`.
+  void MarkChanged(std::size_t first, std::size_t removed,
+                   std::size_t inserted) noexcept;
+  void MarkReloaded() noexcept;
+  // MarkChanged() for `count` lines dropped from the top.
+  void MarkDropped(std::size_t count) noexcept;
+  void MergeChanges(std::size_t first, std::size_t removed,
+                    std::size_t inserted) noexcept;
+  // Writes the finished line index to the cache on a pool thread.
+  void StoreIndex();
+  // Unjournaled primitives shared by the edit methods and undo/redo.
+  bool InsertLineViews(std::size_t line_index,
+                       std::span<const std::string_view> lines);
+  void ReplaceLines(std::size_t line_index, std::size_t count,
+                    const LineSlice& lines);
+  TextPosition Insert(TextPosition at, std::string_view text);
+  void Erase(TextPosition start, TextPosition end);
+  bool IsValid(TextPosition position) const;
+  bool Advance(TextPosition start, std::size_t length,
+               TextPosition& end) const;
+  void AppendText(TextPosition start, TextPosition end,
+                  std::string& text) const;
+  // Pass each edit on to the swap file, once it is applied.
+  void SwapText(TextPosition position, std::size_t removed,
+                std::string_view inserted);
+  void SwapLines(std::size_t line_index, std::size_t removed,
+                 const LineSlice& inserted);
+  std::size_t Replay(const SwapContents& contents);
+  // Followed or streamed text as it arrives, without journaling or swapping
+  // it.
+  void AppendFollowed(std::string_view bytes);
+  void DropFollowed(std::size_t scrollback);
+  // Copies the lines kept into a new original text, so that the ones
+  // dropped and the file mapping are let go.
+  void CompactFollowed();
+
+  // Replaces the text with a paged view of the file.
+  bool LoadPaged(const std::string& file_path);
+
+  PieceTable table_;
+  std::shared_ptr<PagedText> paged_;
+  UndoJournal journal_;
+  LineIndexer indexer_;
+  std::vector<std::uint64_t> index_batch_;
+  std::optional<IndexKey> cache_key_;
+  // Set when the index came from the cache, which also had the statistics.
+  bool index_cached_ = false;
+  TextStats cached_stats_;
+  std::optional<ViewMemory> remembered_view_;
   std::string file_path_;
+  std::string mapped_path_;
+  LineEnding line_ending_ = LineEnding::kLf;
+  bool final_newline_ = true;
+  LineRange damage_{0, kDamageToEnd};
+  LineChanges changes_{0, kDamageToEnd, 0};
+  std::uint64_t revision_ = 0;
   bool dirty_ = false;
+  bool read_only_ = false;
+  // Bytes of the file the buffer was loaded from.
+  std::uint64_t loaded_bytes_ = 0;
+  bool following_ = false;
+  std::uint64_t follow_offset_ = 0;
+  bool streaming_ = false;
+  std::size_t dropped_lines_ = 0;
+  // Text kept and dropped since the last compaction, roughly.
+  std::size_t kept_bytes_ = 0;
+  std::size_t dropped_bytes_ = 0;
+  std::unique_ptr<SwapFile> swap_;
+  SwapStatus swap_status_ = SwapStatus::kNone;
 };
-}  // namespace core
\ No newline at end of file
+}  // namespace core
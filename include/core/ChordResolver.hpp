@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "core/KeyEvent.hpp"
+#include "core/Keymap.hpp"
+#include "core/Mode.hpp"
+
+namespace core {
+struct ChordMatch {
+  const Keymap::Binding* binding = nullptr;
+  // Zero when no count was typed.
+  std::size_t count = 0;
+  // The key typed for <Char>, if the gesture has one.
+  char operand = '\0';
+};
+
+enum class ChordOutcome : std::uint8_t {
+  // More keys are needed; Typed() shows what has been typed so far.
+  kPending,
+  kMatched,
+  // The chord typed before this key is itself bound and this key does not
+  // extend it: it matched, and the key starts a new chord once it has run.
+  kMatchedBefore,
+  kNoMatch,
+};
+
+// Walks a Keymap trie one key at a time, like vi resolving "3d2w". A count
+// may precede the chord and another may follow any key whose node takes no
+// <Char>; the two multiply. A chord that is bound but also the prefix of a
+// longer one, like "g" next to "gg", waits for the next key up to the
+// timeout, then runs by itself, as in vim with 'timeoutlen'.
+class ChordResolver {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::chrono::milliseconds kDefaultTimeout{1000};
+  // Waits for the next key however long it takes.
+  static constexpr std::chrono::milliseconds kNoTimeout{-1};
+
+  ChordOutcome Feed(const Keymap& keymap, Mode mode, const KeyEvent& event,
+                    Clock::time_point now, ChordMatch& match);
+  // When a pending chord that is bound by itself will run, or nullopt.
+  std::optional<Clock::time_point> Deadline() const noexcept;
+  // Matches the pending chord once its deadline has passed.
+  bool Expire(const Keymap& keymap, Clock::time_point now, ChordMatch& match);
+
+  void Reset() noexcept;
+  bool Pending() const noexcept;
+  std::string_view Typed() const noexcept;
+  // Starts the next chord with `count` already typed, as after `"a`.
+  void CarryCount(std::size_t count);
+
+  void SetTimeout(std::chrono::milliseconds timeout) noexcept;
+
+ private:
+  bool AcceptDigit(const Keymap& keymap, const KeyEvent& event);
+  void Finish(const Keymap& keymap, Keymap::NodeId node, ChordMatch& match);
+  void AppendTyped(const KeyEvent& event);
+
+  std::chrono::milliseconds timeout_ = kDefaultTimeout;
+  Keymap::NodeId node_ = 0;
+  std::size_t counts_[2] = {0, 0};
+  char operand_ = '\0';
+  std::optional<Clock::time_point> deadline_;
+  std::string typed_;
+};
+}  // namespace core
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <string>
+#include <functional>
+
+#include "ExCommand.hpp"
 
 namespace core {
 class EditorState;
@@ -14,7 +16,22 @@ public:
   Command& operator=(Command&&) = delete;
   virtual ~Command() = default;
 
-  virtual bool Matches(const std::string& input) const = 0;
-  virtual void Execute(EditorState& state, const std::string& input) = 0;
+  // The names it answers to on the command line and what it accepts; read
+  // once, when it is registered.
+  virtual ExCommandSpec Spec() const = 0;
+  // Returns false when it fails, which stops the rest of a '|' batch.
+  virtual bool Execute(EditorState& state, const ExCommand& command) = 0;
+
+  // For commands whose work continues in the background after Execute():
+  // the hook may run on any thread to have the main loop call Poll(), which
+  // returns true when it changed the state.
+  virtual void SetWakeHook(std::function<void()> /*hook*/) {}
+  virtual bool Poll(EditorState& /*state*/) { return false; }
+  virtual bool IsBusy() const { return false; }
+  // Abandons background work; returns false when there was none.
+  virtual bool Cancel(EditorState& /*state*/) { return false; }
+  // Blocks until background work that later commands must see, such as a
+  // save, is done and applied.
+  virtual void Finish(EditorState& /*state*/) {}
 };
 } // namespace core
\ No newline at end of file
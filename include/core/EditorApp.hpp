@@ -1,13 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <string>
 #include <thread>
 
 #include "core/EditorState.hpp"
 #include "core/EventQueue.hpp"
 #include "core/InputHandler.hpp"
 #include "core/ModeController.hpp"
+#include "core/PluginHost.hpp"
 #include "core/Renderer.hpp"
+#include "io/AppendFile.hpp"
 #include "io/ConsoleKeySource.hpp"
+#include "io/PipeReader.hpp"
+#include "io/Waker.hpp"
 
 namespace core {
 class EditorApp {
@@ -18,20 +24,39 @@ class EditorApp {
 
  private:
   void LoadFile(int argc, char** argv);
+  // Starts the trace -w writes, with the terminal's size and the file opened.
+  void StartRecording(const std::string& trace_path,
+                      const std::string& file_path);
+  // Streams the document from standard input into the current buffer.
+  void ReadStdin();
+  void SyncStdin();
   void Render();
   void HandleEvent(const KeyEvent& event);
   static void ConfigureConsole();
   void StartInputLoop();
   void StopInputLoop();
   void InputLoop(const std::stop_token& token);
-  void ProcessPendingEvents();
+  bool ProcessPendingEvents(EventQueue::Clock::time_point& first_arrival);
+  static void WatchTerminalResize(Waker* waker);
+  // A hangup or SIGTERM ends the editor as closed input does.
+  static void WatchHangup(Waker* waker);
 
   EditorState state_;
   ConsoleKeySource key_source_;
   InputHandler command_handler_;
   EventQueue event_queue_;
+  PluginHost plugin_host_;
   ModeController mode_controller_;
   Renderer renderer_;
+  // Keys handled since the last ProcessPendingEvents(), for the trace.
+  AppendFile record_;
+  std::string recorded_keys_;
+  PipeReader stdin_reader_;
+  // The buffer standard input is streamed into, until it closes.
+  Buffer* stdin_buffer_ = nullptr;
+  Waker wakeup_;
+  Waker input_interrupt_;
+  std::atomic<bool> input_closed_{false};
   std::jthread input_thread_;
 };
 }  // namespace core
\ No newline at end of file
@@ -1,11 +1,21 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "Buffer.hpp"
+#include "Highlighter.hpp"
+#include "LineLayout.hpp"
 #include "Mode.hpp"
+#include "Pattern.hpp"
+#include "Registers.hpp"
+#include "Selection.hpp"
 
 namespace core {
 enum class StatusSeverity : std::uint8_t {
@@ -15,39 +25,202 @@ enum class StatusSeverity : std::uint8_t {
   kError,
 };
 
+// Time from a key arriving to the frame reflecting it reaching the terminal.
+struct LatencyStats {
+  std::chrono::microseconds last{0};
+  std::chrono::microseconds max{0};
+  std::chrono::microseconds total{0};
+  std::uint64_t samples = 0;
+};
+
+// Where the view of a buffer starts, kept by the renderer.
+struct Viewport {
+  // The buffer line at the top.
+  std::size_t line = 0;
+  // Without wrapping, the display column at the left edge.
+  std::size_t column = 0;
+  // With wrapping, rows of `line` scrolled off the top.
+  std::size_t row = 0;
+};
+
+// Settings of :set that change how text is drawn.
+struct ViewOptions {
+  bool wrap = false;
+  std::size_t tabstop = 8;
+  // Lines a followed file keeps; see Buffer::StartFollowing().
+  std::size_t scrollback = 10000;
+};
+
+// One entry of the buffer list, as :ls shows it.
+struct BufferListing {
+  std::size_t number = 0;
+  std::string path;
+  // Zero for a buffer that is not loaded.
+  std::size_t lines = 0;
+  bool current = false;
+  bool dirty = false;
+  bool loaded = false;
+};
+
+// Owns the buffer list. Only the current buffer is edited; the others keep
+// their text, file mapping and line index, and the cursor and viewport to
+// return to, so switching costs nothing. When the inactive buffers hold
+// more than the budget, the least recently used clean ones are unloaded and
+// loaded again from their file when switched to.
 class EditorState {
  public:
+  static constexpr std::size_t kDefaultBufferBudget = 256 * 1024 * 1024;
+
   EditorState();
 
+  // The current buffer.
   Buffer& GetBuffer() noexcept;
   const Buffer& GetBuffer() const noexcept;
+  Highlighter& GetHighlighter() noexcept;
+  // Changes whenever another buffer, or the same one loaded again, becomes
+  // current, so work on the previous one can be told apart.
+  std::uint64_t BufferId() const noexcept;
+
+  // Makes the buffer for `path` current, adding it to the list unless it is
+  // there already. A file that does not exist yet gives an empty buffer
+  // named after it; `created` tells which happened. Either way its edits
+  // are journaled to a swap file unless one is there already. `strategy`
+  // is how a buffer not open yet is loaded, then and whenever it is again.
+  bool OpenBuffer(const std::string& path, bool& created,
+                  LoadStrategy strategy = LoadStrategy::kAuto);
+  // Moves `delta` places along the list, wrapping around.
+  void CycleBuffer(std::ptrdiff_t delta);
+  // By the number :ls shows.
+  bool SwitchBuffer(std::size_t number);
+  // Loads the current buffer again from its file, dropping its changes.
+  bool ReloadBuffer();
+  std::size_t BufferCount() const noexcept;
+  std::vector<BufferListing> ListBuffers() const;
+  // A buffer other than the current one with unsaved changes, or zero.
+  std::size_t HiddenDirtyBuffer() const noexcept;
+  // Stores where each large file's view was left in IndexCache, for when it
+  // is opened again.
+  void RememberViews();
+  // Leaves the swap files of buffers with unsaved changes behind, for
+  // recovery after the editor is cut off rather than quit.
+  void PreserveSwaps();
+  // Bytes the inactive buffers may hold between them.
+  void SetBufferBudget(std::size_t bytes);
+  Registers& GetRegisters() noexcept;
+  const Registers& GetRegisters() const noexcept;
 
   std::size_t CursorLine() const noexcept;
   std::size_t CursorColumn() const noexcept;
+  // The cursor always rests at the start of a grapheme (see Utf8.hpp).
   void SetCursor(std::size_t line, std::size_t column);
+  // Keeps the display column the cursor is at, as near as the line allows,
+  // or the end of the line while the cursor keeps to it.
   void MoveCursorLine(int delta);
+  // Moves by graphemes.
   void MoveCursorColumn(int delta);
+  // After $, the cursor keeps to the end of each line it moves up or down
+  // to, until it is put anywhere else.
+  void KeepCursorAtLineEnd() noexcept;
+  bool KeepsCursorAtLineEnd() const noexcept;
+  const Viewport& GetViewport() const noexcept;
+  void SetViewport(const Viewport& viewport) noexcept;
+  const ViewOptions& GetViewOptions() const noexcept;
+  void SetViewOptions(const ViewOptions& options) noexcept;
 
   Mode CurrentMode() const noexcept;
   bool IsRunning() const noexcept;
+  // Setting any mode but kVisual drops the selection.
   void SetMode(Mode mode) noexcept;
   void RequestQuit() noexcept;
 
+  // Visual mode selects from an anchor, set at the cursor here, to wherever
+  // the cursor goes.
+  void StartSelection(SelectionKind kind);
+  void SetSelectionKind(SelectionKind kind) noexcept;
+  SelectionKind GetSelectionKind() const noexcept;
+  // Swaps the anchor and the cursor, as o does.
+  void SwapSelectionEnds();
+  // Null without a selection. A block's columns are display columns, the
+  // cursor's and the anchor's characters both included.
+  std::optional<Selection> GetSelection();
+
   void SetStatus(const std::string& message,
                  StatusSeverity severity = StatusSeverity::kInfo);
   void ClearStatus() noexcept;
   const std::string& Status() const noexcept;
   StatusSeverity StatusLevel() const noexcept;
 
+  // The pattern whose matches are highlighted, or null for none.
+  void SetSearchHighlight(std::shared_ptr<const Pattern> pattern) noexcept;
+  const std::shared_ptr<const Pattern>& SearchHighlight() const noexcept;
+
+  void RecordInputLatency(std::chrono::microseconds latency) noexcept;
+  const LatencyStats& InputLatency() const noexcept;
+
+  // Whether the message line shows the profiler's totals when it has no
+  // message; see :profile.
+  void SetShowsProfile(bool shows) noexcept;
+  bool ShowsProfile() const noexcept;
+
  private:
+  struct BufferSlot {
+    // Null while unloaded.
+    std::unique_ptr<Buffer> buffer;
+    std::unique_ptr<Highlighter> highlighter;
+    // Where an unloaded buffer is loaded from again, and how.
+    std::string path;
+    LoadStrategy strategy = LoadStrategy::kAuto;
+    std::size_t number = 0;
+    std::uint64_t id = 0;
+    std::uint64_t last_used = 0;
+    std::size_t cursor_line = 0;
+    std::size_t cursor_column = 0;
+    Viewport viewport;
+  };
+
+  // The columns of a line the cursor has recently moved from or to, walked
+  // only as far as it went.
+  struct LineColumns {
+    std::uint64_t revision = 0;
+    std::size_t line = 0;
+    std::size_t tabstop = 0;
+    LineLayout layout;
+  };
+
   void ClampCursor();
+  LineLayout& ColumnsOf(std::size_t line, std::string_view text);
+  void AddBuffer(std::unique_ptr<Buffer> buffer);
+  bool Load(BufferSlot& slot);
+  // Takes the view IndexCache remembered for a buffer just loaded.
+  void RestoreView(BufferSlot& slot);
+  void RememberView(const BufferSlot& slot, std::size_t line,
+                    std::size_t column);
+  void Activate(std::size_t index);
+  void EnforceBudget();
 
-  Buffer buffer_;
+  std::vector<BufferSlot> buffers_;
+  std::size_t current_ = 0;
+  std::size_t next_number_ = 1;
+  std::uint64_t next_id_ = 1;
+  std::uint64_t use_clock_ = 0;
+  std::size_t buffer_budget_ = kDefaultBufferBudget;
+  Buffer* buffer_ = nullptr;
+  Registers registers_;
   std::size_t cursor_line_ = 0;
   std::size_t cursor_column_ = 0;
+  bool keeps_line_end_ = false;
+  Viewport viewport_;
+  ViewOptions view_options_;
+  std::array<LineColumns, 2> line_columns_;
+  std::size_t next_columns_ = 0;
   Mode mode_ = Mode::kNormal;
+  std::optional<TextPosition> selection_anchor_;
+  SelectionKind selection_kind_ = SelectionKind::kCharacter;
   bool running_ = true;
   std::string status_message_;
   StatusSeverity status_severity_ = StatusSeverity::kNone;
+  LatencyStats input_latency_;
+  bool shows_profile_ = false;
+  std::shared_ptr<const Pattern> search_highlight_;
 };
 }  // namespace core
\ No newline at end of file
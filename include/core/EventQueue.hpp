@@ -1,18 +1,107 @@
 #pragma once
 
-#include <mutex>
-#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
 
 #include "core/KeyEvent.hpp"
 
 namespace core {
+enum class OverflowPolicy : std::uint8_t {
+  // The producer waits for the consumer to make room.
+  kBlock,
+  // Arrow keys are dropped while the queue is full, so held-down navigation
+  // collapses instead of lagging; every other key still blocks.
+  kCoalesce,
+};
+
+// Bounded single-producer/single-consumer ring of key events. Push() is only
+// called from the input thread and Drain() only from the main loop; neither
+// takes a lock, and only pasted text is ever copied into the ring.
 class EventQueue {
  public:
-  void Push(const KeyEvent& event);
-  std::vector<KeyEvent> ConsumeAll();
+  using Clock = std::chrono::steady_clock;
+  using WakeHook = std::function<void()>;
+
+  static constexpr std::size_t kDefaultCapacity = 1024;
+
+  explicit EventQueue(std::size_t capacity = kDefaultCapacity,
+                      OverflowPolicy policy = OverflowPolicy::kBlock);
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+  EventQueue(EventQueue&&) = delete;
+  EventQueue& operator=(EventQueue&&) = delete;
+
+  // Called by a producer that is about to wait on a full queue, so a
+  // sleeping consumer can be woken to drain it.
+  void SetWakeHook(WakeHook hook);
+
+  // Returns false when the event was coalesced away.
+  bool Push(const KeyEvent& event);
+
+  // Passes the events queued at the time of the call to `visit`, oldest
+  // first, until it returns false. `first_arrival` receives the push time of
+  // the first event visited. Returns the number of events consumed.
+  template <typename Visitor>
+  std::size_t Drain(Visitor&& visit, Clock::time_point* first_arrival = nullptr);
+
+  bool Empty() const noexcept;
+  std::size_t Capacity() const noexcept;
+  std::uint64_t Dropped() const noexcept;
 
  private:
-  std::mutex mutex_;
-  std::vector<KeyEvent> events_;
+  struct Slot {
+    KeyEvent event;
+    Clock::time_point arrival;
+    std::string text;
+  };
+
+  static constexpr std::size_t kCacheLine = 64;
+  static constexpr std::size_t kRetainedTextBytes = 64 * 1024;
+
+  void Release(std::size_t head) noexcept;
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_ = 0;
+  OverflowPolicy policy_;
+  WakeHook wake_hook_;
+
+  alignas(kCacheLine) std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_ = 0;
+  alignas(kCacheLine) std::atomic<std::size_t> tail_{0};
+  std::size_t cached_head_ = 0;
+  std::atomic<bool> producer_waiting_{false};
+  // A futex-sized word the blocked producer sleeps on.
+  std::atomic<std::uint32_t> space_epoch_{0};
+  std::atomic<std::uint64_t> dropped_{0};
 };
+
+template <typename Visitor>
+std::size_t EventQueue::Drain(Visitor&& visit,
+                              Clock::time_point* first_arrival) {
+  std::size_t head = head_.load(std::memory_order_relaxed);
+  cached_tail_ = tail_.load(std::memory_order_acquire);
+  const std::size_t kFirst = head;
+  while (head != cached_tail_) {
+    const Slot& slot = slots_[head & mask_];
+    if (first_arrival != nullptr && head == kFirst) {
+      *first_arrival = slot.arrival;
+    }
+    const bool kContinue = visit(slot.event);
+    ++head;
+    if (!kContinue) {
+      break;
+    }
+  }
+
+  if (head != kFirst) {
+    Release(head);
+  }
+  return head - kFirst;
+}
 }  // namespace core
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/Registry.hpp"
+
+namespace core {
+// One end of an ex range: '.', '$' or a line number, then any number of +n
+// or -n offsets. Offsets alone count from the cursor.
+struct ExAddress {
+  enum class Base : std::uint8_t {
+    kCurrent,
+    kLast,
+    kNumber,
+  };
+
+  Base base = Base::kCurrent;
+  // One-based, for kNumber.
+  std::size_t number = 0;
+  std::ptrdiff_t offset = 0;
+};
+
+struct ExRange {
+  // 0, 1 or 2; '%' gives two.
+  std::size_t addresses = 0;
+  ExAddress first;
+  ExAddress last;
+  // Set for "first;last", where `last` counts from `first` rather than from
+  // the cursor.
+  bool from_first = false;
+
+  // The zero-based, half-open lines [first, last) of a buffer of
+  // `line_count` lines; the cursor's line when no address was given.
+  bool Resolve(std::size_t cursor, std::size_t line_count, std::size_t& first,
+               std::size_t& last, std::string& error) const;
+};
+
+// A command line entry as typed: `name` is only letters, or one punctuation
+// character such as '!', and `arguments` has the surrounding blanks removed.
+struct ExCommand {
+  ExRange range;
+  std::string name;
+  bool bang = false;
+  std::string arguments;
+};
+
+// A command name, which can be shortened to its first `shortest` letters.
+struct ExCommandName {
+  std::string name;
+  std::size_t shortest = 0;
+};
+
+struct ExCommandSpec {
+  std::vector<ExCommandName> names;
+  bool range = false;
+  bool bang = false;
+  // The argument runs to the end of the line, '|' included, as for a
+  // pattern.
+  bool bar = false;
+  // The argument starts with this many parts, each ended by the character
+  // that starts the first, as :s/pattern/replacement/ has two. A '|' inside
+  // them belongs to them; one after them ends the command.
+  std::size_t delimited_parts = 0;
+  // Changes the text, so it is refused in a read-only buffer.
+  bool modifies = false;
+  // What it reaches, as for a registry command. Ex commands always run on
+  // the main thread, so one that spawns a process while it also holds the
+  // buffer blocks input until the process is done, as in vi.
+  CommandCapabilityMask capabilities = 0;
+};
+
+// Parses the range and name at the start of `text`, after any blanks and
+// colons; `rest` receives what follows them.
+bool ParseExCommandHead(std::string_view text, ExCommand& command,
+                        std::string_view& rest, std::string& error);
+// Takes an argument from the start of `rest`, up to a '|' that ends the
+// command, and leaves `rest` after that '|'. A backslash before a '|' makes
+// it part of the argument.
+std::string TakeExArgument(std::string_view& rest);
+// TakeExArgument() for an argument whose first `parts` parts are delimited
+// as ExCommandSpec::delimited_parts describes; a backslash escapes the next
+// character inside them.
+std::string TakeDelimitedExArgument(std::string_view& rest,
+                                    std::size_t parts);
+}  // namespace core
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace core {
+enum class TokenKind : std::uint8_t {
+  kText,
+  kKeyword,
+  kType,
+  kString,
+  kNumber,
+  kComment,
+  kPreprocessor,
+};
+
+struct TokenSpan {
+  std::size_t start = 0;
+  std::size_t length = 0;
+  TokenKind kind = TokenKind::kText;
+};
+
+// What the lexer carries from the end of one line to the start of the next:
+// whether it is inside a block comment, a multi-line string or a continued
+// preprocessor line.
+using LexState = std::uint8_t;
+
+// The lexical rules of a language, as plain data. Keyword and type lists are
+// sorted so they can be binary searched.
+struct Filetype {
+  std::string_view name;
+  std::span<const std::string_view> extensions;
+  std::span<const std::string_view> keywords;
+  std::span<const std::string_view> types;
+  std::string_view line_comment;
+  std::string_view block_comment_open;
+  std::string_view block_comment_close;
+  // Lines starting with '#' are C preprocessor directives.
+  bool directives = false;
+  // """ and ''' strings, which may span lines.
+  bool triple_quotes = false;
+};
+
+// The built-in filetype for `path`, chosen by extension, or null.
+const Filetype* DetectFiletype(std::string_view path);
+
+// Lexes `line` starting in `state` and returns the state it ends in. Tokens
+// other than plain text are appended to `tokens` when it is not null.
+LexState LexLine(const Filetype& filetype, std::string_view line,
+                 LexState state, std::vector<TokenSpan>* tokens);
+}  // namespace core
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace core {
+// Growable byte buffer that keeps its storage across Clear(), so once it has
+// grown to fit a frame, composing later frames does not allocate.
+class FrameBuffer {
+ public:
+  FrameBuffer() = default;
+
+  void Clear() noexcept;
+  void Truncate(std::size_t size) noexcept;
+  void Reserve(std::size_t capacity);
+  void Swap(FrameBuffer& other) noexcept;
+
+  void Append(std::string_view text);
+  void Append(char value);
+  void AppendRepeated(char value, std::size_t count);
+  // Formats through fixed scratch space, right-aligned to `width`.
+  void AppendNumber(std::size_t value, std::size_t width = 0);
+  // Appends as much of `text` as fits before Size() reaches `limit`.
+  void AppendClipped(std::string_view text, std::size_t limit);
+
+  std::string_view View() const noexcept;
+  std::size_t Size() const noexcept;
+  bool Empty() const noexcept;
+  // Number of times the storage had to grow.
+  std::uint64_t Growths() const noexcept;
+
+ private:
+  void Grow(std::size_t required);
+
+  std::unique_ptr<char[]> data_;
+  std::size_t size_ = 0;
+  std::size_t capacity_ = 0;
+  std::uint64_t growths_ = 0;
+};
+
+std::size_t DecimalDigits(std::size_t value) noexcept;
+}  // namespace core
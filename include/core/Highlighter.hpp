@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "core/Filetype.hpp"
+
+namespace core {
+class Buffer;
+
+// Syntax highlighting for one buffer. The lexer state at the start of every
+// line lexed so far is cached, one byte per line, and lines are lexed only
+// when a line at or below them is drawn, so opening a file lexes no more
+// than its first screen. After an edit the lines below it are lexed again
+// only until a state matches the cached one, from where the cache is known
+// to be right again.
+class Highlighter {
+ public:
+  // Applies the buffer's line changes since its last ClearDamage(), and
+  // picks the filetype again when its path changed.
+  void Sync(const Buffer& buffer);
+  const Filetype* GetFiletype() const noexcept;
+
+  LexState StateAt(const Buffer& buffer, std::size_t line);
+  // Replaces `tokens` with those of `line`, lexing no more than its first
+  // `limit` bytes.
+  void Tokenize(const Buffer& buffer, std::size_t line,
+                std::vector<TokenSpan>& tokens, std::size_t limit = SIZE_MAX);
+
+  // The states at the start of the first lines, as far as they are known
+  // to be right.
+  std::span<const LexState> Checkpoints() const noexcept;
+  // Takes states Checkpoints() once gave for the buffer's text as it is
+  // now, as kept by IndexCache, so that drawing far into a file just opened
+  // need not lex every line above.
+  void Seed(const Buffer& buffer, std::vector<LexState> states);
+
+  // Lines run through the lexer so far, for measuring.
+  std::uint64_t LinesLexed() const noexcept;
+
+ private:
+  void Reset();
+
+  const Filetype* filetype_ = nullptr;
+  std::string path_;
+  // states_[i] is the state at the start of line i. Entries before valid_
+  // are exact; entries from resync_ on follow from each other, so once the
+  // lexer reaches one of them with the same state, all of them are exact.
+  std::vector<LexState> states_;
+  std::size_t valid_ = 0;
+  std::size_t resync_ = 0;
+  std::uint64_t lines_lexed_ = 0;
+  // The buffer revision Seed() was given states for; the reload behind
+  // them must not reset them.
+  std::uint64_t seed_revision_ = 0;
+};
+}  // namespace core
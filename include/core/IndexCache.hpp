@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/Filetype.hpp"
+#include "core/LineScanner.hpp"
+#include "core/SwapFile.hpp"
+
+namespace core {
+// Which file, and which contents of it, a cache entry was made for: its
+// absolute path, size and mtime, and a hash of blocks sampled across its
+// text, which catches a rewrite that kept both.
+struct IndexKey {
+  std::string path;
+  FileStamp stamp;
+  std::uint64_t sample = 0;
+
+  // Reads no more than kSampleBlocks * kSampleBytes of `text`.
+  static IndexKey Of(const std::string& path, std::string_view text);
+  bool operator==(const IndexKey&) const = default;
+
+  static constexpr std::size_t kSampleBlocks = 16;
+  static constexpr std::size_t kSampleBytes = 4096;
+};
+
+// Where the file was left: the cursor, and the lexer states of its lines as
+// far as they were lexed (see Highlighter::Checkpoints()).
+struct ViewMemory {
+  std::size_t cursor_line = 0;
+  std::size_t cursor_column = 0;
+  std::vector<LexState> lex_states;
+};
+
+// Sidecar files under the user's cache directory that let a large file be
+// opened again without scanning it: its line index and text statistics,
+// written once indexing finishes, and the view it was left with, written
+// when it is closed. Entries are named by a hash of the path; one whose key
+// no longer matches the file is ignored and, in time, overwritten. Past
+// kMaxEntries files or kMaxBytes, the least recently used go first.
+class IndexCache {
+ public:
+  static constexpr std::size_t kMaxEntries = 256;
+  static constexpr std::uint64_t kMaxBytes = std::uint64_t{512} * 1024 * 1024;
+  // Cached starts checked against the text before an index is trusted.
+  static constexpr std::size_t kSpotChecks = 64;
+
+  // $XDG_CACHE_HOME/microvi, ~/.cache/microvi, or %LOCALAPPDATA%\microvi;
+  // empty when there is no such place.
+  static std::string Directory();
+
+  // `starts` are the line starts past the first line's, as LineIndexer
+  // finds them, and none past the end of the text. The key can match a
+  // file changed outside its sampled blocks, so kSpotChecks of them, spread
+  // over `text`, must each follow a '\n', with no other in the line it ends.
+  static bool Load(const IndexKey& key, std::string_view text,
+                   std::vector<std::uint64_t>& starts, TextStats& stats);
+  static bool Store(const IndexKey& key,
+                    std::span<const std::uint64_t> starts,
+                    const TextStats& stats);
+
+  static bool LoadView(const IndexKey& key, ViewMemory& view);
+  static bool StoreView(const IndexKey& key, const ViewMemory& view);
+};
+}  // namespace core
@@ -1,18 +1,77 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "Command.hpp"
+#include "ExCommand.hpp"
 
 namespace core {
+// Runs command lines. Each command is parsed once into its range, name,
+// bang and argument, and is found by name in a table holding every
+// abbreviation of every registered name, so lookup does not depend on how
+// many commands there are.
 class InputHandler {
  public:
+  // Offered the commands no registered command is named for, with `name`
+  // extended to the whole first word, such as `plugin.command`. Returns
+  // false when it does not know them either; it reports its own failures.
+  using Fallback = std::function<bool(EditorState&, const ExCommand&)>;
+
+  // A full name wins over an abbreviation of another; otherwise the first
+  // command registered under a name keeps it.
   void RegisterCommand(std::unique_ptr<Command> command);
-  bool Handle(EditorState& state, const std::string& input);
+  void SetFallback(Fallback fallback);
+  // Runs the '|'-separated commands of `line` in order, each after the
+  // background work of earlier ones has finished. Nothing runs unless the
+  // whole line parses, and a failing command stops the rest. Errors go to
+  // the status line; returns false on any.
+  bool Handle(EditorState& state, std::string_view line);
+
+  // Passed to every command, registered before or after.
+  void SetWakeHook(std::function<void()> hook);
+  bool Poll(EditorState& state);
+  bool IsBusy() const;
+  bool Cancel(EditorState& state);
+  void Finish(EditorState& state);
 
  private:
-  std::vector<std::unique_ptr<Command>> commands_;
+  struct Entry {
+    std::unique_ptr<Command> command;
+    ExCommandSpec spec;
+  };
+
+  struct NameTarget {
+    std::size_t entry = 0;
+    std::size_t name = 0;
+    bool exact = false;
+  };
+
+  enum class StepKind : std::uint8_t {
+    kCommand,
+    kGoToLine,
+    kFallback,
+  };
+
+  struct Step {
+    StepKind kind = StepKind::kCommand;
+    std::size_t entry = 0;
+    ExCommand command;
+  };
+
+  bool Parse(EditorState& state, std::string_view line,
+             std::vector<Step>& steps) const;
+  bool Run(EditorState& state, const Step& step);
+
+  std::vector<Entry> commands_;
+  std::unordered_map<std::string, NameTarget> names_;
+  Fallback fallback_;
+  std::function<void()> wake_hook_;
 };
 }  // namespace core
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string_view>
 
 namespace core {
 enum class KeyCode : std::uint8_t {
@@ -12,11 +13,15 @@ enum class KeyCode : std::uint8_t {
   kArrowDown,
   kArrowLeft,
   kArrowRight,
+  kPaste,
 };
 
 struct KeyEvent {
   KeyCode code{};
   char value = '\0';
+  // kPaste payload with '\n' line breaks; only valid while the event is
+  // being handled.
+  std::string_view text;
 };
 
 inline KeyEvent MakeCharacterEvent(char value) {
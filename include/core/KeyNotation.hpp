@@ -0,0 +1,24 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/KeyEvent.hpp"
+
+namespace core {
+// Keys written out as vi's :map has them: characters as themselves and the
+// rest by name in angle brackets, as in "dw<Esc>:w<CR>". The names are
+// <Esc>, <CR>, <BS>, <Tab>, <Up>, <Down>, <Left>, <Right>, <lt> for '<' and
+// <C-x> for a control character. A paste is "<Paste>text<PasteEnd>", with
+// its line breaks as <CR>. Nothing written contains a line break, so keys
+// can be kept a line at a time.
+void AppendKeyNotation(const KeyEvent& event, std::string& notation);
+
+// The keys `notation` names. Paste text is kept in `pastes`, which the
+// events point into; an angle bracket that starts no name stands for
+// itself, as does one in <> that is not known.
+void ParseKeyNotation(std::string_view notation, std::vector<KeyEvent>& events,
+                      std::deque<std::string>& pastes);
+}  // namespace core
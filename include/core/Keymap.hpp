@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "core/KeyEvent.hpp"
+#include "core/Mode.hpp"
+#include "core/Registry.hpp"
+
+namespace core {
+// The active keybindings compiled into a prefix trie per mode, with each
+// binding's command and invocation resolved up front, so dispatching a key
+// takes no lock, builds no string and copies nothing. The first key of a
+// gesture is found in a table indexed by mode and key. A Keymap never
+// changes once built; Registry::CompileKeymap() builds a new one, which is
+// only needed when Registry::Version() has moved past Version().
+class Keymap {
+ public:
+  struct Binding {
+    CommandInvocation invocation;
+    // Empty when the command is missing or is not native.
+    CommandCallable::NativeCallback callback;
+    // The plugin serving the command, when it is not native.
+    std::string rpc_endpoint;
+    CommandCapabilityMask capabilities = 0;
+    bool command_found = false;
+  };
+
+  // A trie node; zero is no node.
+  using NodeId = std::uint32_t;
+
+  explicit Keymap(std::uint64_t version);
+
+  // Binds a sequence of keys, each a character, a named key (<Enter>, <Esc>,
+  // <Backspace>, <Up>, <Down>, <Left>, <Right>), a control key such as
+  // <C-r>, or, after the first, <Char> for any character, which the command
+  // receives as CommandInvocation::operand. A kAny binding applies in modes
+  // whose own trie has nothing for its first key. Returns false for a
+  // gesture that does not parse.
+  bool Bind(KeybindingMode mode, std::string_view gesture, Binding binding);
+
+  // The binding of a single-key gesture, or null.
+  const Binding* Find(Mode mode, const KeyEvent& event) const noexcept;
+
+  NodeId Root(Mode mode, const KeyEvent& event) const noexcept;
+  // The child for exactly this key, not counting a <Char> child.
+  NodeId Child(NodeId node, const KeyEvent& event) const noexcept;
+  NodeId CharChild(NodeId node) const noexcept;
+  const Binding* BindingAt(NodeId node) const noexcept;
+  bool HasChildren(NodeId node) const noexcept;
+
+  std::uint64_t Version() const noexcept;
+
+  // The table slot of a key, or nullopt for keys that cannot be bound.
+  static std::optional<std::size_t> KeySlot(const KeyEvent& event) noexcept;
+
+ private:
+  struct Node {
+    // One plus the index into bindings_, or zero.
+    std::uint16_t binding = 0;
+    NodeId char_child = 0;
+    // By key slot.
+    std::vector<std::pair<std::uint16_t, NodeId>> children;
+  };
+
+  // Every byte, then the named keys from kEscape to kArrowRight.
+  static constexpr std::size_t kKeys = 256 + 7;
+  // The four Modes, then kAny.
+  static constexpr std::size_t kModes = 5;
+  // Stands for <Char> in a parsed gesture.
+  static constexpr std::size_t kCharSlot = kKeys;
+
+  static bool ParseGesture(std::string_view gesture,
+                           std::vector<std::size_t>& keys);
+  NodeId AddChild(NodeId node, std::size_t slot);
+
+  std::uint64_t version_;
+  std::vector<Binding> bindings_;
+  // nodes_[0] stands for no node.
+  std::vector<Node> nodes_;
+  std::array<NodeId, kModes * kKeys> roots_{};
+};
+}  // namespace core
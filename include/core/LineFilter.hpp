@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "core/Buffer.hpp"
+#include "core/Pattern.hpp"
+#include "core/PieceTable.hpp"
+
+namespace core {
+// How :sort orders lines. Plain lines compare byte by byte.
+struct SortOrder {
+  // By the first decimal number in each line, with a '-' just before it
+  // making it negative; lines without one come first.
+  bool numeric = false;
+  bool reverse = false;
+  // Keeps only the first of identical lines once they are sorted.
+  bool unique = false;
+};
+
+// Line-wise work over whole ranges, done on views of the lines so no text is
+// copied. Below kParallelLines lines it runs on the calling thread; above,
+// the lines are cut into one slice per core, and the calling thread works on
+// one of them.
+inline constexpr std::size_t kParallelLines = 16 * 1024;
+
+// Views of lines [first, last) of `snapshot`, which keeps them alive.
+std::vector<std::string_view> SnapshotLines(const TextSnapshot& snapshot,
+                                            std::size_t first,
+                                            std::size_t last);
+// Sorts stably, so lines that compare equal keep their order, reversed or
+// not.
+void SortLines(std::vector<std::string_view>& lines, const SortOrder& order);
+// The lines `pattern` matches, or does not when `invert`, as runs of
+// adjacent lines in order; `lines` are numbered from `first_line` on.
+std::vector<LineRange> MatchLines(std::span<const std::string_view> lines,
+                                  std::size_t first_line,
+                                  const Pattern& pattern, bool invert);
+}  // namespace core
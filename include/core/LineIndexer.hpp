@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/LineScanner.hpp"
+
+namespace core {
+// Builds the line-start table of a text. The first lines are found on the
+// calling thread; the remainder is scanned on a background thread and handed
+// to the owner in batches.
+class LineIndexer {
+ public:
+  LineIndexer() = default;
+  ~LineIndexer();
+
+  LineIndexer(const LineIndexer&) = delete;
+  LineIndexer& operator=(const LineIndexer&) = delete;
+  LineIndexer(LineIndexer&&) = delete;
+  LineIndexer& operator=(LineIndexer&&) = delete;
+
+  // Scans until `starts` holds at least `sync_lines` entries or the text
+  // ends, then continues in the background. `text` must outlive the scan;
+  // call Stop() before releasing it.
+  void Start(std::string_view text, std::size_t sync_lines,
+             std::vector<std::uint64_t>& starts);
+  void Stop();
+  void Wait();
+
+  // Moves the line starts found so far into `starts`. Returns true once the
+  // whole text has been scanned and every start has been handed out.
+  bool Drain(std::vector<std::uint64_t>& starts);
+  bool IsRunning() const noexcept;
+
+  // Complete once the scan has finished (Drain() returned true).
+  const TextStats& Stats() const noexcept;
+
+ private:
+  void Run(const std::stop_token& token);
+
+  std::string_view text_;
+  std::uint64_t offset_ = 0;
+  LineScanner scanner_;
+  std::mutex mutex_;
+  std::vector<std::uint64_t> pending_;
+  std::atomic<bool> finished_{false};
+  bool running_ = false;
+  std::jthread worker_;
+};
+}  // namespace core
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace core {
+// Where the characters of one line fall on screen. Tabs reach the next tab
+// stop, control characters show as ^X, wide characters take two cells and
+// combining marks none. With wrapping, the line is cut into rows of
+// `wrap_width` cells; a wide character that does not fit at the end of a
+// row moves to the next one, leaving a blank cell, and a tab stops at the
+// row's end, so row r always starts at display column r * wrap_width.
+//
+// The line is walked lazily, only as far as a query needs, leaving marks:
+// the start of every row when wrapping, else the first character after
+// every kMarkBytes bytes. A query behind the walk costs a binary search and
+// a walk from the last mark before it; runs of printable ASCII are passed
+// over 16 bytes at a time. Drawing the start of a very long line
+// therefore costs what drawing a short line does, and its far end costs one
+// walk, after which the layout can be kept.
+class LineLayout {
+ public:
+  static constexpr std::size_t kMarkBytes = 256;
+
+  // One character as placed: `byte` and `length` locate it in the line. A
+  // glyph of no length stands for the end of the line.
+  struct Glyph {
+    std::size_t byte = 0;
+    std::size_t length = 0;
+    std::size_t column = 0;
+    std::size_t cells = 0;
+  };
+
+  // Starts over for `line`, which every other call must be given again;
+  // the layout does not keep it.
+  void Reset(std::string_view line, std::size_t tabstop,
+             std::size_t wrap_width);
+
+  // Display columns the whole line takes, blank cells left by wrapping
+  // included.
+  std::size_t Width(std::string_view line);
+  // The rows the line wraps to, one unless wrapping, but no more than
+  // `limit`, so that finding there are many walks only that far.
+  std::size_t Rows(std::string_view line, std::size_t limit = SIZE_MAX);
+
+  // The character covering `column`, or the first one after it when it
+  // falls on a blank cell; past the end, the end.
+  Glyph Locate(std::string_view line, std::size_t column);
+  // The column the character holding `byte` starts at; Width() past the
+  // end.
+  std::size_t ColumnOf(std::string_view line, std::size_t byte);
+  // The glyph following `glyph`.
+  Glyph Next(std::string_view line, const Glyph& glyph) const noexcept;
+
+ private:
+  struct Mark {
+    std::size_t byte = 0;
+    std::size_t column = 0;
+  };
+
+  // The character at `byte`, before the end, when the line so far reaches
+  // `column`.
+  Glyph Place(std::string_view line, std::size_t byte,
+              std::size_t column) const noexcept;
+  // Walks on until past `byte` and `column`, or to the end.
+  void Extend(std::string_view line, std::size_t byte, std::size_t column);
+
+  std::size_t tabstop_ = 8;
+  std::size_t wrap_width_ = 0;
+  std::vector<Mark> marks_;
+  std::size_t next_mark_ = kMarkBytes;
+  // How far the walk has got.
+  std::size_t walked_byte_ = 0;
+  std::size_t walked_column_ = 0;
+  bool complete_ = false;
+};
+}  // namespace core
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace core {
+enum class ScanKernel : std::uint8_t {
+  kAuto,
+  kScalar,
+  kSse2,
+  kAvx2,
+  kNeon,
+};
+
+enum class TextEncoding : std::uint8_t {
+  kAscii,
+  kUtf8,
+  kUtf16Le,
+  kUtf16Be,
+  kLegacy8Bit,
+  kBinary,
+};
+
+enum class LineEnding : std::uint8_t {
+  kLf,
+  kCrLf,
+};
+
+struct TextStats {
+  std::uint64_t bytes = 0;
+  std::uint64_t lf_count = 0;
+  std::uint64_t crlf_count = 0;
+  std::uint64_t nul_count = 0;
+  bool has_bom = false;
+  TextEncoding encoding = TextEncoding::kAscii;
+};
+
+// Finds line starts and gathers line-ending and encoding statistics in a
+// single pass. Text may be fed in consecutive chunks; state that straddles a
+// chunk boundary (a CR before LF, a partial UTF-8 sequence) is carried over.
+class LineScanner {
+ public:
+  explicit LineScanner(ScanKernel kernel = ScanKernel::kAuto);
+
+  // Appends `base` + the offset just past every '\n' in `text`.
+  void Scan(std::string_view text, std::uint64_t base,
+            std::vector<std::uint64_t>& starts);
+  // Settles the encoding once the last chunk has been scanned.
+  void Finish();
+
+  const TextStats& Stats() const noexcept;
+  ScanKernel Kernel() const noexcept;
+
+  static ScanKernel DetectKernel() noexcept;
+  static bool IsSupported(ScanKernel kernel) noexcept;
+
+  struct State {
+    bool previous_cr = false;
+    std::uint8_t utf8_pending = 0;
+    bool utf8_valid = true;
+    bool non_ascii = false;
+  };
+
+ private:
+  ScanKernel kernel_;
+  TextStats stats_;
+  State state_;
+};
+}  // namespace core
@@ -1,82 +1,186 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
+#include "core/ChordResolver.hpp"
+#include "core/ExCommand.hpp"
 #include "core/InputHandler.hpp"
 #include "core/KeyEvent.hpp"
+#include "core/Keymap.hpp"
+#include "core/Motions.hpp"
+#include "core/Pattern.hpp"
+#include "core/PluginHost.hpp"
 #include "core/Registry.hpp"
+#include "core/Searcher.hpp"
+#include "core/Selection.hpp"
+#include "core/TextPosition.hpp"
 
 namespace core {
 class EditorState;
+struct RegisterContent;
 
 class ModeController {
  public:
-  ModeController(EditorState& state, InputHandler& command_handler);
+  ModeController(EditorState& state, InputHandler& command_handler,
+                 PluginHost& plugin_host);
   ~ModeController();
 
   void HandleEvent(const KeyEvent& event);
   std::string_view CommandBuffer() const noexcept;
+  // ':' for ex commands, '/' or '?' while a search is typed.
+  char CommandPrefix() const noexcept;
+
+  // Large buffers are searched in the background; the hook runs on the
+  // search thread when a result is ready for SyncSearch() to apply.
+  void SetSearchWakeHook(std::function<void()> hook);
+  bool SyncSearch();
+  // A background search is still running.
+  bool IsSearching() const noexcept;
+
+  // How long a chord that is bound but also starts a longer one waits for
+  // its next key; SyncChord() runs it once ChordDeadline() has passed.
+  void SetChordTimeout(std::chrono::milliseconds timeout);
+  bool SyncChord();
+  std::optional<ChordResolver::Clock::time_point> ChordDeadline()
+      const noexcept;
 
  private:
-  enum class FindCommandAction : std::uint8_t {
-    kMove,
-    kDelete,
-    kYank,
+  // Generated from the operators and motions; see ModeController.cpp.
+  struct OperatorTable;
+
+  // I, A and c on a block: what is typed on its first line goes on its
+  // other lines too when insert mode ends. I puts it before the block on
+  // the lines that reach into it, A after it on every line, padding short
+  // ones with blanks, and c where the block was on lines that reached it.
+  struct BlockInsert {
+    enum class Kind : std::uint8_t {
+      kInsert,
+      kAppend,
+      kChange,
+    };
+
+    Kind kind = Kind::kInsert;
+    std::size_t first_line = 0;
+    std::size_t last_line = 0;
+    // The display column the text goes in at, or, after $, the end of each
+    // line.
+    std::size_t column = 0;
+    bool to_line_end = false;
+    // Where typing started on the first line, and the line's length then.
+    std::size_t start = 0;
+    std::size_t length = 0;
   };
 
   void HandleNormalMode(const KeyEvent& event);
   void HandleInsertMode(const KeyEvent& event);
   void HandleCommandMode(const KeyEvent& event);
-  bool ExecuteCommandLine(const std::string& line);
+  void HandleSearchPrompt(const KeyEvent& event);
+  void HandleVisualMode(const KeyEvent& event);
   void InitializeRegistryBindings();
-  bool ExecuteRegisteredBinding(const KeyEvent& event);
-  static KeybindingMode ToKeybindingMode(Mode mode) noexcept;
-  std::string MakeGesture(const KeyEvent& event) const;
-  bool InvokeCommand(const std::string& command_id,
-                     const std::unordered_map<std::string, std::string>& args);
+  void ExecuteRegisteredBinding(const KeyEvent& event);
+  bool InvokeBinding(const ChordMatch& match);
+  // Runs a registry command named on the command line; false when there is
+  // none by that id.
+  bool RunRegisteredCommand(const ExCommand& command);
+  // Runs invocation_ with whichever callable the command has.
+  bool RunCommand(const CommandCallable::NativeCallback& callback,
+                  std::string_view rpc_endpoint,
+                  CommandCapabilityMask capabilities);
 
   void InsertCharacter(char value);
+  void InsertUtf8Byte(char value);
+  void InsertText(std::string_view text);
   void InsertNewline();
   void HandleBackspace();
+  void ApplyUndo(bool redo, std::size_t count);
+
+  // Moves the cursor over the span of `Motion`, or deletes or yanks it, by
+  // the type of `Operator`.
+  template <typename Operator, typename Motion>
+  void ApplyOperator(const CommandInvocation& invocation);
 
-  bool ApplyFindCommand(char command, FindCommandAction action, char target);
-  bool ApplyRepeatFind(bool reverse_direction, FindCommandAction action);
-  bool HandlePendingFind(char input, FindCommandAction action);
+  // v, V and CTRL-V start visual mode, switch it to their kind, or leave it
+  // when it is of their kind already.
+  void ToggleVisual(SelectionKind kind);
+  // Returns to normal mode with what was selected.
+  std::optional<Selection> EndVisual();
+  // Each applies to the whole selection as a single edit, however many
+  // lines it spans, and leaves visual mode.
+  void DeleteSelection(bool change);
+  void YankSelection();
+  void ReplaceSelection(char value);
+  void InsertAtSelection(bool append);
+  void StartBlockInsert(const Selection& selection, BlockInsert::Kind kind);
+  void FinishBlockInsert();
+  // Removes a block, putting its text in `text`; false when it has none.
+  bool DeleteBlock(const Selection& selection, std::string& text);
+  std::string BlockText(const Selection& selection);
+  // Where a block starts on its first line.
+  TextPosition BlockStart(const Selection& selection);
 
-  bool HandleDeleteOperator(char motion);
-  bool HandleYankOperator(char motion);
+  // While a search is typed, the cursor previews the first match and
+  // returns to where it was if the search is abandoned.
+  void BeginSearchPrompt(bool backward);
+  void UpdateIncrementalSearch();
+  void AcceptSearch();
+  void CancelSearchPrompt();
+  bool InSearchPrompt() const noexcept;
+  void StartSearch(std::shared_ptr<const Pattern> pattern, TextPosition from,
+                   bool backward, std::size_t count);
+  void RepeatSearch(bool reverse_direction, std::size_t count);
+  void ApplySearchResult(const SearchResult& result);
 
-  void ResetCount() noexcept;
-  std::size_t ConsumeCountOr(std::size_t fallback) noexcept;
   bool CopyLineRange(std::size_t start_line, std::size_t line_count);
   bool CopyCharacterRange(std::size_t start_line, std::size_t start_column,
                           std::size_t end_line, std::size_t end_column);
-  bool PasteAfterCursor();
-  bool HasYank() const noexcept;
+  // Puts the register in `count` times over, as one edit.
+  bool PasteAfterCursor(std::size_t count);
+  // Puts a block's lines after the cursor's column on the lines from the
+  // cursor's down, adding lines past the end as needed; each line of it is
+  // repeated `count` times across.
+  bool PasteBlock(const RegisterContent& content, TextPosition cursor,
+                  std::size_t count);
+  // The register named by a `"x` prefix, or 0; selecting one lasts until
+  // the next yank, delete or paste.
+  char TakeRegister() noexcept;
   std::size_t DeleteLineRange(std::size_t start_line, std::size_t line_count);
   bool DeleteCharacterRange(std::size_t start_line, std::size_t start_column,
                             std::size_t end_line, std::size_t end_column);
 
   EditorState& state_;
   InputHandler& command_handler_;
+  PluginHost& plugin_host_;
   Registry& registry_;
+  // Compiled from the registry and rebuilt when its version moves on, so a
+  // key is dispatched without locking it or copying its records.
+  std::shared_ptr<const Keymap> keymap_;
+  ChordResolver chord_;
+  // Reused for every binding run on this thread.
+  CommandInvocation invocation_;
   std::string command_buffer_;
-  std::string pending_normal_command_;
-  char last_find_target_ = 0;
-  bool has_last_find_ = false;
-  bool last_find_backward_ = false;
-  bool last_find_till_ = false;
-  std::size_t prefix_count_ = 0;
-  std::size_t motion_count_ = 0;
-  bool has_prefix_count_ = false;
-  bool has_motion_count_ = false;
-  std::vector<std::string> yank_buffer_;
-  bool yank_linewise_ = false;
+  // The bytes so far of a character being typed in insert mode.
+  std::string pending_utf8_;
+  std::optional<FindTarget> last_find_;
+  std::optional<BlockInsert> block_insert_;
+  char selected_register_ = 0;
+  char command_prefix_ = ':';
+  Searcher searcher_;
+  std::shared_ptr<const Pattern> last_search_;
+  bool last_search_backward_ = false;
+  std::shared_ptr<const Pattern> prompt_pattern_;
+  std::string prompt_error_;
+  TextPosition search_origin_;
+  std::shared_ptr<const Pattern> running_search_;
+  bool running_backward_ = false;
+  std::uint64_t running_buffer_ = 0;
   std::vector<RegistrationHandle> registry_handles_;
 };
 }  // namespace core
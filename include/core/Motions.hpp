@@ -0,0 +1,311 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "core/TextPosition.hpp"
+
+namespace core {
+class Buffer;
+
+// The cursor motions over words and paragraphs, as vi has them. Each takes
+// the position the cursor is at, clamped into the buffer first, and returns
+// where the motion ends; a buffer that has no lines leaves it where it is.
+
+TextPosition ClampPosition(const Buffer& buffer, TextPosition position);
+
+// w and W: the start of the next word, or the end of the buffer.
+TextPosition NextWordStart(const Buffer& buffer, TextPosition position);
+TextPosition NextBigWordStart(const Buffer& buffer, TextPosition position);
+// b and B: the start of this word, or of the one before.
+TextPosition PreviousWordStart(const Buffer& buffer, TextPosition position);
+TextPosition PreviousBigWordStart(const Buffer& buffer,
+                                  TextPosition position);
+// e and E: the last grapheme of the word from here on.
+TextPosition WordEndInclusive(const Buffer& buffer, TextPosition position);
+TextPosition BigWordEndInclusive(const Buffer& buffer, TextPosition position);
+
+std::size_t FirstNonBlankColumn(std::string_view line);
+std::size_t LastNonBlankColumn(std::string_view line);
+TextPosition FirstNonBlankPosition(const Buffer& buffer, std::size_t line);
+TextPosition LastNonBlankPosition(const Buffer& buffer, std::size_t line);
+
+// } and {: the first line after a blank one, below or above.
+TextPosition NextParagraphStart(const Buffer& buffer, TextPosition position);
+TextPosition PreviousParagraphStart(const Buffer& buffer,
+                                    TextPosition position);
+// The last non-blank of the paragraph's last line.
+TextPosition ParagraphEndInclusive(const Buffer& buffer,
+                                   TextPosition position);
+
+// What f, F, t or T looked for, for ; and , to look again.
+struct FindTarget {
+  char target = 0;
+  bool backward = false;
+  bool till = false;
+};
+
+// The column of the `count`th `find.target` from `column` within `line`,
+// not counting the character at `column`; where f or F lands. Till stops
+// one grapheme short, as t and T do.
+std::optional<std::size_t> FindInLine(std::string_view line,
+                                      std::size_t column,
+                                      const FindTarget& find,
+                                      std::size_t count);
+
+// How an operator takes the text a motion moves over.
+enum class MotionKind : std::uint8_t {
+  // Up to where it ends.
+  kExclusive,
+  // The grapheme it ends on too.
+  kInclusive,
+  // Every line from where it starts to where it ends.
+  kLinewise,
+};
+
+// The span of a motion: it runs from the cursor, and a text object will
+// move `from` as well.
+struct MotionResult {
+  TextPosition from;
+  TextPosition to;
+  MotionKind kind = MotionKind::kExclusive;
+};
+
+// What a motion reads and keeps besides the buffer.
+struct MotionContext {
+  Buffer& buffer;
+  // Set by f, F, t and T, and read by ; and ,.
+  std::optional<FindTarget>& last_find;
+  // When Apply() returns nullopt, why; empty for a failure that says
+  // nothing.
+  std::string_view failure;
+};
+
+// Each motion is a type, so that ModeController instantiates every
+// operator over it as a function of its own (see its OperatorTable):
+//
+//   kName, kLabel  the motion's part of the command ids and labels
+//   kKeys          its gestures, separated by blanks
+//   kKeepsColumn   a linewise motion that, moving the cursor, keeps the
+//                  display column it is in
+//   Apply()        the span from `from`; `count` is zero when none was typed
+//                  and `operand` the key typed for <Char>
+//
+// A text object is the same, with Apply() moving `from` too.
+struct LeftMotion {
+  static constexpr std::string_view kName = "left";
+  static constexpr std::string_view kLabel = "Left";
+  static constexpr std::string_view kKeys = "h <Left>";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct RightMotion {
+  static constexpr std::string_view kName = "right";
+  static constexpr std::string_view kLabel = "Right";
+  static constexpr std::string_view kKeys = "l <Right>";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct DownMotion {
+  static constexpr std::string_view kName = "down";
+  static constexpr std::string_view kLabel = "Down";
+  static constexpr std::string_view kKeys = "j <Down>";
+  static constexpr bool kKeepsColumn = true;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct UpMotion {
+  static constexpr std::string_view kName = "up";
+  static constexpr std::string_view kLabel = "Up";
+  static constexpr std::string_view kKeys = "k <Up>";
+  static constexpr bool kKeepsColumn = true;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+// _, which dd and yy stand for: `count` lines from the cursor's.
+struct LineMotion {
+  static constexpr std::string_view kName = "line";
+  static constexpr std::string_view kLabel = "Line";
+  static constexpr std::string_view kKeys = "_";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct LineStartMotion {
+  static constexpr std::string_view kName = "line_start";
+  static constexpr std::string_view kLabel = "to Line Start";
+  static constexpr std::string_view kKeys = "0";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct FirstNonBlankMotion {
+  static constexpr std::string_view kName = "first_non_blank";
+  static constexpr std::string_view kLabel = "to First Non-Blank";
+  static constexpr std::string_view kKeys = "^";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+// $: the end of the line `count` - 1 lines down.
+struct LineEndMotion {
+  static constexpr std::string_view kName = "line_end";
+  static constexpr std::string_view kLabel = "to Line End";
+  static constexpr std::string_view kKeys = "$";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct WordMotion {
+  static constexpr std::string_view kName = "word";
+  static constexpr std::string_view kLabel = "Word";
+  static constexpr std::string_view kKeys = "w";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct BigWordMotion {
+  static constexpr std::string_view kName = "big_word";
+  static constexpr std::string_view kLabel = "WORD";
+  static constexpr std::string_view kKeys = "W";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct WordBackMotion {
+  static constexpr std::string_view kName = "word_back";
+  static constexpr std::string_view kLabel = "Word Back";
+  static constexpr std::string_view kKeys = "b";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct BigWordBackMotion {
+  static constexpr std::string_view kName = "big_word_back";
+  static constexpr std::string_view kLabel = "WORD Back";
+  static constexpr std::string_view kKeys = "B";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct WordEndMotion {
+  static constexpr std::string_view kName = "word_end";
+  static constexpr std::string_view kLabel = "to Word End";
+  static constexpr std::string_view kKeys = "e";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct BigWordEndMotion {
+  static constexpr std::string_view kName = "big_word_end";
+  static constexpr std::string_view kLabel = "to WORD End";
+  static constexpr std::string_view kKeys = "E";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct ParagraphForwardMotion {
+  static constexpr std::string_view kName = "paragraph_forward";
+  static constexpr std::string_view kLabel = "Paragraph Forward";
+  static constexpr std::string_view kKeys = "}";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+struct ParagraphBackMotion {
+  static constexpr std::string_view kName = "paragraph_back";
+  static constexpr std::string_view kLabel = "Paragraph Back";
+  static constexpr std::string_view kKeys = "{";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+// gg: line `count`, the first without one.
+struct FirstLineMotion {
+  static constexpr std::string_view kName = "first_line";
+  static constexpr std::string_view kLabel = "to First Line";
+  static constexpr std::string_view kKeys = "gg";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+// G: line `count`, the last without one.
+struct GoToLineMotion {
+  static constexpr std::string_view kName = "goto_line";
+  static constexpr std::string_view kLabel = "to Line";
+  static constexpr std::string_view kKeys = "G";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+template <bool kBackward, bool kTill>
+struct FindMotion {
+  static constexpr std::string_view kName =
+      kBackward ? (kTill ? "till_backward" : "find_backward")
+                : (kTill ? "till_forward" : "find_forward");
+  static constexpr std::string_view kLabel =
+      kBackward ? (kTill ? "Till Backward" : "Find Backward")
+                : (kTill ? "Till Forward" : "Find Forward");
+  static constexpr std::string_view kKeys =
+      kBackward ? (kTill ? "T<Char>" : "F<Char>")
+                : (kTill ? "t<Char>" : "f<Char>");
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+
+// ; and ,: the last find again, in the other direction for ,.
+template <bool kReverse>
+struct RepeatFindMotion {
+  static constexpr std::string_view kName =
+      kReverse ? "repeat_find_reverse" : "repeat_find";
+  static constexpr std::string_view kLabel =
+      kReverse ? "Repeat Find Reversed" : "Repeat Find";
+  static constexpr std::string_view kKeys = kReverse ? "," : ";";
+  static constexpr bool kKeepsColumn = false;
+  static std::optional<MotionResult> Apply(MotionContext& context,
+                                           TextPosition from,
+                                           std::size_t count, char operand);
+};
+}  // namespace core
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/LineScanner.hpp"
+#include "io/WindowedFile.hpp"
+
+namespace core {
+// A file too big to load, read where it is. A background scan keeps the
+// offset of one line in every kCheckpointLines; the starts of the lines
+// around the ones asked for are found from the nearest checkpoint, and their
+// text is read through a WindowedFile. What is held stays the same however
+// big the file is: the checkpoints, the starts of two blocks and the mapped
+// windows.
+//
+// The scan may be running on its own thread, but Sync(), LineCount() and
+// Line() are for one thread only. The rest may be called from any thread,
+// each with a WindowedFile of its own.
+class PagedText {
+ public:
+  static constexpr std::size_t kCheckpointLines = 65536;
+  // Only this much of a longer line is read.
+  static constexpr std::size_t kMaxLineBytes = 1024 * 1024;
+
+  PagedText() = default;
+  ~PagedText();
+
+  PagedText(const PagedText&) = delete;
+  PagedText& operator=(const PagedText&) = delete;
+  PagedText(PagedText&&) = delete;
+  PagedText& operator=(PagedText&&) = delete;
+
+  // Starts the scan, and waits for it until the first `sync_lines` lines are
+  // known.
+  bool Open(const std::string& file_path, std::size_t sync_lines);
+
+  // Picks up the lines the scan has found. Returns true once it has finished
+  // and every line has been picked up.
+  bool Sync();
+  // Blocks until the scan has found `lines` lines, or it has finished.
+  void Wait(std::size_t lines);
+  bool IsScanning() const noexcept;
+
+  // Lines picked up by Sync(); at least one.
+  std::size_t LineCount() const noexcept;
+  // Without its line break. The view stays valid until lines far from it
+  // have been read; see WindowedFile::Read().
+  std::string_view Line(std::size_t index);
+
+  const std::string& Path() const noexcept;
+  std::uint64_t Size() const noexcept;
+  // The first line ending decides, as it does for a loaded file.
+  LineEnding GetLineEnding() const noexcept;
+  bool HasFinalNewline() const noexcept;
+  // Complete once the scan has finished.
+  const TextStats& Stats() const noexcept;
+
+  // The offset of the start of `line`, which the scan must have found.
+  std::uint64_t LineStart(std::size_t line, WindowedFile& file) const;
+  // The line `offset` is in, counted from the nearest checkpoint before it.
+  std::size_t LineAt(std::uint64_t offset, WindowedFile& file) const;
+  // Where the line from `start` on ends, before its line break; `next`
+  // receives the start of the line after it, or Size() for the last.
+  std::uint64_t LineEnd(std::uint64_t start, WindowedFile& file,
+                        std::uint64_t* next = nullptr) const;
+  // The start of the line the byte at `offset` is in, its line break being
+  // part of it.
+  std::uint64_t LineStartAt(std::uint64_t offset, WindowedFile& file) const;
+  // The text of [start, end), clipped to kMaxLineBytes and without a
+  // carriage return when the line ending is CRLF.
+  std::string_view LineText(std::uint64_t start, std::uint64_t end,
+                            WindowedFile& file) const;
+
+  // The checkpoints, line starts and windows held.
+  std::size_t MemoryUsage() const noexcept;
+
+ private:
+  // The starts of the lines of one checkpoint block, and of the line after
+  // its last; the file's size + 1 stands for that when the last line of the
+  // file has no line break.
+  struct Block {
+    std::size_t index = SIZE_MAX;
+    std::uint64_t last_used = 0;
+    std::vector<std::uint64_t> starts;
+  };
+
+  void Run(const std::stop_token& token);
+  std::uint64_t Checkpoint(std::size_t block) const;
+  Block& LoadBlock(std::size_t block);
+
+  std::string path_;
+  std::uint64_t size_ = 0;
+  LineEnding line_ending_ = LineEnding::kLf;
+  bool final_newline_ = false;
+
+  mutable std::mutex mutex_;
+  std::condition_variable found_changed_;
+  // checkpoints_[i] is the offset of line i * kCheckpointLines.
+  std::vector<std::uint64_t> checkpoints_;
+  // Line breaks found so far.
+  std::uint64_t breaks_found_ = 0;
+  std::atomic<bool> finished_{false};
+  TextStats stats_;
+
+  std::size_t line_count_ = 1;
+  bool synced_ = false;
+  WindowedFile file_;
+  Block blocks_[2];
+  std::uint64_t use_clock_ = 0;
+  std::jthread scanner_;
+};
+}  // namespace core
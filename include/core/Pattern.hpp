@@ -0,0 +1,81 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+struct PatternMatch {
+  std::size_t start = 0;
+  std::size_t length = 0;
+};
+
+// A compiled search pattern, matched one line at a time. Text without special
+// characters is a literal, found with a memchr scan for its first byte.
+// Anything else is an extended regular expression (. [] * + ? | () ^ $, with
+// \d \w \s and \ to escape) run as a Thompson NFA, so matching costs
+// O(text x pattern) and never backtracks.
+class Pattern {
+ public:
+  Pattern() = default;
+
+  // Returns false and describes the problem in `error` when `source` is not a
+  // valid pattern.
+  bool Compile(std::string_view source, std::string& error);
+
+  const std::string& Source() const noexcept;
+  bool IsLiteral() const noexcept;
+
+  // The leftmost-longest match starting at or after `from`. Safe to call
+  // from several threads at once.
+  bool Find(std::string_view line, std::size_t from, PatternMatch& match) const;
+  // The match with the last start before `before`.
+  bool FindLast(std::string_view line, std::size_t before,
+                PatternMatch& match) const;
+  // For literals: the first occurrence at or after `from` in `text`, which
+  // may hold several lines, or npos.
+  std::size_t FindLiteral(std::string_view text,
+                          std::size_t from) const noexcept;
+
+ private:
+  class Compiler;
+
+  enum class Op : std::uint8_t {
+    kByte,
+    kAny,
+    kClass,
+    kSplit,
+    kJump,
+    kLineStart,
+    kLineEnd,
+    kMatch,
+  };
+
+  // kSplit continues at both `next` and `alternate`; kJump at `next`; kClass
+  // tests classes_[next].
+  struct Instruction {
+    Op op = Op::kMatch;
+    unsigned char byte = 0;
+    std::uint32_t next = 0;
+    std::uint32_t alternate = 0;
+  };
+
+  bool FindRegex(std::string_view line, std::size_t from,
+                 PatternMatch& match) const;
+  bool Accepts(const Instruction& instruction, unsigned char value) const;
+  void ComputeFirstBytes();
+
+  std::string source_;
+  std::string literal_;
+  bool is_literal_ = false;
+  std::vector<Instruction> program_;
+  std::vector<std::bitset<256>> classes_;
+  // Bytes a match can begin with, used to skip ahead when no thread is
+  // alive; unused when the pattern can match the empty string.
+  std::bitset<256> first_bytes_;
+  bool has_first_bytes_ = false;
+};
+}  // namespace core
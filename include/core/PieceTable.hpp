@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/LineScanner.hpp"
+
+namespace core {
+class LineSlice;
+
+// The document frozen for reading on another thread: its lines as runs of
+// text, which keep the bytes they point into alive. Lines inside a run are
+// separated by '\n', or by "\r\n" when `crlf` is set.
+struct TextSnapshot {
+  struct Run {
+    std::string_view text;
+    std::size_t first_line = 0;
+    std::size_t lines = 0;
+    bool crlf = false;
+  };
+
+  // The start of a line: `offset` bytes into runs[run].
+  struct Cursor {
+    std::size_t run = 0;
+    std::size_t offset = 0;
+    std::size_t line = 0;
+  };
+
+  // Costs O(log runs) plus a scan over the lines before `line` in its run.
+  Cursor Locate(std::size_t line) const;
+  // The line at `cursor`, without its separator.
+  std::string_view LineAt(const Cursor& cursor) const;
+  // Moves to the following line; returns false from the last one.
+  bool Next(Cursor& cursor) const;
+
+  std::vector<Run> runs;
+  std::size_t line_count = 0;
+  std::size_t bytes = 0;
+  std::shared_ptr<const void> sources;
+  std::shared_ptr<const void> owner;
+};
+
+// Line-oriented piece table. The document is a sequence of pieces, each naming
+// a run of whole lines in one of two sources: the immutable original text, or
+// an append-only arena that receives every inserted or edited line. Pieces are
+// kept in an implicit treap keyed by line count, so locating, inserting and
+// removing lines costs O(log pieces) and the original bytes are never copied.
+class PieceTable {
+ public:
+  using RunVisitor = std::function<void(std::string_view)>;
+
+  PieceTable();
+
+  // Adopts `original` as the immutable source text. `owner` keeps the bytes
+  // alive (an owned string or a file mapping). No lines are visible until
+  // their starts are supplied through AppendOriginalLines().
+  void Load(std::string_view original, std::shared_ptr<const void> owner);
+  void Clear();
+
+  // Extends the original line index with the starts of the lines following
+  // the last indexed one; the newly complete lines are appended to the end of
+  // the document. FinishOriginal() closes a trailing unterminated line.
+  void AppendOriginalLines(std::span<const std::uint64_t> starts);
+  void FinishOriginal();
+  // The starts of the original lines after the first, as supplied to
+  // AppendOriginalLines(); `owner` keeps them alive. Once FinishOriginal()
+  // has been called they no longer change, and another thread may read them.
+  std::span<const std::uint64_t> OriginalLineStarts(
+      std::shared_ptr<const void>& owner) const;
+  // Copies the original text into memory so its backing file can change.
+  void DetachOriginal();
+  // With kCrLf, original lines ending in "\r\n" are presented without the
+  // carriage return.
+  void SetLineEnding(LineEnding ending) noexcept;
+
+  std::size_t LineCount() const noexcept;
+  std::string_view Line(std::size_t index) const;
+  // Bytes held for the line index, the arena and the tree; the original text
+  // counts only with `count_original`, as a file mapping costs no memory
+  // that the kernel cannot take back.
+  std::size_t MemoryUsage(bool count_original) const noexcept;
+
+  void InsertLine(std::size_t index, std::string_view text);
+  // Inserts the lines as one piece, so a batch costs a single tree node.
+  void InsertLines(std::size_t index, std::span<const std::string_view> lines);
+  // Slices share the table's text instead of copying it. Inserting a slice
+  // taken from the same table only links its pieces back in.
+  LineSlice Extract(std::size_t index, std::size_t count);
+  void InsertSlice(std::size_t index, const LineSlice& slice);
+  void EraseLines(std::size_t index, std::size_t count);
+  void ReplaceLine(std::size_t index, std::string_view text);
+  void InsertChar(std::size_t index, std::size_t column, char value);
+  void EraseChar(std::size_t index, std::size_t column);
+
+  // Visits the document as contiguous runs of lines, in order. Lines inside a
+  // run keep their original separators; consecutive runs must be joined with
+  // one.
+  void ForEachRun(const RunVisitor& visit) const;
+  // Costs O(pieces + edited lines). A run starts at `split_line`, so a scan
+  // can begin there without counting the lines before it.
+  TextSnapshot Snapshot(std::size_t split_line);
+
+  // Whether the tree is a valid treap: no node outranks its parent and every
+  // line count adds up. The O(log pieces) bounds rest on it.
+  bool CheckTree() const;
+  // The number of nodes on the longest path from the root.
+  std::size_t TreeDepth() const;
+
+ private:
+  friend class LineSlice;
+
+  using NodeIndex = std::uint32_t;
+  static constexpr NodeIndex kNil = ~NodeIndex{0};
+
+  enum class Source : std::uint8_t {
+    kOriginal,
+    kAdded,
+  };
+
+  struct Piece {
+    Source source = Source::kOriginal;
+    std::size_t first = 0;
+    std::size_t count = 0;
+  };
+
+  struct Node {
+    Piece piece;
+    std::uint32_t priority = 0;
+    NodeIndex left = kNil;
+    NodeIndex right = kNil;
+    std::size_t lines = 0;
+  };
+
+  struct AddedLine {
+    char* data = nullptr;
+    std::size_t size = 0;
+  };
+
+  // The bytes pieces point into. Load() starts a new one, so slices of the
+  // previous document keep theirs alive. Arena lines other than the tail
+  // line never change once written.
+  struct Sources {
+    std::string_view original;
+    std::shared_ptr<const void> owner;
+    LineEnding line_ending = LineEnding::kLf;
+    std::vector<std::uint64_t> line_starts{0};
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t block_bytes = 0;
+    std::vector<AddedLine> added;
+
+    std::string_view Line(const Piece& piece, std::size_t offset) const;
+    std::uint64_t OriginalLineEnd(std::size_t line) const noexcept;
+  };
+
+  struct Location {
+    NodeIndex node = kNil;
+    std::size_t offset = 0;
+  };
+
+  NodeIndex NewNode(const Piece& piece);
+  void FreeTree(NodeIndex node);
+  std::size_t Lines(NodeIndex node) const noexcept;
+  void Update(NodeIndex node) noexcept;
+  NodeIndex Merge(NodeIndex left, NodeIndex right);
+  void Split(NodeIndex node, std::size_t count, NodeIndex& left,
+             NodeIndex& right);
+  void SplitNodes(NodeIndex node, std::size_t count, NodeIndex& left,
+                  NodeIndex& right, NodeIndex& tail);
+  Location Locate(std::size_t index) const;
+  bool CheckNode(NodeIndex node, std::uint32_t bound) const;
+  std::size_t Depth(NodeIndex node) const;
+  void CollectPieces(NodeIndex node, std::vector<Piece>& pieces) const;
+
+  std::size_t AppendLine(std::size_t size, std::size_t reserve);
+  char* ReserveTail(std::size_t size);
+  std::size_t EditableLine(std::size_t index);
+
+  void ExtendOriginal(std::size_t first, std::size_t count);
+
+  std::shared_ptr<Sources> sources_;
+  char* block_cursor_ = nullptr;
+  char* block_end_ = nullptr;
+  std::size_t tail_line_ = 0;
+  bool has_tail_line_ = false;
+  std::vector<Node> nodes_;
+  std::vector<NodeIndex> free_nodes_;
+  NodeIndex root_ = kNil;
+  std::uint32_t seed_ = 0x9E3779B9u;
+};
+
+// An immutable run of lines taken from a PieceTable. Copying a slice costs
+// O(pieces) whatever the size of the text, and it stays readable after the
+// table is edited, reloaded or destroyed.
+class LineSlice {
+ public:
+  using LineVisitor = std::function<void(std::string_view)>;
+
+  LineSlice() = default;
+  // Copies `lines` into a slice of its own.
+  static LineSlice FromLines(std::span<const std::string_view> lines);
+  // The lines of `first` followed by those of `second`.
+  static LineSlice Concat(const LineSlice& first, const LineSlice& second);
+  // The lines of `slice` `times` over, sharing its text.
+  static LineSlice Repeat(const LineSlice& slice, std::size_t times);
+
+  bool Empty() const noexcept { return lines_ == 0; }
+  std::size_t LineCount() const noexcept { return lines_; }
+  std::size_t PieceCount() const noexcept { return pieces_.size(); }
+  // Bytes of bookkeeping; the text itself is shared.
+  std::size_t MemoryUsage() const noexcept;
+  void ForEachLine(const LineVisitor& visit) const;
+
+ private:
+  friend class PieceTable;
+
+  std::shared_ptr<const PieceTable::Sources> sources_;
+  std::vector<PieceTable::Piece> pieces_;
+  std::size_t lines_ = 0;
+};
+}  // namespace core
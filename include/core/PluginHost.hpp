@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/Registry.hpp"
+
+namespace core {
+class EditorState;
+
+// Runs commands served by plugin processes, which speak the protocol in
+// io/RpcProtocol.hpp. Invoke() only queues a call: each plugin has an I/O
+// thread that writes every queued call in as few writes as the socket
+// takes and reads results as they come, so calls are pipelined and a slow
+// or stuck plugin never holds up the main loop. Poll() applies the results.
+// A call to a command that reads the buffer shares a snapshot of it, copied
+// once per revision into memory the plugin maps, instead of sending it.
+class PluginHost {
+ public:
+  // Calls to one plugin that may await results before more are refused.
+  static constexpr std::size_t kMaxInFlight = 256;
+
+  PluginHost();
+  ~PluginHost();
+
+  PluginHost(const PluginHost&) = delete;
+  PluginHost& operator=(const PluginHost&) = delete;
+  PluginHost(PluginHost&&) = delete;
+  PluginHost& operator=(PluginHost&&) = delete;
+
+  // Runs on a plugin's I/O thread whenever Poll() has something to apply;
+  // set it before loading plugins.
+  void SetWakeHook(std::function<void()> hook);
+
+  // Starts the plugin at `path`, whose commands are registered once it has
+  // introduced itself, with their callables naming `path` as the endpoint.
+  bool Load(const std::string& path, std::string& error);
+  // Queues a call to a command of the plugin at `endpoint`; when it cannot,
+  // says why on the status line and returns false.
+  bool Invoke(std::string_view endpoint, const CommandInvocation& invocation,
+              CommandCapabilityMask capabilities, EditorState& state);
+  // Registers the commands of plugins that have introduced themselves,
+  // applies results and drops plugins that have exited. Returns true when
+  // it changed the state.
+  bool Poll(EditorState& state);
+
+ private:
+  struct Plugin;
+  struct Incoming;
+
+  static void RunIo(Plugin& plugin, const std::stop_token& token);
+  static void Unload(Plugin& plugin);
+  static bool Greet(Plugin& plugin, Incoming& incoming, EditorState& state);
+  static bool Apply(Plugin& plugin, const Incoming& incoming,
+                    EditorState& state);
+  Plugin* Find(std::string_view endpoint) const noexcept;
+
+  std::function<void()> wake_hook_;
+  std::vector<std::unique_ptr<Plugin>> plugins_;
+  std::uint64_t next_call_ = 1;
+};
+}  // namespace core
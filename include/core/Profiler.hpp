@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+// The stretches of the hot path that are timed.
+enum class ProfileZone : std::uint8_t {
+  kHandleEvent,
+  kKeyLookup,
+  kCommand,
+  kCompose,
+  kFlush,
+  kLoad,
+  kSave,
+  kCount,
+};
+
+enum class ProfileCounter : std::uint8_t {
+  kFlushedBytes,
+  kLoadedBytes,
+  kSavedBytes,
+  kCount,
+};
+
+struct ProfileZoneStats {
+  std::uint64_t calls = 0;
+  std::chrono::nanoseconds total{0};
+  std::chrono::nanoseconds max{0};
+  std::chrono::nanoseconds last{0};
+};
+
+// Totals for the zones timed by MICROVI_PROFILE_SCOPE and the counters bumped
+// by MICROVI_PROFILE_COUNT, from any thread. Both macros compile to nothing
+// unless MICROVI_PROFILING is defined, which the build does for Debug or
+// with -DMICROVI_PROFILING=ON; the rest is there either way, and stays
+// empty. While a trace is on, every timed stretch is also kept, up to
+// kMaxTraceEvents, to be written as Chrome trace events (chrome://tracing,
+// Perfetto).
+class Profiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+#ifdef MICROVI_PROFILING
+  static constexpr bool kCompiledIn = true;
+#else
+  static constexpr bool kCompiledIn = false;
+#endif
+  static constexpr std::size_t kMaxTraceEvents = 1024 * 1024;
+
+  static Profiler& Shared();
+  static std::string_view ZoneName(ProfileZone zone) noexcept;
+
+  Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+  Profiler(Profiler&&) = delete;
+  Profiler& operator=(Profiler&&) = delete;
+
+  void Record(ProfileZone zone, Clock::time_point start,
+              Clock::time_point end);
+  void Count(ProfileCounter counter, std::uint64_t amount) noexcept;
+
+  ProfileZoneStats Zone(ProfileZone zone) const noexcept;
+  std::uint64_t Counter(ProfileCounter counter) const noexcept;
+  // Zeroes the totals and counters; a trace keeps its events.
+  void Reset() noexcept;
+  // Replaces `line` with the mean time of each zone that ran, in one row.
+  void Summarize(std::string& line) const;
+
+  // Starts keeping events, dropping any kept before.
+  void StartTrace();
+  bool IsTracing() const noexcept;
+  std::size_t TraceEvents() const;
+  // Writes the events kept as a Chrome trace JSON file and stops the trace.
+  bool WriteTrace(const std::string& path);
+
+ private:
+  struct ZoneTotals {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::int64_t> total{0};
+    std::atomic<std::int64_t> max{0};
+    std::atomic<std::int64_t> last{0};
+  };
+
+  struct TraceEvent {
+    ProfileZone zone = ProfileZone::kCount;
+    std::uint32_t thread = 0;
+    // Nanoseconds since epoch_.
+    std::int64_t start = 0;
+    std::int64_t duration = 0;
+  };
+
+  Clock::time_point epoch_;
+  std::array<ZoneTotals, static_cast<std::size_t>(ProfileZone::kCount)>
+      zones_;
+  std::array<std::atomic<std::uint64_t>,
+             static_cast<std::size_t>(ProfileCounter::kCount)>
+      counters_{};
+  std::atomic<bool> tracing_{false};
+  mutable std::mutex trace_mutex_;
+  std::vector<TraceEvent> trace_;
+};
+
+// Records the time from its construction to its destruction under `zone`.
+class ProfileScope {
+ public:
+  explicit ProfileScope(ProfileZone zone) noexcept
+      : zone_(zone), start_(Profiler::Clock::now()) {}
+  ~ProfileScope() {
+    Profiler::Shared().Record(zone_, start_, Profiler::Clock::now());
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+  ProfileScope(ProfileScope&&) = delete;
+  ProfileScope& operator=(ProfileScope&&) = delete;
+
+ private:
+  ProfileZone zone_;
+  Profiler::Clock::time_point start_;
+};
+}  // namespace core
+
+#ifdef MICROVI_PROFILING
+#define MICROVI_PROFILE_JOIN_(a, b) a##b
+#define MICROVI_PROFILE_JOIN(a, b) MICROVI_PROFILE_JOIN_(a, b)
+// Times the rest of the enclosing block as core::ProfileZone::zone.
+#define MICROVI_PROFILE_SCOPE(zone)                                \
+  const ::core::ProfileScope MICROVI_PROFILE_JOIN(kProfileScope, \
+                                                  __LINE__)(     \
+      ::core::ProfileZone::zone)
+#define MICROVI_PROFILE_COUNT(counter, amount)                           \
+  ::core::Profiler::Shared().Count(::core::ProfileCounter::counter, \
+                                   static_cast<std::uint64_t>(amount))
+#else
+#define MICROVI_PROFILE_SCOPE(zone) static_cast<void>(0)
+#define MICROVI_PROFILE_COUNT(counter, amount) static_cast<void>(0)
+#endif
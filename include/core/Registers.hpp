@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "core/PieceTable.hpp"
+
+namespace core {
+// What a register holds. Linewise contents share the buffer's pieces through
+// `lines`; characterwise contents keep their own copy in `text`, with '\n'
+// separating lines. Blockwise contents are kept as characterwise ones are,
+// a line of the block to each line of `text`.
+struct RegisterContent {
+  LineSlice lines;
+  std::string text;
+  bool linewise = false;
+  bool blockwise = false;
+};
+
+// The unnamed register, "a to "z, the yank register "0, the delete ring "1 to
+// "9 and the small delete register "-. Contents are shared and immutable, so
+// filling a register, rotating the ring or pasting moves no text.
+class Registers {
+ public:
+  using Content = std::shared_ptr<const RegisterContent>;
+
+  static constexpr char kUnnamed = '"';
+
+  // Names accepted after a `"` prefix; "A to "Z append to "a to "z.
+  static bool IsValidName(char name) noexcept;
+
+  // Stores a yank in `name` and the unnamed register. Without a name it also
+  // goes to "0.
+  void Yank(char name, RegisterContent content);
+  // Stores a delete in `name` and the unnamed register. Without a name,
+  // linewise and multi-line deletes shift the ring; smaller ones go to "-.
+  void Delete(char name, RegisterContent content);
+
+  // Returns null when the register is empty.
+  Content Get(char name) const;
+
+ private:
+  static constexpr std::size_t kRingSize = 9;
+
+  Content* Slot(char name) noexcept;
+  const Content* Slot(char name) const noexcept;
+  void Store(char name, Content content);
+
+  Content unnamed_;
+  Content yank_;
+  Content small_delete_;
+  std::array<Content, kRingSize> ring_;
+  std::array<Content, 26> named_;
+};
+}  // namespace core
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
@@ -15,6 +17,7 @@
 namespace core {
 
 struct CommandInvocation;
+class Keymap;
 
 enum class RegistryResourceKind : std::uint8_t {
   kCommand,
@@ -81,6 +84,18 @@ inline constexpr CommandCapability operator&(CommandCapability lhs,
 
 using CommandCapabilityMask = std::uint32_t;
 
+// Commands that reach only outside the editor, and never the buffer, run on
+// a worker thread so a slow disk, network or child process cannot stall
+// input.
+inline constexpr bool RunsOffThread(CommandCapabilityMask capabilities) {
+  constexpr auto kOutside = static_cast<CommandCapabilityMask>(
+      CommandCapability::kFilesystem | CommandCapability::kNetwork |
+      CommandCapability::kSpawnProcess);
+  constexpr auto kBuffer = static_cast<CommandCapabilityMask>(
+      CommandCapability::kReadBuffer | CommandCapability::kWriteBuffer);
+  return (capabilities & kOutside) != 0 && (capabilities & kBuffer) == 0;
+}
+
 struct Origin {
   RegistryOriginKind kind = RegistryOriginKind::kCore;
   std::string name;
@@ -120,6 +135,10 @@ struct CommandDescriptor {
 struct CommandInvocation {
   std::string command_id;
   std::unordered_map<std::string, std::string> arguments;
+  // From a key chord: the count typed with it, zero when none was, and the
+  // key typed for its <Char>.
+  std::size_t count = 0;
+  char operand = '\0';
 };
 
 struct CommandCallable {
@@ -221,6 +240,11 @@ struct RegistryEvent {
 using RegistrySubscriptionToken = std::uint64_t;
 using RegistryCallback = std::function<void(const RegistryEvent&)>;
 
+// Writers serialize on a mutex and publish an immutable snapshot of the
+// command and keybinding tables after every change. Each thread looks up in
+// its own reference to the latest snapshot and renews it, without locking,
+// on its first lookup after a change, so plugins and worker threads can
+// query the registry as often as they like without contending.
 class Registry {
  public:
   static Registry& Instance();
@@ -239,6 +263,9 @@ class Registry {
   std::optional<KeybindingRecord> ResolveKeybinding(
       KeybindingMode mode, std::string_view gesture) const;
   std::vector<KeybindingRecord> ListKeybindings() const;
+  // The active keybindings as of Version(), for dispatching keys without
+  // coming back to the registry.
+  std::shared_ptr<const Keymap> CompileKeymap() const;
 
   bool Unregister(const RegistrationHandle& handle);
 
@@ -274,6 +301,26 @@ class Registry {
 
   struct CommandResolution;
   struct KeybindingResolution;
+  struct Snapshot;
+  struct SubscriberList;
+
+  // An immutable value handed to readers that never lock. A reader counts
+  // itself in while it loads the pointer and takes a reference through
+  // shared_from_this(); the writer keeps each replaced value until it sees
+  // no reader counted in, so none is freed while one may still be reached.
+  template <typename Value>
+  class Published {
+   public:
+    // Called with mutex_ held.
+    void Publish(std::shared_ptr<const Value> value);
+    std::shared_ptr<const Value> Load() const;
+
+   private:
+    std::atomic<const Value*> current_{nullptr};
+    mutable std::atomic<std::size_t> readers_{0};
+    // The current value last, after any replaced ones still kept.
+    std::vector<std::shared_ptr<const Value>> kept_;
+  };
 
   CommandResolution ResolveCommandConflict(const CommandEntry& existing,
                                            const CommandEntry& incoming) const;
@@ -282,6 +329,12 @@ class Registry {
 
   void Notify(const RegistryEvent& event);
 
+  // Both called with mutex_ held, after a change.
+  void PublishSnapshot();
+  void PublishSubscribers();
+  // The calling thread's copy of the latest snapshot.
+  const Snapshot& CurrentSnapshot() const;
+
   void PromoteCommandShadow(const std::string& id);
   void PromoteKeybindingShadow(const std::string& binding_key);
 
@@ -302,6 +355,13 @@ class Registry {
   std::unordered_map<std::uint64_t, std::string> keybinding_token_to_key_;
   std::vector<ConflictRecord> conflicts_;
   std::unordered_map<RegistrySubscriptionToken, RegistryCallback> subscribers_;
+  // Reused from one snapshot to the next while their entry is unchanged.
+  std::unordered_map<std::uint64_t, std::shared_ptr<const CommandRecord>>
+      command_records_;
+  std::unordered_map<std::uint64_t, std::shared_ptr<const KeybindingRecord>>
+      keybinding_records_;
+  Published<Snapshot> snapshot_;
+  Published<SubscriberList> subscriber_list_;
   std::atomic<std::uint64_t> version_{1};
   std::uint64_t next_token_ = 1;
   std::uint64_t next_sequence_ = 1;
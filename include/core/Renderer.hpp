@@ -1,32 +1,146 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
+#include "core/Cursor.hpp"
+#include "core/Filetype.hpp"
+#include "core/FrameBuffer.hpp"
+#include "core/Highlighter.hpp"
+#include "core/LineLayout.hpp"
+#include "core/Pattern.hpp"
+#include "core/Selection.hpp"
 #include "core/Theme.hpp"
+#include "io/Terminal.hpp"
 
 namespace core {
+class Buffer;
 class EditorState;
 
+// Draws the editor by diffing against the rows it last sent: only rows whose
+// text changed are written, starting at the first changed column. Text rows
+// are rebuilt only when their buffer line is damaged or they scroll; when
+// the view moves down by less than a screen, as it does following a growing
+// file, the terminal scrolls the rows still in view and only those coming
+// into view are drawn. Frames are composed in reused buffers and sent with a
+// single write. Text rows are also rebuilt when the syntax state they start
+// in or the part of the visual selection they show changes, and all of them
+// when another buffer becomes current.
+//
+// A row shows only the display columns it has room for: lines are cut into
+// rows when wrapping and scroll sideways otherwise, and only the characters
+// in view are laid out, lexed and searched, through a LineLayout kept for
+// each long line on screen. Drawing a frame costs the same whatever the
+// length of the lines in it.
 class Renderer {
  public:
   Renderer();
 
   void Prepare();
   void Restore();
-  void Render(const EditorState& state, std::string_view command_buffer,
+  // Keeps the state's scroll offset following the cursor.
+  void Render(EditorState& state, std::string_view command_buffer,
               char command_prefix);
+  // Frames go to the terminal unless another sink is set; the sink must
+  // outlive the renderer, or the next SetSink().
+  void SetSink(TerminalSink& sink);
   void SetTheme(const Theme& theme);
   const Theme& GetTheme() const noexcept;
+  // Heap allocations made while composing frames; stays flat once the
+  // screen size and content widths have been seen.
+  std::uint64_t AllocationCount() const noexcept;
 
  private:
-  void UpdateScroll(const EditorState& state, std::size_t content_rows);
+  struct Row {
+    // Counts from the buffer's first line ever, so that lines dropped from
+    // the top (see Buffer::DroppedLines()) leave the rest matching.
+    std::size_t line = 0;
+    // The display column of the line the row starts at.
+    std::size_t column = 0;
+    // The line goes on in the next row; kept so that a row that is still
+    // right tells where the next line starts without laying it out.
+    bool continues = false;
+    bool cursor_line = false;
+    bool valid = false;
+    LexState syntax = 0;
+    SelectedBytes selected;
+    FrameBuffer text;
+  };
+
+  struct CachedLayout {
+    std::size_t line = 0;
+    LineLayout layout;
+  };
+
+  // Builds the frame in output_; returns false when there is nothing to
+  // send.
+  bool Compose(EditorState& state, std::string_view command_buffer,
+               char command_prefix);
+  // Drops layouts the buffer's damage or new settings made stale; returns
+  // true when every row must be drawn again.
+  bool SyncLayouts(const EditorState& state, std::size_t tabstop,
+                   std::size_t wrap_width);
+  // Valid until the next call.
+  LineLayout& LayoutOf(const Buffer& buffer, std::size_t line);
+  // Moves the viewport to keep the cursor in view and finds where on screen
+  // the cursor goes.
+  void UpdateScroll(EditorState& state, std::size_t content_rows,
+                    std::size_t text_width);
+  // Scrolls the first `content_rows` rows up, on screen and in rows_, when
+  // the row showing line `top` is still right and not at the top.
+  void ScrollRows(std::size_t top, std::size_t column,
+                  std::size_t content_rows);
+  void Invalidate();
+  std::uint64_t StorageGrowths() const noexcept;
+  // Fills glyphs_ with the characters of `line` in display columns [first,
+  // end). Returns the bytes they span.
+  std::size_t CollectGlyphs(std::string_view line, LineLayout& layout,
+                            std::size_t first, std::size_t end);
+  // Appends the cells of glyphs_ from column `first` on, control characters
+  // shown as ^X and tabs as blanks, with `tokens` colored, the matches of
+  // `pattern` colored over them and the `selected` bytes over both.
+  void AppendGlyphs(std::string_view line, std::size_t first, std::size_t end,
+                    const std::vector<TokenSpan>& tokens,
+                    const Pattern* pattern, const SelectedBytes& selected);
+  static void AppendRowUpdate(FrameBuffer& output, std::size_t row,
+                              std::string_view previous,
+                              std::string_view next);
 
   Theme theme_;
+  TerminalSink* sink_ = &ConsoleSink();
   bool prepared_ = false;
   bool first_render_ = true;
-  std::string previous_frame_;
-  std::size_t scroll_offset_ = 0;
+  FrameBuffer output_;
+  FrameBuffer scratch_;
+  std::vector<Row> rows_;
+  std::size_t rows_columns_ = 0;
+  std::size_t rows_digits_ = 0;
+  Cursor cursor_;
+  std::uint64_t allocations_ = 0;
+  std::uint64_t buffer_id_ = 0;
+  std::shared_ptr<const Pattern> highlight_;
+  const Filetype* filetype_ = nullptr;
+  // Layouts are built for this buffer, with these settings.
+  std::uint64_t layouts_buffer_ = 0;
+  std::size_t layout_tabstop_ = 0;
+  std::size_t layout_wrap_ = 0;
+  std::size_t layout_dropped_ = 0;
+  std::vector<CachedLayout> layouts_;
+  LineLayout layout_;
+  // Where a visual block falls on each row, laid out without wrapping.
+  LineLayout selection_layout_;
+  std::vector<LineLayout::Glyph> glyphs_;
+  // The cursor's place in the text area, from UpdateScroll().
+  std::size_t cursor_row_ = 0;
+  std::size_t cursor_cell_ = 0;
+  std::vector<TokenSpan> tokens_;
+  // Per visible byte: 0 for plain text, else a TokenKind or kSearchStyle.
+  std::vector<std::uint8_t> styles_;
+  // The :profile overlay, kept for its storage.
+  std::string profile_line_;
 };
 }  // namespace core
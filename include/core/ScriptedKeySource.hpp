@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/KeyEvent.hpp"
+#include "io/Waker.hpp"
+
+namespace core {
+// Keys from a script rather than the console, for replaying a session
+// without a terminal: Poll() and WaitForInput() as ConsoleKeySource has
+// them, handing out the keys Append() was given in order.
+class ScriptedKeySource {
+ public:
+  // `notation` as KeyNotation.hpp has it. Keys already handed out are let
+  // go, so the event last polled must have been handled.
+  void Append(std::string_view notation);
+
+  bool Poll(KeyEvent& event);
+  // Never blocks. Returns false once every key has been handed out, as the
+  // console does when the terminal hangs up.
+  bool WaitForInput(const Waker& interrupt) const;
+  std::size_t Pending() const noexcept;
+
+ private:
+  std::vector<KeyEvent> events_;
+  std::size_t next_ = 0;
+  std::deque<std::string> pastes_;
+};
+}  // namespace core
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+#include "core/PagedText.hpp"
+#include "core/Pattern.hpp"
+#include "core/PieceTable.hpp"
+#include "core/TextPosition.hpp"
+#include "io/WindowedFile.hpp"
+
+namespace core {
+struct SearchResult {
+  bool found = false;
+  // The search ran past one end of the document and continued at the other.
+  bool wrapped = false;
+  TextPosition position;
+  std::size_t length = 0;
+};
+
+// Finds the next match of a pattern in a snapshot of the buffer, or in a
+// paged file. Small snapshots are searched on the calling thread; larger
+// ones and paged files on a background thread, which the next Start() or
+// Cancel() stops.
+class Searcher {
+ public:
+  // Snapshots up to this size are searched without a thread.
+  static constexpr std::size_t kInlineBytes = 4 * 1024 * 1024;
+
+  Searcher() = default;
+  ~Searcher();
+
+  Searcher(const Searcher&) = delete;
+  Searcher& operator=(const Searcher&) = delete;
+  Searcher(Searcher&&) = delete;
+  Searcher& operator=(Searcher&&) = delete;
+
+  // Called on the worker thread when a background search finishes.
+  void SetWakeHook(std::function<void()> hook);
+
+  // Looks for the `count`th match after `from`, or before it when
+  // `backward`, wrapping around the document. Returns true when the result
+  // is already available from TakeResult().
+  bool Start(TextSnapshot snapshot, std::shared_ptr<const Pattern> pattern,
+             TextPosition from, bool backward, std::size_t count = 1);
+  // The same through a paged file, read a window at a time from the line
+  // `from` is on, which the file's scan must have found.
+  bool Start(std::shared_ptr<const PagedText> text,
+             std::shared_ptr<const Pattern> pattern, TextPosition from,
+             bool backward, std::size_t count = 1);
+  void Cancel();
+
+  // Moves out the result of a finished search, once.
+  bool TakeResult(SearchResult& result);
+  bool IsRunning() const noexcept;
+
+  // The search itself; gives up with no match when `token` is stopped.
+  static SearchResult Scan(const TextSnapshot& snapshot,
+                           const Pattern& pattern, TextPosition from,
+                           bool backward, const std::stop_token& token);
+  static SearchResult Scan(const PagedText& text, WindowedFile& file,
+                           const Pattern& pattern, TextPosition from,
+                           bool backward, const std::stop_token& token);
+
+ private:
+  using Search = std::function<SearchResult(const std::stop_token&)>;
+
+  void StartWorker(Search search);
+  void Finish(const SearchResult& result);
+
+  std::function<void()> wake_hook_;
+  std::mutex mutex_;
+  SearchResult result_;
+  bool ready_ = false;
+  std::atomic<bool> running_{false};
+  std::jthread worker_;
+};
+}  // namespace core
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "core/LineLayout.hpp"
+#include "core/TextPosition.hpp"
+
+namespace core {
+// The three visual modes: v, V and CTRL-V.
+enum class SelectionKind : std::uint8_t {
+  kCharacter,
+  kLine,
+  kBlock,
+};
+
+// What visual mode has selected, from its anchor to the cursor, with the
+// ends put in order. Characterwise, `end` is the last character selected,
+// or the end of its line when the cursor is there; a block covers the
+// display columns [left, right) of every line from start to end.
+//
+// After $, as vim's curswant of MAXCOL, `to_line_end` is set: a block then
+// runs from `left` to the end of each line, however long, and characterwise
+// the last line is taken with its break.
+struct Selection {
+  SelectionKind kind = SelectionKind::kCharacter;
+  TextPosition start;
+  TextPosition end;
+  std::size_t left = 0;
+  std::size_t right = 0;
+  bool to_line_end = false;
+
+  bool Covers(std::size_t line) const noexcept {
+    return line >= start.line && line <= end.line;
+  }
+  std::size_t LineCount() const noexcept { return end.line - start.line + 1; }
+};
+
+// The bytes [start, end) of one line that a selection covers, and whether
+// the line break after them goes with it.
+struct SelectedBytes {
+  std::size_t start = 0;
+  std::size_t end = 0;
+  bool line_break = false;
+
+  bool Empty() const noexcept { return start >= end && !line_break; }
+  bool operator==(const SelectedBytes& other) const = default;
+};
+
+// The part of line `line`, whose text is `text`, that `selection` covers.
+// A block is found in `layout`, which is reset to the line; only as much
+// of the line is laid out as the block reaches.
+SelectedBytes SelectedIn(const Selection& selection, std::size_t line,
+                         std::string_view text, std::size_t tabstop,
+                         LineLayout& layout);
+}  // namespace core
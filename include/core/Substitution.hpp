@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/Buffer.hpp"
+#include "core/Pattern.hpp"
+#include "core/PieceTable.hpp"
+
+namespace core {
+// The new text of every line a substitution changed, in line order. `changes`
+// points into `text`.
+struct SubstitutionResult {
+  bool finished = false;
+  std::vector<LineChange> changes;
+  std::size_t substitutions = 0;
+  std::vector<std::string> text;
+};
+
+// Computes a :s over a range of lines of a snapshot. Small ranges are handled
+// on the calling thread; larger ones are cut into chunks of whole lines that
+// worker threads claim one at a time, so the buffer stays usable meanwhile.
+class Substitution {
+ public:
+  // Snapshots up to this size are substituted without threads.
+  static constexpr std::size_t kInlineBytes = 4 * 1024 * 1024;
+  // Bytes of text each chunk covers.
+  static constexpr std::size_t kChunkBytes = 1024 * 1024;
+
+  Substitution() = default;
+  ~Substitution();
+
+  Substitution(const Substitution&) = delete;
+  Substitution& operator=(const Substitution&) = delete;
+  Substitution(Substitution&&) = delete;
+  Substitution& operator=(Substitution&&) = delete;
+
+  // Called on a worker thread when a background substitution finishes.
+  void SetWakeHook(std::function<void()> hook);
+
+  // Replaces the first match, or every match when `global`, in lines
+  // [first, last) with `replacement`, in which & stands for the match and a
+  // backslash escapes the next character. Returns true when the result is
+  // already available from TakeResult().
+  bool Start(TextSnapshot snapshot, std::shared_ptr<const Pattern> pattern,
+             std::string replacement, std::size_t first, std::size_t last,
+             bool global);
+  void Cancel();
+  // Blocks until a background substitution is done; its result is then
+  // available from TakeResult().
+  void Wait();
+
+  bool TakeResult(SubstitutionResult& result);
+  bool IsRunning() const noexcept;
+  // Lines examined so far out of the range being substituted.
+  std::size_t LinesDone() const noexcept;
+  std::size_t LinesTotal() const noexcept;
+
+  // Appends `line` with the substitution applied to `out`; returns the number
+  // of replacements made.
+  static std::size_t Apply(const Pattern& pattern, std::string_view replacement,
+                           bool global, std::string_view line,
+                           std::string& out);
+
+ private:
+  void Finish(SubstitutionResult result);
+
+  std::function<void()> wake_hook_;
+  std::mutex mutex_;
+  SubstitutionResult result_;
+  bool ready_ = false;
+  std::atomic<bool> running_{false};
+  std::atomic<std::size_t> lines_done_{0};
+  std::size_t lines_total_ = 0;
+  std::jthread worker_;
+};
+}  // namespace core
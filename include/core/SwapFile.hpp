@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/PieceTable.hpp"
+#include "core/TextPosition.hpp"
+#include "io/AppendFile.hpp"
+
+namespace core {
+// Enough of a file's metadata to tell whether it changed.
+struct FileStamp {
+  bool exists = false;
+  std::uint64_t size = 0;
+  std::int64_t modified = 0;
+
+  static FileStamp Of(const std::string& path);
+  bool operator==(const FileStamp&) const = default;
+};
+
+// An edit as a swap file keeps it: at `position`, `removed` bytes, each line
+// break counting one, were replaced by `text`. A line edit replaced
+// `removed` whole lines from position.line with the '\n'-separated lines of
+// `text`, `lines` of them. `revision` is the buffer's once it was made.
+struct SwapRecord {
+  std::uint64_t revision = 0;
+  bool whole_lines = false;
+  TextPosition position;
+  std::size_t removed = 0;
+  std::size_t lines = 0;
+  std::string text;
+};
+
+// The file a swap file's edits start from, and the edits.
+struct SwapContents {
+  FileStamp base;
+  std::vector<SwapRecord> records;
+};
+
+// Journals a buffer's edits to ".name.swp" beside its file, as Vim does, so
+// that they survive a crash. Recording only copies an edit into memory,
+// merging typing, backspacing and repeated deletes as UndoJournal does; a
+// writer thread waits kFlushInterval after the first edit it has not
+// written, then appends and fsyncs everything pending in one write. Once
+// MarkSaved() says a revision reached the file, the writer rewrites the
+// journal with only the edits made since.
+class SwapFile {
+ public:
+  static constexpr std::chrono::milliseconds kFlushInterval{250};
+
+  SwapFile() = default;
+  // Deletes the file, unless Preserve() was called.
+  ~SwapFile();
+
+  SwapFile(const SwapFile&) = delete;
+  SwapFile& operator=(const SwapFile&) = delete;
+  SwapFile(SwapFile&&) = delete;
+  SwapFile& operator=(SwapFile&&) = delete;
+
+  static std::string PathFor(const std::string& file_path);
+  // Reads a swap file; a record a crash cut short is dropped.
+  static bool Load(const std::string& swap_path, SwapContents& contents);
+
+  // Creates the swap file for edits to a file stamped `base`, replacing any
+  // already there, and starts the writer.
+  bool Open(const std::string& swap_path, const FileStamp& base);
+  const std::string& Path() const noexcept;
+
+  // Edits as UndoJournal records them, except that only the size of what
+  // was removed is kept; `revision` is the buffer's after the edit.
+  void Record(std::uint64_t revision, TextPosition position,
+              std::size_t removed, std::string_view inserted);
+  void RecordLines(std::uint64_t revision, std::size_t line,
+                   std::size_t removed, const LineSlice& inserted);
+  // Keeps the next edit from merging into those before it, so that a save
+  // taken now can tell them apart.
+  void Seal();
+  // The buffer as it was at `revision` is what a file stamped `base` holds.
+  void MarkSaved(std::uint64_t revision, const FileStamp& base);
+  // Writes out what is pending and stops, leaving the file for recovery.
+  void Preserve();
+
+ private:
+  struct Saved {
+    std::uint64_t revision = 0;
+    FileStamp base;
+  };
+
+  bool Merge(std::uint64_t revision, TextPosition position,
+             std::size_t removed, std::string_view inserted);
+  void Run(const std::stop_token& token);
+  void Stop();
+  void Write(std::vector<SwapRecord>& records,
+             const std::optional<Saved>& saved);
+  bool Rewrite(std::vector<SwapRecord>& records, const Saved& saved);
+
+  std::string path_;
+  // The writer's alone once it runs.
+  AppendFile file_;
+  bool failed_ = false;
+
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::vector<SwapRecord> pending_;
+  bool sealed_ = false;
+  std::optional<Saved> saved_;
+  bool preserve_ = false;
+  std::jthread writer_;
+};
+}  // namespace core
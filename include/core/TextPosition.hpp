@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <string_view>
+
+namespace core {
+// Zero-based line and byte column within a buffer.
+struct TextPosition {
+  std::size_t line = 0;
+  std::size_t column = 0;
+
+  auto operator<=>(const TextPosition&) const = default;
+};
+
+// Position just past `text`, with '\n' line breaks, inserted at `start`.
+inline TextPosition PositionAfter(TextPosition start, std::string_view text) {
+  const std::size_t kLastBreak = text.rfind('\n');
+  if (kLastBreak == std::string_view::npos) {
+    return {start.line, start.column + text.size()};
+  }
+  const auto kBreaks =
+      static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+  return {start.line + kBreaks, text.size() - kLastBreak - 1};
+}
+}  // namespace core
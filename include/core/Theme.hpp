@@ -7,6 +7,14 @@ struct Theme {
   std::string status_info;
   std::string status_warning;
   std::string status_error;
+  std::string search_match;
+  std::string selection;
+  std::string syntax_keyword;
+  std::string syntax_type;
+  std::string syntax_string;
+  std::string syntax_number;
+  std::string syntax_comment;
+  std::string syntax_preprocessor;
   std::string reset;
 };
 
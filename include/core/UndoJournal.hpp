@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/PieceTable.hpp"
+#include "core/TextPosition.hpp"
+
+namespace core {
+// Undo history as a list of edits, each one "at `position`, `removed` was
+// replaced by `inserted`", with '\n' separating lines in either text. The
+// bytes of every edit live in one append-only arena, so a change costs its
+// own size rather than a copy of the lines it touched. Whole-line edits keep
+// LineSlices instead, so deleting a large range copies no text at all.
+//
+// Edits are grouped into steps; a step is everything recorded between two
+// CloseStep() calls. Typing, backspacing over what was just typed and
+// repeated deletes at one position merge into a single edit. The oldest
+// steps are dropped once the history exceeds its byte or step limit.
+class UndoJournal {
+ public:
+  // Line edits replace `removed_lines` with `inserted_lines` at
+  // position.line and leave the texts empty.
+  struct Edit {
+    TextPosition position;
+    std::string_view removed;
+    std::string_view inserted;
+    const LineSlice* removed_lines = nullptr;
+    const LineSlice* inserted_lines = nullptr;
+  };
+
+  static constexpr std::size_t kDefaultByteLimit = 64 * 1024 * 1024;
+  static constexpr std::size_t kDefaultStepLimit = 10000;
+
+  explicit UndoJournal(std::size_t byte_limit = kDefaultByteLimit,
+                       std::size_t step_limit = kDefaultStepLimit);
+
+  // Forgets all history; the empty journal is the saved state.
+  void Clear() noexcept;
+
+  // Appends an edit to the open step, discarding anything that could have
+  // been redone.
+  void Record(TextPosition position, std::string_view removed,
+              std::string_view inserted);
+  void RecordLines(std::size_t line, LineSlice removed, LineSlice inserted);
+  void CloseStep() noexcept;
+
+  // Passes the edits of the newest step to `revert`, newest first, and moves
+  // it to the redo side. Returns false when there is nothing to undo.
+  template <typename Visitor>
+  bool Undo(Visitor&& revert);
+  // Passes the edits of the next undone step to `apply`, oldest first.
+  template <typename Visitor>
+  bool Redo(Visitor&& apply);
+
+  bool CanUndo() const noexcept;
+  bool CanRedo() const noexcept;
+
+  // Marks the current position as matching the file on disk.
+  void MarkSaved() noexcept;
+  bool AtSaved() const noexcept;
+
+  std::size_t StepCount() const noexcept;
+  // Arena and record storage in use.
+  std::size_t MemoryUsage() const noexcept;
+
+ private:
+  static constexpr std::size_t kNoStep = static_cast<std::size_t>(-1);
+  static constexpr std::size_t kNoLineEdit = static_cast<std::size_t>(-1);
+
+  struct Entry {
+    TextPosition position;
+    std::size_t offset = 0;
+    std::size_t removed = 0;
+    std::size_t inserted = 0;
+    std::size_t line_edit = kNoLineEdit;
+  };
+
+  struct LineEdit {
+    LineSlice removed;
+    LineSlice inserted;
+  };
+
+  Edit MakeEdit(const Entry& record) const noexcept;
+  std::size_t StepEnd(std::size_t step) const noexcept;
+  bool Coalesce(TextPosition position, std::string_view removed,
+                std::string_view inserted);
+  void OpenStep();
+  void DiscardRedo();
+  void Trim();
+  std::size_t LineEditsBefore(std::size_t record) const noexcept;
+
+  std::string bytes_;
+  std::vector<Entry> records_;
+  std::vector<LineEdit> line_edits_;
+  std::size_t line_edit_bytes_ = 0;
+  std::vector<std::size_t> step_starts_;
+  std::size_t applied_ = 0;
+  std::size_t saved_ = 0;
+  std::size_t byte_limit_;
+  std::size_t step_limit_;
+  bool open_ = false;
+};
+
+template <typename Visitor>
+bool UndoJournal::Undo(Visitor&& revert) {
+  open_ = false;
+  if (applied_ == 0) {
+    return false;
+  }
+
+  --applied_;
+  const std::size_t kFirst = step_starts_[applied_];
+  for (std::size_t index = StepEnd(applied_); index > kFirst; --index) {
+    revert(MakeEdit(records_[index - 1]));
+  }
+  return true;
+}
+
+template <typename Visitor>
+bool UndoJournal::Redo(Visitor&& apply) {
+  open_ = false;
+  if (applied_ == step_starts_.size()) {
+    return false;
+  }
+
+  const std::size_t kLast = StepEnd(applied_);
+  for (std::size_t index = step_starts_[applied_]; index < kLast; ++index) {
+    apply(MakeEdit(records_[index]));
+  }
+  ++applied_;
+  return true;
+}
+}  // namespace core
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace core {
+inline constexpr char32_t kReplacementCharacter = U'\uFFFD';
+
+inline constexpr bool IsUtf8Continuation(char value) noexcept {
+  return (static_cast<unsigned char>(value) & 0xC0) == 0x80;
+}
+
+// The size of the sequence `lead` starts, or 0 when it cannot start one.
+inline constexpr std::size_t Utf8SequenceLength(char lead) noexcept {
+  const auto kLead = static_cast<unsigned char>(lead);
+  if (kLead < 0x80) {
+    return 1;
+  }
+  if (kLead >= 0xC2 && kLead <= 0xDF) {
+    return 2;
+  }
+  if (kLead >= 0xE0 && kLead <= 0xEF) {
+    return 3;
+  }
+  return kLead >= 0xF0 && kLead <= 0xF4 ? 4 : 0;
+}
+
+// Decodes the character starting at `text[index]`; `length` receives its
+// size in bytes. A byte that does not start a well-formed sequence, overlong
+// and surrogate encodings included, decodes on its own as
+// kReplacementCharacter.
+char32_t DecodeUtf8(std::string_view text, std::size_t index,
+                    std::size_t& length) noexcept;
+// Cells a character takes on a terminal: 0 for combining marks and other
+// zero-width characters, 2 for East Asian wide and fullwidth characters and
+// emoji, 1 for the rest. Control characters are the caller's business.
+std::size_t CharacterWidth(char32_t character) noexcept;
+// Cells `text` takes, if it holds nothing but printable characters.
+std::size_t DisplayWidth(std::string_view text) noexcept;
+
+// The length of the run of printable ASCII that `text` starts with, where
+// every byte is a character, a grapheme and a cell. Scans 16 bytes at a time
+// with SSE2 or NEON where available.
+std::size_t PlainAsciiPrefix(std::string_view text) noexcept;
+
+// Graphemes as the cursor steps over them: a character with the combining
+// marks, variation selectors and emoji modifiers after it, and whatever a
+// zero-width joiner joins to it. No ASCII character extends another, so
+// on ASCII text these cost a byte comparison or two.
+//
+// The start of the grapheme after the one at `index`, or text.size().
+std::size_t NextGrapheme(std::string_view text, std::size_t index) noexcept;
+// The start of the grapheme holding `index`; text.size() past the end.
+std::size_t GraphemeStart(std::string_view text, std::size_t index) noexcept;
+// NextGrapheme() `count` times over, leaping runs of printable ASCII.
+std::size_t SkipGraphemes(std::string_view text, std::size_t index,
+                          std::size_t count) noexcept;
+
+// The class word motions compare, as in Vim: 0 for blanks, 1 for
+// punctuation and symbols, 2 for letters, digits and '_'. Ideographs, kana,
+// hangul, emoji and super- and subscripts each have a class of their own,
+// so a word also ends where the script changes.
+std::uint32_t WordClass(char32_t character) noexcept;
+}  // namespace core
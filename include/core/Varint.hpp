@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace core {
+// LEB128: seven bits a byte, low bits first, the top bit set on all but the
+// last byte. The swap file and the index cache store their numbers so.
+inline void AppendVarint(std::string& out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+// Returns false when `data` ends inside the number.
+inline bool ReadVarint(std::string_view data, std::size_t& index,
+                       std::uint64_t& value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64 && index < data.size(); shift += 7) {
+    const auto kByte = static_cast<unsigned char>(data[index++]);
+    value |= static_cast<std::uint64_t>(kByte & 0x7F) << shift;
+    if ((kByte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Zigzag, so that small negative numbers stay short.
+inline std::uint64_t ZigZag(std::int64_t value) noexcept {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         (value < 0 ? ~std::uint64_t{0} : std::uint64_t{0});
+}
+
+inline std::int64_t UnZigZag(std::uint64_t value) noexcept {
+  return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+}  // namespace core
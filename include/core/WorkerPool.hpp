@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace core {
+enum class TaskStatus : std::uint8_t {
+  kQueued,
+  kRunning,
+  kDone,
+  kCancelled,
+};
+
+// Work to run on a pool thread. It should return soon after `token` is
+// stopped, and must not touch the editor state.
+using TaskWork = std::function<void(const std::stop_token& token)>;
+// Runs on the thread that calls WorkerPool::RunCompletions(), with kDone or
+// kCancelled.
+using TaskCompletion = std::function<void(TaskStatus status)>;
+
+struct TaskState;
+
+// Refers to one submitted task. Copies refer to the same task; a default
+// constructed handle refers to none.
+class TaskHandle {
+ public:
+  TaskHandle() = default;
+
+  bool Valid() const noexcept;
+  TaskStatus Status() const noexcept;
+  // kDone or kCancelled; its completion has been posted by then.
+  bool Finished() const noexcept;
+  // Stops the task: a queued one never runs, a running one sees its token
+  // stopped. Returns false when it had already finished.
+  bool Cancel();
+  // Blocks until Finished().
+  void Wait() const;
+
+ private:
+  friend class WorkerPool;
+  explicit TaskHandle(std::shared_ptr<TaskState> state);
+
+  std::shared_ptr<TaskState> state_;
+};
+
+// A fixed set of threads shared by the whole editor, each with its own
+// queue. A thread takes its newest task first and, when its queue is empty,
+// steals the oldest task of another, so tasks that submit tasks keep their
+// data warm while idle threads still pick up the slack. Completions are
+// posted to a mailbox the main loop empties, which keeps every change to the
+// editor state on the main thread.
+class WorkerPool {
+ public:
+  using WakeHook = std::function<void()>;
+
+  static WorkerPool& Shared();
+
+  // `threads` of zero picks one per core, and at least two, since tasks such
+  // as saving mostly wait on I/O.
+  explicit WorkerPool(std::size_t threads = 0);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  WorkerPool& operator=(WorkerPool&&) = delete;
+
+  TaskHandle Submit(TaskWork work, TaskCompletion completion = {});
+  // Runs job(0) .. job(jobs - 1) on the calling thread and up to `helpers`
+  // pool threads, each claiming the next job left, and returns once all have
+  // run. The caller never waits for a helper that has not started, so a
+  // task may call it too without tying up the pool.
+  void ForEach(std::size_t jobs, std::size_t helpers,
+               const std::function<void(std::size_t)>& job);
+
+  // Called from a pool thread whenever a completion is posted, so a sleeping
+  // main loop can be woken to run it.
+  void SetWakeHook(WakeHook hook);
+  // Runs the completions posted so far, oldest first; returns how many.
+  std::size_t RunCompletions();
+
+  std::size_t ThreadCount() const noexcept;
+  std::uint64_t Steals() const noexcept;
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<TaskState>> tasks;
+  };
+
+  void Run(std::size_t index, const std::stop_token& token);
+  std::shared_ptr<TaskState> Take(std::size_t index);
+  void Execute(const std::shared_ptr<TaskState>& task);
+  void Post(const std::shared_ptr<TaskState>& task, TaskStatus status);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<std::size_t> next_worker_{0};
+  std::atomic<std::size_t> queued_{0};
+  std::atomic<std::uint64_t> steals_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable_any sleep_;
+
+  std::mutex completions_mutex_;
+  std::vector<std::function<void()>> completions_;
+  WakeHook wake_hook_;
+
+  // Last, so the threads stop before the queues they use go away.
+  std::vector<std::jthread> threads_;
+};
+}  // namespace core
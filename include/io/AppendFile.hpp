@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace core {
+// A file written only at its end, for journals that must reach the disk:
+// every Append() is written through to the file in full, and Sync() waits
+// until the file is durable. New files are readable by their owner only.
+class AppendFile {
+ public:
+  AppendFile() = default;
+  ~AppendFile();
+
+  AppendFile(const AppendFile&) = delete;
+  AppendFile& operator=(const AppendFile&) = delete;
+  AppendFile(AppendFile&&) = delete;
+  AppendFile& operator=(AppendFile&&) = delete;
+
+  // Opens `path` for appending, creating it if needed.
+  bool Open(const std::string& path);
+  void Close() noexcept;
+  bool IsOpen() const noexcept;
+
+  bool Append(std::string_view data);
+  bool Sync();
+
+ private:
+#ifdef _WIN32
+  void* handle_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+}  // namespace core
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+namespace core {
+// Writes a file by streaming spans into a temporary file next to the target,
+// then flushing it to disk and renaming it over the target, so a crash leaves
+// either the old or the new contents. Spans are gathered into writev batches
+// and must stay valid until the next Flush() or Commit().
+class AtomicFileWriter {
+ public:
+  AtomicFileWriter() = default;
+  ~AtomicFileWriter();
+
+  AtomicFileWriter(const AtomicFileWriter&) = delete;
+  AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+  AtomicFileWriter(AtomicFileWriter&&) = delete;
+  AtomicFileWriter& operator=(AtomicFileWriter&&) = delete;
+
+  bool Open(const std::string& target_path);
+  // Errors are latched: after a failure further appends are ignored and
+  // Commit() reports false.
+  void Append(std::string_view span);
+  bool Flush();
+  bool Commit();
+  void Abort() noexcept;
+
+  std::uint64_t BytesWritten() const noexcept;
+
+ private:
+  std::string target_path_;
+  std::string temp_path_;
+  std::uint64_t bytes_written_ = 0;
+  bool failed_ = false;
+#ifdef _WIN32
+  bool WriteAll(const char* data, std::size_t size);
+
+  void* handle_ = nullptr;
+  std::string staging_;
+#else
+  int fd_ = -1;
+  std::vector<iovec> batch_;
+#endif
+};
+}  // namespace core
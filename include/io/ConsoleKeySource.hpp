@@ -1,14 +1,23 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
 
 #include "core/KeyEvent.hpp"
+#include "io/Waker.hpp"
 
 #ifndef _WIN32
 #include <termios.h>
 #endif
 
 namespace core {
+// Reads the console in large chunks and decodes keys and escape sequences
+// from the buffered bytes. With bracketed paste, a paste is delivered as one
+// kPaste event. Keys come from the terminal itself (/dev/tty, or CONIN$ on
+// Windows) rather than standard input, which may be a pipe the document
+// arrives through.
 class ConsoleKeySource {
  public:
   ConsoleKeySource();
@@ -21,12 +30,37 @@ class ConsoleKeySource {
 
   KeyEvent Next();
   bool Poll(KeyEvent& event);
+  // Blocks until input may be available or `interrupt` is notified. Returns
+  // false when interrupted or when the terminal has hung up.
+  bool WaitForInput(const Waker& interrupt);
 
  private:
-#ifndef _WIN32
+#ifdef _WIN32
+  void* console_ = nullptr;
+#else
+  static constexpr std::size_t kInputBufferBytes = 64 * 1024;
+  // How long the rest of an escape sequence is waited for before what came
+  // is taken for itself, as vim's 'ttimeoutlen'.
+  static constexpr std::chrono::milliseconds kEscapeTimeout{50};
+
+  // Reads whatever is available; returns false when nothing was read.
+  bool Fill();
+  // As Fill(), but waits up to `timeout` for input when there is none yet.
+  bool FillWithin(std::chrono::milliseconds timeout);
+  std::size_t Available() const noexcept;
+  bool DecodeEscape(KeyEvent& event);
+  bool ContinuePaste(KeyEvent& event);
+
+  int fd_ = 0;
+  bool owns_fd_ = false;
   bool has_original_mode_ = false;
   termios original_{};
   int original_flags_ = -1;
+  std::unique_ptr<char[]> input_;
+  std::size_t input_begin_ = 0;
+  std::size_t input_end_ = 0;
+  bool in_paste_ = false;
+  std::string paste_;
 #endif
   int last_code_ = 0;
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "io/Waker.hpp"
+
+namespace core {
+enum class FileChange : std::uint8_t {
+  kNone,
+  // Written to, or truncated.
+  kModified,
+  // Renamed or deleted, and a file is at the path again, as when a log is
+  // rotated.
+  kReplaced,
+};
+
+// Tells when a file changes, from a thread of its own: inotify on Linux,
+// kqueue on macOS and the BSDs, and change notifications for its directory
+// on Windows. Where none of those is there, or while the file is gone, its
+// size and mtime are polled every kPollInterval. The hook runs on that
+// thread whenever Take() has something new.
+class FileWatcher {
+ public:
+  static constexpr std::chrono::milliseconds kPollInterval{500};
+
+  FileWatcher() = default;
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+  FileWatcher(FileWatcher&&) = delete;
+  FileWatcher& operator=(FileWatcher&&) = delete;
+
+  // Stops watching whatever was watched before.
+  void Watch(const std::string& path, std::function<void()> hook);
+  void Stop();
+  bool IsWatching() const noexcept;
+  const std::string& Path() const noexcept;
+
+  // The biggest change since the last call; kReplaced outranks kModified.
+  FileChange Take() noexcept;
+
+ private:
+  void Run(const std::stop_token& token);
+  // Returns false when the platform's notifications cannot be had.
+  bool RunNative(const std::stop_token& token);
+  void RunPolling(const std::stop_token& token);
+  void Post(FileChange change);
+
+  std::string path_;
+  std::function<void()> hook_;
+  std::atomic<std::uint8_t> pending_{0};
+  Waker stop_;
+  std::jthread thread_;
+};
+}  // namespace core
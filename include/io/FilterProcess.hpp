@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace core {
+// A shell command run as a filter, `/bin/sh -c command`, whose stdin, stdout
+// and stderr are one end of a Unix socket pair; as in vi, what it reports on
+// stderr counts as output. Input is written as it is produced and output is
+// passed on as it arrives, so neither is ever held whole here. Windows has
+// no filters yet: Start() fails there.
+class FilterProcess {
+ public:
+  static constexpr std::size_t kChunkBytes = 64 * 1024;
+
+  // Appends more input to its argument; returns false once there is no more.
+  using Source = std::function<bool(std::string&)>;
+  using Sink = std::function<void(std::string_view)>;
+
+  FilterProcess() = default;
+  // Kills the process if it is still running.
+  ~FilterProcess();
+
+  FilterProcess(const FilterProcess&) = delete;
+  FilterProcess& operator=(const FilterProcess&) = delete;
+  FilterProcess(FilterProcess&&) = delete;
+  FilterProcess& operator=(FilterProcess&&) = delete;
+
+  bool Start(const std::string& command);
+  // Feeds the process from `source` about kChunkBytes at a time, ending its
+  // input after the last, and gives `sink` everything it writes until it
+  // closes its output. A process that stops reading early gets no more.
+  void Run(const Source& source, const Sink& sink);
+  // Waits for the process to exit; returns its exit status, or -1 when it
+  // was killed or never started.
+  int Wait() noexcept;
+
+ private:
+  int fd_ = -1;
+  int pid_ = -1;
+};
+}  // namespace core
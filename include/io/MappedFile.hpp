@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace core {
+// Read-only view of a file, or of part of it, mapped into memory (mmap on
+// POSIX, CreateFileMapping on Windows). Empty files map to an empty view.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+  bool Open(const std::string& file_path);
+  // Maps up to `length` bytes from `offset` on, fewer where the file ends
+  // first. `offset` must be a multiple of the allocation granularity: the
+  // page size on POSIX, 64 KiB on Windows.
+  bool Open(const std::string& file_path, std::uint64_t offset,
+            std::size_t length);
+  void Close() noexcept;
+
+  std::string_view View() const noexcept;
+  std::size_t Size() const noexcept;
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+#ifdef _WIN32
+  void* mapping_ = nullptr;
+#endif
+};
+}  // namespace core
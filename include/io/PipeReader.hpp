@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "io/Waker.hpp"
+
+namespace core {
+// Reads standard input on a thread of its own, for a document piped in as
+// it is being written. Reading pauses while kMaxPendingBytes wait to be
+// drained, so a fast writer is held back rather than buffered. The hook
+// runs on that thread whenever Drain() has something new.
+class PipeReader {
+ public:
+  static constexpr std::size_t kChunkBytes = 64 * 1024;
+  static constexpr std::size_t kMaxPendingBytes = 4 * 1024 * 1024;
+
+  PipeReader() = default;
+  ~PipeReader();
+
+  PipeReader(const PipeReader&) = delete;
+  PipeReader& operator=(const PipeReader&) = delete;
+  PipeReader(PipeReader&&) = delete;
+  PipeReader& operator=(PipeReader&&) = delete;
+
+  // Returns false when standard input is a terminal, which is where keys
+  // come from rather than text.
+  bool Start(std::function<void()> hook);
+  void Stop();
+
+  // Appends what was read since the last call to `bytes`. Returns true once
+  // the pipe has closed and all it sent has been drained.
+  bool Drain(std::string& bytes);
+
+ private:
+  void Run(const std::stop_token& token);
+
+  std::function<void()> hook_;
+  std::mutex mutex_;
+  std::condition_variable_any drained_;
+  std::string pending_;
+  bool closed_ = false;
+  Waker stop_;
+  std::jthread thread_;
+};
+}  // namespace core
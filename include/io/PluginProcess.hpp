@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace core {
+// A child process whose stdin and stdout are one end of a Unix socket pair,
+// the other end of which is kept here in non-blocking mode. Its stderr goes
+// to /dev/null so it cannot draw over the editor. Windows has no plugin
+// processes yet: Start() fails there.
+class PluginProcess {
+ public:
+  PluginProcess() = default;
+  ~PluginProcess();
+
+  PluginProcess(const PluginProcess&) = delete;
+  PluginProcess& operator=(const PluginProcess&) = delete;
+  PluginProcess(PluginProcess&&) = delete;
+  PluginProcess& operator=(PluginProcess&&) = delete;
+
+  bool Start(const std::string& path);
+  // Closes the socket, which the plugin reads as the end of its input, and
+  // kills it if it has not exited shortly after.
+  void Stop() noexcept;
+
+  // For polling; -1 when not started.
+  int Fd() const noexcept;
+  // Sends what fits without blocking; `fd`, unless -1, travels with the
+  // first byte. Returns the bytes sent, 0 when the socket is full, or -1
+  // once the plugin has gone.
+  std::ptrdiff_t Send(std::string_view bytes, int fd = -1);
+  // Returns the bytes read, 0 when nothing is waiting, or -1 once the
+  // plugin has gone.
+  std::ptrdiff_t Receive(char* data, std::size_t size);
+
+ private:
+  int fd_ = -1;
+  int pid_ = -1;
+};
+}  // namespace core
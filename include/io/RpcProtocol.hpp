@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace core {
+// The wire format between the editor and a plugin process. Every message is
+// a frame: a u32 length, then that many bytes holding a u8 RpcMessageType
+// and the message's fields in order. Integers are little-endian; a string
+// is a u32 length and its bytes; a list is a u32 count and its items.
+//
+// A plugin starts by sending RpcHello. The editor then sends RpcInvoke for
+// each call, without waiting for earlier ones to be answered, and the plugin
+// answers each with an RpcResult naming the same call, in any order.
+//
+// The buffer's text never goes through the socket. A call to a command that
+// reads the buffer refers to the last shared memory file the editor sent:
+// the text, lines separated by the buffer's line ending, in its first
+// text_bytes bytes. The frame that carries a new file has it attached as
+// SCM_RIGHTS to its first byte, and `attaches_text` set.
+inline constexpr std::uint32_t kRpcProtocolVersion = 1;
+inline constexpr std::size_t kRpcMaxFrame = std::size_t{64} << 20;
+
+enum class RpcMessageType : std::uint8_t {
+  kHello = 1,
+  kInvoke = 2,
+  kResult = 3,
+};
+
+struct RpcCommandSpec {
+  std::string id;
+  std::string label;
+  // A CommandCapabilityMask; kReadBuffer has calls share the buffer.
+  std::uint32_t capabilities = 0;
+  // A normal-mode gesture, as for Keymap::Bind(); empty for none.
+  std::string gesture;
+};
+
+struct RpcHello {
+  std::uint32_t version = kRpcProtocolVersion;
+  std::string name;
+  std::vector<RpcCommandSpec> commands;
+};
+
+struct RpcInvoke {
+  std::uint64_t call = 0;
+  std::string command_id;
+  std::uint64_t count = 0;
+  char operand = '\0';
+  std::vector<std::pair<std::string, std::string>> arguments;
+  std::uint64_t revision = 0;
+  std::uint64_t cursor_line = 0;
+  std::uint64_t cursor_column = 0;
+  bool has_text = false;
+  bool attaches_text = false;
+  std::uint64_t text_bytes = 0;
+};
+
+struct RpcEdit {
+  std::uint64_t start_line = 0;
+  std::uint64_t start_column = 0;
+  std::uint64_t end_line = 0;
+  std::uint64_t end_column = 0;
+  std::string text;
+};
+
+enum class RpcSeverity : std::uint8_t {
+  kNone,
+  kInfo,
+  kWarning,
+  kError,
+};
+
+// Edits replace [start, end) in the buffer as it was at the call's revision,
+// and must not overlap; they are dropped if the buffer has changed since.
+struct RpcResult {
+  std::uint64_t call = 0;
+  RpcSeverity severity = RpcSeverity::kNone;
+  std::string message;
+  std::vector<RpcEdit> edits;
+};
+
+// Each appends one whole frame to `out`.
+void EncodeRpc(const RpcHello& message, std::string& out);
+void EncodeRpc(const RpcInvoke& message, std::string& out);
+void EncodeRpc(const RpcResult& message, std::string& out);
+
+// Each decodes a payload from RpcFrameReader::Next(); false if malformed.
+bool DecodeRpc(std::string_view payload, RpcHello& message);
+bool DecodeRpc(std::string_view payload, RpcInvoke& message);
+bool DecodeRpc(std::string_view payload, RpcResult& message);
+
+// Splits a byte stream into frames.
+class RpcFrameReader {
+ public:
+  void Append(std::string_view bytes);
+  // The next whole frame, if one has arrived; `payload` stays valid until
+  // the next Append().
+  bool Next(RpcMessageType& type, std::string_view& payload);
+  // Set for good once a frame is empty or longer than kRpcMaxFrame.
+  bool Malformed() const noexcept;
+
+ private:
+  std::string data_;
+  std::size_t consumed_ = 0;
+  bool malformed_ = false;
+};
+}  // namespace core
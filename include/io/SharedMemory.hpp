@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+namespace core {
+// An anonymous shared memory file mapped for writing, whose descriptor can
+// be sent to another process to map: a memfd on Linux, an unlinked POSIX
+// shared memory object elsewhere. Windows is not supported yet.
+class SharedMemory {
+ public:
+  SharedMemory() = default;
+  ~SharedMemory();
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+  SharedMemory(SharedMemory&&) = delete;
+  SharedMemory& operator=(SharedMemory&&) = delete;
+
+  bool Create(std::size_t size);
+  void Close() noexcept;
+
+  // Null when the size is zero.
+  char* Data() const noexcept;
+  std::size_t Size() const noexcept;
+  int Fd() const noexcept;
+
+ private:
+  char* data_ = nullptr;
+  std::size_t size_ = 0;
+  int fd_ = -1;
+};
+}  // namespace core
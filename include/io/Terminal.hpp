@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <string_view>
 
 namespace core {
 struct TerminalSize {
@@ -9,4 +10,25 @@ struct TerminalSize {
 };
 
 auto QueryTerminalSize() -> TerminalSize;
+// Writes `bytes` to standard output with direct system calls, bypassing the
+// iostream buffers. Returns false if the terminal went away.
+auto WriteToTerminal(std::string_view bytes) -> bool;
+
+// Where a Renderer sends its frames, and learns the size of the screen from.
+class TerminalSink {
+ public:
+  TerminalSink() = default;
+  virtual ~TerminalSink() = default;
+
+  TerminalSink(const TerminalSink&) = delete;
+  TerminalSink& operator=(const TerminalSink&) = delete;
+  TerminalSink(TerminalSink&&) = delete;
+  TerminalSink& operator=(TerminalSink&&) = delete;
+
+  virtual auto Size() -> TerminalSize = 0;
+  virtual auto Write(std::string_view bytes) -> bool = 0;
+};
+
+// The terminal itself, through QueryTerminalSize() and WriteToTerminal().
+auto ConsoleSink() -> TerminalSink&;
 }  // namespace core
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+
+namespace core {
+// Wakes a thread blocked in Wait() or a poll on its handle. On POSIX this is a
+// self-pipe, so Notify() is safe to call from a signal handler; on Windows it
+// is an auto-reset event.
+class Waker {
+ public:
+  static constexpr std::chrono::milliseconds kForever{-1};
+
+  Waker();
+  ~Waker();
+
+  Waker(const Waker&) = delete;
+  Waker& operator=(const Waker&) = delete;
+  Waker(Waker&&) = delete;
+  Waker& operator=(Waker&&) = delete;
+
+  void Notify() noexcept;
+  // Blocks until notified or `timeout` passes, then clears the notification.
+  // Returns true when it was notified.
+  bool Wait(std::chrono::milliseconds timeout);
+  void Drain() noexcept;
+
+#ifdef _WIN32
+  void* Handle() const noexcept;
+#else
+  int Fd() const noexcept;
+#endif
+
+ private:
+#ifdef _WIN32
+  void* event_ = nullptr;
+#else
+  int read_fd_ = -1;
+  int write_fd_ = -1;
+#endif
+};
+}  // namespace core
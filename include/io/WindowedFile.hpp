@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io/MappedFile.hpp"
+
+namespace core {
+// Reads a file of any size through a few mapped windows of it, reusing the
+// least recently read one for whatever is not mapped yet, so what is kept
+// mapped stays the same however big the file is. Windows start at multiples
+// of kReadBytes, so a read of up to that much always fits in one, and reads
+// that go backwards find their window as readily as those going forwards.
+// For one thread at a time.
+class WindowedFile {
+ public:
+  static constexpr std::size_t kWindowBytes = 16 * 1024 * 1024;
+  static constexpr std::size_t kReadBytes = kWindowBytes / 2;
+
+  explicit WindowedFile(std::size_t max_windows = 4);
+
+  // Takes the file's size now; the file is opened again for each window.
+  bool Open(const std::string& file_path);
+  void Close() noexcept;
+  std::uint64_t Size() const noexcept;
+
+  // The bytes [offset, offset + length), fewer where the file ends. The view
+  // stays valid until as many other windows as the file keeps are mapped;
+  // an empty one past the end, or when mapping fails.
+  std::string_view Read(std::uint64_t offset, std::size_t length);
+
+  std::size_t MappedBytes() const noexcept;
+
+ private:
+  struct Window {
+    std::uint64_t offset = 0;
+    std::uint64_t last_used = 0;
+    std::unique_ptr<MappedFile> file;
+  };
+
+  std::string path_;
+  std::uint64_t size_ = 0;
+  std::size_t max_windows_;
+  std::vector<Window> windows_;
+  std::uint64_t use_clock_ = 0;
+};
+}  // namespace core
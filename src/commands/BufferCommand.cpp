@@ -0,0 +1,116 @@
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "commands/BufferCommand.hpp"
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+
+namespace {
+// Zero when `text` is not a number.
+std::size_t ParseNumber(const std::string& text) {
+  std::size_t number = 0;
+  for (const char kChr : text) {
+    if (std::isdigit(static_cast<unsigned char>(kChr)) == 0) {
+      return 0;
+    }
+    number = number * 10 + static_cast<std::size_t>(kChr - '0');
+    if (number > SIZE_MAX / 10) {
+      return SIZE_MAX / 10;
+    }
+  }
+  return number;
+}
+
+void ShowBuffer(core::EditorState& state, bool created) {
+  const core::Buffer& buffer = state.GetBuffer();
+  std::ostringstream message;
+  message << '"'
+          << (buffer.FilePath().empty() ? std::string("[No Name]")
+                                        : buffer.FilePath())
+          << '"';
+  if (created) {
+    message << " [New]";
+  } else {
+    if (buffer.IsDirty()) {
+      message << " [+]";
+    }
+    message << ' ' << buffer.LineCount()
+            << (buffer.IsIndexing() ? "+" : "") << " lines";
+  }
+  if (buffer.GetSwapStatus() == core::SwapStatus::kExists) {
+    // Another editor may have it open, or crashed with it.
+    message << " (swap file exists; recover with microvi -r)";
+    state.SetStatus(message.str(), core::StatusSeverity::kWarning);
+    return;
+  }
+  state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+}
+
+bool Edit(core::EditorState& state, const core::ExCommand& command) {
+  bool created = false;
+  if (!command.arguments.empty()) {
+    // The buffer being left keeps its changes, so nothing is lost.
+    state.OpenBuffer(command.arguments, created);
+    ShowBuffer(state, created);
+    return true;
+  }
+
+  if (state.GetBuffer().FilePath().empty()) {
+    state.SetStatus("No file name", core::StatusSeverity::kWarning);
+    return false;
+  }
+  if (state.GetBuffer().IsDirty() && !command.bang) {
+    state.SetStatus("No write since last change (add ! to override)",
+                    core::StatusSeverity::kWarning);
+    return false;
+  }
+  if (!state.ReloadBuffer()) {
+    state.SetStatus("Failed to load file", core::StatusSeverity::kError);
+    return false;
+  }
+  ShowBuffer(state, false);
+  return true;
+}
+}  // namespace
+
+namespace commands {
+core::ExCommandSpec BufferCommand::Spec() const {
+  return {.names = {{"edit", 1},
+                    {"buffer", 1},
+                    {"bnext", 2},
+                    {"bNext", 2},
+                    {"bprevious", 2}},
+          .bang = true};
+}
+
+bool BufferCommand::Execute(core::EditorState& state,
+                            const core::ExCommand& command) {
+  if (command.name == "edit") {
+    return Edit(state, command);
+  }
+
+  const std::size_t kNumber =
+      command.arguments.empty() ? 1 : ParseNumber(command.arguments);
+  if (kNumber == 0) {
+    state.SetStatus("Invalid buffer number", core::StatusSeverity::kWarning);
+    return false;
+  }
+
+  if (command.name == "buffer") {
+    if (!command.arguments.empty() && !state.SwitchBuffer(kNumber)) {
+      state.SetStatus("Buffer " + command.arguments + " does not exist",
+                      core::StatusSeverity::kWarning);
+      return false;
+    }
+  } else {
+    const auto kDelta = static_cast<std::ptrdiff_t>(kNumber);
+    state.CycleBuffer(command.name == "bnext" ? kDelta : -kDelta);
+  }
+  ShowBuffer(state, false);
+  return true;
+}
+}  // namespace commands
@@ -0,0 +1,40 @@
+#include <memory>
+
+#include "commands/BuiltinCommands.hpp"
+
+#include "commands/BufferCommand.hpp"
+#include "commands/DeleteCommand.hpp"
+#include "commands/FilterCommand.hpp"
+#include "commands/FollowCommand.hpp"
+#include "commands/GlobalCommand.hpp"
+#include "commands/LatencyCommand.hpp"
+#include "commands/ListBuffersCommand.hpp"
+#include "commands/NoHighlightCommand.hpp"
+#include "commands/PluginCommand.hpp"
+#include "commands/ProfileCommand.hpp"
+#include "commands/QuitCommand.hpp"
+#include "commands/SetCommand.hpp"
+#include "commands/SortCommand.hpp"
+#include "commands/SubstituteCommand.hpp"
+#include "commands/WriteCommand.hpp"
+
+namespace commands {
+void RegisterBuiltinCommands(core::InputHandler& handler,
+                             core::PluginHost& plugin_host) {
+  handler.RegisterCommand(std::make_unique<WriteCommand>());
+  handler.RegisterCommand(std::make_unique<QuitCommand>());
+  handler.RegisterCommand(std::make_unique<DeleteCommand>());
+  handler.RegisterCommand(std::make_unique<LatencyCommand>());
+  handler.RegisterCommand(std::make_unique<ProfileCommand>());
+  handler.RegisterCommand(std::make_unique<NoHighlightCommand>());
+  handler.RegisterCommand(std::make_unique<SubstituteCommand>());
+  handler.RegisterCommand(std::make_unique<SortCommand>());
+  handler.RegisterCommand(std::make_unique<GlobalCommand>());
+  handler.RegisterCommand(std::make_unique<FilterCommand>());
+  handler.RegisterCommand(std::make_unique<PluginCommand>(plugin_host));
+  handler.RegisterCommand(std::make_unique<BufferCommand>());
+  handler.RegisterCommand(std::make_unique<ListBuffersCommand>());
+  handler.RegisterCommand(std::make_unique<SetCommand>());
+  handler.RegisterCommand(std::make_unique<FollowCommand>());
+}
+} // namespace commands
@@ -1,5 +1,6 @@
 #include <cctype>
 #include <cstddef>
+#include <cstdint>
 #include <sstream>
 #include <string>
 
@@ -9,55 +10,65 @@
 #include "core/EditorState.hpp"
 
 namespace {
-int ParseLineArgument(const std::string& input) {
-  std::string digits;
-  for (const char kChr : input) {
-    if (std::isdigit(static_cast<unsigned char>(kChr)) != 0) {
-      digits.push_back(kChr);
+// The count after the range; zero when it is not a number.
+std::size_t ParseCount(const std::string& text) {
+  std::size_t count = 0;
+  for (const char kChr : text) {
+    if (std::isdigit(static_cast<unsigned char>(kChr)) == 0) {
+      return 0;
+    }
+    count = count * 10 + static_cast<std::size_t>(kChr - '0');
+    if (count > SIZE_MAX / 10) {
+      return SIZE_MAX / 10;
     }
   }
-
-  if (digits.empty()) {
-    return -1;
-  }
-
-  try {
-    return std::stoi(digits);
-  } catch (...) {
-    return -1;
-  }
+  return count;
 }
 }  // namespace
 
 namespace commands {
-bool DeleteCommand::Matches(const std::string& input) const {
-  return input.starts_with(":d");
+core::ExCommandSpec DeleteCommand::Spec() const {
+  return {.names = {{"delete", 1}}, .range = true, .modifies = true};
 }
 
-void DeleteCommand::Execute(core::EditorState& state,
-                            const std::string& input) {
-  const int kParsed = ParseLineArgument(input.substr(2));
-  std::size_t target_line = state.CursorLine();
+// :[range]d [count]. Like vi, a count deletes that many lines from the last
+// line of the range.
+bool DeleteCommand::Execute(core::EditorState& state,
+                            const core::ExCommand& command) {
+  auto& buffer = state.GetBuffer();
+  // "$" is the last line, so every line must have been found.
+  buffer.FinishIndexing();
 
-  if (kParsed > 0) {
-    if (static_cast<std::size_t>(kParsed) == 0) {
-      state.SetStatus("Invalid line number", core::StatusSeverity::kWarning);
-      return;
-    }
-    target_line = static_cast<std::size_t>(kParsed - 1);
+  std::size_t first = 0;
+  std::size_t last = 0;
+  std::string error;
+  if (!command.range.Resolve(state.CursorLine(), buffer.LineCount(), first,
+                             last, error)) {
+    state.SetStatus(error, core::StatusSeverity::kWarning);
+    return false;
   }
 
-  auto& buffer = state.GetBuffer();
-  if (target_line >= buffer.LineCount()) {
-    state.SetStatus("Line out of range", core::StatusSeverity::kWarning);
-    return;
+  std::size_t target_line = first;
+  std::size_t count = last - first;
+  if (!command.arguments.empty()) {
+    count = ParseCount(command.arguments);
+    if (count == 0) {
+      state.SetStatus("Invalid count", core::StatusSeverity::kWarning);
+      return false;
+    }
+    target_line = last - 1;
   }
 
-  buffer.DeleteLine(target_line);
-  state.MoveCursorLine(0);
+  const std::size_t kDeleted = buffer.DeleteLines(target_line, count);
+  state.SetCursor(target_line, 0);
 
   std::ostringstream message;
-  message << "Deleted line " << target_line + 1;
+  if (kDeleted == 1) {
+    message << "Deleted line " << target_line + 1;
+  } else {
+    message << "Deleted " << kDeleted << " lines";
+  }
   state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+  return true;
 }
-}  // namespace commands
\ No newline at end of file
+}  // namespace commands
@@ -0,0 +1,132 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "commands/FilterCommand.hpp"
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/Registry.hpp"
+#include "io/FilterProcess.hpp"
+
+namespace {
+// Output is put into the buffer once this much has come, so a large output
+// takes a few pieces rather than one per read.
+constexpr std::size_t kInsertBytes = 1024 * 1024;
+
+// Inserts the complete lines at the start of `output` at `line`, or all of
+// it with `last`, and drops them from it; returns how many there were.
+std::size_t InsertOutput(core::Buffer& buffer, std::size_t line,
+                         std::string& output, bool last, bool crlf,
+                         std::vector<std::string_view>& lines) {
+  lines.clear();
+  std::size_t start = 0;
+  for (std::size_t end = output.find('\n'); end != std::string::npos;
+       end = output.find('\n', start)) {
+    std::string_view text(output.data() + start, end - start);
+    if (crlf && text.ends_with('\r')) {
+      text.remove_suffix(1);
+    }
+    lines.push_back(text);
+    start = end + 1;
+  }
+  if (last && start < output.size()) {
+    lines.emplace_back(output.data() + start, output.size() - start);
+    start = output.size();
+  }
+  buffer.InsertLines(line, lines);
+  output.erase(0, start);
+  return lines.size();
+}
+}  // namespace
+
+namespace commands {
+core::ExCommandSpec FilterCommand::Spec() const {
+  return {.names = {{"!", 1}},
+          .range = true,
+          .bar = true,
+          .modifies = true,
+          .capabilities = static_cast<core::CommandCapabilityMask>(
+              core::CommandCapability::kReadBuffer |
+              core::CommandCapability::kWriteBuffer |
+              core::CommandCapability::kSpawnProcess)};
+}
+
+bool FilterCommand::Execute(core::EditorState& state,
+                            const core::ExCommand& command) {
+  auto& buffer = state.GetBuffer();
+  if (command.range.addresses == 0) {
+    state.SetStatus("Usage: :{range}!command", core::StatusSeverity::kError);
+    return false;
+  }
+  if (command.arguments.empty()) {
+    state.SetStatus("Argument required", core::StatusSeverity::kError);
+    return false;
+  }
+  buffer.FinishIndexing();
+
+  std::size_t first = 0;
+  std::size_t last = 0;
+  std::string error;
+  if (!command.range.Resolve(state.CursorLine(), buffer.LineCount(), first,
+                             last, error)) {
+    state.SetStatus(error, core::StatusSeverity::kError);
+    return false;
+  }
+
+  core::FilterProcess process;
+  if (!process.Start(command.arguments)) {
+    state.SetStatus("Cannot run: " + command.arguments,
+                    core::StatusSeverity::kError);
+    return false;
+  }
+
+  // The input is read from a snapshot, which the output going into the
+  // buffer below the range leaves as it was.
+  const core::TextSnapshot kSnapshot = buffer.Snapshot(first);
+  core::TextSnapshot::Cursor cursor = kSnapshot.Locate(first);
+  std::size_t unsent = last - first;
+  const auto kSource = [&](std::string& input) {
+    if (unsent > 0) {
+      input.append(kSnapshot.LineAt(cursor));
+      input.push_back('\n');
+      --unsent;
+      kSnapshot.Next(cursor);
+    }
+    return unsent > 0;
+  };
+
+  const bool kCrLf = buffer.GetLineEnding() == core::LineEnding::kCrLf;
+  std::string output;
+  std::vector<std::string_view> lines;
+  std::size_t inserted = 0;
+  buffer.CloseUndoStep();
+  process.Run(kSource, [&](std::string_view bytes) {
+    output.append(bytes);
+    // Only once a line has ended, so one long line is not scanned again on
+    // every read.
+    if (output.size() >= kInsertBytes &&
+        bytes.find('\n') != std::string_view::npos) {
+      inserted += InsertOutput(buffer, last + inserted, output, false, kCrLf,
+                               lines);
+    }
+  });
+  InsertOutput(buffer, last + inserted, output, true, kCrLf, lines);
+  const int kStatus = process.Wait();
+  buffer.DeleteLines(first, last - first);
+  buffer.CloseUndoStep();
+  state.SetCursor(first, 0);
+
+  std::string message = std::to_string(last - first) +
+                        (last - first == 1 ? " line" : " lines") +
+                        " filtered";
+  if (kStatus != 0) {
+    message += kStatus < 0 ? ", command killed"
+                           : ", command returned " + std::to_string(kStatus);
+  }
+  state.SetStatus(message, kStatus == 0 ? core::StatusSeverity::kInfo
+                                        : core::StatusSeverity::kWarning);
+  return true;
+}
+}  // namespace commands
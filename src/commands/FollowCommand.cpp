@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "commands/FollowCommand.hpp"
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+
+namespace commands {
+core::ExCommandSpec FollowCommand::Spec() const {
+  return {.names = {{"follow", 2}}};
+}
+
+bool FollowCommand::Execute(core::EditorState& state,
+                            const core::ExCommand& /*command*/) {
+  core::Buffer& buffer = state.GetBuffer();
+  if (buffer.FilePath().empty()) {
+    state.SetStatus("No file name", core::StatusSeverity::kWarning);
+    return false;
+  }
+  if (buffer.IsDirty()) {
+    state.SetStatus("No write since last change",
+                    core::StatusSeverity::kWarning);
+    return false;
+  }
+  if (!buffer.StartFollowing(state.GetViewOptions().scrollback)) {
+    state.SetStatus("Cannot follow " + buffer.FilePath(),
+                    core::StatusSeverity::kError);
+    return false;
+  }
+
+  buffer_id_ = state.BufferId();
+  watcher_.Watch(buffer.FilePath(), wake_hook_);
+  state.SetCursor(buffer.LineCount() - 1, 0);
+  // Whatever was written since the file was loaded.
+  Follow(state, false);
+  state.SetStatus("Following " + buffer.FilePath(),
+                  core::StatusSeverity::kInfo);
+  return true;
+}
+
+void FollowCommand::SetWakeHook(std::function<void()> hook) {
+  wake_hook_ = std::move(hook);
+}
+
+bool FollowCommand::Poll(core::EditorState& state) {
+  // Changes to a buffer that is not current wait until it is again.
+  if (!watcher_.IsWatching() || state.BufferId() != buffer_id_) {
+    return false;
+  }
+  if (!state.GetBuffer().IsFollowing()) {
+    watcher_.Stop();
+    return false;
+  }
+  const core::FileChange kChange = watcher_.Take();
+  return kChange != core::FileChange::kNone &&
+         Follow(state, kChange == core::FileChange::kReplaced);
+}
+
+bool FollowCommand::Follow(core::EditorState& state, bool replaced) {
+  core::Buffer& buffer = state.GetBuffer();
+  const bool kPinned = state.CursorLine() + 1 >= buffer.LineCount();
+  const std::size_t kDropped = buffer.DroppedLines();
+  bool more = false;
+  if (!buffer.SyncFollow(state.GetViewOptions().scrollback, replaced,
+                         &more)) {
+    return false;
+  }
+  if (more && wake_hook_) {
+    wake_hook_();
+  }
+
+  if (kPinned) {
+    state.SetCursor(buffer.LineCount() - 1, 0);
+    return true;
+  }
+  // Elsewhere the view stays on the lines it showed as those above go.
+  const std::size_t kGone = buffer.DroppedLines() > kDropped
+                                ? buffer.DroppedLines() - kDropped
+                                : 0;
+  core::Viewport viewport = state.GetViewport();
+  viewport.line -= (std::min)(viewport.line, kGone);
+  state.SetViewport(viewport);
+  state.SetCursor(state.CursorLine() - (std::min)(state.CursorLine(), kGone),
+                  state.CursorColumn());
+  return true;
+}
+}  // namespace commands
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "commands/GlobalCommand.hpp"
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/LineFilter.hpp"
+#include "core/Pattern.hpp"
+
+namespace {
+constexpr std::string_view kUsage = "Usage: :g/pattern/d";
+
+// As for :s, any punctuation can separate the pattern.
+bool IsDelimiter(char value) {
+  return std::isgraph(static_cast<unsigned char>(value)) != 0 &&
+         std::isalnum(static_cast<unsigned char>(value)) == 0 &&
+         value != '\\' && value != '"' && value != '|';
+}
+
+// Splits "/pattern/command" into its parts; an escaped delimiter in the
+// pattern stands for itself.
+bool ParseGlobal(std::string_view text, std::string& pattern,
+                 std::string_view& command) {
+  if (text.empty() || !IsDelimiter(text.front())) {
+    return false;
+  }
+  const char kDelimiter = text.front();
+  std::size_t index = 1;
+  while (index < text.size() && text[index] != kDelimiter) {
+    if (text[index] == '\\' && index + 1 < text.size()) {
+      if (text[index + 1] != kDelimiter) {
+        pattern.push_back('\\');
+      }
+      pattern.push_back(text[index + 1]);
+      index += 2;
+      continue;
+    }
+    pattern.push_back(text[index]);
+    ++index;
+  }
+  command = index < text.size() ? text.substr(index + 1) : std::string_view();
+  const std::size_t kStart = command.find_first_not_of(" \t");
+  const std::size_t kEnd = command.find_last_not_of(" \t");
+  command = kStart == std::string_view::npos
+                ? std::string_view()
+                : command.substr(kStart, kEnd + 1 - kStart);
+  return true;
+}
+
+// "d" up to "delete".
+bool IsDelete(std::string_view command) {
+  constexpr std::string_view kDelete = "delete";
+  return !command.empty() && kDelete.starts_with(command);
+}
+}  // namespace
+
+namespace commands {
+core::ExCommandSpec GlobalCommand::Spec() const {
+  return {.names = {{"global", 1}, {"vglobal", 1}},
+          .range = true,
+          .bang = true,
+          .bar = true,
+          .modifies = true};
+}
+
+bool GlobalCommand::Execute(core::EditorState& state,
+                            const core::ExCommand& command) {
+  auto& buffer = state.GetBuffer();
+  buffer.FinishIndexing();
+
+  std::size_t first = 0;
+  std::size_t last = buffer.LineCount();
+  std::string error;
+  if (command.range.addresses != 0 &&
+      !command.range.Resolve(state.CursorLine(), buffer.LineCount(), first,
+                             last, error)) {
+    state.SetStatus(error, core::StatusSeverity::kError);
+    return false;
+  }
+
+  std::string source;
+  std::string_view action;
+  if (!ParseGlobal(command.arguments, source, action)) {
+    state.SetStatus(std::string(kUsage), core::StatusSeverity::kError);
+    return false;
+  }
+  if (!IsDelete(action)) {
+    state.SetStatus(action.empty() ? std::string(kUsage)
+                                   : "Not supported with :g: " +
+                                         std::string(action),
+                    core::StatusSeverity::kError);
+    return false;
+  }
+  if (source.empty()) {
+    state.SetStatus("Empty pattern", core::StatusSeverity::kError);
+    return false;
+  }
+  core::Pattern pattern;
+  if (!pattern.Compile(source, error)) {
+    state.SetStatus("Invalid pattern: " + error, core::StatusSeverity::kError);
+    return false;
+  }
+
+  const bool kInvert = command.bang || command.name == "vglobal";
+  std::vector<core::LineRange> runs;
+  {
+    const core::TextSnapshot kSnapshot = buffer.Snapshot(first);
+    const std::vector<std::string_view> kLines =
+        core::SnapshotLines(kSnapshot, first, last);
+    runs = core::MatchLines(kLines, first, pattern, kInvert);
+  }
+  if (runs.empty()) {
+    state.SetStatus(
+        (kInvert ? "Pattern found in every line: " : "Pattern not found: ") +
+            source,
+        core::StatusSeverity::kWarning);
+    return true;
+  }
+
+  buffer.CloseUndoStep();
+  const std::size_t kDeleted = buffer.DeleteLineRuns(runs);
+  buffer.CloseUndoStep();
+  // On the line that followed the last one deleted, as in vi.
+  const std::size_t kLine = (std::min)(runs.back().last - kDeleted,
+                                       buffer.LineCount() - 1);
+  state.SetCursor(kLine, 0);
+
+  std::ostringstream message;
+  if (kDeleted == 1) {
+    message << "Deleted line " << runs.front().first + 1;
+  } else {
+    message << "Deleted " << kDeleted << " lines";
+  }
+  state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+  return true;
+}
+}  // namespace commands
@@ -0,0 +1,39 @@
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "commands/LatencyCommand.hpp"
+
+#include "core/EditorState.hpp"
+
+namespace {
+double Milliseconds(std::chrono::microseconds value) {
+  return static_cast<double>(value.count()) / 1000.0;
+}
+}  // namespace
+
+namespace commands {
+core::ExCommandSpec LatencyCommand::Spec() const {
+  return {.names = {{"latency", 7}}};
+}
+
+bool LatencyCommand::Execute(core::EditorState& state,
+                             const core::ExCommand& /*command*/) {
+  const core::LatencyStats& kStats = state.InputLatency();
+  if (kStats.samples == 0) {
+    state.SetStatus("No keypresses measured yet", core::StatusSeverity::kInfo);
+    return true;
+  }
+
+  const auto kAverage = kStats.total / kStats.samples;
+  std::ostringstream message;
+  message << std::fixed << std::setprecision(2)
+          << "Keypress to flush: last " << Milliseconds(kStats.last)
+          << " ms, avg " << Milliseconds(kAverage) << " ms, max "
+          << Milliseconds(kStats.max) << " ms (" << kStats.samples
+          << " samples)";
+  state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+  return true;
+}
+}  // namespace commands
@@ -0,0 +1,38 @@
+#include <sstream>
+#include <string>
+
+#include "commands/ListBuffersCommand.hpp"
+
+#include "core/EditorState.hpp"
+
+namespace commands {
+core::ExCommandSpec ListBuffersCommand::Spec() const {
+  return {.names = {{"ls", 2}, {"buffers", 7}, {"files", 5}}};
+}
+
+bool ListBuffersCommand::Execute(core::EditorState& state,
+                                 const core::ExCommand& /*command*/) {
+  // The status line is a single row, so the list is too.
+  std::ostringstream message;
+  for (const core::BufferListing& listing : state.ListBuffers()) {
+    if (message.tellp() > 0) {
+      message << "  ";
+    }
+    message << listing.number;
+    if (listing.current) {
+      message << '%';
+    } else if (listing.loaded) {
+      message << 'h';
+    }
+    if (listing.dirty) {
+      message << '+';
+    }
+    message << " \""
+            << (listing.path.empty() ? std::string("[No Name]")
+                                     : listing.path)
+            << '"';
+  }
+  state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+  return true;
+}
+}  // namespace commands
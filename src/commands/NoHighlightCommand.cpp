@@ -0,0 +1,19 @@
+#include <string>
+
+#include "commands/NoHighlightCommand.hpp"
+
+#include "core/EditorState.hpp"
+
+namespace commands {
+core::ExCommandSpec NoHighlightCommand::Spec() const {
+  return {.names = {{"nohlsearch", 3}}};
+}
+
+// Like vim, the next search or n/N highlights again.
+bool NoHighlightCommand::Execute(core::EditorState& state,
+                                 const core::ExCommand& /*command*/) {
+  state.SetSearchHighlight(nullptr);
+  state.ClearStatus();
+  return true;
+}
+}  // namespace commands
@@ -0,0 +1,30 @@
+#include <string>
+
+#include "commands/PluginCommand.hpp"
+
+#include "core/EditorState.hpp"
+
+namespace commands {
+PluginCommand::PluginCommand(core::PluginHost& host) : host_(host) {}
+
+core::ExCommandSpec PluginCommand::Spec() const {
+  return {.names = {{"plugin", 6}}};
+}
+
+bool PluginCommand::Execute(core::EditorState& state,
+                            const core::ExCommand& command) {
+  const std::string& kPath = command.arguments;
+  if (kPath.empty()) {
+    state.SetStatus("Usage: :plugin <path>", core::StatusSeverity::kWarning);
+    return false;
+  }
+
+  std::string error;
+  if (!host_.Load(kPath, error)) {
+    state.SetStatus(error, core::StatusSeverity::kError);
+    return false;
+  }
+  state.SetStatus("Starting plugin " + kPath, core::StatusSeverity::kInfo);
+  return true;
+}
+}  // namespace commands
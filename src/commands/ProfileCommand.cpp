@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "commands/ProfileCommand.hpp"
+
+#include "core/EditorState.hpp"
+#include "core/Profiler.hpp"
+
+namespace commands {
+core::ExCommandSpec ProfileCommand::Spec() const {
+  return {.names = {{"profile", 4}}};
+}
+
+bool ProfileCommand::Execute(core::EditorState& state,
+                             const core::ExCommand& command) {
+  if (!core::Profiler::kCompiledIn) {
+    state.SetStatus("Profiling is not built in; configure with "
+                    "-DMICROVI_PROFILING=ON",
+                    core::StatusSeverity::kWarning);
+    return false;
+  }
+
+  core::Profiler& profiler = core::Profiler::Shared();
+  const std::string_view kArguments(command.arguments);
+  const std::string_view kAction =
+      kArguments.substr(0, kArguments.find_first_of(" \t"));
+  std::string_view path = kArguments.substr(kAction.size());
+  path.remove_prefix((std::min)(path.find_first_not_of(" \t"), path.size()));
+
+  if (kAction.empty()) {
+    // The overlay shows only while there is no message.
+    state.SetShowsProfile(!state.ShowsProfile());
+    state.ClearStatus();
+    return true;
+  }
+  if (!path.empty() && kAction != "dump") {
+    state.SetStatus("Trailing characters: " + std::string(path),
+                    core::StatusSeverity::kError);
+    return false;
+  }
+  if (kAction == "reset") {
+    profiler.Reset();
+    state.SetStatus("Profile reset", core::StatusSeverity::kInfo);
+    return true;
+  }
+  if (kAction == "trace") {
+    profiler.StartTrace();
+    state.SetStatus("Tracing; :profile dump FILE writes the trace",
+                    core::StatusSeverity::kInfo);
+    return true;
+  }
+  if (kAction == "dump") {
+    if (path.empty()) {
+      state.SetStatus("Argument required: file",
+                      core::StatusSeverity::kError);
+      return false;
+    }
+    if (!profiler.IsTracing()) {
+      state.SetStatus("No trace running; start one with :profile trace",
+                      core::StatusSeverity::kWarning);
+      return false;
+    }
+    const std::size_t kEvents = profiler.TraceEvents();
+    const std::string kPath(path);
+    if (!profiler.WriteTrace(kPath)) {
+      state.SetStatus("Cannot write " + kPath, core::StatusSeverity::kError);
+      return false;
+    }
+    state.SetStatus("Wrote " + std::to_string(kEvents) + " trace events to " +
+                        kPath,
+                    core::StatusSeverity::kInfo);
+    return true;
+  }
+  state.SetStatus("Unknown :profile action: " + std::string(kAction),
+                  core::StatusSeverity::kError);
+  return false;
+}
+}  // namespace commands
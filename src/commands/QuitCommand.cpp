@@ -1,3 +1,4 @@
+#include <cstddef>
 #include <string>
 
 #include "commands/QuitCommand.hpp"
@@ -6,21 +7,29 @@
 #include "core/EditorState.hpp"
 
 namespace commands {
-bool QuitCommand::Matches(const std::string& input) const {
-  return input == ":q" || input == ":q!";
+core::ExCommandSpec QuitCommand::Spec() const {
+  return {.names = {{"quit", 1}}, .bang = true};
 }
 
-void QuitCommand::Execute(core::EditorState& state, const std::string& input) {
-  const bool kForce = input == ":q!";
+bool QuitCommand::Execute(core::EditorState& state,
+                          const core::ExCommand& command) {
   const bool kDirty = state.GetBuffer().IsDirty();
 
-  if (kDirty && !kForce) {
+  if (kDirty && !command.bang) {
     state.SetStatus("Unsaved changes. Use :q! to force quit.",
                     core::StatusSeverity::kWarning);
-    return;
+    return false;
+  }
+  const std::size_t kHidden = state.HiddenDirtyBuffer();
+  if (kHidden != 0 && !command.bang) {
+    state.SetStatus("Buffer " + std::to_string(kHidden) +
+                        " has unsaved changes. Use :q! to force quit.",
+                    core::StatusSeverity::kWarning);
+    return false;
   }
 
   state.ClearStatus();
   state.RequestQuit();
+  return true;
 }
 }  // namespace commands
\ No newline at end of file
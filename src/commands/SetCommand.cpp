@@ -0,0 +1,116 @@
+#include <cctype>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "commands/SetCommand.hpp"
+
+#include "core/EditorState.hpp"
+
+namespace {
+constexpr std::size_t kMaxTabstop = 64;
+// As in Neovim, whose 'scrollback' this is.
+constexpr std::size_t kMaxScrollback = 100000;
+
+bool IsOption(std::string_view name, std::string_view full,
+              std::string_view abbreviation) {
+  return name == full || name == abbreviation;
+}
+
+// Zero when `text` is not a number up to `max`.
+std::size_t ParseNumber(std::string_view text, std::size_t max) {
+  std::size_t number = 0;
+  for (const char kChr : text) {
+    if (std::isdigit(static_cast<unsigned char>(kChr)) == 0) {
+      return 0;
+    }
+    number = number * 10 + static_cast<std::size_t>(kChr - '0');
+    if (number > max) {
+      return 0;
+    }
+  }
+  return number;
+}
+
+// Applies one argument of :set, or says what is wrong with it in `error`.
+bool ApplyOption(std::string_view argument, core::ViewOptions& options,
+                 std::ostringstream& shown, std::string& error) {
+  const std::size_t kEquals = argument.find('=');
+  if (kEquals != std::string_view::npos) {
+    const std::string_view kName = argument.substr(0, kEquals);
+    const bool kTabstop = IsOption(kName, "tabstop", "ts");
+    if (!kTabstop && !IsOption(kName, "scrollback", "scbk")) {
+      error = "Unknown option: " + std::string(kName);
+      return false;
+    }
+    const std::size_t kValue = ParseNumber(
+        argument.substr(kEquals + 1), kTabstop ? kMaxTabstop : kMaxScrollback);
+    if (kValue == 0) {
+      error = "Invalid argument: " + std::string(argument);
+      return false;
+    }
+    (kTabstop ? options.tabstop : options.scrollback) = kValue;
+    return true;
+  }
+
+  if (!argument.empty() && argument.back() == '?') {
+    const std::string_view kName = argument.substr(0, argument.size() - 1);
+    if (kName == "wrap") {
+      shown << (options.wrap ? "  wrap" : "  nowrap");
+    } else if (IsOption(kName, "tabstop", "ts")) {
+      shown << "  tabstop=" << options.tabstop;
+    } else if (IsOption(kName, "scrollback", "scbk")) {
+      shown << "  scrollback=" << options.scrollback;
+    } else {
+      error = "Unknown option: " + std::string(kName);
+      return false;
+    }
+    return true;
+  }
+
+  if (argument == "wrap") {
+    options.wrap = true;
+  } else if (argument == "nowrap") {
+    options.wrap = false;
+  } else if (argument == "invwrap" || argument == "wrap!") {
+    options.wrap = !options.wrap;
+  } else if (IsOption(argument, "tabstop", "ts")) {
+    shown << "  tabstop=" << options.tabstop;
+  } else if (IsOption(argument, "scrollback", "scbk")) {
+    shown << "  scrollback=" << options.scrollback;
+  } else {
+    error = "Unknown option: " + std::string(argument);
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+namespace commands {
+core::ExCommandSpec SetCommand::Spec() const {
+  return {.names = {{"set", 2}}};
+}
+
+bool SetCommand::Execute(core::EditorState& state,
+                         const core::ExCommand& command) {
+  core::ViewOptions options = state.GetViewOptions();
+  std::ostringstream shown;
+  std::string error;
+  std::istringstream arguments(command.arguments);
+  std::string argument;
+  while (arguments >> argument) {
+    if (!ApplyOption(argument, options, shown, error)) {
+      state.SetStatus(error, core::StatusSeverity::kWarning);
+      return false;
+    }
+  }
+
+  state.SetViewOptions(options);
+  const std::string kShown = shown.str();
+  if (!kShown.empty()) {
+    state.SetStatus(kShown.substr(2), core::StatusSeverity::kInfo);
+  }
+  return true;
+}
+}  // namespace commands
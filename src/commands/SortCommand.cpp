@@ -0,0 +1,75 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "commands/SortCommand.hpp"
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/LineFilter.hpp"
+
+namespace commands {
+core::ExCommandSpec SortCommand::Spec() const {
+  return {.names = {{"sort", 3}},
+          .range = true,
+          .bang = true,
+          .modifies = true};
+}
+
+bool SortCommand::Execute(core::EditorState& state,
+                          const core::ExCommand& command) {
+  auto& buffer = state.GetBuffer();
+  buffer.FinishIndexing();
+
+  std::size_t first = 0;
+  std::size_t last = buffer.LineCount();
+  std::string error;
+  if (command.range.addresses != 0 &&
+      !command.range.Resolve(state.CursorLine(), buffer.LineCount(), first,
+                             last, error)) {
+    state.SetStatus(error, core::StatusSeverity::kError);
+    return false;
+  }
+
+  core::SortOrder order;
+  order.reverse = command.bang;
+  for (const char kFlag : command.arguments) {
+    if (kFlag == 'n') {
+      order.numeric = true;
+    } else if (kFlag == 'u') {
+      order.unique = true;
+    } else if (kFlag == 'r') {
+      order.reverse = true;
+    } else if (kFlag != ' ' && kFlag != '\t') {
+      state.SetStatus(std::string("Unknown flag: ") + kFlag,
+                      core::StatusSeverity::kError);
+      return false;
+    }
+  }
+
+  // The views point into the snapshot, which keeps them valid while the
+  // lines they replace go.
+  const core::TextSnapshot kSnapshot = buffer.Snapshot(first);
+  std::vector<std::string_view> lines =
+      core::SnapshotLines(kSnapshot, first, last);
+  core::SortLines(lines, order);
+
+  buffer.CloseUndoStep();
+  if (!buffer.ReplaceLineRange(first, last - first, lines)) {
+    state.SetStatus("Cannot sort", core::StatusSeverity::kError);
+    return false;
+  }
+  buffer.CloseUndoStep();
+  state.SetCursor(first, 0);
+
+  std::string message = "Sorted " + std::to_string(last - first) + " lines";
+  if (lines.size() < last - first) {
+    const std::size_t kDropped = last - first - lines.size();
+    message += ", " + std::to_string(kDropped) +
+               (kDropped == 1 ? " duplicate removed" : " duplicates removed");
+  }
+  state.SetStatus(message, core::StatusSeverity::kInfo);
+  return true;
+}
+}  // namespace commands
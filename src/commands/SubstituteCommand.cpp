@@ -0,0 +1,205 @@
+#include <cctype>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "commands/SubstituteCommand.hpp"
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/Pattern.hpp"
+
+namespace {
+struct SubstituteArguments {
+  std::size_t first = 0;
+  std::size_t last = 0;
+  std::string pattern;
+  std::string replacement;
+  bool global = false;
+};
+
+// Like vi, any punctuation can separate the parts of the command.
+bool IsDelimiter(char value) {
+  return std::isgraph(static_cast<unsigned char>(value)) != 0 &&
+         std::isalnum(static_cast<unsigned char>(value)) == 0 &&
+         value != '\\' && value != '"' && value != '|';
+}
+
+// Reads up to the next unescaped `delimiter`. In the pattern an escaped
+// delimiter stands for itself; the replacement keeps its escapes, which the
+// substitution interprets.
+std::string ReadPart(std::string_view text, std::size_t& index, char delimiter,
+                     bool unescape_delimiter) {
+  std::string part;
+  while (index < text.size() && text[index] != delimiter) {
+    if (text[index] == '\\' && index + 1 < text.size()) {
+      if (!unescape_delimiter || text[index + 1] != delimiter) {
+        part.push_back('\\');
+      }
+      part.push_back(text[index + 1]);
+      index += 2;
+      continue;
+    }
+    part.push_back(text[index]);
+    ++index;
+  }
+  if (index < text.size()) {
+    ++index;
+  }
+  return part;
+}
+
+bool ParseSubstitute(const core::ExCommand& command, std::size_t cursor,
+                     std::size_t line_count, SubstituteArguments& arguments,
+                     std::string& error) {
+  if (!command.range.Resolve(cursor, line_count, arguments.first,
+                             arguments.last, error)) {
+    return false;
+  }
+  const std::string_view kArguments = command.arguments;
+  if (kArguments.empty() || !IsDelimiter(kArguments.front())) {
+    error = "Usage: :s/pattern/replacement/[g]";
+    return false;
+  }
+
+  const std::string_view kText = kArguments.substr(1);
+  const char kDelimiter = kArguments.front();
+  std::size_t index = 0;
+  arguments.pattern = ReadPart(kText, index, kDelimiter, true);
+  arguments.replacement = ReadPart(kText, index, kDelimiter, false);
+  for (; index < kText.size(); ++index) {
+    if (kText[index] == 'g') {
+      arguments.global = true;
+    } else if (kText[index] != ' ') {
+      error = std::string("Unknown flag: ") + kText[index];
+      return false;
+    }
+  }
+  if (arguments.pattern.empty()) {
+    error = "Empty pattern";
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+namespace commands {
+core::ExCommandSpec SubstituteCommand::Spec() const {
+  return {.names = {{"substitute", 1}},
+          .range = true,
+          .delimited_parts = 2,
+          .modifies = true};
+}
+
+bool SubstituteCommand::Execute(core::EditorState& state,
+                                const core::ExCommand& command) {
+  auto& buffer = state.GetBuffer();
+  // The range may reach past what the background indexer has found yet.
+  buffer.FinishIndexing();
+
+  SubstituteArguments arguments;
+  std::string error;
+  if (!ParseSubstitute(command, state.CursorLine(), buffer.LineCount(),
+                       arguments, error)) {
+    state.SetStatus(error, core::StatusSeverity::kError);
+    return false;
+  }
+
+  auto pattern = std::make_shared<core::Pattern>();
+  if (!pattern->Compile(arguments.pattern, error)) {
+    state.SetStatus("Invalid pattern: " + error, core::StatusSeverity::kError);
+    return false;
+  }
+
+  source_ = arguments.pattern;
+  shown_percent_ = 0;
+  core::TextSnapshot snapshot = buffer.Snapshot(arguments.first);
+  revision_ = buffer.Revision();
+  if (substitution_.Start(std::move(snapshot), std::move(pattern),
+                          std::move(arguments.replacement), arguments.first,
+                          arguments.last, arguments.global)) {
+    Poll(state);
+    return true;
+  }
+  state.SetStatus("Substituting... 0%", core::StatusSeverity::kInfo);
+  return true;
+}
+
+void SubstituteCommand::SetWakeHook(std::function<void()> hook) {
+  substitution_.SetWakeHook(std::move(hook));
+}
+
+bool SubstituteCommand::Poll(core::EditorState& state) {
+  core::SubstitutionResult result;
+  if (substitution_.TakeResult(result)) {
+    Apply(state, result);
+    return true;
+  }
+  if (!substitution_.IsRunning() || substitution_.LinesTotal() == 0) {
+    return false;
+  }
+
+  const std::size_t kPercent =
+      substitution_.LinesDone() * 100 / substitution_.LinesTotal();
+  if (kPercent == shown_percent_) {
+    return false;
+  }
+  shown_percent_ = kPercent;
+  state.SetStatus("Substituting... " + std::to_string(kPercent) + "%",
+                  core::StatusSeverity::kInfo);
+  return true;
+}
+
+bool SubstituteCommand::IsBusy() const {
+  return substitution_.IsRunning();
+}
+
+bool SubstituteCommand::Cancel(core::EditorState& state) {
+  if (!substitution_.IsRunning()) {
+    return false;
+  }
+  substitution_.Cancel();
+  state.SetStatus("Substitution cancelled", core::StatusSeverity::kWarning);
+  return true;
+}
+
+void SubstituteCommand::Finish(core::EditorState& state) {
+  substitution_.Wait();
+  core::SubstitutionResult result;
+  if (substitution_.TakeResult(result)) {
+    Apply(state, result);
+  }
+}
+
+void SubstituteCommand::Apply(core::EditorState& state,
+                              const core::SubstitutionResult& result) {
+  auto& buffer = state.GetBuffer();
+  if (buffer.Revision() != revision_) {
+    state.SetStatus("Buffer changed during substitution; nothing replaced",
+                    core::StatusSeverity::kWarning);
+    return;
+  }
+  if (result.changes.empty()) {
+    state.SetStatus("Pattern not found: " + source_,
+                    core::StatusSeverity::kError);
+    return;
+  }
+
+  // However many lines it touches, the substitution undoes as one change.
+  buffer.CloseUndoStep();
+  buffer.ReplaceLineBatch(result.changes);
+  buffer.CloseUndoStep();
+  state.SetCursor(result.changes.back().line, 0);
+
+  std::ostringstream message;
+  message << result.substitutions
+          << (result.substitutions == 1 ? " substitution" : " substitutions")
+          << " on " << result.changes.size()
+          << (result.changes.size() == 1 ? " line" : " lines");
+  state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+}
+}  // namespace commands
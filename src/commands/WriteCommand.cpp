@@ -1,43 +1,126 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
 #include <sstream>
+#include <stop_token>
 #include <string>
 
 #include "commands/WriteCommand.hpp"
 
 #include "core/Buffer.hpp"
 #include "core/EditorState.hpp"
+#include "core/WorkerPool.hpp"
 
 namespace {
-std::string TrimLeadingWhitespace(const std::string& value) {
-  const auto kPos = value.find_first_not_of(" \t");
-  return kPos == std::string::npos ? std::string{} : value.substr(kPos);
+struct SaveOutcome {
+  bool written = false;
+  std::uint64_t bytes = 0;
+  std::chrono::duration<double, std::milli> elapsed{};
+};
+
+// Only this buffer is written, so changes to another stop the quit.
+bool Quit(core::EditorState& state, const core::ExCommand& command) {
+  const std::size_t kHidden = state.HiddenDirtyBuffer();
+  if (kHidden != 0 && !command.bang) {
+    state.SetStatus("Buffer " + std::to_string(kHidden) +
+                        " has unsaved changes. Add ! to quit anyway.",
+                    core::StatusSeverity::kWarning);
+    return false;
+  }
+  state.RequestQuit();
+  return true;
 }
 }  // namespace
 
 namespace commands {
-bool WriteCommand::Matches(const std::string& input) const {
-  return input.starts_with(":w");
+core::ExCommandSpec WriteCommand::Spec() const {
+  return {.names = {{"write", 1}, {"wq", 2}, {"xit", 1}}, .bang = true};
 }
 
-void WriteCommand::Execute(core::EditorState& state, const std::string& input) {
-  const auto kArgument =
-      TrimLeadingWhitespace(input.size() > 2 ? input.substr(2) : std::string{});
+bool WriteCommand::Execute(core::EditorState& state,
+                           const core::ExCommand& command) {
   auto& buffer = state.GetBuffer();
-  const std::string kTargetPath =
-      kArgument.empty() ? buffer.FilePath() : kArgument;
+  const bool kQuit = command.name != "write";
+  // :x writes only what needs writing.
+  if (command.name == "xit" && command.arguments.empty() &&
+      !buffer.IsDirty()) {
+    return Quit(state, command);
+  }
 
+  const std::string kTargetPath =
+      command.arguments.empty() ? buffer.FilePath() : command.arguments;
   if (kTargetPath.empty()) {
     state.SetStatus("No file specified for write",
                     core::StatusSeverity::kWarning);
-    return;
+    return false;
+  }
+  if (buffer.Paged() != nullptr) {
+    state.SetStatus("A paged file cannot be written",
+                    core::StatusSeverity::kError);
+    return false;
+  }
+  // A followed file holds only its last lines; writing them back would cut
+  // the rest off.
+  if (buffer.IsReadOnly() && !command.bang) {
+    state.SetStatus("The buffer is read-only (add ! to override)",
+                    core::StatusSeverity::kWarning);
+    return false;
   }
 
-  if (!buffer.SaveToFile(kTargetPath)) {
+  auto job = std::make_shared<core::SaveJob>();
+  if (!buffer.PrepareSave(kTargetPath, *job)) {
     state.SetStatus("Failed to write file", core::StatusSeverity::kError);
-    return;
+    return false;
   }
 
-  std::ostringstream message;
-  message << "Wrote " << buffer.LineCount() << " lines";
-  state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+  auto outcome = std::make_shared<SaveOutcome>();
+  state.SetStatus("Writing " + kTargetPath + "...",
+                  core::StatusSeverity::kInfo);
+  save_ = core::WorkerPool::Shared().Submit(
+      [job, outcome](const std::stop_token& /*token*/) {
+        // Not cancellable: the rename either happens or it does not.
+        const auto kStart = std::chrono::steady_clock::now();
+        outcome->written = job->Write(&outcome->bytes);
+        outcome->elapsed = std::chrono::steady_clock::now() - kStart;
+      },
+      [&state, job, outcome](core::TaskStatus /*status*/) {
+        if (!outcome->written) {
+          state.SetStatus("Failed to write file",
+                          core::StatusSeverity::kError);
+          return;
+        }
+        state.GetBuffer().FinishSave(*job);
+
+        std::ostringstream message;
+        message << "Wrote " << job->snapshot.line_count << " lines, "
+                << outcome->bytes << " bytes in " << std::fixed
+                << std::setprecision(1) << outcome->elapsed.count() << " ms";
+        state.SetStatus(message.str(), core::StatusSeverity::kInfo);
+      });
+  if (!kQuit) {
+    return true;
+  }
+
+  // Quitting waits for the write, and does not happen if it failed.
+  Finish(state);
+  if (buffer.IsDirty()) {
+    return false;
+  }
+  return Quit(state, command);
+}
+
+bool WriteCommand::IsBusy() const {
+  return save_.Valid() && !save_.Finished();
+}
+
+void WriteCommand::Finish(core::EditorState& /*state*/) {
+  if (!save_.Valid()) {
+    return;
+  }
+  save_.Wait();
+  core::WorkerPool::Shared().RunCompletions();
+  save_ = {};
 }
 }  // namespace commands
\ No newline at end of file
@@ -1,136 +1,1029 @@
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <ios>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
+#include <vector>
 
 #include "core/Buffer.hpp"
 
+#include "core/LineIndexer.hpp"
+#include "core/PagedText.hpp"
+#include "core/Profiler.hpp"
+#include "core/SwapFile.hpp"
+#include "core/WorkerPool.hpp"
+#include "io/AtomicFileWriter.hpp"
+#include "io/MappedFile.hpp"
+
 namespace {
-constexpr char kLineSeparator = '\n';
+constexpr std::string_view kLfSeparator = "\n";
+constexpr std::string_view kCrLfSeparator = "\r\n";
+constexpr std::size_t kMapThresholdBytes = 1024 * 1024;
+constexpr std::size_t kInitialIndexLines = 512;
+// Dropped followed text is let go of once there is at least this much.
+constexpr std::size_t kCompactBytes = 1024 * 1024;
+
+std::atomic<std::uint64_t> g_next_revision{1};
+
+std::uint64_t NextRevision() noexcept {
+  return g_next_revision.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Like vim's 'fileformat' detection, the first line ending decides.
+core::LineEnding DetectLineEnding(std::string_view text) {
+  const void* kNewline = std::memchr(text.data(), '\n', text.size());
+  if (kNewline == nullptr) {
+    return core::LineEnding::kLf;
+  }
+  const std::size_t kOffset = static_cast<std::size_t>(
+      static_cast<const char*>(kNewline) - text.data());
+  return kOffset > 0 && text[kOffset - 1] == '\r' ? core::LineEnding::kCrLf
+                                                  : core::LineEnding::kLf;
+}
 }  // namespace
 
 namespace core {
-Buffer::Buffer() {
-  lines_.emplace_back("");
+Buffer::Buffer() : revision_(NextRevision()) {
+  table_.InsertLine(0, "");
 }
 
-bool Buffer::LoadFromFile(const std::string& file_path) {
-  std::ifstream input(file_path);
-  if (!input.is_open()) {
-    return false;
+Buffer::~Buffer() = default;
+
+bool Buffer::LoadFromFile(const std::string& file_path,
+                          LoadStrategy strategy) {
+  MICROVI_PROFILE_SCOPE(kLoad);
+  std::error_code error;
+  const std::uintmax_t kSize = std::filesystem::file_size(file_path, error);
+  if (strategy == LoadStrategy::kPage ||
+      (strategy == LoadStrategy::kAuto && !error &&
+       kSize >= kPageThresholdBytes)) {
+    return LoadPaged(file_path);
   }
 
-  lines_.clear();
-  for (std::string line; std::getline(input, line);) {
-    lines_.push_back(std::move(line));
+  std::shared_ptr<const void> owner;
+  std::string_view text;
+  bool mapped = false;
+
+  if (strategy != LoadStrategy::kRead) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (mapping->Open(file_path) &&
+        (strategy == LoadStrategy::kMap ||
+         mapping->Size() >= kMapThresholdBytes)) {
+      text = mapping->View();
+      owner = std::move(mapping);
+      mapped = true;
+    }
   }
 
-  if (lines_.empty()) {
-    lines_.emplace_back("");
+  if (!mapped) {
+    std::ifstream input(file_path, std::ios::binary);
+    if (!input.is_open()) {
+      return false;
+    }
+
+    auto contents = std::make_shared<std::string>();
+    input.seekg(0, std::ios::end);
+    const std::streamoff kSize = input.tellg();
+    input.seekg(0, std::ios::beg);
+    if (kSize > 0) {
+      contents->resize(static_cast<std::size_t>(kSize));
+      input.read(contents->data(), kSize);
+      contents->resize(static_cast<std::size_t>(input.gcount()));
+    }
+    text = *contents;
+    owner = std::move(contents);
+  }
+
+  indexer_.Stop();
+  journal_.Clear();
+  paged_.reset();
+  table_.Load(text, std::move(owner));
+  loaded_bytes_ = text.size();
+  MICROVI_PROFILE_COUNT(kLoadedBytes, loaded_bytes_);
+  line_ending_ = DetectLineEnding(text);
+  // An empty file gets a newline once it has a line, as a new one would.
+  final_newline_ = text.empty() || text.back() == '\n';
+  table_.SetLineEnding(line_ending_);
+
+  cache_key_.reset();
+  index_cached_ = false;
+  remembered_view_.reset();
+  std::vector<std::uint64_t> cached_starts;
+  if (mapped) {
+    cache_key_ = IndexKey::Of(file_path, text);
+    index_cached_ =
+        IndexCache::Load(*cache_key_, text, cached_starts, cached_stats_);
+  }
+
+  index_batch_.clear();
+  if (index_cached_) {
+    table_.AppendOriginalLines(cached_starts);
+    table_.FinishOriginal();
+    ViewMemory view;
+    if (IndexCache::LoadView(*cache_key_, view)) {
+      remembered_view_ = std::move(view);
+    }
+  } else {
+    // Index synchronously until the first lines are known (or all of them,
+    // for files that were read); a mapped file continues in the background.
+    indexer_.Start(text, mapped ? kInitialIndexLines : SIZE_MAX,
+                   index_batch_);
+    table_.AppendOriginalLines(index_batch_);
+    index_batch_.clear();
+    if (!indexer_.IsRunning()) {
+      table_.FinishOriginal();
+      StoreIndex();
+    }
   }
 
+  if (table_.LineCount() == 0) {
+    table_.InsertLine(0, "");
+  }
+
+  MarkReloaded();
   file_path_ = file_path;
+  mapped_path_ = mapped ? file_path : std::string{};
   dirty_ = false;
+  read_only_ = false;
+  following_ = false;
+  streaming_ = false;
+  dropped_lines_ = 0;
+  if (swap_ != nullptr) {
+    // A reload starts the journal over; another file gets its own.
+    if (swap_->Path() == SwapFile::PathFor(file_path)) {
+      swap_->MarkSaved(revision_, FileStamp::Of(file_path));
+    } else {
+      swap_.reset();
+      swap_status_ = SwapStatus::kNone;
+    }
+  }
   return true;
 }
 
-bool Buffer::SaveToFile(const std::string& file_path) {
-  const std::string kPath = file_path.empty() ? file_path_ : file_path;
-  if (kPath.empty()) {
+bool Buffer::SaveToFile(const std::string& file_path,
+                        std::uint64_t* bytes_written) {
+  SaveJob job;
+  if (!PrepareSave(file_path, job) || !job.Write(bytes_written)) {
     return false;
   }
+  FinishSave(job);
+  return true;
+}
 
-  std::ofstream output(kPath, std::ios::trunc);
-  if (!output.is_open()) {
+bool Buffer::PrepareSave(const std::string& file_path, SaveJob& job) {
+  job.path = file_path.empty() ? file_path_ : file_path;
+  if (job.path.empty() || paged_ != nullptr) {
     return false;
   }
 
-  for (std::size_t i = 0; i < lines_.size(); ++i) {
-    output << lines_[i];
-    if (i + 1 < lines_.size()) {
-      output << kLineSeparator;
+  FinishIndexing();
+#ifdef _WIN32
+  if (!mapped_path_.empty()) {
+    // A file with a mapped view cannot be replaced on Windows.
+    std::error_code error;
+    if (std::filesystem::equivalent(job.path, mapped_path_, error)) {
+      table_.DetachOriginal();
+      mapped_path_.clear();
     }
   }
+#endif
 
-  file_path_ = kPath;
-  dirty_ = false;
+  job.snapshot = table_.Snapshot(0);
+  job.line_ending = line_ending_;
+  job.final_newline = final_newline_;
+  job.empty_when_blank = loaded_bytes_ == 0;
+  job.revision = revision_;
+  if (swap_ != nullptr) {
+    swap_->Seal();
+  }
+  return true;
+}
+
+void Buffer::FinishSave(const SaveJob& job) {
+  if (swap_ != nullptr && swap_->Path() == SwapFile::PathFor(job.path)) {
+    swap_->MarkSaved(job.revision, FileStamp::Of(job.path));
+  }
+  if (job.path == file_path_) {
+    cache_key_.reset();
+  }
+  file_path_ = job.path;
+  if (job.revision == revision_) {
+    journal_.MarkSaved();
+    dirty_ = false;
+  }
+}
+
+bool SaveJob::Write(std::uint64_t* bytes_written) const {
+  // Unchanged runs are written straight from the original text; on POSIX the
+  // rename leaves a mapped original intact, since the mapping keeps the old
+  // file alive.
+  MICROVI_PROFILE_SCOPE(kSave);
+  AtomicFileWriter writer;
+  if (!writer.Open(path)) {
+    return false;
+  }
+
+  const std::string_view kSeparator =
+      line_ending == LineEnding::kCrLf ? kCrLfSeparator : kLfSeparator;
+  bool first = true;
+  for (const TextSnapshot::Run& run : snapshot.runs) {
+    if (!first) {
+      writer.Append(kSeparator);
+    }
+    writer.Append(run.text);
+    first = false;
+  }
+
+  const bool kEmpty = empty_when_blank && snapshot.line_count == 1 &&
+                      snapshot.runs.size() == 1 &&
+                      snapshot.runs.front().text.empty();
+  if (final_newline && !kEmpty) {
+    writer.Append(kSeparator);
+  }
+
+  if (!writer.Commit()) {
+    return false;
+  }
+  MICROVI_PROFILE_COUNT(kSavedBytes, writer.BytesWritten());
+  if (bytes_written != nullptr) {
+    *bytes_written = writer.BytesWritten();
+  }
   return true;
 }
 
+bool Buffer::SyncIndex() {
+  if (paged_ != nullptr) {
+    if (!paged_->IsScanning()) {
+      return false;
+    }
+    const std::size_t kBefore = paged_->LineCount();
+    const bool kFinished = paged_->Sync();
+    if (paged_->LineCount() != kBefore) {
+      MarkChanged(kBefore, 0, paged_->LineCount() - kBefore);
+    }
+    return kFinished || paged_->LineCount() != kBefore;
+  }
+  if (!indexer_.IsRunning()) {
+    return false;
+  }
+
+  const std::size_t kBefore = table_.LineCount();
+  const bool kFinished = indexer_.Drain(index_batch_);
+  table_.AppendOriginalLines(index_batch_);
+  index_batch_.clear();
+  if (kFinished) {
+    table_.FinishOriginal();
+    StoreIndex();
+  }
+  if (table_.LineCount() != kBefore) {
+    MarkChanged(kBefore, 0, table_.LineCount() - kBefore);
+  }
+  return kFinished || table_.LineCount() != kBefore;
+}
+
+void Buffer::FinishIndexing(std::size_t lines) {
+  if (paged_ != nullptr) {
+    paged_->Wait(lines);
+  } else if (table_.LineCount() < lines) {
+    indexer_.Wait();
+  }
+  SyncIndex();
+}
+
+bool Buffer::IsIndexing() const noexcept {
+  return paged_ != nullptr ? paged_->IsScanning() : indexer_.IsRunning();
+}
+
+std::shared_ptr<const PagedText> Buffer::Paged() const noexcept {
+  return paged_;
+}
+
+LineEnding Buffer::GetLineEnding() const noexcept {
+  return line_ending_;
+}
+
+const TextStats& Buffer::GetTextStats() const noexcept {
+  if (paged_ != nullptr) {
+    return paged_->Stats();
+  }
+  return index_cached_ ? cached_stats_ : indexer_.Stats();
+}
+
+const IndexKey* Buffer::CacheKey() const noexcept {
+  return cache_key_.has_value() ? &*cache_key_ : nullptr;
+}
+
+std::optional<ViewMemory> Buffer::TakeRememberedView() {
+  std::optional<ViewMemory> view = std::move(remembered_view_);
+  remembered_view_.reset();
+  return view;
+}
+
 bool Buffer::InsertChar(std::size_t line, std::size_t column, char value) {
-  if (line >= lines_.size()) {
+  if (read_only_ || line >= table_.LineCount()) {
     return false;
   }
 
-  auto& current = lines_.at(line);
-  if (column > current.size()) {
+  if (column > table_.Line(line).size()) {
     return false;
   }
 
-  current.insert(current.begin() + static_cast<std::ptrdiff_t>(column), value);
+  journal_.Record({line, column}, {}, std::string_view(&value, 1));
+  table_.InsertChar(line, column, value);
+  MarkChanged(line, 1, 1);
+  SwapText({line, column}, 0, std::string_view(&value, 1));
   dirty_ = true;
   return true;
 }
 
 bool Buffer::DeleteChar(std::size_t line, std::size_t column) {
-  if (line >= lines_.size()) {
+  if (read_only_ || line >= table_.LineCount()) {
+    return false;
+  }
+
+  const std::string_view kLine = table_.Line(line);
+  if (column == 0 || column > kLine.size()) {
     return false;
   }
 
-  auto& current = lines_.at(line);
-  if (column == 0 || column > current.size()) {
+  journal_.Record({line, column - 1}, kLine.substr(column - 1, 1), {});
+  table_.EraseChar(line, column - 1);
+  MarkChanged(line, 1, 1);
+  SwapText({line, column - 1}, 1, {});
+  dirty_ = true;
+  return true;
+}
+
+bool Buffer::InsertLine(std::size_t line_index, std::string_view line) {
+  return InsertLineViews(line_index,
+                         std::span<const std::string_view>(&line, 1));
+}
+
+bool Buffer::InsertLines(std::size_t line_index,
+                         std::span<const std::string> lines) {
+  const std::vector<std::string_view> kViews(lines.begin(), lines.end());
+  return InsertLineViews(line_index, kViews);
+}
+
+bool Buffer::InsertLines(std::size_t line_index,
+                         std::span<const std::string_view> lines) {
+  return InsertLineViews(line_index, lines);
+}
+
+bool Buffer::InsertLines(std::size_t line_index, const LineSlice& lines) {
+  if (read_only_ || line_index > table_.LineCount()) {
     return false;
   }
+  if (lines.Empty()) {
+    return true;
+  }
 
-  current.erase(current.begin() + static_cast<std::ptrdiff_t>(column - 1));
+  table_.InsertSlice(line_index, lines);
+  journal_.RecordLines(line_index, {},
+                       table_.Extract(line_index, lines.LineCount()));
+  MarkChanged(line_index, 0, lines.LineCount());
+  SwapLines(line_index, 0, lines);
   dirty_ = true;
   return true;
 }
 
-bool Buffer::InsertLine(std::size_t line_index, const std::string& line) {
-  if (line_index > lines_.size()) {
+bool Buffer::InsertText(std::size_t line, std::size_t column,
+                        std::string_view text, TextPosition* end) {
+  if (read_only_ || !IsValid({line, column})) {
     return false;
   }
 
-  lines_.insert(lines_.begin() + static_cast<std::ptrdiff_t>(line_index),
-                  line);
+  journal_.Record({line, column}, {}, text);
+  const TextPosition kEnd = Insert({line, column}, text);
+  SwapText({line, column}, 0, text);
+  if (end != nullptr) {
+    *end = kEnd;
+  }
   dirty_ = true;
   return true;
 }
 
+bool Buffer::DeleteText(TextPosition start, std::size_t length) {
+  TextPosition end;
+  if (length == 0 || !Advance(start, length, end)) {
+    return false;
+  }
+  return Splice(start, end, {});
+}
+
+bool Buffer::Splice(TextPosition start, TextPosition end,
+                    std::string_view text, TextPosition* text_end) {
+  if (read_only_ || end < start || !IsValid(start) || !IsValid(end)) {
+    return false;
+  }
+
+  std::string removed;
+  AppendText(start, end, removed);
+  journal_.Record(start, removed, text);
+  Erase(start, end);
+  const TextPosition kEnd = Insert(start, text);
+  SwapText(start, removed.size(), text);
+  if (text_end != nullptr) {
+    *text_end = kEnd;
+  }
+  if (!removed.empty() || !text.empty()) {
+    dirty_ = true;
+  }
+  return true;
+}
+
 bool Buffer::DeleteLine(std::size_t line_index) {
-  if (line_index >= lines_.size()) {
+  return DeleteLines(line_index, 1) == 1;
+}
+
+std::size_t Buffer::DeleteLines(std::size_t line_index, std::size_t count,
+                                LineSlice* removed) {
+  const std::size_t kTotal = table_.LineCount();
+  if (read_only_ || line_index >= kTotal || count == 0) {
+    return 0;
+  }
+  count = (std::min)(count, kTotal - line_index);
+
+  LineSlice lines = table_.Extract(line_index, count);
+  if (kTotal == 1 && table_.Line(0).empty()) {
+    // Deleting the only, empty line leaves the document as it was.
+    if (removed != nullptr) {
+      *removed = std::move(lines);
+    }
+    return count;
+  }
+  table_.EraseLines(line_index, count);
+  LineSlice placeholder;
+  if (table_.LineCount() == 0) {
+    table_.InsertLine(0, "");
+    placeholder = table_.Extract(0, 1);
+  }
+  if (removed != nullptr) {
+    *removed = lines;
+  }
+  MarkChanged(line_index, count, placeholder.LineCount());
+  SwapLines(line_index, count, placeholder);
+  journal_.RecordLines(line_index, std::move(lines), std::move(placeholder));
+
+  dirty_ = true;
+  return count;
+}
+
+bool Buffer::ReplaceLine(std::size_t line_index, std::string_view line) {
+  if (read_only_ || line_index >= table_.LineCount()) {
+    return false;
+  }
+
+  // Only the differing middle of the line is journaled.
+  const std::string_view kOld = table_.Line(line_index);
+  const std::size_t kShorter = (std::min)(kOld.size(), line.size());
+  std::size_t prefix = 0;
+  while (prefix < kShorter && kOld[prefix] == line[prefix]) {
+    ++prefix;
+  }
+  std::size_t suffix = 0;
+  while (suffix < kShorter - prefix &&
+         kOld[kOld.size() - suffix - 1] == line[line.size() - suffix - 1]) {
+    ++suffix;
+  }
+  const std::size_t kRemoved = kOld.size() - prefix - suffix;
+  const std::string_view kInserted =
+      line.substr(prefix, line.size() - prefix - suffix);
+  journal_.Record({line_index, prefix}, kOld.substr(prefix, kRemoved),
+                  kInserted);
+
+  table_.ReplaceLine(line_index, line);
+  MarkChanged(line_index, 1, 1);
+  SwapText({line_index, prefix}, kRemoved, kInserted);
+  dirty_ = true;
+  return true;
+}
+
+void LineBatch::Reserve(std::size_t lines, std::size_t bytes) {
+  text_.reserve(bytes);
+  starts_.reserve(lines);
+  changes_.reserve(lines);
+}
+
+void LineBatch::Begin(std::size_t line) {
+  starts_.push_back(text_.size());
+  changes_.push_back({line, {}});
+}
+
+void LineBatch::Append(std::string_view text) {
+  text_.append(text);
+}
+
+void LineBatch::AppendRepeated(char value, std::size_t count) {
+  text_.append(count, value);
+}
+
+bool LineBatch::Empty() const noexcept {
+  return changes_.empty();
+}
+
+std::span<const LineChange> LineBatch::Changes() {
+  // The views are taken only now, as appending may move the text.
+  const std::string_view kText(text_);
+  for (std::size_t i = 0; i < changes_.size(); ++i) {
+    const std::size_t kEnd =
+        i + 1 < starts_.size() ? starts_[i + 1] : kText.size();
+    changes_[i].text = kText.substr(starts_[i], kEnd - starts_[i]);
+  }
+  return changes_;
+}
+
+bool Buffer::ReplaceLineBatch(std::span<const LineChange> changes) {
+  if (read_only_) {
+    return false;
+  }
+  if (changes.empty()) {
+    return true;
+  }
+  for (std::size_t i = 1; i < changes.size(); ++i) {
+    if (changes[i].line <= changes[i - 1].line) {
+      return false;
+    }
+  }
+  const std::size_t kFirst = changes.front().line;
+  const std::size_t kCount = changes.back().line + 1 - kFirst;
+  if (changes.back().line >= table_.LineCount()) {
+    return false;
+  }
+
+  LineSlice removed = table_.Extract(kFirst, kCount);
+  std::vector<std::string_view> run;
+  for (std::size_t begin = 0; begin < changes.size();) {
+    std::size_t end = begin + 1;
+    while (end < changes.size() &&
+           changes[end].line == changes[end - 1].line + 1) {
+      ++end;
+    }
+    run.clear();
+    for (std::size_t i = begin; i < end; ++i) {
+      run.push_back(changes[i].text);
+    }
+    table_.EraseLines(changes[begin].line, end - begin);
+    table_.InsertLines(changes[begin].line, run);
+    begin = end;
+  }
+
+  LineSlice inserted = table_.Extract(kFirst, kCount);
+  MarkChanged(kFirst, kCount, kCount);
+  SwapLines(kFirst, kCount, inserted);
+  journal_.RecordLines(kFirst, std::move(removed), std::move(inserted));
+  dirty_ = true;
+  return true;
+}
+
+bool Buffer::ReplaceLineRange(std::size_t line_index, std::size_t count,
+                              std::span<const std::string_view> lines) {
+  const std::size_t kTotal = table_.LineCount();
+  if (read_only_ || line_index > kTotal || count > kTotal - line_index) {
+    return false;
+  }
+  if (count == 0 && lines.empty()) {
+    return true;
+  }
+
+  // The removed lines keep their text alive, so the views stay good while
+  // they are copied in.
+  LineSlice removed = table_.Extract(line_index, count);
+  table_.EraseLines(line_index, count);
+  std::size_t inserted_count = lines.size();
+  if (!lines.empty()) {
+    table_.InsertLines(line_index, lines);
+  } else if (table_.LineCount() == 0) {
+    table_.InsertLine(0, "");
+    inserted_count = 1;
+  }
+
+  LineSlice inserted = table_.Extract(line_index, inserted_count);
+  MarkChanged(line_index, count, inserted_count);
+  SwapLines(line_index, count, inserted);
+  journal_.RecordLines(line_index, std::move(removed), std::move(inserted));
+  dirty_ = true;
+  return true;
+}
+
+std::size_t Buffer::DeleteLineRuns(std::span<const LineRange> runs) {
+  const std::size_t kTotal = table_.LineCount();
+  if (read_only_ || runs.empty() || runs.back().last > kTotal) {
+    return 0;
+  }
+  std::size_t deleted = 0;
+  for (std::size_t i = 0; i < runs.size(); ++i) {
+    if (runs[i].Empty() || (i > 0 && runs[i].first <= runs[i - 1].last)) {
+      return 0;
+    }
+    deleted += runs[i].last - runs[i].first;
+  }
+  if (runs.size() == 1) {
+    return DeleteLines(runs.front().first, deleted);
+  }
+
+  const std::size_t kFirst = runs.front().first;
+  const std::size_t kCount = runs.back().last - kFirst;
+  LineSlice removed = table_.Extract(kFirst, kCount);
+  // From the last run back, so the earlier ones keep their line numbers.
+  for (std::size_t i = runs.size(); i-- > 0;) {
+    table_.EraseLines(runs[i].first, runs[i].last - runs[i].first);
+  }
+
+  LineSlice kept = table_.Extract(kFirst, kCount - deleted);
+  MarkChanged(kFirst, kCount, kCount - deleted);
+  // The swap file gets each run on its own rather than every kept line.
+  for (std::size_t i = runs.size(); i-- > 0;) {
+    SwapLines(runs[i].first, runs[i].last - runs[i].first, {});
+  }
+  journal_.RecordLines(kFirst, std::move(removed), std::move(kept));
+  dirty_ = true;
+  return deleted;
+}
+
+void Buffer::CloseUndoStep() noexcept {
+  journal_.CloseStep();
+}
+
+bool Buffer::Undo(TextPosition* cursor) {
+  if (read_only_) {
+    return false;
+  }
+  TextPosition start;
+  const bool kUndone =
+      journal_.Undo([this, &start](const UndoJournal::Edit& edit) {
+        if (edit.removed_lines != nullptr) {
+          ReplaceLines(edit.position.line, edit.inserted_lines->LineCount(),
+                       *edit.removed_lines);
+          SwapLines(edit.position.line, edit.inserted_lines->LineCount(),
+                    *edit.removed_lines);
+        } else {
+          Erase(edit.position, PositionAfter(edit.position, edit.inserted));
+          Insert(edit.position, edit.removed);
+          SwapText(edit.position, edit.inserted.size(), edit.removed);
+        }
+        start = edit.position;
+      });
+  if (!kUndone) {
+    return false;
+  }
+
+  if (cursor != nullptr) {
+    *cursor = start;
+  }
+  dirty_ = !journal_.AtSaved();
+  return true;
+}
+
+bool Buffer::Redo(TextPosition* cursor) {
+  if (read_only_) {
+    return false;
+  }
+  std::optional<TextPosition> start;
+  const bool kRedone =
+      journal_.Redo([this, &start](const UndoJournal::Edit& edit) {
+        if (edit.removed_lines != nullptr) {
+          ReplaceLines(edit.position.line, edit.removed_lines->LineCount(),
+                       *edit.inserted_lines);
+          SwapLines(edit.position.line, edit.removed_lines->LineCount(),
+                    *edit.inserted_lines);
+        } else {
+          Erase(edit.position, PositionAfter(edit.position, edit.removed));
+          Insert(edit.position, edit.inserted);
+          SwapText(edit.position, edit.removed.size(), edit.inserted);
+        }
+        if (!start.has_value()) {
+          start = edit.position;
+        }
+      });
+  if (!kRedone) {
     return false;
   }
 
-  lines_.erase(lines_.begin() + static_cast<std::ptrdiff_t>(line_index));
-  if (lines_.empty()) {
-    lines_.emplace_back("");
+  if (cursor != nullptr && start.has_value()) {
+    *cursor = *start;
+  }
+  dirty_ = !journal_.AtSaved();
+  return true;
+}
+
+const UndoJournal& Buffer::History() const noexcept {
+  return journal_;
+}
+
+SwapStatus Buffer::StartSwap(bool recover, std::size_t* recovered) {
+  // A paged file cannot be edited, so it has nothing to journal.
+  if (file_path_.empty() || swap_ != nullptr || paged_ != nullptr) {
+    return swap_status_;
+  }
+
+  const std::string kSwapPath = SwapFile::PathFor(file_path_);
+  const FileStamp kStamp = FileStamp::Of(file_path_);
+  SwapContents contents;
+  const bool kFound = SwapFile::Load(kSwapPath, contents);
+  std::error_code error;
+  if (!kFound && std::filesystem::exists(kSwapPath, error)) {
+    // Unreadable, or not a swap file at all; either way not ours to replace.
+    swap_status_ = SwapStatus::kExists;
+    return swap_status_;
+  }
+  if (kFound && !recover) {
+    swap_status_ = SwapStatus::kExists;
+    return swap_status_;
+  }
+  if (kFound && contents.base != kStamp) {
+    swap_status_ = SwapStatus::kStale;
+    return swap_status_;
+  }
+
+  swap_ = std::make_unique<SwapFile>();
+  if (!swap_->Open(kSwapPath, kStamp)) {
+    swap_.reset();
+    swap_status_ = SwapStatus::kFailed;
+    return swap_status_;
+  }
+  if (!recover) {
+    swap_status_ = SwapStatus::kStarted;
+    return swap_status_;
   }
+  if (!kFound) {
+    swap_status_ = SwapStatus::kMissing;
+    return swap_status_;
+  }
+
+  // Replayed through the journaled edits, so the recovered changes undo as
+  // one step and are journaled again in the new swap file.
+  FinishIndexing();
+  const std::size_t kReplayed = Replay(contents);
+  if (recovered != nullptr) {
+    *recovered = kReplayed;
+  }
+  swap_status_ = SwapStatus::kRecovered;
+  return swap_status_;
+}
+
+SwapStatus Buffer::GetSwapStatus() const noexcept {
+  return swap_status_;
+}
 
+void Buffer::PreserveSwap() {
+  if (swap_ != nullptr) {
+    swap_->Preserve();
+  }
+}
+
+std::size_t Buffer::MemoryUsage() const noexcept {
+  return table_.MemoryUsage(mapped_path_.empty()) + journal_.MemoryUsage() +
+         index_batch_.capacity() * sizeof(std::uint64_t) +
+         (paged_ != nullptr ? paged_->MemoryUsage() : 0);
+}
+
+bool Buffer::InsertLineViews(std::size_t line_index,
+                             std::span<const std::string_view> lines) {
+  if (read_only_ || line_index > table_.LineCount()) {
+    return false;
+  }
+  if (lines.empty()) {
+    return true;
+  }
+
+  table_.InsertLines(line_index, lines);
+  LineSlice inserted = table_.Extract(line_index, lines.size());
+  MarkChanged(line_index, 0, lines.size());
+  SwapLines(line_index, 0, inserted);
+  journal_.RecordLines(line_index, {}, std::move(inserted));
   dirty_ = true;
   return true;
 }
 
+void Buffer::ReplaceLines(std::size_t line_index, std::size_t count,
+                          const LineSlice& lines) {
+  table_.EraseLines(line_index, count);
+  table_.InsertSlice(line_index, lines);
+  MarkChanged(line_index, count, lines.LineCount());
+}
+
+TextPosition Buffer::Insert(TextPosition at, std::string_view text) {
+  if (text.empty()) {
+    return at;
+  }
+
+  const std::string_view kCurrent = table_.Line(at.line);
+  std::size_t break_position = text.find('\n');
+  if (break_position == std::string_view::npos) {
+    std::string joined;
+    joined.reserve(kCurrent.size() + text.size());
+    joined.append(kCurrent.substr(0, at.column));
+    joined.append(text);
+    joined.append(kCurrent.substr(at.column));
+    table_.ReplaceLine(at.line, joined);
+    MarkChanged(at.line, 1, 1);
+    return {at.line, at.column + text.size()};
+  }
+
+  std::string first(kCurrent.substr(0, at.column));
+  first.append(text.substr(0, break_position));
+  std::string last;
+
+  std::vector<std::string_view> rest;
+  std::size_t position = break_position + 1;
+  while ((break_position = text.find('\n', position)) !=
+         std::string_view::npos) {
+    rest.push_back(text.substr(position, break_position - position));
+    position = break_position + 1;
+  }
+  last.append(text.substr(position));
+  const std::size_t kEndColumn = last.size();
+  last.append(kCurrent.substr(at.column));
+  rest.push_back(last);
+
+  table_.ReplaceLine(at.line, first);
+  table_.InsertLines(at.line + 1, rest);
+  MarkChanged(at.line, 1, rest.size() + 1);
+  return {at.line + rest.size(), kEndColumn};
+}
+
+void Buffer::Erase(TextPosition start, TextPosition end) {
+  if (start == end) {
+    return;
+  }
+
+  if (start.line == end.line) {
+    std::string line(table_.Line(start.line));
+    line.erase(start.column, end.column - start.column);
+    table_.ReplaceLine(start.line, line);
+    MarkChanged(start.line, 1, 1);
+    return;
+  }
+
+  std::string joined(table_.Line(start.line).substr(0, start.column));
+  joined.append(table_.Line(end.line).substr(end.column));
+  table_.EraseLines(start.line + 1, end.line - start.line);
+  table_.ReplaceLine(start.line, joined);
+  MarkChanged(start.line, end.line - start.line + 1, 1);
+}
+
+bool Buffer::IsValid(TextPosition position) const {
+  return position.line < LineCount() &&
+         position.column <= GetLine(position.line).size();
+}
+
+bool Buffer::Advance(TextPosition start, std::size_t length,
+                     TextPosition& end) const {
+  if (!IsValid(start)) {
+    return false;
+  }
+
+  std::size_t line = start.line;
+  std::size_t column = start.column;
+  while (true) {
+    const std::size_t kAvailable = GetLine(line).size() - column;
+    if (length <= kAvailable) {
+      end = {line, column + length};
+      return true;
+    }
+    if (line + 1 >= LineCount()) {
+      return false;
+    }
+    length -= kAvailable + 1;
+    ++line;
+    column = 0;
+  }
+}
+
+void Buffer::AppendText(TextPosition start, TextPosition end,
+                        std::string& text) const {
+  if (start.line == end.line) {
+    const std::string_view kLine = GetLine(start.line);
+    text.append(kLine.substr(start.column, end.column - start.column));
+    return;
+  }
+
+  text.append(GetLine(start.line).substr(start.column));
+  for (std::size_t line = start.line + 1; line < end.line; ++line) {
+    text.push_back('\n');
+    text.append(GetLine(line));
+  }
+  text.push_back('\n');
+  text.append(GetLine(end.line).substr(0, end.column));
+}
+
+void Buffer::SwapText(TextPosition position, std::size_t removed,
+                      std::string_view inserted) {
+  if (swap_ != nullptr) {
+    swap_->Record(revision_, position, removed, inserted);
+  }
+}
+
+void Buffer::SwapLines(std::size_t line_index, std::size_t removed,
+                       const LineSlice& inserted) {
+  if (swap_ != nullptr) {
+    swap_->RecordLines(revision_, line_index, removed, inserted);
+  }
+}
+
+std::size_t Buffer::Replay(const SwapContents& contents) {
+  // Stops at the first edit that does not fit, as one of a damaged file.
+  std::size_t replayed = 0;
+  std::vector<std::string_view> lines;
+  for (const SwapRecord& record : contents.records) {
+    if (!record.whole_lines) {
+      TextPosition end;
+      if (!Advance(record.position, record.removed, end) ||
+          !Splice(record.position, end, record.text)) {
+        break;
+      }
+      ++replayed;
+      continue;
+    }
+
+    const std::size_t kLine = record.position.line;
+    if (kLine > table_.LineCount() ||
+        record.removed > table_.LineCount() - kLine) {
+      break;
+    }
+    lines.clear();
+    if (record.lines > 0) {
+      std::string_view rest = record.text;
+      for (std::size_t index = rest.find('\n');
+           index != std::string_view::npos; index = rest.find('\n')) {
+        lines.push_back(rest.substr(0, index));
+        rest.remove_prefix(index + 1);
+      }
+      lines.push_back(rest);
+    }
+    if (lines.size() != record.lines ||
+        table_.LineCount() - record.removed + lines.size() == 0) {
+      break;
+    }
+
+    LineSlice removed = table_.Extract(kLine, record.removed);
+    ReplaceLines(kLine, record.removed, LineSlice::FromLines(lines));
+    LineSlice inserted = table_.Extract(kLine, lines.size());
+    SwapLines(kLine, record.removed, inserted);
+    journal_.RecordLines(kLine, std::move(removed), std::move(inserted));
+    ++replayed;
+  }
+
+  journal_.CloseStep();
+  if (replayed > 0) {
+    dirty_ = true;
+  }
+  return replayed;
+}
+
 std::size_t Buffer::LineCount() const noexcept {
-  return lines_.size();
+  return paged_ != nullptr ? paged_->LineCount() : table_.LineCount();
 }
 
-const std::string& Buffer::GetLine(std::size_t line_index) const {
-  if (line_index >= lines_.size()) {
+std::string_view Buffer::GetLine(std::size_t line_index) const {
+  if (line_index >= LineCount()) {
     throw std::out_of_range("line index out of range");
   }
-  return lines_.at(line_index);
+  return paged_ != nullptr ? paged_->Line(line_index)
+                           : table_.Line(line_index);
 }
 
-std::string& Buffer::GetLine(std::size_t line_index) {
-  if (line_index >= lines_.size()) {
-    throw std::out_of_range("line index out of range");
+LineSlice Buffer::CopyLines(std::size_t line_index, std::size_t count) {
+  if (line_index >= LineCount()) {
+    return {};
   }
-  dirty_ = true;
-  return lines_.at(line_index);
+  if (paged_ != nullptr) {
+    // Copied, since the views of a paged file do not last.
+    const std::size_t kCount = (std::min)(count, LineCount() - line_index);
+    std::vector<std::string> copies;
+    copies.reserve(kCount);
+    for (std::size_t line = line_index; line < line_index + kCount; ++line) {
+      copies.emplace_back(paged_->Line(line));
+    }
+    const std::vector<std::string_view> kViews(copies.begin(), copies.end());
+    return LineSlice::FromLines(kViews);
+  }
+  return table_.Extract(line_index,
+                        (std::min)(count, table_.LineCount() - line_index));
+}
+
+bool Buffer::CopyText(TextPosition start, TextPosition end,
+                      std::string& text) const {
+  if (end < start || !IsValid(start) || !IsValid(end)) {
+    return false;
+  }
+  AppendText(start, end, text);
+  return true;
+}
+
+TextSnapshot Buffer::Snapshot(std::size_t split_line) {
+  return table_.Snapshot(split_line);
 }
 
 const std::string& Buffer::FilePath() const noexcept {
@@ -148,4 +1041,399 @@ bool Buffer::IsDirty() const noexcept {
 void Buffer::MarkDirty(bool dirty) noexcept {
   dirty_ = dirty;
 }
-}  // namespace core
\ No newline at end of file
+
+void Buffer::SetReadOnly(bool read_only) noexcept {
+  read_only_ = read_only || paged_ != nullptr || streaming_;
+}
+
+bool Buffer::IsReadOnly() const noexcept {
+  return read_only_;
+}
+
+bool Buffer::StartFollowing(std::size_t scrollback) {
+  if (following_) {
+    DropFollowed(scrollback);
+    return true;
+  }
+  if (file_path_.empty() || dirty_ || paged_ != nullptr) {
+    return false;
+  }
+
+  FinishIndexing();
+  journal_.Clear();
+  swap_.reset();
+  swap_status_ = SwapStatus::kNone;
+  cache_key_.reset();
+  remembered_view_.reset();
+  read_only_ = true;
+  following_ = true;
+  follow_offset_ = loaded_bytes_;
+  if (loaded_bytes_ == 0) {
+    // Nothing was loaded, so the first line is the file's first.
+    final_newline_ = false;
+  }
+  kept_bytes_ = static_cast<std::size_t>(loaded_bytes_);
+  dropped_bytes_ = 0;
+
+  const std::size_t kLines = table_.LineCount();
+  scrollback = (std::max<std::size_t>)(scrollback, 1);
+  if (kLines > scrollback) {
+    table_.EraseLines(0, kLines - scrollback);
+    dropped_lines_ += kLines - scrollback;
+    MarkDropped(kLines - scrollback);
+  }
+  // A mapping would fault on a file truncated under it.
+  if (!mapped_path_.empty() || kLines > scrollback) {
+    CompactFollowed();
+  }
+  return true;
+}
+
+bool Buffer::IsFollowing() const noexcept {
+  return following_;
+}
+
+bool Buffer::SyncFollow(std::size_t scrollback, bool replaced, bool* more) {
+  if (more != nullptr) {
+    *more = false;
+  }
+  if (!following_) {
+    return false;
+  }
+
+  std::error_code error;
+  const std::uint64_t kSize = std::filesystem::file_size(file_path_, error);
+  if (error) {
+    // Gone for now; a rotated log is back soon.
+    return false;
+  }
+  if (replaced || kSize < follow_offset_) {
+    const std::string kPath = file_path_;
+    if (!LoadFromFile(kPath)) {
+      // Nothing worth showing is left; start again from an empty buffer.
+      table_.Clear();
+      table_.InsertLine(0, "");
+      loaded_bytes_ = 0;
+      following_ = false;
+      MarkReloaded();
+    }
+    StartFollowing(scrollback);
+    return true;
+  }
+  if (kSize == follow_offset_) {
+    return false;
+  }
+
+  std::ifstream input(file_path_, std::ios::binary);
+  if (!input.is_open()) {
+    return false;
+  }
+  input.seekg(static_cast<std::streamoff>(follow_offset_));
+  std::string bytes(static_cast<std::size_t>((std::min<std::uint64_t>)(
+                        kSize - follow_offset_, kFollowChunkBytes)),
+                    '\0');
+  input.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  bytes.resize(static_cast<std::size_t>(input.gcount()));
+  if (bytes.empty()) {
+    return false;
+  }
+  follow_offset_ += bytes.size();
+  if (more != nullptr) {
+    *more = follow_offset_ < kSize;
+  }
+
+  AppendFollowed(bytes);
+  DropFollowed(scrollback);
+  return true;
+}
+
+void Buffer::StartStream() {
+  indexer_.Stop();
+  journal_.Clear();
+  paged_.reset();
+  table_.Clear();
+  table_.InsertLine(0, "");
+  loaded_bytes_ = 0;
+  line_ending_ = LineEnding::kLf;
+  table_.SetLineEnding(line_ending_);
+  // The first line is the first one streamed.
+  final_newline_ = false;
+  cache_key_.reset();
+  index_cached_ = false;
+  remembered_view_.reset();
+  index_batch_.clear();
+
+  MarkReloaded();
+  file_path_.clear();
+  mapped_path_.clear();
+  dirty_ = false;
+  read_only_ = true;
+  following_ = false;
+  streaming_ = true;
+  dropped_lines_ = 0;
+  kept_bytes_ = 0;
+  dropped_bytes_ = 0;
+  swap_.reset();
+  swap_status_ = SwapStatus::kNone;
+}
+
+void Buffer::AppendStream(std::string_view bytes) {
+  if (!streaming_ || bytes.empty()) {
+    return;
+  }
+  if (table_.LineCount() == 1 && !final_newline_) {
+    // The first line ending decides, as it does for a loaded file; its '\r'
+    // may have come in the bytes before.
+    const std::size_t kBreak = bytes.find('\n');
+    if (kBreak != std::string_view::npos) {
+      const bool kCr = kBreak > 0 ? bytes[kBreak - 1] == '\r'
+                                  : table_.Line(0).ends_with('\r');
+      line_ending_ = kCr ? LineEnding::kCrLf : LineEnding::kLf;
+      table_.SetLineEnding(line_ending_);
+    }
+  }
+  AppendFollowed(bytes);
+  loaded_bytes_ += bytes.size();
+}
+
+void Buffer::EndStream() {
+  if (!streaming_) {
+    return;
+  }
+  streaming_ = false;
+  read_only_ = false;
+  if (loaded_bytes_ == 0) {
+    // Nothing came, so it is saved as a new file would be.
+    final_newline_ = true;
+  }
+}
+
+bool Buffer::IsStreaming() const noexcept {
+  return streaming_;
+}
+
+std::size_t Buffer::DroppedLines() const noexcept {
+  return dropped_lines_;
+}
+
+const LineRange& Buffer::Damage() const noexcept {
+  return damage_;
+}
+
+void Buffer::ClearDamage() noexcept {
+  damage_ = {};
+  changes_ = {};
+}
+
+const LineChanges& Buffer::Changes() const noexcept {
+  return changes_;
+}
+
+std::uint64_t Buffer::Revision() const noexcept {
+  return revision_;
+}
+
+void Buffer::MarkChanged(std::size_t first, std::size_t removed,
+                         std::size_t inserted) noexcept {
+  revision_ = NextRevision();
+  const std::size_t kLast =
+      removed == inserted ? first + inserted : kDamageToEnd;
+  if (damage_.Empty()) {
+    damage_ = {first, kLast};
+  } else {
+    damage_.first = (std::min)(damage_.first, first);
+    damage_.last = (std::max)(damage_.last, kLast);
+  }
+  MergeChanges(first, removed, inserted);
+}
+
+void Buffer::MergeChanges(std::size_t first, std::size_t removed,
+                          std::size_t inserted) noexcept {
+  // Merged like vim's b_mod_top/b_mod_bot: the end of the changed range
+  // moves with the lines below an edit, then grows to cover the edit.
+  const auto kShift = static_cast<std::ptrdiff_t>(inserted) -
+                      static_cast<std::ptrdiff_t>(removed);
+  if (changes_.Empty()) {
+    changes_ = {first, first + inserted, kShift};
+    return;
+  }
+  if (changes_.last == kDamageToEnd) {
+    changes_.first = (std::min)(changes_.first, first);
+    return;
+  }
+  changes_.first = (std::min)(changes_.first, first);
+  if (first < changes_.last) {
+    changes_.last = static_cast<std::size_t>(
+        (std::max)(static_cast<std::ptrdiff_t>(changes_.last) + kShift,
+                   static_cast<std::ptrdiff_t>(first)));
+  }
+  changes_.last = (std::max)(changes_.last, first + inserted);
+  changes_.shift += kShift;
+}
+
+bool Buffer::LoadPaged(const std::string& file_path) {
+  auto paged = std::make_shared<PagedText>();
+  if (!paged->Open(file_path, kInitialIndexLines)) {
+    return false;
+  }
+
+  indexer_.Stop();
+  journal_.Clear();
+  table_.Clear();
+  table_.InsertLine(0, "");
+  paged_ = std::move(paged);
+  loaded_bytes_ = paged_->Size();
+  line_ending_ = paged_->GetLineEnding();
+  final_newline_ = paged_->HasFinalNewline();
+  cache_key_.reset();
+  index_cached_ = false;
+  remembered_view_.reset();
+  index_batch_.clear();
+
+  MarkReloaded();
+  file_path_ = file_path;
+  mapped_path_.clear();
+  dirty_ = false;
+  read_only_ = true;
+  following_ = false;
+  streaming_ = false;
+  dropped_lines_ = 0;
+  swap_.reset();
+  swap_status_ = SwapStatus::kNone;
+  return true;
+}
+
+void Buffer::StoreIndex() {
+  if (!cache_key_.has_value()) {
+    return;
+  }
+  // The starts of a finished index stay put, and the owner keeps them
+  // alive however the buffer changes meanwhile.
+  std::shared_ptr<const void> owner;
+  const std::span<const std::uint64_t> kStarts =
+      table_.OriginalLineStarts(owner);
+  WorkerPool::Shared().Submit(
+      [key = *cache_key_, starts = kStarts, owner = std::move(owner),
+       stats = indexer_.Stats()](const std::stop_token& /*token*/) {
+        IndexCache::Store(key, starts, stats);
+      });
+}
+
+void Buffer::MarkReloaded() noexcept {
+  revision_ = NextRevision();
+  damage_ = {0, kDamageToEnd};
+  changes_ = {0, kDamageToEnd, 0};
+}
+
+void Buffer::MarkDropped(std::size_t count) noexcept {
+  revision_ = NextRevision();
+  if (!damage_.Empty()) {
+    damage_.first = damage_.first > count ? damage_.first - count : 0;
+    if (damage_.last != kDamageToEnd) {
+      damage_.last = damage_.last > count ? damage_.last - count : 0;
+    }
+  }
+  MergeChanges(0, count, 0);
+}
+
+void Buffer::AppendFollowed(std::string_view bytes) {
+  std::vector<std::string_view> lines;
+  std::size_t start = 0;
+  for (std::size_t end = bytes.find('\n'); end != std::string_view::npos;
+       end = bytes.find('\n', start)) {
+    lines.push_back(bytes.substr(start, end - start));
+    start = end + 1;
+  }
+  const bool kTerminated = start == bytes.size();
+  if (!kTerminated) {
+    lines.push_back(bytes.substr(start));
+  }
+
+  // Lines are kept as the file has them, less "\r\n" in a dos file.
+  const bool kCrLf = line_ending_ == LineEnding::kCrLf;
+  const auto kStrip = [kCrLf](std::string_view line) {
+    return kCrLf && line.ends_with('\r') ? line.substr(0, line.size() - 1)
+                                         : line;
+  };
+  for (std::size_t i = 0; i < lines.size(); ++i) {
+    if (i + 1 < lines.size() || kTerminated) {
+      lines[i] = kStrip(lines[i]);
+    }
+  }
+
+  // The first piece finishes a last line the file left unterminated.
+  const std::size_t kLast = table_.LineCount() - 1;
+  std::size_t first = 0;
+  if (!final_newline_) {
+    std::string joined(table_.Line(kLast));
+    joined.append(lines.front());
+    if (lines.size() > 1 || kTerminated) {
+      joined.resize(kStrip(joined).size());
+    }
+    table_.ReplaceLine(kLast, joined);
+    first = 1;
+  }
+  const std::span<const std::string_view> kAdded =
+      std::span<const std::string_view>(lines).subspan(first);
+  if (!kAdded.empty()) {
+    table_.InsertLines(table_.LineCount(), kAdded);
+  }
+  if (first == 1) {
+    MarkChanged(kLast, 1, 1 + kAdded.size());
+  } else {
+    MarkChanged(kLast + 1, 0, kAdded.size());
+  }
+  final_newline_ = kTerminated;
+  kept_bytes_ += bytes.size();
+}
+
+void Buffer::DropFollowed(std::size_t scrollback) {
+  scrollback = (std::max<std::size_t>)(scrollback, 1);
+  const std::size_t kLines = table_.LineCount();
+  if (kLines > scrollback) {
+    const std::size_t kCount = kLines - scrollback;
+    std::size_t bytes = 0;
+    for (std::size_t line = 0; line < kCount; ++line) {
+      bytes += table_.Line(line).size() + 1;
+    }
+    table_.EraseLines(0, kCount);
+    dropped_lines_ += kCount;
+    dropped_bytes_ += bytes;
+    kept_bytes_ -= (std::min)(kept_bytes_, bytes);
+    MarkDropped(kCount);
+  }
+
+  // Copying what is kept once as much was dropped holds memory to about
+  // twice the scrollback, at a cost spread evenly over what was appended.
+  if (dropped_bytes_ > (std::max)(kept_bytes_, kCompactBytes)) {
+    CompactFollowed();
+  }
+}
+
+void Buffer::CompactFollowed() {
+  std::size_t size = 0;
+  table_.ForEachRun([&size](std::string_view run) { size += run.size() + 1; });
+  auto text = std::make_shared<std::string>();
+  text->reserve(size);
+  table_.ForEachRun([&text](std::string_view run) {
+    text->append(run);
+    text->push_back('\n');
+  });
+  std::vector<std::uint64_t> starts;
+  for (std::size_t end = text->find('\n'); end + 1 < text->size();
+       end = text->find('\n', end + 1)) {
+    starts.push_back(end + 1);
+  }
+
+  const std::string_view kText = *text;
+  table_.Load(kText, std::move(text));
+  table_.SetLineEnding(line_ending_);
+  table_.AppendOriginalLines(starts);
+  table_.FinishOriginal();
+  mapped_path_.clear();
+  kept_bytes_ = kText.size();
+  dropped_bytes_ = 0;
+  // The lines are the same; only the views into them went stale.
+  revision_ = NextRevision();
+}
+}  // namespace core
@@ -0,0 +1,143 @@
+#include "core/ChordResolver.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace {
+constexpr std::size_t kMaxCount = 1000000;
+
+bool IsDigitKey(const core::KeyEvent& event) {
+  return event.code == core::KeyCode::kCharacter &&
+         std::isdigit(static_cast<unsigned char>(event.value)) != 0;
+}
+}  // namespace
+
+namespace core {
+ChordOutcome ChordResolver::Feed(const Keymap& keymap, Mode mode,
+                                 const KeyEvent& event, Clock::time_point now,
+                                 ChordMatch& match) {
+  if (AcceptDigit(keymap, event)) {
+    AppendTyped(event);
+    return ChordOutcome::kPending;
+  }
+
+  Keymap::NodeId next = 0;
+  if (node_ == 0) {
+    next = keymap.Root(mode, event);
+  } else {
+    next = keymap.Child(node_, event);
+    if (next == 0 && event.code == KeyCode::kCharacter &&
+        event.value != '\0') {
+      next = keymap.CharChild(node_);
+      if (next != 0) {
+        operand_ = event.value;
+      }
+    }
+  }
+
+  if (next == 0) {
+    if (node_ != 0 && keymap.BindingAt(node_) != nullptr) {
+      Finish(keymap, node_, match);
+      return ChordOutcome::kMatchedBefore;
+    }
+    Reset();
+    return ChordOutcome::kNoMatch;
+  }
+  if (!keymap.HasChildren(next)) {
+    Finish(keymap, next, match);
+    return ChordOutcome::kMatched;
+  }
+
+  node_ = next;
+  AppendTyped(event);
+  deadline_.reset();
+  if (keymap.BindingAt(next) != nullptr && timeout_.count() >= 0) {
+    deadline_ = now + timeout_;
+  }
+  return ChordOutcome::kPending;
+}
+
+std::optional<ChordResolver::Clock::time_point> ChordResolver::Deadline()
+    const noexcept {
+  return deadline_;
+}
+
+bool ChordResolver::Expire(const Keymap& keymap, Clock::time_point now,
+                           ChordMatch& match) {
+  if (!deadline_.has_value() || now < *deadline_ || node_ == 0 ||
+      keymap.BindingAt(node_) == nullptr) {
+    return false;
+  }
+  Finish(keymap, node_, match);
+  return true;
+}
+
+void ChordResolver::Reset() noexcept {
+  node_ = 0;
+  counts_[0] = 0;
+  counts_[1] = 0;
+  operand_ = '\0';
+  deadline_.reset();
+  typed_.clear();
+}
+
+bool ChordResolver::Pending() const noexcept {
+  return node_ != 0 || counts_[0] != 0;
+}
+
+std::string_view ChordResolver::Typed() const noexcept {
+  return typed_;
+}
+
+void ChordResolver::CarryCount(std::size_t count) {
+  Reset();
+  if (count != 0) {
+    counts_[0] = (std::min)(count, kMaxCount);
+    typed_ = std::to_string(counts_[0]);
+  }
+}
+
+void ChordResolver::SetTimeout(std::chrono::milliseconds timeout) noexcept {
+  timeout_ = timeout;
+}
+
+// A digit counts unless the chord could take it as a key: '0' before any
+// other digit, a digit the node has its own child for, or any digit where
+// the node takes <Char>, like the target of "f".
+bool ChordResolver::AcceptDigit(const Keymap& keymap, const KeyEvent& event) {
+  if (!IsDigitKey(event) || (node_ != 0 && keymap.CharChild(node_) != 0)) {
+    return false;
+  }
+  std::size_t& count = counts_[node_ == 0 ? 0 : 1];
+  if (count == 0 &&
+      (event.value == '0' || (node_ != 0 && keymap.Child(node_, event) != 0))) {
+    return false;
+  }
+  count = (std::min)(count * 10 + static_cast<std::size_t>(event.value - '0'),
+                     kMaxCount);
+  return true;
+}
+
+void ChordResolver::Finish(const Keymap& keymap, Keymap::NodeId node,
+                           ChordMatch& match) {
+  match.binding = keymap.BindingAt(node);
+  match.operand = operand_;
+  if (counts_[0] != 0 && counts_[1] != 0) {
+    match.count = (std::min)(counts_[0] * counts_[1], kMaxCount);
+  } else {
+    match.count = (std::max)(counts_[0], counts_[1]);
+  }
+  Reset();
+}
+
+void ChordResolver::AppendTyped(const KeyEvent& event) {
+  if (event.code == KeyCode::kCharacter) {
+    typed_.push_back(event.value);
+  }
+}
+}  // namespace core
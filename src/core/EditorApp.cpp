@@ -1,71 +1,178 @@
 #include "core/EditorApp.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <memory>
 #include <span>
 #include <string>
+#include <string_view>
 #include <thread>
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <csignal>
 #endif
 
-#include "commands/DeleteCommand.hpp"
-#include "commands/QuitCommand.hpp"
-#include "commands/WriteCommand.hpp"
+#include "commands/BuiltinCommands.hpp"
+#include "core/KeyNotation.hpp"
+#include "core/SwapFile.hpp"
+#include "core/WorkerPool.hpp"
+#include "io/Terminal.hpp"
 
 namespace {
-constexpr char kCommandPrefix = ':';
+// Background indexing has no wakeup of its own, so it is picked up at this
+// interval while it runs; background commands report progress as often.
+constexpr std::chrono::milliseconds kPollInterval{50};
+
+std::atomic<core::Waker*> g_resize_waker{nullptr};
+std::atomic<core::Waker*> g_hangup_waker{nullptr};
+std::atomic<bool> g_hung_up{false};
+
+#ifndef _WIN32
+void HandleResize(int /*signal*/) {
+  core::Waker* waker = g_resize_waker.load();
+  if (waker != nullptr) {
+    waker->Notify();
+  }
+}
+
+void HandleHangup(int /*signal*/) {
+  g_hung_up.store(true);
+  core::Waker* waker = g_hangup_waker.load();
+  if (waker != nullptr) {
+    waker->Notify();
+  }
+}
+#endif
 }  // namespace
 
 namespace core {
 
-EditorApp::EditorApp() : mode_controller_(state_, command_handler_) {
+EditorApp::EditorApp()
+    : mode_controller_(state_, command_handler_, plugin_host_) {
   ConfigureConsole();
-  command_handler_.RegisterCommand(std::make_unique<commands::WriteCommand>());
-  command_handler_.RegisterCommand(std::make_unique<commands::QuitCommand>());
-  command_handler_.RegisterCommand(std::make_unique<commands::DeleteCommand>());
+  plugin_host_.SetWakeHook([this] { wakeup_.Notify(); });
+  event_queue_.SetWakeHook([this] { wakeup_.Notify(); });
+  mode_controller_.SetSearchWakeHook([this] { wakeup_.Notify(); });
+  command_handler_.SetWakeHook([this] { wakeup_.Notify(); });
+  WorkerPool::Shared().SetWakeHook([this] { wakeup_.Notify(); });
+  commands::RegisterBuiltinCommands(command_handler_, plugin_host_);
 }
 
 int EditorApp::Run(int argc, char** argv) {
   renderer_.Prepare();
   LoadFile(argc, argv);
+  WatchTerminalResize(&wakeup_);
+  WatchHangup(&wakeup_);
   StartInputLoop();
   Render();
 
-  constexpr auto kFrameDuration = std::chrono::milliseconds(16);
-
+  // Sleeps until a key, a resize, a search result, a finished task, a plugin
+  // result, text from standard input, a chord timing out or indexing or
+  // command progress needs a frame; the renderer sends nothing when the frame
+  // did not change.
   while (state_.IsRunning()) {
-    const auto kFrameStart = std::chrono::steady_clock::now();
-    ProcessPendingEvents();
+    EventQueue::Clock::time_point first_arrival;
+    const bool kHadEvents = ProcessPendingEvents(first_arrival);
     if (!state_.IsRunning()) {
       break;
     }
+    if (input_closed_.load() || g_hung_up.load()) {
+      // Cut off rather than quit, as on a hangup: keep what was not saved.
+      state_.PreserveSwaps();
+      state_.RequestQuit();
+      break;
+    }
+
+    state_.GetBuffer().SyncIndex();
+    SyncStdin();
+    mode_controller_.SyncSearch();
+    mode_controller_.SyncChord();
+    command_handler_.Poll(state_);
+    plugin_host_.Poll(state_);
+    WorkerPool::Shared().RunCompletions();
 
     Render();
+    if (kHadEvents) {
+      state_.RecordInputLatency(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              EventQueue::Clock::now() - first_arrival));
+    }
 
-    const auto kElapsed = std::chrono::steady_clock::now() - kFrameStart;
-    if (kElapsed < kFrameDuration) {
-      std::this_thread::sleep_for(kFrameDuration - kElapsed);
+    const bool kPolling =
+        state_.GetBuffer().IsIndexing() || command_handler_.IsBusy();
+    std::chrono::milliseconds timeout =
+        kPolling ? kPollInterval : Waker::kForever;
+    if (const auto kDeadline = mode_controller_.ChordDeadline()) {
+      const auto kLeft = (std::max)(
+          std::chrono::ceil<std::chrono::milliseconds>(
+              *kDeadline - ChordResolver::Clock::now()),
+          std::chrono::milliseconds{0});
+      timeout = timeout == Waker::kForever ? kLeft : (std::min)(timeout, kLeft);
     }
+    wakeup_.Wait(timeout);
   }
 
+  // A save still being written is not abandoned.
+  command_handler_.Finish(state_);
+  state_.RememberViews();
+  WorkerPool::Shared().SetWakeHook({});
   StopInputLoop();
+  stdin_reader_.Stop();
+  WatchHangup(nullptr);
+  WatchTerminalResize(nullptr);
   renderer_.Restore();
   return 0;
 }
 
 void EditorApp::LoadFile(int argc, char** argv) {
-  auto& buffer = state_.GetBuffer();
   const std::span<char*> kArguments(argv, static_cast<std::size_t>(argc));
 
-  if (kArguments.size() <= 1) {
-    state_.SetStatus("New Buffer", StatusSeverity::kInfo);
+  // "-r file" recovers the edits in the file's swap file, as in vi; "-f
+  // file" follows it as tail -f does; "-R file" pages through it read-only,
+  // as files too big to load are anyway. "-w trace" appends the keys typed to
+  // trace, which microvi_replay plays back. A file named "-" is standard
+  // input.
+  std::size_t first = 1;
+  bool recover = false;
+  bool follow = false;
+  bool page = false;
+  std::string trace_path;
+  for (; kArguments.size() > first && kArguments[first] != nullptr;
+       ++first) {
+    const std::string_view kOption(kArguments[first]);
+    if (kOption == "-r") {
+      recover = true;
+    } else if (kOption == "-f") {
+      follow = true;
+    } else if (kOption == "-R") {
+      page = true;
+    } else if (kOption == "-w" && kArguments.size() > first + 1 &&
+               kArguments[first + 1] != nullptr) {
+      trace_path = kArguments[++first];
+    } else {
+      break;
+    }
+  }
+
+  if (!trace_path.empty()) {
+    const char* kFile =
+        kArguments.size() > first ? kArguments[first] : nullptr;
+    StartRecording(trace_path, kFile != nullptr ? kFile : "");
+  }
+
+  if (kArguments.size() <= first) {
+    const bool kNeedsFile = recover || follow || page;
+    state_.SetStatus(kNeedsFile ? "No file name" : "New Buffer",
+                     kNeedsFile ? StatusSeverity::kWarning
+                                : StatusSeverity::kInfo);
     return;
   }
 
-  const char* path_cstr = kArguments[1];
+  const char* path_cstr = kArguments[first];
   const std::string kPath =
       path_cstr != nullptr ? std::string(path_cstr) : std::string{};
 
@@ -73,21 +180,122 @@ void EditorApp::LoadFile(int argc, char** argv) {
     state_.SetStatus("New Buffer", StatusSeverity::kInfo);
     return;
   }
+  if (kPath == "-") {
+    ReadStdin();
+    return;
+  }
 
-  if (!buffer.LoadFromFile(kPath)) {
+  bool created = false;
+  state_.OpenBuffer(kPath, created,
+                    page ? LoadStrategy::kPage : LoadStrategy::kAuto);
+  Buffer& buffer = state_.GetBuffer();
+  if (created) {
     std::cerr << "Failed to load file: " << kPath << '\n';
-    buffer.SetFilePath(kPath);
     state_.SetStatus("New file", StatusSeverity::kInfo);
   } else {
-    state_.SetStatus("Loaded file", StatusSeverity::kInfo);
+    state_.SetStatus(buffer.Paged() != nullptr ? "Paging file, read-only"
+                                               : "Loaded file",
+                     StatusSeverity::kInfo);
+  }
+
+  const std::string kSwapPath = SwapFile::PathFor(kPath);
+  std::size_t recovered = 0;
+  switch (recover ? buffer.StartSwap(true, &recovered)
+                  : buffer.GetSwapStatus()) {
+    case SwapStatus::kStarted:
+      if (recover) {
+        state_.SetStatus("No swap file " + kSwapPath,
+                         StatusSeverity::kWarning);
+      }
+      break;
+    case SwapStatus::kExists:
+      state_.SetStatus("Swap file " + kSwapPath +
+                           " exists; recover with microvi -r " + kPath,
+                       StatusSeverity::kWarning);
+      break;
+    case SwapStatus::kRecovered:
+      state_.SetStatus("Recovered " + std::to_string(recovered) +
+                           (recovered == 1 ? " change" : " changes") +
+                           " from " + kSwapPath,
+                       StatusSeverity::kInfo);
+      break;
+    case SwapStatus::kMissing:
+      state_.SetStatus("No swap file " + kSwapPath, StatusSeverity::kWarning);
+      break;
+    case SwapStatus::kStale:
+      state_.SetStatus(kPath + " changed since " + kSwapPath +
+                           " was written; not recovered",
+                       StatusSeverity::kWarning);
+      break;
+    case SwapStatus::kFailed:
+      state_.SetStatus("Cannot create swap file " + kSwapPath,
+                       StatusSeverity::kWarning);
+      break;
+    case SwapStatus::kNone:
+      break;
+  }
+
+  if (follow) {
+    command_handler_.Handle(state_, "follow");
+  }
+}
+
+void EditorApp::StartRecording(const std::string& trace_path,
+                               const std::string& file_path) {
+  if (!record_.Open(trace_path)) {
+    state_.SetStatus("Cannot write " + trace_path, StatusSeverity::kWarning);
+    return;
+  }
+  const TerminalSize kSize = QueryTerminalSize();
+  std::string header = "size " + std::to_string(kSize.rows) + "x" +
+                       std::to_string(kSize.columns) + "\n";
+  if (!file_path.empty() && file_path != "-") {
+    header += "open " + file_path + "\n";
   }
+  record_.Append(header);
+}
+
+void EditorApp::ReadStdin() {
+  // Keys are read from the terminal instead; see ConsoleKeySource.
+  if (!stdin_reader_.Start([this] { wakeup_.Notify(); })) {
+    state_.SetStatus("Standard input is a terminal", StatusSeverity::kWarning);
+    return;
+  }
+  stdin_buffer_ = &state_.GetBuffer();
+  stdin_buffer_->StartStream();
+  state_.SetStatus("Reading standard input", StatusSeverity::kInfo);
+}
+
+void EditorApp::SyncStdin() {
+  if (stdin_buffer_ == nullptr) {
+    return;
+  }
+  std::string bytes;
+  const bool kClosed = stdin_reader_.Drain(bytes);
+  stdin_buffer_->AppendStream(bytes);
+  if (!kClosed) {
+    return;
+  }
+  stdin_buffer_->EndStream();
+  const std::size_t kLines = stdin_buffer_->LineCount();
+  stdin_buffer_ = nullptr;
+  stdin_reader_.Stop();
+  state_.SetStatus("Read " + std::to_string(kLines) +
+                       (kLines == 1 ? " line" : " lines") +
+                       " from standard input",
+                   StatusSeverity::kInfo);
 }
 
 void EditorApp::Render() {
-  renderer_.Render(state_, mode_controller_.CommandBuffer(), kCommandPrefix);
+  renderer_.Render(state_, mode_controller_.CommandBuffer(),
+                   mode_controller_.CommandPrefix());
+  state_.GetBuffer().ClearDamage();
 }
 
 void EditorApp::HandleEvent(const KeyEvent& event) {
+  if (record_.IsOpen()) {
+    AppendKeyNotation(event, recorded_keys_);
+  }
   mode_controller_.HandleEvent(event);
 }
 
@@ -118,29 +326,66 @@ void EditorApp::StartInputLoop() {
 void EditorApp::StopInputLoop() {
   if (input_thread_.joinable()) {
     input_thread_.request_stop();
+    input_interrupt_.Notify();
     input_thread_.join();
   }
+  input_interrupt_.Drain();
 }
 
 void EditorApp::InputLoop(const std::stop_token& token) {
   while (!token.stop_requested()) {
+    if (!key_source_.WaitForInput(input_interrupt_)) {
+      if (!token.stop_requested()) {
+        input_closed_.store(true);
+        wakeup_.Notify();
+      }
+      return;
+    }
+
     KeyEvent event{};
-    if (key_source_.Poll(event)) {
+    while (key_source_.Poll(event)) {
       event_queue_.Push(event);
-    } else {
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
+    wakeup_.Notify();
   }
 }
 
-void EditorApp::ProcessPendingEvents() {
-  auto events = event_queue_.ConsumeAll();
-  for (const KeyEvent& event : events) {
-    HandleEvent(event);
-    if (!state_.IsRunning()) {
-      break;
-    }
+bool EditorApp::ProcessPendingEvents(
+    EventQueue::Clock::time_point& first_arrival) {
+  const std::size_t kHandled = event_queue_.Drain(
+      [this](const KeyEvent& event) {
+        HandleEvent(event);
+        return state_.IsRunning();
+      },
+      &first_arrival);
+  if (!recorded_keys_.empty()) {
+    record_.Append("keys " + recorded_keys_ + "\n");
+    recorded_keys_.clear();
   }
+  return kHandled > 0;
+}
+
+void EditorApp::WatchTerminalResize(Waker* waker) {
+  g_resize_waker.store(waker);
+#ifndef _WIN32
+  struct sigaction action{};
+  action.sa_handler = waker != nullptr ? HandleResize : SIG_DFL;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGWINCH, &action, nullptr);
+#endif
+}
+
+void EditorApp::WatchHangup(Waker* waker) {
+  g_hangup_waker.store(waker);
+#ifndef _WIN32
+  struct sigaction action{};
+  action.sa_handler = waker != nullptr ? HandleHangup : SIG_DFL;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGHUP, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+#endif
 }
 
 }  // namespace core
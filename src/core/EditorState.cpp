@@ -1,20 +1,207 @@
 #include <algorithm>
 #include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 #include "core/Buffer.hpp"
 
 #include "core/EditorState.hpp"
+#include "core/IndexCache.hpp"
+#include "core/LineLayout.hpp"
 #include "core/Mode.hpp"
+#include "core/Utf8.hpp"
+
+namespace {
+// Paths name the same file if they reach the same inode, or, for files not
+// written yet, if they spell the same absolute path.
+bool SamePath(const std::string& first, const std::string& second) {
+  if (first == second) {
+    return true;
+  }
+  std::error_code error;
+  if (std::filesystem::equivalent(first, second, error)) {
+    return true;
+  }
+  const auto kFirst = std::filesystem::absolute(first, error);
+  const auto kSecond = std::filesystem::absolute(second, error);
+  return !error && kFirst.lexically_normal() == kSecond.lexically_normal();
+}
+
+// A buffer nothing was done to, like the one the editor starts with, which
+// the first file opened replaces. One still being streamed into is kept.
+bool IsUntouched(const core::Buffer& buffer) {
+  return buffer.FilePath().empty() && !buffer.IsDirty() &&
+         !buffer.IsStreaming() &&
+         buffer.LineCount() == 1 && buffer.GetLine(0).empty();
+}
+}  // namespace
 
 namespace core {
-EditorState::EditorState() = default;
+EditorState::EditorState() {
+  AddBuffer(std::make_unique<Buffer>());
+  Activate(0);
+}
 
 Buffer& EditorState::GetBuffer() noexcept {
-  return buffer_;
+  return *buffer_;
 }
 
 const Buffer& EditorState::GetBuffer() const noexcept {
-  return buffer_;
+  return *buffer_;
+}
+
+Highlighter& EditorState::GetHighlighter() noexcept {
+  return *buffers_[current_].highlighter;
+}
+
+std::uint64_t EditorState::BufferId() const noexcept {
+  return buffers_[current_].id;
+}
+
+bool EditorState::OpenBuffer(const std::string& path, bool& created,
+                             LoadStrategy strategy) {
+  created = false;
+  for (std::size_t index = 0; index < buffers_.size(); ++index) {
+    const BufferSlot& slot = buffers_[index];
+    if (SamePath(slot.buffer != nullptr ? slot.buffer->FilePath() : slot.path,
+                 path)) {
+      Activate(index);
+      return true;
+    }
+  }
+
+  auto buffer = std::make_unique<Buffer>();
+  if (!buffer->LoadFromFile(path, strategy)) {
+    buffer->SetFilePath(path);
+    created = true;
+  }
+  buffer->StartSwap(false);
+  if (!IsUntouched(*buffer_)) {
+    AddBuffer(std::move(buffer));
+    buffers_.back().strategy = strategy;
+    RestoreView(buffers_.back());
+    Activate(buffers_.size() - 1);
+    return true;
+  }
+
+  BufferSlot& slot = buffers_[current_];
+  slot.buffer = std::move(buffer);
+  slot.highlighter = std::make_unique<Highlighter>();
+  slot.path = path;
+  slot.strategy = strategy;
+  slot.id = next_id_++;
+  RestoreView(slot);
+  buffer_ = nullptr;
+  cursor_line_ = 0;
+  cursor_column_ = 0;
+  keeps_line_end_ = false;
+  viewport_ = {};
+  Activate(current_);
+  return true;
+}
+
+void EditorState::CycleBuffer(std::ptrdiff_t delta) {
+  const auto kCount = static_cast<std::ptrdiff_t>(buffers_.size());
+  const std::ptrdiff_t kTarget =
+      (static_cast<std::ptrdiff_t>(current_) + delta % kCount + kCount) %
+      kCount;
+  Activate(static_cast<std::size_t>(kTarget));
+}
+
+bool EditorState::SwitchBuffer(std::size_t number) {
+  for (std::size_t index = 0; index < buffers_.size(); ++index) {
+    if (buffers_[index].number == number) {
+      Activate(index);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool EditorState::ReloadBuffer() {
+  const std::string kPath = buffer_->FilePath();
+  BufferSlot& slot = buffers_[current_];
+  if (kPath.empty() || !buffer_->LoadFromFile(kPath, slot.strategy)) {
+    return false;
+  }
+  slot.highlighter = std::make_unique<Highlighter>();
+  slot.id = next_id_++;
+  ClampCursor();
+  return true;
+}
+
+std::size_t EditorState::BufferCount() const noexcept {
+  return buffers_.size();
+}
+
+std::vector<BufferListing> EditorState::ListBuffers() const {
+  std::vector<BufferListing> listings;
+  listings.reserve(buffers_.size());
+  for (std::size_t index = 0; index < buffers_.size(); ++index) {
+    const BufferSlot& slot = buffers_[index];
+    BufferListing& listing = listings.emplace_back();
+    listing.number = slot.number;
+    listing.current = index == current_;
+    listing.loaded = slot.buffer != nullptr;
+    if (listing.loaded) {
+      listing.path = slot.buffer->FilePath();
+      listing.lines = slot.buffer->LineCount();
+      listing.dirty = slot.buffer->IsDirty();
+    } else {
+      listing.path = slot.path;
+    }
+  }
+  return listings;
+}
+
+std::size_t EditorState::HiddenDirtyBuffer() const noexcept {
+  for (std::size_t index = 0; index < buffers_.size(); ++index) {
+    const BufferSlot& slot = buffers_[index];
+    if (index != current_ && slot.buffer != nullptr &&
+        slot.buffer->IsDirty()) {
+      return slot.number;
+    }
+  }
+  return 0;
+}
+
+void EditorState::PreserveSwaps() {
+  for (BufferSlot& slot : buffers_) {
+    if (slot.buffer != nullptr && slot.buffer->IsDirty()) {
+      slot.buffer->PreserveSwap();
+    }
+  }
+}
+
+void EditorState::RememberViews() {
+  for (std::size_t index = 0; index < buffers_.size(); ++index) {
+    const BufferSlot& slot = buffers_[index];
+    if (index == current_) {
+      RememberView(slot, cursor_line_, cursor_column_);
+    } else {
+      RememberView(slot, slot.cursor_line, slot.cursor_column);
+    }
+  }
+}
+
+void EditorState::SetBufferBudget(std::size_t bytes) {
+  buffer_budget_ = bytes;
+  EnforceBudget();
+}
+
+Registers& EditorState::GetRegisters() noexcept {
+  return registers_;
+}
+
+const Registers& EditorState::GetRegisters() const noexcept {
+  return registers_;
 }
 
 std::size_t EditorState::CursorLine() const noexcept {
@@ -28,38 +215,150 @@ std::size_t EditorState::CursorColumn() const noexcept {
 void EditorState::SetCursor(std::size_t line, std::size_t column) {
   cursor_line_ = line;
   cursor_column_ = column;
+  keeps_line_end_ = false;
   ClampCursor();
 }
 
 void EditorState::MoveCursorLine(int delta) {
-  if (buffer_.LineCount() == 0) {
+  if (buffer_->LineCount() == 0) {
     cursor_line_ = 0;
     cursor_column_ = 0;
     return;
   }
 
-  const int kMaxLine = static_cast<int>(buffer_.LineCount()) - 1;
+  const int kMaxLine = static_cast<int>(buffer_->LineCount()) - 1;
   int target = static_cast<int>(cursor_line_) + delta;
   target = std::clamp(target, 0, kMaxLine);
-  cursor_line_ = static_cast<std::size_t>(target);
+  const auto kTarget = static_cast<std::size_t>(target);
+  if (keeps_line_end_) {
+    const std::string_view kTo = buffer_->GetLine(kTarget);
+    cursor_column_ = kTo.empty() ? 0 : GraphemeStart(kTo, kTo.size() - 1);
+  } else if (kTarget != cursor_line_ &&
+             cursor_line_ < buffer_->LineCount()) {
+    const std::string_view kFrom = buffer_->GetLine(cursor_line_);
+    const std::size_t kColumn =
+        ColumnsOf(cursor_line_, kFrom).ColumnOf(kFrom, cursor_column_);
+    const std::string_view kTo = buffer_->GetLine(kTarget);
+    cursor_column_ = ColumnsOf(kTarget, kTo).Locate(kTo, kColumn).byte;
+  }
+  cursor_line_ = kTarget;
   ClampCursor();
 }
 
 void EditorState::MoveCursorColumn(int delta) {
-  const auto kLineLength = buffer_.GetLine(cursor_line_).size();
-  const int kMaxColumn = static_cast<int>(kLineLength);
-  int target = static_cast<int>(cursor_column_) + delta;
-  target = std::clamp(target, 0, kMaxColumn);
-  cursor_column_ = static_cast<std::size_t>(target);
+  const std::string_view kLine = buffer_->GetLine(cursor_line_);
+  std::size_t column = (std::min)(cursor_column_, kLine.size());
+  if (delta > 0) {
+    column = SkipGraphemes(kLine, column, static_cast<std::size_t>(delta));
+  }
+  for (; delta < 0 && column > 0; ++delta) {
+    column = GraphemeStart(kLine, column - 1);
+  }
+  cursor_column_ = column;
+  keeps_line_end_ = false;
   ClampCursor();
 }
 
+void EditorState::KeepCursorAtLineEnd() noexcept {
+  keeps_line_end_ = true;
+}
+
+bool EditorState::KeepsCursorAtLineEnd() const noexcept {
+  return keeps_line_end_;
+}
+
+const Viewport& EditorState::GetViewport() const noexcept {
+  return viewport_;
+}
+
+void EditorState::SetViewport(const Viewport& viewport) noexcept {
+  viewport_ = viewport;
+}
+
+const ViewOptions& EditorState::GetViewOptions() const noexcept {
+  return view_options_;
+}
+
+void EditorState::SetViewOptions(const ViewOptions& options) noexcept {
+  view_options_ = options;
+}
+
 Mode EditorState::CurrentMode() const noexcept {
   return mode_;
 }
 
 void EditorState::SetMode(Mode mode) noexcept {
   mode_ = mode;
+  if (mode != Mode::kVisual) {
+    selection_anchor_.reset();
+  }
+}
+
+void EditorState::StartSelection(SelectionKind kind) {
+  ClampCursor();
+  selection_anchor_ = TextPosition{cursor_line_, cursor_column_};
+  selection_kind_ = kind;
+}
+
+void EditorState::SetSelectionKind(SelectionKind kind) noexcept {
+  selection_kind_ = kind;
+}
+
+SelectionKind EditorState::GetSelectionKind() const noexcept {
+  return selection_kind_;
+}
+
+void EditorState::SwapSelectionEnds() {
+  if (!selection_anchor_) {
+    return;
+  }
+  const TextPosition kCursor{cursor_line_, cursor_column_};
+  cursor_line_ = selection_anchor_->line;
+  cursor_column_ = selection_anchor_->column;
+  keeps_line_end_ = false;
+  selection_anchor_ = kCursor;
+  ClampCursor();
+}
+
+std::optional<Selection> EditorState::GetSelection() {
+  if (!selection_anchor_ || buffer_->LineCount() == 0) {
+    return std::nullopt;
+  }
+  // Edits since the anchor was set may have moved the text from under it.
+  TextPosition anchor = *selection_anchor_;
+  anchor.line = (std::min)(anchor.line, buffer_->LineCount() - 1);
+  const std::string_view kAnchorText = buffer_->GetLine(anchor.line);
+  anchor.column = GraphemeStart(
+      kAnchorText, (std::min)(anchor.column, kAnchorText.size()));
+  const TextPosition kCursor{cursor_line_, cursor_column_};
+
+  Selection selection;
+  selection.kind = selection_kind_;
+  selection.start = (std::min)(anchor, kCursor);
+  selection.end = (std::max)(anchor, kCursor);
+  // Characterwise, only a cursor at the end of the selection reaches past it.
+  selection.to_line_end =
+      keeps_line_end_ &&
+      (selection_kind_ != SelectionKind::kCharacter || anchor <= kCursor);
+  if (selection_kind_ == SelectionKind::kBlock) {
+    // Each end covers its character's cells, the end of a line one.
+    const auto kPlace = [this](const TextPosition& position,
+                               std::size_t& right) {
+      const std::string_view kText = buffer_->GetLine(position.line);
+      LineLayout& layout = ColumnsOf(position.line, kText);
+      const std::size_t kColumn = layout.ColumnOf(kText, position.column);
+      right = kColumn + (std::max)(layout.Locate(kText, kColumn).cells,
+                                   std::size_t{1});
+      return kColumn;
+    };
+    std::size_t anchor_right = 0;
+    std::size_t cursor_right = 0;
+    const std::size_t kAnchorLeft = kPlace(anchor, anchor_right);
+    const std::size_t kCursorLeft = kPlace(kCursor, cursor_right);
+    selection.left = (std::min)(kAnchorLeft, kCursorLeft);
+    selection.right = (std::max)(anchor_right, cursor_right);
+  }
+  return selection;
 }
 
 bool EditorState::IsRunning() const noexcept {
@@ -89,18 +388,172 @@ StatusSeverity EditorState::StatusLevel() const noexcept {
   return status_severity_;
 }
 
+void EditorState::SetSearchHighlight(
+    std::shared_ptr<const Pattern> pattern) noexcept {
+  search_highlight_ = std::move(pattern);
+}
+
+const std::shared_ptr<const Pattern>& EditorState::SearchHighlight()
+    const noexcept {
+  return search_highlight_;
+}
+
+void EditorState::RecordInputLatency(
+    std::chrono::microseconds latency) noexcept {
+  input_latency_.last = latency;
+  input_latency_.max = std::max(input_latency_.max, latency);
+  input_latency_.total += latency;
+  ++input_latency_.samples;
+}
+
+const LatencyStats& EditorState::InputLatency() const noexcept {
+  return input_latency_;
+}
+
+void EditorState::SetShowsProfile(bool shows) noexcept {
+  shows_profile_ = shows;
+}
+
+bool EditorState::ShowsProfile() const noexcept {
+  return shows_profile_;
+}
+
 void EditorState::ClampCursor() {
-  if (buffer_.LineCount() == 0) {
+  if (buffer_->LineCount() == 0) {
     cursor_line_ = 0;
     cursor_column_ = 0;
     return;
   }
 
-  if (cursor_line_ >= buffer_.LineCount()) {
-    cursor_line_ = buffer_.LineCount() - 1;
+  if (cursor_line_ >= buffer_->LineCount()) {
+    cursor_line_ = buffer_->LineCount() - 1;
+  }
+
+  const std::string_view kLine = buffer_->GetLine(cursor_line_);
+  cursor_column_ =
+      GraphemeStart(kLine, std::min(cursor_column_, kLine.size()));
+}
+
+LineLayout& EditorState::ColumnsOf(std::size_t line, std::string_view text) {
+  const std::uint64_t kRevision = buffer_->Revision();
+  const std::size_t kTabstop = view_options_.tabstop;
+  for (LineColumns& columns : line_columns_) {
+    if (columns.revision == kRevision && columns.line == line &&
+        columns.tabstop == kTabstop) {
+      return columns.layout;
+    }
+  }
+  LineColumns& columns = line_columns_[next_columns_];
+  next_columns_ = (next_columns_ + 1) % line_columns_.size();
+  columns.revision = kRevision;
+  columns.line = line;
+  columns.tabstop = kTabstop;
+  columns.layout.Reset(text, kTabstop, 0);
+  return columns.layout;
+}
+
+void EditorState::AddBuffer(std::unique_ptr<Buffer> buffer) {
+  BufferSlot& slot = buffers_.emplace_back();
+  slot.path = buffer->FilePath();
+  slot.buffer = std::move(buffer);
+  slot.highlighter = std::make_unique<Highlighter>();
+  slot.number = next_number_++;
+  slot.id = next_id_++;
+}
+
+bool EditorState::Load(BufferSlot& slot) {
+  slot.buffer = std::make_unique<Buffer>();
+  slot.highlighter = std::make_unique<Highlighter>();
+  slot.id = next_id_++;
+  const bool kLoaded = slot.buffer->LoadFromFile(slot.path, slot.strategy);
+  if (!kLoaded) {
+    // Gone since it was unloaded; it comes back empty, as a new file.
+    slot.buffer->SetFilePath(slot.path);
+  }
+  slot.buffer->StartSwap(false);
+  RestoreView(slot);
+  return kLoaded;
+}
+
+void EditorState::RestoreView(BufferSlot& slot) {
+  std::optional<ViewMemory> view = slot.buffer->TakeRememberedView();
+  if (!view.has_value()) {
+    return;
+  }
+  slot.cursor_line = view->cursor_line;
+  slot.cursor_column = view->cursor_column;
+  slot.viewport = {};
+  slot.highlighter->Seed(*slot.buffer, std::move(view->lex_states));
+}
+
+void EditorState::RememberView(const BufferSlot& slot, std::size_t line,
+                               std::size_t column) {
+  // The lexer states are only right for the text the key describes.
+  if (slot.buffer == nullptr || slot.buffer->CacheKey() == nullptr ||
+      slot.buffer->IsDirty()) {
+    return;
+  }
+  ViewMemory view;
+  view.cursor_line = line;
+  view.cursor_column = column;
+  const std::span<const LexState> kStates =
+      slot.highlighter->Checkpoints();
+  view.lex_states.assign(kStates.begin(), kStates.end());
+  IndexCache::StoreView(*slot.buffer->CacheKey(), view);
+}
+
+void EditorState::Activate(std::size_t index) {
+  if (buffer_ != nullptr) {
+    BufferSlot& previous = buffers_[current_];
+    previous.cursor_line = cursor_line_;
+    previous.cursor_column = cursor_column_;
+    previous.viewport = viewport_;
   }
 
-  const auto& line = buffer_.GetLine(cursor_line_);
-  cursor_column_ = std::min(cursor_column_, line.size());
+  current_ = index;
+  BufferSlot& slot = buffers_[index];
+  if (slot.buffer == nullptr) {
+    Load(slot);
+  }
+  buffer_ = slot.buffer.get();
+  slot.last_used = ++use_clock_;
+  cursor_line_ = slot.cursor_line;
+  cursor_column_ = slot.cursor_column;
+  keeps_line_end_ = false;
+  viewport_ = slot.viewport;
+  ClampCursor();
+  EnforceBudget();
+}
+
+void EditorState::EnforceBudget() {
+  std::size_t resident = 0;
+  for (std::size_t index = 0; index < buffers_.size(); ++index) {
+    if (index != current_ && buffers_[index].buffer != nullptr) {
+      resident += buffers_[index].buffer->MemoryUsage();
+    }
+  }
+
+  while (resident > buffer_budget_) {
+    // Only what can be loaded again as it was is unloaded.
+    BufferSlot* oldest = nullptr;
+    for (std::size_t index = 0; index < buffers_.size(); ++index) {
+      BufferSlot& slot = buffers_[index];
+      if (index == current_ || slot.buffer == nullptr ||
+          slot.buffer->IsDirty() || slot.buffer->FilePath().empty()) {
+        continue;
+      }
+      if (oldest == nullptr || slot.last_used < oldest->last_used) {
+        oldest = &slot;
+      }
+    }
+    if (oldest == nullptr) {
+      return;
+    }
+    resident -= oldest->buffer->MemoryUsage();
+    RememberView(*oldest, oldest->cursor_line, oldest->cursor_column);
+    oldest->path = oldest->buffer->FilePath();
+    oldest->buffer.reset();
+    oldest->highlighter.reset();
+  }
 }
 }  // namespace core
\ No newline at end of file
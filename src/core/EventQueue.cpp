@@ -1,17 +1,91 @@
 #include "core/EventQueue.hpp"
 
+#include <bit>
+#include <utility>
+
+namespace {
+bool IsCoalescable(const core::KeyEvent& event) {
+  switch (event.code) {
+    case core::KeyCode::kArrowUp:
+    case core::KeyCode::kArrowDown:
+    case core::KeyCode::kArrowLeft:
+    case core::KeyCode::kArrowRight:
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
 namespace core {
-void EventQueue::Push(const KeyEvent& event) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  events_.push_back(event);
+EventQueue::EventQueue(std::size_t capacity, OverflowPolicy policy)
+    : policy_(policy) {
+  const std::size_t kCapacity = std::bit_ceil(capacity < 2 ? 2 : capacity);
+  slots_ = std::make_unique<Slot[]>(kCapacity);
+  mask_ = kCapacity - 1;
+}
+
+void EventQueue::SetWakeHook(WakeHook hook) {
+  wake_hook_ = std::move(hook);
+}
+
+bool EventQueue::Push(const KeyEvent& event) {
+  const std::size_t kTail = tail_.load(std::memory_order_relaxed);
+  if (kTail - cached_head_ > mask_) {
+    cached_head_ = head_.load(std::memory_order_acquire);
+    while (kTail - cached_head_ > mask_) {
+      if (policy_ == OverflowPolicy::kCoalesce && IsCoalescable(event)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      if (wake_hook_) {
+        wake_hook_();
+      }
+      // Paired with Release(): either this load sees the consumer's progress
+      // or the consumer sees the flag and notifies.
+      producer_waiting_.store(true, std::memory_order_seq_cst);
+      const std::uint32_t kEpoch =
+          space_epoch_.load(std::memory_order_seq_cst);
+      cached_head_ = head_.load(std::memory_order_seq_cst);
+      if (kTail - cached_head_ > mask_) {
+        space_epoch_.wait(kEpoch, std::memory_order_acquire);
+        cached_head_ = head_.load(std::memory_order_acquire);
+      }
+      producer_waiting_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  Slot& slot = slots_[kTail & mask_];
+  slot.event = event;
+  slot.arrival = Clock::now();
+  if (!event.text.empty()) {
+    slot.text.assign(event.text);
+    slot.event.text = slot.text;
+  } else if (slot.text.capacity() > kRetainedTextBytes) {
+    std::string().swap(slot.text);
+  }
+  tail_.store(kTail + 1, std::memory_order_release);
+  return true;
+}
+
+bool EventQueue::Empty() const noexcept {
+  return head_.load(std::memory_order_acquire) ==
+         tail_.load(std::memory_order_acquire);
+}
+
+std::size_t EventQueue::Capacity() const noexcept {
+  return mask_ + 1;
+}
+
+std::uint64_t EventQueue::Dropped() const noexcept {
+  return dropped_.load(std::memory_order_relaxed);
 }
 
-std::vector<KeyEvent> EventQueue::ConsumeAll() {
-  std::vector<KeyEvent> result;
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    result.swap(events_);
+void EventQueue::Release(std::size_t head) noexcept {
+  head_.store(head, std::memory_order_seq_cst);
+  if (producer_waiting_.load(std::memory_order_seq_cst)) {
+    space_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    space_epoch_.notify_one();
   }
-  return result;
 }
 }  // namespace core
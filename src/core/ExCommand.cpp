@@ -0,0 +1,241 @@
+#include "core/ExCommand.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace {
+constexpr std::string_view kBlanks = " \t";
+// Commands named by one character rather than by letters.
+constexpr std::string_view kSymbolNames = "!&<>=#~";
+
+bool IsDigit(char value) {
+  return std::isdigit(static_cast<unsigned char>(value)) != 0;
+}
+
+void SkipBlanks(std::string_view text, std::size_t& index) {
+  while (index < text.size() && kBlanks.find(text[index]) != kBlanks.npos) {
+    ++index;
+  }
+}
+
+std::size_t ReadNumber(std::string_view text, std::size_t& index) {
+  std::size_t number = 0;
+  while (index < text.size() && IsDigit(text[index])) {
+    const auto kDigit = static_cast<std::size_t>(text[index] - '0');
+    // Saturates; any such line is out of range anyway.
+    number =
+        number > (SIZE_MAX - kDigit) / 10 ? SIZE_MAX : number * 10 + kDigit;
+    ++index;
+  }
+  return number;
+}
+
+// Returns false when there is no address at `index`.
+bool ParseAddress(std::string_view text, std::size_t& index,
+                  core::ExAddress& address) {
+  SkipBlanks(text, index);
+  if (index >= text.size()) {
+    return false;
+  }
+
+  bool found = true;
+  if (text[index] == '.') {
+    address.base = core::ExAddress::Base::kCurrent;
+    ++index;
+  } else if (text[index] == '$') {
+    address.base = core::ExAddress::Base::kLast;
+    ++index;
+  } else if (IsDigit(text[index])) {
+    address.base = core::ExAddress::Base::kNumber;
+    address.number = ReadNumber(text, index);
+  } else {
+    found = false;
+  }
+
+  for (;;) {
+    std::size_t next = index;
+    SkipBlanks(text, next);
+    if (next >= text.size() || (text[next] != '+' && text[next] != '-')) {
+      break;
+    }
+    const bool kBack = text[next] == '-';
+    ++next;
+    const std::size_t kAmount =
+        next < text.size() && IsDigit(text[next]) ? ReadNumber(text, next) : 1;
+    const auto kSigned = static_cast<std::ptrdiff_t>(
+        (std::min)(kAmount, static_cast<std::size_t>(PTRDIFF_MAX)));
+    address.offset += kBack ? -kSigned : kSigned;
+    index = next;
+    found = true;
+  }
+  return found;
+}
+
+bool ResolveAddress(const core::ExAddress& address, std::size_t cursor,
+                    std::size_t line_count, std::size_t& line) {
+  std::size_t base = cursor;
+  if (address.base == core::ExAddress::Base::kLast) {
+    base = line_count - 1;
+  } else if (address.base == core::ExAddress::Base::kNumber) {
+    // Like vi, line 0 stands for the first line.
+    base = address.number > 0 ? address.number - 1 : 0;
+  }
+
+  if (address.offset < 0) {
+    const auto kBack = static_cast<std::size_t>(-address.offset);
+    if (kBack > base) {
+      return false;
+    }
+    line = base - kBack;
+  } else {
+    line = base + static_cast<std::size_t>(address.offset);
+    if (line < base) {
+      return false;
+    }
+  }
+  return line < line_count;
+}
+}  // namespace
+
+namespace core {
+bool ExRange::Resolve(std::size_t cursor, std::size_t line_count,
+                      std::size_t& first_line, std::size_t& last_line,
+                      std::string& error) const {
+  if (line_count == 0) {
+    line_count = 1;
+  }
+  if (addresses == 0) {
+    first_line = cursor;
+    last_line = cursor + 1;
+    return true;
+  }
+
+  std::size_t start = 0;
+  if (!ResolveAddress(first, cursor, line_count, start)) {
+    error = "Line out of range";
+    return false;
+  }
+  std::size_t end = start;
+  if (addresses > 1 &&
+      !ResolveAddress(last, from_first ? start : cursor, line_count, end)) {
+    error = "Line out of range";
+    return false;
+  }
+  if (end < start) {
+    error = "Backwards range";
+    return false;
+  }
+  first_line = start;
+  last_line = end + 1;
+  return true;
+}
+
+bool ParseExCommandHead(std::string_view text, ExCommand& command,
+                        std::string_view& rest, std::string& error) {
+  std::size_t index = 0;
+  while (index < text.size() &&
+         (text[index] == ':' || kBlanks.find(text[index]) != kBlanks.npos)) {
+    ++index;
+  }
+
+  command.range = {};
+  ExRange& range = command.range;
+  if (index < text.size() && text[index] == '%') {
+    ++index;
+    range.addresses = 2;
+    range.first = {ExAddress::Base::kNumber, 1, 0};
+    range.last = {ExAddress::Base::kLast, 0, 0};
+  } else {
+    const bool kHasFirst = ParseAddress(text, index, range.first);
+    SkipBlanks(text, index);
+    if (index < text.size() && (text[index] == ',' || text[index] == ';')) {
+      // A missing address on either side is the cursor's line.
+      range.from_first = text[index] == ';';
+      ++index;
+      range.addresses = 2;
+      ParseAddress(text, index, range.last);
+    } else if (kHasFirst) {
+      range.addresses = 1;
+    }
+  }
+  SkipBlanks(text, index);
+
+  command.name.clear();
+  command.bang = false;
+  command.arguments.clear();
+  if (index < text.size() &&
+      std::isalpha(static_cast<unsigned char>(text[index])) != 0) {
+    const std::size_t kStart = index;
+    while (index < text.size() &&
+           std::isalpha(static_cast<unsigned char>(text[index])) != 0) {
+      ++index;
+    }
+    command.name = text.substr(kStart, index - kStart);
+  } else if (index < text.size() &&
+             kSymbolNames.find(text[index]) != kSymbolNames.npos) {
+    command.name = text.substr(index, 1);
+    ++index;
+  } else if (index < text.size() && text[index] != '|') {
+    error = "Invalid command: " + std::string(text.substr(index));
+    return false;
+  }
+  rest = text.substr(index);
+  return true;
+}
+
+std::string TakeExArgument(std::string_view& rest) {
+  std::string argument;
+  std::size_t index = 0;
+  SkipBlanks(rest, index);
+  for (; index < rest.size() && rest[index] != '|'; ++index) {
+    if (rest[index] == '\\' && index + 1 < rest.size() &&
+        rest[index + 1] == '|') {
+      ++index;
+    }
+    argument.push_back(rest[index]);
+  }
+  rest.remove_prefix(index < rest.size() ? index + 1 : index);
+
+  const std::size_t kEnd = argument.find_last_not_of(kBlanks);
+  argument.resize(kEnd == std::string::npos ? 0 : kEnd + 1);
+  return argument;
+}
+
+std::string TakeDelimitedExArgument(std::string_view& rest,
+                                    std::size_t parts) {
+  std::size_t index = 0;
+  SkipBlanks(rest, index);
+  const auto kIsDelimiter = [](char value) {
+    return std::ispunct(static_cast<unsigned char>(value)) != 0 &&
+           value != '\\' && value != '"' && value != '|';
+  };
+  if (parts == 0 || index == rest.size() || !kIsDelimiter(rest[index])) {
+    return TakeExArgument(rest);
+  }
+
+  const char kDelimiter = rest[index];
+  std::size_t end = index + 1;
+  for (std::size_t part = 0; part < parts && end < rest.size(); ++part) {
+    while (end < rest.size() && rest[end] != kDelimiter) {
+      end += rest[end] == '\\' && end + 1 < rest.size() ? 2 : 1;
+    }
+    if (end < rest.size()) {
+      ++end;
+    }
+  }
+
+  // The flags after the parts end at a '|' as any argument does.
+  std::string argument(rest.substr(index, end - index));
+  rest.remove_prefix(end);
+  if (!rest.empty() && !rest.starts_with('|')) {
+    argument += TakeExArgument(rest);
+  } else if (!rest.empty()) {
+    rest.remove_prefix(1);
+  }
+  return argument;
+}
+}  // namespace core
@@ -0,0 +1,283 @@
+#include "core/Filetype.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace {
+using core::Filetype;
+using core::LexState;
+using core::TokenKind;
+using core::TokenSpan;
+
+constexpr LexState kCode = 0;
+constexpr LexState kBlockComment = 1;
+constexpr LexState kTripleDouble = 2;
+constexpr LexState kTripleSingle = 3;
+constexpr LexState kDirective = 4;
+
+template <std::size_t N>
+constexpr std::array<std::string_view, N> Sorted(
+    std::array<std::string_view, N> words) {
+  std::sort(words.begin(), words.end());
+  return words;
+}
+
+constexpr std::array<std::string_view, 9> kCppExtensions = {
+    "c", "cc", "cpp", "cxx", "h", "hh", "hpp", "hxx", "inl"};
+
+constexpr auto kCppKeywords = Sorted(std::to_array<std::string_view>({
+    "NULL", "alignas", "alignof", "and", "and_eq", "asm", "bitand", "bitor",
+    "break", "case", "catch", "class", "co_await", "co_return", "co_yield",
+    "compl", "concept", "const", "const_cast", "consteval", "constexpr",
+    "constinit", "continue", "decltype", "default", "delete", "do",
+    "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false",
+    "final", "for", "friend", "goto", "if", "import", "inline", "module",
+    "mutable", "namespace", "new", "noexcept", "not", "nullptr", "operator",
+    "or", "or_eq", "override", "private", "protected", "public", "register",
+    "reinterpret_cast", "requires", "return", "sizeof", "static",
+    "static_assert", "static_cast", "struct", "switch", "template", "this",
+    "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+    "union", "using", "virtual", "volatile", "while", "xor"}));
+
+constexpr auto kCppTypes = Sorted(std::to_array<std::string_view>({
+    "auto", "bool", "char", "char16_t", "char32_t", "char8_t", "double",
+    "float", "int", "int16_t", "int32_t", "int64_t", "int8_t", "long",
+    "ptrdiff_t", "short", "signed", "size_t", "uint16_t", "uint32_t",
+    "uint64_t", "uint8_t", "unsigned", "void"}));
+
+constexpr std::array<std::string_view, 2> kPythonExtensions = {"py", "pyi"};
+
+constexpr auto kPythonKeywords = Sorted(std::to_array<std::string_view>({
+    "False", "None", "True", "and", "as", "assert", "async", "await", "break",
+    "class", "continue", "def", "del", "elif", "else", "except", "finally",
+    "for", "from", "global", "if", "import", "in", "is", "lambda", "match",
+    "nonlocal", "not", "or", "pass", "raise", "return", "try", "while",
+    "with"}));
+
+constexpr auto kPythonTypes = Sorted(std::to_array<std::string_view>({
+    "bool", "bytes", "dict", "float", "int", "list", "object", "set", "str",
+    "tuple"}));
+
+constexpr std::array<Filetype, 2> kFiletypes = {{
+    {.name = "cpp",
+     .extensions = kCppExtensions,
+     .keywords = kCppKeywords,
+     .types = kCppTypes,
+     .line_comment = "//",
+     .block_comment_open = "/*",
+     .block_comment_close = "*/",
+     .directives = true},
+    {.name = "python",
+     .extensions = kPythonExtensions,
+     .keywords = kPythonKeywords,
+     .types = kPythonTypes,
+     .line_comment = "#",
+     .triple_quotes = true},
+}};
+
+bool IsWordStart(char value) {
+  return std::isalpha(static_cast<unsigned char>(value)) != 0 || value == '_';
+}
+
+bool IsWordCharacter(char value) {
+  return std::isalnum(static_cast<unsigned char>(value)) != 0 || value == '_';
+}
+
+bool IsDigit(char value) {
+  return std::isdigit(static_cast<unsigned char>(value)) != 0;
+}
+
+bool Contains(std::span<const std::string_view> words, std::string_view word) {
+  return std::binary_search(words.begin(), words.end(), word);
+}
+
+class LineLexer {
+ public:
+  LineLexer(const Filetype& filetype, std::string_view line,
+            std::vector<TokenSpan>* tokens)
+      : filetype_(filetype), line_(line), tokens_(tokens) {}
+
+  LexState Run(LexState state) {
+    switch (state) {
+      case kBlockComment:
+        if (!Close(0, filetype_.block_comment_close, TokenKind::kComment)) {
+          return kBlockComment;
+        }
+        break;
+      case kTripleDouble:
+      case kTripleSingle:
+        if (!Close(0, state == kTripleDouble ? "\"\"\"" : "'''",
+                   TokenKind::kString)) {
+          return state;
+        }
+        break;
+      case kDirective:
+        return Directive();
+      default:
+        if (filetype_.directives) {
+          const std::size_t kFirst = line_.find_first_not_of(" \t");
+          if (kFirst != std::string_view::npos && line_[kFirst] == '#') {
+            position_ = kFirst;
+            return Directive();
+          }
+        }
+        break;
+    }
+    return Code();
+  }
+
+ private:
+  void Emit(std::size_t start, std::size_t end, TokenKind kind) {
+    if (tokens_ != nullptr && end > start) {
+      tokens_->push_back({start, end - start, kind});
+    }
+  }
+
+  bool At(std::string_view text) const {
+    return !text.empty() && line_.substr(position_).starts_with(text);
+  }
+
+  // Colors from `start` up to and including the next `close`; false when the
+  // line ends first.
+  bool Close(std::size_t start, std::string_view close, TokenKind kind) {
+    const std::size_t kEnd = line_.find(close, position_);
+    if (kEnd == std::string_view::npos) {
+      Emit(start, line_.size(), kind);
+      position_ = line_.size();
+      return false;
+    }
+    position_ = kEnd + close.size();
+    Emit(start, position_, kind);
+    return true;
+  }
+
+  // A directive runs to the end of the line, or to a comment, and continues
+  // on the next line after a trailing backslash.
+  LexState Directive() {
+    const std::size_t kStart = position_;
+    while (position_ < line_.size() && !At(filetype_.line_comment) &&
+           !At(filetype_.block_comment_open)) {
+      ++position_;
+    }
+    Emit(kStart, position_, TokenKind::kPreprocessor);
+    if (position_ == line_.size()) {
+      return line_.ends_with('\\') ? kDirective : kCode;
+    }
+    return Code();
+  }
+
+  LexState Code() {
+    while (position_ < line_.size()) {
+      const char kChr = line_[position_];
+      const std::size_t kStart = position_;
+      if (At(filetype_.line_comment)) {
+        Emit(kStart, line_.size(), TokenKind::kComment);
+        return kCode;
+      }
+      if (At(filetype_.block_comment_open)) {
+        position_ += filetype_.block_comment_open.size();
+        if (!Close(kStart, filetype_.block_comment_close,
+                   TokenKind::kComment)) {
+          return kBlockComment;
+        }
+        continue;
+      }
+      if (filetype_.triple_quotes && (At("\"\"\"") || At("'''"))) {
+        const bool kDouble = kChr == '"';
+        position_ += 3;
+        if (!Close(kStart, kDouble ? "\"\"\"" : "'''", TokenKind::kString)) {
+          return kDouble ? kTripleDouble : kTripleSingle;
+        }
+        continue;
+      }
+      if (kChr == '"' || kChr == '\'') {
+        ++position_;
+        while (position_ < line_.size() && line_[position_] != kChr) {
+          position_ += line_[position_] == '\\' ? 2 : 1;
+        }
+        position_ = (std::min)(position_ + 1, line_.size());
+        Emit(kStart, position_, TokenKind::kString);
+        continue;
+      }
+      if (IsDigit(kChr) ||
+          (kChr == '.' && position_ + 1 < line_.size() &&
+           IsDigit(line_[position_ + 1]))) {
+        Number();
+        Emit(kStart, position_, TokenKind::kNumber);
+        continue;
+      }
+      if (IsWordStart(kChr)) {
+        while (position_ < line_.size() && IsWordCharacter(line_[position_])) {
+          ++position_;
+        }
+        const std::string_view kWord =
+            line_.substr(kStart, position_ - kStart);
+        if (Contains(filetype_.keywords, kWord)) {
+          Emit(kStart, position_, TokenKind::kKeyword);
+        } else if (Contains(filetype_.types, kWord)) {
+          Emit(kStart, position_, TokenKind::kType);
+        }
+        continue;
+      }
+      ++position_;
+    }
+    return kCode;
+  }
+
+  // Digits, radix prefixes, suffixes, separators and signed exponents.
+  void Number() {
+    while (position_ < line_.size()) {
+      const char kChr = line_[position_];
+      if (IsWordCharacter(kChr) || kChr == '.' || kChr == '\'') {
+        ++position_;
+      } else if ((kChr == '+' || kChr == '-') &&
+                 std::string_view("eEpP").find(line_[position_ - 1]) !=
+                     std::string_view::npos) {
+        ++position_;
+      } else {
+        break;
+      }
+    }
+  }
+
+  const Filetype& filetype_;
+  std::string_view line_;
+  std::vector<TokenSpan>* tokens_;
+  std::size_t position_ = 0;
+};
+}  // namespace
+
+namespace core {
+const Filetype* DetectFiletype(std::string_view path) {
+  const std::size_t kSlash = path.find_last_of("/\\");
+  const std::string_view kName =
+      kSlash == std::string_view::npos ? path : path.substr(kSlash + 1);
+  const std::size_t kDot = kName.rfind('.');
+  if (kDot == std::string_view::npos || kDot == 0) {
+    return nullptr;
+  }
+
+  std::string_view extension = kName.substr(kDot + 1);
+  for (const Filetype& filetype : kFiletypes) {
+    for (const std::string_view kCandidate : filetype.extensions) {
+      if (std::equal(extension.begin(), extension.end(), kCandidate.begin(),
+                     kCandidate.end(), [](char lhs, char rhs) {
+                       return std::tolower(static_cast<unsigned char>(lhs)) ==
+                              rhs;
+                     })) {
+        return &filetype;
+      }
+    }
+  }
+  return nullptr;
+}
+
+LexState LexLine(const Filetype& filetype, std::string_view line,
+                 LexState state, std::vector<TokenSpan>* tokens) {
+  return LineLexer(filetype, line, tokens).Run(state);
+}
+}  // namespace core
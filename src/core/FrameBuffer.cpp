@@ -0,0 +1,118 @@
+#include "core/FrameBuffer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+namespace {
+constexpr std::size_t kMinimumCapacity = 256;
+constexpr std::size_t kNumberScratch = 24;
+}  // namespace
+
+namespace core {
+void FrameBuffer::Clear() noexcept {
+  size_ = 0;
+}
+
+void FrameBuffer::Truncate(std::size_t size) noexcept {
+  size_ = (std::min)(size_, size);
+}
+
+void FrameBuffer::Reserve(std::size_t capacity) {
+  if (capacity > capacity_) {
+    Grow(capacity);
+  }
+}
+
+void FrameBuffer::Swap(FrameBuffer& other) noexcept {
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(growths_, other.growths_);
+}
+
+void FrameBuffer::Append(std::string_view text) {
+  if (text.empty()) {
+    return;
+  }
+  if (size_ + text.size() > capacity_) {
+    Grow(size_ + text.size());
+  }
+  std::memcpy(data_.get() + size_, text.data(), text.size());
+  size_ += text.size();
+}
+
+void FrameBuffer::Append(char value) {
+  if (size_ == capacity_) {
+    Grow(size_ + 1);
+  }
+  data_[size_++] = value;
+}
+
+void FrameBuffer::AppendRepeated(char value, std::size_t count) {
+  if (count == 0) {
+    return;
+  }
+  if (size_ + count > capacity_) {
+    Grow(size_ + count);
+  }
+  std::memset(data_.get() + size_, value, count);
+  size_ += count;
+}
+
+void FrameBuffer::AppendNumber(std::size_t value, std::size_t width) {
+  char scratch[kNumberScratch];
+  const std::to_chars_result kResult =
+      std::to_chars(scratch, scratch + kNumberScratch, value);
+  const auto kLength = static_cast<std::size_t>(kResult.ptr - scratch);
+  if (width > kLength) {
+    AppendRepeated(' ', width - kLength);
+  }
+  Append(std::string_view(scratch, kLength));
+}
+
+void FrameBuffer::AppendClipped(std::string_view text, std::size_t limit) {
+  if (size_ >= limit) {
+    return;
+  }
+  Append(text.substr(0, limit - size_));
+}
+
+std::string_view FrameBuffer::View() const noexcept {
+  return {data_.get(), size_};
+}
+
+std::size_t FrameBuffer::Size() const noexcept {
+  return size_;
+}
+
+bool FrameBuffer::Empty() const noexcept {
+  return size_ == 0;
+}
+
+std::uint64_t FrameBuffer::Growths() const noexcept {
+  return growths_;
+}
+
+void FrameBuffer::Grow(std::size_t required) {
+  const std::size_t kCapacity =
+      (std::max)({required, capacity_ * 2, kMinimumCapacity});
+  auto data = std::make_unique_for_overwrite<char[]>(kCapacity);
+  if (size_ > 0) {
+    std::memcpy(data.get(), data_.get(), size_);
+  }
+  data_ = std::move(data);
+  capacity_ = kCapacity;
+  ++growths_;
+}
+
+std::size_t DecimalDigits(std::size_t value) noexcept {
+  std::size_t digits = 1;
+  while (value >= 10) {
+    value /= 10;
+    ++digits;
+  }
+  return digits;
+}
+}  // namespace core
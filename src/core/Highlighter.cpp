@@ -0,0 +1,140 @@
+#include "core/Highlighter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "core/Buffer.hpp"
+
+namespace core {
+void Highlighter::Sync(const Buffer& buffer) {
+  if (buffer.Revision() == seed_revision_) {
+    return;
+  }
+  seed_revision_ = 0;
+  if (buffer.FilePath() != path_) {
+    path_ = buffer.FilePath();
+    // A paged file is shown plain, as lexing down to a line means lexing
+    // every line above it.
+    filetype_ = buffer.Paged() != nullptr ? nullptr : DetectFiletype(path_);
+    Reset();
+    return;
+  }
+
+  const LineChanges& changes = buffer.Changes();
+  if (changes.Empty()) {
+    return;
+  }
+  if (changes.first == 0 && changes.last == kDamageToEnd) {
+    Reset();
+    return;
+  }
+
+  // The state at the start of the first changed line depends only on the
+  // lines above it.
+  const std::size_t kKeep = (std::min)(changes.first + 1, states_.size());
+  if (changes.last == kDamageToEnd) {
+    states_.resize(kKeep);
+  } else if (changes.shift != 0) {
+    // Line numbers from kResume on moved by `shift`; their states move along.
+    const std::size_t kResume = (std::max)(changes.last, changes.first + 1);
+    const auto kOldResume = static_cast<std::size_t>(
+        static_cast<std::ptrdiff_t>(kResume) - changes.shift);
+    if (kOldResume >= states_.size()) {
+      states_.resize(kKeep);
+    } else {
+      std::vector<LexState> tail(
+          states_.begin() + static_cast<std::ptrdiff_t>(kOldResume),
+          states_.end());
+      states_.resize(kKeep);
+      states_.resize(kResume);
+      states_.insert(states_.end(), tail.begin(), tail.end());
+    }
+    resync_ = resync_ >= kOldResume
+                  ? static_cast<std::size_t>(
+                        static_cast<std::ptrdiff_t>(resync_) + changes.shift)
+                  : kResume;
+  }
+  if (changes.last != kDamageToEnd) {
+    resync_ = (std::max)(resync_, changes.last);
+  }
+
+  states_.resize((std::min)(states_.size(), buffer.LineCount()));
+  valid_ = (std::min)(valid_, kKeep);
+  resync_ = (std::min)(resync_, states_.size());
+  if (states_.empty()) {
+    Reset();
+  }
+}
+
+const Filetype* Highlighter::GetFiletype() const noexcept {
+  return filetype_;
+}
+
+LexState Highlighter::StateAt(const Buffer& buffer, std::size_t line) {
+  if (filetype_ == nullptr) {
+    return 0;
+  }
+
+  while (valid_ <= line) {
+    const LexState kState = LexLine(*filetype_, buffer.GetLine(valid_ - 1),
+                                    states_[valid_ - 1], nullptr);
+    ++lines_lexed_;
+    if (valid_ == states_.size()) {
+      states_.push_back(kState);
+    } else if (valid_ >= resync_ && states_[valid_] == kState) {
+      valid_ = states_.size();
+      resync_ = valid_;
+      continue;
+    } else {
+      states_[valid_] = kState;
+    }
+    ++valid_;
+    resync_ = (std::max)(resync_, valid_);
+  }
+  return states_[line];
+}
+
+void Highlighter::Tokenize(const Buffer& buffer, std::size_t line,
+                           std::vector<TokenSpan>& tokens, std::size_t limit) {
+  tokens.clear();
+  if (filetype_ == nullptr) {
+    return;
+  }
+  LexLine(*filetype_, buffer.GetLine(line).substr(0, limit),
+          StateAt(buffer, line), &tokens);
+  ++lines_lexed_;
+}
+
+std::span<const LexState> Highlighter::Checkpoints() const noexcept {
+  return std::span<const LexState>(states_).first(
+      (std::min)(valid_, states_.size()));
+}
+
+void Highlighter::Seed(const Buffer& buffer, std::vector<LexState> states) {
+  path_ = buffer.FilePath();
+  filetype_ = DetectFiletype(path_);
+  if (states.empty() || states.size() > buffer.LineCount()) {
+    Reset();
+    return;
+  }
+  states_ = std::move(states);
+  states_.front() = 0;
+  valid_ = states_.size();
+  resync_ = valid_;
+  seed_revision_ = buffer.Revision();
+}
+
+std::uint64_t Highlighter::LinesLexed() const noexcept {
+  return lines_lexed_;
+}
+
+void Highlighter::Reset() {
+  states_.assign(1, 0);
+  valid_ = 1;
+  resync_ = 1;
+}
+}  // namespace core
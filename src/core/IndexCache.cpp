@@ -0,0 +1,339 @@
+#include "core/IndexCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <system_error>
+#include <vector>
+
+#include "core/Varint.hpp"
+#include "io/AtomicFileWriter.hpp"
+#include "io/MappedFile.hpp"
+
+namespace {
+constexpr std::string_view kIndexMagic = "microvi index 1\n";
+constexpr std::string_view kViewMagic = "microvi view 1\n";
+constexpr std::size_t kChunkBytes = 1024 * 1024;
+// Longer lines are only checked for the '\n' that ends them.
+constexpr std::size_t kSpotLineBytes = 64 * 1024;
+constexpr std::uint64_t kFnvOffset = 0xCBF29CE484222325ULL;
+constexpr std::uint64_t kFnvPrime = 0x100000001B3ULL;
+
+std::uint64_t Hash(std::string_view bytes, std::uint64_t hash = kFnvOffset) {
+  for (const char kByte : bytes) {
+    hash = (hash ^ static_cast<unsigned char>(kByte)) * kFnvPrime;
+  }
+  return hash;
+}
+
+std::string EntryPath(const core::IndexKey& key, std::string_view suffix) {
+  const std::string kDirectory = core::IndexCache::Directory();
+  if (kDirectory.empty()) {
+    return {};
+  }
+  char name[17] = {};
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(Hash(key.path)));
+  return (std::filesystem::path(kDirectory) / (name + std::string(suffix)))
+      .string();
+}
+
+void AppendKey(std::string& out, std::string_view magic,
+               const core::IndexKey& key) {
+  out.append(magic);
+  core::AppendVarint(out, key.path.size());
+  out.append(key.path);
+  core::AppendVarint(out, key.stamp.exists ? 1 : 0);
+  core::AppendVarint(out, key.stamp.size);
+  core::AppendVarint(out, core::ZigZag(key.stamp.modified));
+  core::AppendVarint(out, key.sample);
+}
+
+// Maps the entry and checks that it was made for `key`; `index` is left
+// just past the key.
+bool OpenEntry(core::MappedFile& file, const std::string& path,
+               std::string_view magic, const core::IndexKey& key,
+               std::size_t& index) {
+  if (path.empty() || !file.Open(path)) {
+    return false;
+  }
+  std::string expected;
+  AppendKey(expected, magic, key);
+  if (!file.View().starts_with(expected)) {
+    return false;
+  }
+  index = expected.size();
+  return true;
+}
+
+// Whether the starts agree with `text` at IndexCache::kSpotChecks places
+// spread from the first to the last.
+bool SpotCheck(std::span<const std::uint64_t> starts, std::string_view text) {
+  constexpr std::size_t kChecks = core::IndexCache::kSpotChecks;
+  for (std::size_t check = 0; check < kChecks && !starts.empty(); ++check) {
+    const std::size_t kIndex = (starts.size() - 1) * check / (kChecks - 1);
+    const std::uint64_t kStart = starts[kIndex];
+    if (kStart == 0 || kStart > text.size() || text[kStart - 1] != '\n') {
+      return false;
+    }
+    const std::uint64_t kLineStart = kIndex == 0 ? 0 : starts[kIndex - 1];
+    const std::string_view kLine = text.substr(
+        kLineStart, static_cast<std::size_t>(kStart - 1 - kLineStart));
+    if (kLine.size() <= kSpotLineBytes &&
+        kLine.find('\n') != std::string_view::npos) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Marks the entry as used now, for Trim().
+void Touch(const std::string& path) {
+  std::error_code error;
+  std::filesystem::last_write_time(
+      path, std::filesystem::file_time_type::clock::now(), error);
+}
+
+// Drops the least recently used files from the cache, with their index and
+// view together, until at most kMaxEntries of them and kMaxBytes remain.
+// The newest is always kept.
+void Trim(const std::string& directory) {
+  struct Entry {
+    std::filesystem::file_time_type used;
+    std::uint64_t bytes = 0;
+    std::vector<std::filesystem::path> files;
+  };
+  std::map<std::string, Entry> entries;
+  std::error_code error;
+  for (std::filesystem::directory_iterator it(directory, error), end;
+       !error && it != end; it.increment(error)) {
+    const std::filesystem::path& kPath = it->path();
+    if (kPath.extension() != ".idx" && kPath.extension() != ".view") {
+      continue;
+    }
+    std::error_code entry_error;
+    const std::uintmax_t kBytes = it->file_size(entry_error);
+    const std::filesystem::file_time_type kUsed =
+        it->last_write_time(entry_error);
+    if (entry_error) {
+      continue;
+    }
+    Entry& entry = entries[kPath.stem().string()];
+    if (entry.files.empty() || kUsed > entry.used) {
+      entry.used = kUsed;
+    }
+    entry.bytes += kBytes;
+    entry.files.push_back(kPath);
+  }
+
+  std::vector<const Entry*> newest_first;
+  newest_first.reserve(entries.size());
+  for (const auto& [name, entry] : entries) {
+    newest_first.push_back(&entry);
+  }
+  std::sort(newest_first.begin(), newest_first.end(),
+            [](const Entry* lhs, const Entry* rhs) {
+              return lhs->used > rhs->used;
+            });
+  std::uint64_t kept_bytes = 0;
+  for (std::size_t i = 0; i < newest_first.size(); ++i) {
+    kept_bytes += newest_first[i]->bytes;
+    if (i == 0 || (i < core::IndexCache::kMaxEntries &&
+                   kept_bytes <= core::IndexCache::kMaxBytes)) {
+      continue;
+    }
+    for (const std::filesystem::path& kFile : newest_first[i]->files) {
+      std::filesystem::remove(kFile, error);
+    }
+  }
+}
+
+bool OpenWriter(const std::string& path, core::AtomicFileWriter& writer) {
+  if (path.empty()) {
+    return false;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), error);
+  return !error && writer.Open(path);
+}
+}  // namespace
+
+namespace core {
+IndexKey IndexKey::Of(const std::string& path, std::string_view text) {
+  IndexKey key;
+  std::error_code error;
+  const std::filesystem::path kAbsolute =
+      std::filesystem::absolute(path, error);
+  key.path = error ? path : kAbsolute.lexically_normal().string();
+  key.stamp = FileStamp::Of(path);
+
+  std::uint64_t hash = Hash(std::to_string(text.size()));
+  if (text.size() <= kSampleBlocks * kSampleBytes) {
+    hash = Hash(text, hash);
+  } else {
+    const std::size_t kLastStart = text.size() - kSampleBytes;
+    for (std::size_t block = 0; block < kSampleBlocks; ++block) {
+      const auto kStart = static_cast<std::size_t>(
+          std::uint64_t{kLastStart} * block / (kSampleBlocks - 1));
+      hash = Hash(text.substr(kStart, kSampleBytes), hash);
+    }
+  }
+  key.sample = hash;
+  return key;
+}
+
+std::string IndexCache::Directory() {
+#ifdef _WIN32
+  const char* local = std::getenv("LOCALAPPDATA");
+  if (local != nullptr && *local != '\0') {
+    return (std::filesystem::path(local) / "microvi").string();
+  }
+#else
+  const char* xdg = std::getenv("XDG_CACHE_HOME");
+  if (xdg != nullptr && *xdg == '/') {
+    return (std::filesystem::path(xdg) / "microvi").string();
+  }
+  const char* home = std::getenv("HOME");
+  if (home != nullptr && *home != '\0') {
+    return (std::filesystem::path(home) / ".cache" / "microvi").string();
+  }
+#endif
+  return {};
+}
+
+bool IndexCache::Load(const IndexKey& key, std::string_view text,
+                      std::vector<std::uint64_t>& starts, TextStats& stats) {
+  MappedFile file;
+  std::size_t index = 0;
+  const std::string kPath = EntryPath(key, ".idx");
+  if (!OpenEntry(file, kPath, kIndexMagic, key, index)) {
+    return false;
+  }
+
+  const std::string_view kData = file.View();
+  std::uint64_t has_bom = 0;
+  std::uint64_t encoding = 0;
+  std::uint64_t count = 0;
+  if (!ReadVarint(kData, index, stats.bytes) ||
+      !ReadVarint(kData, index, stats.lf_count) ||
+      !ReadVarint(kData, index, stats.crlf_count) ||
+      !ReadVarint(kData, index, stats.nul_count) ||
+      !ReadVarint(kData, index, has_bom) ||
+      !ReadVarint(kData, index, encoding) ||
+      encoding > static_cast<std::uint64_t>(TextEncoding::kBinary) ||
+      !ReadVarint(kData, index, count) || count > kData.size() - index) {
+    return false;
+  }
+  stats.has_bom = has_bom != 0;
+  stats.encoding = static_cast<TextEncoding>(encoding);
+
+  // Deltas between consecutive starts; every line holds at least its '\n'.
+  starts.clear();
+  starts.reserve(static_cast<std::size_t>(count));
+  std::uint64_t start = 0;
+  for (std::uint64_t line = 0; line < count; ++line) {
+    std::uint64_t delta = 0;
+    if (!ReadVarint(kData, index, delta) || delta == 0 ||
+        delta > key.stamp.size - start) {
+      starts.clear();
+      return false;
+    }
+    start += delta;
+    starts.push_back(start);
+  }
+  if (!SpotCheck(starts, text)) {
+    starts.clear();
+    return false;
+  }
+  Touch(kPath);
+  return true;
+}
+
+bool IndexCache::Store(const IndexKey& key,
+                       std::span<const std::uint64_t> starts,
+                       const TextStats& stats) {
+  AtomicFileWriter writer;
+  const std::string kPath = EntryPath(key, ".idx");
+  if (!OpenWriter(kPath, writer)) {
+    return false;
+  }
+
+  std::string data;
+  AppendKey(data, kIndexMagic, key);
+  AppendVarint(data, stats.bytes);
+  AppendVarint(data, stats.lf_count);
+  AppendVarint(data, stats.crlf_count);
+  AppendVarint(data, stats.nul_count);
+  AppendVarint(data, stats.has_bom ? 1 : 0);
+  AppendVarint(data, static_cast<std::uint64_t>(stats.encoding));
+  AppendVarint(data, starts.size());
+
+  // Encoded a chunk at a time, so an index of many millions of lines costs
+  // no more than a chunk of memory.
+  std::uint64_t previous = 0;
+  for (const std::uint64_t kStart : starts) {
+    AppendVarint(data, kStart - previous);
+    previous = kStart;
+    if (data.size() >= kChunkBytes) {
+      writer.Append(data);
+      if (!writer.Flush()) {
+        return false;
+      }
+      data.clear();
+    }
+  }
+  writer.Append(data);
+  if (!writer.Commit()) {
+    return false;
+  }
+  Trim(Directory());
+  return true;
+}
+
+bool IndexCache::LoadView(const IndexKey& key, ViewMemory& view) {
+  MappedFile file;
+  std::size_t index = 0;
+  if (!OpenEntry(file, EntryPath(key, ".view"), kViewMagic, key, index)) {
+    return false;
+  }
+
+  const std::string_view kData = file.View();
+  std::uint64_t line = 0;
+  std::uint64_t column = 0;
+  std::uint64_t states = 0;
+  if (!ReadVarint(kData, index, line) || !ReadVarint(kData, index, column) ||
+      !ReadVarint(kData, index, states) || states != kData.size() - index ||
+      line > SIZE_MAX || column > SIZE_MAX) {
+    return false;
+  }
+  view.cursor_line = static_cast<std::size_t>(line);
+  view.cursor_column = static_cast<std::size_t>(column);
+  view.lex_states.assign(kData.begin() + static_cast<std::ptrdiff_t>(index),
+                         kData.end());
+  return true;
+}
+
+bool IndexCache::StoreView(const IndexKey& key, const ViewMemory& view) {
+  AtomicFileWriter writer;
+  const std::string kPath = EntryPath(key, ".view");
+  if (!OpenWriter(kPath, writer)) {
+    return false;
+  }
+
+  std::string data;
+  AppendKey(data, kViewMagic, key);
+  AppendVarint(data, view.cursor_line);
+  AppendVarint(data, view.cursor_column);
+  AppendVarint(data, view.lex_states.size());
+  data.append(view.lex_states.begin(), view.lex_states.end());
+  writer.Append(data);
+  if (!writer.Commit()) {
+    return false;
+  }
+  Trim(Directory());
+  return true;
+}
+}  // namespace core
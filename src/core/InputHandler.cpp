@@ -1,24 +1,214 @@
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "core/InputHandler.hpp"
 
+#include "core/Buffer.hpp"
 #include "core/Command.hpp"
 #include "core/EditorState.hpp"
+#include "core/ExCommand.hpp"
+#include "core/Profiler.hpp"
 
 namespace core {
 void InputHandler::RegisterCommand(std::unique_ptr<Command> command) {
-  commands_.push_back(std::move(command));
+  if (wake_hook_) {
+    command->SetWakeHook(wake_hook_);
+  }
+
+  const std::size_t kEntry = commands_.size();
+  ExCommandSpec spec = command->Spec();
+  for (std::size_t i = 0; i < spec.names.size(); ++i) {
+    const std::string& kName = spec.names[i].name;
+    const std::size_t kShortest =
+        spec.names[i].shortest == 0 ? kName.size() : spec.names[i].shortest;
+    for (std::size_t length = kShortest; length <= kName.size(); ++length) {
+      const bool kExact = length == kName.size();
+      auto [it, inserted] = names_.try_emplace(kName.substr(0, length),
+                                               NameTarget{kEntry, i, kExact});
+      if (!inserted && kExact && !it->second.exact) {
+        it->second = {kEntry, i, true};
+      }
+    }
+  }
+  commands_.push_back({std::move(command), std::move(spec)});
+}
+
+void InputHandler::SetFallback(Fallback fallback) {
+  fallback_ = std::move(fallback);
+}
+
+bool InputHandler::Handle(EditorState& state, std::string_view line) {
+  std::vector<Step> steps;
+  if (!Parse(state, line, steps)) {
+    return false;
+  }
+  for (const Step& step : steps) {
+    Finish(state);
+    if (!Run(state, step)) {
+      return false;
+    }
+    if (!state.IsRunning()) {
+      break;
+    }
+  }
+  return true;
 }
 
-bool InputHandler::Handle(EditorState& state, const std::string& input) {
-  for (auto& cmd : commands_) {
-    if (cmd->Matches(input)) {
-      cmd->Execute(state, input);
+bool InputHandler::Parse(EditorState& state, std::string_view line,
+                         std::vector<Step>& steps) const {
+  std::string error;
+  std::string_view rest = line;
+  while (rest.find_first_not_of(" \t:|") != std::string_view::npos) {
+    Step& step = steps.emplace_back();
+    ExCommand& command = step.command;
+    if (!ParseExCommandHead(rest, command, rest, error)) {
+      state.SetStatus(error, StatusSeverity::kError);
+      return false;
+    }
+
+    if (command.name.empty()) {
+      step.kind = StepKind::kGoToLine;
+      command.arguments = TakeExArgument(rest);
+      if (command.range.addresses == 0) {
+        steps.pop_back();
+      }
+      continue;
+    }
+
+    const auto kFound = names_.find(command.name);
+    if (kFound == names_.end()) {
+      step.kind = StepKind::kFallback;
+      const std::size_t kWordEnd = rest.find_first_of(" \t|!");
+      command.name.append(rest.substr(0, kWordEnd));
+      rest.remove_prefix(kWordEnd == std::string_view::npos ? rest.size()
+                                                            : kWordEnd);
+      if (rest.starts_with('!')) {
+        command.bang = true;
+        rest.remove_prefix(1);
+      }
+      command.arguments = TakeExArgument(rest);
+      continue;
+    }
+
+    const Entry& entry = commands_[kFound->second.entry];
+    step.entry = kFound->second.entry;
+    command.name = entry.spec.names[kFound->second.name].name;
+    if (entry.spec.bang && rest.starts_with('!')) {
+      command.bang = true;
+      rest.remove_prefix(1);
+    }
+    if (entry.spec.bar) {
+      const std::size_t kStart = rest.find_first_not_of(" \t");
+      if (kStart != std::string_view::npos) {
+        command.arguments = rest.substr(kStart);
+      }
+      rest = {};
+    } else if (entry.spec.delimited_parts != 0) {
+      command.arguments =
+          TakeDelimitedExArgument(rest, entry.spec.delimited_parts);
+    } else {
+      command.arguments = TakeExArgument(rest);
+    }
+    if (command.range.addresses != 0 && !entry.spec.range) {
+      state.SetStatus("No range allowed: " + command.name,
+                      StatusSeverity::kError);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool InputHandler::Run(EditorState& state, const Step& step) {
+  const ExCommand& command = step.command;
+  switch (step.kind) {
+    case StepKind::kCommand: {
+      if (commands_[step.entry].spec.modifies &&
+          state.GetBuffer().IsReadOnly()) {
+        state.SetStatus("Cannot make changes, the buffer is read-only",
+                        StatusSeverity::kError);
+        return false;
+      }
+      MICROVI_PROFILE_SCOPE(kCommand);
+      return commands_[step.entry].command->Execute(state, command);
+    }
+    case StepKind::kFallback:
+      if (fallback_ && fallback_(state, command)) {
+        return true;
+      }
+      state.SetStatus("Not an editor command: " + command.name,
+                      StatusSeverity::kError);
+      return false;
+    case StepKind::kGoToLine:
+      break;
+  }
+
+  if (!command.arguments.empty()) {
+    state.SetStatus("Trailing characters: " + command.arguments,
+                    StatusSeverity::kError);
+    return false;
+  }
+  // Lines must have been found as far as the range reaches, which for "$"
+  // is every one of them; resolving it against no end first tells how far.
+  Buffer& buffer = state.GetBuffer();
+  std::size_t first = 0;
+  std::size_t last = 0;
+  std::string error;
+  buffer.FinishIndexing(command.range.Resolve(state.CursorLine(), SIZE_MAX,
+                                              first, last, error)
+                            ? last
+                            : SIZE_MAX);
+  if (!command.range.Resolve(state.CursorLine(), buffer.LineCount(), first,
+                             last, error)) {
+    state.SetStatus(error, StatusSeverity::kError);
+    return false;
+  }
+  const std::string_view kLine = buffer.GetLine(last - 1);
+  const std::size_t kIndent = kLine.find_first_not_of(" \t");
+  state.SetCursor(last - 1, kIndent == std::string_view::npos ? 0 : kIndent);
+  return true;
+}
+
+void InputHandler::SetWakeHook(std::function<void()> hook) {
+  wake_hook_ = std::move(hook);
+  for (auto& entry : commands_) {
+    entry.command->SetWakeHook(wake_hook_);
+  }
+}
+
+bool InputHandler::Poll(EditorState& state) {
+  bool changed = false;
+  for (auto& entry : commands_) {
+    changed = entry.command->Poll(state) || changed;
+  }
+  return changed;
+}
+
+bool InputHandler::IsBusy() const {
+  for (const auto& entry : commands_) {
+    if (entry.command->IsBusy()) {
       return true;
     }
   }
   return false;
 }
-}  // namespace core
\ No newline at end of file
+
+bool InputHandler::Cancel(EditorState& state) {
+  bool cancelled = false;
+  for (auto& entry : commands_) {
+    cancelled = entry.command->Cancel(state) || cancelled;
+  }
+  return cancelled;
+}
+
+void InputHandler::Finish(EditorState& state) {
+  for (auto& entry : commands_) {
+    entry.command->Finish(state);
+  }
+}
+}  // namespace core
@@ -0,0 +1,164 @@
+#include "core/KeyNotation.hpp"
+
+#include <cctype>
+#include <cstddef>
+
+namespace {
+using core::KeyCode;
+using core::KeyEvent;
+
+struct KeyName {
+  std::string_view name;
+  KeyCode code;
+  char value;
+};
+
+constexpr KeyName kNames[] = {
+    {"Esc", KeyCode::kEscape, '\0'},
+    {"CR", KeyCode::kEnter, '\0'},
+    {"BS", KeyCode::kBackspace, '\0'},
+    {"Up", KeyCode::kArrowUp, '\0'},
+    {"Down", KeyCode::kArrowDown, '\0'},
+    {"Left", KeyCode::kArrowLeft, '\0'},
+    {"Right", KeyCode::kArrowRight, '\0'},
+    {"Tab", KeyCode::kCharacter, '\t'},
+    {"lt", KeyCode::kCharacter, '<'},
+};
+
+constexpr std::string_view kPasteStart = "<Paste>";
+constexpr std::string_view kPasteEnd = "<PasteEnd>";
+
+bool SameName(std::string_view left, std::string_view right) {
+  if (left.size() != right.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < left.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(left[i])) !=
+        std::tolower(static_cast<unsigned char>(right[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The key named by the "<...>" at the start of `notation`; `length`
+// receives the length of the name with its brackets.
+bool ParseName(std::string_view notation, KeyEvent& event,
+               std::size_t& length) {
+  const std::size_t kClose = notation.find('>');
+  if (notation.empty() || notation.front() != '<' ||
+      kClose == std::string_view::npos) {
+    return false;
+  }
+  const std::string_view kName = notation.substr(1, kClose - 1);
+  length = kClose + 1;
+  for (const KeyName& entry : kNames) {
+    if (SameName(kName, entry.name)) {
+      event = KeyEvent{entry.code, entry.value};
+      return true;
+    }
+  }
+  if (kName.size() == 3 && SameName(kName.substr(0, 2), "C-")) {
+    const unsigned char kLetter = static_cast<unsigned char>(kName[2]);
+    if (kLetter == '?') {
+      event = core::MakeCharacterEvent('\x7f');
+      return true;
+    }
+    if (kLetter >= '@' && kLetter <= '_') {
+      event = core::MakeCharacterEvent(static_cast<char>(kLetter - '@'));
+      return true;
+    }
+    if (kLetter >= 'a' && kLetter <= 'z') {
+      event = core::MakeCharacterEvent(static_cast<char>(kLetter - 'a' + 1));
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendCharacter(char value, std::string& notation) {
+  const auto kByte = static_cast<unsigned char>(value);
+  if (value == '<') {
+    notation += "<lt>";
+  } else if (value == '\t') {
+    notation += "<Tab>";
+  } else if (kByte == 0x7f) {
+    notation += "<C-?>";
+  } else if (kByte < 0x20) {
+    notation += "<C-";
+    notation.push_back(static_cast<char>(
+        kByte >= 1 && kByte <= 26 ? kByte - 1 + 'a' : kByte + '@'));
+    notation.push_back('>');
+  } else {
+    notation.push_back(value);
+  }
+}
+}  // namespace
+
+namespace core {
+void AppendKeyNotation(const KeyEvent& event, std::string& notation) {
+  switch (event.code) {
+    case KeyCode::kCharacter:
+      AppendCharacter(event.value, notation);
+      return;
+    case KeyCode::kPaste:
+      notation += kPasteStart;
+      for (const char kValue : event.text) {
+        if (kValue == '\n') {
+          notation += "<CR>";
+        } else {
+          AppendCharacter(kValue, notation);
+        }
+      }
+      notation += kPasteEnd;
+      return;
+    default:
+      break;
+  }
+  for (const KeyName& entry : kNames) {
+    if (entry.code == event.code) {
+      notation.push_back('<');
+      notation += entry.name;
+      notation.push_back('>');
+      return;
+    }
+  }
+}
+
+void ParseKeyNotation(std::string_view notation, std::vector<KeyEvent>& events,
+                      std::deque<std::string>& pastes) {
+  std::string* paste = nullptr;
+  while (!notation.empty()) {
+    if (paste == nullptr && notation.starts_with(kPasteStart)) {
+      paste = &pastes.emplace_back();
+      notation.remove_prefix(kPasteStart.size());
+      continue;
+    }
+    if (paste != nullptr && notation.starts_with(kPasteEnd)) {
+      events.push_back(KeyEvent{KeyCode::kPaste, '\0', *paste});
+      paste = nullptr;
+      notation.remove_prefix(kPasteEnd.size());
+      continue;
+    }
+
+    KeyEvent event = MakeCharacterEvent(notation.front());
+    std::size_t length = 1;
+    if (!ParseName(notation, event, length)) {
+      event = MakeCharacterEvent(notation.front());
+      length = 1;
+    }
+    notation.remove_prefix(length);
+    if (paste == nullptr) {
+      events.push_back(event);
+    } else if (event.code == KeyCode::kEnter) {
+      paste->push_back('\n');
+    } else if (event.code == KeyCode::kCharacter) {
+      paste->push_back(event.value);
+    }
+  }
+  // A paste left open ends with the notation.
+  if (paste != nullptr) {
+    events.push_back(KeyEvent{KeyCode::kPaste, '\0', *paste});
+  }
+}
+}  // namespace core
@@ -0,0 +1,170 @@
+#include "core/Keymap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+struct NamedKey {
+  std::string_view gesture;
+  core::KeyCode code;
+};
+
+constexpr std::array<NamedKey, 7> kNamedKeys = {{
+    {"<Esc>", core::KeyCode::kEscape},
+    {"<Enter>", core::KeyCode::kEnter},
+    {"<Backspace>", core::KeyCode::kBackspace},
+    {"<Up>", core::KeyCode::kArrowUp},
+    {"<Down>", core::KeyCode::kArrowDown},
+    {"<Left>", core::KeyCode::kArrowLeft},
+    {"<Right>", core::KeyCode::kArrowRight},
+}};
+
+constexpr std::string_view kCharGesture = "<Char>";
+constexpr std::size_t kByteKeys = 256;
+constexpr auto kAnyMode = static_cast<std::size_t>(core::KeybindingMode::kAny);
+}  // namespace
+
+namespace core {
+Keymap::Keymap(std::uint64_t version) : version_(version), nodes_(1) {}
+
+bool Keymap::Bind(KeybindingMode mode, std::string_view gesture,
+                  Binding binding) {
+  std::vector<std::size_t> keys;
+  const auto kMode = static_cast<std::size_t>(mode);
+  if (!ParseGesture(gesture, keys) || kMode >= kModes ||
+      bindings_.size() >= UINT16_MAX) {
+    return false;
+  }
+
+  NodeId& root = roots_[kMode * kKeys + keys.front()];
+  if (root == 0) {
+    root = static_cast<NodeId>(nodes_.size());
+    nodes_.emplace_back();
+  }
+  NodeId node = root;
+  for (std::size_t i = 1; i < keys.size(); ++i) {
+    node = AddChild(node, keys[i]);
+  }
+  bindings_.push_back(std::move(binding));
+  nodes_[node].binding = static_cast<std::uint16_t>(bindings_.size());
+  return true;
+}
+
+const Keymap::Binding* Keymap::Find(Mode mode,
+                                    const KeyEvent& event) const noexcept {
+  return BindingAt(Root(mode, event));
+}
+
+Keymap::NodeId Keymap::Root(Mode mode, const KeyEvent& event) const noexcept {
+  const std::optional<std::size_t> kSlot = KeySlot(event);
+  if (!kSlot.has_value()) {
+    return 0;
+  }
+  const NodeId kNode = roots_[static_cast<std::size_t>(mode) * kKeys + *kSlot];
+  return kNode != 0 ? kNode : roots_[kAnyMode * kKeys + *kSlot];
+}
+
+Keymap::NodeId Keymap::Child(NodeId node,
+                             const KeyEvent& event) const noexcept {
+  const std::optional<std::size_t> kSlot = KeySlot(event);
+  if (node == 0 || !kSlot.has_value()) {
+    return 0;
+  }
+  const auto& children = nodes_[node].children;
+  const auto kIt = std::lower_bound(
+      children.begin(), children.end(), *kSlot,
+      [](const auto& child, std::size_t slot) { return child.first < slot; });
+  return kIt != children.end() && kIt->first == *kSlot ? kIt->second : 0;
+}
+
+Keymap::NodeId Keymap::CharChild(NodeId node) const noexcept {
+  return nodes_[node].char_child;
+}
+
+const Keymap::Binding* Keymap::BindingAt(NodeId node) const noexcept {
+  const std::uint16_t kIndex = nodes_[node].binding;
+  return kIndex != 0 ? &bindings_[kIndex - 1] : nullptr;
+}
+
+bool Keymap::HasChildren(NodeId node) const noexcept {
+  return !nodes_[node].children.empty() || nodes_[node].char_child != 0;
+}
+
+std::uint64_t Keymap::Version() const noexcept {
+  return version_;
+}
+
+std::optional<std::size_t> Keymap::KeySlot(const KeyEvent& event) noexcept {
+  if (event.code == KeyCode::kCharacter) {
+    if (event.value == '\0') {
+      return std::nullopt;
+    }
+    return static_cast<unsigned char>(event.value);
+  }
+  if (event.code >= KeyCode::kEscape && event.code <= KeyCode::kArrowRight) {
+    return kByteKeys + static_cast<std::size_t>(event.code) -
+           static_cast<std::size_t>(KeyCode::kEscape);
+  }
+  return std::nullopt;
+}
+
+bool Keymap::ParseGesture(std::string_view gesture,
+                          std::vector<std::size_t>& keys) {
+  while (!gesture.empty()) {
+    const std::size_t kClose = gesture.find('>');
+    const std::string_view kName = gesture.front() == '<' && kClose != 1 &&
+                                           kClose != std::string_view::npos
+                                       ? gesture.substr(0, kClose + 1)
+                                       : std::string_view{};
+    std::optional<std::size_t> slot;
+    if (kName.empty()) {
+      slot = static_cast<unsigned char>(gesture.front());
+    } else if (kName == kCharGesture) {
+      slot = kCharSlot;
+    } else if (kName.size() == 5 && kName.starts_with("<C-")) {
+      slot = static_cast<unsigned char>(kName[3]) & 0x1Fu;
+    } else {
+      for (const NamedKey& key : kNamedKeys) {
+        if (key.gesture == kName) {
+          slot = KeySlot(KeyEvent{key.code});
+        }
+      }
+    }
+    if (!slot.has_value() || (keys.empty() && *slot == kCharSlot)) {
+      return false;
+    }
+    keys.push_back(*slot);
+    gesture.remove_prefix(kName.empty() ? 1 : kName.size());
+  }
+  return !keys.empty();
+}
+
+Keymap::NodeId Keymap::AddChild(NodeId node, std::size_t slot) {
+  if (slot == kCharSlot) {
+    if (nodes_[node].char_child == 0) {
+      nodes_[node].char_child = static_cast<NodeId>(nodes_.size());
+      nodes_.emplace_back();
+    }
+    return nodes_[node].char_child;
+  }
+
+  auto& children = nodes_[node].children;
+  const auto kIt = std::lower_bound(
+      children.begin(), children.end(), slot,
+      [](const auto& child, std::size_t value) { return child.first < value; });
+  if (kIt != children.end() && kIt->first == slot) {
+    return kIt->second;
+  }
+  const auto kChild = static_cast<NodeId>(nodes_.size());
+  children.insert(kIt, {static_cast<std::uint16_t>(slot), kChild});
+  // Last: growing nodes_ invalidates `children`.
+  nodes_.emplace_back();
+  return kChild;
+}
+}  // namespace core
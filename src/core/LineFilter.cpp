@@ -0,0 +1,224 @@
+#include "core/LineFilter.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/WorkerPool.hpp"
+
+namespace {
+using core::LineRange;
+
+struct NumberedLine {
+  std::string_view line;
+  std::int64_t number = 0;
+  bool has_number = false;
+};
+
+bool IsDigit(char value) {
+  return value >= '0' && value <= '9';
+}
+
+NumberedLine Number(std::string_view line) {
+  NumberedLine numbered{line};
+  std::size_t start = 0;
+  while (start < line.size() && !IsDigit(line[start])) {
+    ++start;
+  }
+  if (start == line.size()) {
+    return numbered;
+  }
+  const bool kNegative = start > 0 && line[start - 1] == '-';
+  if (kNegative) {
+    --start;
+  }
+  const auto [end, error] = std::from_chars(
+      line.data() + start, line.data() + line.size(), numbered.number);
+  if (error == std::errc::result_out_of_range) {
+    numbered.number = kNegative ? (std::numeric_limits<std::int64_t>::min)()
+                                : (std::numeric_limits<std::int64_t>::max)();
+  }
+  numbered.has_number = true;
+  return numbered;
+}
+
+// How many threads share `items` items, the caller's included.
+std::size_t ThreadsFor(std::size_t items) {
+  if (items < 2 * core::kParallelLines) {
+    return 1;
+  }
+  return std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1,
+                                 items / core::kParallelLines);
+}
+
+// Runs job(0) .. job(jobs - 1) on `threads` threads, the calling one among
+// them, taking the helpers from the shared pool.
+void RunJobs(std::size_t jobs, std::size_t threads,
+             const std::function<void(std::size_t)>& job) {
+  core::WorkerPool::Shared().ForEach(jobs, threads - 1, job);
+}
+
+// The starts of `slices` nearly equal slices of `items` items, and its end.
+std::vector<std::size_t> SliceBounds(std::size_t items, std::size_t slices) {
+  std::vector<std::size_t> bounds(slices + 1);
+  for (std::size_t i = 0; i <= slices; ++i) {
+    bounds[i] = items * i / slices;
+  }
+  return bounds;
+}
+
+// Each slice is sorted on its own, then neighbours are merged in rounds that
+// halve the number of slices, bouncing between `items` and a scratch copy.
+// Merging takes from the left slice first on ties, so the sort stays stable.
+template <typename T, typename Less>
+void ParallelStableSort(std::vector<T>& items, const Less& less) {
+  const std::size_t kThreads = ThreadsFor(items.size());
+  if (kThreads <= 1) {
+    std::stable_sort(items.begin(), items.end(), less);
+    return;
+  }
+
+  std::vector<std::size_t> bounds = SliceBounds(items.size(), kThreads);
+  const auto kAt = [](std::vector<T>& of, std::size_t index) {
+    return of.begin() + static_cast<std::ptrdiff_t>(index);
+  };
+  RunJobs(kThreads, kThreads, [&](std::size_t slice) {
+    std::stable_sort(kAt(items, bounds[slice]), kAt(items, bounds[slice + 1]),
+                     less);
+  });
+
+  std::vector<T> scratch(items.size());
+  std::vector<T>* from = &items;
+  std::vector<T>* to = &scratch;
+  while (bounds.size() > 2) {
+    const std::size_t kSlices = bounds.size() - 1;
+    RunJobs((kSlices + 1) / 2, kThreads, [&](std::size_t pair) {
+      const std::size_t kLow = bounds[2 * pair];
+      const std::size_t kMiddle = bounds[2 * pair + 1];
+      const std::size_t kHigh =
+          2 * pair + 2 < bounds.size() ? bounds[2 * pair + 2] : kMiddle;
+      std::merge(kAt(*from, kLow), kAt(*from, kMiddle), kAt(*from, kMiddle),
+                 kAt(*from, kHigh), kAt(*to, kLow), less);
+    });
+
+    std::vector<std::size_t> merged;
+    merged.reserve(kSlices / 2 + 2);
+    for (std::size_t i = 0; i < bounds.size(); i += 2) {
+      merged.push_back(bounds[i]);
+    }
+    if (merged.back() != bounds.back()) {
+      merged.push_back(bounds.back());
+    }
+    bounds = std::move(merged);
+    std::swap(from, to);
+  }
+  if (from != &items) {
+    items.swap(*from);
+  }
+}
+
+// Adds the lines [first, last) to `runs`, joining them to the last run when
+// they follow it.
+void AddRun(std::vector<LineRange>& runs, std::size_t first,
+            std::size_t last) {
+  if (!runs.empty() && runs.back().last == first) {
+    runs.back().last = last;
+  } else {
+    runs.push_back({first, last});
+  }
+}
+}  // namespace
+
+namespace core {
+std::vector<std::string_view> SnapshotLines(const TextSnapshot& snapshot,
+                                            std::size_t first,
+                                            std::size_t last) {
+  std::vector<std::string_view> lines;
+  last = (std::min)(last, snapshot.line_count);
+  if (first >= last) {
+    return lines;
+  }
+  lines.reserve(last - first);
+  TextSnapshot::Cursor cursor = snapshot.Locate(first);
+  do {
+    lines.push_back(snapshot.LineAt(cursor));
+  } while (lines.size() < last - first && snapshot.Next(cursor));
+  return lines;
+}
+
+void SortLines(std::vector<std::string_view>& lines, const SortOrder& order) {
+  if (order.numeric) {
+    std::vector<NumberedLine> numbered(lines.size());
+    const std::size_t kThreads = ThreadsFor(lines.size());
+    const std::vector<std::size_t> kBounds =
+        SliceBounds(lines.size(), kThreads);
+    RunJobs(kThreads, kThreads, [&](std::size_t slice) {
+      for (std::size_t i = kBounds[slice]; i < kBounds[slice + 1]; ++i) {
+        numbered[i] = Number(lines[i]);
+      }
+    });
+    const auto kLess = [](const NumberedLine& lhs, const NumberedLine& rhs) {
+      if (lhs.has_number != rhs.has_number) {
+        return rhs.has_number;
+      }
+      return lhs.number < rhs.number;
+    };
+    if (order.reverse) {
+      ParallelStableSort(numbered, [&kLess](const auto& lhs, const auto& rhs) {
+        return kLess(rhs, lhs);
+      });
+    } else {
+      ParallelStableSort(numbered, kLess);
+    }
+    for (std::size_t i = 0; i < numbered.size(); ++i) {
+      lines[i] = numbered[i].line;
+    }
+  } else if (order.reverse) {
+    ParallelStableSort(lines, std::greater<std::string_view>());
+  } else {
+    ParallelStableSort(lines, std::less<std::string_view>());
+  }
+
+  if (order.unique) {
+    lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+  }
+}
+
+std::vector<LineRange> MatchLines(std::span<const std::string_view> lines,
+                                  std::size_t first_line,
+                                  const Pattern& pattern, bool invert) {
+  const std::size_t kThreads = ThreadsFor(lines.size());
+  const std::vector<std::size_t> kBounds =
+      SliceBounds(lines.size(), kThreads);
+  std::vector<std::vector<LineRange>> slices(kThreads);
+  RunJobs(kThreads, kThreads, [&](std::size_t slice) {
+    PatternMatch match;
+    for (std::size_t i = kBounds[slice]; i < kBounds[slice + 1]; ++i) {
+      if (pattern.Find(lines[i], 0, match) != invert) {
+        AddRun(slices[slice], first_line + i, first_line + i + 1);
+      }
+    }
+  });
+
+  std::vector<LineRange> runs;
+  if (kThreads == 1) {
+    runs = std::move(slices.front());
+    return runs;
+  }
+  for (const std::vector<LineRange>& slice : slices) {
+    for (const LineRange& run : slice) {
+      AddRun(runs, run.first, run.last);
+    }
+  }
+  return runs;
+}
+}  // namespace core
@@ -0,0 +1,104 @@
+#include "core/LineIndexer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr std::size_t kSyncChunkBytes = 256 * 1024;
+constexpr std::size_t kScanChunkBytes = 4 * 1024 * 1024;
+}  // namespace
+
+namespace core {
+LineIndexer::~LineIndexer() {
+  Stop();
+}
+
+void LineIndexer::Start(std::string_view text, std::size_t sync_lines,
+                        std::vector<std::uint64_t>& starts) {
+  Stop();
+  text_ = text;
+  scanner_ = LineScanner();
+
+  std::uint64_t position = 0;
+  while (position < text_.size() && starts.size() < sync_lines) {
+    const std::size_t kLength = (std::min)(
+        kSyncChunkBytes, static_cast<std::size_t>(text_.size() - position));
+    scanner_.Scan(text_.substr(position, kLength), position, starts);
+    position += kLength;
+  }
+
+  if (position >= text_.size()) {
+    scanner_.Finish();
+    return;
+  }
+
+  offset_ = position;
+  pending_.clear();
+  finished_.store(false, std::memory_order_relaxed);
+  running_ = true;
+  worker_ =
+      std::jthread([this](const std::stop_token& token) { Run(token); });
+}
+
+void LineIndexer::Stop() {
+  if (worker_.joinable()) {
+    worker_.request_stop();
+    worker_.join();
+  }
+  running_ = false;
+  pending_.clear();
+}
+
+void LineIndexer::Wait() {
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+bool LineIndexer::Drain(std::vector<std::uint64_t>& starts) {
+  if (!running_) {
+    return true;
+  }
+
+  const bool kFinished = finished_.load(std::memory_order_acquire);
+  {
+    std::scoped_lock lock(mutex_);
+    if (starts.empty()) {
+      starts.swap(pending_);
+    } else {
+      starts.insert(starts.end(), pending_.begin(), pending_.end());
+      pending_.clear();
+    }
+  }
+
+  if (kFinished) {
+    running_ = false;
+  }
+  return kFinished;
+}
+
+bool LineIndexer::IsRunning() const noexcept {
+  return running_;
+}
+
+const TextStats& LineIndexer::Stats() const noexcept {
+  return scanner_.Stats();
+}
+
+void LineIndexer::Run(const std::stop_token& token) {
+  std::vector<std::uint64_t> batch;
+  std::uint64_t position = offset_;
+  while (position < text_.size() && !token.stop_requested()) {
+    const std::size_t kLength = (std::min)(
+        kScanChunkBytes, static_cast<std::size_t>(text_.size() - position));
+    scanner_.Scan(text_.substr(position, kLength), position, batch);
+    position += kLength;
+
+    std::scoped_lock lock(mutex_);
+    pending_.insert(pending_.end(), batch.begin(), batch.end());
+    batch.clear();
+  }
+  scanner_.Finish();
+  finished_.store(true, std::memory_order_release);
+}
+}  // namespace core
@@ -0,0 +1,155 @@
+#include "core/LineLayout.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "core/Utf8.hpp"
+
+namespace core {
+void LineLayout::Reset(std::string_view line, std::size_t tabstop,
+                       std::size_t wrap_width) {
+  tabstop_ = (std::max<std::size_t>)(tabstop, 1);
+  wrap_width_ = wrap_width;
+  marks_.clear();
+  marks_.push_back({0, 0});
+  next_mark_ = kMarkBytes;
+  walked_byte_ = 0;
+  walked_column_ = 0;
+  complete_ = line.empty();
+}
+
+std::size_t LineLayout::Width(std::string_view line) {
+  Extend(line, SIZE_MAX, SIZE_MAX);
+  return walked_column_;
+}
+
+std::size_t LineLayout::Rows(std::string_view line, std::size_t limit) {
+  if (wrap_width_ == 0 || limit <= 1) {
+    return (std::min<std::size_t>)(limit, 1);
+  }
+  // A character placed at or after column limit * width has started row
+  // `limit`, past the rows asked about.
+  Extend(line, SIZE_MAX,
+         limit > SIZE_MAX / wrap_width_ ? SIZE_MAX : limit * wrap_width_);
+  return (std::min)(marks_.size(), limit);
+}
+
+LineLayout::Glyph LineLayout::Locate(std::string_view line,
+                                     std::size_t column) {
+  Extend(line, SIZE_MAX, column);
+  if (complete_ && column >= walked_column_) {
+    return {line.size(), 0, walked_column_, 0};
+  }
+  const auto kMark = std::upper_bound(
+      marks_.begin(), marks_.end(), column,
+      [](std::size_t value, const Mark& mark) { return value < mark.column; });
+  const Mark& from = *(kMark - 1);
+  Glyph glyph = Place(line, from.byte, from.column);
+  while (glyph.length > 0 && glyph.column + glyph.cells <= column) {
+    glyph = Next(line, glyph);
+  }
+  return glyph;
+}
+
+std::size_t LineLayout::ColumnOf(std::string_view line, std::size_t byte) {
+  if (byte >= line.size()) {
+    return Width(line);
+  }
+  Extend(line, byte, SIZE_MAX);
+  const auto kMark = std::upper_bound(
+      marks_.begin(), marks_.end(), byte,
+      [](std::size_t value, const Mark& mark) { return value < mark.byte; });
+  const Mark& from = *(kMark - 1);
+  Glyph glyph = Place(line, from.byte, from.column);
+  while (glyph.byte + glyph.length <= byte) {
+    glyph = Next(line, glyph);
+  }
+  return glyph.column;
+}
+
+LineLayout::Glyph LineLayout::Next(std::string_view line,
+                                   const Glyph& glyph) const noexcept {
+  const std::size_t kByte = glyph.byte + glyph.length;
+  if (kByte >= line.size()) {
+    return {line.size(), 0, glyph.column + glyph.cells, 0};
+  }
+  return Place(line, kByte, glyph.column + glyph.cells);
+}
+
+LineLayout::Glyph LineLayout::Place(std::string_view line, std::size_t byte,
+                                    std::size_t column) const noexcept {
+  Glyph glyph{byte, 1, column, 1};
+  const auto kValue = static_cast<unsigned char>(line[byte]);
+  if (kValue == '\t') {
+    glyph.cells = tabstop_ - column % tabstop_;
+  } else if (kValue < 0x20 || kValue == 0x7F) {
+    glyph.cells = 2;
+  } else if (kValue >= 0x80) {
+    glyph.cells = CharacterWidth(DecodeUtf8(line, byte, glyph.length));
+  }
+
+  if (wrap_width_ > 0 && glyph.cells > 0) {
+    const std::size_t kRowEnd = (column / wrap_width_ + 1) * wrap_width_;
+    if (column + glyph.cells > kRowEnd) {
+      if (kValue == '\t') {
+        glyph.cells = kRowEnd - column;
+      } else if (column % wrap_width_ != 0) {
+        glyph.column = kRowEnd;
+      }
+    }
+  }
+  return glyph;
+}
+
+void LineLayout::Extend(std::string_view line, std::size_t byte,
+                        std::size_t column) {
+  while (!complete_ && walked_byte_ <= byte && walked_column_ <= column) {
+    // Printable ASCII takes a cell a byte and never meets a row's end
+    // unevenly, so a run of it is passed over whole, as far as asked.
+    const std::size_t kAhead = (std::min)({byte - walked_byte_,
+                                           column - walked_column_,
+                                           line.size() - walked_byte_ - 1}) +
+                               1;
+    const std::size_t kRun =
+        PlainAsciiPrefix(line.substr(walked_byte_, kAhead));
+    if (kRun > 0) {
+      const std::size_t kEnd = walked_byte_ + kRun;
+      if (wrap_width_ > 0) {
+        // A row a wide character overflowed starts at the next character.
+        while (marks_.size() * wrap_width_ < walked_column_ + kRun) {
+          const std::size_t kRowStart = marks_.size() * wrap_width_;
+          marks_.push_back(
+              {walked_byte_ + (std::max)(kRowStart, walked_column_) -
+                   walked_column_,
+               kRowStart});
+        }
+      } else {
+        for (std::size_t at = (std::max)(next_mark_, walked_byte_); at < kEnd;
+             at = next_mark_) {
+          marks_.push_back({at, walked_column_ + (at - walked_byte_)});
+          next_mark_ = at + kMarkBytes;
+        }
+      }
+      walked_byte_ = kEnd;
+      walked_column_ += kRun;
+      complete_ = walked_byte_ >= line.size();
+      continue;
+    }
+
+    const Glyph kGlyph = Place(line, walked_byte_, walked_column_);
+    if (wrap_width_ > 0) {
+      while (kGlyph.column >= marks_.size() * wrap_width_) {
+        marks_.push_back({walked_byte_, marks_.size() * wrap_width_});
+      }
+    } else if (walked_byte_ >= next_mark_) {
+      marks_.push_back({walked_byte_, kGlyph.column});
+      next_mark_ = walked_byte_ + kMarkBytes;
+    }
+    walked_byte_ += kGlyph.length;
+    walked_column_ = kGlyph.column + kGlyph.cells;
+    complete_ = walked_byte_ >= line.size();
+  }
+}
+}  // namespace core
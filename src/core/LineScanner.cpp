@@ -0,0 +1,346 @@
+#include "core/LineScanner.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MICROVI_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MICROVI_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(MICROVI_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MICROVI_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MICROVI_TARGET_AVX2
+#endif
+
+namespace core {
+namespace {
+using ScanState = LineScanner::State;
+
+void ValidateUtf8(const unsigned char* data, std::size_t size,
+                  ScanState& state) {
+  for (std::size_t i = 0; i < size; ++i) {
+    const unsigned char kByte = data[i];
+    if (state.utf8_pending > 0) {
+      if ((kByte & 0xC0u) == 0x80u) {
+        state.utf8_pending -= 1;
+        continue;
+      }
+      state.utf8_valid = false;
+      state.utf8_pending = 0;
+    }
+
+    if (kByte < 0x80u) {
+      continue;
+    }
+    if (kByte >= 0xC2u && kByte <= 0xDFu) {
+      state.utf8_pending = 1;
+    } else if (kByte >= 0xE0u && kByte <= 0xEFu) {
+      state.utf8_pending = 2;
+    } else if (kByte >= 0xF0u && kByte <= 0xF4u) {
+      state.utf8_pending = 3;
+    } else {
+      state.utf8_valid = false;
+    }
+  }
+}
+
+// Folds the per-byte match masks of one block (bit i set for byte i) into
+// the running statistics and line-start table.
+inline void ConsumeBlock(const unsigned char* block, std::size_t width,
+                         std::uint64_t block_base, std::uint64_t newlines,
+                         std::uint64_t returns, std::uint64_t nuls,
+                         std::uint64_t high, ScanState& state,
+                         TextStats& stats,
+                         std::vector<std::uint64_t>& starts) {
+  if (high != 0 || state.utf8_pending != 0) {
+    state.non_ascii = state.non_ascii || high != 0;
+    ValidateUtf8(block, width, state);
+  }
+
+  if (nuls != 0) {
+    stats.nul_count += static_cast<std::uint64_t>(std::popcount(nuls));
+  }
+
+  if (newlines != 0) {
+    const std::uint64_t kPrecededByCr =
+        (returns << 1) | (state.previous_cr ? 1u : 0u);
+    stats.lf_count += static_cast<std::uint64_t>(std::popcount(newlines));
+    stats.crlf_count +=
+        static_cast<std::uint64_t>(std::popcount(newlines & kPrecededByCr));
+    while (newlines != 0) {
+      const int kBit = std::countr_zero(newlines);
+      starts.push_back(block_base + static_cast<std::uint64_t>(kBit) + 1);
+      newlines &= newlines - 1;
+    }
+  }
+
+  state.previous_cr = ((returns >> (width - 1)) & 1u) != 0;
+}
+
+void ScanScalar(const unsigned char* data, std::size_t size,
+                std::uint64_t base, ScanState& state, TextStats& stats,
+                std::vector<std::uint64_t>& starts) {
+  constexpr std::size_t kWidth = 64;
+  for (std::size_t offset = 0; offset < size; offset += kWidth) {
+    const std::size_t kCount =
+        size - offset < kWidth ? size - offset : kWidth;
+    std::uint64_t newlines = 0;
+    std::uint64_t returns = 0;
+    std::uint64_t nuls = 0;
+    std::uint64_t high = 0;
+    for (std::size_t i = 0; i < kCount; ++i) {
+      const unsigned char kByte = data[offset + i];
+      const std::uint64_t kBit = std::uint64_t{1} << i;
+      newlines |= kByte == '\n' ? kBit : 0;
+      returns |= kByte == '\r' ? kBit : 0;
+      nuls |= kByte == 0 ? kBit : 0;
+      high |= kByte >= 0x80u ? kBit : 0;
+    }
+    ConsumeBlock(data + offset, kCount, base + offset, newlines, returns, nuls,
+                 high, state, stats, starts);
+  }
+}
+
+#ifdef MICROVI_SCAN_X86
+void ScanSse2(const unsigned char* data, std::size_t size, std::uint64_t base,
+              ScanState& state, TextStats& stats,
+              std::vector<std::uint64_t>& starts) {
+  constexpr std::size_t kWidth = 16;
+  const __m128i kNewline = _mm_set1_epi8('\n');
+  const __m128i kReturn = _mm_set1_epi8('\r');
+  const __m128i kZero = _mm_setzero_si128();
+
+  std::size_t offset = 0;
+  for (; offset + kWidth <= size; offset += kWidth) {
+    const __m128i kBlock =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+    const auto kNewlines = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(kBlock, kNewline)));
+    const auto kReturns = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(kBlock, kReturn)));
+    const auto kNuls = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(kBlock, kZero)));
+    const auto kHigh = static_cast<std::uint32_t>(_mm_movemask_epi8(kBlock));
+    if ((kNewlines | kReturns | kNuls | kHigh) == 0 &&
+        state.utf8_pending == 0) {
+      state.previous_cr = false;
+      continue;
+    }
+    ConsumeBlock(data + offset, kWidth, base + offset, kNewlines, kReturns,
+                 kNuls, kHigh, state, stats, starts);
+  }
+
+  ScanScalar(data + offset, size - offset, base + offset, state, stats,
+             starts);
+}
+
+MICROVI_TARGET_AVX2 void ScanAvx2(const unsigned char* data, std::size_t size,
+                                  std::uint64_t base, ScanState& state,
+                                  TextStats& stats,
+                                  std::vector<std::uint64_t>& starts) {
+  constexpr std::size_t kWidth = 32;
+  const __m256i kNewline = _mm256_set1_epi8('\n');
+  const __m256i kReturn = _mm256_set1_epi8('\r');
+  const __m256i kZero = _mm256_setzero_si256();
+
+  std::size_t offset = 0;
+  for (; offset + kWidth <= size; offset += kWidth) {
+    const __m256i kBlock =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+    const auto kNewlines = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(kBlock, kNewline)));
+    const auto kReturns = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(kBlock, kReturn)));
+    const auto kNuls = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(kBlock, kZero)));
+    const auto kHigh =
+        static_cast<std::uint32_t>(_mm256_movemask_epi8(kBlock));
+    if ((kNewlines | kReturns | kNuls | kHigh) == 0 &&
+        state.utf8_pending == 0) {
+      state.previous_cr = false;
+      continue;
+    }
+    ConsumeBlock(data + offset, kWidth, base + offset, kNewlines, kReturns,
+                 kNuls, kHigh, state, stats, starts);
+  }
+
+  ScanSse2(data + offset, size - offset, base + offset, state, stats, starts);
+}
+
+bool CpuHasAvx2() noexcept {
+#ifdef _MSC_VER
+  int info[4] = {};
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  const bool kOsSavesYmm = (info[2] & (1 << 27)) != 0 &&
+                           (_xgetbv(0) & 0x6) == 0x6;
+  __cpuidex(info, 7, 0);
+  return kOsSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+#ifdef MICROVI_SCAN_NEON
+std::uint32_t NeonMask(uint8x16_t matches) {
+  static const uint8_t kBits[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                    1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t kMasked = vandq_u8(matches, vld1q_u8(kBits));
+  const std::uint32_t kLow = vaddv_u8(vget_low_u8(kMasked));
+  const std::uint32_t kHigh = vaddv_u8(vget_high_u8(kMasked));
+  return kLow | (kHigh << 8);
+}
+
+void ScanNeon(const unsigned char* data, std::size_t size, std::uint64_t base,
+              ScanState& state, TextStats& stats,
+              std::vector<std::uint64_t>& starts) {
+  constexpr std::size_t kWidth = 16;
+  const uint8x16_t kNewline = vdupq_n_u8('\n');
+  const uint8x16_t kReturn = vdupq_n_u8('\r');
+  const uint8x16_t kHighBit = vdupq_n_u8(0x80);
+
+  std::size_t offset = 0;
+  for (; offset + kWidth <= size; offset += kWidth) {
+    const uint8x16_t kBlock = vld1q_u8(data + offset);
+    const uint8x16_t kNewlineMatch = vceqq_u8(kBlock, kNewline);
+    const uint8x16_t kReturnMatch = vceqq_u8(kBlock, kReturn);
+    const uint8x16_t kNulMatch = vceqzq_u8(kBlock);
+    const uint8x16_t kHighMatch = vtstq_u8(kBlock, kHighBit);
+    const uint8x16_t kAny =
+        vorrq_u8(vorrq_u8(kNewlineMatch, kReturnMatch),
+                 vorrq_u8(kNulMatch, kHighMatch));
+    if (vmaxvq_u8(kAny) == 0 && state.utf8_pending == 0) {
+      state.previous_cr = false;
+      continue;
+    }
+    ConsumeBlock(data + offset, kWidth, base + offset,
+                 NeonMask(kNewlineMatch), NeonMask(kReturnMatch),
+                 NeonMask(kNulMatch), NeonMask(kHighMatch), state, stats,
+                 starts);
+  }
+
+  ScanScalar(data + offset, size - offset, base + offset, state, stats,
+             starts);
+}
+#endif
+}  // namespace
+
+LineScanner::LineScanner(ScanKernel kernel)
+    : kernel_(kernel == ScanKernel::kAuto || !IsSupported(kernel)
+                  ? DetectKernel()
+                  : kernel) {}
+
+void LineScanner::Scan(std::string_view text, std::uint64_t base,
+                       std::vector<std::uint64_t>& starts) {
+  const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+  std::size_t size = text.size();
+
+  if (stats_.bytes == 0 && base == 0 && size >= 2) {
+    if (data[0] == 0xEF && size >= 3 && data[1] == 0xBB && data[2] == 0xBF) {
+      stats_.has_bom = true;
+      stats_.encoding = TextEncoding::kUtf8;
+    } else if (data[0] == 0xFF && data[1] == 0xFE) {
+      stats_.has_bom = true;
+      stats_.encoding = TextEncoding::kUtf16Le;
+    } else if (data[0] == 0xFE && data[1] == 0xFF) {
+      stats_.has_bom = true;
+      stats_.encoding = TextEncoding::kUtf16Be;
+    }
+  }
+  stats_.bytes += size;
+
+  switch (kernel_) {
+#ifdef MICROVI_SCAN_X86
+    case ScanKernel::kAvx2:
+      ScanAvx2(data, size, base, state_, stats_, starts);
+      return;
+    case ScanKernel::kSse2:
+      ScanSse2(data, size, base, state_, stats_, starts);
+      return;
+#endif
+#ifdef MICROVI_SCAN_NEON
+    case ScanKernel::kNeon:
+      ScanNeon(data, size, base, state_, stats_, starts);
+      return;
+#endif
+    default:
+      ScanScalar(data, size, base, state_, stats_, starts);
+      return;
+  }
+}
+
+void LineScanner::Finish() {
+  if (state_.utf8_pending != 0) {
+    state_.utf8_valid = false;
+    state_.utf8_pending = 0;
+  }
+
+  if (stats_.encoding == TextEncoding::kUtf16Le ||
+      stats_.encoding == TextEncoding::kUtf16Be) {
+    return;
+  }
+  if (stats_.nul_count > 0) {
+    stats_.encoding = TextEncoding::kBinary;
+  } else if (!state_.non_ascii) {
+    stats_.encoding = TextEncoding::kAscii;
+  } else if (state_.utf8_valid) {
+    stats_.encoding = TextEncoding::kUtf8;
+  } else {
+    stats_.encoding = TextEncoding::kLegacy8Bit;
+  }
+}
+
+const TextStats& LineScanner::Stats() const noexcept {
+  return stats_;
+}
+
+ScanKernel LineScanner::Kernel() const noexcept {
+  return kernel_;
+}
+
+ScanKernel LineScanner::DetectKernel() noexcept {
+#if defined(MICROVI_SCAN_X86)
+  static const ScanKernel kDetected =
+      CpuHasAvx2() ? ScanKernel::kAvx2 : ScanKernel::kSse2;
+  return kDetected;
+#elif defined(MICROVI_SCAN_NEON)
+  return ScanKernel::kNeon;
+#else
+  return ScanKernel::kScalar;
+#endif
+}
+
+bool LineScanner::IsSupported(ScanKernel kernel) noexcept {
+  switch (kernel) {
+    case ScanKernel::kAuto:
+    case ScanKernel::kScalar:
+      return true;
+#if defined(MICROVI_SCAN_X86)
+    case ScanKernel::kSse2:
+      return true;
+    case ScanKernel::kAvx2:
+      return CpuHasAvx2();
+#elif defined(MICROVI_SCAN_NEON)
+    case ScanKernel::kNeon:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+}  // namespace core
@@ -1,598 +1,94 @@
 #include "core/ModeController.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
-#include <initializer_list>
+#include <cstdint>
 #include <limits>
 #include <optional>
 #include <sstream>
+#include <stop_token>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 
 #include "core/Buffer.hpp"
 #include "core/EditorState.hpp"
 #include "core/Mode.hpp"
+#include "core/Motions.hpp"
+#include "core/Pattern.hpp"
+#include "core/Profiler.hpp"
+#include "core/Registers.hpp"
+#include "core/Searcher.hpp"
+#include "core/Utf8.hpp"
+#include "core/WorkerPool.hpp"
 
 namespace {
+using core::TextPosition;
+
 constexpr char kCommandPrefix = ':';
-constexpr std::size_t kMaxCountValue = 1000000;
 
-struct TextPosition {
-  std::size_t line = 0;
-  std::size_t column = 0;
+enum class OperatorAction : std::uint8_t {
+  kMove,
+  kDelete,
+  kYank,
 };
 
-struct FindParams {
-  char target = 0;
-  std::size_t count = 1;
-  std::size_t start_column = 0;
+// The operators are types for the same reason the motions are (see
+// Motions.hpp); moving the cursor is the one without a key.
+struct MoveOperator {
+  static constexpr OperatorAction kAction = OperatorAction::kMove;
+  static constexpr std::string_view kName = "move";
+  static constexpr std::string_view kLabel = "Move";
+  static constexpr std::string_view kKeys = "";
 };
 
-enum class FindOperationKind : std::uint8_t {
-  kForwardTo,
-  kForwardTill,
-  kBackwardTo,
-  kBackwardTill,
+struct DeleteOperator {
+  static constexpr OperatorAction kAction = OperatorAction::kDelete;
+  static constexpr std::string_view kName = "delete";
+  static constexpr std::string_view kLabel = "Delete";
+  static constexpr std::string_view kKeys = "d";
 };
 
-struct FindMotionResult {
-  TextPosition cursor{};
-  std::size_t matched_column = 0;
-  bool include_target_char = false;
-  bool backward = false;
+struct YankOperator {
+  static constexpr OperatorAction kAction = OperatorAction::kYank;
+  static constexpr std::string_view kName = "yank";
+  static constexpr std::string_view kLabel = "Yank";
+  static constexpr std::string_view kKeys = "y";
 };
 
-std::size_t AppendCountDigit(std::size_t current, std::size_t digit) {
-  const std::size_t kNext = current * 10 + digit;
-  return kNext > kMaxCountValue ? kMaxCountValue : kNext;
-}
-
-std::string FormatPendingStatus(std::string_view pending_command,
-                                std::size_t prefix_count, bool has_prefix_count,
-                                std::size_t motion_count,
-                                bool has_motion_count) {
-  std::string status;
-  if (has_prefix_count && prefix_count > 0) {
-    status += std::to_string(prefix_count);
-  }
-  status.append(pending_command);
-  if (has_motion_count && motion_count > 0) {
-    status += std::to_string(motion_count);
-  }
-  return status;
-}
-
-FindOperationKind FindKindFromCommand(char command) {
-  switch (command) {
-    case 'f':
-      return FindOperationKind::kForwardTo;
-    case 'F':
-      return FindOperationKind::kBackwardTo;
-    case 't':
-      return FindOperationKind::kForwardTill;
-    case 'T':
-      return FindOperationKind::kBackwardTill;
-    default:
-      return FindOperationKind::kForwardTo;
-  }
-}
-
-char CommandFromState(bool backward, bool till) {
-  if (!backward && !till) {
-    return 'f';
-  }
-  if (!backward && till) {
-    return 't';
-  }
-  if (backward && !till) {
-    return 'F';
-  }
-  return 'T';
-}
-
-bool IsWordChar(char ch) {
-  const unsigned char kCharacter = static_cast<unsigned char>(ch);
-  return std::isalnum(kCharacter) != 0 || kCharacter == '_';
-}
-
-bool IsBlankLine(std::string_view line) {
-  for (unsigned char ch : line) {
-    if (std::isspace(ch) == 0) {
-      return false;
-    }
-  }
-  return true;
-}
-
-TextPosition ClampPosition(const core::Buffer& buffer, TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  if (position.line >= buffer.LineCount()) {
-    position.line = buffer.LineCount() - 1;
-  }
-
-  const std::string& line = buffer.GetLine(position.line);
-  if (position.column > line.size()) {
-    position.column = line.size();
-  }
-
-  return position;
-}
-
-TextPosition NextWordStart(const core::Buffer& buffer, TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-
-  bool consumed_segment = false;
-
-  while (position.line < buffer.LineCount()) {
-    const std::string& line = buffer.GetLine(position.line);
-    const std::size_t kLineLength = line.size();
-
-    if (position.column >= kLineLength) {
-      if (position.line + 1 >= buffer.LineCount()) {
-        return TextPosition{position.line, kLineLength};
-      }
-      position.line += 1;
-      position.column = 0;
-      consumed_segment = false;
-      continue;
-    }
-
-    const unsigned char kCurrentChar =
-        static_cast<unsigned char>(line.at(position.column));
-    if (std::isspace(kCurrentChar) != 0) {
-      consumed_segment = false;
-      position.column += 1;
-      continue;
-    }
-
-    if (!consumed_segment) {
-      const bool kInitialIsWord = IsWordChar(static_cast<char>(kCurrentChar));
-      consumed_segment = true;
-      while (position.column < kLineLength) {
-        const unsigned char kNextChar =
-            static_cast<unsigned char>(line.at(position.column));
-        if (std::isspace(kNextChar) != 0) {
-          break;
-        }
-        const bool kNextIsWord = IsWordChar(static_cast<char>(kNextChar));
-        if (kNextIsWord != kInitialIsWord) {
-          break;
-        }
-        position.column += 1;
-      }
-      continue;
-    }
-
-    return position;
-  }
-
-  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
-  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
+template <typename... Types>
+struct TypeList {};
+
+using Operators = TypeList<MoveOperator, DeleteOperator, YankOperator>;
+using Motions =
+    TypeList<core::LeftMotion, core::RightMotion, core::DownMotion,
+             core::UpMotion, core::LineMotion, core::LineStartMotion,
+             core::FirstNonBlankMotion, core::LineEndMotion,
+             core::WordMotion, core::BigWordMotion, core::WordBackMotion,
+             core::BigWordBackMotion, core::WordEndMotion,
+             core::BigWordEndMotion, core::ParagraphForwardMotion,
+             core::ParagraphBackMotion, core::FirstLineMotion,
+             core::GoToLineMotion, core::FindMotion<false, false>,
+             core::FindMotion<true, false>, core::FindMotion<false, true>,
+             core::FindMotion<true, true>, core::RepeatFindMotion<false>,
+             core::RepeatFindMotion<true>>;
+
+std::size_t CountOr(const core::CommandInvocation& invocation,
+                    std::size_t fallback) {
+  return invocation.count != 0 ? invocation.count : fallback;
 }
 
-TextPosition NextBigWordStart(const core::Buffer& buffer,
-                              TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
+std::string LinesMessage(std::string_view verb, std::size_t lines) {
+  std::ostringstream message;
+  message << verb << ' ' << lines << " line";
+  if (lines != 1) {
+    message << 's';
   }
-
-  position = ClampPosition(buffer, position);
-  bool consumed_segment = false;
-
-  while (position.line < buffer.LineCount()) {
-    const std::string& line = buffer.GetLine(position.line);
-    const std::size_t kLineLength = line.size();
-
-    if (position.column >= kLineLength) {
-      if (position.line + 1 >= buffer.LineCount()) {
-        return TextPosition{position.line, kLineLength};
-      }
-      position.line += 1;
-      position.column = 0;
-      consumed_segment = false;
-      continue;
-    }
-
-    const unsigned char kCurrentChar =
-        static_cast<unsigned char>(line.at(position.column));
-    if (std::isspace(kCurrentChar) != 0) {
-      consumed_segment = false;
-      position.column += 1;
-      continue;
-    }
-
-    if (!consumed_segment) {
-      consumed_segment = true;
-      while (position.column < kLineLength) {
-        const unsigned char kNextChar =
-            static_cast<unsigned char>(line.at(position.column));
-        if (std::isspace(kNextChar) != 0) {
-          break;
-        }
-        position.column += 1;
-      }
-      continue;
-    }
-
-    return position;
-  }
-
-  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
-  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
-}
-
-TextPosition PreviousWordStart(const core::Buffer& buffer,
-                               TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-
-  auto retreat_line = [&]() {
-    if (position.line == 0) {
-      position.column = 0;
-      return false;
-    }
-    position.line -= 1;
-    position.column = buffer.GetLine(position.line).size();
-    return true;
-  };
-
-  if (position.column > 0) {
-    position.column -= 1;
-  } else if (!retreat_line()) {
-    return TextPosition{0, 0};
-  }
-
-  while (true) {
-    const std::string& line = buffer.GetLine(position.line);
-    const std::size_t kLineLength = line.size();
-    if (kLineLength == 0) {
-      if (!retreat_line()) {
-        return TextPosition{0, 0};
-      }
-      continue;
-    }
-
-    if (position.column >= kLineLength) {
-      position.column = kLineLength - 1;
-    }
-
-    const unsigned char kCurrentChar =
-        static_cast<unsigned char>(line.at(position.column));
-    if (std::isspace(kCurrentChar) != 0) {
-      if (position.column == 0) {
-        if (!retreat_line()) {
-          return TextPosition{0, 0};
-        }
-      } else {
-        position.column -= 1;
-      }
-      continue;
-    }
-
-    const bool kCurrentIsWord = IsWordChar(line.at(position.column));
-    while (position.column > 0) {
-      const unsigned char kPrevChar =
-          static_cast<unsigned char>(line.at(position.column - 1));
-      const bool kPrevIsWord = IsWordChar(line.at(position.column - 1));
-      if (std::isspace(kPrevChar) != 0 || kPrevIsWord != kCurrentIsWord) {
-        break;
-      }
-      position.column -= 1;
-    }
-
-    return position;
-  }
-}
-
-TextPosition PreviousBigWordStart(const core::Buffer& buffer,
-                                  TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-
-  auto retreat_line = [&]() {
-    if (position.line == 0) {
-      position.column = 0;
-      return false;
-    }
-    position.line -= 1;
-    position.column = buffer.GetLine(position.line).size();
-    return true;
-  };
-
-  if (position.column > 0) {
-    position.column -= 1;
-  } else if (!retreat_line()) {
-    return TextPosition{0, 0};
-  }
-
-  while (true) {
-    const std::string& line = buffer.GetLine(position.line);
-    const std::size_t kLineLength = line.size();
-    if (kLineLength == 0) {
-      if (!retreat_line()) {
-        return TextPosition{0, 0};
-      }
-      continue;
-    }
-
-    if (position.column >= kLineLength) {
-      position.column = kLineLength - 1;
-    }
-
-    const unsigned char kCurrentChar =
-        static_cast<unsigned char>(line.at(position.column));
-    if (std::isspace(kCurrentChar) != 0) {
-      if (position.column == 0) {
-        if (!retreat_line()) {
-          return TextPosition{0, 0};
-        }
-      } else {
-        position.column -= 1;
-      }
-      continue;
-    }
-
-    while (position.column > 0) {
-      const unsigned char kPrevChar =
-          static_cast<unsigned char>(line.at(position.column - 1));
-      if (std::isspace(kPrevChar) != 0) {
-        break;
-      }
-      position.column -= 1;
-    }
-
-    return position;
-  }
-}
-
-TextPosition WordEndInclusive(const core::Buffer& buffer,
-                              TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-
-  while (position.line < buffer.LineCount()) {
-    const std::string& line = buffer.GetLine(position.line);
-    const std::size_t kLineLength = line.size();
-
-    if (position.column >= kLineLength) {
-      if (position.line + 1 >= buffer.LineCount()) {
-        return TextPosition{position.line, kLineLength};
-      }
-      position.line += 1;
-      position.column = 0;
-      continue;
-    }
-
-    const unsigned char kCurrentChar =
-        static_cast<unsigned char>(line.at(position.column));
-    if (std::isspace(kCurrentChar) != 0) {
-      position.column += 1;
-      continue;
-    }
-
-    const bool kInitialIsWord = IsWordChar(static_cast<char>(kCurrentChar));
-    std::size_t probe = position.column;
-    while (probe < kLineLength) {
-      const unsigned char kProbeChar =
-          static_cast<unsigned char>(line.at(probe));
-      if (std::isspace(kProbeChar) != 0) {
-        break;
-      }
-      const bool kProbeIsWord = IsWordChar(static_cast<char>(kProbeChar));
-      if (kProbeIsWord != kInitialIsWord) {
-        break;
-      }
-      probe += 1;
-    }
-
-    if (probe == position.column) {
-      return position;
-    }
-
-    return TextPosition{position.line, probe - 1};
-  }
-
-  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
-  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
-}
-
-TextPosition BigWordEndInclusive(const core::Buffer& buffer,
-                                 TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-
-  while (position.line < buffer.LineCount()) {
-    const std::string& line = buffer.GetLine(position.line);
-    const std::size_t kLineLength = line.size();
-
-    if (position.column >= kLineLength) {
-      if (position.line + 1 >= buffer.LineCount()) {
-        return TextPosition{position.line, kLineLength};
-      }
-      position.line += 1;
-      position.column = 0;
-      continue;
-    }
-
-    const unsigned char kCurrentChar =
-        static_cast<unsigned char>(line.at(position.column));
-    if (std::isspace(kCurrentChar) != 0) {
-      position.column += 1;
-      continue;
-    }
-
-    std::size_t probe = position.column;
-    while (probe < kLineLength) {
-      const unsigned char kProbeChar =
-          static_cast<unsigned char>(line.at(probe));
-      if (std::isspace(kProbeChar) != 0) {
-        break;
-      }
-      probe += 1;
-    }
-
-    if (probe == position.column) {
-      return position;
-    }
-
-    return TextPosition{position.line, probe - 1};
-  }
-
-  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
-  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
-}
-
-std::size_t FirstNonBlankColumn(const std::string& line) {
-  for (std::size_t i = 0; i < line.size(); ++i) {
-    if (std::isspace(static_cast<unsigned char>(line[i])) == 0) {
-      return i;
-    }
-  }
-  return 0;
-}
-
-std::size_t LastNonBlankColumn(const std::string& line) {
-  if (line.empty()) {
-    return 0;
-  }
-
-  for (std::size_t i = line.size(); i-- > 0;) {
-    if (std::isspace(static_cast<unsigned char>(line[i])) == 0) {
-      return i;
-    }
-  }
-
-  return 0;
-}
-
-TextPosition FirstNonBlankPosition(const core::Buffer& buffer,
-                                   std::size_t line) {
-  if (buffer.LineCount() == 0) {
-    return TextPosition{};
-  }
-  line = (std::min)(line, buffer.LineCount() - 1);
-  const std::string& text = buffer.GetLine(line);
-  return TextPosition{line, FirstNonBlankColumn(text)};
-}
-
-TextPosition LastNonBlankPosition(const core::Buffer& buffer,
-                                  std::size_t line) {
-  if (buffer.LineCount() == 0) {
-    return TextPosition{};
-  }
-  line = (std::min)(line, buffer.LineCount() - 1);
-  const std::string& text = buffer.GetLine(line);
-  const std::size_t kColumn = LastNonBlankColumn(text);
-  return TextPosition{line, kColumn};
-}
-
-TextPosition NextParagraphStart(const core::Buffer& buffer,
-                                TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-
-  const std::size_t kTotalLines = buffer.LineCount();
-  std::size_t line = position.line;
-
-  bool in_blank = IsBlankLine(buffer.GetLine(line));
-  while (line + 1 < kTotalLines) {
-    ++line;
-    const bool kCurrentBlank = IsBlankLine(buffer.GetLine(line));
-    if (!kCurrentBlank && in_blank) {
-      return TextPosition{line, FirstNonBlankColumn(buffer.GetLine(line))};
-    }
-    in_blank = kCurrentBlank;
-  }
-
-  return TextPosition{kTotalLines - 1, buffer.GetLine(kTotalLines - 1).size()};
-}
-
-TextPosition PreviousParagraphStart(const core::Buffer& buffer,
-                                    TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-
-  std::size_t line = position.line;
-  bool in_blank = IsBlankLine(buffer.GetLine(line));
-
-  while (line > 0) {
-    --line;
-    const bool kCurrentBlank = IsBlankLine(buffer.GetLine(line));
-    if (!kCurrentBlank && in_blank) {
-      return TextPosition{line, FirstNonBlankColumn(buffer.GetLine(line))};
-    }
-    in_blank = kCurrentBlank;
-  }
-
-  return TextPosition{0, 0};
-}
-
-TextPosition ParagraphEndInclusive(const core::Buffer& buffer,
-                                   TextPosition position) {
-  if (buffer.LineCount() == 0) {
-    return position;
-  }
-
-  position = ClampPosition(buffer, position);
-  std::size_t line = position.line;
-  const std::size_t kTotalLines = buffer.LineCount();
-
-  while (line < kTotalLines) {
-    const bool kBlank = IsBlankLine(buffer.GetLine(line));
-    if (kBlank) {
-      if (line == 0) {
-        return TextPosition{0, 0};
-      }
-      return LastNonBlankPosition(buffer, line - 1);
-    }
-    if (line + 1 >= kTotalLines) {
-      return LastNonBlankPosition(buffer, line);
-    }
-    line += 1;
-  }
-
-  return LastNonBlankPosition(buffer, kTotalLines - 1);
-}
-
-bool IsCommandSeparator(char ch) {
-  return ch == '|' || ch == ';';
-}
-
-std::string TrimCopy(std::string_view value) {
-  const auto kFirst = value.find_first_not_of(" \t\r\n");
-  if (kFirst == std::string_view::npos) {
-    return {};
-  }
-  const auto kLast = value.find_last_not_of(" \t\r\n");
-  return std::string(value.substr(kFirst, kLast - kFirst + 1));
+  return message.str();
 }
 
 int ToSignedDelta(std::size_t count) {
@@ -610,504 +106,148 @@ int ToSignedDelta(std::size_t count) {
 
 namespace core {
 ModeController::ModeController(EditorState& state,
-                               InputHandler& command_handler)
+                               InputHandler& command_handler,
+                               PluginHost& plugin_host)
     : state_(state),
       command_handler_(command_handler),
+      plugin_host_(plugin_host),
       registry_(Registry::Instance()) {
   InitializeRegistryBindings();
+  command_handler_.SetFallback(
+      [this](EditorState& /*state*/, const ExCommand& command) {
+        return RunRegisteredCommand(command);
+      });
 }
 
 ModeController::~ModeController() {
-  for (const RegistrationHandle& handle : registry_handles_) {
-    registry_.Unregister(handle);
-  }
-}
-
-void ModeController::HandleEvent(const KeyEvent& event) {
-  switch (state_.CurrentMode()) {
-    case Mode::kInsert:
-      HandleInsertMode(event);
-      break;
-    case Mode::kCommandLine:
-      HandleCommandMode(event);
-      break;
-    case Mode::kNormal:
-    default:
-      HandleNormalMode(event);
-      break;
-  }
-}
-
-std::string_view ModeController::CommandBuffer() const noexcept {
-  return command_buffer_;
-}
-
-void ModeController::HandleNormalMode(const KeyEvent& event) {
-  if (event.code == KeyCode::kEscape) {
-    pending_normal_command_.clear();
-    ResetCount();
-    state_.ClearStatus();
-    return;
-  }
-
-  if (ExecuteRegisteredBinding(event)) {
-    return;
-  }
-
-  if (event.code == KeyCode::kArrowDown) {
-    if (pending_normal_command_ == "d") {
-      pending_normal_command_.clear();
-      const std::size_t kLines = std::max<std::size_t>(1, ConsumeCountOr(2));
-      const std::size_t kDeleted = DeleteLineRange(state_.CursorLine(), kLines);
-      if (kDeleted == 0) {
-        state_.SetStatus("Delete failed", StatusSeverity::kWarning);
-      } else {
-        state_.MoveCursorLine(0);
-        std::ostringstream message;
-        message << "Deleted " << kDeleted << " line";
-        if (kDeleted != 1) {
-          message << 's';
-        }
-        state_.SetStatus(message.str(), StatusSeverity::kInfo);
-      }
-      return;
-    }
-
-    pending_normal_command_.clear();
-    const std::size_t kCount = ConsumeCountOr(1);
-    state_.MoveCursorLine(ToSignedDelta(kCount));
-    state_.ClearStatus();
-    return;
-  }
-  if (event.code == KeyCode::kArrowUp) {
-    if (pending_normal_command_ == "d") {
-      const std::size_t kLines = std::max<std::size_t>(1, ConsumeCountOr(2));
-      const std::size_t kCurrent = state_.CursorLine();
-      const std::size_t kStart =
-          kLines > kCurrent + 1 ? 0 : kCurrent + 1 - kLines;
-      pending_normal_command_.clear();
-      const std::size_t kDeleted = DeleteLineRange(kStart, kLines);
-      if (kDeleted == 0) {
-        state_.SetStatus("Delete failed", StatusSeverity::kWarning);
-      } else {
-        state_.SetCursor(kStart, 0);
-        state_.MoveCursorLine(0);
-        std::ostringstream message;
-        message << "Deleted " << kDeleted << " line";
-        if (kDeleted != 1) {
-          message << 's';
-        }
-        state_.SetStatus(message.str(), StatusSeverity::kInfo);
-      }
-      return;
-    }
-
-    pending_normal_command_.clear();
-    const std::size_t kCount = ConsumeCountOr(1);
-    state_.MoveCursorLine(-ToSignedDelta(kCount));
-    state_.ClearStatus();
-    return;
-  }
-  if (event.code == KeyCode::kArrowLeft) {
-    pending_normal_command_.clear();
-    const std::size_t kCount = ConsumeCountOr(1);
-    state_.MoveCursorColumn(-ToSignedDelta(kCount));
-    state_.ClearStatus();
-    return;
-  }
-  if (event.code == KeyCode::kArrowRight) {
-    pending_normal_command_.clear();
-    const std::size_t kCount = ConsumeCountOr(1);
-    state_.MoveCursorColumn(ToSignedDelta(kCount));
-    state_.ClearStatus();
-    return;
-  }
-  if (event.code != KeyCode::kCharacter) {
-    pending_normal_command_.clear();
-    ResetCount();
-    state_.ClearStatus();
-    return;
-  }
-
-  const char kValue = event.value;
-
-  if (kValue == '0' && !has_prefix_count_ && !has_motion_count_) {
-    if (pending_normal_command_ == "d") {
-      const std::size_t kLine = state_.CursorLine();
-      const Buffer& buffer_view = state_.GetBuffer();
-      const std::size_t kColumn =
-          (std::min)(state_.CursorColumn(), buffer_view.GetLine(kLine).size());
-      pending_normal_command_.clear();
-      ResetCount();
-      if (kColumn == 0) {
-        state_.SetStatus("Already at line start", StatusSeverity::kWarning);
-      } else if (DeleteCharacterRange(kLine, 0, kLine, kColumn)) {
-        state_.SetCursor(kLine, 0);
-        state_.MoveCursorLine(0);
-        state_.SetStatus("Deleted to line start", StatusSeverity::kInfo);
-      } else {
-        state_.SetStatus("Delete failed", StatusSeverity::kWarning);
-      }
-      return;
-    }
-
-    if (pending_normal_command_ == "y") {
-      const std::size_t kLine = state_.CursorLine();
-      const Buffer& buffer_view = state_.GetBuffer();
-      const std::size_t kColumn =
-          (std::min)(state_.CursorColumn(), buffer_view.GetLine(kLine).size());
-      pending_normal_command_.clear();
-      ResetCount();
-      if (kColumn == 0) {
-        state_.SetStatus("Nothing to yank", StatusSeverity::kWarning);
-      } else if (CopyCharacterRange(kLine, 0, kLine, kColumn)) {
-        state_.SetStatus("Yanked to line start", StatusSeverity::kInfo);
-      } else {
-        state_.SetStatus("Yank failed", StatusSeverity::kWarning);
-      }
-      return;
-    }
-
-    if (pending_normal_command_.empty()) {
-      ResetCount();
-      const std::size_t kLine = state_.CursorLine();
-      state_.SetCursor(kLine, 0);
-      state_.MoveCursorLine(0);
-      state_.ClearStatus();
-      return;
-    }
-  }
-
-  if (std::isdigit(static_cast<unsigned char>(kValue)) != 0) {
-    const std::size_t kDigit = static_cast<std::size_t>(kValue - '0');
-    if (pending_normal_command_.empty()) {
-      has_prefix_count_ = true;
-      prefix_count_ = AppendCountDigit(prefix_count_, kDigit);
-      state_.SetStatus(FormatPendingStatus(pending_normal_command_,
-                                           prefix_count_, has_prefix_count_,
-                                           motion_count_, has_motion_count_),
-                       StatusSeverity::kInfo);
-      return;
-    }
-
-    has_motion_count_ = true;
-    motion_count_ = AppendCountDigit(motion_count_, kDigit);
-    state_.SetStatus(FormatPendingStatus(pending_normal_command_, prefix_count_,
-                                         has_prefix_count_, motion_count_,
-                                         has_motion_count_),
-                     StatusSeverity::kInfo);
-    return;
+  command_handler_.SetFallback({});
+  for (const RegistrationHandle& handle : registry_handles_) {
+    registry_.Unregister(handle);
   }
+}
 
-  switch (kValue) {
-    case 'h': {
-      pending_normal_command_.clear();
-      const std::size_t kCount = ConsumeCountOr(1);
-      state_.MoveCursorColumn(-ToSignedDelta(kCount));
-      state_.ClearStatus();
-      return;
-    }
-    case 'j': {
-      pending_normal_command_.clear();
-      const std::size_t kCount = ConsumeCountOr(1);
-      state_.MoveCursorLine(ToSignedDelta(kCount));
-      state_.ClearStatus();
-      return;
-    }
-    case 'k': {
-      pending_normal_command_.clear();
-      const std::size_t kCount = ConsumeCountOr(1);
-      state_.MoveCursorLine(-ToSignedDelta(kCount));
-      state_.ClearStatus();
-      return;
-    }
-    case 'l': {
-      pending_normal_command_.clear();
-      const std::size_t kCount = ConsumeCountOr(1);
-      state_.MoveCursorColumn(ToSignedDelta(kCount));
-      state_.ClearStatus();
-      return;
-    }
-    case 'i': {
-      pending_normal_command_.clear();
-      ResetCount();
-      state_.SetMode(Mode::kInsert);
-      state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
-      return;
-    }
-    case 'a': {
-      pending_normal_command_.clear();
-      ResetCount();
-      state_.MoveCursorColumn(1);
-      state_.SetMode(Mode::kInsert);
-      state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
-      return;
-    }
-    case 'A': {
-      pending_normal_command_.clear();
-      ResetCount();
-      const Buffer& buffer_view = state_.GetBuffer();
-      const std::size_t kLine = state_.CursorLine();
-      const std::size_t kLength = buffer_view.GetLine(kLine).size();
-      state_.SetCursor(kLine, kLength);
-      state_.MoveCursorLine(0);
-      state_.SetMode(Mode::kInsert);
-      state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
-      return;
-    }
-    case 'I': {
-      pending_normal_command_.clear();
-      ResetCount();
-      TextPosition target =
-          FirstNonBlankPosition(state_.GetBuffer(), state_.CursorLine());
-      state_.SetCursor(target.line, target.column);
-      state_.MoveCursorLine(0);
-      state_.SetMode(Mode::kInsert);
-      state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
-      return;
-    }
-    case 'o': {
-      pending_normal_command_.clear();
-      ResetCount();
-      InsertNewline();
-      state_.SetMode(Mode::kInsert);
-      state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
-      return;
-    }
-    case 'O': {
-      pending_normal_command_.clear();
-      ResetCount();
-      auto& buffer = state_.GetBuffer();
-      const std::size_t kLine = state_.CursorLine();
-      if (buffer.InsertLine(kLine, "")) {
-        state_.SetCursor(kLine, 0);
-        state_.MoveCursorLine(0);
-      }
-      state_.SetMode(Mode::kInsert);
-      state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
-      return;
-    }
-    case ':': {
-      pending_normal_command_.clear();
-      ResetCount();
-      command_buffer_.clear();
-      state_.SetMode(Mode::kCommandLine);
-      state_.SetStatus("-- COMMAND --", StatusSeverity::kInfo);
-      return;
-    }
-    case 'x': {
-      pending_normal_command_.clear();
-      const std::size_t kCount = ConsumeCountOr(1);
-      const std::size_t kLine = state_.CursorLine();
-      const std::size_t kStartColumn = state_.CursorColumn();
-      const std::size_t kEndColumn = kStartColumn + kCount;
-      if (DeleteCharacterRange(kLine, kStartColumn, kLine, kEndColumn)) {
-        state_.SetCursor(kLine, kStartColumn);
-        state_.MoveCursorLine(0);
-        state_.SetStatus("Deleted characters", StatusSeverity::kInfo);
-      } else {
-        state_.SetStatus("Delete failed", StatusSeverity::kWarning);
-      }
-      return;
-    }
-    case 'd':
-    case 'c':
-    case 'y':
-    case 'g':
-    case 'z':
-    case 'f':
-    case 'F':
-    case 't':
-    case 'T':
-    case 'n':
-    case 'N':
-    case 'p':
-    case 'P':
-    case 'J':
-    case 'G':
-    case 'H':
-    case 'M':
-    case 'L':
-    case 'w':
-    case 'W':
-    case 'b':
-    case 'B':
-    case 'e':
-    case 'E':
-    case 's':
-    case 'S':
-    case 'u':
-    case 'r':
-    case 'R':
-    case '0':
-    case '$':
-    case 'm':
-    case '`':
-    case '\'':
-    case '~':
-    case '*':
-    case '#':
-    case '%':
-    case '^':
-    case '(':
-    case ')':
-    case '{':
-    case '}':
+void ModeController::HandleEvent(const KeyEvent& event) {
+  MICROVI_PROFILE_SCOPE(kHandleEvent);
+  switch (state_.CurrentMode()) {
+    case Mode::kInsert:
+      HandleInsertMode(event);
+      break;
+    case Mode::kCommandLine:
+      HandleCommandMode(event);
+      break;
+    case Mode::kVisual:
+      HandleVisualMode(event);
       break;
+    case Mode::kNormal:
     default:
+      HandleNormalMode(event);
       break;
   }
 
-  pending_normal_command_.push_back(kValue);
-  state_.SetStatus(
-      FormatPendingStatus(pending_normal_command_, prefix_count_,
-                          has_prefix_count_, motion_count_, has_motion_count_),
-      StatusSeverity::kInfo);
+  if (state_.CurrentMode() == Mode::kInsert &&
+      state_.GetBuffer().IsReadOnly()) {
+    block_insert_.reset();
+    state_.SetMode(Mode::kNormal);
+    state_.SetStatus("Cannot make changes, the buffer is read-only",
+                     StatusSeverity::kWarning);
+  }
 
-  if (pending_normal_command_.size() == 1) {
-    const char kCommand = pending_normal_command_.front();
-    switch (kCommand) {
-      case 'd':
-      case 'c':
-      case 'y':
-        return;
-      case 'p':
-      case 'P': {
-        pending_normal_command_.clear();
-        ResetCount();
-        if (!PasteAfterCursor()) {
-          state_.SetStatus("Paste failed", StatusSeverity::kWarning);
-        }
-        return;
-      }
-      case 'u': {
-        pending_normal_command_.clear();
-        ResetCount();
-        state_.SetStatus("Nothing to undo", StatusSeverity::kWarning);
-        return;
-      }
-      case 'r': {
-        pending_normal_command_.clear();
-        ResetCount();
-        state_.SetStatus("Nothing to redo", StatusSeverity::kWarning);
-        return;
-      }
-      case 'n': {
-        pending_normal_command_.clear();
-        ResetCount();
-        ApplyRepeatFind(false, FindCommandAction::kMove);
-        return;
-      }
-      case 'N': {
-        pending_normal_command_.clear();
-        ResetCount();
-        ApplyRepeatFind(true, FindCommandAction::kMove);
-        return;
-      }
-      case 'f':
-      case 'F':
-      case 't':
-      case 'T':
-        return;
-      default:
-        break;
-    }
+  // Like vi, a whole insert session undoes as one change, as does each
+  // normal-mode or ex command.
+  if (state_.CurrentMode() != Mode::kInsert) {
+    state_.GetBuffer().CloseUndoStep();
   }
+}
 
-  const std::string kCommand = pending_normal_command_;
-  pending_normal_command_.clear();
+std::string_view ModeController::CommandBuffer() const noexcept {
+  return command_buffer_;
+}
 
-  if (kCommand == "dd") {
-    const std::size_t kCount = ConsumeCountOr(1);
-    const std::size_t kDeleted = DeleteLineRange(state_.CursorLine(), kCount);
-    if (kDeleted == 0) {
-      state_.SetStatus("Delete failed", StatusSeverity::kWarning);
-    } else {
-      state_.MoveCursorLine(0);
-      std::ostringstream message;
-      message << "Deleted " << kDeleted << " line";
-      if (kDeleted != 1) {
-        message << 's';
-      }
-      state_.SetStatus(message.str(), StatusSeverity::kInfo);
-    }
-    return;
-  }
+char ModeController::CommandPrefix() const noexcept {
+  return command_prefix_;
+}
 
-  if (kCommand == "yy") {
-    const std::size_t kCount = ConsumeCountOr(1);
-    if (CopyLineRange(state_.CursorLine(), kCount)) {
-      state_.SetStatus("Yanked line", StatusSeverity::kInfo);
-    } else {
-      state_.SetStatus("Yank failed", StatusSeverity::kWarning);
-    }
-    return;
-  }
+void ModeController::SetSearchWakeHook(std::function<void()> hook) {
+  searcher_.SetWakeHook(std::move(hook));
+}
 
-  if (kCommand == "p" || kCommand == "P") {
-    ResetCount();
-    if (!PasteAfterCursor()) {
-      state_.SetStatus("Paste failed", StatusSeverity::kWarning);
+bool ModeController::SyncSearch() {
+  SearchResult result;
+  if (!searcher_.TakeResult(result)) {
+    return false;
+  }
+  // A search started in a buffer that is no longer current lands nowhere.
+  if (running_buffer_ == state_.BufferId()) {
+    // A paged file's search can run ahead of its scan.
+    if (result.found) {
+      state_.GetBuffer().FinishIndexing(result.position.line + 1);
     }
-    return;
+    ApplySearchResult(result);
   }
+  return true;
+}
 
-  if (kCommand == "gg") {
-    ResetCount();
-    state_.SetCursor(0, 0);
-    state_.MoveCursorLine(0);
-    state_.ClearStatus();
-    return;
-  }
+bool ModeController::IsSearching() const noexcept {
+  return searcher_.IsRunning();
+}
 
-  if (kCommand == "G") {
-    const auto& buffer = state_.GetBuffer();
-    const std::size_t kTarget =
-        has_prefix_count_ ? (std::min)(prefix_count_, buffer.LineCount())
-                          : buffer.LineCount();
-    ResetCount();
-    if (kTarget == 0) {
-      state_.SetCursor(0, 0);
-    } else {
-      state_.SetCursor(kTarget - 1, 0);
-    }
-    state_.MoveCursorLine(0);
-    state_.ClearStatus();
-    return;
-  }
+void ModeController::SetChordTimeout(std::chrono::milliseconds timeout) {
+  chord_.SetTimeout(timeout);
+}
 
-  if (kCommand.size() == 2 &&
-      (kCommand.front() == 'f' || kCommand.front() == 'F' ||
-       kCommand.front() == 't' || kCommand.front() == 'T')) {
-    const char kCommandChar = kCommand.front();
-    const char kTarget = kCommand.back();
-    if (!ApplyFindCommand(kCommandChar, FindCommandAction::kMove, kTarget)) {
-      state_.SetStatus("Find failed", StatusSeverity::kWarning);
-    }
-    return;
+bool ModeController::SyncChord() {
+  ChordMatch match;
+  const Mode kMode = state_.CurrentMode();
+  if ((kMode != Mode::kNormal && kMode != Mode::kVisual) ||
+      keymap_ == nullptr ||
+      !chord_.Expire(*keymap_, ChordResolver::Clock::now(), match)) {
+    return false;
   }
+  InvokeBinding(match);
+  if (state_.CurrentMode() != Mode::kInsert) {
+    state_.GetBuffer().CloseUndoStep();
+  }
+  return true;
+}
 
-  if (kCommand.size() == 2 && kCommand.front() == 'd') {
-    if (!HandleDeleteOperator(kCommand.back())) {
-      state_.SetStatus("Delete failed", StatusSeverity::kWarning);
-    }
+std::optional<ChordResolver::Clock::time_point> ModeController::ChordDeadline()
+    const noexcept {
+  return chord_.Deadline();
+}
+
+void ModeController::HandleNormalMode(const KeyEvent& event) {
+  if (event.code == KeyCode::kPaste) {
+    chord_.Reset();
+    InsertText(event.text);
     return;
   }
 
-  if (kCommand.size() == 2 && kCommand.front() == 'y') {
-    if (!HandleYankOperator(kCommand.back())) {
-      state_.SetStatus("Yank failed", StatusSeverity::kWarning);
+  if (event.code == KeyCode::kEscape) {
+    chord_.Reset();
+    selected_register_ = 0;
+    searcher_.Cancel();
+    if (!command_handler_.Cancel(state_)) {
+      state_.ClearStatus();
     }
     return;
   }
 
-  state_.SetStatus("Unknown command", StatusSeverity::kWarning);
-  ResetCount();
+  ExecuteRegisteredBinding(event);
 }
 
 void ModeController::HandleInsertMode(const KeyEvent& event) {
+  if (event.code == KeyCode::kCharacter &&
+      static_cast<unsigned char>(event.value) >= 0x80) {
+    InsertUtf8Byte(event.value);
+    return;
+  }
+  pending_utf8_.clear();
+
   switch (event.code) {
     case KeyCode::kEscape:
+      if (block_insert_) {
+        FinishBlockInsert();
+      }
       state_.SetMode(Mode::kNormal);
       state_.ClearStatus();
       return;
@@ -1134,12 +274,36 @@ void ModeController::HandleInsertMode(const KeyEvent& event) {
         InsertCharacter(event.value);
       }
       return;
+    case KeyCode::kPaste:
+      InsertText(event.text);
+      return;
     default:
       return;
   }
 }
 
+void ModeController::HandleVisualMode(const KeyEvent& event) {
+  if (event.code == KeyCode::kEscape) {
+    chord_.Reset();
+    selected_register_ = 0;
+    state_.SetMode(Mode::kNormal);
+    state_.ClearStatus();
+    return;
+  }
+  if (event.code == KeyCode::kPaste) {
+    chord_.Reset();
+    return;
+  }
+
+  ExecuteRegisteredBinding(event);
+}
+
 void ModeController::HandleCommandMode(const KeyEvent& event) {
+  if (command_prefix_ != kCommandPrefix) {
+    HandleSearchPrompt(event);
+    return;
+  }
+
   switch (event.code) {
     case KeyCode::kEscape:
       command_buffer_.clear();
@@ -1149,8 +313,8 @@ void ModeController::HandleCommandMode(const KeyEvent& event) {
     case KeyCode::kEnter: {
       if (command_buffer_.empty()) {
         state_.SetStatus("Command line empty", StatusSeverity::kWarning);
-      } else if (!ExecuteCommandLine(command_buffer_)) {
-        state_.SetStatus("Unknown command", StatusSeverity::kWarning);
+      } else {
+        command_handler_.Handle(state_, command_buffer_);
       }
       command_buffer_.clear();
       state_.SetMode(Mode::kNormal);
@@ -1166,11 +330,233 @@ void ModeController::HandleCommandMode(const KeyEvent& event) {
         command_buffer_.push_back(event.value);
       }
       return;
+    case KeyCode::kPaste:
+      for (const char kValue : event.text.substr(0, event.text.find('\n'))) {
+        if (std::isprint(static_cast<unsigned char>(kValue)) != 0) {
+          command_buffer_.push_back(kValue);
+        }
+      }
+      return;
+    default:
+      return;
+  }
+}
+
+void ModeController::HandleSearchPrompt(const KeyEvent& event) {
+  switch (event.code) {
+    case KeyCode::kEscape:
+      CancelSearchPrompt();
+      return;
+    case KeyCode::kEnter:
+      AcceptSearch();
+      return;
+    case KeyCode::kBackspace:
+      if (command_buffer_.empty()) {
+        return;
+      }
+      command_buffer_.pop_back();
+      break;
+    case KeyCode::kCharacter:
+      if (std::isprint(static_cast<unsigned char>(event.value)) == 0) {
+        return;
+      }
+      command_buffer_.push_back(event.value);
+      break;
+    case KeyCode::kPaste:
+      for (const char kValue : event.text.substr(0, event.text.find('\n'))) {
+        if (std::isprint(static_cast<unsigned char>(kValue)) != 0) {
+          command_buffer_.push_back(kValue);
+        }
+      }
+      break;
     default:
       return;
   }
+  UpdateIncrementalSearch();
+}
+
+void ModeController::BeginSearchPrompt(bool backward) {
+  command_prefix_ = backward ? '?' : '/';
+  command_buffer_.clear();
+  prompt_pattern_.reset();
+  prompt_error_.clear();
+  search_origin_ = {state_.CursorLine(), state_.CursorColumn()};
+  state_.SetMode(Mode::kCommandLine);
+  state_.ClearStatus();
+}
+
+void ModeController::UpdateIncrementalSearch() {
+  searcher_.Cancel();
+  prompt_pattern_.reset();
+  prompt_error_.clear();
+  state_.SetCursor(search_origin_.line, search_origin_.column);
+  if (command_buffer_.empty()) {
+    state_.SetSearchHighlight(last_search_);
+    return;
+  }
+
+  auto pattern = std::make_shared<Pattern>();
+  if (!pattern->Compile(command_buffer_, prompt_error_)) {
+    state_.SetSearchHighlight(nullptr);
+    return;
+  }
+  prompt_pattern_ = pattern;
+  state_.SetSearchHighlight(pattern);
+  StartSearch(std::move(pattern), search_origin_, command_prefix_ == '?', 1);
+}
+
+void ModeController::AcceptSearch() {
+  const bool kBackward = command_prefix_ == '?';
+  std::shared_ptr<const Pattern> pattern =
+      command_buffer_.empty() ? last_search_ : prompt_pattern_;
+  const std::string kError = prompt_error_;
+  const bool kEmpty = command_buffer_.empty();
+
+  searcher_.Cancel();
+  command_buffer_.clear();
+  command_prefix_ = kCommandPrefix;
+  prompt_pattern_.reset();
+  state_.SetMode(Mode::kNormal);
+  state_.SetCursor(search_origin_.line, search_origin_.column);
+
+  if (pattern == nullptr) {
+    state_.SetSearchHighlight(last_search_);
+    state_.SetStatus(kEmpty ? "No previous search pattern"
+                            : "Invalid pattern: " + kError,
+                     StatusSeverity::kError);
+    return;
+  }
+
+  last_search_ = pattern;
+  last_search_backward_ = kBackward;
+  state_.SetSearchHighlight(pattern);
+  StartSearch(std::move(pattern), search_origin_, kBackward, 1);
+}
+
+void ModeController::CancelSearchPrompt() {
+  searcher_.Cancel();
+  command_buffer_.clear();
+  command_prefix_ = kCommandPrefix;
+  prompt_pattern_.reset();
+  state_.SetSearchHighlight(last_search_);
+  state_.SetMode(Mode::kNormal);
+  state_.SetCursor(search_origin_.line, search_origin_.column);
+  state_.ClearStatus();
+}
+
+bool ModeController::InSearchPrompt() const noexcept {
+  return state_.CurrentMode() == Mode::kCommandLine &&
+         command_prefix_ != kCommandPrefix;
+}
+
+void ModeController::StartSearch(std::shared_ptr<const Pattern> pattern,
+                                 TextPosition from, bool backward,
+                                 std::size_t count) {
+  running_search_ = pattern;
+  running_backward_ = backward;
+  running_buffer_ = state_.BufferId();
+  auto& buffer = state_.GetBuffer();
+  const bool kDone =
+      buffer.Paged() != nullptr
+          ? searcher_.Start(buffer.Paged(), std::move(pattern), from, backward,
+                            count)
+          : searcher_.Start(buffer.Snapshot(from.line), std::move(pattern),
+                            from, backward, count);
+  if (kDone) {
+    SyncSearch();
+  } else if (!InSearchPrompt()) {
+    state_.SetStatus("Searching...", StatusSeverity::kInfo);
+  }
+}
+
+void ModeController::RepeatSearch(bool reverse_direction, std::size_t count) {
+  if (last_search_ == nullptr) {
+    state_.SetStatus("No previous search pattern", StatusSeverity::kError);
+    return;
+  }
+  state_.SetSearchHighlight(last_search_);
+  StartSearch(last_search_, {state_.CursorLine(), state_.CursorColumn()},
+              last_search_backward_ != reverse_direction, count);
+}
+
+void ModeController::ApplySearchResult(const SearchResult& result) {
+  if (InSearchPrompt()) {
+    const TextPosition kTarget =
+        result.found ? result.position : search_origin_;
+    state_.SetCursor(kTarget.line, kTarget.column);
+    return;
+  }
+
+  const std::string kSource =
+      running_search_ != nullptr ? running_search_->Source() : std::string{};
+  if (!result.found) {
+    state_.SetStatus("Pattern not found: " + kSource, StatusSeverity::kError);
+    return;
+  }
+
+  state_.SetCursor(result.position.line, result.position.column);
+  if (result.wrapped) {
+    state_.SetStatus(running_backward_ ? "search hit TOP, continuing at BOTTOM"
+                                       : "search hit BOTTOM, continuing at TOP",
+                     StatusSeverity::kWarning);
+  } else {
+    state_.SetStatus(std::string(1, running_backward_ ? '?' : '/') + kSource,
+                     StatusSeverity::kInfo);
+  }
 }
 
+// Every operator over every motion, as "d3w" or "y}" are typed: each pair is
+// an ApplyOperator() of its own, instantiated here, in which the operator's
+// choices and the motion's traits are constants. A key then costs one call
+// through the pair's pointer, whatever the number of pairs.
+struct ModeController::OperatorTable {
+  using Apply = void (ModeController::*)(const CommandInvocation&);
+
+  struct Entry {
+    std::string_view operator_name;
+    std::string_view operator_label;
+    std::string_view operator_keys;
+    std::string_view motion_name;
+    std::string_view motion_label;
+    std::string_view motion_keys;
+    // dd and yy: the operator's key typed again stands for the line.
+    bool doubled = false;
+    // Moves extend the selection in visual mode too.
+    bool visual = false;
+    Apply apply = nullptr;
+  };
+
+  template <typename... OperatorTypes, typename... MotionTypes>
+  static constexpr auto Build(TypeList<OperatorTypes...> /*operators*/,
+                              TypeList<MotionTypes...> motions) {
+    std::array<Entry, sizeof...(OperatorTypes) * sizeof...(MotionTypes)>
+        table{};
+    std::size_t next = 0;
+    (Fill<OperatorTypes>(table, next, motions), ...);
+    return table;
+  }
+
+  template <typename Operator, typename... MotionTypes, std::size_t kSize>
+  static constexpr void Fill(std::array<Entry, kSize>& table,
+                             std::size_t& next,
+                             TypeList<MotionTypes...> /*motions*/) {
+    ((table[next++] = Pair<Operator, MotionTypes>()), ...);
+  }
+
+  template <typename Operator, typename Motion>
+  static constexpr Entry Pair() {
+    return {Operator::kName,
+            Operator::kLabel,
+            Operator::kKeys,
+            Motion::kName,
+            Motion::kLabel,
+            Motion::kKeys,
+            !Operator::kKeys.empty() && std::is_same_v<Motion, LineMotion>,
+            Operator::kAction == OperatorAction::kMove,
+            &ModeController::ApplyOperator<Operator, Motion>};
+  }
+};
+
 void ModeController::InitializeRegistryBindings() {
   // Register the built-in normal-mode commands so they flow through the
   // registry just like external contributions.
@@ -1192,15 +578,16 @@ void ModeController::InitializeRegistryBindings() {
     return result;
   };
 
-  auto register_normal = [&](const std::string& command_id,
-                             const std::string& label,
-                             CommandCallable::NativeCallback callback,
-                             std::initializer_list<std::string> gestures) {
+  auto register_command = [&](const std::string& command_id,
+                              const std::string& label,
+                              CommandCallable::NativeCallback callback,
+                              const std::vector<std::string>& gestures,
+                              const std::vector<Mode>& modes) {
     CommandRegistration command_registration;
     command_registration.descriptor.id = command_id;
     command_registration.descriptor.label = label;
     command_registration.descriptor.short_description = label;
-    command_registration.descriptor.modes = {Mode::kNormal};
+    command_registration.descriptor.modes = modes;
     command_registration.descriptor.capabilities = 0;
     command_registration.descriptor.undo_scope = UndoScope::kNone;
     command_registration.callable.native_callback = std::move(callback);
@@ -1217,64 +604,150 @@ void ModeController::InitializeRegistryBindings() {
       return;
     }
 
-    for (const std::string& gesture : gestures) {
-      KeybindingRegistration binding_registration;
-      binding_registration.descriptor.id =
-          command_id + ".binding." + sanitize_gesture(gesture);
-      binding_registration.descriptor.command_id = command_id;
-      binding_registration.descriptor.mode = KeybindingMode::kNormal;
-      binding_registration.descriptor.gesture = gesture;
-      binding_registration.lifetime = RegistrationLifetime::kSession;
-
-      RegistrationResult binding_result =
-          registry_.RegisterKeybinding(binding_registration, origin);
-      if (binding_result.status != RegistrationStatus::kRejected &&
-          binding_result.handle.IsValid()) {
-        registry_handles_.push_back(binding_result.handle);
+    for (const Mode kMode : modes) {
+      for (const std::string& gesture : gestures) {
+        KeybindingRegistration binding_registration;
+        binding_registration.descriptor.id =
+            command_id +
+            (kMode == Mode::kVisual ? ".visual_binding." : ".binding.") +
+            sanitize_gesture(gesture);
+        binding_registration.descriptor.command_id = command_id;
+        binding_registration.descriptor.mode =
+            static_cast<KeybindingMode>(kMode);
+        binding_registration.descriptor.gesture = gesture;
+        binding_registration.lifetime = RegistrationLifetime::kSession;
+
+        RegistrationResult binding_result =
+            registry_.RegisterKeybinding(binding_registration, origin);
+        if (binding_result.status != RegistrationStatus::kRejected &&
+            binding_result.handle.IsValid()) {
+          registry_handles_.push_back(binding_result.handle);
+        }
       }
     }
   };
 
-  register_normal("core.normal.move_down", "Move Down",
+  auto register_normal = [&](const std::string& command_id,
+                             const std::string& label,
+                             CommandCallable::NativeCallback callback,
+                             const std::vector<std::string>& gestures) {
+    register_command(command_id, label, std::move(callback), gestures,
+                     {Mode::kNormal});
+  };
+
+  auto register_visual = [&](const std::string& command_id,
+                             const std::string& label,
+                             CommandCallable::NativeCallback callback,
+                             const std::vector<std::string>& gestures) {
+    register_command(command_id, label, std::move(callback), gestures,
+                     {Mode::kVisual});
+  };
+
+  static constexpr auto kOperatorTable =
+      OperatorTable::Build(Operators{}, Motions{});
+  for (const OperatorTable::Entry& entry : kOperatorTable) {
+    std::vector<std::string> gestures;
+    for (std::string_view keys = entry.motion_keys; !keys.empty();) {
+      const std::size_t kEnd = (std::min)(keys.find(' '), keys.size());
+      gestures.push_back(std::string(entry.operator_keys) +
+                         std::string(keys.substr(0, kEnd)));
+      keys.remove_prefix((std::min)(kEnd + 1, keys.size()));
+    }
+    if (entry.doubled) {
+      gestures.push_back(std::string(entry.operator_keys) +
+                         std::string(entry.operator_keys));
+    }
+    std::vector<Mode> modes{Mode::kNormal};
+    if (entry.visual) {
+      modes.push_back(Mode::kVisual);
+    }
+    register_command(std::string("core.normal.") +
+                         std::string(entry.operator_name) + '_' +
+                         std::string(entry.motion_name),
+                     std::string(entry.operator_label) + ' ' +
+                         std::string(entry.motion_label),
+                     [this, apply = entry.apply](
+                         const CommandInvocation& invocation) {
+                       (this->*apply)(invocation);
+                     },
+                     gestures, modes);
+  }
+
+  register_command("core.normal.visual", "Visual",
+                   [this](const CommandInvocation&) {
+                     ToggleVisual(SelectionKind::kCharacter);
+                   },
+                   {"v"}, {Mode::kNormal, Mode::kVisual});
+
+  register_command("core.normal.visual_line", "Visual Line",
+                   [this](const CommandInvocation&) {
+                     ToggleVisual(SelectionKind::kLine);
+                   },
+                   {"V"}, {Mode::kNormal, Mode::kVisual});
+
+  register_command("core.normal.visual_block", "Visual Block",
+                   [this](const CommandInvocation&) {
+                     ToggleVisual(SelectionKind::kBlock);
+                   },
+                   {"<C-v>"}, {Mode::kNormal, Mode::kVisual});
+
+  register_visual("core.visual.delete", "Delete Selection",
+                  [this](const CommandInvocation&) {
+                    DeleteSelection(false);
+                  },
+                  {"d", "x"});
+
+  register_visual("core.visual.change", "Change Selection",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    std::size_t count = ConsumeCountOr(1);
-                    state_.MoveCursorLine(ToSignedDelta(count));
-                    state_.ClearStatus();
+                    DeleteSelection(true);
                   },
-                  {"j", "<Down>"});
+                  {"c", "s"});
 
-  register_normal("core.normal.move_up", "Move Up",
+  register_visual("core.visual.yank", "Yank Selection",
+                  [this](const CommandInvocation&) { YankSelection(); },
+                  {"y"});
+
+  register_visual("core.visual.replace", "Replace Selection",
+                  [this](const CommandInvocation& invocation) {
+                    ReplaceSelection(invocation.operand);
+                  },
+                  {"r<Char>"});
+
+  register_visual("core.visual.insert", "Insert Before Selection",
+                  [this](const CommandInvocation&) {
+                    InsertAtSelection(false);
+                  },
+                  {"I"});
+
+  register_visual("core.visual.append", "Append After Selection",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    std::size_t count = ConsumeCountOr(1);
-                    state_.MoveCursorLine(-ToSignedDelta(count));
-                    state_.ClearStatus();
+                    InsertAtSelection(true);
                   },
-                  {"k", "<Up>"});
+                  {"A"});
 
-  register_normal("core.normal.move_left", "Move Left",
+  register_visual("core.visual.swap_ends", "Other End of Selection",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    std::size_t count = ConsumeCountOr(1);
-                    state_.MoveCursorColumn(-ToSignedDelta(count));
-                    state_.ClearStatus();
+                    state_.SwapSelectionEnds();
                   },
-                  {"h", "<Left>"});
+                  {"o"});
 
-  register_normal("core.normal.move_right", "Move Right",
+  // Marks are not kept, so the selected lines are given by number.
+  register_visual("core.visual.command_line", "Command Line on Selection",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    std::size_t count = ConsumeCountOr(1);
-                    state_.MoveCursorColumn(ToSignedDelta(count));
-                    state_.ClearStatus();
+                    const std::optional<Selection> kSelection = EndVisual();
+                    command_buffer_.clear();
+                    if (kSelection) {
+                      command_buffer_ =
+                          std::to_string(kSelection->start.line + 1) + ',' +
+                          std::to_string(kSelection->end.line + 1);
+                    }
+                    state_.SetMode(Mode::kCommandLine);
+                    state_.SetStatus("-- COMMAND --", StatusSeverity::kInfo);
                   },
-                  {"l", "<Right>"});
+                  {":"});
 
-  register_normal("core.normal.enter_insert", "Enter Insert Mode",
+  register_normal("core.normal.enter_insert", "Insert",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    ResetCount();
                     state_.SetMode(Mode::kInsert);
                     state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
                   },
@@ -1282,8 +755,6 @@ void ModeController::InitializeRegistryBindings() {
 
   register_normal("core.normal.append", "Append",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    ResetCount();
                     state_.MoveCursorColumn(1);
                     state_.SetMode(Mode::kInsert);
                     state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
@@ -1292,12 +763,9 @@ void ModeController::InitializeRegistryBindings() {
 
   register_normal("core.normal.append_line_end", "Append at Line End",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    ResetCount();
-                    const Buffer& buffer_view = state_.GetBuffer();
-                    std::size_t line = state_.CursorLine();
-                    std::size_t length = buffer_view.GetLine(line).size();
-                    state_.SetCursor(line, length);
+                    const std::size_t kLine = state_.CursorLine();
+                    state_.SetCursor(kLine,
+                                     state_.GetBuffer().GetLine(kLine).size());
                     state_.MoveCursorLine(0);
                     state_.SetMode(Mode::kInsert);
                     state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
@@ -1306,11 +774,9 @@ void ModeController::InitializeRegistryBindings() {
 
   register_normal("core.normal.insert_line_start", "Insert at Line Start",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    ResetCount();
-                    TextPosition target = FirstNonBlankPosition(
+                    const TextPosition kTarget = FirstNonBlankPosition(
                         state_.GetBuffer(), state_.CursorLine());
-                    state_.SetCursor(target.line, target.column);
+                    state_.SetCursor(kTarget.line, kTarget.column);
                     state_.MoveCursorLine(0);
                     state_.SetMode(Mode::kInsert);
                     state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
@@ -1319,8 +785,6 @@ void ModeController::InitializeRegistryBindings() {
 
   register_normal("core.normal.insert_below", "Insert Below",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    ResetCount();
                     InsertNewline();
                     state_.SetMode(Mode::kInsert);
                     state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
@@ -1329,104 +793,200 @@ void ModeController::InitializeRegistryBindings() {
 
   register_normal("core.normal.insert_above", "Insert Above",
                   [this](const CommandInvocation&) {
-                    pending_normal_command_.clear();
-                    ResetCount();
                     auto& buffer = state_.GetBuffer();
-                    std::size_t line = state_.CursorLine();
-                    if (buffer.InsertLine(line, "")) {
-                      state_.SetCursor(line, 0);
+                    const std::size_t kLine = state_.CursorLine();
+                    if (buffer.InsertLine(kLine, "")) {
+                      state_.SetCursor(kLine, 0);
                       state_.MoveCursorLine(0);
                     }
                     state_.SetMode(Mode::kInsert);
                     state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
                   },
                   {"O"});
-}
 
-bool ModeController::ExecuteRegisteredBinding(const KeyEvent& event) {
-  if (!pending_normal_command_.empty()) {
-    return false;
-  }
+  register_normal("core.normal.command_line", "Command Line",
+                  [this](const CommandInvocation&) {
+                    command_buffer_.clear();
+                    state_.SetMode(Mode::kCommandLine);
+                    state_.SetStatus("-- COMMAND --", StatusSeverity::kInfo);
+                  },
+                  {":"});
 
-  std::string gesture = MakeGesture(event);
-  if (gesture.empty()) {
-    return false;
-  }
+  register_normal(
+      "core.normal.search_forward", "Search Forward",
+      [this](const CommandInvocation&) { BeginSearchPrompt(false); }, {"/"});
 
-  KeybindingMode mode = ToKeybindingMode(state_.CurrentMode());
-  auto binding = registry_.ResolveKeybinding(mode, gesture);
-  if (!binding.has_value()) {
-    binding = registry_.ResolveKeybinding(KeybindingMode::kAny, gesture);
-    if (!binding.has_value()) {
-      return false;
-    }
-  }
+  register_normal(
+      "core.normal.search_backward", "Search Backward",
+      [this](const CommandInvocation&) { BeginSearchPrompt(true); }, {"?"});
+
+  register_normal("core.normal.search_next", "Next Match",
+                  [this](const CommandInvocation& invocation) {
+                    RepeatSearch(false, CountOr(invocation, 1));
+                  },
+                  {"n"});
+
+  register_normal("core.normal.search_previous", "Previous Match",
+                  [this](const CommandInvocation& invocation) {
+                    RepeatSearch(true, CountOr(invocation, 1));
+                  },
+                  {"N"});
 
-  const KeybindingRecord& record = *binding;
-  return InvokeCommand(record.descriptor.command_id,
-                       record.descriptor.arguments);
+  // x is dl.
+  register_normal("core.normal.delete_char", "Delete Character",
+                  [this](const CommandInvocation& invocation) {
+                    ApplyOperator<DeleteOperator, RightMotion>(invocation);
+                  },
+                  {"x"});
+
+  register_normal("core.normal.paste", "Paste",
+                  [this](const CommandInvocation& invocation) {
+                    if (!PasteAfterCursor(CountOr(invocation, 1))) {
+                      state_.SetStatus("Paste failed",
+                                       StatusSeverity::kWarning);
+                    }
+                  },
+                  {"p", "P"});
+
+  // The count typed before `"x` carries over to the command after it.
+  register_normal("core.normal.select_register", "Select Register",
+                  [this](const CommandInvocation& invocation) {
+                    if (!Registers::IsValidName(invocation.operand)) {
+                      state_.SetStatus("Invalid register",
+                                       StatusSeverity::kWarning);
+                      return;
+                    }
+                    selected_register_ = invocation.operand;
+                    chord_.CarryCount(invocation.count);
+                    state_.SetStatus(std::string{'"', invocation.operand},
+                                     StatusSeverity::kInfo);
+                  },
+                  {"\"<Char>"});
+
+  register_normal("core.normal.undo", "Undo",
+                  [this](const CommandInvocation& invocation) {
+                    ApplyUndo(false, CountOr(invocation, 1));
+                  },
+                  {"u"});
+
+  register_normal("core.normal.redo", "Redo",
+                  [this](const CommandInvocation& invocation) {
+                    ApplyUndo(true, CountOr(invocation, 1));
+                  },
+                  {"<C-r>", "r"});
 }
 
-KeybindingMode ModeController::ToKeybindingMode(Mode mode) noexcept {
-  switch (mode) {
-    case Mode::kNormal:
-      return KeybindingMode::kNormal;
-    case Mode::kInsert:
-      return KeybindingMode::kInsert;
-    case Mode::kCommandLine:
-      return KeybindingMode::kCommand;
-    case Mode::kVisual:
-      return KeybindingMode::kVisual;
+void ModeController::ExecuteRegisteredBinding(const KeyEvent& event) {
+  ChordMatch match;
+  ChordOutcome outcome = ChordOutcome::kNoMatch;
+  {
+    MICROVI_PROFILE_SCOPE(kKeyLookup);
+    if (keymap_ == nullptr || keymap_->Version() != registry_.Version()) {
+      keymap_ = registry_.CompileKeymap();
+      // A pending chord points into the trie it was typed against.
+      chord_.Reset();
+    }
+    outcome = chord_.Feed(*keymap_, state_.CurrentMode(), event,
+                          ChordResolver::Clock::now(), match);
+  }
+  switch (outcome) {
+    case ChordOutcome::kPending:
+      state_.SetStatus(std::string(chord_.Typed()), StatusSeverity::kInfo);
+      return;
+    case ChordOutcome::kMatched:
+      InvokeBinding(match);
+      return;
+    case ChordOutcome::kMatchedBefore:
+      // The chord runs as its own change, then the key is handled afresh in
+      // whatever mode the chord left.
+      InvokeBinding(match);
+      if (state_.CurrentMode() != Mode::kInsert) {
+        state_.GetBuffer().CloseUndoStep();
+      }
+      HandleEvent(event);
+      return;
+    case ChordOutcome::kNoMatch:
+      break;
+  }
+
+  if (event.code == KeyCode::kCharacter) {
+    state_.SetStatus("Unknown command", StatusSeverity::kWarning);
+  } else {
+    state_.ClearStatus();
   }
-  return KeybindingMode::kAny;
 }
 
-std::string ModeController::MakeGesture(const KeyEvent& event) const {
-  switch (event.code) {
-    case KeyCode::kCharacter:
-      if (event.value != '\0') {
-        return std::string(1, event.value);
-      }
-      return {};
-    case KeyCode::kEnter:
-      return "<Enter>";
-    case KeyCode::kEscape:
-      return "<Esc>";
-    case KeyCode::kBackspace:
-      return "<Backspace>";
-    case KeyCode::kArrowUp:
-      return "<Up>";
-    case KeyCode::kArrowDown:
-      return "<Down>";
-    case KeyCode::kArrowLeft:
-      return "<Left>";
-    case KeyCode::kArrowRight:
-      return "<Right>";
-    default:
-      return {};
+bool ModeController::InvokeBinding(const ChordMatch& match) {
+  const Keymap::Binding& binding = *match.binding;
+  if (!binding.command_found) {
+    state_.SetStatus("Command not found", StatusSeverity::kWarning);
+    return false;
   }
+
+  invocation_.command_id.assign(binding.invocation.command_id);
+  invocation_.arguments = binding.invocation.arguments;
+  invocation_.count = match.count;
+  invocation_.operand = match.operand;
+  return RunCommand(binding.callback, binding.rpc_endpoint,
+                    binding.capabilities);
 }
 
-bool ModeController::InvokeCommand(
-    const std::string& command_id,
-    const std::unordered_map<std::string, std::string>& args) {
-  auto command = registry_.FindCommand(command_id, true);
-  if (!command.has_value()) {
-    state_.SetStatus("Command not found", StatusSeverity::kWarning);
+bool ModeController::RunRegisteredCommand(const ExCommand& command) {
+  const std::optional<CommandRecord> kRecord =
+      registry_.FindCommand(command.name);
+  if (!kRecord) {
     return false;
   }
 
-  const CommandCallable& callable = command->callable;
-  if (callable.native_callback) {
-    CommandInvocation invocation;
-    invocation.command_id = command_id;
-    invocation.arguments = args;
-    callable.native_callback(invocation);
+  // Words of the argument fill the declared parameters in order.
+  invocation_.command_id = kRecord->descriptor.id;
+  invocation_.arguments.clear();
+  invocation_.count = 0;
+  invocation_.operand = '\0';
+  std::istringstream words(command.arguments);
+  std::string word;
+  for (const CommandParameter& parameter :
+       kRecord->descriptor.parameters) {
+    if (words >> word) {
+      invocation_.arguments[parameter.name] = word;
+    } else if (parameter.required) {
+      state_.SetStatus("Argument required: " + parameter.name,
+                       StatusSeverity::kError);
+      return true;
+    } else if (!parameter.default_value.empty()) {
+      invocation_.arguments[parameter.name] = parameter.default_value;
+    }
+  }
+  if (words >> word) {
+    state_.SetStatus("Trailing characters: " + word, StatusSeverity::kError);
     return true;
   }
+  RunCommand(kRecord->callable.native_callback, kRecord->callable.rpc_endpoint,
+             kRecord->descriptor.capabilities);
+  return true;
+}
 
-  state_.SetStatus("Command not executable", StatusSeverity::kWarning);
-  return false;
+bool ModeController::RunCommand(const CommandCallable::NativeCallback& callback,
+                                std::string_view rpc_endpoint,
+                                CommandCapabilityMask capabilities) {
+  MICROVI_PROFILE_SCOPE(kCommand);
+  if (!callback) {
+    if (rpc_endpoint.empty()) {
+      state_.SetStatus("Command not executable", StatusSeverity::kWarning);
+      return false;
+    }
+    return plugin_host_.Invoke(rpc_endpoint, invocation_, capabilities,
+                               state_);
+  }
+  if (RunsOffThread(capabilities)) {
+    WorkerPool::Shared().Submit(
+        [callback, invocation = invocation_](const std::stop_token&) {
+          callback(invocation);
+        });
+    return true;
+  }
+  callback(invocation_);
+  return true;
 }
 
 void ModeController::InsertCharacter(char value) {
@@ -1439,20 +999,43 @@ void ModeController::InsertCharacter(char value) {
   }
 }
 
-void ModeController::InsertNewline() {
-  auto& buffer = state_.GetBuffer();
-  const std::size_t kLine = state_.CursorLine();
-  const std::size_t kColumn = state_.CursorColumn();
+void ModeController::InsertUtf8Byte(char value) {
+  // The terminal sends a character as its bytes, one key each; it goes in
+  // once whole, and a sequence that breaks off is dropped.
+  if (!core::IsUtf8Continuation(value)) {
+    pending_utf8_.assign(1, value);
+  } else if (!pending_utf8_.empty()) {
+    pending_utf8_.push_back(value);
+  }
+  if (pending_utf8_.empty()) {
+    return;
+  }
+  const std::size_t kLength = core::Utf8SequenceLength(pending_utf8_[0]);
+  if (pending_utf8_.size() < kLength) {
+    return;
+  }
+  std::size_t decoded = 0;
+  core::DecodeUtf8(pending_utf8_, 0, decoded);
+  if (kLength > 1 && decoded == kLength) {
+    InsertText(pending_utf8_);
+  }
+  pending_utf8_.clear();
+}
 
-  auto& current = buffer.GetLine(kLine);
-  std::string tail = current.substr(kColumn);
-  current.erase(kColumn);
-  if (!buffer.InsertLine(kLine + 1, tail)) {
+void ModeController::InsertText(std::string_view text) {
+  auto& buffer = state_.GetBuffer();
+  TextPosition end;
+  if (!buffer.InsertText(state_.CursorLine(), state_.CursorColumn(), text,
+                         &end)) {
     state_.SetStatus("Insert failed", StatusSeverity::kError);
     return;
   }
 
-  state_.SetCursor(kLine + 1, 0);
+  state_.SetCursor(end.line, end.column);
+}
+
+void ModeController::InsertNewline() {
+  InsertText("\n");
 }
 
 void ModeController::HandleBackspace() {
@@ -1461,8 +1044,10 @@ void ModeController::HandleBackspace() {
   const std::size_t kColumn = state_.CursorColumn();
 
   if (kColumn > 0) {
-    if (buffer.DeleteChar(kLine, kColumn)) {
-      state_.SetCursor(kLine, kColumn - 1);
+    const std::size_t kStart =
+        core::GraphemeStart(buffer.GetLine(kLine), kColumn - 1);
+    if (buffer.DeleteText({kLine, kStart}, kColumn - kStart)) {
+      state_.SetCursor(kLine, kStart);
     }
     return;
   }
@@ -1471,281 +1056,522 @@ void ModeController::HandleBackspace() {
     return;
   }
 
-  std::string current_line = buffer.GetLine(kLine);
-  if (!buffer.DeleteLine(kLine)) {
-    return;
+  const std::size_t kPreviousLength = buffer.GetLine(kLine - 1).size();
+  if (buffer.DeleteText({kLine - 1, kPreviousLength}, 1)) {
+    state_.SetCursor(kLine - 1, kPreviousLength);
   }
-
-  auto& previous = buffer.GetLine(kLine - 1);
-  const std::size_t kPreviousLength = previous.size();
-  previous += current_line;
-  state_.SetCursor(kLine - 1, kPreviousLength);
 }
 
-bool ModeController::ApplyFindCommand(char command, FindCommandAction action,
-                                      char target) {
-  const Buffer& buffer = state_.GetBuffer();
-  if (buffer.LineCount() == 0) {
-    return false;
+void ModeController::ApplyUndo(bool redo, std::size_t count) {
+  auto& buffer = state_.GetBuffer();
+  TextPosition cursor{state_.CursorLine(), state_.CursorColumn()};
+  std::size_t applied = 0;
+  while (applied < count &&
+         (redo ? buffer.Redo(&cursor) : buffer.Undo(&cursor))) {
+    ++applied;
   }
 
-  const std::size_t kCount = ConsumeCountOr(1);
-  const std::size_t kLine = state_.CursorLine();
-  const std::size_t kColumn = state_.CursorColumn();
-  const std::string& line = buffer.GetLine(kLine);
-
-  if (line.empty()) {
-    state_.SetStatus("Line empty", StatusSeverity::kWarning);
-    return false;
+  if (applied == 0) {
+    state_.SetStatus(redo ? "Already at newest change"
+                          : "Already at oldest change",
+                     StatusSeverity::kWarning);
+    return;
   }
 
-  std::optional<FindMotionResult> result;
-  const FindOperationKind kKind = FindKindFromCommand(command);
-  const bool kBackward = kKind == FindOperationKind::kBackwardTo ||
-                         kKind == FindOperationKind::kBackwardTill;
-  const bool kTill = kKind == FindOperationKind::kForwardTill ||
-                     kKind == FindOperationKind::kBackwardTill;
-
-  std::size_t count = kCount;
-  std::size_t position = kColumn;
+  state_.SetCursor(cursor.line, cursor.column);
+  state_.MoveCursorLine(0);
+  std::ostringstream message;
+  message << applied << (applied == 1 ? " change" : " changes")
+          << (redo ? " redone" : " undone");
+  state_.SetStatus(message.str(), StatusSeverity::kInfo);
+}
 
-  while (count > 0) {
-    if (kBackward) {
-      if (position == 0) {
-        state_.SetStatus("Target not found", StatusSeverity::kWarning);
-        ResetCount();
-        return false;
-      }
-      position -= 1;
-      for (; position < line.size(); --position) {
-        if (line.at(position) == target) {
-          result = FindMotionResult{
-              .cursor = TextPosition{kLine, position},
-              .matched_column = position,
-              .include_target_char = !kTill,
-              .backward = true,
-          };
-          break;
-        }
-        if (position == 0) {
-          break;
-        }
+template <typename Operator, typename Motion>
+void ModeController::ApplyOperator(const CommandInvocation& invocation) {
+  constexpr OperatorAction kAction = Operator::kAction;
+  Buffer& buffer = state_.GetBuffer();
+  MotionContext context{buffer, last_find_, {}};
+  const std::optional<MotionResult> kSpan =
+      Motion::Apply(context, {state_.CursorLine(), state_.CursorColumn()},
+                    invocation.count, invocation.operand);
+
+  if constexpr (kAction == OperatorAction::kMove) {
+    if (!kSpan) {
+      if (!context.failure.empty()) {
+        state_.SetStatus(std::string(context.failure),
+                         StatusSeverity::kWarning);
       }
+      return;
+    }
+    if constexpr (Motion::kKeepsColumn) {
+      state_.MoveCursorLine(
+          kSpan->to.line >= kSpan->from.line
+              ? ToSignedDelta(kSpan->to.line - kSpan->from.line)
+              : -ToSignedDelta(kSpan->from.line - kSpan->to.line));
     } else {
-      if (position + 1 >= line.size()) {
-        state_.SetStatus("Target not found", StatusSeverity::kWarning);
-        ResetCount();
-        return false;
-      }
-      position += 1;
-      for (; position < line.size(); ++position) {
-        if (line.at(position) == target) {
-          result = FindMotionResult{
-              .cursor = TextPosition{kLine, position},
-              .matched_column = position,
-              .include_target_char = !kTill,
-              .backward = false,
-          };
-          break;
-        }
+      state_.SetCursor(kSpan->to.line, kSpan->to.column);
+      state_.MoveCursorLine(0);
+      if constexpr (std::is_same_v<Motion, LineEndMotion>) {
+        state_.KeepCursorAtLineEnd();
       }
     }
-
-    if (!result.has_value()) {
-      state_.SetStatus("Target not found", StatusSeverity::kWarning);
-      ResetCount();
-      return false;
+    state_.ClearStatus();
+  } else {
+    constexpr bool kDelete = kAction == OperatorAction::kDelete;
+    constexpr std::string_view kFailed = kDelete ? "Delete failed"
+                                                 : "Yank failed";
+    if (!kSpan) {
+      TakeRegister();
+      state_.SetStatus(std::string(context.failure.empty() ? kFailed
+                                                           : context.failure),
+                       StatusSeverity::kWarning);
+      return;
     }
 
-    position = result->matched_column;
-    count -= 1;
-  }
-
-  if (!result.has_value()) {
-    state_.SetStatus("Target not found", StatusSeverity::kWarning);
-    ResetCount();
-    return false;
-  }
-
-  auto apply_motion = [&](const FindMotionResult& motion) {
-    const bool kInclude = motion.include_target_char;
-    const std::size_t kMatchColumn = motion.matched_column;
-    const std::size_t kCursorColumn =
-        kInclude ? kMatchColumn
-                 : (motion.backward ? kMatchColumn + 1 : kMatchColumn - 1);
-    state_.SetCursor(motion.cursor.line, kCursorColumn);
-    state_.MoveCursorLine(0);
-  };
-
-  switch (action) {
-    case FindCommandAction::kMove:
-      apply_motion(*result);
-      break;
-    case FindCommandAction::kDelete:
-    case FindCommandAction::kYank: {
-      const std::size_t kStartColumn =
-          (std::min)(kColumn, result->matched_column);
-      const std::size_t kEndColumn =
-          (std::max)(kColumn, result->matched_column) + 1;
-      if (action == FindCommandAction::kDelete) {
-        if (!DeleteCharacterRange(kLine, kStartColumn, kLine, kEndColumn)) {
-          state_.SetStatus("Delete failed", StatusSeverity::kWarning);
-          return false;
+    TextPosition start = (std::min)(kSpan->from, kSpan->to);
+    TextPosition end = (std::max)(kSpan->from, kSpan->to);
+    bool linewise = kSpan->kind == MotionKind::kLinewise;
+    if (kSpan->kind == MotionKind::kExclusive && end.column == 0 &&
+        end.line > start.line) {
+      // As in vi, an exclusive span that ends at the start of a line stops
+      // at the end of the one before instead, and takes whole lines when it
+      // also starts at or before the first non-blank.
+      --end.line;
+      end.column = buffer.GetLine(end.line).size();
+      linewise = start.column <=
+                 FirstNonBlankPosition(buffer, start.line).column;
+    }
+
+    if (linewise) {
+      const std::size_t kFirst = start.line;
+      const std::size_t kLines = end.line - kFirst + 1;
+      if constexpr (kDelete) {
+        const std::size_t kDeleted = DeleteLineRange(kFirst, kLines);
+        if (kDeleted == 0) {
+          state_.SetStatus(std::string(kFailed), StatusSeverity::kWarning);
+          return;
         }
-        state_.SetCursor(kLine, kStartColumn);
+        const TextPosition kTo = FirstNonBlankPosition(
+            buffer, (std::min)(kFirst, buffer.LineCount() - 1));
+        state_.SetCursor(kTo.line, kTo.column);
         state_.MoveCursorLine(0);
+        state_.SetStatus(LinesMessage("Deleted", kDeleted),
+                         StatusSeverity::kInfo);
       } else {
-        if (!CopyCharacterRange(kLine, kStartColumn, kLine, kEndColumn)) {
-          state_.SetStatus("Yank failed", StatusSeverity::kWarning);
-          return false;
+        if (!CopyLineRange(kFirst, kLines)) {
+          state_.SetStatus(std::string(kFailed), StatusSeverity::kWarning);
+          return;
         }
-        apply_motion(*result);
+        // The cursor goes to the start of what was yanked.
+        state_.MoveCursorLine(-ToSignedDelta(kSpan->from.line - kFirst));
+        state_.SetStatus(LinesMessage("Yanked", kLines),
+                         StatusSeverity::kInfo);
       }
-      break;
+      return;
     }
-  }
 
-  has_last_find_ = true;
-  last_find_target_ = target;
-  last_find_backward_ = result->backward;
-  last_find_till_ = kTill;
-  return true;
-}
-
-bool ModeController::ApplyRepeatFind(bool reverse_direction,
-                                     FindCommandAction action) {
-  if (!has_last_find_) {
-    state_.SetStatus("No previous find", StatusSeverity::kWarning);
-    return false;
+    if (kSpan->kind == MotionKind::kInclusive) {
+      end.column = core::NextGrapheme(buffer.GetLine(end.line), end.column);
+    }
+    if (start >= end) {
+      TakeRegister();
+      state_.SetStatus(kDelete ? "Nothing to delete" : "Nothing to yank",
+                       StatusSeverity::kWarning);
+      return;
+    }
+    const bool kDone =
+        kDelete
+            ? DeleteCharacterRange(start.line, start.column, end.line,
+                                   end.column)
+            : CopyCharacterRange(start.line, start.column, end.line,
+                                 end.column);
+    if (!kDone) {
+      state_.SetStatus(std::string(kFailed), StatusSeverity::kWarning);
+      return;
+    }
+    state_.SetCursor(start.line, start.column);
+    state_.MoveCursorLine(0);
+    state_.ClearStatus();
   }
+}
 
-  bool backward = last_find_backward_;
-  if (reverse_direction) {
-    backward = !backward;
+void ModeController::ToggleVisual(SelectionKind kind) {
+  if (state_.CurrentMode() != Mode::kVisual) {
+    state_.StartSelection(kind);
+    state_.SetMode(Mode::kVisual);
+  } else if (state_.GetSelectionKind() == kind) {
+    state_.SetMode(Mode::kNormal);
+  } else {
+    state_.SetSelectionKind(kind);
   }
+  state_.ClearStatus();
+}
 
-  char command = CommandFromState(backward, last_find_till_);
-  return ApplyFindCommand(command, action, last_find_target_);
+std::optional<Selection> ModeController::EndVisual() {
+  std::optional<Selection> selection = state_.GetSelection();
+  state_.SetMode(Mode::kNormal);
+  state_.ClearStatus();
+  return selection;
 }
 
-bool ModeController::HandlePendingFind(char input, FindCommandAction action) {
-  if (pending_normal_command_.empty()) {
-    return false;
+void ModeController::DeleteSelection(bool change) {
+  const std::optional<Selection> kSelection = EndVisual();
+  if (!kSelection) {
+    TakeRegister();
+    return;
   }
-  char command = pending_normal_command_.front();
-  pending_normal_command_.clear();
-  ResetCount();
-  return ApplyFindCommand(command, action, input);
-}
+  Buffer& buffer = state_.GetBuffer();
+  const Selection& selection = *kSelection;
 
-bool ModeController::HandleDeleteOperator(char motion) {
-  ResetCount();
-  switch (motion) {
-    case 'd': {
-      const std::size_t kCount = ConsumeCountOr(1);
-      const std::size_t kDeleted = DeleteLineRange(state_.CursorLine(), kCount);
+  switch (selection.kind) {
+    case SelectionKind::kLine: {
+      const std::size_t kDeleted =
+          DeleteLineRange(selection.start.line, selection.LineCount());
       if (kDeleted == 0) {
-        return false;
+        state_.SetStatus("Delete failed", StatusSeverity::kWarning);
+        return;
+      }
+      if (change) {
+        buffer.InsertLine(selection.start.line, "");
+        state_.SetCursor(selection.start.line, 0);
+        break;
       }
+      const TextPosition kTo = FirstNonBlankPosition(
+          buffer, (std::min)(selection.start.line, buffer.LineCount() - 1));
+      state_.SetCursor(kTo.line, kTo.column);
       state_.MoveCursorLine(0);
-      std::ostringstream message;
-      message << "Deleted " << kDeleted << " line";
-      if (kDeleted != 1) {
-        message << 's';
+      state_.SetStatus(LinesMessage("Deleted", kDeleted),
+                       StatusSeverity::kInfo);
+      return;
+    }
+    case SelectionKind::kBlock: {
+      const TextPosition kStart = BlockStart(selection);
+      RegisterContent content;
+      content.blockwise = true;
+      const char kRegister = TakeRegister();
+      if (!DeleteBlock(selection, content.text)) {
+        state_.SetStatus("Nothing to delete", StatusSeverity::kWarning);
+        return;
       }
-      state_.SetStatus(message.str(), StatusSeverity::kInfo);
-      return true;
+      state_.GetRegisters().Delete(kRegister, std::move(content));
+      state_.SetCursor(kStart.line, kStart.column);
+      if (change) {
+        Selection left = selection;
+        left.right = left.left;
+        StartBlockInsert(left, BlockInsert::Kind::kChange);
+      }
+      return;
     }
-    case 'w':
-    case 'W':
-    case 'b':
-    case 'B':
-    case 'e':
-    case 'E': {
-      const std::size_t kCount = ConsumeCountOr(1);
-      const Buffer& buffer = state_.GetBuffer();
-      TextPosition start{state_.CursorLine(), state_.CursorColumn()};
-      TextPosition end = start;
-
-      auto advance_word = [&](TextPosition position) {
-        switch (motion) {
-          case 'w':
-            return NextWordStart(buffer, position);
-          case 'W':
-            return NextBigWordStart(buffer, position);
-          case 'e':
-            return WordEndInclusive(buffer, position);
-          case 'E':
-            return BigWordEndInclusive(buffer, position);
-          case 'b':
-            return PreviousWordStart(buffer, position);
-          case 'B':
-            return PreviousBigWordStart(buffer, position);
-          default:
-            return position;
-        }
-      };
-
-      for (std::size_t i = 0; i < kCount; ++i) {
-        end = advance_word(end);
+    case SelectionKind::kCharacter:
+    default: {
+      // The span runs through the last character, or the line break after
+      // it when that is selected too.
+      const std::string_view kLast = buffer.GetLine(selection.end.line);
+      LineLayout layout;
+      const SelectedBytes kTail =
+          SelectedIn(selection, selection.end.line, kLast,
+                     state_.GetViewOptions().tabstop, layout);
+      TextPosition stop{selection.end.line, kTail.end};
+      if (kTail.line_break && stop.line + 1 < buffer.LineCount()) {
+        stop = {stop.line + 1, 0};
       }
-
-      if (motion == 'e' || motion == 'E') {
-        end.column += 1;
+      if (!DeleteCharacterRange(selection.start.line, selection.start.column,
+                                stop.line, stop.column)) {
+        state_.SetStatus("Nothing to delete", StatusSeverity::kWarning);
+        return;
       }
+      state_.SetCursor(selection.start.line, selection.start.column);
+      break;
+    }
+  }
+
+  if (change) {
+    state_.SetMode(Mode::kInsert);
+    state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
+  } else {
+    state_.MoveCursorLine(0);
+  }
+}
 
-      if (!DeleteCharacterRange(start.line, start.column, end.line,
-                                end.column)) {
-        return false;
+void ModeController::YankSelection() {
+  const std::optional<Selection> kSelection = EndVisual();
+  if (!kSelection) {
+    TakeRegister();
+    return;
+  }
+  const Selection& selection = *kSelection;
+  Buffer& buffer = state_.GetBuffer();
+
+  TextPosition cursor = selection.start;
+  bool yanked = false;
+  switch (selection.kind) {
+    case SelectionKind::kLine:
+      yanked = CopyLineRange(selection.start.line, selection.LineCount());
+      if (yanked) {
+        state_.SetStatus(LinesMessage("Yanked", selection.LineCount()),
+                         StatusSeverity::kInfo);
       }
-      state_.SetCursor(start.line, start.column);
-      state_.MoveCursorLine(0);
-      return true;
+      break;
+    case SelectionKind::kBlock: {
+      RegisterContent content;
+      content.blockwise = true;
+      content.text = BlockText(selection);
+      state_.GetRegisters().Yank(TakeRegister(), std::move(content));
+      cursor = BlockStart(selection);
+      yanked = true;
+      break;
     }
-    default:
-      return false;
+    case SelectionKind::kCharacter:
+    default: {
+      const std::string_view kLast = buffer.GetLine(selection.end.line);
+      LineLayout layout;
+      const SelectedBytes kTail =
+          SelectedIn(selection, selection.end.line, kLast,
+                     state_.GetViewOptions().tabstop, layout);
+      TextPosition stop{selection.end.line, kTail.end};
+      if (kTail.line_break && stop.line + 1 < buffer.LineCount()) {
+        stop = {stop.line + 1, 0};
+      }
+      yanked = CopyCharacterRange(selection.start.line, selection.start.column,
+                                  stop.line, stop.column);
+      break;
+    }
+  }
+
+  if (!yanked) {
+    state_.SetStatus("Nothing to yank", StatusSeverity::kWarning);
   }
+  state_.SetCursor(cursor.line, cursor.column);
+  state_.MoveCursorLine(0);
 }
 
-bool ModeController::HandleYankOperator(char motion) {
-  ResetCount();
-  switch (motion) {
-    case 'y':
-      return CopyLineRange(state_.CursorLine(), ConsumeCountOr(1));
-    default:
-      return false;
+void ModeController::ReplaceSelection(char value) {
+  const std::optional<Selection> kSelection = EndVisual();
+  if (!kSelection) {
+    return;
+  }
+  if (std::isprint(static_cast<unsigned char>(value)) == 0 &&
+      value != '\t') {
+    state_.SetStatus("Cannot replace with that character",
+                     StatusSeverity::kWarning);
+    return;
+  }
+  const Selection& selection = *kSelection;
+  Buffer& buffer = state_.GetBuffer();
+  const std::size_t kTabstop = state_.GetViewOptions().tabstop;
+
+  // Every character selected becomes `value`, on all lines in one edit; the
+  // line breaks stay.
+  LineLayout layout;
+  LineBatch batch;
+  batch.Reserve(selection.LineCount(), 0);
+  for (std::size_t line = selection.start.line; line <= selection.end.line;
+       ++line) {
+    const std::string_view kText = buffer.GetLine(line);
+    const SelectedBytes kSelected =
+        SelectedIn(selection, line, kText, kTabstop, layout);
+    if (kSelected.start >= kSelected.end) {
+      continue;
+    }
+    batch.Begin(line);
+    batch.Append(kText.substr(0, kSelected.start));
+    for (std::size_t at = kSelected.start; at < kSelected.end;
+         at = core::NextGrapheme(kText, at)) {
+      batch.AppendRepeated(value, 1);
+    }
+    batch.Append(kText.substr(kSelected.end));
+  }
+  if (batch.Empty()) {
+    state_.SetStatus("Nothing to replace", StatusSeverity::kWarning);
+    return;
+  }
+  if (!buffer.ReplaceLineBatch(batch.Changes())) {
+    state_.SetStatus("Replace failed", StatusSeverity::kWarning);
+    return;
+  }
+
+  const TextPosition kCursor = selection.kind == SelectionKind::kBlock
+                                   ? BlockStart(selection)
+                               : selection.kind == SelectionKind::kLine
+                                   ? TextPosition{selection.start.line, 0}
+                                   : selection.start;
+  state_.SetCursor(kCursor.line, kCursor.column);
+  state_.MoveCursorLine(0);
+}
+
+void ModeController::InsertAtSelection(bool append) {
+  const std::optional<Selection> kSelection = EndVisual();
+  if (!kSelection) {
+    return;
+  }
+  const Selection& selection = *kSelection;
+  if (selection.kind == SelectionKind::kBlock) {
+    StartBlockInsert(selection, append ? BlockInsert::Kind::kAppend
+                                       : BlockInsert::Kind::kInsert);
+    return;
   }
+
+  // Otherwise before the first character selected or after the last.
+  const Buffer& buffer = state_.GetBuffer();
+  TextPosition at = selection.start;
+  if (selection.kind == SelectionKind::kLine) {
+    at = append ? TextPosition{selection.end.line,
+                               buffer.GetLine(selection.end.line).size()}
+                : FirstNonBlankPosition(buffer, selection.start.line);
+  } else if (append) {
+    at = {selection.end.line,
+          core::NextGrapheme(buffer.GetLine(selection.end.line),
+                             selection.end.column)};
+  }
+  state_.SetCursor(at.line, at.column);
+  state_.SetMode(Mode::kInsert);
+  state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
 }
 
-void ModeController::ResetCount() noexcept {
-  prefix_count_ = 0;
-  motion_count_ = 0;
-  has_prefix_count_ = false;
-  has_motion_count_ = false;
+void ModeController::StartBlockInsert(const Selection& selection,
+                                      BlockInsert::Kind kind) {
+  Buffer& buffer = state_.GetBuffer();
+  BlockInsert insert;
+  insert.kind = kind;
+  insert.first_line = selection.start.line;
+  insert.last_line = selection.end.line;
+  insert.column =
+      kind == BlockInsert::Kind::kAppend ? selection.right : selection.left;
+  insert.to_line_end =
+      kind == BlockInsert::Kind::kAppend && selection.to_line_end;
+
+  // The first line is padded out to the column now, the others when the
+  // text is known.
+  const std::string_view kText = buffer.GetLine(insert.first_line);
+  LineLayout layout;
+  layout.Reset(kText, state_.GetViewOptions().tabstop, 0);
+  const LineLayout::Glyph kGlyph = layout.Locate(kText, insert.column);
+  insert.start = insert.to_line_end ? kText.size() : kGlyph.byte;
+  if (kGlyph.length == 0 && kGlyph.column < insert.column &&
+      kind == BlockInsert::Kind::kAppend && !insert.to_line_end) {
+    const std::string kPadding(insert.column - kGlyph.column, ' ');
+    if (buffer.InsertText(insert.first_line, kText.size(), kPadding)) {
+      insert.start += kPadding.size();
+    }
+  }
+  insert.length = buffer.GetLine(insert.first_line).size();
+
+  block_insert_ = insert;
+  state_.SetCursor(insert.first_line, insert.start);
+  state_.SetMode(Mode::kInsert);
+  state_.SetStatus("-- INSERT --", StatusSeverity::kInfo);
 }
 
-std::size_t ModeController::ConsumeCountOr(std::size_t fallback) noexcept {
-  const bool kHasPrefix = has_prefix_count_ && prefix_count_ > 0;
-  const bool kHasMotion = has_motion_count_ && motion_count_ > 0;
+void ModeController::FinishBlockInsert() {
+  const BlockInsert kInsert = *block_insert_;
+  block_insert_.reset();
+  Buffer& buffer = state_.GetBuffer();
+  if (kInsert.first_line >= buffer.LineCount() ||
+      state_.CursorLine() != kInsert.first_line) {
+    return;
+  }
+  // Only text typed in one go where insert mode started is repeated, as in
+  // vim.
+  const std::string_view kFirst = buffer.GetLine(kInsert.first_line);
+  if (kFirst.size() <= kInsert.length ||
+      state_.CursorColumn() != kInsert.start + kFirst.size() - kInsert.length) {
+    return;
+  }
+  const std::string kTyped(
+      kFirst.substr(kInsert.start, kFirst.size() - kInsert.length));
+
+  const std::size_t kLast =
+      (std::min)(kInsert.last_line, buffer.LineCount() - 1);
+  LineLayout layout;
+  LineBatch batch;
+  batch.Reserve(kLast - kInsert.first_line, 0);
+  for (std::size_t line = kInsert.first_line + 1; line <= kLast; ++line) {
+    const std::string_view kText = buffer.GetLine(line);
+    if (kInsert.to_line_end) {
+      batch.Begin(line);
+      batch.Append(kText);
+      batch.Append(kTyped);
+      continue;
+    }
+    layout.Reset(kText, state_.GetViewOptions().tabstop, 0);
+    const LineLayout::Glyph kGlyph = layout.Locate(kText, kInsert.column);
+    const bool kShort = kGlyph.length == 0 && kGlyph.column < kInsert.column;
+    if ((kInsert.kind == BlockInsert::Kind::kInsert && kGlyph.length == 0) ||
+        (kInsert.kind == BlockInsert::Kind::kChange && kShort)) {
+      continue;
+    }
+    batch.Begin(line);
+    batch.Append(kText.substr(0, kGlyph.byte));
+    if (kShort) {
+      batch.AppendRepeated(' ', kInsert.column - kGlyph.column);
+    }
+    batch.Append(kTyped);
+    batch.Append(kText.substr(kGlyph.byte));
+  }
+  if (!batch.Empty() && !buffer.ReplaceLineBatch(batch.Changes())) {
+    state_.SetStatus("Insert failed", StatusSeverity::kError);
+  }
+  state_.SetCursor(kInsert.first_line, kInsert.start);
+}
 
-  std::size_t result = fallback;
-  if (kHasMotion) {
-    result = motion_count_;
-    if (kHasPrefix) {
-      const std::size_t kProduct = prefix_count_ * result;
-      result = (std::min)(kProduct, kMaxCountValue);
+bool ModeController::DeleteBlock(const Selection& selection,
+                                 std::string& text) {
+  Buffer& buffer = state_.GetBuffer();
+  const std::size_t kTabstop = state_.GetViewOptions().tabstop;
+  LineLayout layout;
+  LineBatch batch;
+  batch.Reserve(selection.LineCount(), 0);
+  // One pass takes the block's text and builds what is left of each line.
+  for (std::size_t line = selection.start.line; line <= selection.end.line;
+       ++line) {
+    const std::string_view kText = buffer.GetLine(line);
+    const SelectedBytes kSelected =
+        SelectedIn(selection, line, kText, kTabstop, layout);
+    if (line > selection.start.line) {
+      text.push_back('\n');
+    }
+    if (kSelected.start >= kSelected.end) {
+      continue;
     }
-  } else if (kHasPrefix) {
-    result = prefix_count_;
+    text.append(kText.substr(kSelected.start, kSelected.end - kSelected.start));
+    batch.Begin(line);
+    batch.Append(kText.substr(0, kSelected.start));
+    batch.Append(kText.substr(kSelected.end));
   }
+  return !batch.Empty() && buffer.ReplaceLineBatch(batch.Changes());
+}
 
-  ResetCount();
-  return result;
+std::string ModeController::BlockText(const Selection& selection) {
+  const Buffer& buffer = state_.GetBuffer();
+  const std::size_t kTabstop = state_.GetViewOptions().tabstop;
+  LineLayout layout;
+  std::string text;
+  for (std::size_t line = selection.start.line; line <= selection.end.line;
+       ++line) {
+    const std::string_view kText = buffer.GetLine(line);
+    const SelectedBytes kSelected =
+        SelectedIn(selection, line, kText, kTabstop, layout);
+    if (line > selection.start.line) {
+      text.push_back('\n');
+    }
+    text.append(kText.substr(kSelected.start, kSelected.end - kSelected.start));
+  }
+  return text;
+}
+
+TextPosition ModeController::BlockStart(const Selection& selection) {
+  LineLayout layout;
+  const std::size_t kLine = selection.start.line;
+  return {kLine, SelectedIn(selection, kLine,
+                            state_.GetBuffer().GetLine(kLine),
+                            state_.GetViewOptions().tabstop, layout)
+                     .start};
 }
 
 bool ModeController::CopyLineRange(std::size_t start_line,
                                    std::size_t line_count) {
-  const Buffer& buffer = state_.GetBuffer();
+  const char kRegister = TakeRegister();
+  auto& buffer = state_.GetBuffer();
   if (buffer.LineCount() == 0 || start_line >= buffer.LineCount() ||
       line_count == 0) {
     return false;
@@ -1757,12 +1583,11 @@ bool ModeController::CopyLineRange(std::size_t start_line,
     return false;
   }
 
-  yank_buffer_.clear();
-  yank_buffer_.reserve(line_count);
-  for (std::size_t i = 0; i < line_count; ++i) {
-    yank_buffer_.push_back(buffer.GetLine(start_line + i));
-  }
-  yank_linewise_ = true;
+  // The register shares the lines' pieces; nothing is copied.
+  RegisterContent content;
+  content.lines = buffer.CopyLines(start_line, line_count);
+  content.linewise = true;
+  state_.GetRegisters().Yank(kRegister, std::move(content));
   return true;
 }
 
@@ -1770,6 +1595,7 @@ bool ModeController::CopyCharacterRange(std::size_t start_line,
                                         std::size_t start_column,
                                         std::size_t end_line,
                                         std::size_t end_column) {
+  const char kRegister = TakeRegister();
   const Buffer& buffer = state_.GetBuffer();
   if (buffer.LineCount() == 0) {
     return false;
@@ -1783,34 +1609,26 @@ bool ModeController::CopyCharacterRange(std::size_t start_line,
   start_line = (std::min)(start_line, buffer.LineCount() - 1);
   end_line = (std::min)(end_line, buffer.LineCount() - 1);
 
-  const std::string& start_text = buffer.GetLine(start_line);
-  const std::string& end_text = buffer.GetLine(end_line);
+  start_column = (std::min)(start_column, buffer.GetLine(start_line).size());
+  end_column = (std::min)(end_column, buffer.GetLine(end_line).size());
 
-  start_column = (std::min)(start_column, start_text.size());
-  end_column = (std::min)(end_column, end_text.size());
-
-  if (start_line == end_line) {
-    if (start_column >= end_column) {
-      return false;
-    }
-    yank_buffer_.assign(
-        1, start_text.substr(start_column, end_column - start_column));
-  } else {
-    yank_buffer_.clear();
-    yank_buffer_.reserve(end_line - start_line + 1);
-    yank_buffer_.push_back(start_text.substr(start_column));
-    for (std::size_t line = start_line + 1; line < end_line; ++line) {
-      yank_buffer_.push_back(buffer.GetLine(line));
-    }
-    yank_buffer_.push_back(end_text.substr(0, end_column));
+  if (start_line == end_line && start_column >= end_column) {
+    return false;
   }
 
-  yank_linewise_ = false;
+  RegisterContent content;
+  if (!buffer.CopyText({start_line, start_column}, {end_line, end_column},
+                       content.text)) {
+    return false;
+  }
+  state_.GetRegisters().Yank(kRegister, std::move(content));
   return true;
 }
 
-bool ModeController::PasteAfterCursor() {
-  if (!HasYank()) {
+bool ModeController::PasteAfterCursor(std::size_t count) {
+  const Registers::Content kContent =
+      state_.GetRegisters().Get(TakeRegister());
+  if (kContent == nullptr) {
     state_.SetStatus("Nothing to paste", StatusSeverity::kWarning);
     return false;
   }
@@ -1823,66 +1641,141 @@ bool ModeController::PasteAfterCursor() {
   TextPosition cursor{state_.CursorLine(), state_.CursorColumn()};
   cursor = ClampPosition(buffer, cursor);
 
-  if (yank_linewise_) {
+  if (kContent->blockwise) {
+    return PasteBlock(*kContent, cursor, count);
+  }
+  if (kContent->linewise) {
     const std::size_t kInsertLine = cursor.line + 1;
-    for (std::size_t i = 0; i < yank_buffer_.size(); ++i) {
-      if (!buffer.InsertLine(kInsertLine + i, yank_buffer_[i])) {
-        state_.SetStatus("Paste failed", StatusSeverity::kWarning);
-        return false;
-      }
+    // The copies share the register's text.
+    if (!buffer.InsertLines(kInsertLine,
+                            LineSlice::Repeat(kContent->lines, count))) {
+      state_.SetStatus("Paste failed", StatusSeverity::kWarning);
+      return false;
     }
 
     const std::size_t kFirstInserted =
         (std::min)(kInsertLine, buffer.LineCount() - 1);
-    const std::string& first_line = buffer.GetLine(kFirstInserted);
+    const std::string_view first_line = buffer.GetLine(kFirstInserted);
     const std::size_t kColumn = FirstNonBlankColumn(first_line);
     state_.SetCursor(kFirstInserted, kColumn);
     state_.MoveCursorLine(0);
     return true;
   }
 
-  std::size_t line = cursor.line;
-  std::size_t column = cursor.column;
-  std::string& current = buffer.GetLine(line);
-  const std::size_t kInsertColumn = (std::min)(column + 1, current.size());
-  std::string prefix = current.substr(0, kInsertColumn);
-  std::string suffix = current.substr(kInsertColumn);
-  current = prefix + yank_buffer_.front();
-
-  if (yank_buffer_.size() == 1) {
-    current += suffix;
-    const std::size_t kInserted = yank_buffer_.front().size();
-    const std::size_t kCursorColumn =
-        kInserted == 0 ? prefix.size() : prefix.size() + kInserted - 1;
-    state_.SetCursor(line, kCursorColumn);
-    state_.MoveCursorLine(0);
-    return true;
+  const std::size_t kInsertColumn =
+      core::NextGrapheme(buffer.GetLine(cursor.line), cursor.column);
+  std::string repeated;
+  if (count > 1) {
+    repeated.reserve(kContent->text.size() * count);
+    for (std::size_t copy = 0; copy < count; ++copy) {
+      repeated += kContent->text;
+    }
+  }
+  TextPosition end;
+  if (!buffer.InsertText(cursor.line, kInsertColumn,
+                         count > 1 ? repeated : kContent->text, &end)) {
+    state_.SetStatus("Paste failed", StatusSeverity::kWarning);
+    return false;
   }
 
-  for (std::size_t i = 1; i < yank_buffer_.size(); ++i) {
-    const std::size_t kInsertAt = line + i;
-    if (!buffer.InsertLine(kInsertAt, yank_buffer_[i])) {
+  // The cursor ends on the last pasted character.
+  const std::size_t kLastStart = end.line == cursor.line ? kInsertColumn : 0;
+  const std::size_t kCursorColumn =
+      end.column > kLastStart
+          ? core::GraphemeStart(buffer.GetLine(end.line), end.column - 1)
+          : kLastStart;
+  state_.SetCursor(end.line, kCursorColumn);
+  state_.MoveCursorLine(0);
+  return true;
+}
+
+bool ModeController::PasteBlock(const RegisterContent& content,
+                                TextPosition cursor, std::size_t count) {
+  Buffer& buffer = state_.GetBuffer();
+  const std::size_t kTabstop = state_.GetViewOptions().tabstop;
+  const std::string_view kBlock(content.text);
+  const std::size_t kLines =
+      static_cast<std::size_t>(std::count(kBlock.begin(), kBlock.end(), '\n')) +
+      1;
+  std::size_t width = 0;
+  for (std::string_view rest = kBlock;;) {
+    const std::size_t kBreak = rest.find('\n');
+    width = (std::max)(width, core::DisplayWidth(rest.substr(0, kBreak)));
+    if (kBreak == std::string_view::npos) {
+      break;
+    }
+    rest.remove_prefix(kBreak + 1);
+  }
+
+  // After the cursor's character, unless the line is empty.
+  LineLayout layout;
+  const std::string_view kCursorText = buffer.GetLine(cursor.line);
+  layout.Reset(kCursorText, kTabstop, 0);
+  const std::size_t kColumn =
+      kCursorText.empty()
+          ? 0
+          : layout.ColumnOf(kCursorText,
+                            core::NextGrapheme(kCursorText, cursor.column));
+  if (cursor.line + kLines > buffer.LineCount()) {
+    const std::vector<std::string> kMissing(
+        cursor.line + kLines - buffer.LineCount());
+    if (!buffer.InsertLines(buffer.LineCount(), kMissing)) {
       state_.SetStatus("Paste failed", StatusSeverity::kWarning);
       return false;
     }
   }
 
-  const std::size_t kLastInsertedLine = line + yank_buffer_.size() - 1;
-  std::string& last_line = buffer.GetLine(kLastInsertedLine);
-  last_line += suffix;
-  const std::size_t kCursorColumn =
-      yank_buffer_.back().empty() ? 0 : yank_buffer_.back().size() - 1;
-  state_.SetCursor(kLastInsertedLine, kCursorColumn);
-  state_.MoveCursorLine(0);
+  // A line of the block goes on each line, padded to the block's width
+  // where text follows it, so that the text stays in line. Its copies are
+  // each padded to the width but the last.
+  LineBatch batch;
+  batch.Reserve(kLines, content.text.size() * count);
+  std::size_t first_byte = 0;
+  std::string_view rest = kBlock;
+  for (std::size_t line = cursor.line; line < cursor.line + kLines; ++line) {
+    const std::size_t kBreak = rest.find('\n');
+    const std::string_view kPiece = rest.substr(0, kBreak);
+    rest.remove_prefix(kBreak == std::string_view::npos ? rest.size()
+                                                        : kBreak + 1);
+    const std::string_view kText = buffer.GetLine(line);
+    layout.Reset(kText, kTabstop, 0);
+    const LineLayout::Glyph kGlyph = layout.Locate(kText, kColumn);
+    batch.Begin(line);
+    batch.Append(kText.substr(0, kGlyph.byte));
+    std::size_t padding = 0;
+    if (kGlyph.length == 0 && kGlyph.column < kColumn && !kPiece.empty()) {
+      padding = kColumn - kGlyph.column;
+      batch.AppendRepeated(' ', padding);
+    }
+    if (line == cursor.line) {
+      first_byte = kGlyph.byte + padding;
+    }
+    const std::size_t kPadding = width - core::DisplayWidth(kPiece);
+    for (std::size_t copy = 0; copy < count; ++copy) {
+      batch.Append(kPiece);
+      if (copy + 1 < count || kGlyph.byte < kText.size()) {
+        batch.AppendRepeated(' ', kPadding);
+      }
+    }
+    batch.Append(kText.substr(kGlyph.byte));
+  }
+  if (!buffer.ReplaceLineBatch(batch.Changes())) {
+    state_.SetStatus("Paste failed", StatusSeverity::kWarning);
+    return false;
+  }
+  state_.SetCursor(cursor.line, first_byte);
   return true;
 }
 
-bool ModeController::HasYank() const noexcept {
-  return !yank_buffer_.empty();
+char ModeController::TakeRegister() noexcept {
+  const char kRegister = selected_register_;
+  selected_register_ = 0;
+  return kRegister;
 }
 
 std::size_t ModeController::DeleteLineRange(std::size_t start_line,
                                             std::size_t line_count) {
+  const char kRegister = TakeRegister();
   if (line_count == 0) {
     return 0;
   }
@@ -1892,23 +1785,21 @@ std::size_t ModeController::DeleteLineRange(std::size_t start_line,
     return 0;
   }
 
-  std::size_t deleted = 0;
-  for (std::size_t i = 0; i < line_count && start_line < buffer.LineCount();
-       ++i) {
-    if (buffer.DeleteLine(start_line)) {
-      ++deleted;
-    } else {
-      break;
-    }
+  RegisterContent content;
+  content.linewise = true;
+  const std::size_t kDeleted =
+      buffer.DeleteLines(start_line, line_count, &content.lines);
+  if (kDeleted > 0) {
+    state_.GetRegisters().Delete(kRegister, std::move(content));
   }
-
-  return deleted;
+  return kDeleted;
 }
 
 bool ModeController::DeleteCharacterRange(std::size_t start_line,
                                           std::size_t start_column,
                                           std::size_t end_line,
                                           std::size_t end_column) {
+  const char kRegister = TakeRegister();
   auto& buffer = state_.GetBuffer();
   const Buffer& buffer_const = buffer;
   if (buffer.LineCount() == 0) {
@@ -1923,91 +1814,25 @@ bool ModeController::DeleteCharacterRange(std::size_t start_line,
   start_line = (std::min)(start_line, buffer.LineCount() - 1);
   end_line = (std::min)(end_line, buffer.LineCount() - 1);
 
-  const std::string& start_line_text = buffer_const.GetLine(start_line);
-  const std::string& end_line_text = buffer_const.GetLine(end_line);
+  const std::string_view start_line_text = buffer_const.GetLine(start_line);
+  const std::string_view end_line_text = buffer_const.GetLine(end_line);
 
   start_column = (std::min)(start_column, start_line_text.size());
   end_column = (std::min)(end_column, end_line_text.size());
 
-  if (start_line == end_line) {
-    if (start_column >= end_column) {
-      return false;
-    }
-    std::string& target = buffer.GetLine(start_line);
-    target.erase(start_column, end_column - start_column);
-    return true;
-  }
-
-  std::string prefix = start_line_text.substr(0, start_column);
-  std::string suffix = end_line_text.substr(end_column);
-
-  const std::size_t kLinesToDelete = end_line - start_line;
-  for (std::size_t i = 0; i < kLinesToDelete; ++i) {
-    buffer.DeleteLine(start_line + 1);
-  }
-
-  std::string& merged = buffer.GetLine(start_line);
-  merged = std::move(prefix) + std::move(suffix);
-  return true;
-}
-
-bool ModeController::ExecuteCommandLine(const std::string& line) {
-  const std::string kTrimmed = TrimCopy(line);
-  if (kTrimmed.empty()) {
+  if (start_line == end_line && start_column >= end_column) {
     return false;
   }
 
-  std::vector<std::string> commands;
-  auto push_command = [&commands](const std::string& candidate) {
-    std::string command = TrimCopy(candidate);
-    if (command.empty()) {
-      return;
-    }
-
-    if (command == "wq" || command == "qw" || command == "x") {
-      commands.emplace_back(":w");
-      commands.emplace_back(":q");
-      return;
-    }
-
-    if (command.front() != ':') {
-      command.insert(command.begin(), ':');
-    }
-    commands.push_back(std::move(command));
-  };
-
-  std::string segment;
-  bool saw_separator = false;
-  for (char ch : line) {
-    if (IsCommandSeparator(ch)) {
-      saw_separator = true;
-      push_command(segment);
-      segment.clear();
-    } else {
-      segment.push_back(ch);
-    }
-  }
-  push_command(segment);
-
-  if (!saw_separator && commands.empty()) {
-    push_command(kTrimmed);
-  }
-
-  if (commands.empty()) {
+  RegisterContent content;
+  const TextPosition kStart{start_line, start_column};
+  const TextPosition kEnd{end_line, end_column};
+  if (!buffer_const.CopyText(kStart, kEnd, content.text) ||
+      !buffer.Splice(kStart, kEnd, {})) {
     return false;
   }
-
-  bool success = true;
-  for (const std::string& command : commands) {
-    if (!command_handler_.Handle(state_, command)) {
-      success = false;
-      break;
-    }
-    if (!state_.IsRunning()) {
-      break;
-    }
-  }
-
-  return success;
+  state_.GetRegisters().Delete(kRegister, std::move(content));
+  return true;
 }
+
 }  // namespace core
\ No newline at end of file
@@ -0,0 +1,712 @@
+#include "core/Motions.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <optional>
+
+#include "core/Buffer.hpp"
+#include "core/Utf8.hpp"
+
+namespace {
+constexpr std::uint32_t kBlankClass = 0;
+
+// Word motions compare graphemes by the class of their first character.
+std::uint32_t ClassAt(std::string_view line, std::size_t column) {
+  std::size_t length = 0;
+  return core::WordClass(core::DecodeUtf8(line, column, length));
+}
+
+// A motion typed without a count moves once.
+std::size_t Times(std::size_t count) {
+  return count == 0 ? 1 : count;
+}
+
+// `step` taken `count` times over from `from`.
+template <typename Step>
+std::optional<core::MotionResult> Repeat(const core::Buffer& buffer,
+                                         core::TextPosition from,
+                                         std::size_t count,
+                                         core::MotionKind kind, Step step) {
+  core::TextPosition to = from;
+  for (std::size_t i = Times(count); i > 0; --i) {
+    to = step(buffer, to);
+  }
+  return core::MotionResult{from, to, kind};
+}
+
+std::optional<core::MotionResult> Find(core::MotionContext& context,
+                                       core::TextPosition from,
+                                       const core::FindTarget& find,
+                                       std::size_t count) {
+  const std::optional<std::size_t> kColumn = core::FindInLine(
+      context.buffer.GetLine(from.line), from.column, find, Times(count));
+  if (!kColumn) {
+    context.failure = "Target not found";
+    return std::nullopt;
+  }
+  // F and T stop short of the cursor, whose grapheme is not theirs.
+  return core::MotionResult{from,
+                            {from.line, *kColumn},
+                            find.backward ? core::MotionKind::kExclusive
+                                          : core::MotionKind::kInclusive};
+}
+
+bool IsBlankLine(std::string_view line) {
+  for (unsigned char ch : line) {
+    if (std::isspace(ch) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+namespace core {
+TextPosition ClampPosition(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  if (position.line >= buffer.LineCount()) {
+    position.line = buffer.LineCount() - 1;
+  }
+
+  const std::string_view line = buffer.GetLine(position.line);
+  if (position.column > line.size()) {
+    position.column = line.size();
+  }
+
+  return position;
+}
+
+TextPosition NextWordStart(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+
+  bool consumed_segment = false;
+
+  while (position.line < buffer.LineCount()) {
+    const std::string_view line = buffer.GetLine(position.line);
+    const std::size_t kLineLength = line.size();
+
+    if (position.column >= kLineLength) {
+      if (position.line + 1 >= buffer.LineCount()) {
+        return TextPosition{position.line, kLineLength};
+      }
+      position.line += 1;
+      position.column = 0;
+      consumed_segment = true;
+      continue;
+    }
+
+    const std::uint32_t kCurrentClass = ClassAt(line, position.column);
+    if (kCurrentClass == kBlankClass) {
+      // Whatever follows blanks or a line break starts the next word.
+      consumed_segment = true;
+      position.column = NextGrapheme(line, position.column);
+      continue;
+    }
+
+    if (!consumed_segment) {
+      consumed_segment = true;
+      while (position.column < kLineLength &&
+             ClassAt(line, position.column) == kCurrentClass) {
+        position.column = NextGrapheme(line, position.column);
+      }
+      continue;
+    }
+
+    return position;
+  }
+
+  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
+  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
+}
+
+TextPosition NextBigWordStart(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+  bool consumed_segment = false;
+
+  while (position.line < buffer.LineCount()) {
+    const std::string_view line = buffer.GetLine(position.line);
+    const std::size_t kLineLength = line.size();
+
+    if (position.column >= kLineLength) {
+      if (position.line + 1 >= buffer.LineCount()) {
+        return TextPosition{position.line, kLineLength};
+      }
+      position.line += 1;
+      position.column = 0;
+      consumed_segment = true;
+      continue;
+    }
+
+    if (ClassAt(line, position.column) == kBlankClass) {
+      // Whatever follows blanks or a line break starts the next word.
+      consumed_segment = true;
+      position.column = NextGrapheme(line, position.column);
+      continue;
+    }
+
+    if (!consumed_segment) {
+      consumed_segment = true;
+      while (position.column < kLineLength &&
+             ClassAt(line, position.column) != kBlankClass) {
+        position.column = NextGrapheme(line, position.column);
+      }
+      continue;
+    }
+
+    return position;
+  }
+
+  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
+  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
+}
+
+TextPosition PreviousWordStart(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+
+  auto retreat_line = [&]() {
+    if (position.line == 0) {
+      position.column = 0;
+      return false;
+    }
+    position.line -= 1;
+    position.column = buffer.GetLine(position.line).size();
+    return true;
+  };
+
+  if (position.column > 0) {
+    position.column =
+        GraphemeStart(buffer.GetLine(position.line), position.column - 1);
+  } else if (!retreat_line()) {
+    return TextPosition{0, 0};
+  }
+
+  while (true) {
+    const std::string_view line = buffer.GetLine(position.line);
+    const std::size_t kLineLength = line.size();
+    if (kLineLength == 0) {
+      if (!retreat_line()) {
+        return TextPosition{0, 0};
+      }
+      continue;
+    }
+
+    if (position.column >= kLineLength) {
+      position.column = GraphemeStart(line, kLineLength - 1);
+    }
+
+    const std::uint32_t kCurrentClass = ClassAt(line, position.column);
+    if (kCurrentClass == kBlankClass) {
+      if (position.column == 0) {
+        if (!retreat_line()) {
+          return TextPosition{0, 0};
+        }
+      } else {
+        position.column = GraphemeStart(line, position.column - 1);
+      }
+      continue;
+    }
+
+    while (position.column > 0) {
+      const std::size_t kPrevious = GraphemeStart(line, position.column - 1);
+      if (ClassAt(line, kPrevious) != kCurrentClass) {
+        break;
+      }
+      position.column = kPrevious;
+    }
+
+    return position;
+  }
+}
+
+TextPosition PreviousBigWordStart(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+
+  auto retreat_line = [&]() {
+    if (position.line == 0) {
+      position.column = 0;
+      return false;
+    }
+    position.line -= 1;
+    position.column = buffer.GetLine(position.line).size();
+    return true;
+  };
+
+  if (position.column > 0) {
+    position.column =
+        GraphemeStart(buffer.GetLine(position.line), position.column - 1);
+  } else if (!retreat_line()) {
+    return TextPosition{0, 0};
+  }
+
+  while (true) {
+    const std::string_view line = buffer.GetLine(position.line);
+    const std::size_t kLineLength = line.size();
+    if (kLineLength == 0) {
+      if (!retreat_line()) {
+        return TextPosition{0, 0};
+      }
+      continue;
+    }
+
+    if (position.column >= kLineLength) {
+      position.column = GraphemeStart(line, kLineLength - 1);
+    }
+
+    if (ClassAt(line, position.column) == kBlankClass) {
+      if (position.column == 0) {
+        if (!retreat_line()) {
+          return TextPosition{0, 0};
+        }
+      } else {
+        position.column = GraphemeStart(line, position.column - 1);
+      }
+      continue;
+    }
+
+    while (position.column > 0) {
+      const std::size_t kPrevious = GraphemeStart(line, position.column - 1);
+      if (ClassAt(line, kPrevious) == kBlankClass) {
+        break;
+      }
+      position.column = kPrevious;
+    }
+
+    return position;
+  }
+}
+
+TextPosition WordEndInclusive(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+
+  while (position.line < buffer.LineCount()) {
+    const std::string_view line = buffer.GetLine(position.line);
+    const std::size_t kLineLength = line.size();
+
+    if (position.column >= kLineLength) {
+      if (position.line + 1 >= buffer.LineCount()) {
+        return TextPosition{position.line, kLineLength};
+      }
+      position.line += 1;
+      position.column = 0;
+      continue;
+    }
+
+    const std::uint32_t kInitialClass = ClassAt(line, position.column);
+    if (kInitialClass == kBlankClass) {
+      position.column = NextGrapheme(line, position.column);
+      continue;
+    }
+
+    // The last grapheme of the run of the initial class.
+    std::size_t last = position.column;
+    std::size_t probe = NextGrapheme(line, last);
+    while (probe < kLineLength && ClassAt(line, probe) == kInitialClass) {
+      last = probe;
+      probe = NextGrapheme(line, probe);
+    }
+
+    return TextPosition{position.line, last};
+  }
+
+  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
+  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
+}
+
+TextPosition BigWordEndInclusive(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+
+  while (position.line < buffer.LineCount()) {
+    const std::string_view line = buffer.GetLine(position.line);
+    const std::size_t kLineLength = line.size();
+
+    if (position.column >= kLineLength) {
+      if (position.line + 1 >= buffer.LineCount()) {
+        return TextPosition{position.line, kLineLength};
+      }
+      position.line += 1;
+      position.column = 0;
+      continue;
+    }
+
+    if (ClassAt(line, position.column) == kBlankClass) {
+      position.column = NextGrapheme(line, position.column);
+      continue;
+    }
+
+    std::size_t last = position.column;
+    std::size_t probe = NextGrapheme(line, last);
+    while (probe < kLineLength && ClassAt(line, probe) != kBlankClass) {
+      last = probe;
+      probe = NextGrapheme(line, probe);
+    }
+
+    return TextPosition{position.line, last};
+  }
+
+  const std::size_t kLastLineIndex = buffer.LineCount() - 1;
+  return TextPosition{kLastLineIndex, buffer.GetLine(kLastLineIndex).size()};
+}
+
+std::size_t FirstNonBlankColumn(std::string_view line) {
+  for (std::size_t i = 0; i < line.size(); ++i) {
+    if (std::isspace(static_cast<unsigned char>(line[i])) == 0) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+std::size_t LastNonBlankColumn(std::string_view line) {
+  if (line.empty()) {
+    return 0;
+  }
+
+  for (std::size_t i = line.size(); i-- > 0;) {
+    if (std::isspace(static_cast<unsigned char>(line[i])) == 0) {
+      return GraphemeStart(line, i);
+    }
+  }
+
+  return 0;
+}
+
+TextPosition FirstNonBlankPosition(const Buffer& buffer, std::size_t line) {
+  if (buffer.LineCount() == 0) {
+    return TextPosition{};
+  }
+  line = (std::min)(line, buffer.LineCount() - 1);
+  const std::string_view text = buffer.GetLine(line);
+  return TextPosition{line, FirstNonBlankColumn(text)};
+}
+
+TextPosition LastNonBlankPosition(const Buffer& buffer, std::size_t line) {
+  if (buffer.LineCount() == 0) {
+    return TextPosition{};
+  }
+  line = (std::min)(line, buffer.LineCount() - 1);
+  const std::string_view text = buffer.GetLine(line);
+  const std::size_t kColumn = LastNonBlankColumn(text);
+  return TextPosition{line, kColumn};
+}
+
+TextPosition NextParagraphStart(const Buffer& buffer, TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+
+  const std::size_t kTotalLines = buffer.LineCount();
+  std::size_t line = position.line;
+
+  bool in_blank = IsBlankLine(buffer.GetLine(line));
+  while (line + 1 < kTotalLines) {
+    ++line;
+    const bool kCurrentBlank = IsBlankLine(buffer.GetLine(line));
+    if (!kCurrentBlank && in_blank) {
+      return TextPosition{line, FirstNonBlankColumn(buffer.GetLine(line))};
+    }
+    in_blank = kCurrentBlank;
+  }
+
+  return TextPosition{kTotalLines - 1, buffer.GetLine(kTotalLines - 1).size()};
+}
+
+TextPosition PreviousParagraphStart(const Buffer& buffer,
+                                    TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+
+  std::size_t line = position.line;
+  bool in_blank = IsBlankLine(buffer.GetLine(line));
+
+  while (line > 0) {
+    --line;
+    const bool kCurrentBlank = IsBlankLine(buffer.GetLine(line));
+    if (!kCurrentBlank && in_blank) {
+      return TextPosition{line, FirstNonBlankColumn(buffer.GetLine(line))};
+    }
+    in_blank = kCurrentBlank;
+  }
+
+  return TextPosition{0, 0};
+}
+
+TextPosition ParagraphEndInclusive(const Buffer& buffer,
+                                   TextPosition position) {
+  if (buffer.LineCount() == 0) {
+    return position;
+  }
+
+  position = ClampPosition(buffer, position);
+  std::size_t line = position.line;
+  const std::size_t kTotalLines = buffer.LineCount();
+
+  while (line < kTotalLines) {
+    const bool kBlank = IsBlankLine(buffer.GetLine(line));
+    if (kBlank) {
+      if (line == 0) {
+        return TextPosition{0, 0};
+      }
+      return LastNonBlankPosition(buffer, line - 1);
+    }
+    if (line + 1 >= kTotalLines) {
+      return LastNonBlankPosition(buffer, line);
+    }
+    line += 1;
+  }
+
+  return LastNonBlankPosition(buffer, kTotalLines - 1);
+}
+
+std::optional<std::size_t> FindInLine(std::string_view line,
+                                      std::size_t column,
+                                      const FindTarget& find,
+                                      std::size_t count) {
+  std::size_t position = column;
+  for (; count > 0; --count) {
+    if (find.backward) {
+      position = position == 0 ? std::string_view::npos
+                               : line.rfind(find.target, position - 1);
+    } else {
+      position = line.find(find.target, position + 1);
+    }
+    if (position == std::string_view::npos) {
+      return std::nullopt;
+    }
+  }
+  if (!find.till) {
+    return position;
+  }
+  return find.backward ? NextGrapheme(line, position)
+                       : GraphemeStart(line, position - 1);
+}
+
+std::optional<MotionResult> LeftMotion::Apply(MotionContext& context,
+                                              TextPosition from,
+                                              std::size_t count,
+                                              char /*operand*/) {
+  const std::string_view kLine = context.buffer.GetLine(from.line);
+  std::size_t column = (std::min)(from.column, kLine.size());
+  for (std::size_t i = Times(count); i > 0 && column > 0; --i) {
+    column = GraphemeStart(kLine, column - 1);
+  }
+  return MotionResult{from, {from.line, column}, MotionKind::kExclusive};
+}
+
+std::optional<MotionResult> RightMotion::Apply(MotionContext& context,
+                                               TextPosition from,
+                                               std::size_t count,
+                                               char /*operand*/) {
+  const std::string_view kLine = context.buffer.GetLine(from.line);
+  return MotionResult{from,
+                      {from.line, SkipGraphemes(kLine, from.column,
+                                                Times(count))},
+                      MotionKind::kExclusive};
+}
+
+std::optional<MotionResult> DownMotion::Apply(MotionContext& context,
+                                              TextPosition from,
+                                              std::size_t count,
+                                              char /*operand*/) {
+  const std::size_t kLast = context.buffer.LineCount() - 1;
+  const std::size_t kLine =
+      from.line +
+      (std::min)(Times(count), kLast - (std::min)(from.line, kLast));
+  return MotionResult{from, {kLine, 0}, MotionKind::kLinewise};
+}
+
+std::optional<MotionResult> UpMotion::Apply(MotionContext& /*context*/,
+                                            TextPosition from,
+                                            std::size_t count,
+                                            char /*operand*/) {
+  return MotionResult{from,
+                      {from.line - (std::min)(Times(count), from.line), 0},
+                      MotionKind::kLinewise};
+}
+
+std::optional<MotionResult> LineMotion::Apply(MotionContext& context,
+                                              TextPosition from,
+                                              std::size_t count,
+                                              char /*operand*/) {
+  const std::size_t kLast = context.buffer.LineCount() - 1;
+  const std::size_t kLine =
+      from.line +
+      (std::min)(Times(count) - 1, kLast - (std::min)(from.line, kLast));
+  const TextPosition kTo = FirstNonBlankPosition(context.buffer, kLine);
+  return MotionResult{from, kTo, MotionKind::kLinewise};
+}
+
+std::optional<MotionResult> LineStartMotion::Apply(
+    MotionContext& /*context*/, TextPosition from, std::size_t /*count*/,
+    char /*operand*/) {
+  return MotionResult{from, {from.line, 0}, MotionKind::kExclusive};
+}
+
+std::optional<MotionResult> FirstNonBlankMotion::Apply(
+    MotionContext& context, TextPosition from, std::size_t /*count*/,
+    char /*operand*/) {
+  return MotionResult{from, FirstNonBlankPosition(context.buffer, from.line),
+                      MotionKind::kExclusive};
+}
+
+std::optional<MotionResult> LineEndMotion::Apply(MotionContext& context,
+                                                 TextPosition from,
+                                                 std::size_t count,
+                                                 char /*operand*/) {
+  const std::size_t kLast = context.buffer.LineCount() - 1;
+  const std::size_t kLine =
+      from.line +
+      (std::min)(Times(count) - 1, kLast - (std::min)(from.line, kLast));
+  const std::string_view kText = context.buffer.GetLine(kLine);
+  const std::size_t kColumn =
+      kText.empty() ? 0 : GraphemeStart(kText, kText.size() - 1);
+  return MotionResult{from, {kLine, kColumn}, MotionKind::kInclusive};
+}
+
+std::optional<MotionResult> WordMotion::Apply(MotionContext& context,
+                                              TextPosition from,
+                                              std::size_t count,
+                                              char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kExclusive,
+                NextWordStart);
+}
+
+std::optional<MotionResult> BigWordMotion::Apply(MotionContext& context,
+                                                 TextPosition from,
+                                                 std::size_t count,
+                                                 char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kExclusive,
+                NextBigWordStart);
+}
+
+std::optional<MotionResult> WordBackMotion::Apply(MotionContext& context,
+                                                  TextPosition from,
+                                                  std::size_t count,
+                                                  char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kExclusive,
+                PreviousWordStart);
+}
+
+std::optional<MotionResult> BigWordBackMotion::Apply(MotionContext& context,
+                                                     TextPosition from,
+                                                     std::size_t count,
+                                                     char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kExclusive,
+                PreviousBigWordStart);
+}
+
+std::optional<MotionResult> WordEndMotion::Apply(MotionContext& context,
+                                                 TextPosition from,
+                                                 std::size_t count,
+                                                 char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kInclusive,
+                WordEndInclusive);
+}
+
+std::optional<MotionResult> BigWordEndMotion::Apply(MotionContext& context,
+                                                    TextPosition from,
+                                                    std::size_t count,
+                                                    char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kInclusive,
+                BigWordEndInclusive);
+}
+
+std::optional<MotionResult> ParagraphForwardMotion::Apply(
+    MotionContext& context, TextPosition from, std::size_t count,
+    char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kExclusive,
+                NextParagraphStart);
+}
+
+std::optional<MotionResult> ParagraphBackMotion::Apply(
+    MotionContext& context, TextPosition from, std::size_t count,
+    char /*operand*/) {
+  return Repeat(context.buffer, from, count, MotionKind::kExclusive,
+                PreviousParagraphStart);
+}
+
+std::optional<MotionResult> FirstLineMotion::Apply(MotionContext& context,
+                                                   TextPosition from,
+                                                   std::size_t count,
+                                                   char /*operand*/) {
+  context.buffer.FinishIndexing(Times(count));
+  const std::size_t kLine =
+      (std::min)(Times(count), context.buffer.LineCount()) - 1;
+  return MotionResult{from, {kLine, 0}, MotionKind::kLinewise};
+}
+
+std::optional<MotionResult> GoToLineMotion::Apply(MotionContext& context,
+                                                  TextPosition from,
+                                                  std::size_t count,
+                                                  char /*operand*/) {
+  // The last line is only known once every line has been found.
+  context.buffer.FinishIndexing(count == 0 ? SIZE_MAX : count);
+  const std::size_t kLines = context.buffer.LineCount();
+  const std::size_t kLine = (count == 0 ? kLines : (std::min)(count, kLines));
+  return MotionResult{from, {kLine - 1, 0}, MotionKind::kLinewise};
+}
+
+template <bool kBackward, bool kTill>
+std::optional<MotionResult> FindMotion<kBackward, kTill>::Apply(
+    MotionContext& context, TextPosition from, std::size_t count,
+    char operand) {
+  const FindTarget kFind{operand, kBackward, kTill};
+  std::optional<MotionResult> result = Find(context, from, kFind, count);
+  if (result) {
+    context.last_find = kFind;
+  }
+  return result;
+}
+
+template <bool kReverse>
+std::optional<MotionResult> RepeatFindMotion<kReverse>::Apply(
+    MotionContext& context, TextPosition from, std::size_t count,
+    char /*operand*/) {
+  if (!context.last_find) {
+    context.failure = "No previous find";
+    return std::nullopt;
+  }
+  FindTarget find = *context.last_find;
+  find.backward = find.backward != kReverse;
+  return Find(context, from, find, count);
+}
+
+template struct FindMotion<false, false>;
+template struct FindMotion<false, true>;
+template struct FindMotion<true, false>;
+template struct FindMotion<true, true>;
+template struct RepeatFindMotion<false>;
+template struct RepeatFindMotion<true>;
+}  // namespace core
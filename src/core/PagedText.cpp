@@ -0,0 +1,325 @@
+#include "core/PagedText.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace {
+using core::WindowedFile;
+
+constexpr std::size_t kReadBytes = WindowedFile::kReadBytes;
+// What a line start is first looked for in before it, going backwards; most
+// lines are shorter.
+constexpr std::size_t kBackStepBytes = 4096;
+
+std::size_t FindBreak(std::string_view text, std::size_t from = 0) {
+  if (from >= text.size()) {
+    return std::string_view::npos;
+  }
+  const void* kFound =
+      std::memchr(text.data() + from, '\n', text.size() - from);
+  return kFound == nullptr
+             ? std::string_view::npos
+             : static_cast<std::size_t>(static_cast<const char*>(kFound) -
+                                        text.data());
+}
+}  // namespace
+
+namespace core {
+PagedText::~PagedText() {
+  if (scanner_.joinable()) {
+    scanner_.request_stop();
+    scanner_.join();
+  }
+}
+
+bool PagedText::Open(const std::string& file_path, std::size_t sync_lines) {
+  if (!file_.Open(file_path)) {
+    return false;
+  }
+  path_ = file_path;
+  size_ = file_.Size();
+
+  // Like DetectLineEnding() for a loaded file, within the first read.
+  const std::string_view kHead = file_.Read(0, kReadBytes);
+  const std::size_t kBreak = FindBreak(kHead);
+  line_ending_ = kBreak != std::string_view::npos && kBreak > 0 &&
+                         kHead[kBreak - 1] == '\r'
+                     ? LineEnding::kCrLf
+                     : LineEnding::kLf;
+  final_newline_ = size_ > 0 && file_.Read(size_ - 1, 1) == "\n";
+
+  checkpoints_.assign(1, 0);
+  scanner_ = std::jthread([this](const std::stop_token& token) { Run(token); });
+  Wait(sync_lines);
+  Sync();
+  return true;
+}
+
+bool PagedText::Sync() {
+  if (synced_) {
+    return false;
+  }
+  std::uint64_t breaks = 0;
+  bool finished = false;
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    breaks = breaks_found_;
+    finished = finished_.load();
+  }
+  // A last line without a line break is known only once the scan is done.
+  std::uint64_t lines = breaks;
+  if (finished && !final_newline_) {
+    ++lines;
+  }
+  line_count_ = static_cast<std::size_t>((std::max)(lines, std::uint64_t{1}));
+  synced_ = finished;
+  return finished;
+}
+
+void PagedText::Wait(std::size_t lines) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  found_changed_.wait(
+      lock, [&] { return finished_.load() || breaks_found_ >= lines; });
+}
+
+bool PagedText::IsScanning() const noexcept {
+  return !synced_;
+}
+
+std::size_t PagedText::LineCount() const noexcept {
+  return line_count_;
+}
+
+std::string_view PagedText::Line(std::size_t index) {
+  if (index >= line_count_) {
+    return {};
+  }
+  const std::size_t kBlock = index / kCheckpointLines;
+  const std::size_t kAt = index - kBlock * kCheckpointLines;
+  const Block& block = LoadBlock(kBlock);
+  if (kAt + 1 >= block.starts.size()) {
+    return {};
+  }
+  return LineText(block.starts[kAt], block.starts[kAt + 1] - 1, file_);
+}
+
+const std::string& PagedText::Path() const noexcept {
+  return path_;
+}
+
+std::uint64_t PagedText::Size() const noexcept {
+  return size_;
+}
+
+LineEnding PagedText::GetLineEnding() const noexcept {
+  return line_ending_;
+}
+
+bool PagedText::HasFinalNewline() const noexcept {
+  return final_newline_;
+}
+
+const TextStats& PagedText::Stats() const noexcept {
+  return stats_;
+}
+
+std::uint64_t PagedText::LineStart(std::size_t line,
+                                   WindowedFile& file) const {
+  std::size_t block = line / kCheckpointLines;
+  std::uint64_t offset = 0;
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    block = (std::min)(block, checkpoints_.size() - 1);
+    offset = checkpoints_[block];
+  }
+  for (std::size_t left = line - block * kCheckpointLines; left > 0;) {
+    const std::string_view kText = file.Read(offset, kReadBytes);
+    if (kText.empty()) {
+      return size_;
+    }
+    std::size_t at = 0;
+    while (left > 0 && (at = FindBreak(kText, at)) != std::string_view::npos) {
+      ++at;
+      --left;
+    }
+    offset += left == 0 ? at : kText.size();
+  }
+  return offset;
+}
+
+std::size_t PagedText::LineAt(std::uint64_t offset, WindowedFile& file) const {
+  std::size_t block = 0;
+  std::uint64_t position = 0;
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    const auto kAfter =
+        std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset);
+    block = static_cast<std::size_t>(kAfter - checkpoints_.begin()) - 1;
+    position = checkpoints_[block];
+  }
+  std::size_t line = block * kCheckpointLines;
+  while (position < offset) {
+    const std::string_view kText = file.Read(
+        position,
+        static_cast<std::size_t>((std::min)(std::uint64_t{kReadBytes},
+                                            offset - position)));
+    if (kText.empty()) {
+      break;
+    }
+    line += static_cast<std::size_t>(
+        std::count(kText.begin(), kText.end(), '\n'));
+    position += kText.size();
+  }
+  return line;
+}
+
+std::uint64_t PagedText::LineEnd(std::uint64_t start, WindowedFile& file,
+                                 std::uint64_t* next) const {
+  for (std::uint64_t offset = start; offset < size_;) {
+    const std::string_view kText = file.Read(offset, kReadBytes);
+    if (kText.empty()) {
+      break;
+    }
+    const std::size_t kBreak = FindBreak(kText);
+    if (kBreak != std::string_view::npos) {
+      if (next != nullptr) {
+        *next = offset + kBreak + 1;
+      }
+      return offset + kBreak;
+    }
+    offset += kText.size();
+  }
+  if (next != nullptr) {
+    *next = size_;
+  }
+  return size_;
+}
+
+std::uint64_t PagedText::LineStartAt(std::uint64_t offset,
+                                     WindowedFile& file) const {
+  std::uint64_t end = (std::min)(offset, size_);
+  std::size_t step = kBackStepBytes;
+  while (end > 0) {
+    const std::uint64_t kBegin = end - (std::min)(std::uint64_t{step}, end);
+    const std::string_view kText =
+        file.Read(kBegin, static_cast<std::size_t>(end - kBegin));
+    if (kText.empty()) {
+      break;
+    }
+    const std::size_t kBreak = kText.rfind('\n');
+    if (kBreak != std::string_view::npos) {
+      return kBegin + kBreak + 1;
+    }
+    end = kBegin;
+    step = kReadBytes;
+  }
+  return 0;
+}
+
+std::string_view PagedText::LineText(std::uint64_t start, std::uint64_t end,
+                                     WindowedFile& file) const {
+  if (end <= start) {
+    return {};
+  }
+  const bool kClipped = end - start > kMaxLineBytes;
+  std::string_view text = file.Read(
+      start, kClipped ? kMaxLineBytes : static_cast<std::size_t>(end - start));
+  if (!kClipped && line_ending_ == LineEnding::kCrLf &&
+      text.ends_with('\r')) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+std::size_t PagedText::MemoryUsage() const noexcept {
+  std::size_t bytes = sizeof(PagedText) + file_.MappedBytes();
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    bytes += checkpoints_.capacity() * sizeof(std::uint64_t);
+  }
+  for (const Block& block : blocks_) {
+    bytes += block.starts.capacity() * sizeof(std::uint64_t);
+  }
+  return bytes;
+}
+
+void PagedText::Run(const std::stop_token& token) {
+  WindowedFile file(1);
+  LineScanner scanner;
+  std::vector<std::uint64_t> starts;
+  if (file.Open(path_)) {
+    for (std::uint64_t offset = 0;
+         offset < size_ && !token.stop_requested();) {
+      const std::string_view kText = file.Read(offset, kReadBytes);
+      if (kText.empty()) {
+        break;
+      }
+      starts.clear();
+      scanner.Scan(kText, offset, starts);
+      offset += kText.size();
+      {
+        const std::lock_guard<std::mutex> kLock(mutex_);
+        for (const std::uint64_t kStart : starts) {
+          if (++breaks_found_ % kCheckpointLines == 0) {
+            checkpoints_.push_back(kStart);
+          }
+        }
+      }
+      found_changed_.notify_all();
+    }
+  }
+  scanner.Finish();
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    stats_ = scanner.Stats();
+    finished_.store(true);
+  }
+  found_changed_.notify_all();
+}
+
+std::uint64_t PagedText::Checkpoint(std::size_t block) const {
+  const std::lock_guard<std::mutex> kLock(mutex_);
+  return checkpoints_[(std::min)(block, checkpoints_.size() - 1)];
+}
+
+PagedText::Block& PagedText::LoadBlock(std::size_t block) {
+  Block* victim = &blocks_[0];
+  for (Block& cached : blocks_) {
+    if (cached.index == block) {
+      cached.last_used = ++use_clock_;
+      return cached;
+    }
+    if (cached.last_used < victim->last_used) {
+      victim = &cached;
+    }
+  }
+
+  // The block's starts follow from the file alone, so they need no scan
+  // beyond its checkpoint.
+  victim->index = block;
+  victim->last_used = ++use_clock_;
+  std::vector<std::uint64_t>& starts = victim->starts;
+  starts.clear();
+  std::uint64_t offset = Checkpoint(block);
+  starts.push_back(offset);
+  while (starts.size() <= kCheckpointLines && offset < size_) {
+    const std::string_view kText = file_.Read(offset, kReadBytes);
+    if (kText.empty()) {
+      break;
+    }
+    for (std::size_t at = 0; starts.size() <= kCheckpointLines &&
+                             (at = FindBreak(kText, at)) !=
+                                 std::string_view::npos;) {
+      ++at;
+      starts.push_back(offset + at);
+    }
+    offset += kText.size();
+  }
+  if (starts.size() <= kCheckpointLines && starts.back() < size_) {
+    starts.push_back(size_ + 1);
+  }
+  return *victim;
+}
+}  // namespace core
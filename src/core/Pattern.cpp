@@ -0,0 +1,670 @@
+#include "core/Pattern.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr std::size_t kMaxNesting = 200;
+
+struct Thread {
+  std::uint32_t pc = 0;
+  std::size_t start = 0;
+};
+
+// Per-thread simulation state, reused across calls so scanning a file line by
+// line does not allocate.
+struct Scratch {
+  std::vector<Thread> current;
+  std::vector<Thread> next;
+  std::vector<std::uint64_t> seen;
+  std::vector<std::uint32_t> stack;
+  std::uint64_t generation = 0;
+};
+
+bool IsWordByte(unsigned char value) {
+  return (value >= 'a' && value <= 'z') || (value >= 'A' && value <= 'Z') ||
+         (value >= '0' && value <= '9') || value == '_';
+}
+
+bool IsSpaceByte(unsigned char value) {
+  return value == ' ' || value == '\t' || value == '\r' || value == '\v' ||
+         value == '\f';
+}
+
+// Fills `bytes` for the \d \w \s escapes and their negations.
+bool EscapeClass(char escape, std::bitset<256>& bytes) {
+  bool negate = false;
+  bool (*test)(unsigned char) = nullptr;
+  switch (escape) {
+    case 'D':
+      negate = true;
+      [[fallthrough]];
+    case 'd':
+      test = [](unsigned char value) { return value >= '0' && value <= '9'; };
+      break;
+    case 'W':
+      negate = true;
+      [[fallthrough]];
+    case 'w':
+      test = IsWordByte;
+      break;
+    case 'S':
+      negate = true;
+      [[fallthrough]];
+    case 's':
+      test = IsSpaceByte;
+      break;
+    default:
+      return false;
+  }
+  for (std::size_t value = 0; value < bytes.size(); ++value) {
+    if (test(static_cast<unsigned char>(value)) != negate) {
+      bytes.set(value);
+    }
+  }
+  return true;
+}
+
+char EscapedByte(char escape) {
+  return escape == 't' ? '\t' : escape;
+}
+}  // namespace
+
+namespace core {
+class Pattern::Compiler {
+ public:
+  Compiler(std::string_view source, Pattern& pattern)
+      : source_(source), pattern_(pattern) {}
+
+  bool Run(std::string& error) {
+    Node root;
+    if (!ParseAlternation(root, 0)) {
+      error = error_;
+      return false;
+    }
+    if (position_ < source_.size()) {
+      error = "Unmatched )";
+      return false;
+    }
+
+    pattern_.literal_.clear();
+    pattern_.is_literal_ = CollectLiteral(root, pattern_.literal_) &&
+                           !pattern_.literal_.empty();
+    Emit(root);
+    pattern_.program_.push_back({.op = Op::kMatch});
+    return true;
+  }
+
+ private:
+  struct Node {
+    enum class Kind : std::uint8_t {
+      kEmpty,
+      kByte,
+      kAny,
+      kClass,
+      kLineStart,
+      kLineEnd,
+      kConcat,
+      kAlternate,
+      kStar,
+      kPlus,
+      kQuestion,
+    };
+
+    Kind kind = Kind::kEmpty;
+    unsigned char byte = 0;
+    std::uint32_t class_index = 0;
+    std::vector<Node> children;
+  };
+
+  static bool IsRepeat(Node::Kind kind) noexcept {
+    return kind == Node::Kind::kStar || kind == Node::Kind::kPlus ||
+           kind == Node::Kind::kQuestion;
+  }
+
+  bool Fail(const char* message) {
+    error_ = message;
+    return false;
+  }
+
+  bool AtEnd() const noexcept { return position_ >= source_.size(); }
+  char Peek() const noexcept { return source_[position_]; }
+
+  bool ParseAlternation(Node& node, std::size_t depth) {
+    if (depth > kMaxNesting) {
+      return Fail("Pattern nested too deeply");
+    }
+
+    Node branch;
+    if (!ParseConcat(branch, depth)) {
+      return false;
+    }
+    if (AtEnd() || Peek() != '|') {
+      node = std::move(branch);
+      return true;
+    }
+
+    node.kind = Node::Kind::kAlternate;
+    node.children.push_back(std::move(branch));
+    while (!AtEnd() && Peek() == '|') {
+      ++position_;
+      Node next;
+      if (!ParseConcat(next, depth)) {
+        return false;
+      }
+      node.children.push_back(std::move(next));
+    }
+    return true;
+  }
+
+  bool ParseConcat(Node& node, std::size_t depth) {
+    node.kind = Node::Kind::kConcat;
+    while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+      Node item;
+      if (!ParseRepeat(item, depth)) {
+        return false;
+      }
+      node.children.push_back(std::move(item));
+    }
+    return true;
+  }
+
+  bool ParseRepeat(Node& node, std::size_t depth) {
+    if (!ParseAtom(node, depth)) {
+      return false;
+    }
+    while (!AtEnd() && (Peek() == '*' || Peek() == '+' || Peek() == '?')) {
+      Node repeated;
+      switch (Peek()) {
+        case '*':
+          repeated.kind = Node::Kind::kStar;
+          break;
+        case '+':
+          repeated.kind = Node::Kind::kPlus;
+          break;
+        default:
+          repeated.kind = Node::Kind::kQuestion;
+          break;
+      }
+      ++position_;
+      // Stacked quantifiers collapse, so a** cannot nest without bound.
+      if (IsRepeat(node.kind)) {
+        if (node.kind != repeated.kind) {
+          node.kind = Node::Kind::kStar;
+        }
+        continue;
+      }
+      repeated.children.push_back(std::move(node));
+      node = std::move(repeated);
+    }
+    return true;
+  }
+
+  bool ParseAtom(Node& node, std::size_t depth) {
+    const char kValue = Peek();
+    ++position_;
+    switch (kValue) {
+      case '(':
+        if (!ParseAlternation(node, depth + 1)) {
+          return false;
+        }
+        if (AtEnd() || Peek() != ')') {
+          return Fail("Unmatched (");
+        }
+        ++position_;
+        return true;
+      case '.':
+        node.kind = Node::Kind::kAny;
+        return true;
+      case '^':
+        node.kind = Node::Kind::kLineStart;
+        return true;
+      case '$':
+        node.kind = Node::Kind::kLineEnd;
+        return true;
+      case '[':
+        return ParseClass(node);
+      case '\\': {
+        if (AtEnd()) {
+          return Fail("Trailing \\");
+        }
+        const char kEscape = Peek();
+        ++position_;
+        std::bitset<256> bytes;
+        if (EscapeClass(kEscape, bytes)) {
+          AddClass(node, bytes);
+          return true;
+        }
+        node.kind = Node::Kind::kByte;
+        node.byte = static_cast<unsigned char>(EscapedByte(kEscape));
+        return true;
+      }
+      default:
+        // Like vi, a quantifier with nothing to repeat stands for itself.
+        node.kind = Node::Kind::kByte;
+        node.byte = static_cast<unsigned char>(kValue);
+        return true;
+    }
+  }
+
+  bool ParseClass(Node& node) {
+    std::bitset<256> bytes;
+    bool negate = false;
+    if (!AtEnd() && Peek() == '^') {
+      negate = true;
+      ++position_;
+    }
+
+    bool first = true;
+    while (true) {
+      if (AtEnd()) {
+        return Fail("Unmatched [");
+      }
+      char value = Peek();
+      ++position_;
+      if (value == ']' && !first) {
+        break;
+      }
+      first = false;
+
+      if (value == '\\' && !AtEnd()) {
+        const char kEscape = Peek();
+        ++position_;
+        if (EscapeClass(kEscape, bytes)) {
+          continue;
+        }
+        value = EscapedByte(kEscape);
+      }
+
+      auto low = static_cast<unsigned char>(value);
+      auto high = low;
+      if (position_ + 1 < source_.size() && Peek() == '-' &&
+          source_[position_ + 1] != ']') {
+        high = static_cast<unsigned char>(source_[position_ + 1]);
+        position_ += 2;
+        if (high < low) {
+          return Fail("Invalid range in []");
+        }
+      }
+      for (unsigned int byte = low; byte <= high; ++byte) {
+        bytes.set(byte);
+      }
+    }
+
+    if (negate) {
+      bytes.flip();
+    }
+    AddClass(node, bytes);
+    return true;
+  }
+
+  void AddClass(Node& node, const std::bitset<256>& bytes) {
+    node.kind = Node::Kind::kClass;
+    node.class_index = static_cast<std::uint32_t>(pattern_.classes_.size());
+    pattern_.classes_.push_back(bytes);
+  }
+
+  static bool CollectLiteral(const Node& node, std::string& literal) {
+    switch (node.kind) {
+      case Node::Kind::kByte:
+        literal.push_back(static_cast<char>(node.byte));
+        return true;
+      case Node::Kind::kConcat:
+        return std::all_of(
+            node.children.begin(), node.children.end(),
+            [&literal](const Node& child) {
+              return CollectLiteral(child, literal);
+            });
+      default:
+        return false;
+    }
+  }
+
+  std::uint32_t Here() const noexcept {
+    return static_cast<std::uint32_t>(pattern_.program_.size());
+  }
+
+  std::uint32_t Push(Instruction instruction) {
+    pattern_.program_.push_back(instruction);
+    return Here() - 1;
+  }
+
+  void Emit(const Node& node) {
+    std::vector<Instruction>& program = pattern_.program_;
+    switch (node.kind) {
+      case Node::Kind::kEmpty:
+        return;
+      case Node::Kind::kByte:
+        Push({.op = Op::kByte, .byte = node.byte});
+        return;
+      case Node::Kind::kAny:
+        Push({.op = Op::kAny});
+        return;
+      case Node::Kind::kClass:
+        Push({.op = Op::kClass, .next = node.class_index});
+        return;
+      case Node::Kind::kLineStart:
+        Push({.op = Op::kLineStart});
+        return;
+      case Node::Kind::kLineEnd:
+        Push({.op = Op::kLineEnd});
+        return;
+      case Node::Kind::kConcat:
+        for (const Node& child : node.children) {
+          Emit(child);
+        }
+        return;
+      case Node::Kind::kAlternate: {
+        // split L1, L2; L1: a; jump end; L2: split ... ; end:
+        std::vector<std::uint32_t> jumps;
+        for (std::size_t i = 0; i + 1 < node.children.size(); ++i) {
+          const std::uint32_t kSplit = Push({.op = Op::kSplit});
+          program[kSplit].next = Here();
+          Emit(node.children[i]);
+          jumps.push_back(Push({.op = Op::kJump}));
+          program[kSplit].alternate = Here();
+        }
+        Emit(node.children.back());
+        for (const std::uint32_t kJump : jumps) {
+          program[kJump].next = Here();
+        }
+        return;
+      }
+      case Node::Kind::kStar: {
+        const std::uint32_t kSplit = Push({.op = Op::kSplit});
+        program[kSplit].next = Here();
+        Emit(node.children.front());
+        Push({.op = Op::kJump, .next = kSplit});
+        program[kSplit].alternate = Here();
+        return;
+      }
+      case Node::Kind::kPlus: {
+        const std::uint32_t kStart = Here();
+        Emit(node.children.front());
+        Push({.op = Op::kSplit, .next = kStart, .alternate = Here() + 1});
+        return;
+      }
+      case Node::Kind::kQuestion: {
+        const std::uint32_t kSplit = Push({.op = Op::kSplit});
+        program[kSplit].next = Here();
+        Emit(node.children.front());
+        program[kSplit].alternate = Here();
+        return;
+      }
+    }
+  }
+
+  std::string_view source_;
+  Pattern& pattern_;
+  std::size_t position_ = 0;
+  const char* error_ = "";
+};
+
+bool Pattern::Compile(std::string_view source, std::string& error) {
+  source_.assign(source);
+  literal_.clear();
+  is_literal_ = false;
+  program_.clear();
+  classes_.clear();
+  has_first_bytes_ = false;
+
+  if (source.empty()) {
+    error = "Empty pattern";
+    return false;
+  }
+  Compiler compiler(source, *this);
+  if (!compiler.Run(error)) {
+    program_.clear();
+    return false;
+  }
+  ComputeFirstBytes();
+  return true;
+}
+
+const std::string& Pattern::Source() const noexcept {
+  return source_;
+}
+
+bool Pattern::IsLiteral() const noexcept {
+  return is_literal_;
+}
+
+bool Pattern::Find(std::string_view line, std::size_t from,
+                   PatternMatch& match) const {
+  if (from > line.size() || program_.empty()) {
+    return false;
+  }
+  if (!is_literal_) {
+    return FindRegex(line, from, match);
+  }
+
+  const std::size_t kStart = FindLiteral(line, from);
+  if (kStart == std::string_view::npos) {
+    return false;
+  }
+  match = {kStart, literal_.size()};
+  return true;
+}
+
+bool Pattern::FindLast(std::string_view line, std::size_t before,
+                       PatternMatch& match) const {
+  if (before == 0 || program_.empty()) {
+    return false;
+  }
+  if (is_literal_) {
+    const std::size_t kStart = line.rfind(literal_, before - 1);
+    if (kStart == std::string_view::npos) {
+      return false;
+    }
+    match = {kStart, literal_.size()};
+    return true;
+  }
+
+  bool found = false;
+  PatternMatch candidate;
+  std::size_t from = 0;
+  while (from <= line.size() && Find(line, from, candidate) &&
+         candidate.start < before) {
+    match = candidate;
+    found = true;
+    from = candidate.start + 1;
+  }
+  return found;
+}
+
+std::size_t Pattern::FindLiteral(std::string_view text,
+                                 std::size_t from) const noexcept {
+  const std::size_t kLength = literal_.size();
+  if (kLength == 0 || from > text.size() || text.size() - from < kLength) {
+    return std::string_view::npos;
+  }
+
+  // memchr is vectorized by the C library; only candidates whose first byte
+  // matches are compared in full.
+  const char* const kBegin = text.data();
+  const char* const kLast = kBegin + (text.size() - kLength);
+  const char* cursor = kBegin + from;
+  while (cursor <= kLast) {
+    const void* kFound =
+        std::memchr(cursor, literal_.front(),
+                    static_cast<std::size_t>(kLast - cursor) + 1);
+    if (kFound == nullptr) {
+      break;
+    }
+    const char* const kCandidate = static_cast<const char*>(kFound);
+    if (std::memcmp(kCandidate + 1, literal_.data() + 1, kLength - 1) == 0) {
+      return static_cast<std::size_t>(kCandidate - kBegin);
+    }
+    cursor = kCandidate + 1;
+  }
+  return std::string_view::npos;
+}
+
+bool Pattern::FindRegex(std::string_view line, std::size_t from,
+                        PatternMatch& match) const {
+  thread_local Scratch scratch;
+  if (scratch.seen.size() < program_.size()) {
+    scratch.seen.assign(program_.size(), 0);
+    scratch.generation = 0;
+  }
+
+  const std::size_t kSize = line.size();
+  // Follows empty transitions from `pc`, adding the threads that wait on a
+  // byte (or match) to `list`. Each instruction joins a list at most once,
+  // and the first thread to claim it has the earliest start.
+  auto add_thread = [&](std::vector<Thread>& list, std::uint32_t pc,
+                        std::size_t start, std::size_t position) {
+    scratch.stack.clear();
+    scratch.stack.push_back(pc);
+    while (!scratch.stack.empty()) {
+      const std::uint32_t kPc = scratch.stack.back();
+      scratch.stack.pop_back();
+      if (scratch.seen[kPc] == scratch.generation) {
+        continue;
+      }
+      scratch.seen[kPc] = scratch.generation;
+
+      const Instruction& instruction = program_[kPc];
+      switch (instruction.op) {
+        case Op::kJump:
+          scratch.stack.push_back(instruction.next);
+          break;
+        case Op::kSplit:
+          scratch.stack.push_back(instruction.alternate);
+          scratch.stack.push_back(instruction.next);
+          break;
+        case Op::kLineStart:
+          if (position == 0) {
+            scratch.stack.push_back(kPc + 1);
+          }
+          break;
+        case Op::kLineEnd:
+          if (position == kSize) {
+            scratch.stack.push_back(kPc + 1);
+          }
+          break;
+        default:
+          list.push_back({kPc, start});
+          break;
+      }
+    }
+  };
+
+  bool found = false;
+  std::size_t best_start = 0;
+  std::size_t best_end = 0;
+  scratch.current.clear();
+  ++scratch.generation;
+
+  for (std::size_t position = from;; ++position) {
+    if (!found) {
+      if (scratch.current.empty() && has_first_bytes_) {
+        while (position < kSize &&
+               !first_bytes_[static_cast<unsigned char>(line[position])]) {
+          ++position;
+        }
+        if (position == kSize) {
+          break;
+        }
+      }
+      add_thread(scratch.current, 0, position, position);
+    }
+    if (scratch.current.empty()) {
+      break;
+    }
+
+    ++scratch.generation;
+    scratch.next.clear();
+    for (const Thread& thread : scratch.current) {
+      if (found && thread.start > best_start) {
+        continue;
+      }
+      const Instruction& instruction = program_[thread.pc];
+      if (instruction.op == Op::kMatch) {
+        if (!found || thread.start < best_start ||
+            (thread.start == best_start && position > best_end)) {
+          found = true;
+          best_start = thread.start;
+          best_end = position;
+        }
+        continue;
+      }
+      if (position < kSize &&
+          Accepts(instruction, static_cast<unsigned char>(line[position]))) {
+        add_thread(scratch.next, thread.pc + 1, thread.start, position + 1);
+      }
+    }
+    std::swap(scratch.current, scratch.next);
+    if (position >= kSize) {
+      break;
+    }
+  }
+
+  if (found) {
+    match = {best_start, best_end - best_start};
+  }
+  return found;
+}
+
+bool Pattern::Accepts(const Instruction& instruction,
+                      unsigned char value) const {
+  switch (instruction.op) {
+    case Op::kByte:
+      return instruction.byte == value;
+    case Op::kAny:
+      return true;
+    case Op::kClass:
+      return classes_[instruction.next][value];
+    default:
+      return false;
+  }
+}
+
+void Pattern::ComputeFirstBytes() {
+  first_bytes_.reset();
+  std::vector<bool> visited(program_.size(), false);
+  std::vector<std::uint32_t> stack{0};
+  while (!stack.empty()) {
+    const std::uint32_t kPc = stack.back();
+    stack.pop_back();
+    if (visited[kPc]) {
+      continue;
+    }
+    visited[kPc] = true;
+
+    const Instruction& instruction = program_[kPc];
+    switch (instruction.op) {
+      case Op::kByte:
+        first_bytes_.set(instruction.byte);
+        break;
+      case Op::kClass:
+        first_bytes_ |= classes_[instruction.next];
+        break;
+      case Op::kJump:
+        stack.push_back(instruction.next);
+        break;
+      case Op::kSplit:
+        stack.push_back(instruction.next);
+        stack.push_back(instruction.alternate);
+        break;
+      case Op::kLineStart:
+      case Op::kLineEnd:
+        stack.push_back(kPc + 1);
+        break;
+      case Op::kAny:
+      case Op::kMatch:
+        // Any byte, or none at all, can begin a match.
+        has_first_bytes_ = false;
+        return;
+    }
+  }
+  has_first_bytes_ = true;
+}
+}  // namespace core
@@ -0,0 +1,659 @@
+#include "core/PieceTable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace {
+constexpr std::size_t kArenaBlockSize = 64 * 1024;
+constexpr std::size_t kEditSlack = 16;
+}  // namespace
+
+namespace core {
+PieceTable::PieceTable() : sources_(std::make_shared<Sources>()) {}
+
+void PieceTable::Load(std::string_view original,
+                      std::shared_ptr<const void> owner) {
+  Clear();
+  sources_->original = original;
+  sources_->owner = std::move(owner);
+}
+
+void PieceTable::Clear() {
+  sources_ = std::make_shared<Sources>();
+  block_cursor_ = nullptr;
+  block_end_ = nullptr;
+  tail_line_ = 0;
+  has_tail_line_ = false;
+  nodes_.clear();
+  free_nodes_.clear();
+  root_ = kNil;
+}
+
+void PieceTable::AppendOriginalLines(std::span<const std::uint64_t> starts) {
+  if (starts.empty()) {
+    return;
+  }
+  const std::size_t kFirst = sources_->line_starts.size() - 1;
+  std::vector<std::uint64_t>& line_starts = sources_->line_starts;
+  line_starts.insert(line_starts.end(), starts.begin(), starts.end());
+  ExtendOriginal(kFirst, starts.size());
+}
+
+void PieceTable::FinishOriginal() {
+  // Every line is addressed as [start, next_start - 1). A final line without
+  // a terminating newline gets a sentinel one past the end of the text.
+  if (sources_->line_starts.back() == sources_->original.size()) {
+    return;
+  }
+  const std::size_t kFirst = sources_->line_starts.size() - 1;
+  sources_->line_starts.push_back(sources_->original.size() + 1);
+  ExtendOriginal(kFirst, 1);
+}
+
+std::span<const std::uint64_t> PieceTable::OriginalLineStarts(
+    std::shared_ptr<const void>& owner) const {
+  owner = sources_;
+  std::span<const std::uint64_t> starts(sources_->line_starts);
+  starts = starts.subspan(1);
+  if (!starts.empty() && starts.back() > sources_->original.size()) {
+    // FinishOriginal()'s sentinel.
+    starts = starts.first(starts.size() - 1);
+  }
+  return starts;
+}
+
+void PieceTable::DetachOriginal() {
+  auto copy = std::make_shared<const std::string>(sources_->original);
+  sources_->original = *copy;
+  sources_->owner = std::move(copy);
+}
+
+void PieceTable::SetLineEnding(LineEnding ending) noexcept {
+  sources_->line_ending = ending;
+}
+
+std::size_t PieceTable::LineCount() const noexcept {
+  return Lines(root_);
+}
+
+std::size_t PieceTable::MemoryUsage(bool count_original) const noexcept {
+  return (count_original ? sources_->original.size() : 0) +
+         sources_->line_starts.capacity() * sizeof(std::uint64_t) +
+         sources_->block_bytes +
+         sources_->added.capacity() * sizeof(AddedLine) +
+         nodes_.capacity() * sizeof(Node) +
+         free_nodes_.capacity() * sizeof(NodeIndex);
+}
+
+std::string_view PieceTable::Line(std::size_t index) const {
+  if (index >= LineCount()) {
+    throw std::out_of_range("line index out of range");
+  }
+  const Location kLocation = Locate(index);
+  return sources_->Line(nodes_[kLocation.node].piece, kLocation.offset);
+}
+
+void PieceTable::InsertLine(std::size_t index, std::string_view text) {
+  InsertLines(index, std::span<const std::string_view>(&text, 1));
+}
+
+void PieceTable::InsertLines(std::size_t index,
+                             std::span<const std::string_view> lines) {
+  if (lines.empty()) {
+    return;
+  }
+
+  // Arena lines appended back to back have consecutive numbers; like
+  // ReplaceLine, the texts may alias lines already in the arena.
+  const std::size_t kFirst = sources_->added.size();
+  for (const std::string_view kText : lines) {
+    const std::size_t kAdded = AppendLine(kText.size(), kEditSlack);
+    if (!kText.empty()) {
+      std::memcpy(sources_->added[kAdded].data, kText.data(), kText.size());
+    }
+  }
+
+  const NodeIndex kNode =
+      NewNode(Piece{Source::kAdded, kFirst, lines.size()});
+  NodeIndex left = kNil;
+  NodeIndex right = kNil;
+  Split(root_, index, left, right);
+  root_ = Merge(Merge(left, kNode), right);
+}
+
+void PieceTable::EraseLines(std::size_t index, std::size_t count) {
+  NodeIndex left = kNil;
+  NodeIndex rest = kNil;
+  NodeIndex middle = kNil;
+  NodeIndex right = kNil;
+  Split(root_, index, left, rest);
+  Split(rest, count, middle, right);
+  FreeTree(middle);
+  root_ = Merge(left, right);
+}
+
+LineSlice PieceTable::Extract(std::size_t index, std::size_t count) {
+  LineSlice slice;
+  NodeIndex left = kNil;
+  NodeIndex rest = kNil;
+  NodeIndex middle = kNil;
+  NodeIndex right = kNil;
+  Split(root_, index, left, rest);
+  Split(rest, count, middle, right);
+  CollectPieces(middle, slice.pieces_);
+  slice.lines_ = Lines(middle);
+  root_ = Merge(Merge(left, middle), right);
+
+  // The tail line is edited in place; once shared it must be copied first.
+  has_tail_line_ = false;
+  slice.sources_ = sources_;
+  return slice;
+}
+
+void PieceTable::InsertSlice(std::size_t index, const LineSlice& slice) {
+  if (slice.Empty()) {
+    return;
+  }
+
+  if (slice.sources_ != sources_) {
+    std::vector<std::string_view> lines;
+    lines.reserve(slice.LineCount());
+    slice.ForEachLine(
+        [&lines](std::string_view line) { lines.push_back(line); });
+    InsertLines(index, lines);
+    return;
+  }
+
+  NodeIndex inserted = kNil;
+  for (const Piece& piece : slice.pieces_) {
+    inserted = Merge(inserted, NewNode(piece));
+  }
+  NodeIndex left = kNil;
+  NodeIndex right = kNil;
+  Split(root_, index, left, right);
+  root_ = Merge(Merge(left, inserted), right);
+}
+
+void PieceTable::ReplaceLine(std::size_t index, std::string_view text) {
+  // The new text may alias the line being replaced; appending never moves
+  // existing arena bytes, so copying before the old piece is dropped is safe.
+  const std::size_t kAdded = AppendLine(text.size(), kEditSlack);
+  if (!text.empty()) {
+    std::memcpy(sources_->added[kAdded].data, text.data(), text.size());
+  }
+  EraseLines(index, 1);
+
+  const NodeIndex kNode = NewNode(Piece{Source::kAdded, kAdded, 1});
+  NodeIndex left = kNil;
+  NodeIndex right = kNil;
+  Split(root_, index, left, right);
+  root_ = Merge(Merge(left, kNode), right);
+}
+
+void PieceTable::InsertChar(std::size_t index, std::size_t column,
+                            char value) {
+  const std::size_t kLine = EditableLine(index);
+  const std::size_t kSize = sources_->added[kLine].size;
+  char* data = ReserveTail(kSize + 1);
+  std::memmove(data + column + 1, data + column, kSize - column);
+  data[column] = value;
+  sources_->added[kLine].size = kSize + 1;
+}
+
+void PieceTable::EraseChar(std::size_t index, std::size_t column) {
+  const std::size_t kLine = EditableLine(index);
+  AddedLine& line = sources_->added[kLine];
+  std::memmove(line.data + column, line.data + column + 1,
+               line.size - column - 1);
+  line.size -= 1;
+  block_cursor_ = line.data + line.size;
+}
+
+void PieceTable::ForEachRun(const RunVisitor& visit) const {
+  std::vector<NodeIndex> stack;
+  NodeIndex node = root_;
+  while (node != kNil || !stack.empty()) {
+    while (node != kNil) {
+      stack.push_back(node);
+      node = nodes_[node].left;
+    }
+    node = stack.back();
+    stack.pop_back();
+
+    const Piece& piece = nodes_[node].piece;
+    if (piece.source == Source::kOriginal) {
+      const std::uint64_t kBegin = sources_->line_starts[piece.first];
+      const std::uint64_t kEnd =
+          sources_->OriginalLineEnd(piece.first + piece.count - 1);
+      visit(sources_->original.substr(kBegin, kEnd - kBegin));
+    } else {
+      for (std::size_t i = 0; i < piece.count; ++i) {
+        visit(sources_->Line(piece, i));
+      }
+    }
+    node = nodes_[node].right;
+  }
+}
+
+TextSnapshot::Cursor TextSnapshot::Locate(std::size_t line) const {
+  const auto kRun = std::upper_bound(
+      runs.begin(), runs.end(), line,
+      [](std::size_t value, const Run& run) { return value < run.first_line; });
+  Cursor cursor;
+  cursor.run = static_cast<std::size_t>(kRun - runs.begin()) - 1;
+  cursor.line = line;
+  const std::string_view kText = runs[cursor.run].text;
+  for (std::size_t skipped = runs[cursor.run].first_line; skipped < line;
+       ++skipped) {
+    cursor.offset = kText.find('\n', cursor.offset) + 1;
+  }
+  return cursor;
+}
+
+std::string_view TextSnapshot::LineAt(const Cursor& cursor) const {
+  const Run& run = runs[cursor.run];
+  const std::size_t kEnd = run.text.find('\n', cursor.offset);
+  if (kEnd == std::string_view::npos) {
+    return run.text.substr(cursor.offset);
+  }
+  std::string_view line = run.text.substr(cursor.offset, kEnd - cursor.offset);
+  if (run.crlf && !line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  return line;
+}
+
+bool TextSnapshot::Next(Cursor& cursor) const {
+  const std::size_t kEnd = runs[cursor.run].text.find('\n', cursor.offset);
+  if (kEnd != std::string_view::npos) {
+    cursor.offset = kEnd + 1;
+  } else if (cursor.run + 1 < runs.size()) {
+    ++cursor.run;
+    cursor.offset = 0;
+  } else {
+    return false;
+  }
+  ++cursor.line;
+  return true;
+}
+
+TextSnapshot PieceTable::Snapshot(std::size_t split_line) {
+  // The tail line is edited in place, so it is frozen like an extracted one.
+  has_tail_line_ = false;
+
+  TextSnapshot snapshot;
+  snapshot.sources = sources_;
+  snapshot.owner = sources_->owner;
+  snapshot.line_count = LineCount();
+  const bool kCrLf = sources_->line_ending == LineEnding::kCrLf;
+
+  auto add_original = [&](std::size_t first, std::size_t count,
+                          std::size_t line) {
+    const std::uint64_t kBegin = sources_->line_starts[first];
+    const std::uint64_t kEnd = sources_->OriginalLineEnd(first + count - 1);
+    snapshot.runs.push_back({.text = sources_->original.substr(
+                                 kBegin, kEnd - kBegin),
+                             .first_line = line,
+                             .lines = count,
+                             .crlf = kCrLf});
+  };
+
+  std::size_t line = 0;
+  std::vector<Piece> pieces;
+  CollectPieces(root_, pieces);
+  for (const Piece& piece : pieces) {
+    if (piece.source == Source::kAdded) {
+      for (std::size_t i = 0; i < piece.count; ++i) {
+        snapshot.runs.push_back(
+            {.text = sources_->Line(piece, i), .first_line = line + i,
+             .lines = 1});
+      }
+    } else if (split_line > line && split_line < line + piece.count) {
+      const std::size_t kHead = split_line - line;
+      add_original(piece.first, kHead, line);
+      add_original(piece.first + kHead, piece.count - kHead, split_line);
+    } else {
+      add_original(piece.first, piece.count, line);
+    }
+    line += piece.count;
+  }
+
+  for (const TextSnapshot::Run& run : snapshot.runs) {
+    snapshot.bytes += run.text.size() + 1;
+  }
+  return snapshot;
+}
+
+PieceTable::NodeIndex PieceTable::NewNode(const Piece& piece) {
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+
+  Node node;
+  node.piece = piece;
+  node.priority = seed_;
+  node.lines = piece.count;
+
+  if (!free_nodes_.empty()) {
+    const NodeIndex kIndex = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[kIndex] = node;
+    return kIndex;
+  }
+
+  nodes_.push_back(node);
+  return static_cast<NodeIndex>(nodes_.size() - 1);
+}
+
+void PieceTable::FreeTree(NodeIndex node) {
+  if (node == kNil) {
+    return;
+  }
+  FreeTree(nodes_[node].left);
+  FreeTree(nodes_[node].right);
+  free_nodes_.push_back(node);
+}
+
+std::size_t PieceTable::Lines(NodeIndex node) const noexcept {
+  return node == kNil ? 0 : nodes_[node].lines;
+}
+
+void PieceTable::Update(NodeIndex node) noexcept {
+  Node& current = nodes_[node];
+  current.lines = Lines(current.left) + current.piece.count +
+                  Lines(current.right);
+}
+
+PieceTable::NodeIndex PieceTable::Merge(NodeIndex left, NodeIndex right) {
+  if (left == kNil) {
+    return right;
+  }
+  if (right == kNil) {
+    return left;
+  }
+
+  if (nodes_[left].priority > nodes_[right].priority) {
+    const NodeIndex kMerged = Merge(nodes_[left].right, right);
+    nodes_[left].right = kMerged;
+    Update(left);
+    return left;
+  }
+
+  const NodeIndex kMerged = Merge(left, nodes_[right].left);
+  nodes_[right].left = kMerged;
+  Update(right);
+  return right;
+}
+
+void PieceTable::Split(NodeIndex node, std::size_t count, NodeIndex& left,
+                       NodeIndex& right) {
+  NodeIndex tail = kNil;
+  SplitNodes(node, count, left, right, tail);
+  // A piece cut in two leaves its tail outside both trees. Merging it in as
+  // the leftmost node on the right gives it a fresh priority while keeping
+  // the heap order, as an insertion would.
+  if (tail != kNil) {
+    right = Merge(tail, right);
+  }
+}
+
+void PieceTable::SplitNodes(NodeIndex node, std::size_t count,
+                            NodeIndex& left, NodeIndex& right,
+                            NodeIndex& tail) {
+  if (node == kNil) {
+    left = kNil;
+    right = kNil;
+    return;
+  }
+
+  const std::size_t kLeftLines = Lines(nodes_[node].left);
+  const std::size_t kPieceLines = nodes_[node].piece.count;
+
+  if (count <= kLeftLines) {
+    NodeIndex inner_right = kNil;
+    SplitNodes(nodes_[node].left, count, left, inner_right, tail);
+    nodes_[node].left = inner_right;
+    Update(node);
+    right = node;
+    return;
+  }
+
+  if (count >= kLeftLines + kPieceLines) {
+    NodeIndex inner_left = kNil;
+    SplitNodes(nodes_[node].right, count - kLeftLines - kPieceLines,
+               inner_left, right, tail);
+    nodes_[node].right = inner_left;
+    Update(node);
+    left = node;
+    return;
+  }
+
+  // The boundary falls inside this node's piece: keep the head here and hand
+  // the tail back as a node of its own. Only existing subtrees are relinked
+  // below, so both sides stay heap-ordered.
+  const std::size_t kOffset = count - kLeftLines;
+  Piece piece = nodes_[node].piece;
+  piece.first += kOffset;
+  piece.count -= kOffset;
+  tail = NewNode(piece);
+
+  right = nodes_[node].right;
+  nodes_[node].piece.count = kOffset;
+  nodes_[node].right = kNil;
+  Update(node);
+  left = node;
+}
+
+bool PieceTable::CheckTree() const {
+  return root_ == kNil || CheckNode(root_, nodes_[root_].priority);
+}
+
+std::size_t PieceTable::TreeDepth() const {
+  return Depth(root_);
+}
+
+bool PieceTable::CheckNode(NodeIndex node, std::uint32_t bound) const {
+  if (node == kNil) {
+    return true;
+  }
+  const Node& current = nodes_[node];
+  return current.priority <= bound &&
+         current.lines ==
+             Lines(current.left) + current.piece.count + Lines(current.right) &&
+         CheckNode(current.left, current.priority) &&
+         CheckNode(current.right, current.priority);
+}
+
+std::size_t PieceTable::Depth(NodeIndex node) const {
+  if (node == kNil) {
+    return 0;
+  }
+  return 1 + (std::max)(Depth(nodes_[node].left), Depth(nodes_[node].right));
+}
+
+PieceTable::Location PieceTable::Locate(std::size_t index) const {
+  NodeIndex node = root_;
+  while (node != kNil) {
+    const Node& current = nodes_[node];
+    const std::size_t kLeftLines = Lines(current.left);
+    if (index < kLeftLines) {
+      node = current.left;
+      continue;
+    }
+    index -= kLeftLines;
+    if (index < current.piece.count) {
+      return Location{node, index};
+    }
+    index -= current.piece.count;
+    node = current.right;
+  }
+  return Location{};
+}
+
+void PieceTable::CollectPieces(NodeIndex node,
+                               std::vector<Piece>& pieces) const {
+  if (node == kNil) {
+    return;
+  }
+  CollectPieces(nodes_[node].left, pieces);
+  pieces.push_back(nodes_[node].piece);
+  CollectPieces(nodes_[node].right, pieces);
+}
+
+std::size_t PieceTable::AppendLine(std::size_t size, std::size_t reserve) {
+  const std::size_t kNeeded = size + reserve;
+  if (block_cursor_ == nullptr ||
+      static_cast<std::size_t>(block_end_ - block_cursor_) < kNeeded) {
+    const std::size_t kCapacity = (std::max)(kArenaBlockSize, kNeeded);
+    sources_->blocks.push_back(std::make_unique<char[]>(kCapacity));
+    sources_->block_bytes += kCapacity;
+    block_cursor_ = sources_->blocks.back().get();
+    block_end_ = block_cursor_ + kCapacity;
+  }
+
+  sources_->added.push_back(AddedLine{block_cursor_, size});
+  block_cursor_ += size;
+  tail_line_ = sources_->added.size() - 1;
+  has_tail_line_ = true;
+  return tail_line_;
+}
+
+char* PieceTable::ReserveTail(std::size_t size) {
+  AddedLine& line = sources_->added[tail_line_];
+  if (static_cast<std::size_t>(block_end_ - line.data) >= size) {
+    block_cursor_ = line.data + size;
+    return line.data;
+  }
+
+  // The tail outgrew its block; move it to a new one with room to keep
+  // growing. The old bytes are simply abandoned.
+  const std::size_t kCapacity = (std::max)(kArenaBlockSize, size * 2);
+  sources_->blocks.push_back(std::make_unique<char[]>(kCapacity));
+  sources_->block_bytes += kCapacity;
+  char* data = sources_->blocks.back().get();
+  std::memcpy(data, line.data, line.size);
+  line.data = data;
+  block_cursor_ = data + size;
+  block_end_ = data + kCapacity;
+  return data;
+}
+
+std::size_t PieceTable::EditableLine(std::size_t index) {
+  const Location kLocation = Locate(index);
+  const Piece& piece = nodes_[kLocation.node].piece;
+  if (has_tail_line_ && piece.source == Source::kAdded &&
+      piece.first + kLocation.offset == tail_line_) {
+    return tail_line_;
+  }
+
+  ReplaceLine(index, sources_->Line(piece, kLocation.offset));
+  return tail_line_;
+}
+
+void PieceTable::ExtendOriginal(std::size_t first, std::size_t count) {
+  // Grow the last piece in place when it already ends at `first`; this keeps
+  // incremental indexing from adding one node per batch.
+  NodeIndex node = root_;
+  while (node != kNil && nodes_[node].right != kNil) {
+    node = nodes_[node].right;
+  }
+
+  if (node != kNil && nodes_[node].piece.source == Source::kOriginal &&
+      nodes_[node].piece.first + nodes_[node].piece.count == first) {
+    nodes_[node].piece.count += count;
+    for (NodeIndex spine = root_; spine != kNil;
+         spine = nodes_[spine].right) {
+      nodes_[spine].lines += count;
+    }
+    return;
+  }
+
+  root_ = Merge(root_, NewNode(Piece{Source::kOriginal, first, count}));
+}
+
+std::string_view PieceTable::Sources::Line(const Piece& piece,
+                                           std::size_t offset) const {
+  const std::size_t kLine = piece.first + offset;
+  if (piece.source == Source::kAdded) {
+    const AddedLine& line = added[kLine];
+    return {line.data, line.size};
+  }
+
+  const std::uint64_t kBegin = line_starts[kLine];
+  return original.substr(kBegin, OriginalLineEnd(kLine) - kBegin);
+}
+
+std::uint64_t PieceTable::Sources::OriginalLineEnd(
+    std::size_t line) const noexcept {
+  const std::uint64_t kBegin = line_starts[line];
+  const std::uint64_t kEnd = line_starts[line + 1] - 1;
+  if (line_ending == LineEnding::kCrLf && kEnd > kBegin &&
+      kEnd < original.size() && original[kEnd - 1] == '\r') {
+    return kEnd - 1;
+  }
+  return kEnd;
+}
+
+LineSlice LineSlice::FromLines(std::span<const std::string_view> lines) {
+  PieceTable table;
+  table.InsertLines(0, lines);
+  return table.Extract(0, lines.size());
+}
+
+LineSlice LineSlice::Concat(const LineSlice& first, const LineSlice& second) {
+  if (first.Empty()) {
+    return second;
+  }
+  if (second.Empty()) {
+    return first;
+  }
+
+  if (first.sources_ == second.sources_) {
+    LineSlice result = first;
+    result.pieces_.insert(result.pieces_.end(), second.pieces_.begin(),
+                          second.pieces_.end());
+    result.lines_ += second.lines_;
+    return result;
+  }
+
+  std::vector<std::string_view> lines;
+  lines.reserve(first.lines_ + second.lines_);
+  const auto kCollect = [&lines](std::string_view line) {
+    lines.push_back(line);
+  };
+  first.ForEachLine(kCollect);
+  second.ForEachLine(kCollect);
+  return FromLines(lines);
+}
+
+LineSlice LineSlice::Repeat(const LineSlice& slice, std::size_t times) {
+  LineSlice result;
+  if (slice.Empty() || times == 0) {
+    return result;
+  }
+  result.sources_ = slice.sources_;
+  result.pieces_.reserve(slice.pieces_.size() * times);
+  for (std::size_t copy = 0; copy < times; ++copy) {
+    result.pieces_.insert(result.pieces_.end(), slice.pieces_.begin(),
+                          slice.pieces_.end());
+  }
+  result.lines_ = slice.lines_ * times;
+  return result;
+}
+
+std::size_t LineSlice::MemoryUsage() const noexcept {
+  return sizeof(LineSlice) + pieces_.size() * sizeof(PieceTable::Piece);
+}
+
+void LineSlice::ForEachLine(const LineVisitor& visit) const {
+  for (const PieceTable::Piece& piece : pieces_) {
+    for (std::size_t offset = 0; offset < piece.count; ++offset) {
+      visit(sources_->Line(piece, offset));
+    }
+  }
+}
+}  // namespace core
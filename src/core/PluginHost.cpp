@@ -0,0 +1,546 @@
+#include "core/PluginHost.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+
+#include <cerrno>
+#endif
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/PieceTable.hpp"
+#include "core/TextPosition.hpp"
+#include "io/PluginProcess.hpp"
+#include "io/RpcProtocol.hpp"
+#include "io/SharedMemory.hpp"
+#include "io/Waker.hpp"
+
+namespace {
+constexpr std::size_t kReadChunk = 64 * 1024;
+
+std::size_t JoinedSize(const core::TextSnapshot& snapshot,
+                       std::string_view separator) {
+  std::size_t size = 0;
+  for (const core::TextSnapshot::Run& run : snapshot.runs) {
+    size += run.text.size();
+  }
+  if (!snapshot.runs.empty()) {
+    size += separator.size() * (snapshot.runs.size() - 1);
+  }
+  return size;
+}
+}  // namespace
+
+namespace core {
+struct PluginHost::Incoming {
+  RpcMessageType type = RpcMessageType::kResult;
+  RpcHello hello;
+  RpcResult result;
+};
+
+struct PluginHost::Plugin {
+  ~Plugin() {
+    if (io.joinable()) {
+      io.request_stop();
+      waker.Notify();
+      io.join();
+    }
+    process.Stop();
+  }
+
+  // A call queued by Invoke(), with the text to share if it brings a new
+  // revision.
+  struct Outgoing {
+    RpcInvoke message;
+    std::optional<TextSnapshot> text;
+    std::string_view separator;
+  };
+
+  std::string path;
+  std::string name;
+  PluginProcess process;
+  Waker waker;
+  std::function<void()> wake_hook;
+
+  // Shared with the I/O thread.
+  std::mutex mutex;
+  std::deque<Outgoing> outbox;
+  std::vector<Incoming> inbox;
+  bool closed = false;
+
+  // Main thread only.
+  bool ready = false;
+  bool failed = false;
+  std::vector<Incoming> received;
+  // The buffer revision each call was made at, by call.
+  std::unordered_map<std::uint64_t, std::uint64_t> in_flight;
+  bool has_shared = false;
+  std::uint64_t shared_revision = 0;
+  std::uint64_t shared_bytes = 0;
+  std::vector<RegistrationHandle> handles;
+
+  // Last, so it stops before anything it uses goes.
+  std::jthread io;
+};
+}  // namespace core
+
+namespace {
+core::StatusSeverity ToSeverity(core::RpcSeverity severity) {
+  switch (severity) {
+    case core::RpcSeverity::kInfo:
+      return core::StatusSeverity::kInfo;
+    case core::RpcSeverity::kWarning:
+      return core::StatusSeverity::kWarning;
+    case core::RpcSeverity::kError:
+      return core::StatusSeverity::kError;
+    case core::RpcSeverity::kNone:
+      break;
+  }
+  return core::StatusSeverity::kNone;
+}
+
+// Bytes waiting to be written; the descriptor of `memory`, if any, goes with
+// the first of them.
+struct Segment {
+  std::string bytes;
+  std::size_t written = 0;
+  std::unique_ptr<core::SharedMemory> memory;
+};
+
+// Copies the snapshot, lines joined by `separator`, into new shared memory.
+std::unique_ptr<core::SharedMemory> ShareText(const core::TextSnapshot& text,
+                                              std::string_view separator) {
+  auto memory = std::make_unique<core::SharedMemory>();
+  if (!memory->Create(JoinedSize(text, separator))) {
+    return nullptr;
+  }
+  char* out = memory->Data();
+  bool first = true;
+  for (const core::TextSnapshot::Run& run : text.runs) {
+    if (!first) {
+      std::memcpy(out, separator.data(), separator.size());
+      out += separator.size();
+    }
+    if (!run.text.empty()) {
+      std::memcpy(out, run.text.data(), run.text.size());
+      out += run.text.size();
+    }
+    first = false;
+  }
+  return memory;
+}
+
+// Edits must be in range and, once sorted from last to first, not overlap.
+bool EditsApply(const core::Buffer& buffer,
+                const std::vector<core::RpcEdit>& edits) {
+  auto valid = [&](std::uint64_t line, std::uint64_t column) {
+    return line < buffer.LineCount() &&
+           column <= buffer.GetLine(static_cast<std::size_t>(line)).size();
+  };
+  for (std::size_t i = 0; i < edits.size(); ++i) {
+    const core::RpcEdit& edit = edits[i];
+    if (!valid(edit.start_line, edit.start_column) ||
+        !valid(edit.end_line, edit.end_column) ||
+        std::pair(edit.end_line, edit.end_column) <
+            std::pair(edit.start_line, edit.start_column)) {
+      return false;
+    }
+    if (i != 0 && std::pair(edit.end_line, edit.end_column) >
+                      std::pair(edits[i - 1].start_line,
+                                edits[i - 1].start_column)) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+namespace core {
+PluginHost::PluginHost() = default;
+
+PluginHost::~PluginHost() {
+  for (const std::unique_ptr<Plugin>& plugin : plugins_) {
+    Unload(*plugin);
+  }
+}
+
+void PluginHost::SetWakeHook(std::function<void()> hook) {
+  wake_hook_ = std::move(hook);
+}
+
+bool PluginHost::Load(const std::string& path, std::string& error) {
+  if (Find(path) != nullptr) {
+    error = "Plugin already loaded: " + path;
+    return false;
+  }
+
+  auto plugin = std::make_unique<Plugin>();
+  plugin->path = path;
+  plugin->name = path;
+  plugin->wake_hook = wake_hook_;
+  if (!plugin->process.Start(path)) {
+    error = "Cannot start plugin: " + path;
+    return false;
+  }
+  Plugin& started = *plugin;
+  started.io = std::jthread(
+      [&started](const std::stop_token& token) { RunIo(started, token); });
+  plugins_.push_back(std::move(plugin));
+  return true;
+}
+
+bool PluginHost::Invoke(std::string_view endpoint,
+                        const CommandInvocation& invocation,
+                        CommandCapabilityMask capabilities,
+                        EditorState& state) {
+  Plugin* plugin = Find(endpoint);
+  if (plugin == nullptr) {
+    state.SetStatus("Plugin not running", StatusSeverity::kWarning);
+    return false;
+  }
+  if (!plugin->ready) {
+    state.SetStatus("Plugin starting", StatusSeverity::kWarning);
+    return false;
+  }
+  if (plugin->in_flight.size() >= kMaxInFlight) {
+    state.SetStatus("Plugin busy", StatusSeverity::kWarning);
+    return false;
+  }
+
+  Buffer& buffer = state.GetBuffer();
+  Plugin::Outgoing outgoing;
+  RpcInvoke& message = outgoing.message;
+  message.call = next_call_++;
+  message.command_id = invocation.command_id;
+  message.count = invocation.count;
+  message.operand = invocation.operand;
+  message.arguments.assign(invocation.arguments.begin(),
+                           invocation.arguments.end());
+  message.revision = buffer.Revision();
+  message.cursor_line = state.CursorLine();
+  message.cursor_column = state.CursorColumn();
+
+  constexpr auto kReads =
+      static_cast<CommandCapabilityMask>(CommandCapability::kReadBuffer);
+  // A paged file is too big to share; its plugins get no text.
+  if ((capabilities & kReads) != 0 && buffer.Paged() == nullptr) {
+    message.has_text = true;
+    if (!plugin->has_shared || plugin->shared_revision != message.revision) {
+      outgoing.separator =
+          buffer.GetLineEnding() == LineEnding::kCrLf ? "\r\n" : "\n";
+      outgoing.text = buffer.Snapshot();
+      message.attaches_text = true;
+      plugin->has_shared = true;
+      plugin->shared_revision = message.revision;
+      plugin->shared_bytes = JoinedSize(*outgoing.text, outgoing.separator);
+    }
+    message.text_bytes = plugin->shared_bytes;
+  }
+
+  plugin->in_flight.emplace(message.call, message.revision);
+  {
+    std::scoped_lock lock(plugin->mutex);
+    plugin->outbox.push_back(std::move(outgoing));
+  }
+  plugin->waker.Notify();
+  return true;
+}
+
+bool PluginHost::Poll(EditorState& state) {
+  bool changed = false;
+  for (auto it = plugins_.begin(); it != plugins_.end();) {
+    Plugin& plugin = **it;
+    bool closed = false;
+    {
+      std::scoped_lock lock(plugin.mutex);
+      plugin.received.swap(plugin.inbox);
+      closed = plugin.closed;
+    }
+
+    for (Incoming& incoming : plugin.received) {
+      if (plugin.failed) {
+        break;
+      }
+      changed |= incoming.type == RpcMessageType::kHello
+                     ? Greet(plugin, incoming, state)
+                     : Apply(plugin, incoming, state);
+    }
+    plugin.received.clear();
+
+    if (!closed && !plugin.failed) {
+      ++it;
+      continue;
+    }
+    if (!plugin.failed) {
+      state.SetStatus("Plugin " + plugin.name + " exited",
+                      StatusSeverity::kWarning);
+    }
+    Unload(plugin);
+    it = plugins_.erase(it);
+    changed = true;
+  }
+  return changed;
+}
+
+void PluginHost::RunIo(Plugin& plugin, const std::stop_token& token) {
+#ifdef _WIN32
+  static_cast<void>(plugin);
+  static_cast<void>(token);
+#else
+  std::deque<Plugin::Outgoing> queued;
+  std::deque<Segment> segments;
+  std::vector<Incoming> received;
+  RpcFrameReader reader;
+  std::array<char, kReadChunk> chunk{};
+  bool closed = false;
+
+  while (!closed && !token.stop_requested()) {
+    {
+      std::scoped_lock lock(plugin.mutex);
+      queued.swap(plugin.outbox);
+    }
+    // Calls are appended to the last segment, so a burst goes out in one
+    // write; a call sharing new text starts a segment of its own, since the
+    // descriptor must arrive with its first byte.
+    for (Plugin::Outgoing& outgoing : queued) {
+      if (outgoing.text || segments.empty()) {
+        segments.emplace_back();
+      }
+      if (outgoing.text) {
+        segments.back().memory =
+            ShareText(*outgoing.text, outgoing.separator);
+        if (!segments.back().memory) {
+          closed = true;
+          break;
+        }
+      }
+      EncodeRpc(outgoing.message, segments.back().bytes);
+    }
+    queued.clear();
+
+    while (!closed && !segments.empty()) {
+      Segment& segment = segments.front();
+      const int kAttached =
+          segment.written == 0 && segment.memory ? segment.memory->Fd() : -1;
+      const std::ptrdiff_t kSent = plugin.process.Send(
+          std::string_view(segment.bytes).substr(segment.written), kAttached);
+      if (kSent < 0) {
+        closed = true;
+      } else if (kSent == 0) {
+        break;
+      } else {
+        // The plugin holds its own descriptor now.
+        segment.memory.reset();
+        segment.written += static_cast<std::size_t>(kSent);
+        if (segment.written == segment.bytes.size()) {
+          segments.pop_front();
+        }
+      }
+    }
+
+    std::array<pollfd, 2> fds{};
+    fds[0].fd = plugin.process.Fd();
+    fds[0].events =
+        static_cast<short>(POLLIN | (segments.empty() ? 0 : POLLOUT));
+    fds[1].fd = plugin.waker.Fd();
+    fds[1].events = POLLIN;
+    if (!closed && ::poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) {
+      closed = true;
+    }
+    if ((fds[1].revents & POLLIN) != 0) {
+      plugin.waker.Drain();
+    }
+
+    if (!closed && (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+      for (;;) {
+        const std::ptrdiff_t kRead =
+            plugin.process.Receive(chunk.data(), chunk.size());
+        if (kRead <= 0) {
+          closed = kRead < 0;
+          break;
+        }
+        reader.Append(
+            std::string_view(chunk.data(), static_cast<std::size_t>(kRead)));
+
+        RpcMessageType type{};
+        std::string_view payload;
+        while (reader.Next(type, payload)) {
+          Incoming incoming;
+          incoming.type = type;
+          bool decoded = false;
+          if (type == RpcMessageType::kHello) {
+            decoded = DecodeRpc(payload, incoming.hello);
+          } else if (type == RpcMessageType::kResult) {
+            decoded = DecodeRpc(payload, incoming.result);
+          }
+          if (!decoded) {
+            closed = true;
+            break;
+          }
+          received.push_back(std::move(incoming));
+        }
+        if (closed || reader.Malformed()) {
+          closed = true;
+          break;
+        }
+      }
+    }
+
+    if (received.empty() && !closed) {
+      continue;
+    }
+    {
+      std::scoped_lock lock(plugin.mutex);
+      std::move(received.begin(), received.end(),
+                std::back_inserter(plugin.inbox));
+      plugin.closed = closed;
+    }
+    received.clear();
+    if (plugin.wake_hook) {
+      plugin.wake_hook();
+    }
+  }
+#endif
+}
+
+void PluginHost::Unload(Plugin& plugin) {
+  Registry& registry = Registry::Instance();
+  for (const RegistrationHandle& handle : plugin.handles) {
+    registry.Unregister(handle);
+  }
+  plugin.handles.clear();
+}
+
+bool PluginHost::Greet(Plugin& plugin, Incoming& incoming,
+                       EditorState& state) {
+  RpcHello& hello = incoming.hello;
+  if (plugin.ready) {
+    return false;
+  }
+  if (hello.version != kRpcProtocolVersion) {
+    state.SetStatus("Plugin " + plugin.path + " speaks protocol version " +
+                        std::to_string(hello.version),
+                    StatusSeverity::kError);
+    plugin.failed = true;
+    return true;
+  }
+
+  if (!hello.name.empty()) {
+    plugin.name = std::move(hello.name);
+  }
+  const Origin kOrigin{RegistryOriginKind::kPlugin, plugin.name};
+  Registry& registry = Registry::Instance();
+  std::size_t registered = 0;
+  for (RpcCommandSpec& spec : hello.commands) {
+    CommandRegistration command;
+    command.descriptor.id = spec.id;
+    command.descriptor.label = std::move(spec.label);
+    command.descriptor.short_description = command.descriptor.label;
+    command.descriptor.modes = {Mode::kNormal};
+    command.descriptor.capabilities = spec.capabilities;
+    command.callable.rpc_endpoint = plugin.path;
+    command.lifetime = RegistrationLifetime::kSession;
+    const RegistrationResult kCommand =
+        registry.RegisterCommand(command, kOrigin);
+    if (kCommand.status == RegistrationStatus::kRejected) {
+      continue;
+    }
+    plugin.handles.push_back(kCommand.handle);
+    ++registered;
+
+    if (spec.gesture.empty()) {
+      continue;
+    }
+    KeybindingRegistration binding;
+    binding.descriptor.id = spec.id + ".binding";
+    binding.descriptor.command_id = spec.id;
+    binding.descriptor.mode = KeybindingMode::kNormal;
+    binding.descriptor.gesture = std::move(spec.gesture);
+    binding.lifetime = RegistrationLifetime::kSession;
+    const RegistrationResult kBinding =
+        registry.RegisterKeybinding(binding, kOrigin);
+    if (kBinding.status != RegistrationStatus::kRejected) {
+      plugin.handles.push_back(kBinding.handle);
+    }
+  }
+
+  plugin.ready = true;
+  state.SetStatus("Plugin " + plugin.name + ": " + std::to_string(registered) +
+                      (registered == 1 ? " command" : " commands"),
+                  StatusSeverity::kInfo);
+  return true;
+}
+
+bool PluginHost::Apply(Plugin& plugin, const Incoming& incoming,
+                       EditorState& state) {
+  const RpcResult& result = incoming.result;
+  const auto kCall = plugin.in_flight.find(result.call);
+  if (kCall == plugin.in_flight.end()) {
+    return false;
+  }
+  const std::uint64_t kRevision = kCall->second;
+  plugin.in_flight.erase(kCall);
+
+  if (!result.edits.empty()) {
+    Buffer& buffer = state.GetBuffer();
+    if (buffer.Revision() != kRevision) {
+      state.SetStatus(
+          "Plugin " + plugin.name + ": buffer changed, edits dropped",
+          StatusSeverity::kWarning);
+      return true;
+    }
+    std::vector<RpcEdit> edits = result.edits;
+    std::sort(edits.begin(), edits.end(),
+              [](const RpcEdit& lhs, const RpcEdit& rhs) {
+                return std::pair(lhs.start_line, lhs.start_column) >
+                       std::pair(rhs.start_line, rhs.start_column);
+              });
+    if (!EditsApply(buffer, edits)) {
+      state.SetStatus("Plugin " + plugin.name + ": invalid edits",
+                      StatusSeverity::kError);
+      return true;
+    }
+
+    // Applied last to first, so each leaves the positions of the rest
+    // alone, and undone together.
+    buffer.CloseUndoStep();
+    for (const RpcEdit& edit : edits) {
+      buffer.Splice({static_cast<std::size_t>(edit.start_line),
+                     static_cast<std::size_t>(edit.start_column)},
+                    {static_cast<std::size_t>(edit.end_line),
+                     static_cast<std::size_t>(edit.end_column)},
+                    edit.text);
+    }
+    buffer.CloseUndoStep();
+    state.MoveCursorLine(0);
+  }
+
+  if (result.severity != RpcSeverity::kNone) {
+    state.SetStatus(result.message, ToSeverity(result.severity));
+  }
+  return true;
+}
+
+PluginHost::Plugin* PluginHost::Find(std::string_view endpoint) const noexcept {
+  for (const std::unique_ptr<Plugin>& plugin : plugins_) {
+    if (plugin->path == endpoint) {
+      return plugin.get();
+    }
+  }
+  return nullptr;
+}
+}  // namespace core
@@ -0,0 +1,230 @@
+#include "core/Profiler.hpp"
+
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace {
+using core::ProfileCounter;
+using core::ProfileZone;
+
+constexpr std::array<std::string_view,
+                     static_cast<std::size_t>(ProfileZone::kCount)>
+    kZoneNames = {"HandleEvent", "KeyLookup", "Command", "Compose",
+                  "Flush",       "Load",      "Save"};
+// As the overlay shows them, where room is short.
+constexpr std::array<std::string_view,
+                     static_cast<std::size_t>(ProfileZone::kCount)>
+    kZoneLabels = {"key", "map", "cmd", "draw", "flush", "load", "save"};
+
+std::atomic<std::uint32_t> g_next_thread{1};
+
+std::uint32_t ThreadNumber() {
+  thread_local const std::uint32_t kNumber = g_next_thread.fetch_add(1);
+  return kNumber;
+}
+
+std::size_t Index(ProfileZone zone) {
+  return static_cast<std::size_t>(zone);
+}
+
+std::size_t Index(ProfileCounter counter) {
+  return static_cast<std::size_t>(counter);
+}
+
+// Appends `value` with `decimals` digits after the point, without the
+// allocations of a stream.
+void AppendFixed(std::string& out, double value, int decimals) {
+  std::array<char, 32> digits{};
+  const auto [end, error] =
+      std::to_chars(digits.data(), digits.data() + digits.size(), value,
+                    std::chars_format::fixed, decimals);
+  if (error == std::errc{}) {
+    out.append(digits.data(), end);
+  }
+}
+
+// In the largest unit that leaves a number of at least one.
+void AppendDuration(std::string& out, std::int64_t nanoseconds) {
+  const auto kValue = static_cast<double>(nanoseconds);
+  if (nanoseconds < 1000) {
+    AppendFixed(out, kValue, 0);
+    out.append("ns");
+  } else if (nanoseconds < 1000 * 1000) {
+    AppendFixed(out, kValue / 1e3, 1);
+    out.append("us");
+  } else if (nanoseconds < 1000 * 1000 * 1000) {
+    AppendFixed(out, kValue / 1e6, 1);
+    out.append("ms");
+  } else {
+    AppendFixed(out, kValue / 1e9, 2);
+    out.append("s");
+  }
+}
+
+void AppendBytes(std::string& out, std::uint64_t bytes) {
+  const auto kValue = static_cast<double>(bytes);
+  if (bytes < 1024) {
+    AppendFixed(out, kValue, 0);
+    out.append("B");
+  } else if (bytes < 1024 * 1024) {
+    AppendFixed(out, kValue / 1024.0, 1);
+    out.append("K");
+  } else {
+    AppendFixed(out, kValue / (1024.0 * 1024.0), 1);
+    out.append("M");
+  }
+}
+}  // namespace
+
+namespace core {
+Profiler& Profiler::Shared() {
+  static Profiler profiler;
+  return profiler;
+}
+
+std::string_view Profiler::ZoneName(ProfileZone zone) noexcept {
+  return zone < ProfileZone::kCount ? kZoneNames[Index(zone)]
+                                    : std::string_view("Unknown");
+}
+
+Profiler::Profiler() : epoch_(Clock::now()) {}
+
+void Profiler::Record(ProfileZone zone, Clock::time_point start,
+                      Clock::time_point end) {
+  const std::int64_t kNanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count();
+  ZoneTotals& totals = zones_[Index(zone)];
+  totals.calls.fetch_add(1, std::memory_order_relaxed);
+  totals.total.fetch_add(kNanoseconds, std::memory_order_relaxed);
+  totals.last.store(kNanoseconds, std::memory_order_relaxed);
+  std::int64_t max = totals.max.load(std::memory_order_relaxed);
+  while (kNanoseconds > max &&
+         !totals.max.compare_exchange_weak(max, kNanoseconds,
+                                           std::memory_order_relaxed)) {
+  }
+
+  if (!tracing_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  const std::lock_guard<std::mutex> kLock(trace_mutex_);
+  if (trace_.size() < kMaxTraceEvents) {
+    trace_.push_back(
+        {zone, ThreadNumber(),
+         std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_)
+             .count(),
+         kNanoseconds});
+  }
+}
+
+void Profiler::Count(ProfileCounter counter, std::uint64_t amount) noexcept {
+  counters_[Index(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+ProfileZoneStats Profiler::Zone(ProfileZone zone) const noexcept {
+  const ZoneTotals& totals = zones_[Index(zone)];
+  ProfileZoneStats stats;
+  stats.calls = totals.calls.load(std::memory_order_relaxed);
+  stats.total = std::chrono::nanoseconds(
+      totals.total.load(std::memory_order_relaxed));
+  stats.max =
+      std::chrono::nanoseconds(totals.max.load(std::memory_order_relaxed));
+  stats.last =
+      std::chrono::nanoseconds(totals.last.load(std::memory_order_relaxed));
+  return stats;
+}
+
+std::uint64_t Profiler::Counter(ProfileCounter counter) const noexcept {
+  return counters_[Index(counter)].load(std::memory_order_relaxed);
+}
+
+void Profiler::Reset() noexcept {
+  for (ZoneTotals& totals : zones_) {
+    totals.calls.store(0, std::memory_order_relaxed);
+    totals.total.store(0, std::memory_order_relaxed);
+    totals.max.store(0, std::memory_order_relaxed);
+    totals.last.store(0, std::memory_order_relaxed);
+  }
+  for (std::atomic<std::uint64_t>& counter : counters_) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Profiler::Summarize(std::string& line) const {
+  line.clear();
+  for (std::size_t i = 0; i < zones_.size(); ++i) {
+    const ProfileZoneStats kStats = Zone(static_cast<ProfileZone>(i));
+    if (kStats.calls == 0) {
+      continue;
+    }
+    if (!line.empty()) {
+      line.append("  ");
+    }
+    line.append(kZoneLabels[i]);
+    line.push_back(' ');
+    AppendDuration(line, kStats.total.count() /
+                             static_cast<std::int64_t>(kStats.calls));
+    if (static_cast<ProfileZone>(i) == ProfileZone::kFlush) {
+      line.push_back('/');
+      AppendBytes(line, Counter(ProfileCounter::kFlushedBytes) / kStats.calls);
+    }
+  }
+  if (line.empty()) {
+    line.assign("Nothing profiled yet");
+  }
+}
+
+void Profiler::StartTrace() {
+  const std::lock_guard<std::mutex> kLock(trace_mutex_);
+  trace_.clear();
+  tracing_.store(true);
+}
+
+bool Profiler::IsTracing() const noexcept {
+  return tracing_.load();
+}
+
+std::size_t Profiler::TraceEvents() const {
+  const std::lock_guard<std::mutex> kLock(trace_mutex_);
+  return trace_.size();
+}
+
+bool Profiler::WriteTrace(const std::string& path) {
+  std::vector<TraceEvent> events;
+  {
+    const std::lock_guard<std::mutex> kLock(trace_mutex_);
+    tracing_.store(false);
+    events.swap(trace_);
+  }
+
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  if (!output.is_open()) {
+    return false;
+  }
+  // Complete ("X") events, in microseconds as the format has them.
+  std::string json("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  for (std::size_t i = 0; i < events.size(); ++i) {
+    const TraceEvent& event = events[i];
+    if (i > 0) {
+      json.push_back(',');
+    }
+    json.append("\n{\"name\":\"");
+    json.append(ZoneName(event.zone));
+    json.append("\",\"cat\":\"microvi\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+    json.append(std::to_string(event.thread));
+    json.append(",\"ts\":");
+    AppendFixed(json, static_cast<double>(event.start) / 1e3, 3);
+    json.append(",\"dur\":");
+    AppendFixed(json, static_cast<double>(event.duration) / 1e3, 3);
+    json.push_back('}');
+  }
+  json.append("\n]}\n");
+  output.write(json.data(), static_cast<std::streamsize>(json.size()));
+  return output.good();
+}
+}  // namespace core
@@ -0,0 +1,120 @@
+#include "core/Registers.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace core {
+namespace {
+LineSlice ToLines(const RegisterContent& content) {
+  if (content.linewise) {
+    return content.lines;
+  }
+
+  std::vector<std::string_view> lines;
+  std::string_view rest(content.text);
+  while (true) {
+    const std::size_t kBreak = rest.find('\n');
+    lines.push_back(rest.substr(0, kBreak));
+    if (kBreak == std::string_view::npos) {
+      break;
+    }
+    rest.remove_prefix(kBreak + 1);
+  }
+  return LineSlice::FromLines(lines);
+}
+
+bool SpansLines(const RegisterContent& content) {
+  return content.linewise ||
+         content.text.find('\n') != std::string::npos;
+}
+}  // namespace
+
+bool Registers::IsValidName(char name) noexcept {
+  const unsigned char kName = static_cast<unsigned char>(name);
+  return name == kUnnamed || name == '-' || std::isdigit(kName) != 0 ||
+         std::isalpha(kName) != 0;
+}
+
+void Registers::Yank(char name, RegisterContent content) {
+  Content shared = std::make_shared<const RegisterContent>(std::move(content));
+  if (name == 0 || name == kUnnamed) {
+    yank_ = shared;
+    unnamed_ = std::move(shared);
+    return;
+  }
+  Store(name, std::move(shared));
+}
+
+void Registers::Delete(char name, RegisterContent content) {
+  Content shared = std::make_shared<const RegisterContent>(std::move(content));
+  if (name != 0 && name != kUnnamed) {
+    Store(name, std::move(shared));
+    return;
+  }
+
+  if (SpansLines(*shared)) {
+    std::move_backward(ring_.begin(), ring_.end() - 1, ring_.end());
+    ring_.front() = shared;
+  } else {
+    small_delete_ = shared;
+  }
+  unnamed_ = std::move(shared);
+}
+
+Registers::Content Registers::Get(char name) const {
+  const Content* slot = Slot(name);
+  return slot != nullptr ? *slot : nullptr;
+}
+
+Registers::Content* Registers::Slot(char name) noexcept {
+  return const_cast<Content*>(std::as_const(*this).Slot(name));
+}
+
+const Registers::Content* Registers::Slot(char name) const noexcept {
+  const unsigned char kName = static_cast<unsigned char>(name);
+  if (name == 0 || name == kUnnamed) {
+    return &unnamed_;
+  }
+  if (name == '0') {
+    return &yank_;
+  }
+  if (name >= '1' && name <= '9') {
+    return &ring_[static_cast<std::size_t>(name - '1')];
+  }
+  if (name == '-') {
+    return &small_delete_;
+  }
+  if (std::isalpha(kName) != 0) {
+    return &named_[static_cast<std::size_t>(std::tolower(kName) - 'a')];
+  }
+  return nullptr;
+}
+
+void Registers::Store(char name, Content content) {
+  Content* slot = Slot(name);
+  if (slot == nullptr) {
+    return;
+  }
+
+  // Appending builds a new content; the old one may still be shared.
+  if (std::isupper(static_cast<unsigned char>(name)) != 0 && *slot != nullptr) {
+    const RegisterContent& kOld = **slot;
+    RegisterContent combined;
+    if (!kOld.linewise && !content->linewise) {
+      combined.text = kOld.text + content->text;
+    } else {
+      combined.lines = LineSlice::Concat(ToLines(kOld), ToLines(*content));
+      combined.linewise = true;
+    }
+    content = std::make_shared<const RegisterContent>(std::move(combined));
+  }
+
+  *slot = content;
+  unnamed_ = std::move(content);
+}
+}  // namespace core
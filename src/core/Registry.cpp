@@ -1,12 +1,17 @@
 #include "core/Registry.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "core/Keymap.hpp"
+
 namespace core {
 
 namespace {
@@ -14,6 +19,8 @@ constexpr int kPrecedenceCore = 0;
 constexpr int kPrecedenceNative = 1;
 constexpr int kPrecedencePlugin = 2;
 constexpr int kPrecedenceUser = 3;
+constexpr std::size_t kKeybindingModes =
+    static_cast<std::size_t>(core::KeybindingMode::kAny) + 1;
 }  // namespace
 
 struct Registry::CommandResolution {
@@ -38,12 +45,56 @@ struct Registry::KeybindingResolution {
   std::optional<ConflictRecord> conflict;
 };
 
+struct Registry::Snapshot : std::enable_shared_from_this<Snapshot> {
+  // Keyed by views into the records, which the snapshot keeps alive.
+  template <typename Record>
+  using Table =
+      std::unordered_map<std::string_view, std::shared_ptr<const Record>>;
+
+  std::uint64_t version = 0;
+  Table<CommandRecord> commands;
+  // For ids with no active command, the shadowed one FindCommand(id, true)
+  // falls back to.
+  Table<CommandRecord> shadowed_commands;
+  Table<KeybindingRecord> keybindings;
+  Table<KeybindingRecord> shadowed_keybindings;
+  // The active keybindings again, by mode and then gesture.
+  std::array<Table<KeybindingRecord>, kKeybindingModes> gestures;
+};
+
+struct Registry::SubscriberList
+    : std::enable_shared_from_this<SubscriberList> {
+  std::vector<RegistryCallback> callbacks;
+};
+
+template <typename Value>
+void Registry::Published<Value>::Publish(std::shared_ptr<const Value> value) {
+  kept_.push_back(std::move(value));
+  current_.store(kept_.back().get());
+  // A reader that counts itself in from here on loads the new value.
+  if (readers_.load() == 0) {
+    kept_.erase(kept_.begin(), kept_.end() - 1);
+  }
+}
+
+template <typename Value>
+std::shared_ptr<const Value> Registry::Published<Value>::Load() const {
+  readers_.fetch_add(1);
+  std::shared_ptr<const Value> value = current_.load()->shared_from_this();
+  readers_.fetch_sub(1);
+  return value;
+}
+
 Registry& Registry::Instance() {
   static Registry instance;
   return instance;
 }
 
-Registry::Registry() = default;
+Registry::Registry() {
+  std::scoped_lock lock(mutex_);
+  PublishSnapshot();
+  PublishSubscribers();
+}
 
 RegistrationResult Registry::RegisterCommand(
     const CommandRegistration& registration, const Origin& origin) {
@@ -147,6 +198,9 @@ RegistrationResult Registry::RegisterCommand(
         }
       }
     }
+    if (result.status != RegistrationStatus::kRejected) {
+      PublishSnapshot();
+    }
   }
 
   for (const auto& event : events) {
@@ -283,6 +337,9 @@ RegistrationResult Registry::RegisterKeybinding(
         }
       }
     }
+    if (result.status != RegistrationStatus::kRejected) {
+      PublishSnapshot();
+    }
   }
 
   for (const auto& event : events) {
@@ -377,6 +434,9 @@ bool Registry::Unregister(const RegistrationHandle& handle) {
       default:
         break;
     }
+    if (success) {
+      PublishSnapshot();
+    }
   }
 
   for (const auto& event : events) {
@@ -397,125 +457,111 @@ std::uint64_t Registry::Version() const noexcept {
 
 std::optional<CommandRecord> Registry::FindCommand(std::string_view id,
                                                    bool include_shadow) const {
-  std::string key(id);
-  std::scoped_lock lock(mutex_);
-
-  auto it = commands_.find(key);
-  if (it != commands_.end()) {
-    const CommandEntry& entry = it->second;
-    return CommandRecord{entry.descriptor, entry.callable,
-                         entry.origin,     entry.priority,
-                         entry.lifetime,   entry.token,
-                         entry.sequence,   RegistrationStatus::kApplied};
+  const Snapshot& snapshot = CurrentSnapshot();
+  auto it = snapshot.commands.find(id);
+  if (it != snapshot.commands.end()) {
+    return *it->second;
   }
-
   if (!include_shadow) {
     return std::nullopt;
   }
 
-  auto shadow_it = command_shadow_.find(key);
-  if (shadow_it == command_shadow_.end() || shadow_it->second.empty()) {
+  auto shadow_it = snapshot.shadowed_commands.find(id);
+  if (shadow_it == snapshot.shadowed_commands.end()) {
     return std::nullopt;
   }
-
-  const CommandEntry& shadow_entry = shadow_it->second.back();
-  return CommandRecord{shadow_entry.descriptor, shadow_entry.callable,
-                       shadow_entry.origin,     shadow_entry.priority,
-                       shadow_entry.lifetime,   shadow_entry.token,
-                       shadow_entry.sequence,   RegistrationStatus::kShadowed};
+  CommandRecord record = *shadow_it->second;
+  record.status = RegistrationStatus::kShadowed;
+  return record;
 }
 
 std::vector<CommandRecord> Registry::ListCommands() const {
+  const Snapshot& snapshot = CurrentSnapshot();
   std::vector<CommandRecord> records;
-  std::scoped_lock lock(mutex_);
-  records.reserve(commands_.size());
-  for (const auto& pair : commands_) {
-    const CommandEntry& entry = pair.second;
-    records.push_back(CommandRecord{entry.descriptor, entry.callable,
-                                    entry.origin, entry.priority,
-                                    entry.lifetime, entry.token, entry.sequence,
-                                    RegistrationStatus::kApplied});
+  records.reserve(snapshot.commands.size());
+  for (const auto& pair : snapshot.commands) {
+    records.push_back(*pair.second);
   }
   return records;
 }
 
 std::optional<KeybindingRecord> Registry::FindKeybinding(
     std::string_view id, bool include_shadow) const {
-  std::string key(id);
-  std::scoped_lock lock(mutex_);
-
-  auto it = keybindings_by_id_.find(key);
-  if (it != keybindings_by_id_.end()) {
-    const KeybindingEntry& entry = it->second;
-    return KeybindingRecord{entry.descriptor,
-                            entry.origin,
-                            entry.priority,
-                            entry.lifetime,
-                            entry.token,
-                            entry.sequence,
-                            RegistrationStatus::kApplied};
+  const Snapshot& snapshot = CurrentSnapshot();
+  auto it = snapshot.keybindings.find(id);
+  if (it != snapshot.keybindings.end()) {
+    return *it->second;
   }
-
   if (!include_shadow) {
     return std::nullopt;
   }
 
-  for (const auto& pair : keybinding_shadow_) {
-    const auto& entries = pair.second;
-    for (const KeybindingEntry& entry : entries) {
-      if (entry.descriptor.id == key) {
-        return KeybindingRecord{entry.descriptor,
-                                entry.origin,
-                                entry.priority,
-                                entry.lifetime,
-                                entry.token,
-                                entry.sequence,
-                                RegistrationStatus::kShadowed};
-      }
-    }
+  auto shadow_it = snapshot.shadowed_keybindings.find(id);
+  if (shadow_it == snapshot.shadowed_keybindings.end()) {
+    return std::nullopt;
   }
-
-  return std::nullopt;
+  KeybindingRecord record = *shadow_it->second;
+  record.status = RegistrationStatus::kShadowed;
+  return record;
 }
 
 std::optional<KeybindingRecord> Registry::ResolveKeybinding(
     KeybindingMode mode, std::string_view gesture) const {
-  std::string binding_key = ComposeBindingKey(mode, gesture);
-  std::scoped_lock lock(mutex_);
-
-  auto active_it = keybinding_active_key_to_id_.find(binding_key);
-  if (active_it == keybinding_active_key_to_id_.end()) {
+  const auto kMode = static_cast<std::size_t>(mode);
+  if (kMode >= kKeybindingModes) {
     return std::nullopt;
   }
-
-  auto record_it = keybindings_by_id_.find(active_it->second);
-  if (record_it == keybindings_by_id_.end()) {
+  const Snapshot& snapshot = CurrentSnapshot();
+  auto it = snapshot.gestures[kMode].find(gesture);
+  if (it == snapshot.gestures[kMode].end()) {
     return std::nullopt;
   }
-
-  const KeybindingEntry& entry = record_it->second;
-  return KeybindingRecord{entry.descriptor,
-                          entry.origin,
-                          entry.priority,
-                          entry.lifetime,
-                          entry.token,
-                          entry.sequence,
-                          RegistrationStatus::kApplied};
+  return *it->second;
 }
 
 std::vector<KeybindingRecord> Registry::ListKeybindings() const {
+  const Snapshot& snapshot = CurrentSnapshot();
   std::vector<KeybindingRecord> records;
-  std::scoped_lock lock(mutex_);
-  records.reserve(keybindings_by_id_.size());
-  for (const auto& pair : keybindings_by_id_) {
-    const KeybindingEntry& entry = pair.second;
-    records.push_back(KeybindingRecord{
-        entry.descriptor, entry.origin, entry.priority, entry.lifetime,
-        entry.token, entry.sequence, RegistrationStatus::kApplied});
+  records.reserve(snapshot.keybindings.size());
+  for (const auto& pair : snapshot.keybindings) {
+    records.push_back(*pair.second);
   }
   return records;
 }
 
+std::shared_ptr<const Keymap> Registry::CompileKeymap() const {
+  const Snapshot& snapshot = CurrentSnapshot();
+  auto keymap = std::make_shared<Keymap>(snapshot.version);
+
+  for (const auto& pair : snapshot.keybindings) {
+    const KeybindingDescriptor& descriptor = pair.second->descriptor;
+
+    // Resolved like FindCommand(id, true).
+    const CommandRecord* command = nullptr;
+    auto command_it = snapshot.commands.find(descriptor.command_id);
+    if (command_it != snapshot.commands.end()) {
+      command = command_it->second.get();
+    } else {
+      auto shadow_it = snapshot.shadowed_commands.find(descriptor.command_id);
+      if (shadow_it != snapshot.shadowed_commands.end()) {
+        command = shadow_it->second.get();
+      }
+    }
+
+    Keymap::Binding binding;
+    binding.invocation.command_id = descriptor.command_id;
+    binding.invocation.arguments = descriptor.arguments;
+    if (command != nullptr) {
+      binding.command_found = true;
+      binding.callback = command->callable.native_callback;
+      binding.rpc_endpoint = command->callable.rpc_endpoint;
+      binding.capabilities = command->descriptor.capabilities;
+    }
+    keymap->Bind(descriptor.mode, descriptor.gesture, std::move(binding));
+  }
+  return keymap;
+}
+
 RegistrySubscriptionToken Registry::Subscribe(RegistryCallback callback) {
   if (!callback) {
     return 0;
@@ -524,6 +570,7 @@ RegistrySubscriptionToken Registry::Subscribe(RegistryCallback callback) {
   std::scoped_lock lock(mutex_);
   RegistrySubscriptionToken subscription_token = next_subscription_token_++;
   subscribers_.emplace(subscription_token, std::move(callback));
+  PublishSubscribers();
   return subscription_token;
 }
 
@@ -533,24 +580,107 @@ bool Registry::Unsubscribe(RegistrySubscriptionToken token) {
   }
 
   std::scoped_lock lock(mutex_);
-  return subscribers_.erase(token) > 0;
+  if (subscribers_.erase(token) == 0) {
+    return false;
+  }
+  PublishSubscribers();
+  return true;
 }
 
 void Registry::Notify(const RegistryEvent& event) {
-  std::vector<RegistryCallback> callbacks;
-  {
-    std::scoped_lock lock(mutex_);
-    callbacks.reserve(subscribers_.size());
-    for (auto& entry : subscribers_) {
-      callbacks.push_back(entry.second);
+  const std::shared_ptr<const SubscriberList> kSubscribers =
+      subscriber_list_.Load();
+  for (const RegistryCallback& callback : kSubscribers->callbacks) {
+    callback(event);
+  }
+}
+
+void Registry::PublishSnapshot() {
+  auto next = std::make_shared<Snapshot>();
+  next->version = Version();
+
+  std::unordered_map<std::uint64_t, std::shared_ptr<const CommandRecord>>
+      command_records;
+  auto command_record = [&](const CommandEntry& entry) {
+    auto it = command_records_.find(entry.token);
+    std::shared_ptr<const CommandRecord> record =
+        it != command_records_.end()
+            ? it->second
+            : std::make_shared<const CommandRecord>(CommandRecord{
+                  entry.descriptor, entry.callable, entry.origin,
+                  entry.priority, entry.lifetime, entry.token, entry.sequence,
+                  RegistrationStatus::kApplied});
+    command_records.emplace(entry.token, record);
+    return record;
+  };
+  for (const auto& pair : commands_) {
+    auto record = command_record(pair.second);
+    next->commands.emplace(record->descriptor.id, std::move(record));
+  }
+  for (const auto& [id, list] : command_shadow_) {
+    if (!list.empty() && commands_.find(id) == commands_.end()) {
+      auto record = command_record(list.back());
+      next->shadowed_commands.emplace(record->descriptor.id,
+                                      std::move(record));
     }
   }
 
-  for (auto& callback : callbacks) {
-    if (callback) {
-      callback(event);
+  std::unordered_map<std::uint64_t, std::shared_ptr<const KeybindingRecord>>
+      keybinding_records;
+  auto keybinding_record = [&](const KeybindingEntry& entry) {
+    auto it = keybinding_records_.find(entry.token);
+    std::shared_ptr<const KeybindingRecord> record =
+        it != keybinding_records_.end()
+            ? it->second
+            : std::make_shared<const KeybindingRecord>(KeybindingRecord{
+                  entry.descriptor, entry.origin, entry.priority,
+                  entry.lifetime, entry.token, entry.sequence,
+                  RegistrationStatus::kApplied});
+    keybinding_records.emplace(entry.token, record);
+    return record;
+  };
+  for (const auto& pair : keybindings_by_id_) {
+    auto record = keybinding_record(pair.second);
+    next->keybindings.emplace(record->descriptor.id, record);
+    const auto kMode = static_cast<std::size_t>(record->descriptor.mode);
+    if (kMode < kKeybindingModes) {
+      next->gestures[kMode].emplace(record->descriptor.gesture,
+                                    std::move(record));
     }
   }
+  for (const auto& pair : keybinding_shadow_) {
+    for (const KeybindingEntry& entry : pair.second) {
+      if (keybindings_by_id_.find(entry.descriptor.id) ==
+          keybindings_by_id_.end()) {
+        auto record = keybinding_record(entry);
+        next->shadowed_keybindings.emplace(record->descriptor.id,
+                                           std::move(record));
+      }
+    }
+  }
+
+  command_records_.swap(command_records);
+  keybinding_records_.swap(keybinding_records);
+  snapshot_.Publish(std::move(next));
+}
+
+void Registry::PublishSubscribers() {
+  auto subscribers = std::make_shared<SubscriberList>();
+  subscribers->callbacks.reserve(subscribers_.size());
+  for (const auto& entry : subscribers_) {
+    subscribers->callbacks.push_back(entry.second);
+  }
+  subscriber_list_.Publish(std::move(subscribers));
+}
+
+const Registry::Snapshot& Registry::CurrentSnapshot() const {
+  // The registry is a singleton, so one snapshot per thread will do. Until
+  // the version moves on, a lookup touches nothing another thread writes.
+  thread_local std::shared_ptr<const Snapshot> t_snapshot;
+  if (t_snapshot == nullptr || t_snapshot->version != Version()) {
+    t_snapshot = snapshot_.Load();
+  }
+  return *t_snapshot;
 }
 
 void Registry::PromoteCommandShadow(const std::string& id) {
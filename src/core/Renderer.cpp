@@ -1,30 +1,60 @@
 #include "core/Renderer.hpp"
 
 #include <algorithm>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 
 #include "core/Buffer.hpp"
 #include "core/Cursor.hpp"
 #include "core/EditorState.hpp"
 #include "core/Mode.hpp"
+#include "core/Profiler.hpp"
+#include "core/Selection.hpp"
+#include "core/Utf8.hpp"
 #include "io/Terminal.hpp"
 
 namespace {
-const char* ModeLabel(core::Mode mode) {
+const char* ModeLabel(core::Mode mode, core::SelectionKind selection) {
   switch (mode) {
     case core::Mode::kInsert:
       return "-- INSERT --";
     case core::Mode::kCommandLine:
       return "-- COMMAND --";
+    case core::Mode::kVisual:
+      switch (selection) {
+        case core::SelectionKind::kLine:
+          return "-- VISUAL LINE --";
+        case core::SelectionKind::kBlock:
+          return "-- VISUAL BLOCK --";
+        case core::SelectionKind::kCharacter:
+        default:
+          return "-- VISUAL --";
+      }
     case core::Mode::kNormal:
     default:
       return "-- NORMAL --";
   }
 }
 
+const char* EncodingLabel(core::TextEncoding encoding) {
+  switch (encoding) {
+    case core::TextEncoding::kUtf16Le:
+      return " [utf-16le]";
+    case core::TextEncoding::kUtf16Be:
+      return " [utf-16be]";
+    case core::TextEncoding::kLegacy8Bit:
+      return " [8bit]";
+    case core::TextEncoding::kBinary:
+      return " [binary]";
+    case core::TextEncoding::kAscii:
+    case core::TextEncoding::kUtf8:
+    default:
+      return "";
+  }
+}
+
 bool IsHighlightSeverity(core::StatusSeverity severity) {
   return severity == core::StatusSeverity::kWarning ||
          severity == core::StatusSeverity::kError;
@@ -44,15 +74,44 @@ const std::string& HighlightColor(const core::Theme& theme,
   }
 }
 
-std::string FitToWidth(std::string text, std::size_t width) {
-  if (width == 0) {
-    return {};
+constexpr std::uint8_t kSearchStyle = 0xFF;
+constexpr std::uint8_t kSelectionStyle = 0xFE;
+
+const std::string& StyleColor(const core::Theme& theme, std::uint8_t style) {
+  static const std::string kPlain;
+  if (style == kSearchStyle) {
+    return theme.search_match;
+  }
+  if (style == kSelectionStyle) {
+    return theme.selection;
   }
-  if (text.size() > width) {
-    text.resize(width);
+  switch (static_cast<core::TokenKind>(style)) {
+    case core::TokenKind::kKeyword:
+      return theme.syntax_keyword;
+    case core::TokenKind::kType:
+      return theme.syntax_type;
+    case core::TokenKind::kString:
+      return theme.syntax_string;
+    case core::TokenKind::kNumber:
+      return theme.syntax_number;
+    case core::TokenKind::kComment:
+      return theme.syntax_comment;
+    case core::TokenKind::kPreprocessor:
+      return theme.syntax_preprocessor;
+    case core::TokenKind::kText:
+    default:
+      return kPlain;
   }
-  return text;
 }
+
+// Lines at least this long keep their layout across frames.
+constexpr std::size_t kLongLineBytes = 4096;
+// Like vim's 'synmaxcol': text further into a line is not lexed.
+constexpr std::size_t kSyntaxMaxBytes = 3000;
+// How far outside the visible bytes of a long line a search match may start
+// or end and still be found.
+constexpr std::size_t kSearchReach = 1024;
+constexpr std::string_view kReplacementUtf8 = "\xEF\xBF\xBD";
 }  // namespace
 
 namespace core {
@@ -63,8 +122,7 @@ void Renderer::Prepare() {
     return;
   }
 
-  previous_frame_.clear();
-  first_render_ = true;
+  Invalidate();
   prepared_ = true;
 }
 
@@ -73,20 +131,33 @@ void Renderer::Restore() {
     return;
   }
 
-  std::cout << "\x1b[?25h\x1b[0m\x1b[2J\x1b[H" << std::flush;
+  sink_->Write("\x1b[?25h\x1b[0m\x1b[2J\x1b[H");
   prepared_ = false;
-  first_render_ = true;
-  previous_frame_.clear();
-  scroll_offset_ = 0;
+  Invalidate();
 }
 
-void Renderer::Render(const EditorState& state, std::string_view command_buffer,
+void Renderer::Render(EditorState& state, std::string_view command_buffer,
                       char command_prefix) {
   if (!prepared_) {
     Prepare();
   }
 
-  const TerminalSize kSize = QueryTerminalSize();
+  bool changed = false;
+  {
+    MICROVI_PROFILE_SCOPE(kCompose);
+    changed = Compose(state, command_buffer, command_prefix);
+  }
+  if (changed) {
+    MICROVI_PROFILE_SCOPE(kFlush);
+    MICROVI_PROFILE_COUNT(kFlushedBytes, output_.Size());
+    sink_->Write(output_.View());
+  }
+}
+
+bool Renderer::Compose(EditorState& state, std::string_view command_buffer,
+                       char command_prefix) {
+
+  const TerminalSize kSize = sink_->Size();
   const std::size_t kTotalRows = std::max<std::size_t>(kSize.rows, 3);
   const std::size_t kTotalColumns = kSize.columns;
 
@@ -94,90 +165,211 @@ void Renderer::Render(const EditorState& state, std::string_view command_buffer,
   const std::size_t kContentRows =
       kTotalRows > kInfoRows ? kTotalRows - kInfoRows : 0;
 
-  UpdateScroll(state, kContentRows);
-
   const Buffer& buffer = state.GetBuffer();
+  Highlighter& highlighter = state.GetHighlighter();
+  highlighter.Sync(buffer);
   const std::size_t kTotalLines = buffer.LineCount();
-  const std::size_t kLineDigits = std::max<std::size_t>(
-      1, std::to_string(std::max<std::size_t>(1, kTotalLines)).size());
+  const std::size_t kDropped = buffer.DroppedLines();
+  const std::size_t kLineDigits =
+      DecimalDigits(std::max<std::size_t>(1, kDropped + kTotalLines));
   const std::size_t kPrefixWidth = 2 + kLineDigits + 1;
+  const std::size_t kTextWidth =
+      kTotalColumns > kPrefixWidth ? kTotalColumns - kPrefixWidth : 0;
+
+  const ViewOptions& options = state.GetViewOptions();
+  const bool kRelaidOut = SyncLayouts(
+      state, options.tabstop,
+      options.wrap ? std::max<std::size_t>(kTextWidth, 1) : 0);
+  UpdateScroll(state, kContentRows, std::max<std::size_t>(kTextWidth, 1));
+  const Viewport& viewport = state.GetViewport();
+
+  output_.Clear();
+  output_.Append("\x1b[?25l");
+  const std::size_t kHeaderSize = output_.Size();
+
+  const bool kResized =
+      rows_.size() != kTotalRows || rows_columns_ != kTotalColumns;
+  if (first_render_ || kResized) {
+    // A resize may have reflowed whatever was on screen.
+    output_.Append("\x1b[2J");
+    if (rows_.capacity() < kTotalRows) {
+      ++allocations_;
+    }
+    rows_.resize(kTotalRows);
+    for (Row& row : rows_) {
+      row.valid = false;
+      row.text.Clear();
+    }
+  } else if (kRelaidOut || buffer_id_ != state.BufferId() ||
+             rows_digits_ != kLineDigits ||
+             highlight_ != state.SearchHighlight() ||
+             filetype_ != highlighter.GetFiletype()) {
+    for (Row& row : rows_) {
+      row.valid = false;
+    }
+  }
+  buffer_id_ = state.BufferId();
+  highlight_ = state.SearchHighlight();
+  filetype_ = highlighter.GetFiletype();
+  rows_columns_ = kTotalColumns;
+  rows_digits_ = kLineDigits;
+  const std::uint64_t kGrowthsBefore = StorageGrowths();
+  if (layout_wrap_ == 0) {
+    ScrollRows(kDropped + viewport.line, viewport.column, kContentRows);
+  }
 
-  std::ostringstream frame;
-  frame << "\x1b[?25l" << "\x1b[H";
-
+  const LineRange& damage = buffer.Damage();
+  // Only rows whose part of the selection changed are drawn again as it
+  // follows the cursor.
+  const std::optional<Selection> kSelection = state.GetSelection();
+  std::size_t line = viewport.line;
+  std::size_t line_row = layout_wrap_ > 0 ? viewport.row : 0;
   for (std::size_t row = 0; row < kContentRows; ++row) {
-    std::ostringstream line_stream;
-    const std::size_t kLineIndex = scroll_offset_ + row;
-    if (kLineIndex < kTotalLines) {
-      const bool kIsCursorLine = kLineIndex == state.CursorLine();
-      line_stream << (kIsCursorLine ? "> " : "  ");
-      line_stream << std::setw(static_cast<int>(kLineDigits))
-                  << (kLineIndex + 1) << ' ' << buffer.GetLine(kLineIndex);
+    Row& cached = rows_[row];
+    const bool kIsText = line < kTotalLines;
+    const std::size_t kColumn =
+        layout_wrap_ > 0 ? line_row * layout_wrap_ : viewport.column;
+    const bool kIsCursorLine = kIsText && line == state.CursorLine();
+    const LexState kSyntax = kIsText ? highlighter.StateAt(buffer, line) : 0;
+    const SelectedBytes kSelected =
+        kIsText && kSelection && kSelection->Covers(line)
+            ? SelectedIn(*kSelection, line, buffer.GetLine(line),
+                         options.tabstop, selection_layout_)
+            : SelectedBytes{};
+    bool continues = false;
+    if (cached.valid && cached.line == kDropped + line &&
+        cached.column == kColumn &&
+        cached.cursor_line == kIsCursorLine && cached.syntax == kSyntax &&
+        cached.selected == kSelected && !damage.Contains(line)) {
+      continues = cached.continues;
     } else {
-      line_stream << "  " << std::string(kLineDigits, ' ') << ' ' << '~';
+      scratch_.Clear();
+      if (kIsText) {
+        if (line_row == 0) {
+          scratch_.Append(kIsCursorLine ? "> " : "  ");
+          scratch_.AppendNumber(kDropped + line + 1, kLineDigits);
+        } else {
+          scratch_.AppendRepeated(' ', 2 + kLineDigits);
+        }
+        scratch_.Append(' ');
+
+        const std::string_view kText = buffer.GetLine(line);
+        LineLayout& layout = LayoutOf(buffer, line);
+        const std::size_t kEnd = kColumn + kTextWidth;
+        const std::size_t kLastByte =
+            CollectGlyphs(kText, layout, kColumn, kEnd);
+        if (kLastByte <= kSyntaxMaxBytes) {
+          highlighter.Tokenize(buffer, line, tokens_, kLastByte);
+        } else {
+          tokens_.clear();
+        }
+        AppendGlyphs(kText, kColumn, kEnd, tokens_, highlight_.get(),
+                     kSelected);
+        continues = layout_wrap_ > 0 &&
+                    layout.Locate(kText, kColumn + layout_wrap_).length > 0;
+      } else {
+        scratch_.Append("  ");
+        scratch_.AppendRepeated(' ', kLineDigits);
+        scratch_.Append(" ~");
+      }
+      // Only a prefix wider than the screen is left to cut.
+      scratch_.Truncate(kTextWidth > 0 ? scratch_.Size() : kTotalColumns);
+
+      AppendRowUpdate(output_, row, cached.text.View(), scratch_.View());
+      cached.line = kDropped + line;
+      cached.column = kColumn;
+      cached.continues = continues;
+      cached.cursor_line = kIsCursorLine;
+      cached.syntax = kSyntax;
+      cached.selected = kSelected;
+      cached.valid = true;
+      cached.text.Swap(scratch_);
     }
 
-    std::string line_text = FitToWidth(line_stream.str(), kTotalColumns);
-    frame << line_text << "\x1b[K";
-    frame << '\n';
-  }
-
-  if (kContentRows == 0) {
-    frame << "\x1b[K\n";
+    if (continues) {
+      ++line_row;
+      continue;
+    }
+    line_row = 0;
+    ++line;
   }
+  // Layouts of lines scrolled out of view go; the rest stay for rows that
+  // may need drawing again.
+  const std::size_t kFirstShown = viewport.line;
+  const std::size_t kLastShown = line_row > 0 ? line : line - 1;
+  std::erase_if(layouts_, [kFirstShown, kLastShown](const CachedLayout& entry) {
+    return entry.line < kFirstShown || entry.line > kLastShown;
+  });
 
   const StatusSeverity kSeverity = state.StatusLevel();
   const bool kHighlightStatus = IsHighlightSeverity(kSeverity);
 
+  scratch_.Clear();
   if (kHighlightStatus) {
-    std::string highlight_text = FitToWidth(state.Status(), kTotalColumns);
-    const std::string& color = HighlightColor(theme_, kSeverity);
-    const std::size_t kPadding = kTotalColumns > highlight_text.size()
-                                     ? kTotalColumns - highlight_text.size()
-                                     : 0;
-    frame << color << highlight_text;
-    if (kPadding > 0) {
-      frame << std::string(kPadding, ' ');
-    }
-    frame << theme_.reset << "\x1b[K" << '\n';
+    scratch_.Append(HighlightColor(theme_, kSeverity));
+    const std::size_t kTextStart = scratch_.Size();
+    scratch_.AppendClipped(state.Status(), kTextStart + kTotalColumns);
+    scratch_.AppendRepeated(' ',
+                            kTotalColumns - (scratch_.Size() - kTextStart));
+    scratch_.Append(theme_.reset);
   } else {
-    std::ostringstream status_stream;
-    const std::string kFileLabel =
-        buffer.FilePath().empty() ? "[No Name]" : buffer.FilePath();
-    status_stream << ModeLabel(state.CurrentMode()) << ' ' << kFileLabel;
+    scratch_.Append(
+        ModeLabel(state.CurrentMode(), state.GetSelectionKind()));
+    scratch_.Append(' ');
+    scratch_.Append(buffer.FilePath().empty()
+                        ? std::string_view("[No Name]")
+                        : std::string_view(buffer.FilePath()));
     if (buffer.IsDirty()) {
-      status_stream << " [+]";
+      scratch_.Append(" [+]");
+    }
+    if (buffer.IsReadOnly()) {
+      scratch_.Append(" [RO]");
     }
-    status_stream << "  Ln " << (state.CursorLine() + 1) << ", Col "
-                  << (state.CursorColumn() + 1) << "  Lines " << kTotalLines;
-    frame << FitToWidth(status_stream.str(), kTotalColumns) << "\x1b[K" << '\n';
+    if (buffer.GetLineEnding() == core::LineEnding::kCrLf) {
+      scratch_.Append(" [dos]");
+    }
+    if (!buffer.IsIndexing()) {
+      scratch_.Append(EncodingLabel(buffer.GetTextStats().encoding));
+    }
+    scratch_.Append("  Ln ");
+    scratch_.AppendNumber(kDropped + state.CursorLine() + 1);
+    scratch_.Append(", Col ");
+    scratch_.AppendNumber(state.CursorColumn() + 1);
+    scratch_.Append("  Lines ");
+    scratch_.AppendNumber(kDropped + kTotalLines);
+    if (buffer.IsIndexing()) {
+      scratch_.Append('+');
+    }
+    scratch_.Truncate(kTotalColumns);
   }
+  Row& status_row = rows_[kContentRows];
+  AppendRowUpdate(output_, kContentRows, status_row.text.View(),
+                  scratch_.View());
+  status_row.text.Swap(scratch_);
 
-  std::string message_line;
+  scratch_.Clear();
   if (state.CurrentMode() == Mode::kCommandLine) {
-    message_line = std::string(1, command_prefix) + std::string(command_buffer);
+    scratch_.Append(command_prefix);
+    scratch_.Append(command_buffer);
   } else if (kSeverity == StatusSeverity::kInfo) {
-    message_line = state.Status();
+    scratch_.AppendClipped(state.Status(), kTotalColumns);
+  } else if (state.ShowsProfile()) {
+    Profiler::Shared().Summarize(profile_line_);
+    scratch_.AppendClipped(profile_line_, kTotalColumns);
   }
-  frame << FitToWidth(message_line, kTotalColumns) << "\x1b[K";
-
-  frame << "\x1b[J";
+  scratch_.Truncate(kTotalColumns);
+  Row& message_row = rows_[kContentRows + 1];
+  AppendRowUpdate(output_, kContentRows + 1, message_row.text.View(),
+                  scratch_.View());
+  message_row.text.Swap(scratch_);
 
   Cursor cursor;
   if (state.CurrentMode() == Mode::kCommandLine) {
     cursor.row = kContentRows + 2;
     cursor.column = 1 + 1 + command_buffer.size();
   } else {
-    if (kContentRows == 0) {
-      cursor.row = 1;
-    } else {
-      const std::size_t kRelativeLine =
-          state.CursorLine() < scroll_offset_
-              ? 0
-              : state.CursorLine() - scroll_offset_;
-      cursor.row = std::min<std::size_t>(kRelativeLine + 1, kContentRows);
-    }
-    cursor.column = kPrefixWidth + state.CursorColumn() + 1;
+    cursor.row = std::min<std::size_t>(cursor_row_ + 1, kContentRows);
+    cursor.column = kPrefixWidth + cursor_cell_ + 1;
   }
 
   cursor.row = std::max<std::size_t>(1, cursor.row);
@@ -190,18 +382,30 @@ void Renderer::Render(const EditorState& state, std::string_view command_buffer,
     cursor.column = kTotalColumns;
   }
 
-  const std::string kFrameContent = frame.str();
-  if (kFrameContent != previous_frame_) {
-    if (first_render_) {
-      std::cout << "\x1b[2J";
+  const bool kHasUpdates = output_.Size() > kHeaderSize;
+  if (!kHasUpdates) {
+    if (cursor.row == cursor_.row && cursor.column == cursor_.column) {
+      return false;
     }
-    std::cout << kFrameContent;
-    previous_frame_ = kFrameContent;
+    output_.Clear();
   }
 
-  std::cout << "\x1b[" << cursor.row << ';' << cursor.column << 'H'
-            << "\x1b[?25h" << std::flush;
+  output_.Append("\x1b[");
+  output_.AppendNumber(cursor.row);
+  output_.Append(';');
+  output_.AppendNumber(cursor.column);
+  output_.Append('H');
+  output_.Append("\x1b[?25h");
+  allocations_ += StorageGrowths() - kGrowthsBefore;
+
+  cursor_ = cursor;
   first_render_ = false;
+  return true;
+}
+
+void Renderer::SetSink(TerminalSink& sink) {
+  sink_ = &sink;
+  Invalidate();
 }
 
 void Renderer::SetTheme(const Theme& theme) {
@@ -212,36 +416,361 @@ const Theme& Renderer::GetTheme() const noexcept {
   return theme_;
 }
 
-void Renderer::UpdateScroll(const EditorState& state,
-                            std::size_t content_rows) {
-  if (content_rows == 0) {
-    scroll_offset_ = 0;
+void Renderer::Invalidate() {
+  rows_.clear();
+  first_render_ = true;
+}
+
+std::uint64_t Renderer::AllocationCount() const noexcept {
+  return allocations_;
+}
+
+std::uint64_t Renderer::StorageGrowths() const noexcept {
+  std::uint64_t growths = output_.Growths() + scratch_.Growths();
+  for (const Row& row : rows_) {
+    growths += row.text.Growths();
+  }
+  return growths;
+}
+
+bool Renderer::SyncLayouts(const EditorState& state, std::size_t tabstop,
+                           std::size_t wrap_width) {
+  const std::size_t kDropped = state.GetBuffer().DroppedLines();
+  if (layouts_buffer_ == state.BufferId() && layout_tabstop_ == tabstop &&
+      layout_wrap_ == wrap_width && layout_dropped_ == kDropped) {
+    const LineRange& damage = state.GetBuffer().Damage();
+    std::erase_if(layouts_, [&damage](const CachedLayout& entry) {
+      return damage.Contains(entry.line);
+    });
+    return false;
+  }
+  // Lines dropped from the top move the rest without changing how the rows
+  // are laid out.
+  const bool kRelaidOut = layouts_buffer_ != state.BufferId() ||
+                          layout_tabstop_ != tabstop ||
+                          layout_wrap_ != wrap_width;
+  layouts_.clear();
+  layouts_buffer_ = state.BufferId();
+  layout_tabstop_ = tabstop;
+  layout_wrap_ = wrap_width;
+  layout_dropped_ = kDropped;
+  return kRelaidOut;
+}
+
+LineLayout& Renderer::LayoutOf(const Buffer& buffer, std::size_t line) {
+  const std::string_view kText = buffer.GetLine(line);
+  if (kText.size() < kLongLineBytes) {
+    layout_.Reset(kText, layout_tabstop_, layout_wrap_);
+    return layout_;
+  }
+  for (CachedLayout& entry : layouts_) {
+    if (entry.line == line) {
+      return entry.layout;
+    }
+  }
+  CachedLayout& entry = layouts_.emplace_back();
+  entry.line = line;
+  entry.layout.Reset(kText, layout_tabstop_, layout_wrap_);
+  return entry.layout;
+}
+
+std::size_t Renderer::CollectGlyphs(std::string_view line, LineLayout& layout,
+                                    std::size_t first, std::size_t end) {
+  const std::size_t kCapacity = glyphs_.capacity();
+  glyphs_.clear();
+  for (LineLayout::Glyph glyph = layout.Locate(line, first);
+       glyph.length > 0 && glyph.column < end;
+       glyph = layout.Next(line, glyph)) {
+    glyphs_.push_back(glyph);
+  }
+  if (glyphs_.capacity() != kCapacity) {
+    ++allocations_;
+  }
+  return glyphs_.empty() ? 0 : glyphs_.back().byte + glyphs_.back().length;
+}
+
+void Renderer::AppendGlyphs(std::string_view line, std::size_t first,
+                            std::size_t end,
+                            const std::vector<TokenSpan>& tokens,
+                            const Pattern* pattern,
+                            const SelectedBytes& selected) {
+  if (glyphs_.empty()) {
+    if (selected.line_break && line.empty() && first == 0 && end > 0) {
+      scratch_.Append(theme_.selection);
+      scratch_.Append(' ');
+      scratch_.Append(theme_.reset);
+    }
     return;
   }
+  const std::size_t kFirstByte = glyphs_.front().byte;
+  const std::size_t kLastByte = glyphs_.back().byte + glyphs_.back().length;
+  const std::size_t kBytes = kLastByte - kFirstByte;
+  const bool kStyled =
+      pattern != nullptr || !tokens.empty() || selected.start < selected.end;
+  if (kStyled) {
+    if (styles_.capacity() < kBytes) {
+      ++allocations_;
+    }
+    styles_.assign(kBytes, 0);
+  }
+
+  // Styles the bytes of [start, stop) that are in view.
+  const auto kPaint = [this, kFirstByte, kLastByte](
+                          std::size_t start, std::size_t stop,
+                          std::uint8_t style) {
+    start = std::max(start, kFirstByte);
+    stop = std::min(stop, kLastByte);
+    if (start < stop) {
+      std::fill_n(styles_.begin() +
+                      static_cast<std::ptrdiff_t>(start - kFirstByte),
+                  stop - start, style);
+    }
+  };
+  for (const TokenSpan& token : tokens) {
+    if (token.start >= kLastByte) {
+      break;
+    }
+    kPaint(token.start, token.start + token.length,
+           static_cast<std::uint8_t>(token.kind));
+  }
+
+  if (pattern != nullptr) {
+    // Far into a long line, only the text around the window is searched.
+    const std::string_view kSearched = line.substr(0, kLastByte + kSearchReach);
+    std::size_t from =
+        kFirstByte > kSearchReach ? kFirstByte - kSearchReach : 0;
+    PatternMatch match;
+    while (from <= kSearched.size() && pattern->Find(kSearched, from, match) &&
+           match.start < kLastByte) {
+      kPaint(match.start, match.start + match.length, kSearchStyle);
+      from = match.start + std::max<std::size_t>(match.length, 1);
+    }
+  }
+  kPaint(selected.start, selected.end, kSelectionStyle);
 
+  std::size_t column = first;
+  const std::string* color = nullptr;
+  const auto kSetColor = [this, &color](const std::string* next) {
+    if (next == color) {
+      return;
+    }
+    if (color != nullptr) {
+      scratch_.Append(theme_.reset);
+    }
+    if (next != nullptr) {
+      scratch_.Append(*next);
+    }
+    color = next;
+  };
+
+  for (const LineLayout::Glyph& glyph : glyphs_) {
+    if (glyph.column > column) {
+      // Left blank by a wide character that moved to the next row.
+      kSetColor(nullptr);
+      scratch_.AppendRepeated(' ', glyph.column - column);
+    }
+    const std::string* next = nullptr;
+    if (kStyled) {
+      const std::string& style =
+          StyleColor(theme_, styles_[glyph.byte - kFirstByte]);
+      next = style.empty() ? nullptr : &style;
+    }
+    kSetColor(next);
+
+    const std::size_t kStart = std::max(glyph.column, first);
+    const std::size_t kStop = std::min(glyph.column + glyph.cells, end);
+    const char kValue = line[glyph.byte];
+    if (kStart != glyph.column || kStop != glyph.column + glyph.cells ||
+        kValue == '\t') {
+      // Cut by an edge of the window, or a tab.
+      scratch_.AppendRepeated(' ', kStop - kStart);
+    } else if (static_cast<unsigned char>(kValue) < 0x20 || kValue == 0x7F) {
+      scratch_.Append('^');
+      scratch_.Append(static_cast<char>(kValue ^ 0x40));
+    } else if (glyph.length == 1 &&
+               static_cast<unsigned char>(kValue) >= 0x80) {
+      scratch_.Append(kReplacementUtf8);
+    } else {
+      scratch_.Append(line.substr(glyph.byte, glyph.length));
+    }
+    column = std::max(column, kStop);
+  }
+  // A selected line break shows as one cell past the end of the line.
+  if (selected.line_break && kLastByte == line.size() && column < end) {
+    kSetColor(&theme_.selection);
+    scratch_.Append(' ');
+  }
+  kSetColor(nullptr);
+}
+
+void Renderer::AppendRowUpdate(FrameBuffer& output, std::size_t row,
+                               std::string_view previous,
+                               std::string_view next) {
+  if (previous == next) {
+    return;
+  }
+
+  // Rows carrying escape sequences (colored status text) cannot be split by
+  // column and are redrawn whole.
+  const bool kPlain = previous.find('\x1b') == std::string_view::npos &&
+                      next.find('\x1b') == std::string_view::npos;
+  std::size_t prefix = 0;
+  if (kPlain) {
+    const std::size_t kLimit = std::min(previous.size(), next.size());
+    while (prefix < kLimit && previous[prefix] == next[prefix]) {
+      ++prefix;
+    }
+    while (prefix > 0 &&
+           ((prefix < next.size() && IsUtf8Continuation(next[prefix])) ||
+            (prefix < previous.size() &&
+             IsUtf8Continuation(previous[prefix])))) {
+      --prefix;
+    }
+  }
+
+  output.Append("\x1b[");
+  output.AppendNumber(row + 1);
+  output.Append(';');
+  output.AppendNumber(DisplayWidth(next.substr(0, prefix)) + 1);
+  output.Append('H');
+  output.Append(next.substr(prefix));
+  if (!kPlain || DisplayWidth(next) < DisplayWidth(previous)) {
+    output.Append("\x1b[K");
+  }
+}
+
+void Renderer::ScrollRows(std::size_t top, std::size_t column,
+                          std::size_t content_rows) {
+  const Row& first = rows_[0];
+  if (content_rows < 2 || !first.valid || first.line >= top ||
+      top - first.line >= content_rows) {
+    return;
+  }
+  const std::size_t kShift = top - first.line;
+  const Row& kept = rows_[kShift];
+  if (!kept.valid || kept.line != top || kept.column != column) {
+    return;
+  }
+
+  // Limited to the text rows, so the status rows stay put.
+  output_.Append("\x1b[1;");
+  output_.AppendNumber(content_rows);
+  output_.Append("r\x1b[");
+  output_.AppendNumber(kShift);
+  output_.Append("S\x1b[r");
+  const auto kBegin = rows_.begin();
+  std::rotate(kBegin, kBegin + static_cast<std::ptrdiff_t>(kShift),
+              kBegin + static_cast<std::ptrdiff_t>(content_rows));
+  for (std::size_t row = content_rows - kShift; row < content_rows; ++row) {
+    rows_[row].valid = false;
+    rows_[row].text.Clear();
+  }
+}
+
+void Renderer::UpdateScroll(EditorState& state, std::size_t content_rows,
+                            std::size_t text_width) {
   const Buffer& buffer = state.GetBuffer();
   const std::size_t kTotalLines = buffer.LineCount();
+  cursor_row_ = 0;
+  cursor_cell_ = 0;
+  if (content_rows == 0 || kTotalLines == 0) {
+    state.SetViewport({});
+    return;
+  }
 
-  if (kTotalLines == 0) {
-    scroll_offset_ = 0;
+  Viewport viewport = state.GetViewport();
+  viewport.line = (std::min)(viewport.line, kTotalLines - 1);
+  const std::size_t kCursorLine = (std::min)(state.CursorLine(),
+                                             kTotalLines - 1);
+  const std::string_view kCursorText = buffer.GetLine(kCursorLine);
+  LineLayout& cursor_layout = LayoutOf(buffer, kCursorLine);
+  const std::size_t kCursorColumn =
+      cursor_layout.ColumnOf(kCursorText, state.CursorColumn());
+
+  if (layout_wrap_ == 0) {
+    if (kCursorLine < viewport.line) {
+      viewport.line = kCursorLine;
+    } else if (kCursorLine >= viewport.line + content_rows) {
+      viewport.line = kCursorLine - content_rows + 1;
+    }
+    const std::size_t kMaxOffset =
+        kTotalLines > content_rows ? kTotalLines - content_rows : 0;
+    viewport.line = (std::min)(viewport.line, kMaxOffset);
+
+    // Like vim with 'sidescroll' at 0, a cursor leaving the screen sideways
+    // brings it back half a screen.
+    if (kCursorColumn < viewport.column ||
+        kCursorColumn >= viewport.column + text_width) {
+      viewport.column =
+          kCursorColumn > text_width / 2 ? kCursorColumn - text_width / 2 : 0;
+    }
+    viewport.row = 0;
+    cursor_row_ = kCursorLine - viewport.line;
+    cursor_cell_ = kCursorColumn - viewport.column;
+    state.SetViewport(viewport);
     return;
   }
 
-  if (scroll_offset_ >= kTotalLines) {
-    scroll_offset_ = kTotalLines - 1;
+  // Past the end of a line that fills its last row, the cursor stays on it.
+  const std::size_t kCursorRow = (std::min)(
+      kCursorColumn / layout_wrap_,
+      cursor_layout.Rows(kCursorText, kCursorColumn / layout_wrap_ + 1) - 1);
+  cursor_cell_ =
+      (std::min)(kCursorColumn - kCursorRow * layout_wrap_, layout_wrap_ - 1);
+  viewport.column = 0;
+  viewport.row = (std::min)(
+      viewport.row, LayoutOf(buffer, viewport.line)
+                            .Rows(buffer.GetLine(viewport.line),
+                                  viewport.row + 1) -
+                        1);
+
+  if (kCursorLine < viewport.line ||
+      (kCursorLine == viewport.line && kCursorRow < viewport.row)) {
+    // The line goes at the top, from its start if the cursor's row allows.
+    viewport.line = kCursorLine;
+    viewport.row =
+        kCursorRow >= content_rows ? kCursorRow - content_rows + 1 : 0;
+    cursor_row_ = kCursorRow - viewport.row;
+    state.SetViewport(viewport);
+    return;
   }
 
-  const std::size_t kCursorLine = state.CursorLine();
-  if (kCursorLine < scroll_offset_) {
-    scroll_offset_ = kCursorLine;
-  } else if (kCursorLine >= scroll_offset_ + content_rows) {
-    scroll_offset_ = kCursorLine - content_rows + 1;
+  // Rows from the top to the cursor, counted no further than a screen.
+  std::size_t rows = 0;
+  std::size_t line = viewport.line;
+  std::size_t skip = viewport.row;
+  while (line < kCursorLine && rows < content_rows) {
+    rows += LayoutOf(buffer, line)
+                .Rows(buffer.GetLine(line), skip + content_rows - rows) -
+            skip;
+    skip = 0;
+    ++line;
+  }
+  if (line == kCursorLine && rows + kCursorRow - skip < content_rows) {
+    cursor_row_ = rows + kCursorRow - skip;
+    state.SetViewport(viewport);
+    return;
   }
 
-  const std::size_t kMaxOffset =
-      kTotalLines > content_rows ? kTotalLines - content_rows : 0;
-  if (scroll_offset_ > kMaxOffset) {
-    scroll_offset_ = kMaxOffset;
+  // The cursor goes on the last row; the top is found walking up from it.
+  line = kCursorLine;
+  std::size_t row = kCursorRow;
+  std::size_t above = content_rows - 1;
+  while (above > row && line > 0) {
+    above -= row + 1;
+    --line;
+    row = LayoutOf(buffer, line).Rows(buffer.GetLine(line)) - 1;
+  }
+  if (above <= row) {
+    row -= above;
+    above = 0;
+  } else {
+    above -= row;
+    row = 0;
   }
+  viewport.line = line;
+  viewport.row = row;
+  cursor_row_ = content_rows - 1 - above;
+  state.SetViewport(viewport);
 }
 }  // namespace core
@@ -0,0 +1,30 @@
+#include "core/ScriptedKeySource.hpp"
+
+#include "core/KeyNotation.hpp"
+
+namespace core {
+void ScriptedKeySource::Append(std::string_view notation) {
+  if (next_ == events_.size()) {
+    events_.clear();
+    pastes_.clear();
+    next_ = 0;
+  }
+  ParseKeyNotation(notation, events_, pastes_);
+}
+
+bool ScriptedKeySource::Poll(KeyEvent& event) {
+  if (next_ == events_.size()) {
+    return false;
+  }
+  event = events_[next_++];
+  return true;
+}
+
+bool ScriptedKeySource::WaitForInput(const Waker& /*interrupt*/) const {
+  return next_ < events_.size();
+}
+
+std::size_t ScriptedKeySource::Pending() const noexcept {
+  return events_.size() - next_;
+}
+}  // namespace core
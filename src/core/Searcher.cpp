@@ -0,0 +1,454 @@
+#include "core/Searcher.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace {
+using core::PagedText;
+using core::Pattern;
+using core::PatternMatch;
+using core::SearchResult;
+using core::TextPosition;
+using core::TextSnapshot;
+using core::WindowedFile;
+using Cursor = TextSnapshot::Cursor;
+using Run = TextSnapshot::Run;
+
+// Lines between checks for cancellation.
+constexpr std::size_t kCancelInterval = 4096;
+// Bytes a literal is looked for in between those checks.
+constexpr std::size_t kWindowBytes = 1024 * 1024;
+
+std::size_t FindNewline(std::string_view text, std::size_t from) {
+  if (from >= text.size()) {
+    return std::string_view::npos;
+  }
+  const void* kFound =
+      std::memchr(text.data() + from, '\n', text.size() - from);
+  return kFound == nullptr
+             ? std::string_view::npos
+             : static_cast<std::size_t>(static_cast<const char*>(kFound) -
+                                        text.data());
+}
+
+std::size_t CountNewlines(std::string_view text, std::size_t begin,
+                          std::size_t end) {
+  return static_cast<std::size_t>(
+      std::count(text.begin() + static_cast<std::ptrdiff_t>(begin),
+                 text.begin() + static_cast<std::ptrdiff_t>(end), '\n'));
+}
+
+// Moves to the next line, wrapping from the last line to the first.
+bool Advance(const TextSnapshot& snapshot, Cursor& cursor) {
+  if (snapshot.Next(cursor)) {
+    return false;
+  }
+  cursor = {};
+  return true;
+}
+
+// Moves to the previous line, wrapping from the first line to the last.
+bool Retreat(const TextSnapshot& snapshot, Cursor& cursor) {
+  if (cursor.offset > 0) {
+    const std::string_view kText = snapshot.runs[cursor.run].text;
+    const std::size_t kBreak = cursor.offset >= 2
+                                   ? kText.rfind('\n', cursor.offset - 2)
+                                   : std::string_view::npos;
+    cursor.offset = kBreak == std::string_view::npos ? 0 : kBreak + 1;
+    --cursor.line;
+    return false;
+  }
+  const bool kWrapped = cursor.run == 0;
+  cursor.run = kWrapped ? snapshot.runs.size() - 1 : cursor.run - 1;
+  const Run& run = snapshot.runs[cursor.run];
+  const std::size_t kBreak = run.text.rfind('\n');
+  cursor.offset = kBreak == std::string_view::npos ? 0 : kBreak + 1;
+  cursor.line = run.first_line + run.lines - 1;
+  return kWrapped;
+}
+
+SearchResult Found(std::size_t line, const PatternMatch& match,
+                   bool wrapped) {
+  return {.found = true,
+          .wrapped = wrapped,
+          .position = {line, match.start},
+          .length = match.length};
+}
+
+SearchResult ScanForward(const TextSnapshot& snapshot, const Pattern& pattern,
+                         TextPosition from, const std::stop_token& token) {
+  const Cursor kStart = snapshot.Locate(from.line);
+  Cursor cursor = kStart;
+  bool wrapped = false;
+
+  // The starting line is visited twice: after the cursor first, and before
+  // it once the search has come back around.
+  std::size_t visited = 0;
+  while (visited <= snapshot.line_count) {
+    if (visited % kCancelInterval == 0 && token.stop_requested()) {
+      return {};
+    }
+
+    const Run& run = snapshot.runs[cursor.run];
+    const bool kFirst = visited == 0;
+    const bool kLast = visited == snapshot.line_count;
+
+    // Between the ends, a literal is looked for across many lines at once
+    // instead of line by line. Windows end at a line break, and are bounded
+    // so cancellation stays prompt.
+    if (pattern.IsLiteral() && !kFirst && !kLast && run.lines > 1) {
+      std::size_t limit = wrapped && cursor.run == kStart.run
+                              ? kStart.offset
+                              : run.text.size();
+      if (limit - cursor.offset > kWindowBytes) {
+        const std::size_t kBreak =
+            FindNewline(run.text, cursor.offset + kWindowBytes);
+        if (kBreak < limit) {
+          limit = kBreak + 1;
+        }
+      }
+
+      const std::size_t kHit =
+          pattern.FindLiteral(run.text.substr(0, limit), cursor.offset);
+      if (kHit != std::string_view::npos) {
+        const std::size_t kLine =
+            cursor.line + CountNewlines(run.text, cursor.offset, kHit);
+        const std::size_t kBreak =
+            kHit > 0 ? run.text.rfind('\n', kHit - 1) : std::string_view::npos;
+        const std::size_t kLineStart =
+            kBreak == std::string_view::npos ? 0 : kBreak + 1;
+        PatternMatch match;
+        pattern.Find(snapshot.LineAt({cursor.run, kLineStart, kLine}),
+                     kHit - kLineStart, match);
+        return Found(kLine, match, wrapped);
+      }
+
+      const std::size_t kSkipped =
+          CountNewlines(run.text, cursor.offset, limit);
+      visited += kSkipped;
+      cursor.line += kSkipped;
+      if (limit < run.text.size()) {
+        cursor.offset = limit;
+        if (token.stop_requested()) {
+          return {};
+        }
+        continue;
+      }
+      cursor.offset = run.text.rfind('\n') + 1;
+    }
+
+    const std::string_view kLine = snapshot.LineAt(cursor);
+    const std::size_t kBegin = kFirst ? from.column + 1 : 0;
+    PatternMatch match;
+    if (kBegin <= kLine.size() && pattern.Find(kLine, kBegin, match) &&
+        (!kLast || match.start <= from.column)) {
+      return Found(cursor.line, match, wrapped);
+    }
+
+    wrapped = Advance(snapshot, cursor) || wrapped;
+    ++visited;
+  }
+  return {};
+}
+
+SearchResult ScanBackward(const TextSnapshot& snapshot, const Pattern& pattern,
+                          TextPosition from, const std::stop_token& token) {
+  Cursor cursor = snapshot.Locate(from.line);
+  bool wrapped = false;
+
+  for (std::size_t visited = 0; visited <= snapshot.line_count; ++visited) {
+    if (visited % kCancelInterval == 0 && token.stop_requested()) {
+      return {};
+    }
+
+    const std::string_view kLine = snapshot.LineAt(cursor);
+    const bool kFirst = visited == 0;
+    const bool kLast = visited == snapshot.line_count;
+    PatternMatch match;
+    if (pattern.FindLast(kLine, kFirst ? from.column : kLine.size() + 1,
+                         match) &&
+        (!kLast || match.start >= from.column)) {
+      return Found(cursor.line, match, wrapped);
+    }
+
+    wrapped = Retreat(snapshot, cursor) || wrapped;
+  }
+  return {};
+}
+
+// Paged files are read a line, or for a literal as many lines as one read
+// holds, at a time; `start` is always at the start of the line numbered
+// `line`.
+SearchResult ScanPagedForward(const PagedText& text, WindowedFile& file,
+                              const Pattern& pattern, TextPosition from,
+                              const std::stop_token& token) {
+  const std::uint64_t kFrom = text.LineStart(from.line, file);
+  std::uint64_t start = 0;
+  const std::uint64_t kFromEnd = text.LineEnd(kFrom, file, &start);
+  PatternMatch match;
+  std::string_view line = text.LineText(kFrom, kFromEnd, file);
+  if (from.column + 1 <= line.size() &&
+      pattern.Find(line, from.column + 1, match)) {
+    return Found(from.line, match, false);
+  }
+
+  std::size_t number = from.line + 1;
+  bool wrapped = false;
+  while (!token.stop_requested()) {
+    if (start >= text.Size()) {
+      wrapped = true;
+      start = 0;
+      number = 0;
+    }
+    // Back around at the starting line: only what is before the cursor is
+    // left.
+    if (wrapped && start >= kFrom) {
+      line = text.LineText(kFrom, kFromEnd, file);
+      if (pattern.Find(line, 0, match) && match.start <= from.column) {
+        return Found(from.line, match, true);
+      }
+      return {};
+    }
+
+    const std::uint64_t kLimit = wrapped ? kFrom : text.Size();
+    if (pattern.IsLiteral()) {
+      std::string_view chunk = file.Read(
+          start, static_cast<std::size_t>((std::min)(
+                     std::uint64_t{WindowedFile::kReadBytes}, kLimit - start)));
+      if (start + chunk.size() < kLimit) {
+        const std::size_t kBreak = chunk.rfind('\n');
+        chunk = kBreak == std::string_view::npos ? std::string_view{}
+                                                 : chunk.substr(0, kBreak + 1);
+      }
+      if (!chunk.empty()) {
+        const std::size_t kHit = pattern.FindLiteral(chunk, 0);
+        if (kHit == std::string_view::npos) {
+          number += CountNewlines(chunk, 0, chunk.size());
+          start += chunk.size();
+          continue;
+        }
+        const std::size_t kBreak =
+            kHit > 0 ? chunk.rfind('\n', kHit - 1) : std::string_view::npos;
+        const std::size_t kLineStart =
+            kBreak == std::string_view::npos ? 0 : kBreak + 1;
+        number += CountNewlines(chunk, 0, kLineStart);
+        start += kLineStart;
+        // Found unless it is past what is read of a very long line.
+        std::uint64_t next = 0;
+        line = text.LineText(start, text.LineEnd(start, file, &next), file);
+        if (pattern.Find(line, kHit - kLineStart, match)) {
+          return Found(number, match, wrapped);
+        }
+        start = next;
+        ++number;
+        continue;
+      }
+    }
+
+    std::uint64_t next = 0;
+    line = text.LineText(start, text.LineEnd(start, file, &next), file);
+    if (pattern.Find(line, 0, match)) {
+      return Found(number, match, wrapped);
+    }
+    start = next;
+    ++number;
+  }
+  return {};
+}
+
+// Line numbers are counted down until the search wraps to the end of the
+// file; from there, a match's line is found from the checkpoints.
+SearchResult ScanPagedBackward(const PagedText& text, WindowedFile& file,
+                               const Pattern& pattern, TextPosition from,
+                               const std::stop_token& token) {
+  const std::uint64_t kFrom = text.LineStart(from.line, file);
+  const std::uint64_t kFromEnd = text.LineEnd(kFrom, file);
+  PatternMatch match;
+  std::string_view line = text.LineText(kFrom, kFromEnd, file);
+  if (pattern.FindLast(line, from.column, match)) {
+    return Found(from.line, match, false);
+  }
+
+  std::uint64_t start = kFrom;
+  std::size_t number = from.line;
+  bool wrapped = false;
+  while (!token.stop_requested()) {
+    if (start == 0) {
+      if (wrapped || text.Size() == 0) {
+        return {};
+      }
+      wrapped = true;
+      start = text.LineStartAt(text.Size() - 1, file);
+    } else {
+      start = text.LineStartAt(start - 1, file);
+      --number;
+    }
+
+    if (wrapped && start <= kFrom) {
+      line = text.LineText(kFrom, kFromEnd, file);
+      if (pattern.FindLast(line, line.size() + 1, match) &&
+          match.start >= from.column) {
+        return Found(from.line, match, true);
+      }
+      return {};
+    }
+
+    line = text.LineText(start, text.LineEnd(start, file), file);
+    if (pattern.FindLast(line, line.size() + 1, match)) {
+      return Found(wrapped ? text.LineAt(start, file) : number, match,
+                   wrapped);
+    }
+  }
+  return {};
+}
+
+// Looks for the `count`th match, each from where the one before it was.
+template <typename ScanOnce>
+SearchResult ScanRepeated(TextPosition from, std::size_t count,
+                          const ScanOnce& scan) {
+  SearchResult result;
+  TextPosition position = from;
+  bool wrapped = false;
+  for (std::size_t i = 0; i < (std::max)(count, std::size_t{1}); ++i) {
+    result = scan(position);
+    if (!result.found) {
+      break;
+    }
+    wrapped = wrapped || result.wrapped;
+    position = result.position;
+  }
+  result.wrapped = result.found && wrapped;
+  return result;
+}
+}  // namespace
+
+namespace core {
+Searcher::~Searcher() {
+  Cancel();
+}
+
+void Searcher::SetWakeHook(std::function<void()> hook) {
+  wake_hook_ = std::move(hook);
+}
+
+bool Searcher::Start(TextSnapshot snapshot,
+                     std::shared_ptr<const Pattern> pattern, TextPosition from,
+                     bool backward, std::size_t count) {
+  Cancel();
+  if (snapshot.runs.empty() || pattern == nullptr) {
+    Finish({});
+    return true;
+  }
+  from.line = (std::min)(from.line, snapshot.line_count - 1);
+
+  auto search = [snapshot = std::move(snapshot), pattern, from, backward,
+                 count](const std::stop_token& token) {
+    return ScanRepeated(from, count, [&](TextPosition position) {
+      return Scan(snapshot, *pattern, position, backward, token);
+    });
+  };
+
+  if (snapshot.bytes <= kInlineBytes) {
+    Finish(search(std::stop_token{}));
+    return true;
+  }
+  StartWorker(std::move(search));
+  return false;
+}
+
+bool Searcher::Start(std::shared_ptr<const PagedText> text,
+                     std::shared_ptr<const Pattern> pattern, TextPosition from,
+                     bool backward, std::size_t count) {
+  Cancel();
+  if (text == nullptr || pattern == nullptr) {
+    Finish({});
+    return true;
+  }
+  StartWorker([text = std::move(text), pattern, from, backward,
+               count](const std::stop_token& token) {
+    WindowedFile file(2);
+    if (!file.Open(text->Path())) {
+      return SearchResult{};
+    }
+    return ScanRepeated(from, count, [&](TextPosition position) {
+      return Scan(*text, file, *pattern, position, backward, token);
+    });
+  });
+  return false;
+}
+
+void Searcher::StartWorker(Search search) {
+  running_.store(true);
+  worker_ = std::jthread([this, search = std::move(search)](
+                             const std::stop_token& token) {
+    const SearchResult kResult = search(token);
+    if (token.stop_requested()) {
+      return;
+    }
+    Finish(kResult);
+    if (wake_hook_) {
+      wake_hook_();
+    }
+  });
+}
+
+void Searcher::Cancel() {
+  if (worker_.joinable()) {
+    worker_.request_stop();
+    worker_.join();
+  }
+  running_.store(false);
+  const std::lock_guard<std::mutex> kLock(mutex_);
+  ready_ = false;
+}
+
+bool Searcher::TakeResult(SearchResult& result) {
+  const std::lock_guard<std::mutex> kLock(mutex_);
+  if (!ready_) {
+    return false;
+  }
+  result = result_;
+  ready_ = false;
+  return true;
+}
+
+bool Searcher::IsRunning() const noexcept {
+  return running_.load();
+}
+
+SearchResult Searcher::Scan(const TextSnapshot& snapshot,
+                            const Pattern& pattern, TextPosition from,
+                            bool backward, const std::stop_token& token) {
+  if (snapshot.runs.empty()) {
+    return {};
+  }
+  from.line = (std::min)(from.line, snapshot.line_count - 1);
+  return backward ? ScanBackward(snapshot, pattern, from, token)
+                  : ScanForward(snapshot, pattern, from, token);
+}
+
+SearchResult Searcher::Scan(const PagedText& text, WindowedFile& file,
+                            const Pattern& pattern, TextPosition from,
+                            bool backward, const std::stop_token& token) {
+  return backward ? ScanPagedBackward(text, file, pattern, from, token)
+                  : ScanPagedForward(text, file, pattern, from, token);
+}
+
+void Searcher::Finish(const SearchResult& result) {
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    result_ = result;
+    ready_ = true;
+  }
+  running_.store(false);
+}
+}  // namespace core
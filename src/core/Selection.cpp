@@ -0,0 +1,47 @@
+#include "core/Selection.hpp"
+
+#include <algorithm>
+
+#include "core/Utf8.hpp"
+
+namespace core {
+SelectedBytes SelectedIn(const Selection& selection, std::size_t line,
+                         std::string_view text, std::size_t tabstop,
+                         LineLayout& layout) {
+  SelectedBytes selected;
+  if (!selection.Covers(line)) {
+    return selected;
+  }
+
+  switch (selection.kind) {
+    case SelectionKind::kLine:
+      selected.end = text.size();
+      selected.line_break = true;
+      return selected;
+    case SelectionKind::kBlock:
+      layout.Reset(text, tabstop, 0);
+      selected.start = layout.Locate(text, selection.left).byte;
+      selected.end = (std::max)(
+          selected.start, selection.to_line_end
+                              ? text.size()
+                              : layout.Locate(text, selection.right).byte);
+      return selected;
+    case SelectionKind::kCharacter:
+    default:
+      break;
+  }
+
+  if (line == selection.start.line) {
+    selected.start = (std::min)(selection.start.column, text.size());
+  }
+  if (line != selection.end.line || selection.to_line_end ||
+      selection.end.column >= text.size()) {
+    // A cursor at the end of its line, as on an empty one, takes the break.
+    selected.end = text.size();
+    selected.line_break = true;
+  } else {
+    selected.end = NextGrapheme(text, selection.end.column);
+  }
+  return selected;
+}
+}  // namespace core
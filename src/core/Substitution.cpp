@@ -0,0 +1,318 @@
+#include "core/Substitution.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/WorkerPool.hpp"
+
+namespace {
+using core::Pattern;
+using core::PatternMatch;
+using core::Substitution;
+using core::SubstitutionResult;
+using core::TextSnapshot;
+using Cursor = TextSnapshot::Cursor;
+
+// Lines between checks for cancellation and progress updates.
+constexpr std::size_t kProgressInterval = 4096;
+
+// A run of whole lines handed to one worker.
+struct Chunk {
+  Cursor start;
+  std::size_t lines = 0;
+};
+
+// What a worker produced for a chunk: each changed line's number and the end
+// of its new text within `text`.
+struct ChunkOutput {
+  std::vector<std::size_t> lines;
+  std::vector<std::size_t> ends;
+  std::string text;
+  std::size_t substitutions = 0;
+};
+
+std::size_t CountNewlines(std::string_view text, std::size_t begin,
+                          std::size_t end) {
+  return static_cast<std::size_t>(
+      std::count(text.begin() + static_cast<std::ptrdiff_t>(begin),
+                 text.begin() + static_cast<std::ptrdiff_t>(end), '\n'));
+}
+
+// Cuts lines [first, last) into chunks of about kChunkBytes. Only a run
+// larger than a chunk has its lines counted; smaller runs are taken whole.
+std::vector<Chunk> PlanChunks(const TextSnapshot& snapshot, std::size_t first,
+                              std::size_t last, const std::stop_token& token) {
+  std::vector<Chunk> chunks;
+  Cursor cursor = snapshot.Locate(first);
+  Chunk chunk{cursor, 0};
+  std::size_t bytes = 0;
+
+  while (cursor.line < last && !token.stop_requested()) {
+    const TextSnapshot::Run& run = snapshot.runs[cursor.run];
+    const std::size_t kWanted =
+        (std::min)(run.first_line + run.lines, last) - cursor.line;
+    const std::size_t kBudget = Substitution::kChunkBytes - bytes;
+    const std::size_t kCut =
+        run.text.size() - cursor.offset > kBudget
+            ? run.text.find('\n', cursor.offset + kBudget)
+            : std::string_view::npos;
+
+    if (kCut == std::string_view::npos) {
+      chunk.lines += kWanted;
+      cursor.line += kWanted;
+      bytes += run.text.size() - cursor.offset + 1;
+      ++cursor.run;
+      cursor.offset = 0;
+    } else {
+      const std::size_t kLines = (std::min)(
+          kWanted, CountNewlines(run.text, cursor.offset, kCut) + 1);
+      chunk.lines += kLines;
+      cursor.line += kLines;
+      cursor.offset = kCut + 1;
+      bytes = Substitution::kChunkBytes;
+    }
+
+    if (bytes >= Substitution::kChunkBytes) {
+      chunks.push_back(chunk);
+      chunk = {cursor, 0};
+      bytes = 0;
+    }
+  }
+  if (chunk.lines > 0) {
+    chunks.push_back(chunk);
+  }
+  return chunks;
+}
+
+void RunChunk(const TextSnapshot& snapshot, const Pattern& pattern,
+              std::string_view replacement, bool global, const Chunk& chunk,
+              ChunkOutput& output, std::atomic<std::size_t>& lines_done,
+              const std::stop_token& token) {
+  Cursor cursor = chunk.start;
+  std::size_t reported = 0;
+  for (std::size_t i = 0; i < chunk.lines; ++i) {
+    if (i - reported == kProgressInterval) {
+      lines_done.fetch_add(i - reported, std::memory_order_relaxed);
+      reported = i;
+      if (token.stop_requested()) {
+        return;
+      }
+    }
+
+    const std::size_t kMark = output.text.size();
+    const std::size_t kReplaced = Substitution::Apply(
+        pattern, replacement, global, snapshot.LineAt(cursor), output.text);
+    if (kReplaced > 0) {
+      output.lines.push_back(cursor.line);
+      output.ends.push_back(output.text.size());
+      output.substitutions += kReplaced;
+    } else {
+      output.text.resize(kMark);
+    }
+    snapshot.Next(cursor);
+  }
+  lines_done.fetch_add(chunk.lines - reported, std::memory_order_relaxed);
+}
+
+// Joins the chunk outputs in line order. The text is moved into the result
+// before any view of it is taken, so the views stay valid when it moves.
+SubstitutionResult Collect(std::vector<ChunkOutput>& outputs) {
+  SubstitutionResult result;
+  result.finished = true;
+  std::size_t changed = 0;
+  for (const ChunkOutput& output : outputs) {
+    changed += output.lines.size();
+  }
+  result.changes.reserve(changed);
+  result.text.reserve(outputs.size());
+
+  for (ChunkOutput& output : outputs) {
+    if (output.lines.empty()) {
+      continue;
+    }
+    result.text.push_back(std::move(output.text));
+    const std::string& text = result.text.back();
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < output.lines.size(); ++i) {
+      result.changes.push_back(
+          {output.lines[i],
+           std::string_view(text).substr(begin, output.ends[i] - begin)});
+      begin = output.ends[i];
+    }
+    result.substitutions += output.substitutions;
+  }
+  return result;
+}
+}  // namespace
+
+namespace core {
+Substitution::~Substitution() {
+  Cancel();
+}
+
+void Substitution::SetWakeHook(std::function<void()> hook) {
+  wake_hook_ = std::move(hook);
+}
+
+bool Substitution::Start(TextSnapshot snapshot,
+                         std::shared_ptr<const Pattern> pattern,
+                         std::string replacement, std::size_t first,
+                         std::size_t last, bool global) {
+  Cancel();
+  last = (std::min)(last, snapshot.line_count);
+  lines_done_.store(0);
+  lines_total_ = last > first ? last - first : 0;
+  if (lines_total_ == 0 || pattern == nullptr) {
+    Finish({.finished = true});
+    return true;
+  }
+
+  const bool kInline = snapshot.bytes <= kInlineBytes;
+  auto substitute = [this, snapshot = std::move(snapshot), pattern,
+                     replacement = std::move(replacement), first, last,
+                     global](const std::stop_token& token) {
+    const std::vector<Chunk> kChunks =
+        PlanChunks(snapshot, first, last, token);
+    std::vector<ChunkOutput> outputs(kChunks.size());
+
+    // The calling thread works too; pool threads join in only for a large
+    // range.
+    std::size_t threads = 1;
+    if (snapshot.bytes > kInlineBytes) {
+      threads = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1,
+                                        (std::max)(kChunks.size(),
+                                                   std::size_t{1}));
+    }
+    WorkerPool::Shared().ForEach(
+        kChunks.size(), threads - 1, [&](std::size_t index) {
+          if (!token.stop_requested()) {
+            RunChunk(snapshot, *pattern, replacement, global, kChunks[index],
+                     outputs[index], lines_done_, token);
+          }
+        });
+    return token.stop_requested() ? SubstitutionResult{} : Collect(outputs);
+  };
+
+  if (kInline) {
+    Finish(substitute(std::stop_token{}));
+    return true;
+  }
+
+  running_.store(true);
+  worker_ = std::jthread([this, substitute = std::move(substitute)](
+                             const std::stop_token& token) mutable {
+    SubstitutionResult result = substitute(token);
+    if (token.stop_requested()) {
+      return;
+    }
+    Finish(std::move(result));
+    if (wake_hook_) {
+      wake_hook_();
+    }
+  });
+  return false;
+}
+
+void Substitution::Cancel() {
+  if (worker_.joinable()) {
+    worker_.request_stop();
+    worker_.join();
+  }
+  running_.store(false);
+  const std::lock_guard<std::mutex> kLock(mutex_);
+  ready_ = false;
+  result_ = {};
+}
+
+void Substitution::Wait() {
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+bool Substitution::TakeResult(SubstitutionResult& result) {
+  const std::lock_guard<std::mutex> kLock(mutex_);
+  if (!ready_) {
+    return false;
+  }
+  result = std::move(result_);
+  result_ = {};
+  ready_ = false;
+  return true;
+}
+
+bool Substitution::IsRunning() const noexcept {
+  return running_.load();
+}
+
+std::size_t Substitution::LinesDone() const noexcept {
+  return lines_done_.load(std::memory_order_relaxed);
+}
+
+std::size_t Substitution::LinesTotal() const noexcept {
+  return lines_total_;
+}
+
+std::size_t Substitution::Apply(const Pattern& pattern,
+                                std::string_view replacement, bool global,
+                                std::string_view line, std::string& out) {
+  std::size_t replaced = 0;
+  std::size_t copied = 0;
+  std::size_t from = 0;
+  // An empty match right after a replaced one is not replaced again, so
+  // s/x*/-/g turns "axb" into "-a-b-".
+  std::size_t previous_end = std::string_view::npos;
+  PatternMatch match;
+  while (from <= line.size() && pattern.Find(line, from, match)) {
+    if (match.length == 0 && match.start == previous_end) {
+      from = match.start + 1;
+      continue;
+    }
+
+    out.append(line.substr(copied, match.start - copied));
+    const std::string_view kMatched = line.substr(match.start, match.length);
+    for (std::size_t i = 0; i < replacement.size(); ++i) {
+      const char kChr = replacement[i];
+      if (kChr == '&') {
+        out.append(kMatched);
+      } else if (kChr == '\\' && i + 1 < replacement.size()) {
+        ++i;
+        out.push_back(replacement[i] == 't' ? '\t' : replacement[i]);
+      } else {
+        out.push_back(kChr);
+      }
+    }
+    copied = match.start + match.length;
+    previous_end = copied;
+    ++replaced;
+    if (!global) {
+      break;
+    }
+    from = match.length == 0 ? match.start + 1 : copied;
+  }
+
+  if (replaced > 0) {
+    out.append(line.substr(copied));
+  }
+  return replaced;
+}
+
+void Substitution::Finish(SubstitutionResult result) {
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    result_ = std::move(result);
+    ready_ = true;
+  }
+  running_.store(false);
+}
+}  // namespace core
@@ -0,0 +1,334 @@
+#include "core/SwapFile.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#include "core/Varint.hpp"
+#include "io/AtomicFileWriter.hpp"
+
+namespace {
+constexpr std::string_view kMagic = "microvi swap 1\n";
+constexpr char kTextRecord = 'T';
+constexpr char kLineRecord = 'L';
+
+bool ReadSize(std::string_view data, std::size_t& index, std::size_t& size) {
+  std::uint64_t value = 0;
+  if (!core::ReadVarint(data, index, value) || value > SIZE_MAX) {
+    return false;
+  }
+  size = static_cast<std::size_t>(value);
+  return true;
+}
+
+void AppendHeader(std::string& out, const core::FileStamp& base) {
+  out.append(kMagic);
+  core::AppendVarint(out, base.exists ? 1 : 0);
+  core::AppendVarint(out, base.size);
+  core::AppendVarint(out, core::ZigZag(base.modified));
+}
+
+void AppendRecord(std::string& out, const core::SwapRecord& record) {
+  out.push_back(record.whole_lines ? kLineRecord : kTextRecord);
+  core::AppendVarint(out, record.revision);
+  core::AppendVarint(out, record.position.line);
+  core::AppendVarint(out, record.position.column);
+  core::AppendVarint(out, record.removed);
+  core::AppendVarint(out, record.lines);
+  core::AppendVarint(out, record.text.size());
+  out.append(record.text);
+}
+
+bool ReadRecord(std::string_view data, std::size_t& index,
+                core::SwapRecord& record) {
+  if (index >= data.size() ||
+      (data[index] != kTextRecord && data[index] != kLineRecord)) {
+    return false;
+  }
+  record.whole_lines = data[index++] == kLineRecord;
+  std::size_t text_size = 0;
+  if (!core::ReadVarint(data, index, record.revision) ||
+      !ReadSize(data, index, record.position.line) ||
+      !ReadSize(data, index, record.position.column) ||
+      !ReadSize(data, index, record.removed) ||
+      !ReadSize(data, index, record.lines) ||
+      !ReadSize(data, index, text_size) || text_size > data.size() - index) {
+    return false;
+  }
+  record.text.assign(data.substr(index, text_size));
+  index += text_size;
+  return true;
+}
+}  // namespace
+
+namespace core {
+FileStamp FileStamp::Of(const std::string& path) {
+  FileStamp stamp;
+  std::error_code error;
+  const std::uint64_t kSize = std::filesystem::file_size(path, error);
+  if (error) {
+    return stamp;
+  }
+  const auto kModified = std::filesystem::last_write_time(path, error);
+  if (error) {
+    return stamp;
+  }
+  stamp.exists = true;
+  stamp.size = kSize;
+  stamp.modified = static_cast<std::int64_t>(
+      kModified.time_since_epoch().count());
+  return stamp;
+}
+
+SwapFile::~SwapFile() {
+  Stop();
+  file_.Close();
+  if (!path_.empty() && !preserve_) {
+    std::error_code error;
+    std::filesystem::remove(path_, error);
+  }
+}
+
+std::string SwapFile::PathFor(const std::string& file_path) {
+  const std::filesystem::path kPath(file_path);
+  return (kPath.parent_path() / ("." + kPath.filename().string() + ".swp"))
+      .string();
+}
+
+bool SwapFile::Load(const std::string& swap_path, SwapContents& contents) {
+  std::ifstream input(swap_path, std::ios::binary);
+  if (!input.is_open()) {
+    return false;
+  }
+  const std::string kData{std::istreambuf_iterator<char>(input),
+                          std::istreambuf_iterator<char>()};
+  const std::string_view kView(kData);
+  if (!kView.starts_with(kMagic)) {
+    return false;
+  }
+
+  std::size_t index = kMagic.size();
+  std::uint64_t exists = 0;
+  std::uint64_t modified = 0;
+  if (!ReadVarint(kView, index, exists) ||
+      !ReadVarint(kView, index, contents.base.size) ||
+      !ReadVarint(kView, index, modified)) {
+    return false;
+  }
+  contents.base.exists = exists != 0;
+  contents.base.modified = UnZigZag(modified);
+
+  contents.records.clear();
+  SwapRecord record;
+  while (ReadRecord(kView, index, record)) {
+    contents.records.push_back(std::move(record));
+  }
+  return true;
+}
+
+bool SwapFile::Open(const std::string& swap_path, const FileStamp& base) {
+  std::error_code error;
+  std::filesystem::remove(swap_path, error);
+  std::string header;
+  AppendHeader(header, base);
+  if (!file_.Open(swap_path) || !file_.Append(header) || !file_.Sync()) {
+    file_.Close();
+    return false;
+  }
+
+  path_ = swap_path;
+  writer_ =
+      std::jthread([this](const std::stop_token& token) { Run(token); });
+  return true;
+}
+
+const std::string& SwapFile::Path() const noexcept {
+  return path_;
+}
+
+void SwapFile::Record(std::uint64_t revision, TextPosition position,
+                      std::size_t removed, std::string_view inserted) {
+  if (removed == 0 && inserted.empty()) {
+    return;
+  }
+
+  std::scoped_lock lock(mutex_);
+  const bool kWake = pending_.empty();
+  if (sealed_ || !Merge(revision, position, removed, inserted)) {
+    SwapRecord& record = pending_.emplace_back();
+    record.revision = revision;
+    record.position = position;
+    record.removed = removed;
+    record.text.assign(inserted);
+  }
+  sealed_ = false;
+  if (kWake) {
+    wake_.notify_one();
+  }
+}
+
+void SwapFile::RecordLines(std::uint64_t revision, std::size_t line,
+                           std::size_t removed, const LineSlice& inserted) {
+  SwapRecord record;
+  record.revision = revision;
+  record.whole_lines = true;
+  record.position = {line, 0};
+  record.removed = removed;
+  record.lines = inserted.LineCount();
+  bool first = true;
+  inserted.ForEachLine([&record, &first](std::string_view text) {
+    if (!first) {
+      record.text.push_back('\n');
+    }
+    record.text.append(text);
+    first = false;
+  });
+
+  std::scoped_lock lock(mutex_);
+  const bool kWake = pending_.empty();
+  pending_.push_back(std::move(record));
+  sealed_ = false;
+  if (kWake) {
+    wake_.notify_one();
+  }
+}
+
+void SwapFile::Seal() {
+  std::scoped_lock lock(mutex_);
+  sealed_ = true;
+}
+
+void SwapFile::MarkSaved(std::uint64_t revision, const FileStamp& base) {
+  std::scoped_lock lock(mutex_);
+  saved_ = Saved{revision, base};
+  sealed_ = true;
+  wake_.notify_one();
+}
+
+void SwapFile::Preserve() {
+  Stop();
+  std::vector<SwapRecord> records;
+  std::optional<Saved> saved;
+  {
+    std::scoped_lock lock(mutex_);
+    records.swap(pending_);
+    saved.swap(saved_);
+    preserve_ = true;
+  }
+  Write(records, saved);
+  file_.Close();
+}
+
+bool SwapFile::Merge(std::uint64_t revision, TextPosition position,
+                     std::size_t removed, std::string_view inserted) {
+  if (pending_.empty() || pending_.back().whole_lines) {
+    return false;
+  }
+  SwapRecord& last = pending_.back();
+  const TextPosition kLastEnd = PositionAfter(last.position, last.text);
+
+  if (removed == 0 && position == kLastEnd) {
+    last.text.append(inserted);
+    last.revision = revision;
+    return true;
+  }
+
+  if (inserted.empty() && removed <= last.text.size() &&
+      PositionAfter(last.position,
+                    std::string_view(last.text)
+                        .substr(0, last.text.size() - removed)) == position) {
+    last.text.resize(last.text.size() - removed);
+    last.revision = revision;
+    if (last.text.empty() && last.removed == 0) {
+      pending_.pop_back();
+    }
+    return true;
+  }
+
+  if (inserted.empty() && last.text.empty() && position == last.position) {
+    last.removed += removed;
+    last.revision = revision;
+    return true;
+  }
+  return false;
+}
+
+void SwapFile::Run(const std::stop_token& token) {
+  std::vector<SwapRecord> records;
+  std::optional<Saved> saved;
+  while (!token.stop_requested()) {
+    {
+      std::unique_lock lock(mutex_);
+      if (!wake_.wait(lock, token,
+                      [this] { return !pending_.empty() || saved_; })) {
+        return;
+      }
+      // Whatever arrives meanwhile goes out in the same write.
+      wake_.wait_for(lock, token, kFlushInterval, [] { return false; });
+      if (token.stop_requested()) {
+        return;
+      }
+      records.swap(pending_);
+      saved.swap(saved_);
+    }
+    Write(records, saved);
+    records.clear();
+    saved.reset();
+  }
+}
+
+void SwapFile::Stop() {
+  if (writer_.joinable()) {
+    writer_.request_stop();
+    writer_.join();
+  }
+}
+
+void SwapFile::Write(std::vector<SwapRecord>& records,
+                     const std::optional<Saved>& saved) {
+  if (failed_ || path_.empty()) {
+    return;
+  }
+  if (saved.has_value()) {
+    failed_ = !Rewrite(records, *saved);
+    return;
+  }
+  if (records.empty()) {
+    return;
+  }
+
+  std::string data;
+  for (const SwapRecord& record : records) {
+    AppendRecord(data, record);
+  }
+  failed_ = !file_.Append(data) || !file_.Sync();
+}
+
+bool SwapFile::Rewrite(std::vector<SwapRecord>& records,
+                       const Saved& saved) {
+  SwapContents contents;
+  Load(path_, contents);
+
+  std::string data;
+  AppendHeader(data, saved.base);
+  for (const std::vector<SwapRecord>* list : {&contents.records, &records}) {
+    for (const SwapRecord& record : *list) {
+      if (record.revision > saved.revision) {
+        AppendRecord(data, record);
+      }
+    }
+  }
+
+  // Windows cannot rename over a file that is open.
+  file_.Close();
+  AtomicFileWriter writer;
+  if (!writer.Open(path_)) {
+    return false;
+  }
+  writer.Append(data);
+  return writer.Commit() && file_.Open(path_);
+}
+}  // namespace core
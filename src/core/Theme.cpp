@@ -3,9 +3,17 @@
 namespace core {
 Theme DefaultTheme() {
   Theme theme;
-  theme.status_info = "\x1b[30;47m";     // black on white
-  theme.status_warning = "\x1b[30;43m";  // black on yellow
-  theme.status_error = "\x1b[97;41m";    // bright white on red
+  theme.status_info = "\x1b[30;47m";       // black on white
+  theme.status_warning = "\x1b[30;43m";    // black on yellow
+  theme.status_error = "\x1b[97;41m";      // bright white on red
+  theme.search_match = "\x1b[30;103m";     // black on bright yellow
+  theme.selection = "\x1b[7m";             // reverse video
+  theme.syntax_keyword = "\x1b[94m";       // bright blue
+  theme.syntax_type = "\x1b[32m";          // green
+  theme.syntax_string = "\x1b[31m";        // red
+  theme.syntax_number = "\x1b[35m";        // magenta
+  theme.syntax_comment = "\x1b[36m";       // cyan
+  theme.syntax_preprocessor = "\x1b[95m";  // bright magenta
   theme.reset = "\x1b[0m";
   return theme;
 }
@@ -0,0 +1,240 @@
+#include "core/UndoJournal.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+
+namespace core {
+UndoJournal::UndoJournal(std::size_t byte_limit, std::size_t step_limit)
+    : byte_limit_(byte_limit),
+      step_limit_((std::max)(step_limit, std::size_t{1})) {}
+
+void UndoJournal::Clear() noexcept {
+  bytes_.clear();
+  records_.clear();
+  line_edits_.clear();
+  line_edit_bytes_ = 0;
+  step_starts_.clear();
+  applied_ = 0;
+  saved_ = 0;
+  open_ = false;
+}
+
+void UndoJournal::Record(TextPosition position, std::string_view removed,
+                         std::string_view inserted) {
+  if (removed.empty() && inserted.empty()) {
+    return;
+  }
+
+  DiscardRedo();
+  if (open_ && Coalesce(position, removed, inserted)) {
+    return;
+  }
+
+  OpenStep();
+  records_.push_back({.position = position,
+                      .offset = bytes_.size(),
+                      .removed = removed.size(),
+                      .inserted = inserted.size()});
+  bytes_.append(removed);
+  bytes_.append(inserted);
+  Trim();
+}
+
+void UndoJournal::RecordLines(std::size_t line, LineSlice removed,
+                              LineSlice inserted) {
+  if (removed.Empty() && inserted.Empty()) {
+    return;
+  }
+
+  DiscardRedo();
+  OpenStep();
+  records_.push_back({.position = {line, 0},
+                      .offset = bytes_.size(),
+                      .line_edit = line_edits_.size()});
+  line_edit_bytes_ += removed.MemoryUsage() + inserted.MemoryUsage();
+  line_edits_.push_back({std::move(removed), std::move(inserted)});
+  Trim();
+}
+
+void UndoJournal::CloseStep() noexcept {
+  open_ = false;
+}
+
+bool UndoJournal::CanUndo() const noexcept {
+  return applied_ > 0;
+}
+
+bool UndoJournal::CanRedo() const noexcept {
+  return applied_ < step_starts_.size();
+}
+
+void UndoJournal::MarkSaved() noexcept {
+  saved_ = applied_;
+  open_ = false;
+}
+
+bool UndoJournal::AtSaved() const noexcept {
+  return saved_ == applied_;
+}
+
+std::size_t UndoJournal::StepCount() const noexcept {
+  return step_starts_.size();
+}
+
+std::size_t UndoJournal::MemoryUsage() const noexcept {
+  return bytes_.size() + records_.size() * sizeof(Entry) +
+         step_starts_.size() * sizeof(std::size_t) + line_edit_bytes_;
+}
+
+UndoJournal::Edit UndoJournal::MakeEdit(const Entry& record) const noexcept {
+  if (record.line_edit != kNoLineEdit) {
+    const LineEdit& kLines = line_edits_[record.line_edit];
+    return Edit{
+        .position = record.position,
+        .removed_lines = &kLines.removed,
+        .inserted_lines = &kLines.inserted,
+    };
+  }
+
+  const std::string_view kBytes(bytes_);
+  return Edit{
+      .position = record.position,
+      .removed = kBytes.substr(record.offset, record.removed),
+      .inserted = kBytes.substr(record.offset + record.removed,
+                                record.inserted),
+  };
+}
+
+std::size_t UndoJournal::StepEnd(std::size_t step) const noexcept {
+  return step + 1 < step_starts_.size() ? step_starts_[step + 1]
+                                        : records_.size();
+}
+
+bool UndoJournal::Coalesce(TextPosition position, std::string_view removed,
+                           std::string_view inserted) {
+  // The open step always ends with the newest record, whose bytes are the
+  // tail of the arena, so it can grow or shrink in place.
+  Entry& last = records_.back();
+  if (last.line_edit != kNoLineEdit) {
+    return false;
+  }
+  const Edit kLast = MakeEdit(last);
+
+  if (removed.empty() && last.removed == 0 &&
+      position == PositionAfter(last.position, kLast.inserted)) {
+    bytes_.append(inserted);
+    last.inserted += inserted.size();
+    Trim();
+    return true;
+  }
+
+  if (inserted.empty() && last.removed == 0 &&
+      kLast.inserted.ends_with(removed) &&
+      PositionAfter(position, removed) ==
+          PositionAfter(last.position, kLast.inserted)) {
+    bytes_.resize(bytes_.size() - removed.size());
+    last.inserted -= removed.size();
+    if (last.inserted == 0) {
+      records_.pop_back();
+      if (records_.size() == step_starts_.back()) {
+        step_starts_.pop_back();
+        --applied_;
+        open_ = false;
+      }
+    }
+    return true;
+  }
+
+  if (inserted.empty() && last.inserted == 0 && position == last.position) {
+    bytes_.append(removed);
+    last.removed += removed.size();
+    Trim();
+    return true;
+  }
+
+  return false;
+}
+
+void UndoJournal::OpenStep() {
+  if (!open_) {
+    step_starts_.push_back(records_.size());
+    ++applied_;
+    open_ = true;
+  }
+}
+
+void UndoJournal::DiscardRedo() {
+  if (applied_ == step_starts_.size()) {
+    return;
+  }
+
+  if (saved_ > applied_) {
+    saved_ = kNoStep;
+  }
+  const std::size_t kKeptLineEdits = LineEditsBefore(step_starts_[applied_]);
+  for (std::size_t index = kKeptLineEdits; index < line_edits_.size();
+       ++index) {
+    line_edit_bytes_ -= line_edits_[index].removed.MemoryUsage() +
+                        line_edits_[index].inserted.MemoryUsage();
+  }
+  line_edits_.resize(kKeptLineEdits);
+  records_.resize(step_starts_[applied_]);
+  step_starts_.resize(applied_);
+  bytes_.resize(records_.empty() ? 0
+                                 : records_.back().offset +
+                                       records_.back().removed +
+                                       records_.back().inserted);
+  open_ = false;
+}
+
+void UndoJournal::Trim() {
+  // Steps are dropped a quarter at a time so the front of the arena is moved
+  // rarely. The newest step is always kept, however large it is.
+  while (step_starts_.size() > 1 &&
+         (MemoryUsage() > byte_limit_ || step_starts_.size() > step_limit_)) {
+    const std::size_t kDrop =
+        (std::min)(step_starts_.size() - 1,
+                   (std::max)(step_starts_.size() / 4, std::size_t{1}));
+    const std::size_t kFirstRecord = step_starts_[kDrop];
+    const std::size_t kFirstByte = records_[kFirstRecord].offset;
+    const std::size_t kDroppedLineEdits = LineEditsBefore(kFirstRecord);
+
+    bytes_.erase(0, kFirstByte);
+    records_.erase(
+        records_.begin(),
+        records_.begin() + static_cast<std::ptrdiff_t>(kFirstRecord));
+    for (Entry& record : records_) {
+      record.offset -= kFirstByte;
+      if (record.line_edit != kNoLineEdit) {
+        record.line_edit -= kDroppedLineEdits;
+      }
+    }
+    for (std::size_t index = 0; index < kDroppedLineEdits; ++index) {
+      line_edit_bytes_ -= line_edits_[index].removed.MemoryUsage() +
+                          line_edits_[index].inserted.MemoryUsage();
+    }
+    line_edits_.erase(
+        line_edits_.begin(),
+        line_edits_.begin() + static_cast<std::ptrdiff_t>(kDroppedLineEdits));
+    step_starts_.erase(
+        step_starts_.begin(),
+        step_starts_.begin() + static_cast<std::ptrdiff_t>(kDrop));
+    for (std::size_t& start : step_starts_) {
+      start -= kFirstRecord;
+    }
+
+    applied_ -= kDrop;
+    saved_ = saved_ != kNoStep && saved_ >= kDrop ? saved_ - kDrop : kNoStep;
+  }
+}
+
+std::size_t UndoJournal::LineEditsBefore(std::size_t record) const noexcept {
+  for (std::size_t index = record; index < records_.size(); ++index) {
+    if (records_[index].line_edit != kNoLineEdit) {
+      return records_[index].line_edit;
+    }
+  }
+  return line_edits_.size();
+}
+}  // namespace core
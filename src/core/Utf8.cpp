@@ -0,0 +1,357 @@
+#include "core/Utf8.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MICROVI_UTF8_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MICROVI_UTF8_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+struct Range {
+  char32_t first;
+  char32_t last;
+};
+
+// Condensed from Unicode's EastAsianWidth.txt (W and F) and emoji blocks.
+constexpr std::array kWideRanges = {
+    Range{0x1100, 0x115F},   Range{0x231A, 0x231B},   Range{0x2329, 0x232A},
+    Range{0x23E9, 0x23EC},   Range{0x23F0, 0x23F0},   Range{0x23F3, 0x23F3},
+    Range{0x25FD, 0x25FE},   Range{0x2614, 0x2615},   Range{0x2648, 0x2653},
+    Range{0x267F, 0x267F},   Range{0x2693, 0x2693},   Range{0x26A1, 0x26A1},
+    Range{0x26AA, 0x26AB},   Range{0x26BD, 0x26BE},   Range{0x26C4, 0x26C5},
+    Range{0x26CE, 0x26CE},   Range{0x26D4, 0x26D4},   Range{0x26EA, 0x26EA},
+    Range{0x26F2, 0x26F3},   Range{0x26F5, 0x26F5},   Range{0x26FA, 0x26FA},
+    Range{0x26FD, 0x26FD},   Range{0x2705, 0x2705},   Range{0x270A, 0x270B},
+    Range{0x2728, 0x2728},   Range{0x274C, 0x274C},   Range{0x274E, 0x274E},
+    Range{0x2753, 0x2755},   Range{0x2757, 0x2757},   Range{0x2795, 0x2797},
+    Range{0x27B0, 0x27B0},   Range{0x27BF, 0x27BF},   Range{0x2B1B, 0x2B1C},
+    Range{0x2B50, 0x2B50},   Range{0x2B55, 0x2B55},   Range{0x2E80, 0x303E},
+    Range{0x3041, 0x33FF},   Range{0x3400, 0x4DBF},   Range{0x4E00, 0x9FFF},
+    Range{0xA000, 0xA4CF},   Range{0xA960, 0xA97F},   Range{0xAC00, 0xD7A3},
+    Range{0xF900, 0xFAFF},   Range{0xFE10, 0xFE19},   Range{0xFE30, 0xFE6F},
+    Range{0xFF00, 0xFF60},   Range{0xFFE0, 0xFFE6},   Range{0x16FE0, 0x16FE4},
+    Range{0x17000, 0x18CFF}, Range{0x1B000, 0x1B2FF}, Range{0x1F004, 0x1F004},
+    Range{0x1F0CF, 0x1F0CF}, Range{0x1F18E, 0x1F18E}, Range{0x1F191, 0x1F19A},
+    Range{0x1F200, 0x1F2FF}, Range{0x1F300, 0x1F64F}, Range{0x1F680, 0x1F6FF},
+    Range{0x1F7E0, 0x1F7EB}, Range{0x1F90C, 0x1F9FF}, Range{0x1FA70, 0x1FAFF},
+    Range{0x20000, 0x2FFFD}, Range{0x30000, 0x3FFFD},
+};
+
+// Combining marks, joiners and variation selectors.
+constexpr std::array kZeroWidthRanges = {
+    Range{0x0300, 0x036F},   Range{0x0483, 0x0489},   Range{0x0591, 0x05BD},
+    Range{0x0610, 0x061A},   Range{0x064B, 0x065F},   Range{0x0E31, 0x0E31},
+    Range{0x0E34, 0x0E3A},   Range{0x0E47, 0x0E4E},   Range{0x1AB0, 0x1AFF},
+    Range{0x1DC0, 0x1DFF},   Range{0x200B, 0x200F},   Range{0x2028, 0x202E},
+    Range{0x2060, 0x2064},   Range{0x20D0, 0x20FF},   Range{0x302A, 0x302D},
+    Range{0x3099, 0x309A},   Range{0xFE00, 0xFE0F},   Range{0xFE20, 0xFE2F},
+    Range{0xFEFF, 0xFEFF},   Range{0x1F3FB, 0x1F3FF}, Range{0xE0100, 0xE01EF},
+};
+
+struct ClassRange {
+  char32_t first;
+  char32_t last;
+  std::uint32_t word_class;
+};
+
+constexpr std::uint32_t kBlankClass = 0;
+constexpr std::uint32_t kPunctuationClass = 1;
+constexpr std::uint32_t kWordClass = 2;
+constexpr std::uint32_t kEmojiClass = 3;
+
+// Condensed from Vim's utf_class(); anything else non-ASCII is a letter.
+constexpr std::array kClassRanges = {
+    ClassRange{0x00A0, 0x00A0, kBlankClass},
+    ClassRange{0x00A1, 0x00BF, kPunctuationClass},
+    ClassRange{0x00D7, 0x00D7, kPunctuationClass},
+    ClassRange{0x00F7, 0x00F7, kPunctuationClass},
+    ClassRange{0x037E, 0x037E, kPunctuationClass},
+    ClassRange{0x0387, 0x0387, kPunctuationClass},
+    ClassRange{0x055A, 0x055F, kPunctuationClass},
+    ClassRange{0x0589, 0x0589, kPunctuationClass},
+    ClassRange{0x05C0, 0x05C0, kPunctuationClass},
+    ClassRange{0x05C3, 0x05C3, kPunctuationClass},
+    ClassRange{0x05F3, 0x05F4, kPunctuationClass},
+    ClassRange{0x060C, 0x060C, kPunctuationClass},
+    ClassRange{0x061B, 0x061B, kPunctuationClass},
+    ClassRange{0x061F, 0x061F, kPunctuationClass},
+    ClassRange{0x066A, 0x066D, kPunctuationClass},
+    ClassRange{0x06D4, 0x06D4, kPunctuationClass},
+    ClassRange{0x0964, 0x0965, kPunctuationClass},
+    ClassRange{0x0E4F, 0x0E4F, kPunctuationClass},
+    ClassRange{0x0E5A, 0x0E5B, kPunctuationClass},
+    ClassRange{0x1680, 0x1680, kBlankClass},
+    ClassRange{0x2000, 0x200B, kBlankClass},
+    ClassRange{0x200C, 0x2027, kPunctuationClass},
+    ClassRange{0x2028, 0x2029, kBlankClass},
+    ClassRange{0x202A, 0x202E, kPunctuationClass},
+    ClassRange{0x202F, 0x202F, kBlankClass},
+    ClassRange{0x2030, 0x205E, kPunctuationClass},
+    ClassRange{0x205F, 0x205F, kBlankClass},
+    ClassRange{0x2060, 0x206F, kPunctuationClass},
+    ClassRange{0x2070, 0x209F, 0x2070},
+    ClassRange{0x20A0, 0x27FF, kPunctuationClass},
+    ClassRange{0x2800, 0x28FF, 0x2800},
+    ClassRange{0x2900, 0x2BFF, kPunctuationClass},
+    ClassRange{0x2E00, 0x2E7F, kPunctuationClass},
+    ClassRange{0x3000, 0x3000, kBlankClass},
+    ClassRange{0x3001, 0x3020, kPunctuationClass},
+    ClassRange{0x3030, 0x3030, kPunctuationClass},
+    ClassRange{0x303D, 0x303D, kPunctuationClass},
+    ClassRange{0x3040, 0x309F, 0x3040},
+    ClassRange{0x30A0, 0x30FF, 0x30A0},
+    ClassRange{0x3300, 0x9FFF, 0x4E00},
+    ClassRange{0xAC00, 0xD7A3, 0xAC00},
+    ClassRange{0xF900, 0xFAFF, 0x4E00},
+    ClassRange{0xFD3E, 0xFD3F, kPunctuationClass},
+    ClassRange{0xFE30, 0xFE6B, kPunctuationClass},
+    ClassRange{0xFF00, 0xFF0F, kPunctuationClass},
+    ClassRange{0xFF1A, 0xFF20, kPunctuationClass},
+    ClassRange{0xFF3B, 0xFF40, kPunctuationClass},
+    ClassRange{0xFF5B, 0xFF65, kPunctuationClass},
+    ClassRange{0x1F000, 0x1F2FF, kPunctuationClass},
+    ClassRange{0x1F300, 0x1F9FF, kEmojiClass},
+    ClassRange{0x1FA70, 0x1FAFF, kEmojiClass},
+    ClassRange{0x20000, 0x2FFFF, 0x4E00},
+    ClassRange{0x30000, 0x3FFFF, 0x4E00},
+};
+
+constexpr std::array<std::uint8_t, 0x80> kAsciiClasses = [] {
+  std::array<std::uint8_t, 0x80> classes{};
+  for (std::size_t value = 0; value < classes.size(); ++value) {
+    const bool kBlank = value == ' ' || (value >= '\t' && value <= '\r');
+    const bool kWord = (value >= '0' && value <= '9') ||
+                       (value >= 'A' && value <= 'Z') ||
+                       (value >= 'a' && value <= 'z') || value == '_';
+    classes[value] = kBlank ? kBlankClass
+                     : kWord ? kWordClass
+                             : kPunctuationClass;
+  }
+  return classes;
+}();
+
+constexpr char32_t kZeroWidthJoiner = 0x200D;
+
+inline bool IsPlainAscii(unsigned char value) {
+  return value >= 0x20 && value < 0x7F;
+}
+
+template <std::size_t kSize>
+bool InRanges(const std::array<Range, kSize>& ranges, char32_t character) {
+  const auto kFound = std::upper_bound(
+      ranges.begin(), ranges.end(), character,
+      [](char32_t value, const Range& range) { return value < range.first; });
+  return kFound != ranges.begin() && character <= (kFound - 1)->last;
+}
+// Zero-width characters that attach to the one before them; spaces, bidi
+// controls and the like stand alone.
+bool ExtendsGrapheme(char32_t character) {
+  if (character == 0x200B || character == 0xFEFF ||
+      (character >= 0x2028 && character <= 0x202E) ||
+      (character >= 0x2060 && character <= 0x2064)) {
+    return false;
+  }
+  return core::CharacterWidth(character) == 0;
+}
+
+// The start of the character holding `index`, as DecodeUtf8() splits the
+// text: a byte that no sequence before it covers is a character itself.
+std::size_t CharacterStart(std::string_view text, std::size_t index) {
+  if (!core::IsUtf8Continuation(text[index])) {
+    return index;
+  }
+  const std::size_t kFloor = index < 3 ? 0 : index - 3;
+  std::size_t start = index;
+  while (start > kFloor && core::IsUtf8Continuation(text[start])) {
+    --start;
+  }
+  std::size_t length = 0;
+  core::DecodeUtf8(text, start, length);
+  return start + length > index ? start : index;
+}
+}  // namespace
+
+namespace core {
+char32_t DecodeUtf8(std::string_view text, std::size_t index,
+                    std::size_t& length) noexcept {
+  length = 1;
+  const auto kLead = static_cast<unsigned char>(text[index]);
+  if (kLead < 0x80) {
+    return kLead;
+  }
+
+  std::size_t size = 0;
+  char32_t character = 0;
+  char32_t minimum = 0;
+  if (kLead >= 0xC2 && kLead <= 0xDF) {
+    size = 2;
+    character = kLead & 0x1F;
+    minimum = 0x80;
+  } else if (kLead >= 0xE0 && kLead <= 0xEF) {
+    size = 3;
+    character = kLead & 0x0F;
+    minimum = 0x800;
+  } else if (kLead >= 0xF0 && kLead <= 0xF4) {
+    size = 4;
+    character = kLead & 0x07;
+    minimum = 0x10000;
+  } else {
+    return kReplacementCharacter;
+  }
+  if (text.size() - index < size) {
+    return kReplacementCharacter;
+  }
+  for (std::size_t offset = 1; offset < size; ++offset) {
+    const char kByte = text[index + offset];
+    if (!IsUtf8Continuation(kByte)) {
+      return kReplacementCharacter;
+    }
+    character = (character << 6) | (static_cast<unsigned char>(kByte) & 0x3F);
+  }
+  if (character < minimum || character > 0x10FFFF ||
+      (character >= 0xD800 && character <= 0xDFFF)) {
+    return kReplacementCharacter;
+  }
+  length = size;
+  return character;
+}
+
+std::size_t CharacterWidth(char32_t character) noexcept {
+  if (character < 0x300) {
+    return 1;
+  }
+  if (InRanges(kZeroWidthRanges, character)) {
+    return 0;
+  }
+  return InRanges(kWideRanges, character) ? 2 : 1;
+}
+
+std::size_t DisplayWidth(std::string_view text) noexcept {
+  std::size_t width = 0;
+  for (std::size_t index = 0; index < text.size();) {
+    if (static_cast<unsigned char>(text[index]) < 0x80) {
+      ++width;
+      ++index;
+      continue;
+    }
+    std::size_t length = 0;
+    width += CharacterWidth(DecodeUtf8(text, index, length));
+    index += length;
+  }
+  return width;
+}
+
+std::size_t PlainAsciiPrefix(std::string_view text) noexcept {
+  const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+  const std::size_t kSize = text.size();
+  constexpr std::size_t kWidth = 16;
+  std::size_t index = 0;
+#if defined(MICROVI_UTF8_SSE2)
+  // Signed comparisons, so bytes from 0x80 up fail the first.
+  const __m128i kBelow = _mm_set1_epi8(0x1F);
+  const __m128i kAbove = _mm_set1_epi8(0x7F);
+  for (; index + kWidth <= kSize; index += kWidth) {
+    const __m128i kBlock =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+    const auto kPlain = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(kBlock, kBelow),
+                                        _mm_cmplt_epi8(kBlock, kAbove))));
+    if (kPlain != 0xFFFF) {
+      return index + static_cast<std::size_t>(std::countr_one(kPlain));
+    }
+  }
+#elif defined(MICROVI_UTF8_NEON)
+  const uint8x16_t kLow = vdupq_n_u8(0x20);
+  const uint8x16_t kHigh = vdupq_n_u8(0x7F);
+  for (; index + kWidth <= kSize; index += kWidth) {
+    const uint8x16_t kBlock = vld1q_u8(data + index);
+    const uint8x16_t kPlain =
+        vandq_u8(vcgeq_u8(kBlock, kLow), vcltq_u8(kBlock, kHigh));
+    if (vminvq_u8(kPlain) != 0xFF) {
+      break;
+    }
+  }
+#endif
+  while (index < kSize && IsPlainAscii(data[index])) {
+    ++index;
+  }
+  return index;
+}
+
+std::size_t NextGrapheme(std::string_view text, std::size_t index) noexcept {
+  if (index >= text.size()) {
+    return text.size();
+  }
+  std::size_t length = 0;
+  char32_t character = DecodeUtf8(text, index, length);
+  index += length;
+  while (index < text.size() &&
+         static_cast<unsigned char>(text[index]) >= 0x80) {
+    const char32_t kNext = DecodeUtf8(text, index, length);
+    if (character != kZeroWidthJoiner && !ExtendsGrapheme(kNext)) {
+      break;
+    }
+    character = kNext;
+    index += length;
+  }
+  return index;
+}
+
+std::size_t GraphemeStart(std::string_view text, std::size_t index) noexcept {
+  if (index >= text.size()) {
+    return text.size();
+  }
+  std::size_t start = CharacterStart(text, index);
+  while (start > 0 && static_cast<unsigned char>(text[start]) >= 0x80) {
+    std::size_t length = 0;
+    const std::size_t kPrevious = CharacterStart(text, start - 1);
+    if (!ExtendsGrapheme(DecodeUtf8(text, start, length)) &&
+        DecodeUtf8(text, kPrevious, length) != kZeroWidthJoiner) {
+      break;
+    }
+    start = kPrevious;
+  }
+  return start;
+}
+
+std::size_t SkipGraphemes(std::string_view text, std::size_t index,
+                          std::size_t count) noexcept {
+  while (count > 0 && index < text.size()) {
+    // Every byte of the run but its last starts a grapheme of one byte; the
+    // last may still gain combining marks.
+    const std::size_t kRun = PlainAsciiPrefix(
+        text.substr(index, (std::min)(count, text.size() - index)));
+    if (kRun > 1) {
+      index += kRun - 1;
+      count -= kRun - 1;
+    }
+    index = NextGrapheme(text, index);
+    --count;
+  }
+  return index;
+}
+
+std::uint32_t WordClass(char32_t character) noexcept {
+  if (character < kAsciiClasses.size()) {
+    return kAsciiClasses[character];
+  }
+  const auto kFound = std::upper_bound(
+      kClassRanges.begin(), kClassRanges.end(), character,
+      [](char32_t value, const ClassRange& range) {
+        return value < range.first;
+      });
+  if (kFound != kClassRanges.begin() && character <= (kFound - 1)->last) {
+    return (kFound - 1)->word_class;
+  }
+  return kWordClass;
+}
+}  // namespace core
@@ -0,0 +1,270 @@
+#include "core/WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace core {
+struct TaskState {
+  TaskWork work;
+  TaskCompletion completion;
+  std::stop_source stop;
+  std::atomic<TaskStatus> status{TaskStatus::kQueued};
+};
+}  // namespace core
+
+namespace {
+// Which pool and queue the current thread serves, so tasks submitted from a
+// task go to the submitting thread's own queue.
+thread_local const core::WorkerPool* t_pool = nullptr;
+thread_local std::size_t t_worker = 0;
+
+bool IsFinished(core::TaskStatus status) {
+  return status == core::TaskStatus::kDone ||
+         status == core::TaskStatus::kCancelled;
+}
+}  // namespace
+
+namespace core {
+TaskHandle::TaskHandle(std::shared_ptr<TaskState> state)
+    : state_(std::move(state)) {}
+
+bool TaskHandle::Valid() const noexcept {
+  return state_ != nullptr;
+}
+
+TaskStatus TaskHandle::Status() const noexcept {
+  return state_ != nullptr ? state_->status.load(std::memory_order_acquire)
+                           : TaskStatus::kCancelled;
+}
+
+bool TaskHandle::Finished() const noexcept {
+  return IsFinished(Status());
+}
+
+bool TaskHandle::Cancel() {
+  if (Finished()) {
+    return false;
+  }
+  state_->stop.request_stop();
+  return true;
+}
+
+void TaskHandle::Wait() const {
+  if (state_ == nullptr) {
+    return;
+  }
+  TaskStatus status = state_->status.load(std::memory_order_acquire);
+  while (!IsFinished(status)) {
+    state_->status.wait(status, std::memory_order_acquire);
+    status = state_->status.load(std::memory_order_acquire);
+  }
+}
+
+WorkerPool& WorkerPool::Shared() {
+  static WorkerPool pool;
+  return pool;
+}
+
+WorkerPool::WorkerPool(std::size_t threads) {
+  const std::size_t kThreads =
+      threads != 0
+          ? threads
+          : (std::max)(std::size_t{2},
+                       static_cast<std::size_t>(
+                           std::thread::hardware_concurrency()));
+  workers_.reserve(kThreads);
+  for (std::size_t i = 0; i < kThreads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  threads_.reserve(kThreads);
+  for (std::size_t i = 0; i < kThreads; ++i) {
+    threads_.emplace_back(
+        [this, i](const std::stop_token& token) { Run(i, token); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  // Tasks still queued are dropped; running ones finish first.
+  for (std::jthread& thread : threads_) {
+    thread.request_stop();
+  }
+  threads_.clear();
+}
+
+TaskHandle WorkerPool::Submit(TaskWork work, TaskCompletion completion) {
+  auto task = std::make_shared<TaskState>();
+  task->work = std::move(work);
+  task->completion = std::move(completion);
+
+  const bool kFromWorker = t_pool == this;
+  const std::size_t kIndex =
+      kFromWorker ? t_worker
+                  : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                        workers_.size();
+  // Counted before it is visible, so a thread that takes it never sees the
+  // count go below zero.
+  queued_.fetch_add(1, std::memory_order_seq_cst);
+  {
+    Worker& worker = *workers_[kIndex];
+    const std::lock_guard<std::mutex> kLock(worker.mutex);
+    worker.tasks.push_back(task);
+  }
+  {
+    const std::lock_guard<std::mutex> kLock(sleep_mutex_);
+  }
+  sleep_.notify_one();
+  return TaskHandle(std::move(task));
+}
+
+void WorkerPool::ForEach(std::size_t jobs, std::size_t helpers,
+                         const std::function<void(std::size_t)>& job) {
+  // Shared with the helpers, which may be taken off a queue only after this
+  // returns; by then every job has been claimed, so they touch nothing else.
+  struct Progress {
+    std::size_t jobs = 0;
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> running{0};
+  };
+  auto progress = std::make_shared<Progress>();
+  progress->jobs = jobs;
+
+  helpers = (std::min)({helpers, jobs > 0 ? jobs - 1 : 0, workers_.size()});
+  std::vector<TaskHandle> handles;
+  handles.reserve(helpers);
+  for (std::size_t i = 0; i < helpers; ++i) {
+    handles.push_back(Submit([progress, &job](const std::stop_token&) {
+      // Counted before claiming, so the caller cannot miss a helper that
+      // still holds a job.
+      progress->running.fetch_add(1);
+      for (std::size_t index = progress->next.fetch_add(1);
+           index < progress->jobs; index = progress->next.fetch_add(1)) {
+        job(index);
+      }
+      if (progress->running.fetch_sub(1) == 1) {
+        progress->running.notify_all();
+      }
+    }));
+  }
+
+  for (std::size_t index = progress->next.fetch_add(1); index < jobs;
+       index = progress->next.fetch_add(1)) {
+    job(index);
+  }
+  // Helpers still queued have nothing left to do.
+  for (TaskHandle& handle : handles) {
+    handle.Cancel();
+  }
+  std::size_t running = progress->running.load();
+  while (running != 0) {
+    progress->running.wait(running);
+    running = progress->running.load();
+  }
+}
+
+void WorkerPool::SetWakeHook(WakeHook hook) {
+  const std::lock_guard<std::mutex> kLock(completions_mutex_);
+  wake_hook_ = std::move(hook);
+}
+
+std::size_t WorkerPool::RunCompletions() {
+  std::vector<std::function<void()>> ready;
+  {
+    const std::lock_guard<std::mutex> kLock(completions_mutex_);
+    ready.swap(completions_);
+  }
+  for (const auto& completion : ready) {
+    completion();
+  }
+  return ready.size();
+}
+
+std::size_t WorkerPool::ThreadCount() const noexcept {
+  return workers_.size();
+}
+
+std::uint64_t WorkerPool::Steals() const noexcept {
+  return steals_.load(std::memory_order_relaxed);
+}
+
+void WorkerPool::Run(std::size_t index, const std::stop_token& token) {
+  t_pool = this;
+  t_worker = index;
+  while (!token.stop_requested()) {
+    if (const std::shared_ptr<TaskState> kTask = Take(index)) {
+      Execute(kTask);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleep_.wait(lock, token, [this] {
+      return queued_.load(std::memory_order_seq_cst) > 0;
+    });
+  }
+}
+
+std::shared_ptr<TaskState> WorkerPool::Take(std::size_t index) {
+  std::shared_ptr<TaskState> task;
+  {
+    Worker& own = *workers_[index];
+    const std::lock_guard<std::mutex> kLock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+    }
+  }
+  for (std::size_t i = 1; task == nullptr && i < workers_.size(); ++i) {
+    Worker& victim = *workers_[(index + i) % workers_.size()];
+    const std::lock_guard<std::mutex> kLock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      steals_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (task != nullptr) {
+    queued_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+  return task;
+}
+
+void WorkerPool::Execute(const std::shared_ptr<TaskState>& task) {
+  TaskStatus expected = TaskStatus::kQueued;
+  if (task->stop.stop_requested() ||
+      !task->status.compare_exchange_strong(expected, TaskStatus::kRunning,
+                                            std::memory_order_acq_rel)) {
+    task->work = nullptr;
+    Post(task, TaskStatus::kCancelled);
+    return;
+  }
+  task->work(task->stop.get_token());
+  // Lets go of whatever the work captured before the main loop gets to it.
+  task->work = nullptr;
+  Post(task, task->stop.stop_requested() ? TaskStatus::kCancelled
+                                         : TaskStatus::kDone);
+}
+
+void WorkerPool::Post(const std::shared_ptr<TaskState>& task,
+                      TaskStatus status) {
+  const std::lock_guard<std::mutex> kLock(completions_mutex_);
+  if (task->completion) {
+    completions_.emplace_back([task, status] {
+      TaskCompletion completion = std::move(task->completion);
+      completion(status);
+    });
+  }
+  // Published after the completion, so a Wait() that returns is followed by
+  // a RunCompletions() that runs it.
+  task->status.store(status, std::memory_order_release);
+  task->status.notify_all();
+  if (wake_hook_) {
+    wake_hook_();
+  }
+}
+}  // namespace core
@@ -0,0 +1,98 @@
+#include "io/AppendFile.hpp"
+
+#include <cerrno>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace core {
+AppendFile::~AppendFile() {
+  Close();
+}
+
+bool AppendFile::Open(const std::string& path) {
+  Close();
+#ifdef _WIN32
+  const HANDLE kFile = CreateFileA(
+      path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_DELETE,
+      nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_HIDDEN, nullptr);
+  if (kFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  handle_ = kFile;
+#else
+  const int kFd =
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+  if (kFd < 0) {
+    return false;
+  }
+  fd_ = kFd;
+#endif
+  return true;
+}
+
+void AppendFile::Close() noexcept {
+#ifdef _WIN32
+  if (handle_ != nullptr) {
+    CloseHandle(handle_);
+    handle_ = nullptr;
+  }
+#else
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#endif
+}
+
+bool AppendFile::IsOpen() const noexcept {
+#ifdef _WIN32
+  return handle_ != nullptr;
+#else
+  return fd_ >= 0;
+#endif
+}
+
+bool AppendFile::Append(std::string_view data) {
+  if (!IsOpen()) {
+    return false;
+  }
+  while (!data.empty()) {
+#ifdef _WIN32
+    DWORD written = 0;
+    const auto kChunk = static_cast<DWORD>(
+        data.size() < 0x40000000 ? data.size() : 0x40000000);
+    if (WriteFile(handle_, data.data(), kChunk, &written, nullptr) == 0) {
+      return false;
+    }
+#else
+    const ssize_t kWritten = ::write(fd_, data.data(), data.size());
+    if (kWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    const auto written = static_cast<std::size_t>(kWritten);
+#endif
+    data.remove_prefix(written);
+  }
+  return true;
+}
+
+bool AppendFile::Sync() {
+  if (!IsOpen()) {
+    return false;
+  }
+#ifdef _WIN32
+  return FlushFileBuffers(handle_) != 0;
+#else
+  return ::fsync(fd_) == 0;
+#endif
+}
+}  // namespace core
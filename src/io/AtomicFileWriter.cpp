@@ -0,0 +1,265 @@
+#include "io/AtomicFileWriter.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+// WriteFileGather needs page-sized, unbuffered writes, so small spans are
+// coalesced into a staging buffer instead and large ones written directly.
+constexpr std::size_t kStagingBytes = 1024 * 1024;
+constexpr std::size_t kDirectWriteBytes = 64 * 1024;
+#else
+#ifdef IOV_MAX
+constexpr std::size_t kMaxBatch = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+constexpr std::size_t kMaxBatch = 16;
+#endif
+#endif
+
+// Replacing a symlink would turn it into a regular file; write through it to
+// the file it names instead.
+std::filesystem::path ResolveTarget(const std::string& target_path) {
+  const std::filesystem::path kPath(target_path);
+  std::error_code error;
+  if (std::filesystem::is_symlink(kPath, error)) {
+    std::filesystem::path resolved = std::filesystem::canonical(kPath, error);
+    if (!error) {
+      return resolved;
+    }
+  }
+  return kPath;
+}
+}  // namespace
+
+namespace core {
+AtomicFileWriter::~AtomicFileWriter() {
+  Abort();
+}
+
+bool AtomicFileWriter::Open(const std::string& target_path) {
+  Abort();
+  const std::filesystem::path kTarget = ResolveTarget(target_path);
+  std::filesystem::path directory = kTarget.parent_path();
+  if (directory.empty()) {
+    directory = ".";
+  }
+
+  target_path_ = kTarget.string();
+  bytes_written_ = 0;
+  failed_ = false;
+
+#ifdef _WIN32
+  char temp_name[MAX_PATH];
+  if (GetTempFileNameA(directory.string().c_str(), "mvi", 0, temp_name) ==
+      0) {
+    return false;
+  }
+  temp_path_ = temp_name;
+
+  const HANDLE kFile =
+      CreateFileA(temp_path_.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (kFile == INVALID_HANDLE_VALUE) {
+    DeleteFileA(temp_path_.c_str());
+    temp_path_.clear();
+    return false;
+  }
+  handle_ = kFile;
+  staging_.clear();
+  staging_.reserve(kStagingBytes);
+#else
+  std::string pattern =
+      (directory / ("." + kTarget.filename().string() + ".microvi-XXXXXX"))
+          .string();
+  const int kFd = ::mkstemp(pattern.data());
+  if (kFd < 0) {
+    return false;
+  }
+  temp_path_ = pattern;
+  fd_ = kFd;
+
+  // Keep the permissions (and, where allowed, the owner) of the file being
+  // replaced; new files get the permissions open(2) would have given them.
+  struct stat info{};
+  if (::stat(target_path_.c_str(), &info) == 0) {
+    ::fchmod(fd_, info.st_mode & 07777);
+    [[maybe_unused]] const int kOwned =
+        ::fchown(fd_, info.st_uid, info.st_gid);
+  } else {
+    const mode_t kMask = ::umask(0);
+    ::umask(kMask);
+    ::fchmod(fd_, 0666 & ~kMask);
+  }
+  batch_.clear();
+#endif
+  return true;
+}
+
+void AtomicFileWriter::Append(std::string_view span) {
+  if (failed_ || span.empty()) {
+    return;
+  }
+
+#ifdef _WIN32
+  if (span.size() >= kDirectWriteBytes) {
+    if (!Flush() || !WriteAll(span.data(), span.size())) {
+      failed_ = true;
+    }
+    return;
+  }
+  if (staging_.size() + span.size() > kStagingBytes && !Flush()) {
+    return;
+  }
+  staging_.append(span);
+#else
+  batch_.push_back({const_cast<char*>(span.data()), span.size()});
+  if (batch_.size() >= kMaxBatch) {
+    Flush();
+  }
+#endif
+}
+
+bool AtomicFileWriter::Flush() {
+  if (failed_) {
+    return false;
+  }
+
+#ifdef _WIN32
+  if (!WriteAll(staging_.data(), staging_.size())) {
+    failed_ = true;
+  }
+  staging_.clear();
+#else
+  std::size_t first = 0;
+  while (first < batch_.size()) {
+    const int kCount =
+        static_cast<int>((std::min)(batch_.size() - first, kMaxBatch));
+    const ssize_t kWritten = ::writev(fd_, batch_.data() + first, kCount);
+    if (kWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      failed_ = true;
+      break;
+    }
+
+    bytes_written_ += static_cast<std::uint64_t>(kWritten);
+    auto remaining = static_cast<std::size_t>(kWritten);
+    while (first < batch_.size() && remaining >= batch_[first].iov_len) {
+      remaining -= batch_[first].iov_len;
+      ++first;
+    }
+    if (remaining > 0) {
+      batch_[first].iov_base =
+          static_cast<char*>(batch_[first].iov_base) + remaining;
+      batch_[first].iov_len -= remaining;
+    }
+  }
+  batch_.clear();
+#endif
+  return !failed_;
+}
+
+bool AtomicFileWriter::Commit() {
+  if (temp_path_.empty()) {
+    return false;
+  }
+
+  if (!Flush()) {
+    Abort();
+    return false;
+  }
+
+#ifdef _WIN32
+  const bool kSynced = FlushFileBuffers(handle_) != 0;
+  CloseHandle(handle_);
+  handle_ = nullptr;
+  if (!kSynced ||
+      MoveFileExA(temp_path_.c_str(), target_path_.c_str(),
+                  MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == 0) {
+    Abort();
+    return false;
+  }
+#else
+  const bool kSynced = ::fsync(fd_) == 0;
+  const bool kClosed = ::close(fd_) == 0;
+  fd_ = -1;
+  if (!kSynced || !kClosed ||
+      ::rename(temp_path_.c_str(), target_path_.c_str()) != 0) {
+    Abort();
+    return false;
+  }
+
+  // Make the rename itself durable.
+  std::filesystem::path directory =
+      std::filesystem::path(target_path_).parent_path();
+  if (directory.empty()) {
+    directory = ".";
+  }
+  const int kDirectory =
+      ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (kDirectory >= 0) {
+    ::fsync(kDirectory);
+    ::close(kDirectory);
+  }
+#endif
+  temp_path_.clear();
+  return true;
+}
+
+void AtomicFileWriter::Abort() noexcept {
+#ifdef _WIN32
+  if (handle_ != nullptr) {
+    CloseHandle(handle_);
+    handle_ = nullptr;
+  }
+  staging_.clear();
+  if (!temp_path_.empty()) {
+    DeleteFileA(temp_path_.c_str());
+  }
+#else
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  batch_.clear();
+  if (!temp_path_.empty()) {
+    ::unlink(temp_path_.c_str());
+  }
+#endif
+  temp_path_.clear();
+}
+
+std::uint64_t AtomicFileWriter::BytesWritten() const noexcept {
+  return bytes_written_;
+}
+
+#ifdef _WIN32
+bool AtomicFileWriter::WriteAll(const char* data, std::size_t size) {
+  while (size > 0) {
+    const DWORD kChunk = static_cast<DWORD>(
+        (std::min)(size, static_cast<std::size_t>(1) << 30));
+    DWORD written = 0;
+    if (WriteFile(handle_, data, kChunk, &written, nullptr) == 0) {
+      return false;
+    }
+    bytes_written_ += written;
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+#endif
+}  // namespace core
@@ -1,12 +1,17 @@
 #include "io/ConsoleKeySource.hpp"
 
-#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
 
 #include "core/KeyEvent.hpp"
+#include "io/Terminal.hpp"
 
 #ifdef _WIN32
 #include <conio.h>
+#include <windows.h>
 #else
+#include <poll.h>
 #include <unistd.h>
 
 #include <fcntl.h>
@@ -60,55 +65,145 @@ KeyEvent TranslateExtended(int code) {
   }
 }
 #else
-constexpr unsigned char kEscapeChar = static_cast<unsigned char>(kEscapeCode);
-constexpr unsigned char kEscapeBracket = '[';
-constexpr unsigned char kArrowUpSeq = 'A';
-constexpr unsigned char kArrowDownSeq = 'B';
-constexpr unsigned char kArrowRightSeq = 'C';
-constexpr unsigned char kArrowLeftSeq = 'D';
+constexpr char kEscapeChar = static_cast<char>(kEscapeCode);
+constexpr char kEscapeBracket = '[';
+constexpr char kEscapeSs3 = 'O';
+constexpr char kArrowUpSeq = 'A';
+constexpr char kArrowDownSeq = 'B';
+constexpr char kArrowRightSeq = 'C';
+constexpr char kArrowLeftSeq = 'D';
+constexpr std::string_view kPasteStartParams = "200";
+constexpr std::string_view kPasteEnd = "\x1b[201~";
+constexpr std::string_view kEnableBracketedPaste = "\x1b[?2004h";
+constexpr std::string_view kDisableBracketedPaste = "\x1b[?2004l";
+
+bool IsCsiFinal(char value) {
+  return value >= 0x40 && value <= 0x7E;
+}
+
+// Terminals send line breaks in pasted text as CR.
+void NormalizeLineBreaks(std::string& text) {
+  std::size_t out = 0;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '\r') {
+      text[out++] = '\n';
+      if (i + 1 < text.size() && text[i + 1] == '\n') {
+        ++i;
+      }
+    } else {
+      text[out++] = text[i];
+    }
+  }
+  text.resize(out);
+}
 #endif
 }  // namespace
 
 ConsoleKeySource::ConsoleKeySource() {
-#ifndef _WIN32
-  if (tcgetattr(STDIN_FILENO, &original_) == 0) {
+#ifdef _WIN32
+  const HANDLE kConsole =
+      CreateFileA("CONIN$", GENERIC_READ | GENERIC_WRITE,
+                  FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                  FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (kConsole != INVALID_HANDLE_VALUE) {
+    console_ = kConsole;
+  }
+#else
+  input_ = std::make_unique<char[]>(kInputBufferBytes);
+  fd_ = STDIN_FILENO;
+  if (::isatty(STDIN_FILENO) == 0) {
+    const int kTerminal = ::open("/dev/tty", O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (kTerminal >= 0) {
+      fd_ = kTerminal;
+      owns_fd_ = true;
+    }
+  }
+  if (tcgetattr(fd_, &original_) == 0) {
     termios raw = original_;
     raw.c_lflag &= static_cast<tcflag_t>(~(ICANON | ECHO));
     raw.c_iflag &= static_cast<tcflag_t>(~(IXON | ICRNL));
     raw.c_oflag &= static_cast<tcflag_t>(~OPOST);
     raw.c_cc[VMIN] = 0;
     raw.c_cc[VTIME] = 0;
-    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0) {
+    if (tcsetattr(fd_, TCSANOW, &raw) == 0) {
       has_original_mode_ = true;
+      WriteToTerminal(kEnableBracketedPaste);
     }
   }
 
-  original_flags_ = fcntl(STDIN_FILENO, F_GETFL, 0);
+  original_flags_ = fcntl(fd_, F_GETFL, 0);
   if (original_flags_ != -1) {
-    fcntl(STDIN_FILENO, F_SETFL, original_flags_ | O_NONBLOCK);
+    fcntl(fd_, F_SETFL, original_flags_ | O_NONBLOCK);
   }
 #endif
 }
 
 ConsoleKeySource::~ConsoleKeySource() {
-#ifndef _WIN32
+#ifdef _WIN32
+  if (console_ != nullptr) {
+    CloseHandle(console_);
+  }
+#else
   if (has_original_mode_) {
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_);
+    WriteToTerminal(kDisableBracketedPaste);
+    tcsetattr(fd_, TCSANOW, &original_);
   }
   if (original_flags_ != -1) {
-    fcntl(STDIN_FILENO, F_SETFL, original_flags_);
+    fcntl(fd_, F_SETFL, original_flags_);
+  }
+  if (owns_fd_) {
+    ::close(fd_);
   }
 #endif
 }
 
 KeyEvent ConsoleKeySource::Next() {
+  Waker never;
   KeyEvent event{};
   while (!Poll(event)) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    WaitForInput(never);
   }
   return event;
 }
 
+bool ConsoleKeySource::WaitForInput(const Waker& interrupt) {
+#ifdef _WIN32
+  const HANDLE kInput =
+      console_ != nullptr ? console_ : GetStdHandle(STD_INPUT_HANDLE);
+  const HANDLE kHandles[] = {kInput, interrupt.Handle()};
+  const DWORD kResult = WaitForMultipleObjects(2, kHandles, FALSE, INFINITE);
+  if (kResult != WAIT_OBJECT_0) {
+    return false;
+  }
+
+  // The console handle is also signaled for key releases, focus and resize
+  // records, which _kbhit() ignores; drop them so the next wait blocks.
+  INPUT_RECORD record{};
+  DWORD count = 0;
+  while (PeekConsoleInputA(kInput, &record, 1, &count) != 0 && count > 0) {
+    if (record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown) {
+      break;
+    }
+    ReadConsoleInputA(kInput, &record, 1, &count);
+  }
+  return true;
+#else
+  pollfd entries[] = {
+      {.fd = fd_, .events = POLLIN, .revents = 0},
+      {.fd = interrupt.Fd(), .events = POLLIN, .revents = 0},
+  };
+  while (::poll(entries, 2, -1) < 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  if ((entries[0].revents & (POLLHUP | POLLERR | POLLNVAL)) != 0) {
+    return false;
+  }
+  return (entries[1].revents & POLLIN) == 0;
+#endif
+}
+
 bool ConsoleKeySource::Poll(KeyEvent& event) {
 #ifdef _WIN32
   if (_kbhit() == 0) {
@@ -126,61 +221,161 @@ bool ConsoleKeySource::Poll(KeyEvent& event) {
   }
   return true;
 #else
-  unsigned char ch = 0;
-  const ssize_t count = ::read(STDIN_FILENO, &ch, 1);
+  if (in_paste_) {
+    return ContinuePaste(event);
+  }
+
+  if (Available() == 0 && !Fill()) {
+    return false;
+  }
+
+  const char kFirst = input_[input_begin_];
+  last_code_ = static_cast<unsigned char>(kFirst);
+  if (kFirst == kEscapeChar) {
+    return DecodeEscape(event);
+  }
+
+  ++input_begin_;
+  event = TranslateChar(static_cast<unsigned char>(kFirst));
+  return true;
+#endif
+}
+
+#ifndef _WIN32
+bool ConsoleKeySource::Fill() {
+  if (input_begin_ == input_end_) {
+    input_begin_ = 0;
+    input_end_ = 0;
+  } else if (input_end_ == kInputBufferBytes) {
+    std::memmove(input_.get(), input_.get() + input_begin_, Available());
+    input_end_ -= input_begin_;
+    input_begin_ = 0;
+  }
+  if (input_end_ == kInputBufferBytes) {
+    return false;
+  }
+
+  ssize_t count = 0;
+  do {
+    count = ::read(fd_, input_.get() + input_end_,
+                   kInputBufferBytes - input_end_);
+  } while (count < 0 && errno == EINTR);
   if (count <= 0) {
-    if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
-        errno != EINTR) {
-      event = KeyEvent{.code = KeyCode::kEscape};
-      return true;
-    }
     return false;
   }
+  input_end_ += static_cast<std::size_t>(count);
+  return true;
+}
 
-  last_code_ = ch;
+bool ConsoleKeySource::FillWithin(std::chrono::milliseconds timeout) {
+  if (Fill()) {
+    return true;
+  }
+  if (Available() == kInputBufferBytes) {
+    return false;
+  }
+  pollfd entry{.fd = fd_, .events = POLLIN, .revents = 0};
+  int ready = 0;
+  do {
+    ready = ::poll(&entry, 1, static_cast<int>(timeout.count()));
+  } while (ready < 0 && errno == EINTR);
+  return ready > 0 && Fill();
+}
+
+std::size_t ConsoleKeySource::Available() const noexcept {
+  return input_end_ - input_begin_;
+}
 
-  if (ch == kEscapeChar) {
-    unsigned char seq = 0;
-    const ssize_t first = ::read(STDIN_FILENO, &seq, 1);
-    if (first <= 0) {
+bool ConsoleKeySource::DecodeEscape(KeyEvent& event) {
+  // A sequence split across reads waits up to kEscapeTimeout for the rest.
+  // An ESC that nothing follows in that time is the Escape key; a sequence
+  // left unfinished is dropped, so its tail is not typed as keys.
+  if (Available() < 2) {
+    FillWithin(kEscapeTimeout);
+  }
+  if (Available() < 2 || (input_[input_begin_ + 1] != kEscapeBracket &&
+                          input_[input_begin_ + 1] != kEscapeSs3)) {
+    ++input_begin_;
+    event = KeyEvent{.code = KeyCode::kEscape};
+    return true;
+  }
+
+  const char kIntroducer = input_[input_begin_ + 1];
+  std::size_t final = input_begin_ + 2;
+  while (true) {
+    while (final < input_end_ && !IsCsiFinal(input_[final])) {
+      ++final;
+    }
+    if (final < input_end_) {
+      break;
+    }
+    const std::size_t kOffset = final - input_begin_;
+    if (!FillWithin(kEscapeTimeout)) {
+      input_begin_ = input_end_;
       event = KeyEvent{.code = KeyCode::kEscape};
       return true;
     }
+    final = input_begin_ + kOffset;
+  }
 
-    if (seq == kEscapeBracket) {
-      unsigned char final = 0;
-      const ssize_t second = ::read(STDIN_FILENO, &final, 1);
-      if (second <= 0) {
-        event = KeyEvent{.code = KeyCode::kEscape};
-        return true;
-      }
+  const std::string_view kParams(input_.get() + input_begin_ + 2,
+                                 final - input_begin_ - 2);
+  const char kFinal = input_[final];
+  input_begin_ = final + 1;
+  last_code_ = static_cast<unsigned char>(kFinal);
 
-      last_code_ = final;
-      switch (final) {
-        case kArrowUpSeq:
-          event = KeyEvent{.code = KeyCode::kArrowUp};
-          return true;
-        case kArrowDownSeq:
-          event = KeyEvent{.code = KeyCode::kArrowDown};
-          return true;
-        case kArrowLeftSeq:
-          event = KeyEvent{.code = KeyCode::kArrowLeft};
-          return true;
-        case kArrowRightSeq:
-          event = KeyEvent{.code = KeyCode::kArrowRight};
-          return true;
-        default:
-          event = KeyEvent{.code = KeyCode::kEscape};
-          return true;
-      }
-    }
+  if (kIntroducer == kEscapeBracket && kFinal == '~' &&
+      kParams == kPasteStartParams) {
+    in_paste_ = true;
+    paste_.clear();
+    return ContinuePaste(event);
+  }
 
-    event = KeyEvent{.code = KeyCode::kEscape};
-    return true;
+  if (kParams.empty() || kIntroducer == kEscapeSs3) {
+    switch (kFinal) {
+      case kArrowUpSeq:
+        event = KeyEvent{.code = KeyCode::kArrowUp};
+        return true;
+      case kArrowDownSeq:
+        event = KeyEvent{.code = KeyCode::kArrowDown};
+        return true;
+      case kArrowLeftSeq:
+        event = KeyEvent{.code = KeyCode::kArrowLeft};
+        return true;
+      case kArrowRightSeq:
+        event = KeyEvent{.code = KeyCode::kArrowRight};
+        return true;
+      default:
+        break;
+    }
   }
 
-  event = TranslateChar(static_cast<int>(ch));
+  event = KeyEvent{.code = KeyCode::kEscape};
   return true;
-#endif
 }
+
+bool ConsoleKeySource::ContinuePaste(KeyEvent& event) {
+  while (true) {
+    const std::string_view kPending(input_.get() + input_begin_, Available());
+    const std::size_t kEnd = kPending.find(kPasteEnd);
+    if (kEnd != std::string_view::npos) {
+      paste_.append(kPending.substr(0, kEnd));
+      input_begin_ += kEnd + kPasteEnd.size();
+      in_paste_ = false;
+      NormalizeLineBreaks(paste_);
+      event = KeyEvent{.code = KeyCode::kPaste, .text = paste_};
+      return true;
+    }
+
+    // Keep a tail that could be the start of a split terminator.
+    const std::size_t kKeep =
+        std::min(kPending.size(), kPasteEnd.size() - 1);
+    paste_.append(kPending.substr(0, kPending.size() - kKeep));
+    input_begin_ += kPending.size() - kKeep;
+    if (!Fill()) {
+      return false;
+    }
+  }
+}
+#endif
 }  // namespace core
@@ -0,0 +1,281 @@
+#include "io/FileWatcher.hpp"
+
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__)
+#define MICROVI_KQUEUE 1
+#include <fcntl.h>
+#include <sys/event.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+// What polling compares, and what tells a Windows directory notification
+// that concerns the file from one that does not.
+struct Stamp {
+  bool exists = false;
+  std::uintmax_t size = 0;
+  std::filesystem::file_time_type modified;
+
+  bool operator==(const Stamp&) const = default;
+};
+
+Stamp StampOf(const std::string& path) {
+  Stamp stamp;
+  std::error_code error;
+  stamp.size = std::filesystem::file_size(path, error);
+  if (error) {
+    return {};
+  }
+  stamp.modified = std::filesystem::last_write_time(path, error);
+  stamp.exists = !error;
+  return stamp;
+}
+
+#ifdef MICROVI_KQUEUE
+int OpenForEvents(const std::string& path) {
+#ifdef O_EVTONLY
+  return ::open(path.c_str(), O_EVTONLY | O_CLOEXEC);
+#else
+  return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+#endif
+}  // namespace
+
+namespace core {
+FileWatcher::~FileWatcher() {
+  Stop();
+}
+
+void FileWatcher::Watch(const std::string& path, std::function<void()> hook) {
+  Stop();
+  path_ = path;
+  hook_ = std::move(hook);
+  pending_.store(static_cast<std::uint8_t>(FileChange::kNone));
+  stop_.Drain();
+  thread_ = std::jthread([this](const std::stop_token& token) { Run(token); });
+}
+
+void FileWatcher::Stop() {
+  if (thread_.joinable()) {
+    thread_.request_stop();
+    stop_.Notify();
+    thread_.join();
+  }
+  path_.clear();
+}
+
+bool FileWatcher::IsWatching() const noexcept {
+  return thread_.joinable();
+}
+
+const std::string& FileWatcher::Path() const noexcept {
+  return path_;
+}
+
+FileChange FileWatcher::Take() noexcept {
+  return static_cast<FileChange>(
+      pending_.exchange(static_cast<std::uint8_t>(FileChange::kNone)));
+}
+
+void FileWatcher::Run(const std::stop_token& token) {
+  if (!RunNative(token)) {
+    RunPolling(token);
+  }
+}
+
+void FileWatcher::Post(FileChange change) {
+  const auto kValue = static_cast<std::uint8_t>(change);
+  std::uint8_t pending = pending_.load();
+  while (pending < kValue &&
+         !pending_.compare_exchange_weak(pending, kValue)) {
+  }
+  if (hook_) {
+    hook_();
+  }
+}
+
+void FileWatcher::RunPolling(const std::stop_token& token) {
+  Stamp last = StampOf(path_);
+  while (!token.stop_requested()) {
+    stop_.Wait(kPollInterval);
+    const Stamp kNow = StampOf(path_);
+    if (kNow != last && kNow.exists) {
+      Post(last.exists ? FileChange::kModified : FileChange::kReplaced);
+    }
+    last = kNow;
+  }
+}
+
+#ifdef _WIN32
+bool FileWatcher::RunNative(const std::stop_token& token) {
+  // Directories are what Windows watches; a change is the file's only if
+  // its stamp moved.
+  const std::filesystem::path kDirectory =
+      std::filesystem::absolute(path_).parent_path();
+  HANDLE change = FindFirstChangeNotificationW(
+      kDirectory.c_str(), FALSE,
+      FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE |
+          FILE_NOTIFY_CHANGE_LAST_WRITE);
+  if (change == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  Stamp last = StampOf(path_);
+  const HANDLE kHandles[2] = {change, stop_.Handle()};
+  while (!token.stop_requested()) {
+    const DWORD kWoken = WaitForMultipleObjects(2, kHandles, FALSE, INFINITE);
+    if (kWoken != WAIT_OBJECT_0) {
+      break;
+    }
+    const Stamp kNow = StampOf(path_);
+    if (kNow != last && kNow.exists) {
+      Post(last.exists ? FileChange::kModified : FileChange::kReplaced);
+    }
+    last = kNow;
+    if (FindNextChangeNotification(change) == 0) {
+      break;
+    }
+  }
+  FindCloseChangeNotification(change);
+  return true;
+}
+#elif defined(__linux__)
+bool FileWatcher::RunNative(const std::stop_token& token) {
+  const int kFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (kFd < 0) {
+    return false;
+  }
+  constexpr std::uint32_t kMask =
+      IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+  int watch = ::inotify_add_watch(kFd, path_.c_str(), kMask);
+
+  alignas(inotify_event) char events[4096];
+  while (!token.stop_requested()) {
+    pollfd entries[2] = {
+        {.fd = kFd, .events = POLLIN, .revents = 0},
+        {.fd = stop_.Fd(), .events = POLLIN, .revents = 0},
+    };
+    // A file that went away is looked for again until it is back.
+    const int kTimeout =
+        watch < 0 ? static_cast<int>(kPollInterval.count()) : -1;
+    if (::poll(entries, 2, kTimeout) < 0 && errno != EINTR) {
+      break;
+    }
+    if (token.stop_requested()) {
+      break;
+    }
+
+    bool modified = false;
+    bool lost = false;
+    ssize_t size = 0;
+    while ((size = ::read(kFd, events, sizeof(events))) > 0) {
+      for (const char* at = events; at < events + size;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(at);
+        if ((event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) !=
+            0) {
+          lost = true;
+        } else {
+          modified = true;
+        }
+        at += sizeof(inotify_event) + event->len;
+      }
+    }
+    if (modified) {
+      Post(FileChange::kModified);
+    }
+    if (lost && watch >= 0) {
+      ::inotify_rm_watch(kFd, watch);
+      watch = -1;
+    }
+    if (watch < 0) {
+      watch = ::inotify_add_watch(kFd, path_.c_str(), kMask);
+      if (watch >= 0) {
+        Post(FileChange::kReplaced);
+      }
+    }
+  }
+  ::close(kFd);
+  return true;
+}
+#elif defined(MICROVI_KQUEUE)
+bool FileWatcher::RunNative(const std::stop_token& token) {
+  const int kQueue = ::kqueue();
+  if (kQueue < 0) {
+    return false;
+  }
+  struct kevent stop_event{};
+  EV_SET(&stop_event, stop_.Fd(), EVFILT_READ, EV_ADD, 0, 0, nullptr);
+  ::kevent(kQueue, &stop_event, 1, nullptr, 0, nullptr);
+
+  // Registers the file, which is dropped from the queue when it is closed.
+  const auto kArm = [this, kQueue]() {
+    const int kFile = OpenForEvents(path_);
+    if (kFile >= 0) {
+      struct kevent change{};
+      EV_SET(&change, kFile, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+             NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE |
+                 NOTE_RENAME,
+             0, nullptr);
+      ::kevent(kQueue, &change, 1, nullptr, 0, nullptr);
+    }
+    return kFile;
+  };
+  int file = kArm();
+
+  while (!token.stop_requested()) {
+    const auto kInterval =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(kPollInterval);
+    const timespec kTimeout{
+        .tv_sec = 0, .tv_nsec = static_cast<long>(kInterval.count())};
+    struct kevent event{};
+    const int kCount =
+        ::kevent(kQueue, nullptr, 0, &event, 1, file < 0 ? &kTimeout : nullptr);
+    if (kCount < 0 && errno != EINTR) {
+      break;
+    }
+    if (token.stop_requested()) {
+      break;
+    }
+
+    if (kCount > 0 && event.filter == EVFILT_VNODE) {
+      if ((event.fflags & (NOTE_DELETE | NOTE_RENAME)) != 0) {
+        ::close(file);
+        file = -1;
+      } else {
+        Post(FileChange::kModified);
+      }
+    }
+    if (file < 0) {
+      file = kArm();
+      if (file >= 0) {
+        Post(FileChange::kReplaced);
+      }
+    }
+  }
+  if (file >= 0) {
+    ::close(file);
+  }
+  ::close(kQueue);
+  return true;
+}
+#else
+bool FileWatcher::RunNative(const std::stop_token& /*token*/) {
+  return false;
+}
+#endif
+}  // namespace core
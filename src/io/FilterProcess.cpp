@@ -0,0 +1,175 @@
+#include "io/FilterProcess.hpp"
+
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+extern char** environ;  // NOLINT(readability-redundant-declaration)
+#endif
+
+namespace {
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool WouldBlock(int error) {
+  return error == EAGAIN || error == EWOULDBLOCK;
+}
+#endif
+}  // namespace
+
+namespace core {
+FilterProcess::~FilterProcess() {
+#ifndef _WIN32
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  if (pid_ >= 0) {
+    ::kill(static_cast<pid_t>(pid_), SIGKILL);
+    Wait();
+  }
+#endif
+}
+
+#ifdef _WIN32
+bool FilterProcess::Start(const std::string& /*command*/) {
+  return false;
+}
+
+void FilterProcess::Run(const Source& /*source*/, const Sink& /*sink*/) {}
+
+int FilterProcess::Wait() noexcept {
+  return -1;
+}
+#else
+bool FilterProcess::Start(const std::string& command) {
+  if (pid_ >= 0) {
+    return false;
+  }
+  int fds[2] = {-1, -1};
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    return false;
+  }
+  for (const int kFd : fds) {
+    ::fcntl(kFd, F_SETFD, FD_CLOEXEC);
+  }
+
+  // dup2 clears close-on-exec on the child's copies.
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+  ::posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  ::posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+  char shell[] = "/bin/sh";
+  char flag[] = "-c";
+  char* argv[] = {shell, flag, const_cast<char*>(command.c_str()), nullptr};
+  pid_t pid = -1;
+  const int kError =
+      ::posix_spawn(&pid, shell, &actions, nullptr, argv, environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  ::close(fds[1]);
+  if (kError != 0) {
+    ::close(fds[0]);
+    return false;
+  }
+
+  ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  const int kOn = 1;
+  ::setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &kOn, sizeof(kOn));
+#endif
+  fd_ = fds[0];
+  pid_ = static_cast<int>(pid);
+  return true;
+}
+
+void FilterProcess::Run(const Source& source, const Sink& sink) {
+  std::string input;
+  std::size_t sent = 0;
+  bool more = true;
+  bool writing = true;
+  std::vector<char> output(kChunkBytes);
+
+  while (fd_ >= 0) {
+    if (writing && sent == input.size()) {
+      input.clear();
+      sent = 0;
+      while (more && input.size() < kChunkBytes) {
+        more = source(input);
+      }
+      if (input.empty()) {
+        // The child reads this as the end of its input.
+        ::shutdown(fd_, SHUT_WR);
+        writing = false;
+      }
+    }
+
+    pollfd watched{fd_, static_cast<short>(POLLIN | (writing ? POLLOUT : 0)),
+                   0};
+    if (::poll(&watched, 1, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    if (writing && (watched.revents & POLLOUT) != 0) {
+      ssize_t written = 0;
+      do {
+        written = ::send(fd_, input.data() + sent, input.size() - sent,
+                         kSendFlags);
+      } while (written < 0 && errno == EINTR);
+      if (written >= 0) {
+        sent += static_cast<std::size_t>(written);
+      } else if (!WouldBlock(errno)) {
+        // It stopped reading; whatever it writes still counts.
+        writing = false;
+      }
+    }
+
+    if ((watched.revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+      ssize_t received = 0;
+      do {
+        received = ::read(fd_, output.data(), output.size());
+      } while (received < 0 && errno == EINTR);
+      if (received > 0) {
+        sink(std::string_view(output.data(),
+                              static_cast<std::size_t>(received)));
+      } else if (received == 0 || !WouldBlock(errno)) {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+  }
+}
+
+int FilterProcess::Wait() noexcept {
+  if (pid_ < 0) {
+    return -1;
+  }
+  const auto kPid = static_cast<pid_t>(pid_);
+  pid_ = -1;
+  int status = 0;
+  while (::waitpid(kPid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+}  // namespace core
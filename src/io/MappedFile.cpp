@@ -0,0 +1,126 @@
+#include "io/MappedFile.hpp"
+
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace core {
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::Open(const std::string& file_path) {
+  return Open(file_path, 0, SIZE_MAX);
+}
+
+bool MappedFile::Open(const std::string& file_path, std::uint64_t offset,
+                      std::size_t length) {
+  Close();
+#ifdef _WIN32
+  const HANDLE kFile =
+      CreateFileA(file_path.c_str(), GENERIC_READ,
+                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (kFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size{};
+  if (GetFileSizeEx(kFile, &size) == 0 || GetFileType(kFile) != FILE_TYPE_DISK) {
+    CloseHandle(kFile);
+    return false;
+  }
+
+  const auto kFileSize = static_cast<std::uint64_t>(size.QuadPart);
+  if (offset >= kFileSize || length == 0) {
+    CloseHandle(kFile);
+    return true;
+  }
+
+  const HANDLE kMapping =
+      CreateFileMappingA(kFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(kFile);
+  if (kMapping == nullptr) {
+    return false;
+  }
+
+  const auto kLength = static_cast<std::size_t>(
+      length < kFileSize - offset ? length : kFileSize - offset);
+  const void* view = MapViewOfFile(kMapping, FILE_MAP_READ,
+                                   static_cast<DWORD>(offset >> 32),
+                                   static_cast<DWORD>(offset), kLength);
+  if (view == nullptr) {
+    CloseHandle(kMapping);
+    return false;
+  }
+
+  mapping_ = kMapping;
+  data_ = static_cast<const char*>(view);
+  size_ = kLength;
+  return true;
+#else
+  const int kFd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (kFd < 0) {
+    return false;
+  }
+
+  struct stat info{};
+  if (::fstat(kFd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    ::close(kFd);
+    return false;
+  }
+
+  const auto kFileSize = static_cast<std::uint64_t>(info.st_size);
+  if (offset >= kFileSize || length == 0) {
+    ::close(kFd);
+    return true;
+  }
+
+  const auto kLength = static_cast<std::size_t>(
+      length < kFileSize - offset ? length : kFileSize - offset);
+  void* view = ::mmap(nullptr, kLength, PROT_READ, MAP_PRIVATE, kFd,
+                      static_cast<off_t>(offset));
+  ::close(kFd);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+
+  data_ = static_cast<const char*>(view);
+  size_ = kLength;
+  return true;
+#endif
+}
+
+void MappedFile::Close() noexcept {
+#ifdef _WIN32
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+#else
+  if (data_ != nullptr) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+std::string_view MappedFile::View() const noexcept {
+  return {data_, size_};
+}
+
+std::size_t MappedFile::Size() const noexcept {
+  return size_;
+}
+}  // namespace core
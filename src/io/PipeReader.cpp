@@ -0,0 +1,134 @@
+#include "io/PipeReader.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace core {
+PipeReader::~PipeReader() {
+  Stop();
+}
+
+bool PipeReader::Start(std::function<void()> hook) {
+  Stop();
+#ifdef _WIN32
+  DWORD mode = 0;
+  if (GetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), &mode) != 0) {
+    return false;
+  }
+#else
+  if (::isatty(STDIN_FILENO) != 0) {
+    return false;
+  }
+#endif
+  hook_ = std::move(hook);
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    pending_.clear();
+    closed_ = false;
+  }
+  stop_.Drain();
+  thread_ = std::jthread([this](const std::stop_token& token) { Run(token); });
+  return true;
+}
+
+void PipeReader::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  thread_.request_stop();
+  stop_.Notify();
+#ifdef _WIN32
+  // A read from a pipe cannot be waited for together with an event, so it is
+  // cancelled instead, until the thread is out of it.
+  const HANDLE kThread = thread_.native_handle();
+  while (WaitForSingleObject(kThread, 10) == WAIT_TIMEOUT) {
+    CancelSynchronousIo(kThread);
+  }
+#endif
+  thread_.join();
+}
+
+bool PipeReader::Drain(std::string& bytes) {
+  bool closed = false;
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    bytes.append(pending_);
+    pending_.clear();
+    closed = closed_;
+  }
+  drained_.notify_all();
+  return closed;
+}
+
+void PipeReader::Run(const std::stop_token& token) {
+  std::string chunk(kChunkBytes, '\0');
+  while (!token.stop_requested()) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!drained_.wait(lock, token, [this] {
+            return pending_.size() < kMaxPendingBytes;
+          })) {
+        return;
+      }
+    }
+
+#ifdef _WIN32
+    DWORD count = 0;
+    if (ReadFile(GetStdHandle(STD_INPUT_HANDLE), chunk.data(),
+                 static_cast<DWORD>(chunk.size()), &count, nullptr) == 0 ||
+        count == 0) {
+      if (token.stop_requested()) {
+        return;
+      }
+      break;
+    }
+#else
+    pollfd entries[2] = {
+        {.fd = STDIN_FILENO, .events = POLLIN, .revents = 0},
+        {.fd = stop_.Fd(), .events = POLLIN, .revents = 0},
+    };
+    if (::poll(entries, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (token.stop_requested()) {
+      return;
+    }
+    const ssize_t kCount = ::read(STDIN_FILENO, chunk.data(), chunk.size());
+    if (kCount < 0 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    }
+    if (kCount <= 0) {
+      break;
+    }
+    const auto count = static_cast<std::size_t>(kCount);
+#endif
+
+    {
+      const std::lock_guard<std::mutex> kLock(mutex_);
+      pending_.append(chunk.data(), count);
+    }
+    if (hook_) {
+      hook_();
+    }
+  }
+
+  {
+    const std::lock_guard<std::mutex> kLock(mutex_);
+    closed_ = true;
+  }
+  if (hook_) {
+    hook_();
+  }
+}
+}  // namespace core
@@ -0,0 +1,160 @@
+#include "io/PluginProcess.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+extern char** environ;  // NOLINT(readability-redundant-declaration)
+#endif
+
+namespace {
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// How long Stop() waits for a plugin to exit by itself.
+constexpr int kExitChecks = 20;
+constexpr std::chrono::milliseconds kExitCheckInterval{10};
+
+bool WouldBlock(int error) {
+  return error == EAGAIN || error == EWOULDBLOCK;
+}
+#endif
+}  // namespace
+
+namespace core {
+PluginProcess::~PluginProcess() {
+  Stop();
+}
+
+int PluginProcess::Fd() const noexcept {
+  return fd_;
+}
+
+#ifdef _WIN32
+bool PluginProcess::Start(const std::string& /*path*/) {
+  return false;
+}
+
+void PluginProcess::Stop() noexcept {}
+
+std::ptrdiff_t PluginProcess::Send(std::string_view /*bytes*/, int /*fd*/) {
+  return -1;
+}
+
+std::ptrdiff_t PluginProcess::Receive(char* /*data*/, std::size_t /*size*/) {
+  return -1;
+}
+#else
+bool PluginProcess::Start(const std::string& path) {
+  Stop();
+  int fds[2] = {-1, -1};
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    return false;
+  }
+  for (const int kFd : fds) {
+    ::fcntl(kFd, F_SETFD, FD_CLOEXEC);
+  }
+
+  // dup2 clears close-on-exec on the child's copies.
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+  ::posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  ::posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+  char* argv[] = {const_cast<char*>(path.c_str()), nullptr};
+  pid_t pid = -1;
+  const int kError =
+      ::posix_spawn(&pid, path.c_str(), &actions, nullptr, argv, environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  ::close(fds[1]);
+  if (kError != 0) {
+    ::close(fds[0]);
+    return false;
+  }
+
+  ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  const int kOn = 1;
+  ::setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &kOn, sizeof(kOn));
+#endif
+  fd_ = fds[0];
+  pid_ = static_cast<int>(pid);
+  return true;
+}
+
+void PluginProcess::Stop() noexcept {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  if (pid_ < 0) {
+    return;
+  }
+
+  const auto kPid = static_cast<pid_t>(pid_);
+  pid_ = -1;
+  for (int i = 0; i < kExitChecks; ++i) {
+    if (::waitpid(kPid, nullptr, WNOHANG) != 0) {
+      return;
+    }
+    std::this_thread::sleep_for(kExitCheckInterval);
+  }
+  ::kill(kPid, SIGKILL);
+  while (::waitpid(kPid, nullptr, 0) < 0 && errno == EINTR) {
+  }
+}
+
+std::ptrdiff_t PluginProcess::Send(std::string_view bytes, int fd) {
+  iovec data{const_cast<char*>(bytes.data()), bytes.size()};
+  msghdr message{};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  if (fd >= 0) {
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(header), &fd, sizeof(int));
+  }
+
+  ssize_t sent = 0;
+  do {
+    sent = ::sendmsg(fd_, &message, kSendFlags);
+  } while (sent < 0 && errno == EINTR);
+  if (sent < 0) {
+    return WouldBlock(errno) ? 0 : -1;
+  }
+  return sent;
+}
+
+std::ptrdiff_t PluginProcess::Receive(char* data, std::size_t size) {
+  ssize_t received = 0;
+  do {
+    received = ::read(fd_, data, size);
+  } while (received < 0 && errno == EINTR);
+  if (received > 0) {
+    return received;
+  }
+  return received < 0 && WouldBlock(errno) ? 0 : -1;
+}
+#endif
+}  // namespace core
@@ -0,0 +1,246 @@
+#include "io/RpcProtocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace {
+constexpr std::size_t kLengthBytes = 4;
+constexpr std::uint8_t kHasText = 0x01;
+constexpr std::uint8_t kAttachesText = 0x02;
+
+class FrameWriter {
+ public:
+  FrameWriter(std::string& out, core::RpcMessageType type)
+      : out_(out), start_(out.size()) {
+    out_.append(kLengthBytes, '\0');
+    U8(static_cast<std::uint8_t>(type));
+  }
+
+  FrameWriter(const FrameWriter&) = delete;
+  FrameWriter& operator=(const FrameWriter&) = delete;
+
+  // Fills in the length once every field is written.
+  ~FrameWriter() {
+    const std::size_t kLength = out_.size() - start_ - kLengthBytes;
+    for (std::size_t i = 0; i < kLengthBytes; ++i) {
+      out_[start_ + i] = static_cast<char>((kLength >> (8 * i)) & 0xFFu);
+    }
+  }
+
+  void U8(std::uint8_t value) { out_.push_back(static_cast<char>(value)); }
+
+  void U32(std::uint32_t value) { Little(value, 4); }
+
+  void U64(std::uint64_t value) { Little(value, 8); }
+
+  void String(std::string_view value) {
+    U32(static_cast<std::uint32_t>(value.size()));
+    out_.append(value);
+  }
+
+ private:
+  void Little(std::uint64_t value, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; ++i) {
+      out_.push_back(static_cast<char>((value >> (8 * i)) & 0xFFu));
+    }
+  }
+
+  std::string& out_;
+  std::size_t start_;
+};
+
+// Reads fields in order; once one runs past the end, every later read
+// yields zero and Done() reports false.
+class PayloadReader {
+ public:
+  explicit PayloadReader(std::string_view payload) : rest_(payload) {}
+
+  std::uint8_t U8() { return static_cast<std::uint8_t>(Little(1)); }
+
+  std::uint32_t U32() { return static_cast<std::uint32_t>(Little(4)); }
+
+  std::uint64_t U64() { return Little(8); }
+
+  std::string String() {
+    const std::uint32_t kSize = U32();
+    if (!ok_ || rest_.size() < kSize) {
+      ok_ = false;
+      return {};
+    }
+    std::string value(rest_.substr(0, kSize));
+    rest_.remove_prefix(kSize);
+    return value;
+  }
+
+  // A list length, refused when the rest could not hold that many items.
+  std::uint32_t Count() {
+    const std::uint32_t kCount = U32();
+    if (kCount > rest_.size()) {
+      ok_ = false;
+      return 0;
+    }
+    return kCount;
+  }
+
+  bool Done() const noexcept { return ok_ && rest_.empty(); }
+
+ private:
+  std::uint64_t Little(std::size_t bytes) {
+    if (!ok_ || rest_.size() < bytes) {
+      ok_ = false;
+      return 0;
+    }
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; ++i) {
+      value |= static_cast<std::uint64_t>(static_cast<unsigned char>(rest_[i]))
+               << (8 * i);
+    }
+    rest_.remove_prefix(bytes);
+    return value;
+  }
+
+  std::string_view rest_;
+  bool ok_ = true;
+};
+}  // namespace
+
+namespace core {
+void EncodeRpc(const RpcHello& message, std::string& out) {
+  FrameWriter frame(out, RpcMessageType::kHello);
+  frame.U32(message.version);
+  frame.String(message.name);
+  frame.U32(static_cast<std::uint32_t>(message.commands.size()));
+  for (const RpcCommandSpec& command : message.commands) {
+    frame.String(command.id);
+    frame.String(command.label);
+    frame.U32(command.capabilities);
+    frame.String(command.gesture);
+  }
+}
+
+void EncodeRpc(const RpcInvoke& message, std::string& out) {
+  FrameWriter frame(out, RpcMessageType::kInvoke);
+  frame.U64(message.call);
+  frame.String(message.command_id);
+  frame.U64(message.count);
+  frame.U8(static_cast<std::uint8_t>(message.operand));
+  frame.U32(static_cast<std::uint32_t>(message.arguments.size()));
+  for (const auto& [key, value] : message.arguments) {
+    frame.String(key);
+    frame.String(value);
+  }
+  frame.U64(message.revision);
+  frame.U64(message.cursor_line);
+  frame.U64(message.cursor_column);
+  frame.U8((message.has_text ? kHasText : 0) |
+           (message.attaches_text ? kAttachesText : 0));
+  frame.U64(message.text_bytes);
+}
+
+void EncodeRpc(const RpcResult& message, std::string& out) {
+  FrameWriter frame(out, RpcMessageType::kResult);
+  frame.U64(message.call);
+  frame.U8(static_cast<std::uint8_t>(message.severity));
+  frame.String(message.message);
+  frame.U32(static_cast<std::uint32_t>(message.edits.size()));
+  for (const RpcEdit& edit : message.edits) {
+    frame.U64(edit.start_line);
+    frame.U64(edit.start_column);
+    frame.U64(edit.end_line);
+    frame.U64(edit.end_column);
+    frame.String(edit.text);
+  }
+}
+
+bool DecodeRpc(std::string_view payload, RpcHello& message) {
+  PayloadReader in(payload);
+  message.version = in.U32();
+  message.name = in.String();
+  message.commands.resize(in.Count());
+  for (RpcCommandSpec& command : message.commands) {
+    command.id = in.String();
+    command.label = in.String();
+    command.capabilities = in.U32();
+    command.gesture = in.String();
+  }
+  return in.Done();
+}
+
+bool DecodeRpc(std::string_view payload, RpcInvoke& message) {
+  PayloadReader in(payload);
+  message.call = in.U64();
+  message.command_id = in.String();
+  message.count = in.U64();
+  message.operand = static_cast<char>(in.U8());
+  message.arguments.resize(in.Count());
+  for (auto& [key, value] : message.arguments) {
+    key = in.String();
+    value = in.String();
+  }
+  message.revision = in.U64();
+  message.cursor_line = in.U64();
+  message.cursor_column = in.U64();
+  const std::uint8_t kFlags = in.U8();
+  message.has_text = (kFlags & kHasText) != 0;
+  message.attaches_text = (kFlags & kAttachesText) != 0;
+  message.text_bytes = in.U64();
+  return in.Done();
+}
+
+bool DecodeRpc(std::string_view payload, RpcResult& message) {
+  PayloadReader in(payload);
+  message.call = in.U64();
+  const std::uint8_t kSeverity = in.U8();
+  message.severity =
+      kSeverity <= static_cast<std::uint8_t>(RpcSeverity::kError)
+          ? static_cast<RpcSeverity>(kSeverity)
+          : RpcSeverity::kNone;
+  message.message = in.String();
+  message.edits.resize(in.Count());
+  for (RpcEdit& edit : message.edits) {
+    edit.start_line = in.U64();
+    edit.start_column = in.U64();
+    edit.end_line = in.U64();
+    edit.end_column = in.U64();
+    edit.text = in.String();
+  }
+  return in.Done();
+}
+
+void RpcFrameReader::Append(std::string_view bytes) {
+  if (consumed_ != 0) {
+    data_.erase(0, consumed_);
+    consumed_ = 0;
+  }
+  data_.append(bytes);
+}
+
+bool RpcFrameReader::Next(RpcMessageType& type, std::string_view& payload) {
+  const std::string_view kRest = std::string_view(data_).substr(consumed_);
+  if (malformed_ || kRest.size() < kLengthBytes) {
+    return false;
+  }
+  std::size_t length = 0;
+  for (std::size_t i = 0; i < kLengthBytes; ++i) {
+    length |= static_cast<std::size_t>(static_cast<unsigned char>(kRest[i]))
+              << (8 * i);
+  }
+  if (length == 0 || length > kRpcMaxFrame) {
+    malformed_ = true;
+    return false;
+  }
+  if (kRest.size() < kLengthBytes + length) {
+    return false;
+  }
+  type = static_cast<RpcMessageType>(kRest[kLengthBytes]);
+  payload = kRest.substr(kLengthBytes + 1, length - 1);
+  consumed_ += kLengthBytes + length;
+  return true;
+}
+
+bool RpcFrameReader::Malformed() const noexcept {
+  return malformed_;
+}
+}  // namespace core
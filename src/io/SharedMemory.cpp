@@ -0,0 +1,98 @@
+#include "io/SharedMemory.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifndef __linux__
+#include <atomic>
+#include <string>
+#endif
+#endif
+
+namespace {
+#if !defined(_WIN32) && !defined(__linux__)
+std::atomic<unsigned> g_next_name{0};
+#endif
+
+int CreateAnonymousFile() {
+#if defined(_WIN32)
+  return -1;
+#elif defined(__linux__)
+  return ::memfd_create("microvi", MFD_CLOEXEC);
+#else
+  // Unlinked as soon as it exists, so only its descriptors keep it.
+  const std::string kName = "/microvi-" + std::to_string(::getpid()) + "-" +
+                            std::to_string(g_next_name.fetch_add(1));
+  const int kFd = ::shm_open(kName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (kFd >= 0) {
+    ::shm_unlink(kName.c_str());
+    ::fcntl(kFd, F_SETFD, FD_CLOEXEC);
+  }
+  return kFd;
+#endif
+}
+}  // namespace
+
+namespace core {
+SharedMemory::~SharedMemory() {
+  Close();
+}
+
+bool SharedMemory::Create(std::size_t size) {
+  Close();
+#ifdef _WIN32
+  static_cast<void>(size);
+  return false;
+#else
+  const int kFd = CreateAnonymousFile();
+  if (kFd < 0) {
+    return false;
+  }
+  if (::ftruncate(kFd, static_cast<off_t>(size)) != 0) {
+    ::close(kFd);
+    return false;
+  }
+  if (size != 0) {
+    void* data =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, kFd, 0);
+    if (data == MAP_FAILED) {
+      ::close(kFd);
+      return false;
+    }
+    data_ = static_cast<char*>(data);
+  }
+  fd_ = kFd;
+  size_ = size;
+  return true;
+#endif
+}
+
+void SharedMemory::Close() noexcept {
+#ifndef _WIN32
+  if (data_ != nullptr) {
+    ::munmap(data_, size_);
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  fd_ = -1;
+}
+
+char* SharedMemory::Data() const noexcept {
+  return data_;
+}
+
+std::size_t SharedMemory::Size() const noexcept {
+  return size_;
+}
+
+int SharedMemory::Fd() const noexcept {
+  return fd_;
+}
+}  // namespace core
@@ -5,8 +5,22 @@
 #else
 #include <sys/ioctl.h>
 #include <unistd.h>
+
+#include <cerrno>
 #endif
 
+namespace {
+class Console final : public core::TerminalSink {
+ public:
+  auto Size() -> core::TerminalSize override {
+    return core::QueryTerminalSize();
+  }
+  auto Write(std::string_view bytes) -> bool override {
+    return core::WriteToTerminal(bytes);
+  }
+};
+}  // namespace
+
 namespace core {
 auto QueryTerminalSize() -> TerminalSize {
 #ifdef _WIN32
@@ -39,4 +53,38 @@ auto QueryTerminalSize() -> TerminalSize {
 
   return TerminalSize{};
 }
+
+auto WriteToTerminal(std::string_view bytes) -> bool {
+#ifdef _WIN32
+  const HANDLE kHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+  if (kHandle == nullptr || kHandle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  while (!bytes.empty()) {
+    DWORD written = 0;
+    if (WriteFile(kHandle, bytes.data(), static_cast<DWORD>(bytes.size()),
+                  &written, nullptr) == 0) {
+      return false;
+    }
+    bytes.remove_prefix(written);
+  }
+#else
+  while (!bytes.empty()) {
+    const ssize_t kWritten = ::write(STDOUT_FILENO, bytes.data(), bytes.size());
+    if (kWritten < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      return false;
+    }
+    bytes.remove_prefix(static_cast<std::size_t>(kWritten));
+  }
+#endif
+  return true;
+}
+
+auto ConsoleSink() -> TerminalSink& {
+  static Console console;
+  return console;
+}
 }  // namespace core
@@ -0,0 +1,96 @@
+#include "io/Waker.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace core {
+#ifdef _WIN32
+Waker::Waker() : event_(CreateEventA(nullptr, FALSE, FALSE, nullptr)) {}
+
+Waker::~Waker() {
+  if (event_ != nullptr) {
+    CloseHandle(event_);
+  }
+}
+
+void Waker::Notify() noexcept {
+  SetEvent(event_);
+}
+
+bool Waker::Wait(std::chrono::milliseconds timeout) {
+  const DWORD kTimeout =
+      timeout.count() < 0 ? INFINITE : static_cast<DWORD>(timeout.count());
+  return WaitForSingleObject(event_, kTimeout) == WAIT_OBJECT_0;
+}
+
+void Waker::Drain() noexcept {
+  ResetEvent(event_);
+}
+
+void* Waker::Handle() const noexcept {
+  return event_;
+}
+#else
+Waker::Waker() {
+  int fds[2] = {-1, -1};
+  if (::pipe(fds) != 0) {
+    return;
+  }
+  for (const int kFd : fds) {
+    ::fcntl(kFd, F_SETFL, ::fcntl(kFd, F_GETFL, 0) | O_NONBLOCK);
+    ::fcntl(kFd, F_SETFD, FD_CLOEXEC);
+  }
+  read_fd_ = fds[0];
+  write_fd_ = fds[1];
+}
+
+Waker::~Waker() {
+  if (read_fd_ >= 0) {
+    ::close(read_fd_);
+  }
+  if (write_fd_ >= 0) {
+    ::close(write_fd_);
+  }
+}
+
+void Waker::Notify() noexcept {
+  const int kSavedErrno = errno;
+  const char kByte = 1;
+  // A full pipe already guarantees a wakeup.
+  [[maybe_unused]] const ssize_t kWritten = ::write(write_fd_, &kByte, 1);
+  errno = kSavedErrno;
+}
+
+bool Waker::Wait(std::chrono::milliseconds timeout) {
+  pollfd entry{.fd = read_fd_, .events = POLLIN, .revents = 0};
+  const int kTimeout = static_cast<int>(timeout.count());
+  int ready = 0;
+  do {
+    ready = ::poll(&entry, 1, kTimeout);
+  } while (ready < 0 && errno == EINTR);
+
+  if (ready <= 0) {
+    return false;
+  }
+  Drain();
+  return true;
+}
+
+void Waker::Drain() noexcept {
+  char bytes[64];
+  while (::read(read_fd_, bytes, sizeof(bytes)) > 0) {
+  }
+}
+
+int Waker::Fd() const noexcept {
+  return read_fd_;
+}
+#endif
+}  // namespace core
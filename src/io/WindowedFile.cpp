@@ -0,0 +1,84 @@
+#include "io/WindowedFile.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace core {
+WindowedFile::WindowedFile(std::size_t max_windows)
+    : max_windows_((std::max)(max_windows, std::size_t{1})) {}
+
+bool WindowedFile::Open(const std::string& file_path) {
+  Close();
+  std::error_code error;
+  const std::uintmax_t kSize = std::filesystem::file_size(file_path, error);
+  if (error) {
+    return false;
+  }
+  path_ = file_path;
+  size_ = kSize;
+  return true;
+}
+
+void WindowedFile::Close() noexcept {
+  windows_.clear();
+  path_.clear();
+  size_ = 0;
+}
+
+std::uint64_t WindowedFile::Size() const noexcept {
+  return size_;
+}
+
+std::string_view WindowedFile::Read(std::uint64_t offset, std::size_t length) {
+  if (offset >= size_ || length == 0) {
+    return {};
+  }
+  const std::uint64_t kEnd = offset + (std::min)(std::uint64_t{length},
+                                                 size_ - offset);
+  for (Window& window : windows_) {
+    if (offset >= window.offset &&
+        kEnd <= window.offset + window.file->Size()) {
+      window.last_used = ++use_clock_;
+      return window.file->View().substr(
+          static_cast<std::size_t>(offset - window.offset),
+          static_cast<std::size_t>(kEnd - offset));
+    }
+  }
+
+  Window* window = nullptr;
+  if (windows_.size() < max_windows_) {
+    window = &windows_.emplace_back();
+    window->file = std::make_unique<MappedFile>();
+  } else {
+    window = &*std::min_element(windows_.begin(), windows_.end(),
+                                [](const Window& left, const Window& right) {
+                                  return left.last_used < right.last_used;
+                                });
+  }
+
+  // kReadBytes is a multiple of any page size or allocation granularity.
+  const std::uint64_t kStart = offset - offset % kReadBytes;
+  const auto kLength = static_cast<std::size_t>(
+      (std::max)(std::uint64_t{kWindowBytes}, kEnd - kStart));
+  window->offset = kStart;
+  window->last_used = ++use_clock_;
+  if (!window->file->Open(path_, kStart, kLength)) {
+    return {};
+  }
+  // Shorter than asked for only if the file shrank since it was opened.
+  const std::string_view kView = window->file->View();
+  const auto kSkip = static_cast<std::size_t>(offset - kStart);
+  return kSkip < kView.size()
+             ? kView.substr(kSkip, static_cast<std::size_t>(kEnd - offset))
+             : std::string_view{};
+}
+
+std::size_t WindowedFile::MappedBytes() const noexcept {
+  std::size_t bytes = 0;
+  for (const Window& window : windows_) {
+    bytes += window.file->Size();
+  }
+  return bytes;
+}
+}  // namespace core
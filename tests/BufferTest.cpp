@@ -0,0 +1,86 @@
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "core/Buffer.hpp"
+
+namespace {
+// A file in the temporary directory, removed again with the test.
+class TempFile {
+ public:
+  explicit TempFile(std::string_view name)
+      : path_((std::filesystem::temp_directory_path() /
+               ("microvi_test_" + std::string(name)))
+                  .string()) {}
+  ~TempFile() {
+    std::error_code error;
+    std::filesystem::remove(path_, error);
+  }
+
+  TempFile(const TempFile&) = delete;
+  TempFile& operator=(const TempFile&) = delete;
+
+  const std::string& Path() const noexcept { return path_; }
+
+  void Write(std::string_view bytes) const {
+    std::ofstream output(path_, std::ios::binary | std::ios::trunc);
+    output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  std::string Read() const {
+    std::ifstream input(path_, std::ios::binary);
+    return {std::istreambuf_iterator<char>(input),
+            std::istreambuf_iterator<char>()};
+  }
+
+ private:
+  std::string path_;
+};
+
+// Loads `bytes` from a file and saves the buffer straight back.
+std::string RoundTrip(std::string_view name, std::string_view bytes) {
+  const TempFile kFile(name);
+  kFile.Write(bytes);
+  core::Buffer buffer;
+  REQUIRE(buffer.LoadFromFile(kFile.Path(), core::LoadStrategy::kRead));
+  REQUIRE(buffer.SaveToFile(kFile.Path()));
+  return kFile.Read();
+}
+}  // namespace
+
+TEST_CASE("One blank line is saved as it was loaded", "[Buffer]") {
+  CHECK(RoundTrip("blank_line", "\n") == "\n");
+  CHECK(RoundTrip("blank_crlf", "\r\n") == "\r\n");
+  CHECK(RoundTrip("two_blank_lines", "\n\n") == "\n\n");
+}
+
+TEST_CASE("An empty file is saved empty", "[Buffer]") {
+  CHECK(RoundTrip("empty", "").empty());
+}
+
+TEST_CASE("A missing final newline stays missing", "[Buffer]") {
+  CHECK(RoundTrip("unterminated", "a\nb") == "a\nb");
+  CHECK(RoundTrip("terminated", "a\nb\n") == "a\nb\n");
+}
+
+TEST_CASE("Text typed into an empty file ends with a newline", "[Buffer]") {
+  const TempFile kFile("typed");
+  kFile.Write("");
+  core::Buffer buffer;
+  REQUIRE(buffer.LoadFromFile(kFile.Path(), core::LoadStrategy::kRead));
+  REQUIRE(buffer.LineCount() >= 1);
+  buffer.ReplaceLine(0, "abc");
+  REQUIRE(buffer.SaveToFile(kFile.Path()));
+  CHECK(kFile.Read() == "abc\n");
+}
+
+TEST_CASE("A new empty buffer is saved empty", "[Buffer]") {
+  const TempFile kFile("new");
+  core::Buffer buffer;
+  REQUIRE(buffer.SaveToFile(kFile.Path()));
+  CHECK(kFile.Read().empty());
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "commands/DeleteCommand.hpp"
+#include "commands/SubstituteCommand.hpp"
+#include "commands/WriteCommand.hpp"
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/ExCommand.hpp"
+#include "core/InputHandler.hpp"
+#include "core/Substitution.hpp"
+
+namespace {
+// Takes a two-part argument as :s does and returns what is left after it.
+std::string TakeSubstitute(std::string_view line, std::string& argument) {
+  std::string_view rest = line;
+  argument = core::TakeDelimitedExArgument(rest, 2);
+  return std::string(rest);
+}
+
+// A path in the temporary directory, removed again with the test.
+class TempPath {
+ public:
+  explicit TempPath(std::string_view name)
+      : path_((std::filesystem::temp_directory_path() /
+               ("microvi_test_" + std::string(name) + "_" +
+                std::to_string(std::random_device()())))
+                  .string()) {}
+  ~TempPath() {
+    std::error_code error;
+    std::filesystem::remove(path_, error);
+  }
+
+  TempPath(const TempPath&) = delete;
+  TempPath& operator=(const TempPath&) = delete;
+
+  const std::string& Path() const noexcept { return path_; }
+
+  std::string Read() const {
+    std::ifstream input(path_, std::ios::binary);
+    return {std::istreambuf_iterator<char>(input),
+            std::istreambuf_iterator<char>()};
+  }
+
+ private:
+  std::string path_;
+};
+
+// Lines enough that :s over all of them runs in the background.
+std::string LargeText() {
+  const std::string kLine = "a quick brown fox jumps over the lazy dog\n";
+  std::string text;
+  while (text.size() <= 2 * core::Substitution::kInlineBytes) {
+    text += kLine;
+  }
+  return text;
+}
+}  // namespace
+
+TEST_CASE("A delimited argument ends after its parts and flags",
+          "[ExCommand]") {
+  std::string argument;
+  CHECK(TakeSubstitute("/a/b/|2d", argument) == "2d");
+  CHECK(argument == "/a/b/");
+  CHECK(TakeSubstitute(" /a/b/ g | 2d", argument) == " 2d");
+  CHECK(argument == "/a/b/g");
+  // A '|' inside the pattern or the replacement is part of them.
+  CHECK(TakeSubstitute("/a|b/c|d/g|3", argument) == "3");
+  CHECK(argument == "/a|b/c|d/g");
+  CHECK(TakeSubstitute("#a\\#|b#c#", argument).empty());
+  CHECK(argument == "#a\\#|b#c#");
+  // Unterminated parts run to the end of the line.
+  CHECK(TakeSubstitute("/a|b", argument).empty());
+  CHECK(argument == "/a|b");
+  // Without a delimiter it is an ordinary argument.
+  CHECK(TakeSubstitute("g|2d", argument) == "2d");
+  CHECK(argument == "g");
+}
+
+TEST_CASE(":s followed by | runs the next command", "[ExCommand]") {
+  core::EditorState state;
+  core::Buffer& buffer = state.GetBuffer();
+  buffer.ReplaceLine(0, "a one");
+  buffer.InsertLine(1, "a two");
+  buffer.InsertLine(2, "a three");
+
+  core::InputHandler handler;
+  handler.RegisterCommand(std::make_unique<commands::SubstituteCommand>());
+  handler.RegisterCommand(std::make_unique<commands::DeleteCommand>());
+  REQUIRE(handler.Handle(state, "s/a/b/|2d"));
+  handler.Finish(state);
+
+  REQUIRE(buffer.LineCount() == 2);
+  CHECK(buffer.GetLine(0) == "b one");
+  CHECK(buffer.GetLine(1) == "a three");
+}
+
+// The commands after a background :s see what it substituted.
+TEST_CASE(":s in the background finishes before the next command",
+          "[ExCommand]") {
+  const std::string kText = LargeText();
+  const TempPath kFile("substitute_in");
+  {
+    std::ofstream output(kFile.Path(), std::ios::binary);
+    output << kText;
+  }
+  core::EditorState state;
+  bool created = false;
+  REQUIRE(state.OpenBuffer(kFile.Path(), created));
+  REQUIRE_FALSE(created);
+
+  core::InputHandler handler;
+  handler.RegisterCommand(std::make_unique<commands::SubstituteCommand>());
+  handler.RegisterCommand(std::make_unique<commands::WriteCommand>());
+  const TempPath kOut("substitute_out");
+  REQUIRE(handler.Handle(state, "%s/a/Z/g | %s/q/c/g | w! " + kOut.Path()));
+  handler.Finish(state);
+
+  std::string expected = kText;
+  for (char& value : expected) {
+    value = value == 'a' ? 'Z' : value == 'q' ? 'c' : value;
+  }
+  CHECK(state.GetBuffer().GetLine(0) ==
+        "Z cuick brown fox jumps over the lZzy dog");
+  CHECK(kOut.Read() == expected);
+}
@@ -0,0 +1,143 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/IndexCache.hpp"
+#include "core/LineScanner.hpp"
+
+namespace {
+// Points XDG_CACHE_HOME at a fresh directory for the test's lifetime. Its
+// name is the test's and a random suffix, as ctest may run tests at once.
+class TempCache {
+ public:
+  explicit TempCache(std::string_view name)
+      : root_(std::filesystem::temp_directory_path() /
+              ("microvi_test_cache_" + std::string(name) + "_" +
+               std::to_string(std::random_device()()))) {
+    const char* old = std::getenv("XDG_CACHE_HOME");
+    had_old_ = old != nullptr;
+    old_ = had_old_ ? old : "";
+    std::filesystem::remove_all(root_);
+    setenv("XDG_CACHE_HOME", root_.c_str(), 1);
+  }
+  ~TempCache() {
+    if (had_old_) {
+      setenv("XDG_CACHE_HOME", old_.c_str(), 1);
+    } else {
+      unsetenv("XDG_CACHE_HOME");
+    }
+    std::error_code error;
+    std::filesystem::remove_all(root_, error);
+  }
+
+  TempCache(const TempCache&) = delete;
+  TempCache& operator=(const TempCache&) = delete;
+
+  const std::filesystem::path& Root() const noexcept { return root_; }
+
+  std::set<std::filesystem::path> Entries() const {
+    std::set<std::filesystem::path> entries;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(
+             core::IndexCache::Directory(), error)) {
+      entries.insert(entry.path());
+    }
+    return entries;
+  }
+
+ private:
+  std::filesystem::path root_;
+  std::string old_;
+  bool had_old_ = false;
+};
+
+std::vector<std::uint64_t> StartsOf(std::string_view text) {
+  std::vector<std::uint64_t> starts;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '\n') {
+      starts.push_back(i + 1);
+    }
+  }
+  return starts;
+}
+
+core::IndexKey KeyFor(std::size_t number) {
+  core::IndexKey key;
+  key.path = "/microvi/test/" + std::to_string(number);
+  return key;
+}
+}  // namespace
+
+TEST_CASE("A cached index is only trusted where it fits the text",
+          "[IndexCache]") {
+  const TempCache kCache("trusted");
+  std::string text;
+  for (int line = 0; line < 10000; ++line) {
+    text += "abcdefghi\n";
+  }
+  const std::filesystem::path kFile = kCache.Root() / "text";
+  std::filesystem::create_directories(kCache.Root());
+  std::ofstream(kFile, std::ios::binary) << text;
+
+  const core::IndexKey kKey = core::IndexKey::Of(kFile.string(), text);
+  const core::TextStats kStats{.bytes = text.size(), .lf_count = 10000};
+  REQUIRE(core::IndexCache::Store(kKey, StartsOf(text), kStats));
+
+  std::vector<std::uint64_t> starts;
+  core::TextStats stats;
+  REQUIRE(core::IndexCache::Load(kKey, text, starts, stats));
+  CHECK(starts == StartsOf(text));
+  CHECK(stats.lf_count == 10000);
+
+  // The same size and the same sampled blocks, but the middle lines start
+  // one byte later.
+  std::string moved = text;
+  for (std::size_t line = 4000; line < 6000; ++line) {
+    moved.replace(line * 10, 10, "\nabcdefghi");
+  }
+  CHECK_FALSE(core::IndexCache::Load(kKey, moved, starts, stats));
+  CHECK(starts.empty());
+}
+
+TEST_CASE("The least recently used cache entries are evicted",
+          "[IndexCache]") {
+  const TempCache kCache("evicted");
+  const auto kLongAgo =
+      std::filesystem::file_time_type::clock::now() - std::chrono::hours(24);
+  std::vector<std::filesystem::path> files;
+  for (std::size_t i = 0; i < core::IndexCache::kMaxEntries; ++i) {
+    const std::set<std::filesystem::path> kBefore = kCache.Entries();
+    REQUIRE(core::IndexCache::Store(KeyFor(i), {}, {}));
+    for (const std::filesystem::path& kPath : kCache.Entries()) {
+      if (!kBefore.contains(kPath)) {
+        files.push_back(kPath);
+      }
+    }
+    REQUIRE(files.size() == i + 1);
+    // Distinct times, oldest first, whatever the clock's resolution.
+    std::filesystem::last_write_time(files.back(),
+                                     kLongAgo + std::chrono::seconds(i));
+  }
+
+  // Loading the oldest makes the second oldest the next to go.
+  std::vector<std::uint64_t> starts;
+  core::TextStats stats;
+  REQUIRE(core::IndexCache::Load(KeyFor(0), "", starts, stats));
+  REQUIRE(core::IndexCache::Store(KeyFor(core::IndexCache::kMaxEntries), {},
+                                  {}));
+
+  const std::set<std::filesystem::path> kAfter = kCache.Entries();
+  CHECK(kAfter.size() == core::IndexCache::kMaxEntries);
+  CHECK(kAfter.contains(files[0]));
+  CHECK_FALSE(kAfter.contains(files[1]));
+  CHECK(kAfter.contains(files[2]));
+}
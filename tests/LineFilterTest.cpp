@@ -0,0 +1,78 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/LineFilter.hpp"
+#include "core/Pattern.hpp"
+
+namespace {
+std::vector<std::string> Sorted(std::vector<std::string_view> lines,
+                                const core::SortOrder& order) {
+  core::SortLines(lines, order);
+  return {lines.begin(), lines.end()};
+}
+}  // namespace
+
+TEST_CASE("SortLines orders by text or by first number", "[LineFilter]") {
+  const std::vector<std::string_view> kLines = {"b 10", "a 2", "c -3", "b 10",
+                                                "x"};
+  CHECK(Sorted(kLines, {}) ==
+        std::vector<std::string>{"a 2", "b 10", "b 10", "c -3", "x"});
+  CHECK(Sorted(kLines, {.unique = true}) ==
+        std::vector<std::string>{"a 2", "b 10", "c -3", "x"});
+  CHECK(Sorted(kLines, {.reverse = true}) ==
+        std::vector<std::string>{"x", "c -3", "b 10", "b 10", "a 2"});
+  // Lines without a number come first; equal keys keep their order.
+  CHECK(Sorted(kLines, {.numeric = true}) ==
+        std::vector<std::string>{"x", "c -3", "a 2", "b 10", "b 10"});
+}
+
+// Large enough to be cut into slices.
+TEST_CASE("SortLines sorts many lines stably", "[LineFilter]") {
+  constexpr std::size_t kCount = 4 * core::kParallelLines + 7;
+  std::vector<std::string> store;
+  store.reserve(kCount);
+  for (std::size_t i = 0; i < kCount; ++i) {
+    store.push_back(std::to_string((i * 7919) % 1000) + " " +
+                    std::to_string(i));
+  }
+  std::vector<std::string_view> lines(store.begin(), store.end());
+  core::SortLines(lines, {.numeric = true});
+  REQUIRE(lines.size() == kCount);
+  for (std::size_t i = 1; i < lines.size(); ++i) {
+    const std::string_view kPrevious = lines[i - 1];
+    const std::string_view kCurrent = lines[i];
+    const int kPreviousKey = std::stoi(std::string(kPrevious));
+    const int kCurrentKey = std::stoi(std::string(kCurrent));
+    REQUIRE(kPreviousKey <= kCurrentKey);
+    if (kPreviousKey == kCurrentKey) {
+      REQUIRE(std::stoul(std::string(kPrevious.substr(kPrevious.find(' ')))) <
+              std::stoul(std::string(kCurrent.substr(kCurrent.find(' ')))));
+    }
+  }
+}
+
+TEST_CASE("MatchLines joins adjacent matches into runs", "[LineFilter]") {
+  const std::vector<std::string_view> kLines = {"apple", "apricot", "fig",
+                                                "kiwi", "apple"};
+  core::Pattern pattern;
+  std::string error;
+  REQUIRE(pattern.Compile("ap", error));
+
+  const std::vector<core::LineRange> kRuns =
+      core::MatchLines(kLines, 10, pattern, false);
+  REQUIRE(kRuns.size() == 2);
+  CHECK(kRuns[0].first == 10);
+  CHECK(kRuns[0].last == 12);
+  CHECK(kRuns[1].first == 14);
+  CHECK(kRuns[1].last == 15);
+
+  const std::vector<core::LineRange> kInverted =
+      core::MatchLines(kLines, 0, pattern, true);
+  REQUIRE(kInverted.size() == 1);
+  CHECK(kInverted[0].first == 2);
+  CHECK(kInverted[0].last == 4);
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch.hpp>
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/Buffer.hpp"
+#include "core/EditorState.hpp"
+#include "core/InputHandler.hpp"
+#include "core/KeyNotation.hpp"
+#include "core/ModeController.hpp"
+#include "core/PluginHost.hpp"
+#include "core/Registers.hpp"
+
+namespace {
+using Lines = std::vector<std::string>;
+
+// An editor over `lines` that is typed at.
+class Session {
+ public:
+  explicit Session(const Lines& lines)
+      : controller_(state_, handler_, plugin_host_) {
+    core::Buffer& buffer = state_.GetBuffer();
+    buffer.ReplaceLine(0, lines.front());
+    for (std::size_t line = 1; line < lines.size(); ++line) {
+      buffer.InsertLine(line, lines[line]);
+    }
+  }
+
+  Session& Type(std::string_view keys) {
+    std::vector<core::KeyEvent> events;
+    std::deque<std::string> pastes;
+    core::ParseKeyNotation(keys, events, pastes);
+    for (const core::KeyEvent& event : events) {
+      controller_.HandleEvent(event);
+    }
+    return *this;
+  }
+
+  Lines Text() const {
+    const core::Buffer& buffer = state_.GetBuffer();
+    Lines lines;
+    for (std::size_t line = 0; line < buffer.LineCount(); ++line) {
+      lines.emplace_back(buffer.GetLine(line));
+    }
+    return lines;
+  }
+
+  std::string Unnamed() const {
+    const core::Registers::Content kContent =
+        state_.GetRegisters().Get(core::Registers::kUnnamed);
+    return kContent ? kContent->text : std::string();
+  }
+
+ private:
+  core::EditorState state_;
+  core::InputHandler handler_;
+  core::PluginHost plugin_host_;
+  core::ModeController controller_;
+};
+
+Lines Typed(const Lines& lines, std::string_view keys) {
+  return Session(lines).Type(keys).Text();
+}
+}  // namespace
+
+// After $ a block reaches the end of every line, the longer ones included.
+TEST_CASE("A block made with $ runs to each line's end", "[ModeController]") {
+  const Lines kLines = {"alpha beta gamma", "delta epsilon"};
+  CHECK(Typed(kLines, "<C-v>j$AEND<Esc>") ==
+        Lines{"alpha beta gammaEND", "delta epsilonEND"});
+  CHECK(Typed(kLines, "w<C-v>j$d") == Lines{"alpha ", "delta "});
+  CHECK(Typed(kLines, "w<C-v>j$cX<Esc>") == Lines{"alpha X", "delta X"});
+  CHECK(Typed(kLines, "w<C-v>j$rx") ==
+        Lines{"alpha xxxxxxxxxx", "delta xxxxxxx"});
+  CHECK(Typed(kLines, "w<C-v>j$IX<Esc>") ==
+        Lines{"alpha Xbeta gamma", "delta Xepsilon"});
+  CHECK(Session(kLines).Type("w<C-v>j$y").Unnamed() == "beta gamma\nepsilon");
+  // Starting on the longer line, $ still follows the shorter one.
+  CHECK(Typed({"delta epsilon", "alpha beta gamma"}, "<C-v>$jAEND<Esc>") ==
+        Lines{"delta epsilonEND", "alpha beta gammaEND"});
+  // Without $ the block keeps the cursor's column.
+  CHECK(Typed(kLines, "<C-v>jeAEND<Esc>") ==
+        Lines{"alphaEND beta gamma", "deltaEND epsilon"});
+}
+
+TEST_CASE("A characterwise selection made with $ takes the line break",
+          "[ModeController]") {
+  const Lines kLines = {"alpha beta", "gamma", "delta"};
+  CHECK(Typed(kLines, "wv$d") == Lines{"alpha gamma", "delta"});
+  CHECK(Typed(kLines, "v$jd") == Lines{"delta"});
+  CHECK(Session(kLines).Type("wv$y").Unnamed() == "beta\n");
+  // At the last character without $, the break stays.
+  CHECK(Typed(kLines, "wvtad") == Lines{"alpha a", "gamma", "delta"});
+  CHECK(Session(kLines).Type("wvey").Unnamed() == "beta");
+}
+
+TEST_CASE("A counted paste puts the register in that many times",
+          "[ModeController]") {
+  const Lines kLines = {"one", "two", "three", "four", "five"};
+  CHECK(Typed(kLines, "2dd3p") ==
+        Lines{"three", "one", "two", "one", "two", "one", "two", "four",
+              "five"});
+  CHECK(Typed(kLines, "yy2P") == Lines{"one", "one", "one", "two", "three",
+                                       "four", "five"});
+  // The copies go in as one change.
+  CHECK(Typed(kLines, "2dd3pu") == Lines{"three", "four", "five"});
+  CHECK(Typed({"abc"}, "yl3p") == Lines{"aaaabc"});
+  // A block's copies sit side by side, each padded out to its width.
+  CHECK(Typed({"ab", "cd"}, "<C-v>jy3p") == Lines{"aaaab", "ccccd"});
+  CHECK(Typed({"ab", "c"}, "<C-v>jly$2p") == Lines{"ababab", "c c c"});
+}
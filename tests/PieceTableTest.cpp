@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/PieceTable.hpp"
+
+namespace {
+// A table over `count` lines "0".."count-1", loaded as a single piece.
+void LoadNumbered(core::PieceTable& table, std::size_t count) {
+  auto text = std::make_shared<std::string>();
+  std::vector<std::uint64_t> starts;
+  for (std::size_t line = 0; line < count; ++line) {
+    *text += std::to_string(line);
+    text->push_back('\n');
+    starts.push_back(text->size());
+  }
+  table.Load(*text, text);
+  table.AppendOriginalLines(starts);
+  table.FinishOriginal();
+}
+}  // namespace
+
+// Every split inside a piece makes a node; the treap must stay heap-ordered
+// and shallow however many there are.
+TEST_CASE("Repeated splits keep the piece tree heap-ordered", "[PieceTable]") {
+  constexpr std::size_t kLines = 20000;
+  core::PieceTable table;
+  LoadNumbered(table, kLines);
+
+  // Every other line, from the top, cuts the one original piece each time.
+  for (std::size_t line = 0; line < table.LineCount(); ++line) {
+    table.EraseLines(line, 1);
+    if (line % 1000 == 0) {
+      INFO("after erasing line " << line);
+      REQUIRE(table.CheckTree());
+    }
+  }
+
+  REQUIRE(table.LineCount() == kLines / 2);
+  CHECK(table.CheckTree());
+  // A random treap of 10000 nodes is expected to be about 30 deep.
+  CHECK(table.TreeDepth() < 100);
+  for (std::size_t line = 0; line < table.LineCount(); ++line) {
+    REQUIRE(table.Line(line) == std::to_string(line * 2 + 1));
+  }
+}
+
+TEST_CASE("Splits made by insertion keep the piece tree heap-ordered",
+          "[PieceTable]") {
+  constexpr std::size_t kLines = 5000;
+  core::PieceTable table;
+  LoadNumbered(table, kLines);
+
+  // Inserting between original lines splits a piece at every step.
+  for (std::size_t line = kLines; line > 0; --line) {
+    table.InsertLine(line, "x");
+  }
+
+  REQUIRE(table.LineCount() == kLines * 2);
+  CHECK(table.CheckTree());
+  CHECK(table.TreeDepth() < 100);
+  CHECK(table.Line(0) == "0");
+  CHECK(table.Line(1) == "x");
+  CHECK(table.Line(kLines * 2 - 2) == std::to_string(kLines - 1));
+}
@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/Mode.hpp"
+#include "core/Registry.hpp"
+
+namespace {
+const core::Origin kOrigin{core::RegistryOriginKind::kCore, "test"};
+
+core::CommandRegistration MakeCommand(std::string id) {
+  core::CommandRegistration command;
+  command.descriptor.id = std::move(id);
+  command.descriptor.modes = {core::Mode::kNormal};
+  command.callable.native_callback =
+      [](const core::CommandInvocation& /*invocation*/) {};
+  return command;
+}
+}  // namespace
+
+// Readers renew their snapshot after every change the writer publishes;
+// each must see the stable command throughout and the churning one only
+// whole.
+TEST_CASE("Lookups see consistent snapshots while the registry changes",
+          "[Registry]") {
+  core::Registry& registry = core::Registry::Instance();
+  const core::RegistrationResult kStable =
+      registry.RegisterCommand(MakeCommand("test.registry.stable"), kOrigin);
+  REQUIRE(kStable.handle.IsValid());
+
+  std::atomic<bool> stop{false};
+  std::atomic<std::size_t> missing{0};
+  std::atomic<std::size_t> torn{0};
+  std::vector<std::jthread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!stop.load()) {
+        if (!registry.FindCommand("test.registry.stable")) {
+          missing.fetch_add(1);
+        }
+        const auto kChurn = registry.FindCommand("test.registry.churn");
+        if (kChurn && kChurn->descriptor.id != "test.registry.churn") {
+          torn.fetch_add(1);
+        }
+      }
+    });
+  }
+
+  const core::CommandRegistration kChurn = MakeCommand("test.registry.churn");
+  for (int i = 0; i < 2000; ++i) {
+    registry.Unregister(registry.RegisterCommand(kChurn, kOrigin).handle);
+  }
+  stop.store(true);
+  readers.clear();
+
+  CHECK(missing.load() == 0);
+  CHECK(torn.load() == 0);
+  CHECK_FALSE(registry.FindCommand("test.registry.churn"));
+  registry.Unregister(kStable.handle);
+  CHECK_FALSE(registry.FindCommand("test.registry.stable"));
+}
+
+TEST_CASE("Subscribers hear of changes until they unsubscribe",
+          "[Registry]") {
+  core::Registry& registry = core::Registry::Instance();
+  std::size_t events = 0;
+  const core::RegistrySubscriptionToken kToken =
+      registry.Subscribe([&events](const core::RegistryEvent& /*event*/) {
+        ++events;
+      });
+  REQUIRE(kToken != 0);
+
+  const core::RegistrationResult kResult =
+      registry.RegisterCommand(MakeCommand("test.registry.notify"), kOrigin);
+  CHECK(events == 1);
+  REQUIRE(registry.Unsubscribe(kToken));
+  registry.Unregister(kResult.handle);
+  CHECK(events == 1);
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "core/WorkerPool.hpp"
+
+TEST_CASE("ForEach runs every job once", "[WorkerPool]") {
+  core::WorkerPool pool(4);
+  constexpr std::size_t kJobs = 1000;
+  std::vector<std::atomic<int>> runs(kJobs);
+  pool.ForEach(kJobs, 3, [&](std::size_t index) { runs[index].fetch_add(1); });
+  for (std::size_t i = 0; i < kJobs; ++i) {
+    REQUIRE(runs[i].load() == 1);
+  }
+
+  std::size_t calls = 0;
+  pool.ForEach(0, 3, [&](std::size_t /*index*/) { ++calls; });
+  pool.ForEach(1, 3, [&](std::size_t /*index*/) { ++calls; });
+  CHECK(calls == 1);
+}
+
+// Every pool thread runs a ForEach of its own, so none is free to help; the
+// callers must still get through their jobs alone.
+TEST_CASE("ForEach inside tasks does not wait on busy threads",
+          "[WorkerPool]") {
+  constexpr std::size_t kThreads = 2;
+  constexpr std::size_t kJobs = 64;
+  core::WorkerPool pool(kThreads);
+  std::atomic<std::size_t> done{0};
+  std::vector<core::TaskHandle> tasks;
+  for (std::size_t i = 0; i < kThreads * 2; ++i) {
+    tasks.push_back(pool.Submit([&](const std::stop_token& /*token*/) {
+      pool.ForEach(kJobs, kThreads,
+                   [&](std::size_t /*index*/) { done.fetch_add(1); });
+    }));
+  }
+  for (const core::TaskHandle& task : tasks) {
+    task.Wait();
+  }
+  CHECK(done.load() == kThreads * 2 * kJobs);
+}